@@ -29,9 +29,12 @@
 
 // data
 #include "../src/data/data.cc"
+#include "../src/data/dense_dmatrix.cc"
 #include "../src/data/simple_csr_source.cc"
 #include "../src/data/simple_dmatrix.cc"
+#include "../src/data/slice_dmatrix.cc"
 #include "../src/data/sparse_page_raw_format.cc"
+#include "../src/data/synthetic_source.cc"
 
 // prediction
 #include "../src/predictor/predictor.cc"
@@ -66,6 +69,8 @@
 #include "../src/common/common.cc"
 #include "../src/common/host_device_vector.cc"
 #include "../src/common/hist_util.cc"
+#include "../src/common/memory_stats.cc"
+#include "../src/common/timer.cc"
 
 // c_api
 #include "../src/c_api/c_api.cc"
@@ -33,6 +33,8 @@ typedef uint64_t bst_ulong;  // NOLINT(*)
 typedef void *DMatrixHandle;  // NOLINT(*)
 /*! \brief handle to Booster */
 typedef void *BoosterHandle;  // NOLINT(*)
+/*! \brief handle to a reusable single instance prediction context */
+typedef void *PredictContextHandle;  // NOLINT(*)
 /*! \brief handle to a data iterator */
 typedef void *DataIterHandle;  // NOLINT(*)
 /*! \brief handle to a internal data holder. */
@@ -228,6 +230,25 @@ XGB_DLL int XGDMatrixCreateFromMat_omp(const float *data,  // NOLINT
                                        bst_ulong nrow, bst_ulong ncol,
                                        float missing, DMatrixHandle *out,
                                        int nthread);
+/*!
+ * \brief create matrix content borrowing a dense matrix the caller owns
+ *
+ *  Unlike XGDMatrixCreateFromMat, nothing is copied at construction; the
+ *  DMatrix keeps a pointer into the caller's matrix and converts it into
+ *  bounded row batches while iterating. The caller must keep `data` alive
+ *  and unchanged until the matrix is freed with XGDMatrixFree.
+ *
+ * \param data pointer to the data space, in row major order
+ * \param nrow number of rows
+ * \param ncol number columns
+ * \param missing which value to represent missing value
+ * \param out created dmatrix
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGDMatrixCreateFromMatBorrowed(const float *data,
+                                           bst_ulong nrow, bst_ulong ncol,
+                                           float missing,
+                                           DMatrixHandle *out);
 /*!
  * \brief create matrix content from python data table
  * \param data pointer to pointer to column data
@@ -256,6 +277,16 @@ XGB_DLL int XGDMatrixSliceDMatrix(DMatrixHandle handle,
                                   const int *idxset,
                                   bst_ulong len,
                                   DMatrixHandle *out);
+/*!
+ * \brief append the rows of one matrix behind another, extending the meta
+ *  information along with the data. Only in-memory matrices support
+ *  appending; the source matrix is left untouched.
+ * \param handle instance of data matrix to extend
+ * \param src instance of data matrix whose rows are appended
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGDMatrixAppendRows(DMatrixHandle handle,
+                                DMatrixHandle src);
 /*!
  * \brief free space in data matrix
  * \return 0 when success, -1 when failure happens
@@ -362,6 +393,34 @@ XGB_DLL int XGBoosterCreate(const DMatrixHandle dmats[],
  */
 XGB_DLL int XGBoosterFree(BoosterHandle handle);
 
+/*!
+ * \brief create a booster over the trees [unit_begin, unit_end) of an
+ *  existing booster. The tree storage is shared, not copied, so slicing
+ *  a large model is cheap; the result predicts and trains independently
+ *  of the source and must be freed with XGBoosterFree.
+ * \param handle handle of the source booster
+ * \param unit_begin index of the first tree to share
+ * \param unit_end one past the last tree to share; 0 means all trees
+ * \param out handle to the sliced booster
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterSlice(BoosterHandle handle,
+                           bst_ulong unit_begin,
+                           bst_ulong unit_end,
+                           BoosterHandle *out);
+
+/*!
+ * \brief create an in-memory clone of a booster without a save/load
+ *  round trip. The clone shares the tree storage copy-on-write, so
+ *  cloning is cheap regardless of the model size; it must be freed with
+ *  XGBoosterFree.
+ * \param handle handle of the source booster
+ * \param out handle to the cloned booster
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterClone(BoosterHandle handle,
+                           BoosterHandle *out);
+
 /*!
  * \brief set parameters
  * \param handle handle
@@ -383,6 +442,41 @@ XGB_DLL int XGBoosterSetParam(BoosterHandle handle,
 XGB_DLL int XGBoosterUpdateOneIter(BoosterHandle handle,
                                    int iter,
                                    DMatrixHandle dtrain);
+/*!
+ * \brief seed the prediction cache of dtrain with margins computed earlier,
+ *        e.g. fetched through XGBoosterGetCachedMargin at the end of a
+ *        previous training session and persisted alongside the model.
+ *        When continuing training on a loaded model, the first
+ *        XGBoosterUpdateOneIter then skips the full prediction pass over
+ *        dtrain that would otherwise rebuild the margins tree by tree.
+ *        The margins must be the untransformed predictions of the current
+ *        model over dtrain; stale margins silently corrupt training.
+ * \param handle handle
+ * \param dtrain training data, must have been passed to XGBoosterCreate
+ * \param margin margin array, length num_row * num_output_group
+ * \param len length of margin
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterSetCachedMargin(BoosterHandle handle,
+                                     DMatrixHandle dtrain,
+                                     const float *margin,
+                                     bst_ulong len);
+/*!
+ * \brief fetch the cached prediction margins of dtrain, the counterpart of
+ *        XGBoosterSetCachedMargin. Right after training the cache already
+ *        holds the final margins, so this costs no prediction pass.
+ *        out_len is 0 when no cached margins are available.
+ * \param handle handle
+ * \param dtrain training data
+ * \param out_len length of the margin array
+ * \param out_result pointer to the margin array, valid until the next
+ *        xgboost call in the same thread
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterGetCachedMargin(BoosterHandle handle,
+                                     DMatrixHandle dtrain,
+                                     bst_ulong *out_len,
+                                     const float **out_result);
 /*!
  * \brief update the model, by directly specify gradient and second order gradient,
  *        this can be used to replace UpdateOneIter, to support customized loss function
@@ -398,6 +492,59 @@ XGB_DLL int XGBoosterBoostOneIter(BoosterHandle handle,
                                   float *grad,
                                   float *hess,
                                   bst_ulong len);
+/*!
+ * \brief Gradient callback of a registered custom objective.
+ *
+ *  Invoked on a contiguous chunk of instances. preds holds margin
+ *  predictions; labels and weights may be NULL when the training data
+ *  carries none, or when label size does not match prediction size
+ *  (multi-class objectives must index labels themselves via begin).
+ *
+ * \param preds margin predictions for the chunk, length len
+ * \param labels labels for the chunk, or NULL
+ * \param weights instance weights for the chunk, or NULL
+ * \param begin global index of the first prediction in the chunk
+ * \param len number of predictions in the chunk
+ * \param out_grad output gradient, length len
+ * \param out_hess output second order gradient, length len
+ * \param user_data the pointer registered along with the callback
+ * \return 0 when success, nonzero to abort the boosting round
+ */
+XGB_EXTERN_C typedef int XGBCustomObjCallback(  // NOLINT(*)
+    const float *preds, const float *labels, const float *weights,
+    bst_ulong begin, bst_ulong len, float *out_grad, float *out_hess,
+    void *user_data);
+/*!
+ * \brief register a custom objective callback on the booster,
+ *        to be used by XGBoosterUpdateOneIterCustom. Unlike
+ *        XGBoosterBoostOneIter this keeps predictions and gradients in
+ *        xgboost-owned buffers that are reused across iterations, so the
+ *        binding only pays for the gradient arithmetic itself.
+ * \param handle handle
+ * \param callback the gradient callback; NULL unregisters
+ * \param parallel if nonzero, chunks may be dispatched to the callback
+ *        from multiple threads concurrently; the callback must be
+ *        thread safe in that case
+ * \param user_data opaque pointer passed through to every invocation
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterSetCustomObjective(BoosterHandle handle,
+                                        XGBCustomObjCallback *callback,
+                                        int parallel,
+                                        void *user_data);
+/*!
+ * \brief update the model in one round using dtrain and the custom
+ *        objective registered through XGBoosterSetCustomObjective:
+ *        predict margins, invoke the callback on chunks of the
+ *        prediction buffer, then boost from the resulting gradients
+ * \param handle handle
+ * \param iter current iteration rounds
+ * \param dtrain training data
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterUpdateOneIterCustom(BoosterHandle handle,
+                                         int iter,
+                                         DMatrixHandle dtrain);
 /*!
  * \brief get evaluation statistics for xgboost
  * \param handle handle
@@ -414,6 +561,20 @@ XGB_DLL int XGBoosterEvalOneIter(BoosterHandle handle,
                                  const char *evnames[],
                                  bst_ulong len,
                                  const char **out_result);
+/*!
+ * \brief get the wall time the training phases of the most recent
+ *  iteration took, as a flat JSON object in seconds: prediction,
+ *  gradient computation, boosting broken down per tree updater, and
+ *  evaluation. Always on and scoped to one iteration, so a training
+ *  orchestrator can watch phase times drift live without profilers;
+ *  see XGBProfileDump for the full hierarchical profile.
+ * \param handle handle
+ * \param out_json the JSON string; valid until the next xgboost API call
+ *  from the same thread
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterIterationTimings(BoosterHandle handle,
+                                      const char **out_json);
 /*!
  * \brief make prediction based on dmat
  * \param handle handle
@@ -436,6 +597,202 @@ XGB_DLL int XGBoosterPredict(BoosterHandle handle,
                              bst_ulong *out_len,
                              const float **out_result);
 
+/*!
+ * \brief margin prediction reusing the margins of the previous call.
+ *  Returns margin (untransformed) predictions at ntree_limit. When the
+ *  previous call on this thread used the same booster and data with a
+ *  smaller or equal tree limit, only the trees in between are evaluated,
+ *  so sweeping ntree_limit upward for early-stopping analysis costs one
+ *  full pass over the ensemble instead of one per limit. Any other
+ *  sequence of calls falls back to a full prediction.
+ * \param handle handle
+ * \param dmat data matrix
+ * \param ntree_limit limit number of trees used for prediction, must be nonzero
+ * \param out_len used to store length of returning result
+ * \param out_result used to set a pointer to array
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterPredictDelta(BoosterHandle handle,
+                                  DMatrixHandle dmat,
+                                  unsigned ntree_limit,
+                                  bst_ulong *out_len,
+                                  const float **out_result);
+
+/*!
+ * \brief predict in place from a dense row-major host buffer, without
+ *  building a DMatrix. Removes the XGDMatrixCreateFromMat / predict /
+ *  free cycle for services scoring transient batches: the rows are read
+ *  directly from caller memory and the only allocation is the output.
+ *  The per-matrix prediction caches are bypassed.
+ * \param handle handle
+ * \param data pointer to num_row * num_col row-major floats
+ * \param num_row number of rows
+ * \param num_col number of columns, must equal the number of features of
+ *    the model
+ * \param missing value marking a missing feature, NaN always counts as
+ *    missing
+ * \param option_mask 0:normal prediction 1:output margin instead of
+ *    transformed value
+ * \param ntree_limit limit number of trees used for prediction,
+ *    when the parameter is set to 0, we will use all the trees
+ * \param out_len used to store length of returning result
+ * \param out_result used to set a pointer to array
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterPredictDense(BoosterHandle handle,
+                                  const float *data,
+                                  bst_ulong num_row,
+                                  bst_ulong num_col,
+                                  float missing,
+                                  int option_mask,
+                                  unsigned ntree_limit,
+                                  bst_ulong *out_len,
+                                  const float **out_result);
+
+/*!
+ * \brief predict from a dense row-major matrix already resident in CUDA
+ *  device memory, leaving the result on the device. No DMatrix is built
+ *  and neither input nor output crosses the PCIe bus, so a GPU feature
+ *  pipeline can feed scoring directly. Missing values must be encoded as
+ *  NaN. The output holds raw margin scores (no objective transformation);
+ *  requires the booster to be configured with predictor=gpu_predictor.
+ * \param handle handle
+ * \param data device pointer to num_row * num_col row-major floats
+ * \param num_row number of rows
+ * \param num_col number of columns, must equal the number of features of
+ *    the model
+ * \param ntree_limit limit number of trees used for prediction,
+ *    when the parameter is set to 0, we will use all the trees
+ * \param out_len used to store length of returning result
+ * \param out_result used to set a device pointer to the margins, owned by
+ *    the booster and valid until the next call on the same handle
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterPredictDeviceDense(BoosterHandle handle,
+                                        const float *data,
+                                        bst_ulong num_row,
+                                        bst_ulong num_col,
+                                        unsigned ntree_limit,
+                                        bst_ulong *out_len,
+                                        const float **out_result);
+
+/*!
+ * \brief predict the leaf index of each tree into a caller provided buffer.
+ *  Equivalent to XGBoosterPredict with option_mask 2, but writes into
+ *  preallocated memory and reuses the internal prediction buffer, so no
+ *  output-sized allocation happens per call once the buffer is warm.
+ * \param handle handle
+ * \param dmat data matrix
+ * \param ntree_limit limit number of trees used for prediction, this is only valid for boosted trees
+ *    when the parameter is set to 0, we will use all the trees
+ * \param len length of out_result, must equal num_row * number of trees used
+ * \param out_result preallocated buffer receiving the leaf indices
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterPredictLeafInto(BoosterHandle handle,
+                                     DMatrixHandle dmat,
+                                     unsigned ntree_limit,
+                                     bst_ulong len,
+                                     float *out_result);
+
+/*!
+ * \brief general prediction into a caller provided buffer. Equivalent to
+ *  XGBoosterPredict with the same option_mask, but writes into
+ *  preallocated memory (for example a shared-memory IPC segment) and
+ *  reuses the internal prediction buffer, so no output-sized allocation
+ *  happens per call once the buffer is warm. The buffer length is checked
+ *  against the actual output size before anything is written.
+ * \param handle handle
+ * \param dmat data matrix
+ * \param option_mask bit-mask of options taken in prediction, see XGBoosterPredict
+ * \param ntree_limit limit number of trees used for prediction, this is only valid for boosted trees
+ *    when the parameter is set to 0, we will use all the trees
+ * \param len length of out_result, must equal the output size of the
+ *    equivalent XGBoosterPredict call
+ * \param out_result preallocated buffer receiving the predictions
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterPredictInto(BoosterHandle handle,
+                                 DMatrixHandle dmat,
+                                 int option_mask,
+                                 unsigned ntree_limit,
+                                 bst_ulong len,
+                                 float *out_result);
+
+/*!
+ * \brief create a reusable prediction context for XGBoosterPredictSingle.
+ *  The context owns the scratch buffers of single instance prediction, so
+ *  steady-state calls allocate nothing. A context must only be used by one
+ *  thread at a time; create one per serving thread for concurrent scoring.
+ * \param handle handle to the booster the context will be used with
+ * \param out the created prediction context
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterPredictContextCreate(BoosterHandle handle,
+                                          PredictContextHandle *out);
+
+/*!
+ * \brief free the prediction context
+ * \param ctx the prediction context
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterPredictContextFree(PredictContextHandle ctx);
+
+/*!
+ * \brief predict a single sparse instance through a prediction context.
+ *  Unlike XGBoosterPredict this performs no per-call allocation and is safe
+ *  to call concurrently from multiple threads as long as each thread uses
+ *  its own context. The result pointer stays valid until the next call with
+ *  the same context.
+ * \param handle handle
+ * \param ctx prediction context created by XGBoosterPredictContextCreate
+ * \param indices feature indices of the instance
+ * \param values feature values of the instance
+ * \param len number of nonzero features
+ * \param option_mask 0:normal prediction 1:output margin instead of transformed value
+ * \param ntree_limit limit number of trees used for prediction, this is only valid for boosted trees
+ *    when the parameter is set to 0, we will use all the trees
+ * \param out_len used to store length of returning result
+ * \param out_result used to set a pointer to array
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterPredictSingle(BoosterHandle handle,
+                                   PredictContextHandle ctx,
+                                   const unsigned *indices,
+                                   const float *values,
+                                   bst_ulong len,
+                                   int option_mask,
+                                   unsigned ntree_limit,
+                                   bst_ulong *out_len,
+                                   const float **out_result);
+
+/*!
+ * \brief thread-safe batch prediction through a prediction context.
+ *  Unlike XGBoosterPredict this reads nothing but the loaded model and
+ *  writes nothing but the context, so N threads holding N contexts can
+ *  score one booster concurrently without external locking; throughput
+ *  scales with the number of callers. The matrix must not be shared
+ *  between concurrent calls and the booster must not be mutated (trained,
+ *  reconfigured, reloaded) while predictions are in flight. The result
+ *  pointer stays valid until the next call with the same context.
+ * \param handle handle
+ * \param ctx prediction context created by XGBoosterPredictContextCreate
+ * \param dmat data matrix
+ * \param option_mask 0:normal prediction 1:output margin instead of transformed value
+ * \param ntree_limit limit number of trees used for prediction, this is only valid for boosted trees
+ *    when the parameter is set to 0, we will use all the trees
+ * \param out_len used to store length of returning result
+ * \param out_result used to set a pointer to array
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterPredictSafe(BoosterHandle handle,
+                                 PredictContextHandle ctx,
+                                 DMatrixHandle dmat,
+                                 int option_mask,
+                                 unsigned ntree_limit,
+                                 bst_ulong *out_len,
+                                 const float **out_result);
+
 /*!
  * \brief load model from existing file
  * \param handle handle
@@ -545,6 +902,34 @@ XGB_DLL int XGBoosterDumpModelExWithFeatures(BoosterHandle handle,
                                              bst_ulong *out_len,
                                              const char ***out_models);
 
+/*!
+ * \brief compute feature importance scores directly from the model,
+ *        avoiding the text dump round trip the bindings used to do
+ * \param handle handle
+ * \param importance_type one of "weight", "gain" or "cover"
+ * \param out_len length of the output arrays
+ * \param out_features feature indices that appear in at least one split
+ * \param out_scores importance score for each entry of out_features
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterFeatureImportance(BoosterHandle handle,
+                                       const char *importance_type,
+                                       bst_ulong *out_len,
+                                       const unsigned **out_features,
+                                       const float **out_scores);
+
+/*!
+ * \brief profile the model on a sample of inference traffic and rewrite
+ *        the tree node layout so frequently taken paths are contiguous in
+ *        memory; an offline pass for frozen models. Leaf indices reported
+ *        by prediction are renumbered.
+ * \param handle handle
+ * \param dmat sample of representative inference traffic
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterOptimizeNodeLayout(BoosterHandle handle,
+                                        DMatrixHandle dmat);
+
 /*!
  * \brief Get string attribute from Booster.
  * \param handle handle
@@ -580,6 +965,36 @@ XGB_DLL int XGBoosterGetAttrNames(BoosterHandle handle,
                                   bst_ulong* out_len,
                                   const char*** out);
 
+/*!
+ * \brief Dump the process-wide hierarchical performance profile as JSON.
+ *  The profiler is enabled by setting XGBOOST_PROFILE=1 in the environment
+ *  before the library is loaded; when disabled an empty profile is
+ *  returned. Scopes nest by training phase with per-scope seconds, call
+ *  counts and processed bytes.
+ * \param out_json the JSON string; valid until the next xgboost API call
+ *  from the same thread
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBProfileDump(const char** out_json);
+
+/*!
+ * \brief Zero all profile counters, e.g. between training iterations, so
+ *  the next XGBProfileDump covers only the work after this call.
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBProfileReset();
+
+/*!
+ * \brief Dump process-wide memory accounting as JSON: current and peak
+ *  bytes per tracked component (in-memory DMatrix storage, histogram
+ *  collections, bulk device buffers). Always on; the tracking uses
+ *  relaxed atomics and is cheap enough for production.
+ * \param out_json the JSON string; valid until the next xgboost API call
+ *  from the same thread
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBMemoryStatsDump(const char** out_json);
+
 // --- Distributed training API----
 // NOTE: functions in rabit/c_api.h will be also available in libxgboost.so
 /*!
@@ -122,6 +122,13 @@ class MetaInfo {
    * \param num Number of elements in the source array.
    */
   void SetInfo(const char* key, const void* dptr, DataType dtype, size_t num);
+  /*!
+   * \brief Append the meta information of another dataset behind this one.
+   *  Optional fields (weights, margins, qids, groups) must be present on
+   *  both sides or on neither; mixing them cannot be reconciled.
+   * \param other The meta information to append.
+   */
+  void Append(const MetaInfo& other);
 
  private:
   /*! \brief argsort of labels */
@@ -201,6 +208,60 @@ class SparsePage {
     offset_vec.clear();
     offset_vec.push_back(0);
     data.HostVector().clear();
+    soa_built_ = false;
+  }
+
+  /*!
+   * \brief index half of the structure-of-arrays mirror of data.
+   *
+   * The mirror splits the interleaved Entry array into separate index and
+   * value arrays, so scans that touch only one half do not drag the other
+   * four bytes per entry through cache. It is built lazily on first access
+   * and kept until the page is cleared or grows, so only consumers that ask
+   * for it pay the extra memory. Like HostVector(), the first access is not
+   * thread safe: touch an accessor once before reading from inside a
+   * parallel region.
+   */
+  inline common::Span<bst_uint const> Indices() const {
+    MaterializeSoA();
+    return {soa_index_.data(),
+            static_cast<typename common::Span<bst_uint const>::index_type>(
+                soa_index_.size())};
+  }
+  /*! \brief value half of the structure-of-arrays mirror; see Indices() */
+  inline common::Span<bst_float const> Values() const {
+    MaterializeSoA();
+    return {soa_value_.data(),
+            static_cast<typename common::Span<bst_float const>::index_type>(
+                soa_value_.size())};
+  }
+  /*! \brief indices of the i-th instance in the mirror; see Indices() */
+  inline common::Span<bst_uint const> RowIndices(size_t i) const {
+    MaterializeSoA();
+    const auto& offset_vec = offset.HostVector();
+    size_t size;
+    // see operator[]
+    if (rabit::IsDistributed() && i + 1 >= offset_vec.size()) {
+      size = 0;
+    } else {
+      size = offset_vec[i + 1] - offset_vec[i];
+    }
+    return {soa_index_.data() + offset_vec[i],
+            static_cast<typename common::Span<bst_uint const>::index_type>(size)};
+  }
+  /*! \brief values of the i-th instance in the mirror; see Indices() */
+  inline common::Span<bst_float const> RowValues(size_t i) const {
+    MaterializeSoA();
+    const auto& offset_vec = offset.HostVector();
+    size_t size;
+    // see operator[]
+    if (rabit::IsDistributed() && i + 1 >= offset_vec.size()) {
+      size = 0;
+    } else {
+      size = offset_vec[i + 1] - offset_vec[i];
+    }
+    return {soa_value_.data() + offset_vec[i],
+            static_cast<typename common::Span<bst_float const>::index_type>(size)};
   }
 
   SparsePage GetTranspose(int num_columns) const {
@@ -234,14 +295,18 @@ class SparsePage {
   }
 
   void SortRows() {
+    const auto& offset_vec = offset.HostVector();
+    auto& data_vec = data.HostVector();
     auto ncol = static_cast<bst_omp_uint>(this->Size());
 #pragma omp parallel for schedule(dynamic, 1)
     for (bst_omp_uint i = 0; i < ncol; ++i) {
-      if (this->offset.HostVector()[i] < this->offset.HostVector()[i + 1]) {
-        std::sort(
-            this->data.HostVector().begin() + this->offset.HostVector()[i],
-            this->data.HostVector().begin() + this->offset.HostVector()[i + 1],
-            Entry::CmpValue);
+      if (offset_vec[i] < offset_vec[i + 1] &&
+          !std::is_sorted(data_vec.begin() + offset_vec[i],
+                          data_vec.begin() + offset_vec[i + 1],
+                          Entry::CmpValue)) {
+        std::sort(data_vec.begin() + offset_vec[i],
+                  data_vec.begin() + offset_vec[i + 1],
+                  Entry::CmpValue);
       }
     }
   }
@@ -303,6 +368,27 @@ class SparsePage {
   }
 
   size_t Size() { return offset.Size() - 1; }
+
+ private:
+  /*! \brief build the structure-of-arrays mirror if it is out of date */
+  inline void MaterializeSoA() const {
+    const auto& data_vec = data.HostVector();
+    if (soa_built_ && soa_index_.size() == data_vec.size()) return;
+    soa_index_.resize(data_vec.size());
+    soa_value_.resize(data_vec.size());
+    const auto ndata = static_cast<bst_omp_uint>(data_vec.size());
+#pragma omp parallel for schedule(static)
+    for (bst_omp_uint i = 0; i < ndata; ++i) {
+      soa_index_[i] = data_vec[i].index;
+      soa_value_[i] = data_vec[i].fvalue;
+    }
+    soa_built_ = true;
+  }
+
+  // structure-of-arrays mirror of data, materialized on demand
+  mutable std::vector<bst_uint> soa_index_;
+  mutable std::vector<bst_float> soa_value_;
+  mutable bool soa_built_{false};
 };
 
 class BatchIteratorImpl {
@@ -412,6 +498,38 @@ class RowSet {
   std::vector<bst_uint> rows_;
 };
 
+/*!
+ * \brief Summary statistics of a dataset, computed in a single parallel
+ *  pass over the row batches and cached on the DMatrix, so updaters can
+ *  base strategy choices (forward/backward search, dense code paths) on
+ *  precomputed numbers instead of rescanning columns.
+ */
+struct DatasetStats {
+  /*! \brief number of rows in the dataset */
+  size_t num_row{0};
+  /*! \brief number of present entries in each column */
+  std::vector<size_t> column_nnz;
+  /*! \brief minimum present value in each column */
+  std::vector<bst_float> column_min;
+  /*! \brief maximum present value in each column */
+  std::vector<bst_float> column_max;
+  /*!
+   * \brief histogram of row lengths in power of two buckets: bucket 0
+   *  counts empty rows, bucket b the rows with 2^(b-1) <= length < 2^b
+   */
+  std::vector<size_t> row_length_hist;
+
+  /*! \brief fraction of rows with a present entry in the column */
+  inline float Density(size_t cidx) const {
+    if (num_row == 0) return 0.0f;
+    return static_cast<float>(column_nnz[cidx]) / num_row;
+  }
+  /*! \brief number of rows with no entry in the column */
+  inline size_t MissingCount(size_t cidx) const {
+    return num_row - column_nnz[cidx];
+  }
+};
+
 /*!
  * \brief Internal data structured used by XGBoost during training.
  *  There are two ways to create a customized DMatrix that reads in user defined-format.
@@ -436,11 +554,51 @@ class DMatrix {
   virtual BatchSet GetRowBatches() = 0;
   virtual BatchSet GetSortedColumnBatches() = 0;
   virtual BatchSet GetColumnBatches() = 0;
+  /*!
+   * \brief Request page-level row subsampling for subsequent row batch
+   *  iterations. External-memory implementations honor it by skipping
+   *  whole pages on disk with the given keep probability, cutting cache
+   *  I/O roughly in proportion; a fresh page sample is drawn for every
+   *  iteration over the row batches. Kept pages carry their original
+   *  base row ids, so rows stay aligned with labels and gradients.
+   *  In-memory implementations ignore the request.
+   * \param keep_prob probability of keeping each page; 1 disables sampling.
+   * \param seed seed of the sampling sequence.
+   */
+  virtual void SetPageSubsample(float keep_prob, uint64_t seed) {}
+  /*!
+   * \brief If this matrix is a row view over another matrix, return the
+   *  parent matrix and the view's row index list, so consumers (e.g. the
+   *  hist updater) can derive per-view structures by gathering from the
+   *  parent's instead of recomputing them from raw feature values.
+   * \param out_ridx receives a pointer to the view's row index list, in
+   *  view row order; untouched for materialized matrices
+   * \return the parent matrix, or nullptr for materialized matrices
+   */
+  virtual DMatrix* ViewParent(const std::vector<bst_uint>** out_ridx) {
+    return nullptr;
+  }
+  /*!
+   * \brief Append the rows of another matrix behind this one, extending
+   *  the meta information along with the data. Derived structures
+   *  (column pages, dataset statistics, quantized indices) are refreshed
+   *  lazily on their next use. Only in-memory implementations support
+   *  appending; the source matrix is left untouched.
+   * \param other matrix whose rows are appended; must have the same
+   *  number of columns and the same optional meta fields set.
+   */
+  virtual void AppendRows(DMatrix* other);
   // the following are column meta data, should be able to answer them fast.
   /*! \return Whether the data columns single column block. */
   virtual bool SingleColBlock() const = 0;
   /*! \brief get column density */
   virtual float GetColDensity(size_t cidx) = 0;
+  /*!
+   * \brief Dataset statistics, computed on the first call in one parallel
+   *  pass over the row batches and cached afterwards. The first call must
+   *  not come from inside a parallel region.
+   */
+  const DatasetStats& Stats();
   /*! \brief virtual destructor */
   virtual ~DMatrix() = default;
   /*!
@@ -487,6 +645,14 @@ class DMatrix {
    */
   static DMatrix* Create(dmlc::Parser<uint32_t>* parser,
                          const std::string& cache_prefix = "");
+
+ protected:
+  /*! \brief drop the cached dataset statistics after the data changed */
+  void ResetStats() { stats_.reset(); }
+
+ private:
+  // lazily computed by Stats()
+  std::unique_ptr<DatasetStats> stats_;
 };
 
 // implementation of inline functions
@@ -9,6 +9,7 @@
 #define XGBOOST_GBM_H_
 
 #include <dmlc/registry.h>
+#include <map>
 #include <vector>
 #include <utility>
 #include <string>
@@ -21,6 +22,9 @@
 #include "../../src/common/host_device_vector.h"
 
 namespace xgboost {
+// forward declaration; defined in predictor.h
+struct PredictionContext;
+
 /*!
  * \brief interface of gradient boosting model.
  */
@@ -53,6 +57,38 @@ class GradientBooster {
    * \param fo output stream
    */
   virtual void Save(dmlc::Stream* fo) const = 0;
+  /*!
+   * \brief number of boosting units committed to the model, the base
+   *  marker of an incremental checkpoint. Returns 0 when the booster
+   *  cannot serialize deltas and callers must take full snapshots.
+   */
+  virtual size_t NumBoostedUnits() const {
+    return 0;
+  }
+  /*!
+   * \brief save only the units committed at or after unit_begin,
+   *  to be appended to an earlier full save through LoadDelta
+   * \param fo output stream
+   * \param unit_begin index of the first unit to save
+   */
+  virtual void SaveDelta(dmlc::Stream* fo, size_t unit_begin) const;
+  /*!
+   * \brief append the units written by SaveDelta
+   * \param fi input stream
+   */
+  virtual void LoadDelta(dmlc::Stream* fi);
+  /*!
+   * \brief turn out into a booster over the units [unit_begin, unit_end)
+   *  of this model. The underlying model storage is shared, not copied,
+   *  so slicing is cheap regardless of the model size; out must have been
+   *  created with the same booster type as this model.
+   * \param unit_begin index of the first unit to share
+   * \param unit_end one past the last unit to share; 0 means all units,
+   *  which makes out a full clone of this model
+   * \param out booster receiving the view
+   */
+  virtual void Slice(size_t unit_begin, size_t unit_end,
+                     GradientBooster* out) const;
   /*!
    * \brief whether the model allow lazy checkpoint
    * return true if model is only updated in DoBoost
@@ -71,6 +107,13 @@ class GradientBooster {
   virtual void DoBoost(DMatrix* p_fmat,
                        HostDeviceVector<GradientPair>* in_gpair,
                        ObjFunction* obj = nullptr) = 0;
+  /*!
+   * \brief report the wall time the last DoBoost spent in each internal
+   *  phase, e.g. per tree updater, keyed by phase name in seconds.
+   *  Boosters without an internal breakdown report nothing.
+   * \param timings output map the phases are added to
+   */
+  virtual void CollectIterationTimings(std::map<std::string, double>* timings) const {}
 
   /*!
    * \brief generate predictions for given feature matrix
@@ -82,6 +125,86 @@ class GradientBooster {
   virtual void PredictBatch(DMatrix* dmat,
                             HostDeviceVector<bst_float>* out_preds,
                             unsigned ntree_limit = 0) = 0;
+  /*!
+   * \brief extend margin predictions from one tree limit to another, for
+   *  incremental ntree_limit sweeps. io_preds must hold the margins
+   *  produced at old_ntree_limit; on return it holds the margins at
+   *  ntree_limit, having evaluated only the trees in between. The default
+   *  implementation recomputes from scratch, which boosters without a
+   *  meaningful tree range (or with per-tree weights) keep.
+   * \param dmat feature matrix
+   * \param io_preds margins at old_ntree_limit, replaced by margins at ntree_limit
+   * \param old_ntree_limit the tree limit io_preds was produced with
+   * \param ntree_limit the requested tree limit, 0 means use all the trees
+   */
+  virtual void PredictMarginRange(DMatrix* dmat,
+                                  HostDeviceVector<bst_float>* io_preds,
+                                  unsigned old_ntree_limit,
+                                  unsigned ntree_limit = 0);
+  /*!
+   * \brief seed the prediction cache of a registered matrix with margins
+   *  computed earlier, so the next full prediction pass over it is a cache
+   *  hit. The default implementation rejects the margins; boosters with a
+   *  prediction cache override it.
+   * \param dmat the matrix to seed, must be registered in the prediction cache
+   * \param margin full margins of the current model over dmat
+   * \return whether the margins were accepted
+   */
+  virtual bool SetCachedPredictionMargin(DMatrix* dmat,
+                                         const std::vector<bst_float>& margin) {
+    return false;
+  }
+  /*!
+   * \brief read back the cached prediction margins of a matrix, the
+   *  counterpart of SetCachedPredictionMargin.
+   * \param dmat the matrix to look up
+   * \param out_margin output vector receiving the cached margins
+   * \return whether cached margins were available
+   */
+  virtual bool GetCachedPredictionMargin(
+      DMatrix* dmat, std::vector<bst_float>* out_margin) const {
+    return false;
+  }
+  /*!
+   * \brief predict from a dense row-major matrix resident in device memory,
+   *  leaving the raw margins on the device. Missing values are encoded as
+   *  NaN. The default implementation aborts; only gbtree with a
+   *  device-capable predictor supports it.
+   * \param d_data device pointer to num_row * num_col row-major floats
+   * \param num_row number of rows
+   * \param num_col number of columns, must equal the number of features
+   * \param ntree_limit limit the number of trees used in prediction, 0 means
+   *  use all the trees
+   * \param out_d_preds output device pointer to the margins, owned by the
+   *  booster and valid until the next call
+   * \param out_len output length of the prediction buffer
+   */
+  virtual void PredictDeviceDense(const float* d_data, size_t num_row,
+                                  size_t num_col, unsigned ntree_limit,
+                                  const float** out_d_preds, size_t* out_len) {
+    LOG(FATAL) << "predict from device memory is not supported by the current "
+                  "booster or predictor";
+  }
+  /*!
+   * \brief predict in place from a dense row-major host buffer, without
+   *  building a DMatrix. The output holds raw margins and the prediction
+   *  caches are bypassed. The default implementation aborts; gbtree
+   *  supports it.
+   * \param data pointer to num_row * num_col row-major floats
+   * \param num_row number of rows
+   * \param num_col number of columns, must equal the number of features
+   * \param missing value marking a missing feature, NaN always counts as
+   *  missing
+   * \param ntree_limit limit the number of trees used in prediction, 0
+   *  means use all the trees
+   * \param out_preds output vector of num_row * num_output_group margins
+   */
+  virtual void PredictDense(const float* data, size_t num_row, size_t num_col,
+                            float missing, unsigned ntree_limit,
+                            std::vector<bst_float>* out_preds) {
+    LOG(FATAL) << "in-place dense prediction is not supported by the current "
+                  "booster";
+  }
   /*!
    * \brief online prediction function, predict score for one instance at a time
    *  NOTE: use the batch prediction interface if possible, batch prediction is usually
@@ -98,6 +221,31 @@ class GradientBooster {
                        std::vector<bst_float>* out_preds,
                        unsigned ntree_limit = 0,
                        unsigned root_index = 0) = 0;
+  /*!
+   * \brief online prediction into a caller owned context, see
+   *  Predictor::PredictInstance. Safe to call concurrently as long as each
+   *  thread uses its own context; the default implementation forwards to the
+   *  vector overload and keeps its thread safety caveats.
+   * \param inst the instance you want to predict
+   * \param ctx reusable prediction context holding the output buffer
+   * \param ntree_limit limit the number of trees used in prediction
+   */
+  virtual void PredictInstance(const SparsePage::Inst& inst,
+                       PredictionContext* ctx,
+                       unsigned ntree_limit = 0);
+  /*!
+   * \brief batch prediction into a caller owned context, see
+   *  Predictor::PredictBatchSafe. Touches only the immutable model and the
+   *  context, so concurrent calls are safe as long as each thread uses its
+   *  own context and its own matrix. The default implementation aborts;
+   *  boosters override it where a safe traversal exists.
+   * \param dmat feature matrix, must not be shared between concurrent calls
+   * \param ctx reusable prediction context holding the output buffer
+   * \param ntree_limit limit the number of trees used in prediction
+   */
+  virtual void PredictBatchSafe(DMatrix* dmat,
+                       PredictionContext* ctx,
+                       unsigned ntree_limit = 0);
   /*!
    * \brief predict the leaf index of each tree, the output will be nsample * ntree vector
    *        this is only valid in gbtree predictor
@@ -140,6 +288,28 @@ class GradientBooster {
   virtual std::vector<std::string> DumpModel(const FeatureMap& fmap,
                                              bool with_stats,
                                              std::string format) const = 0;
+  /*!
+   * \brief compute per-feature importance scores from the model structure,
+   *  without going through a text dump
+   * \param importance_type one of "weight", "gain" or "cover"
+   * \param out_features feature indices that appear in at least one split
+   * \param out_scores importance score for each entry of out_features
+   */
+  virtual void FeatureImportance(const std::string& importance_type,
+                                 std::vector<bst_uint>* out_features,
+                                 std::vector<bst_float>* out_scores) const {
+    LOG(FATAL) << "feature importance is not defined for the current booster";
+  }
+  /*!
+   * \brief profile the model on a sample and rewrite the node layout of
+   *  each tree so frequently taken paths are contiguous in memory. Intended
+   *  as an offline pass on frozen models; leaf indices reported by
+   *  prediction are renumbered.
+   * \param p_fmat sample of representative inference traffic
+   */
+  virtual void OptimizeNodeLayout(DMatrix* p_fmat) {
+    LOG(FATAL) << "node layout optimization is not defined for the current booster";
+  }
   /*!
    * \brief create a gradient booster from given name
    * \param name name of gradient booster
@@ -96,6 +96,23 @@ class Learner : public rabit::Serializable {
   virtual std::string EvalOneIter(int iter,
                                   const std::vector<DMatrix*>& data_sets,
                                   const std::vector<std::string>& data_names) = 0;
+  /*!
+   * \brief collect the pending result of an asynchronous evaluation, see
+   *  the eval_async training parameter. Blocks until the background
+   *  worker finishes, so the last round's metrics can be reported after
+   *  the training loop.
+   * \return the pending evaluation result; empty when nothing is pending
+   */
+  virtual std::string FlushEvalOneIter();
+  /*!
+   * \brief Wall time of the training phases of the most recent iteration
+   *  as a flat JSON object: gradient computation, prediction, boosting
+   *  broken down per tree updater, and evaluation. Unlike the monitor
+   *  logs these are machine readable and reset every iteration, so an
+   *  orchestrator can watch phase times drift while training runs.
+   * \return JSON string; empty object before the first iteration
+   */
+  virtual std::string IterationTimingsJson() const = 0;
   /*!
    * \brief get prediction given the model.
    * \param data input data
@@ -147,6 +164,35 @@ class Learner : public rabit::Serializable {
    * \return whether the model allow lazy checkpoint in rabit.
    */
   bool AllowLazyCheckPoint() const;
+  /*!
+   * \brief number of boosting units committed to the model, the base
+   *  marker of an incremental checkpoint; 0 when the booster does not
+   *  support delta serialization
+   */
+  size_t NumBoostedUnits() const;
+  /*!
+   * \brief save only the model units committed at or after unit_begin,
+   *  to be appended to an earlier full save through LoadDelta
+   * \param fo output stream
+   * \param unit_begin index of the first unit to save
+   */
+  void SaveDelta(dmlc::Stream* fo, size_t unit_begin) const;
+  /*!
+   * \brief append the model units written by SaveDelta
+   * \param fi input stream
+   */
+  void LoadDelta(dmlc::Stream* fi);
+  /*!
+   * \brief create a learner over the model units [unit_begin, unit_end)
+   *  of this learner. The model storage is shared, not copied, so
+   *  slicing or cloning a large ensemble costs one pointer per tree; the
+   *  returned learner predicts and trains independently of this one.
+   * \param unit_begin index of the first unit to share
+   * \param unit_end one past the last unit to share; 0 means all units,
+   *  which makes the result a full clone
+   * \return the sliced learner; the caller takes ownership
+   */
+  virtual Learner* Slice(size_t unit_begin, size_t unit_end) const = 0;
   /*!
    * \brief dump the model in the requested format
    * \param fmap feature map that may help give interpretations of feature
@@ -157,6 +203,24 @@ class Learner : public rabit::Serializable {
   std::vector<std::string> DumpModel(const FeatureMap& fmap,
                                      bool with_stats,
                                      std::string format) const;
+  /*!
+   * \brief compute per-feature importance scores directly from the model
+   *  structure, without parsing a text dump
+   * \param importance_type one of "weight", "gain" or "cover"
+   * \param out_features feature indices that appear in at least one split
+   * \param out_scores importance score for each entry of out_features
+   */
+  void FeatureImportance(const std::string& importance_type,
+                         std::vector<bst_uint>* out_features,
+                         std::vector<bst_float>* out_scores) const;
+  /*!
+   * \brief profile the model on a sample of inference traffic and rewrite
+   *  the tree node layout so frequently taken paths are contiguous in
+   *  memory; an offline pass for frozen models. Leaf indices reported by
+   *  prediction are renumbered.
+   * \param p_fmat sample of representative inference traffic
+   */
+  void OptimizeNodeLayout(DMatrix* p_fmat);
   /*!
    * \brief online prediction function, predict score for one instance at a time
    *  NOTE: use the batch prediction interface if possible, batch prediction is usually
@@ -172,6 +236,115 @@ class Learner : public rabit::Serializable {
                       bool output_margin,
                       HostDeviceVector<bst_float> *out_preds,
                       unsigned ntree_limit = 0) const;
+  /*!
+   * \brief low latency single instance prediction into a caller owned
+   *  context, see Predictor::PredictInstance. Unlike the overload above this
+   *  is safe to call concurrently as long as each thread uses its own
+   *  context, and performs no allocation once the context is warm.
+   *
+   * \param inst the instance you want to predict
+   * \param output_margin whether to only predict margin value instead of transformed prediction
+   * \param ctx reusable prediction context holding the output buffer
+   * \param ntree_limit limit the number of trees used in prediction
+   */
+  void Predict(const SparsePage::Inst& inst,
+               bool output_margin,
+               PredictionContext* ctx,
+               unsigned ntree_limit = 0) const;
+  /*!
+   * \brief thread-safe batch prediction into a caller owned context, see
+   *  GradientBooster::PredictBatchSafe. Reads only the immutable model, so
+   *  any number of threads may score one loaded learner concurrently as
+   *  long as each uses its own context and its own matrix. The prediction
+   *  caches are bypassed.
+   *
+   * \param data input data, must not be shared between concurrent calls
+   * \param output_margin whether to only predict margin value instead of transformed prediction
+   * \param ctx reusable prediction context holding the output buffer
+   * \param ntree_limit limit the number of trees used in prediction
+   */
+  void PredictSafe(DMatrix* data,
+                   bool output_margin,
+                   PredictionContext* ctx,
+                   unsigned ntree_limit = 0) const;
+  /*!
+   * \brief extend margin predictions from one tree limit to another by
+   *  evaluating only the trees in between, see
+   *  GradientBooster::PredictMarginRange. Used for incremental ntree_limit
+   *  sweeps during early-stopping analysis.
+   * \param data input data
+   * \param io_preds margins at old_ntree_limit, replaced by margins at ntree_limit
+   * \param old_ntree_limit the tree limit io_preds was produced with
+   * \param ntree_limit the requested tree limit, 0 means use all the trees
+   */
+  void PredictMarginRange(DMatrix* data,
+                          HostDeviceVector<bst_float>* io_preds,
+                          unsigned old_ntree_limit,
+                          unsigned ntree_limit = 0) const;
+  /*!
+   * \brief seed the prediction cache of a matrix with margins computed
+   *  earlier, e.g. persisted at the end of a previous training session.
+   *  The next full prediction pass over the matrix (notably the one at the
+   *  start of training continuation) becomes a cache hit instead of a walk
+   *  over every tree of the loaded model.
+   * \param data the matrix to seed; must be registered in the prediction
+   *  cache, i.e. passed to Learner::Create
+   * \param margin full untransformed margins of the current model over
+   *  data, of length num_row * num_output_group
+   * \return whether the booster supports cache seeding and accepted the
+   *  margins
+   */
+  bool SetCachedPredictionMargin(DMatrix* data,
+                                 const std::vector<bst_float>& margin);
+  /*!
+   * \brief read back the cached prediction margins of a matrix, the
+   *  counterpart of SetCachedPredictionMargin: fetched after the last
+   *  training iteration the margins are already up to date and cost no
+   *  prediction pass.
+   * \param data the matrix to look up
+   * \param out_margin output vector receiving the cached margins
+   * \return whether cached margins were available for data
+   */
+  bool GetCachedPredictionMargin(DMatrix* data,
+                                 std::vector<bst_float>* out_margin) const;
+  /*!
+   * \brief predict from a dense row-major matrix resident in device memory,
+   *  leaving the result on the device, see
+   *  GradientBooster::PredictDeviceDense. The output holds raw margin
+   *  scores; no objective transformation is applied. Requires a booster
+   *  configured with a device-capable predictor.
+   * \param d_data device pointer to num_row * num_col row-major floats,
+   *  with missing values encoded as NaN
+   * \param num_row number of rows
+   * \param num_col number of columns, must equal the number of features
+   * \param ntree_limit limit the number of trees used in prediction, 0
+   *  means use all the trees
+   * \param out_d_preds output device pointer to num_row * num_output_group
+   *  margins, owned by the booster and valid until the next call
+   * \param out_len output length of the prediction buffer
+   */
+  void PredictDeviceDense(const float* d_data, size_t num_row, size_t num_col,
+                          unsigned ntree_limit, const float** out_d_preds,
+                          size_t* out_len);
+  /*!
+   * \brief predict in place from a dense row-major host buffer, without
+   *  building a DMatrix, see GradientBooster::PredictDense. Bypasses the
+   *  prediction caches.
+   * \param data pointer to num_row * num_col row-major floats
+   * \param num_row number of rows
+   * \param num_col number of columns, must equal the number of features
+   * \param missing value marking a missing feature, NaN always counts as
+   *  missing
+   * \param output_margin whether to only predict margin value instead of
+   *  transformed prediction
+   * \param out_preds output vector receiving the predictions
+   * \param ntree_limit limit the number of trees used in prediction, 0
+   *  means use all the trees
+   */
+  void PredictDense(const float* data, size_t num_row, size_t num_col,
+                    float missing, bool output_margin,
+                    HostDeviceVector<bst_float>* out_preds,
+                    unsigned ntree_limit = 0) const;
   /*!
    * \brief Create a new instance of learner.
    * \param cache_data The matrix to cache the prediction.
@@ -207,6 +380,18 @@ inline void Learner::Predict(const SparsePage::Inst& inst,
   }
 }
 
+inline void Learner::PredictDense(const float* data, size_t num_row,
+                                  size_t num_col, float missing,
+                                  bool output_margin,
+                                  HostDeviceVector<bst_float>* out_preds,
+                                  unsigned ntree_limit) const {
+  gbm_->PredictDense(data, num_row, num_col, missing,
+                     ntree_limit, &out_preds->HostVector());
+  if (!output_margin) {
+    obj_->PredTransform(out_preds);
+  }
+}
+
 // implementing configure.
 template<typename PairIter>
 inline void Learner::Configure(PairIter begin, PairIter end) {
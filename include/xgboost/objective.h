@@ -75,6 +75,37 @@ class ObjFunction {
   virtual bst_float ProbToMargin(bst_float base_score) const {
     return base_score;
   }
+  /*!
+   * \brief Get an evaluation metric value computed as part of the last
+   *  GetGradient call, for objectives that support fusing the two passes.
+   *  The value corresponds to the predictions the gradients were computed
+   *  from, i.e. to the model before the boosting round of that iteration.
+   * \param info information of the data the metric is requested for
+   * \param metric name of the requested metric
+   * \param value output metric value
+   * \return whether a fused metric value is available
+   */
+  virtual bool GetFusedMetric(const MetaInfo& info, const std::string& metric,
+                              bst_float* value) const {
+    return false;
+  }
+  /*!
+   * \brief whether GetGradient writes gradients class-major: all rows of
+   *  output group 0 first, then group 1, and so on. The default is the
+   *  row-major interleaving gpair[row * ngroup + group]. Boosters that
+   *  train one tree per group can then slice a contiguous block per
+   *  group instead of gathering strided elements.
+   */
+  virtual bool ClassMajorGradient() const {
+    return false;
+  }
+  /*!
+   * \brief hint that the booster consuming the gradients prefers the
+   *  class-major layout. Objectives that support it switch their
+   *  GetGradient output and report so through ClassMajorGradient();
+   *  others ignore the hint and stay row-major.
+   */
+  virtual void SetClassMajorGradient(bool enable) {}
   /*!
    * \brief Create an objective function according to name.
    * \param name Name of the objective.
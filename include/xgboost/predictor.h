@@ -8,8 +8,11 @@
 #include <xgboost/base.h>
 #include <xgboost/data.h>
 #include <functional>
+#include <list>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 #include "../../src/gbm/gbtree_model.h"
@@ -22,6 +25,69 @@ class TreeUpdater;
 
 namespace xgboost {
 
+/**
+ * \struct PredictionContext
+ *
+ * \brief Reusable state for low latency single instance prediction. Create
+ * one per serving thread and pass it to the context overloads of
+ * PredictInstance: the dense feature vector and the output buffer are
+ * allocated on first use and reused afterwards, so steady-state calls are
+ * allocation free. Because all mutable state lives in the context, concurrent
+ * calls with distinct contexts are safe.
+ */
+struct PredictionContext {
+  /*! \brief dense feature vector scratch, lazily sized to num_feature */
+  RegTree::FVec feats;
+  /*! \brief output margin buffer */
+  HostDeviceVector<bst_float> preds;
+};
+
+/**
+ * \class GlobalPredictionCache
+ *
+ * \brief Process-level prediction cache shared across learners. The
+ * per-predictor cache below is keyed by DMatrix pointer within one learner
+ * and never evicts, which both misses sharing between boosters scoring the
+ * same matrix and accumulates entries for short-lived evaluation matrices.
+ * This cache is the complement: one LRU structure with an explicit byte
+ * cap, keyed by the content of (model state, matrix, tree range), so
+ * repeated evaluation passes skip redundant prediction and stale entries
+ * age out instead of leaking.
+ */
+class GlobalPredictionCache {
+ public:
+  /*! \brief the process-wide cache instance */
+  static GlobalPredictionCache* Get();
+  /*!
+   * \brief set the capacity in bytes; shrinking evicts immediately and a
+   *  capacity of zero empties the cache
+   */
+  void SetCapacityBytes(size_t bytes);
+  /*!
+   * \brief look up cached predictions, copying them into out_preds on a hit
+   * \return whether a cached result was found
+   */
+  bool Lookup(const gbm::GBTreeModel& model, DMatrix* dmat,
+              unsigned ntree_limit, std::vector<bst_float>* out_preds);
+  /*! \brief store computed predictions, evicting least recently used
+   *  entries beyond the capacity */
+  void Store(const gbm::GBTreeModel& model, DMatrix* dmat,
+             unsigned ntree_limit, const std::vector<bst_float>& preds);
+
+ private:
+  struct Entry {
+    uint64_t key;
+    std::vector<bst_float> preds;
+  };
+
+  std::mutex mutex_;
+  size_t capacity_bytes_{256UL << 20};
+  size_t size_bytes_{0};
+  // most recently used entries at the front
+  std::list<Entry> lru_;
+  std::unordered_map<uint64_t, std::list<Entry>::iterator> index_;
+};
+
 /**
  * \class Predictor
  *
@@ -51,6 +117,39 @@ class Predictor {
   virtual void Init(const std::vector<std::pair<std::string, std::string>>& cfg,
                     const std::vector<std::shared_ptr<DMatrix>>& cache);
 
+  /**
+   * \brief Seed the per-matrix cache with externally supplied margins, so
+   * the next full PredictBatch over the matrix is a cache hit. Used for
+   * training continuation, where the margins of the loaded model were
+   * persisted by the previous session.
+   *
+   * \param dmat   The matrix to seed; must be registered in the cache.
+   * \param margin Full margins of the current model over dmat.
+   * \return Whether dmat was registered and the margins were stored.
+   */
+  bool SeedPredictionCache(DMatrix* dmat,
+                           const std::vector<bst_float>& margin);
+
+  /**
+   * \brief Read back the cached predictions of a matrix, the counterpart
+   * of SeedPredictionCache.
+   *
+   * \param dmat       The matrix to look up.
+   * \param out_margin Output vector receiving the cached margins.
+   * \return Whether a non-empty cache entry existed for dmat.
+   */
+  bool LookupPredictionCache(DMatrix* dmat,
+                             std::vector<bst_float>* out_margin) const;
+
+  /**
+   * \brief Whether a matrix is registered in this predictor's prediction
+   * cache, i.e. was passed to Init.
+   *
+   * \param dmat The matrix to look up.
+   * \return Whether dmat is registered.
+   */
+  bool PredictionCached(DMatrix* dmat) const;
+
   /**
    * \brief Generate batch predictions for a given feature matrix. May use
    * cached predictions if available instead of calculating from scratch.
@@ -58,7 +157,9 @@ class Predictor {
    * \param [in,out]  dmat        Feature matrix.
    * \param [in,out]  out_preds   The output preds.
    * \param           model       The model to predict from.
-   * \param           tree_begin  The tree begin index.
+   * \param           tree_begin  The tree begin index. When nonzero,
+   * out_preds must already hold the accumulated margins of the trees before
+   * it, and the prediction caches are bypassed (delta prediction).
    * \param           ntree_limit (Optional) The ntree limit. 0 means do not
    * limit trees.
    */
@@ -67,6 +168,51 @@ class Predictor {
                             const gbm::GBTreeModel& model, int tree_begin,
                             unsigned ntree_limit = 0) = 0;
 
+  /**
+   * \brief Predict from a dense row-major matrix already resident in device
+   * memory, leaving the result on the device. No DMatrix is built and the
+   * input is never copied to the host, so a GPU feature pipeline can score
+   * batches without any PCIe round trip. Missing values must be encoded as
+   * NaN. The output holds raw margin scores (base_margin included, no
+   * objective transformation). The default implementation aborts; only
+   * device-capable predictors override it.
+   *
+   * \param d_data      Device pointer to num_row * num_col row-major floats.
+   * \param num_row     Number of rows.
+   * \param num_col     Number of columns; must match the model's features.
+   * \param model       The model to predict from.
+   * \param ntree_limit The ntree limit. 0 means do not limit trees.
+   * \param out_d_preds Output device pointer to num_row * num_output_group
+   * margins, owned by the predictor and valid until the next call.
+   * \param out_len     Output length of the prediction buffer.
+   */
+  virtual void PredictDeviceDense(const float* d_data, size_t num_row,
+                                  size_t num_col, const gbm::GBTreeModel& model,
+                                  unsigned ntree_limit,
+                                  const float** out_d_preds, size_t* out_len);
+
+  /**
+   * \brief Predict in place from a caller owned dense row-major host
+   * buffer. No DMatrix, SparsePage or MetaInfo is built: the rows are
+   * viewed through a lightweight adapter and the only allocation is the
+   * output (plus per-thread scratch on first use). The output holds raw
+   * margin scores. The per-matrix prediction caches are bypassed, since
+   * there is no matrix to key them on.
+   *
+   * \param data        Pointer to num_row * num_col row-major floats.
+   * \param num_row     Number of rows.
+   * \param num_col     Number of columns; must match the model's features.
+   * \param missing     Value marking a missing feature; NaN always counts
+   * as missing.
+   * \param model       The model to predict from.
+   * \param ntree_limit The ntree limit. 0 means do not limit trees.
+   * \param out_preds   Output vector of num_row * num_output_group margins.
+   */
+  virtual void PredictDense(const float* data, size_t num_row, size_t num_col,
+                            float missing, const gbm::GBTreeModel& model,
+                            unsigned ntree_limit,
+                            std::vector<bst_float>* out_preds);
+
   /**
    * \fn  virtual void Predictor::UpdatePredictionCache( const gbm::GBTreeModel
    * &model, std::vector<std::unique_ptr<TreeUpdater> >* updaters, int
@@ -110,6 +256,45 @@ class Predictor {
                                unsigned ntree_limit = 0,
                                unsigned root_index = 0) = 0;
 
+  /**
+   * \brief online prediction into a caller owned context, the low latency
+   * variant of PredictInstance. Unlike the plain overload this does not touch
+   * any predictor internal scratch, so it is safe to call concurrently as
+   * long as each thread uses its own context, and after the first call it
+   * performs no allocation. The default implementation forwards to the plain
+   * overload; backends override it to skip per-call setup.
+   *
+   * \param           inst        The instance to predict.
+   * \param [in,out]  ctx         Reusable prediction context.
+   * \param           model       The model to predict from.
+   * \param           ntree_limit (Optional) The ntree limit.
+   */
+
+  virtual void PredictInstance(const SparsePage::Inst& inst,
+                               PredictionContext* ctx,
+                               const gbm::GBTreeModel& model,
+                               unsigned ntree_limit = 0);
+
+  /**
+   * \brief batch prediction into a caller owned context. Unlike PredictBatch
+   * this reads nothing but the immutable model and writes nothing but the
+   * context: no predictor scratch, no per-matrix cache, no global cache. It
+   * is therefore safe to call concurrently as long as each thread uses its
+   * own context and its own matrix; the matrix must not be shared because
+   * iterating row batches advances its internal iterator. The traversal is
+   * serial within one call, throughput scaling comes from the callers.
+   *
+   * \param [in,out]  dmat        The input feature matrix.
+   * \param [in,out]  ctx         Reusable prediction context.
+   * \param           model       The model to predict from.
+   * \param           ntree_limit (Optional) The ntree limit.
+   */
+
+  virtual void PredictBatchSafe(DMatrix* dmat,
+                                PredictionContext* ctx,
+                                const gbm::GBTreeModel& model,
+                                unsigned ntree_limit = 0);
+
   /**
    * \fn  virtual void Predictor::PredictLeaf(DMatrix* dmat,
    * std::vector<bst_float>* out_preds, const gbm::GBTreeModel& model, unsigned
@@ -160,6 +345,28 @@ class Predictor {
                                    unsigned ntree_limit = 0,
                                    bool approximate = false) = 0;
 
+  /**
+   * \brief Emit specialized native traversal code for a frozen model.
+   *
+   * Produces a self-contained C99 translation unit defining
+   *
+   *     void xgboost_predict(const float* f, float* out);
+   *
+   * where f holds XGBOOST_NUM_FEATURE feature values (NAN marks a missing
+   * feature) and out receives XGBOOST_NUM_OUTPUT_GROUP margins. Every tree
+   * is unrolled into nested branches with its thresholds as literals, so a
+   * build-time compiler turns the ensemble into straight native code,
+   * replacing the interpreted traversal for latency-critical scoring tiers
+   * while keeping the xgboost model file as the single source artifact.
+   *
+   * \param model       The model to compile.
+   * \param ntree_limit (Optional) The ntree limit. 0 means do not limit
+   *                    trees.
+   * \return  The generated source text.
+   */
+  std::string EmitNativeCode(const gbm::GBTreeModel& model,
+                             unsigned ntree_limit = 0) const;
+
   /**
    * \fn  static Predictor* Predictor::Create(std::string name);
    *
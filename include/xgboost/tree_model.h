@@ -269,6 +269,42 @@ class RegTree {
   const RTreeNodeStat& Stat(int nid) const {
     return stats_[nid];
   }
+  /*!
+   * \brief store the leaf value vector of a node; only valid when
+   *  param.size_leaf_vector is positive and values has exactly that length
+   */
+  inline void SetLeafVector(int nid, const std::vector<bst_float>& values) {
+    CHECK_GT(param.size_leaf_vector, 0);
+    CHECK_EQ(static_cast<int>(values.size()), param.size_leaf_vector);
+    const size_t stride = static_cast<size_t>(param.size_leaf_vector);
+    const size_t required = std::max(static_cast<size_t>(param.num_nodes),
+                                     static_cast<size_t>(nid) + 1) * stride;
+    if (leaf_vector_.size() < required) {
+      leaf_vector_.resize(required, 0.0f);
+    }
+    std::copy(values.begin(), values.end(),
+              leaf_vector_.begin() + static_cast<size_t>(nid) * stride);
+  }
+  /*!
+   * \brief leaf value vector of a node, of length param.size_leaf_vector;
+   *  zero-filled for internal nodes
+   */
+  inline const bst_float* LeafVector(int nid) const {
+    CHECK_LT(static_cast<size_t>(nid) * param.size_leaf_vector,
+             leaf_vector_.size());
+    return &leaf_vector_[static_cast<size_t>(nid) * param.size_leaf_vector];
+  }
+  /*! \brief get const reference to the leaf value vectors */
+  const std::vector<bst_float>& GetLeafVectors() const { return leaf_vector_; }
+  /*!
+   * \brief load the leaf value vectors from this tree's slice of a bulk
+   *  leaf vector section; the caller guarantees
+   *  param.num_nodes * param.size_leaf_vector entries
+   */
+  inline void LoadLeafVectors(const bst_float* data) {
+    leaf_vector_.assign(
+        data, data + static_cast<size_t>(param.num_nodes) * param.size_leaf_vector);
+  }
   /*!
    * \brief load model from stream
    * \param fi input stream
@@ -282,6 +318,15 @@ class RegTree {
              sizeof(Node) * nodes_.size());
     CHECK_EQ(fi->Read(dmlc::BeginPtr(stats_), sizeof(RTreeNodeStat) * stats_.size()),
              sizeof(RTreeNodeStat) * stats_.size());
+    if (param.size_leaf_vector != 0) {
+      leaf_vector_.resize(
+          static_cast<size_t>(param.num_nodes) * param.size_leaf_vector);
+      CHECK_EQ(fi->Read(dmlc::BeginPtr(leaf_vector_),
+                        sizeof(bst_float) * leaf_vector_.size()),
+               sizeof(bst_float) * leaf_vector_.size());
+    } else {
+      leaf_vector_.clear();
+    }
     // chg deleted nodes
     deleted_nodes_.resize(0);
     for (int i = param.num_roots; i < param.num_nodes; ++i) {
@@ -289,6 +334,25 @@ class RegTree {
     }
     CHECK_EQ(static_cast<int>(deleted_nodes_.size()), param.num_deleted);
   }
+  /*!
+   * \brief load the tree from pre-read sections of the bulk model
+   *  layout: a parsed tree parameter plus pointers into the contiguous
+   *  node and statistics arrays of the whole ensemble
+   * \param p parsed parameter of this tree
+   * \param nodes this tree's slice of the node section
+   * \param stats this tree's slice of the statistics section
+   */
+  void Load(const TreeParam& p, const Node* nodes, const RTreeNodeStat* stats) {
+    param = p;
+    CHECK_NE(param.num_nodes, 0);
+    nodes_.assign(nodes, nodes + param.num_nodes);
+    stats_.assign(stats, stats + param.num_nodes);
+    deleted_nodes_.resize(0);
+    for (int i = param.num_roots; i < param.num_nodes; ++i) {
+      if (nodes_[i].IsDeleted()) deleted_nodes_.push_back(i);
+    }
+    CHECK_EQ(static_cast<int>(deleted_nodes_.size()), param.num_deleted);
+  }
   /*!
    * \brief save model to stream
    * \param fo output stream
@@ -300,6 +364,12 @@ class RegTree {
     CHECK_NE(param.num_nodes, 0);
     fo->Write(dmlc::BeginPtr(nodes_), sizeof(Node) * nodes_.size());
     fo->Write(dmlc::BeginPtr(stats_), sizeof(RTreeNodeStat) * nodes_.size());
+    if (param.size_leaf_vector != 0) {
+      CHECK_EQ(leaf_vector_.size(),
+               static_cast<size_t>(param.num_nodes) * param.size_leaf_vector);
+      fo->Write(dmlc::BeginPtr(leaf_vector_),
+                sizeof(bst_float) * leaf_vector_.size());
+    }
   }
 
   /**
@@ -326,6 +396,16 @@ class RegTree {
     nodes_[pright].SetLeaf(0.0f, 0);
   }
 
+  /*!
+   * \brief reserve space for the given number of nodes, so growing the
+   *  tree split by split does not go back to the allocator; the logical
+   *  size of the tree is unchanged
+   * \param nodes expected upper bound of the node count
+   */
+  void Reserve(size_t nodes) {
+    nodes_.reserve(nodes);
+    stats_.reserve(nodes);
+  }
   /*!
    * \brief get current depth
    * \param nid node id
@@ -480,6 +560,16 @@ class RegTree {
    * \brief calculate the mean value for each node, required for feature contributions
    */
   void FillNodeMeanValues();
+  /*!
+   * \brief rewrite the node layout by observed access frequency: the busier
+   *  child of each split is placed right after its parent so that frequent
+   *  root-to-leaf paths become contiguous in memory, and subtrees the
+   *  profile never reached are moved to the tail. The tree semantics are
+   *  unchanged, but node ids, and therefore leaf indices reported by
+   *  prediction, are renumbered.
+   * \param visit_counts per-node visit counts, one entry per node
+   */
+  void ReorderNodes(const std::vector<size_t>& visit_counts);
 
  private:
   // vector of nodes
@@ -488,6 +578,8 @@ class RegTree {
   std::vector<int>  deleted_nodes_;
   // stats of nodes
   std::vector<RTreeNodeStat> stats_;
+  // leaf value vectors, num_nodes x size_leaf_vector; empty for scalar trees
+  std::vector<bst_float> leaf_vector_;
   std::vector<bst_float> node_mean_values_;
   // allocate a new node,
   // !!!!!! NOTE: may cause BUG here, nodes.resize
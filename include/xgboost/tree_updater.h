@@ -48,6 +48,13 @@ class TreeUpdater {
    * \brief determines whether updater has enough knowledge about a given dataset
    *        to quickly update prediction cache its training data and performs the
    *        update if possible.
+   *
+   *  Updaters in a sequence are consulted from last to first and the
+   *  first one to return true wins, so an updater that only transforms
+   *  trees in place (pruning marks nodes deleted, refresh rewrites leaf
+   *  values) may return false and let the grower before it serve the
+   *  cache: the grower's row-to-leaf assignments read the final tree
+   *  state and must follow deleted nodes up to the surviving leaf.
    * \param data: data matrix
    * \param out_preds: prediction cache to be updated
    * \return boolean indicating whether updater has capability to update
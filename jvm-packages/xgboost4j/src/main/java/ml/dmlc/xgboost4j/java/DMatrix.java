@@ -15,6 +15,8 @@
  */
 package ml.dmlc.xgboost4j.java;
 
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
 import java.util.Iterator;
 
 import ml.dmlc.xgboost4j.LabeledPoint;
@@ -115,6 +117,41 @@ public class DMatrix {
     handle = out[0];
   }
 
+  /**
+   * Create DMatrix from a CSR matrix staged in direct ByteBuffers.
+   *
+   * Unlike the array based constructors the buffer contents are handed to the
+   * native library as raw off-heap pointers, so neither a per-element JNI
+   * transition nor a duplicate on-heap copy happens. The buffers must be
+   * direct and in native byte order, laid out as 8-byte longs (headers),
+   * 4-byte ints (indices) and 4-byte floats (data); they may be larger than
+   * the region described by nindptr and nelem, so ingestion frameworks can
+   * reuse fixed-size off-heap chunks.
+   *
+   * @param headers direct buffer holding the nindptr row offsets
+   * @param indices direct buffer holding the nelem feature indices
+   * @param data direct buffer holding the nelem feature values
+   * @param nindptr number of row offsets (number of rows + 1)
+   * @param nelem number of entries
+   * @param shapeParam the column number
+   * @throws XGBoostError native error
+   */
+  public DMatrix(ByteBuffer headers, ByteBuffer indices, ByteBuffer data,
+                 long nindptr, long nelem, int shapeParam) throws XGBoostError {
+    if (!headers.isDirect() || !indices.isDirect() || !data.isDirect()) {
+      throw new IllegalArgumentException("headers, indices and data must be direct ByteBuffers");
+    }
+    if (headers.order() != ByteOrder.nativeOrder()
+            || indices.order() != ByteOrder.nativeOrder()
+            || data.order() != ByteOrder.nativeOrder()) {
+      throw new IllegalArgumentException("buffers must be in native byte order");
+    }
+    long[] out = new long[1];
+    XGBoostJNI.checkCall(XGBoostJNI.XGDMatrixCreateFromCSRDirect(headers, indices, data,
+            nindptr, nelem, shapeParam, out));
+    handle = out[0];
+  }
+
   /**
    * create DMatrix from dense matrix
    *
@@ -59,6 +59,11 @@ class XGBoostJNI {
   public final static native int XGDMatrixCreateFromCSREx(long[] indptr, int[] indices, float[] data,
                                                         int shapeParam, long[] out);
 
+  public final static native int XGDMatrixCreateFromCSRDirect(ByteBuffer indptr, ByteBuffer indices,
+                                                              ByteBuffer data, long nindptr,
+                                                              long nelem, int shapeParam,
+                                                              long[] out);
+
   public final static native int XGDMatrixCreateFromCSCEx(long[] colptr, int[] indices, float[] data,
                                                           int shapeParam, long[] out);
 
@@ -222,6 +222,34 @@ JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGDMatrixCreateFro
   return ret;
 }
 
+/*
+ * Class:     ml_dmlc_xgboost4j_java_XGBoostJNI
+ * Method:    XGDMatrixCreateFromCSRDirect
+ * Signature: (Ljava/nio/ByteBuffer;Ljava/nio/ByteBuffer;Ljava/nio/ByteBuffer;JJI[J)I
+ */
+JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGDMatrixCreateFromCSRDirect
+  (JNIEnv *jenv, jclass jcls, jobject jindptr, jobject jindices, jobject jdata,
+   jlong jnindptr, jlong jnelem, jint jcol, jlongArray jout) {
+  DMatrixHandle result;
+  // the buffers are direct, so the native library reads the caller's
+  // off-heap memory in place; no per-element JNI transition, no on-heap copy
+  const size_t* indptr =
+    static_cast<const size_t*>(jenv->GetDirectBufferAddress(jindptr));
+  const unsigned* indices =
+    static_cast<const unsigned*>(jenv->GetDirectBufferAddress(jindices));
+  const float* data =
+    static_cast<const float*>(jenv->GetDirectBufferAddress(jdata));
+  if (indptr == nullptr || indices == nullptr || data == nullptr) {
+    jenv->ThrowNew(jenv->FindClass("java/lang/IllegalArgumentException"),
+                   "XGDMatrixCreateFromCSRDirect requires direct ByteBuffers");
+    return -1;
+  }
+  jint ret = (jint) XGDMatrixCreateFromCSREx(indptr, indices, data,
+    (size_t)jnindptr, (size_t)jnelem, (size_t)jcol, &result);
+  setHandle(jenv, jout, result);
+  return ret;
+}
+
 /*
  * Class:     ml_dmlc_xgboost4j_java_XGBoostJNI
  * Method:    XGDMatrixCreateFromCSCEx
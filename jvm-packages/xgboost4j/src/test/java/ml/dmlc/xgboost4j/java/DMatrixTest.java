@@ -109,6 +109,46 @@ public class DMatrixTest {
     TestCase.assertTrue(Arrays.equals(label1, label2));
   }
 
+  @Test
+  public void testCreateFromCSRDirect() throws XGBoostError {
+    //create Matrix from csr chunks staged in direct off-heap buffers
+    /**
+     * sparse matrix
+     * 1 0 2 3 0
+     * 4 0 2 3 5
+     * 3 1 2 5 0
+     */
+    float[] data = new float[]{1, 2, 3, 4, 2, 3, 5, 3, 1, 2, 5};
+    int[] colIndex = new int[]{0, 2, 3, 0, 2, 3, 4, 0, 1, 2, 3};
+    long[] rowHeaders = new long[]{0, 3, 7, 11};
+    // the buffers are deliberately over-allocated, as a chunked writer
+    // reusing fixed-size buffers would leave them
+    java.nio.ByteBuffer headerBuf = java.nio.ByteBuffer.allocateDirect(8 * 16)
+            .order(java.nio.ByteOrder.nativeOrder());
+    java.nio.ByteBuffer indexBuf = java.nio.ByteBuffer.allocateDirect(4 * 16)
+            .order(java.nio.ByteOrder.nativeOrder());
+    java.nio.ByteBuffer dataBuf = java.nio.ByteBuffer.allocateDirect(4 * 16)
+            .order(java.nio.ByteOrder.nativeOrder());
+    for (long header : rowHeaders) {
+      headerBuf.putLong(header);
+    }
+    for (int index : colIndex) {
+      indexBuf.putInt(index);
+    }
+    for (float value : data) {
+      dataBuf.putFloat(value);
+    }
+    DMatrix dmat1 = new DMatrix(headerBuf, indexBuf, dataBuf,
+            rowHeaders.length, data.length, 5);
+    //check row num
+    TestCase.assertTrue(dmat1.rowNum() == 3);
+    //test set label
+    float[] label1 = new float[]{1, 0, 1};
+    dmat1.setLabel(label1);
+    float[] label2 = dmat1.getLabel();
+    TestCase.assertTrue(Arrays.equals(label1, label2));
+  }
+
   @Test
   public void testCreateFromCSC() throws XGBoostError {
     //create Matrix from csc format sparse Matrix and labels
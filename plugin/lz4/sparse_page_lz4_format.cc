@@ -181,13 +181,13 @@ class SparsePageLZ4Format : public SparsePageFormat {
     auto& data_vec = page->data.HostVector();
     if (!fi->Read(&(offset_vec))) return false;
     CHECK_NE(offset_vec.size(), 0) << "Invalid SparsePage file";
-    this->LoadIndexValue(fi);
+    this->LoadIndexValue(fi, offset_vec);
 
     data_vec.resize(offset_vec.back());
-    CHECK_EQ(index_.data.size(), value_.data.size());
-    CHECK_EQ(index_.data.size(), data_vec.size());
+    CHECK_EQ(decoded_index_.size(), value_.data.size());
+    CHECK_EQ(decoded_index_.size(), data_vec.size());
     for (size_t i = 0; i < data_vec.size(); ++i) {
-      data_vec[i] = Entry(index_.data[i] + min_index_, value_.data[i]);
+      data_vec[i] = Entry(decoded_index_[i] + min_index_, value_.data[i]);
     }
     return true;
   }
@@ -196,7 +196,7 @@ class SparsePageLZ4Format : public SparsePageFormat {
             dmlc::SeekStream* fi,
             const std::vector<bst_uint>& sorted_index_set) override {
     if (!fi->Read(&disk_offset_)) return false;
-    this->LoadIndexValue(fi);
+    this->LoadIndexValue(fi, disk_offset_);
     auto& offset_vec = page->offset.HostVector();
     auto& data_vec = page->data.HostVector();
     offset_vec.clear();
@@ -206,8 +206,8 @@ class SparsePageLZ4Format : public SparsePageFormat {
           offset_vec.back() + disk_offset_[cid + 1] - disk_offset_[cid]);
     }
     data_vec.resize(offset_vec.back());
-    CHECK_EQ(index_.data.size(), value_.data.size());
-    CHECK_EQ(index_.data.size(), disk_offset_.back());
+    CHECK_EQ(decoded_index_.size(), value_.data.size());
+    CHECK_EQ(decoded_index_.size(), disk_offset_.back());
 
     for (size_t i = 0; i < sorted_index_set.size(); ++i) {
       bst_uint cid = sorted_index_set[i];
@@ -216,7 +216,7 @@ class SparsePageLZ4Format : public SparsePageFormat {
       size_t num = disk_offset_[cid + 1] - disk_offset_[cid];
       for (size_t j = 0; j < num; ++j) {
         data_vec[dst_begin + j] = Entry(
-            index_.data[src_begin + j] + min_index_, value_.data[src_begin + j]);
+            decoded_index_[src_begin + j] + min_index_, value_.data[src_begin + j]);
       }
     }
     return true;
@@ -230,7 +230,7 @@ class SparsePageLZ4Format : public SparsePageFormat {
     fo->Write(offset_vec);
     min_index_ = page.base_rowid;
     fo->Write(&min_index_, sizeof(min_index_));
-    index_.data.resize(data_vec.size());
+    decoded_index_.resize(data_vec.size());
     value_.data.resize(data_vec.size());
 
     for (size_t i = 0; i < data_vec.size(); ++i) {
@@ -239,10 +239,45 @@ class SparsePageLZ4Format : public SparsePageFormat {
           << "The storage index is chosen to limited to smaller equal than "
           << std::numeric_limits<StorageIndex>::max()
           << "min_index=" << min_index_;
-      index_.data[i] = static_cast<StorageIndex>(idx);
+      decoded_index_[i] = idx;
       value_.data[i] = data_vec[i].fvalue;
     }
 
+    // indices ascend within each row/column segment, so consecutive
+    // in-segment deltas are small; pack them with the narrowest byte width
+    // that holds the largest one before handing the stream to LZ4. Each
+    // segment restarts the encoding: the start values can be as large as
+    // the feature space, so they travel in a separate full-width stream,
+    // leave a zero in their delta slot and stay out of the width choice.
+    segment_start_.clear();
+    bst_uint max_delta = 0;
+    for (size_t r = 0; r + 1 < offset_vec.size(); ++r) {
+      const size_t begin = offset_vec[r];
+      const size_t end = offset_vec[r + 1];
+      if (begin == end) continue;
+      segment_start_.push_back(decoded_index_[begin]);
+      bst_uint prev = decoded_index_[begin];
+      decoded_index_[begin] = 0;
+      for (size_t i = begin + 1; i < end; ++i) {
+        const bst_uint cur = decoded_index_[i];
+        const bst_uint delta = cur - prev;
+        decoded_index_[i] = delta;
+        max_delta = std::max(max_delta, delta);
+        prev = cur;
+      }
+    }
+    index_width_ = max_delta < (1U << 8) ? 1 : max_delta < (1U << 16) ? 2 : 4;
+    fo->Write(&index_width_, sizeof(index_width_));
+    fo->Write(segment_start_);
+    index_.data.resize(decoded_index_.size() * index_width_);
+    for (size_t i = 0; i < decoded_index_.size(); ++i) {
+      bst_uint delta = decoded_index_[i];
+      for (int b = 0; b < index_width_; ++b) {
+        index_.data[i * index_width_ + b] = static_cast<uint8_t>(delta & 0xffU);
+        delta >>= 8;
+      }
+    }
+
     index_.InitCompressChunks(kChunkSize, kMaxChunk);
     value_.InitCompressChunks(kChunkSize, kMaxChunk);
 
@@ -260,15 +295,19 @@ class SparsePageLZ4Format : public SparsePageFormat {
     index_.Write(fo);
     value_.Write(fo);
     // statistics
-    raw_bytes_index_ += index_.RawBytes() * sizeof(bst_uint) / sizeof(StorageIndex);
+    raw_bytes_index_ += decoded_index_.size() * sizeof(bst_uint);
     raw_bytes_value_ += value_.RawBytes();
     encoded_bytes_index_ += index_.EncodedBytes();
     encoded_bytes_value_ += value_.EncodedBytes();
-    raw_bytes_ += offset_vec.size() * sizeof(size_t);
+    raw_bytes_ += offset_vec.size() * sizeof(size_t) +
+        segment_start_.size() * sizeof(bst_uint);
   }
 
-  inline void LoadIndexValue(dmlc::SeekStream* fi) {
+  inline void LoadIndexValue(dmlc::SeekStream* fi,
+                             const std::vector<size_t>& offsets) {
     fi->Read(&min_index_, sizeof(min_index_));
+    fi->Read(&index_width_, sizeof(index_width_));
+    CHECK(fi->Read(&segment_start_));
     index_.Read(fi);
     value_.Read(fi);
 
@@ -283,6 +322,29 @@ class SparsePageLZ4Format : public SparsePageFormat {
         value_.Decompress(i - nindex);
       }
     }
+    // undo the byte packing and the delta encoding; each row/column
+    // segment restarts the prefix sum from its entry in the full-width
+    // segment-start stream
+    CHECK_EQ(index_.data.size() % index_width_, 0U);
+    decoded_index_.resize(index_.data.size() / index_width_);
+    CHECK_EQ(decoded_index_.size(), offsets.back());
+    size_t seg = 0;
+    for (size_t r = 0; r + 1 < offsets.size(); ++r) {
+      const size_t begin = offsets[r];
+      const size_t end = offsets[r + 1];
+      if (begin == end) continue;
+      CHECK_LT(seg, segment_start_.size());
+      bst_uint prev = segment_start_[seg++];
+      decoded_index_[begin] = prev;
+      for (size_t i = begin + 1; i < end; ++i) {
+        bst_uint delta = 0;
+        for (int b = 0; b < index_width_; ++b) {
+          delta |= static_cast<bst_uint>(index_.data[i * index_width_ + b]) << (8 * b);
+        }
+        prev += delta;
+        decoded_index_[i] = prev;
+      }
+    }
   }
 
  private:
@@ -302,10 +364,16 @@ class SparsePageLZ4Format : public SparsePageFormat {
   size_t encoded_bytes_index_, encoded_bytes_value_;
   /*! \brief minimum index value */
   uint32_t min_index_;
+  /*! \brief byte width of the packed in-segment index deltas, 1, 2 or 4 */
+  uint8_t index_width_{4};
+  /*! \brief absolute first index of each non-empty segment, stored raw */
+  std::vector<bst_uint> segment_start_;
   /*! \brief external memory column offset */
   std::vector<size_t> disk_offset_;
-  // internal index
-  CompressArray<StorageIndex> index_;
+  // packed modular deltas of the index stream
+  CompressArray<uint8_t> index_;
+  // decoded absolute indices, relative to min_index_
+  std::vector<bst_uint> decoded_index_;
   // value set.
   CompressArray<bst_float> value_;
 };
@@ -2,6 +2,7 @@
 
 #include <xgboost/data.h>
 #include <xgboost/learner.h>
+#include <xgboost/predictor.h>
 #include <xgboost/c_api.h>
 #include <xgboost/logging.h>
 #include <dmlc/thread_local.h>
@@ -14,10 +15,14 @@
 #include <memory>
 
 #include "./c_api_error.h"
+#include "../data/dense_dmatrix.h"
 #include "../data/simple_csr_source.h"
+#include "../data/slice_dmatrix.h"
 #include "../common/math.h"
 #include "../common/io.h"
 #include "../common/group_data.h"
+#include "../common/memory_stats.h"
+#include "../common/timer.h"
 
 
 namespace xgboost {
@@ -29,6 +34,11 @@ class Booster {
         initialized_(false),
         learner_(Learner::Create(cache_mats)) {}
 
+  // wrap an already initialized learner, e.g. one produced by
+  // Learner::Slice; takes ownership
+  explicit Booster(Learner* learner)
+      : configured_(false), initialized_(true), learner_(learner) {}
+
   inline Learner* learner() {  // NOLINT
     return learner_.get();
   }
@@ -92,6 +102,26 @@ class Booster {
   bool initialized_;
   std::unique_ptr<Learner> learner_;
   std::vector<std::pair<std::string, std::string> > cfg_;
+  // custom objective registered through XGBoosterSetCustomObjective
+  XGBCustomObjCallback* custom_obj_{nullptr};
+  int custom_obj_parallel_{0};
+  void* custom_obj_user_data_{nullptr};
+  // buffers reused across XGBoosterUpdateOneIterCustom iterations so the
+  // custom objective path allocates nothing in steady state
+  HostDeviceVector<bst_float> custom_preds_;
+  HostDeviceVector<GradientPair> custom_gpair_;
+  std::vector<bst_float> custom_grad_;
+  std::vector<bst_float> custom_hess_;
+};
+
+// reusable state behind a PredictContextHandle; holds the instance buffer
+// and the predictor scratch so XGBoosterPredictSingle allocates nothing in
+// steady state. One context must only be used by one thread at a time.
+struct PredictContext {
+  // instance entries, cleared but not shrunk between calls
+  std::vector<Entry> row;
+  // feature vector and output buffer shared with the predictor
+  PredictionContext ctx;
 };
 
 // declare the data callback.
@@ -216,8 +246,19 @@ struct XGBAPIThreadLocalEntry {
   std::vector<const char *> ret_vec_charp;
   /*! \brief returning float vector. */
   std::vector<bst_float> ret_vec_float;
+  /*! \brief returning unsigned vector, e.g. feature indices. */
+  std::vector<unsigned> ret_vec_uint;
   /*! \brief temp variable of gradient pairs. */
   std::vector<GradientPair> tmp_gpair;
+  /*! \brief reusable prediction buffer for the preallocated-output variants. */
+  HostDeviceVector<bst_float> tmp_preds;
+  /*! \brief cached state of XGBoosterPredictDelta sweeps. */
+  struct {
+    void* booster{nullptr};
+    void* dmat{nullptr};
+    unsigned ntree_limit{0};
+    HostDeviceVector<bst_float> margins;
+  } delta;
 };
 
 // define the threadlocal store.
@@ -273,20 +314,44 @@ XGB_DLL int XGDMatrixCreateFromCSREx(const size_t* indptr,
   data::SimpleCSRSource& mat = *source;
   auto& offset_vec = mat.page_.offset.HostVector();
   auto& data_vec = mat.page_.data.HostVector();
-  offset_vec.reserve(nindptr);
-  data_vec.reserve(nelem);
-  offset_vec.resize(1);
+  const int nthread = omp_get_max_threads();
+  std::vector<size_t> max_columns(nthread, 0);
+  offset_vec.resize(std::max(nindptr, static_cast<size_t>(1)));
   offset_vec[0] = 0;
-  size_t num_column = 0;
-  for (size_t i = 1; i < nindptr; ++i) {
-    for (size_t j = indptr[i - 1]; j < indptr[i]; ++j) {
+  const auto nrow = static_cast<omp_ulong>(nindptr == 0 ? 0 : nindptr - 1);
+  // pass 1: count the entries of each row that survive the nan skip and
+  // track the per-thread column maximum
+  #pragma omp parallel for schedule(static)
+  for (omp_ulong i = 0; i < nrow; ++i) {
+    const int tid = omp_get_thread_num();
+    size_t nelem_row = 0;
+    for (size_t j = indptr[i]; j < indptr[i + 1]; ++j) {
       if (!common::CheckNAN(data[j])) {
         // automatically skip nan.
-        data_vec.emplace_back(Entry(indices[j], data[j]));
-        num_column = std::max(num_column, static_cast<size_t>(indices[j] + 1));
+        ++nelem_row;
+        max_columns[tid] = std::max(max_columns[tid],
+                                    static_cast<size_t>(indices[j] + 1));
+      }
+    }
+    offset_vec[i + 1] = nelem_row;
+  }
+  for (omp_ulong i = 0; i < nrow; ++i) {
+    offset_vec[i + 1] += offset_vec[i];
+  }
+  data_vec.resize(offset_vec.back());
+  // pass 2: scatter the surviving entries into their final position
+  #pragma omp parallel for schedule(static)
+  for (omp_ulong i = 0; i < nrow; ++i) {
+    size_t at = offset_vec[i];
+    for (size_t j = indptr[i]; j < indptr[i + 1]; ++j) {
+      if (!common::CheckNAN(data[j])) {
+        data_vec[at++] = Entry(indices[j], data[j]);
       }
     }
-    offset_vec.push_back(mat.page_.data.Size());
+  }
+  size_t num_column = 0;
+  for (int tid = 0; tid < nthread; ++tid) {
+    num_column = std::max(num_column, max_columns[tid]);
   }
 
   mat.info.num_col_ = num_column;
@@ -553,6 +618,17 @@ XGB_DLL int XGDMatrixCreateFromMat_omp(const bst_float* data,  // NOLINT
   API_END();
 }
 
+XGB_DLL int XGDMatrixCreateFromMatBorrowed(const bst_float* data,
+                                           xgboost::bst_ulong nrow,
+                                           xgboost::bst_ulong ncol,
+                                           bst_float missing,
+                                           DMatrixHandle* out) {
+  API_BEGIN();
+  *out = new std::shared_ptr<DMatrix>(
+      new data::DenseDMatrix(data, nrow, ncol, missing));
+  API_END();
+}
+
 enum class DTType : uint8_t {
   kFloat32 = 0,
   kFloat64 = 1,
@@ -700,8 +776,25 @@ XGB_DLL int XGDMatrixSliceDMatrix(DMatrixHandle handle,
 
   API_BEGIN();
   CHECK_HANDLE();
+  std::shared_ptr<DMatrix>& parent =
+      *static_cast<std::shared_ptr<DMatrix>*>(handle);
+  if (parent->SingleColBlock()) {
+    // in-memory parents get a zero-copy row view: fold construction is
+    // O(rows in the fold) indices and sliced meta info, the feature
+    // entries stay in the parent
+    std::vector<bst_uint> ridx;
+    ridx.reserve(len);
+    for (xgboost::bst_ulong i = 0; i < len; ++i) {
+      CHECK_GE(idxset[i], 0) << "slice index must be nonnegative";
+      ridx.push_back(static_cast<bst_uint>(idxset[i]));
+    }
+    *out = new std::shared_ptr<DMatrix>(
+        new data::SliceDMatrix(parent, std::move(ridx)));
+    return 0;
+  }
+  // external-memory parents keep the materializing path
   data::SimpleCSRSource src;
-  src.CopyFrom(static_cast<std::shared_ptr<DMatrix>*>(handle)->get());
+  src.CopyFrom(parent.get());
   data::SimpleCSRSource& ret = *source;
 
   CHECK_EQ(src.info.group_ptr_.size(), 0U)
@@ -751,6 +844,15 @@ XGB_DLL int XGDMatrixSliceDMatrix(DMatrixHandle handle,
   API_END();
 }
 
+XGB_DLL int XGDMatrixAppendRows(DMatrixHandle handle,
+                                DMatrixHandle src) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  static_cast<std::shared_ptr<DMatrix>*>(handle)->get()->AppendRows(
+      static_cast<std::shared_ptr<DMatrix>*>(src)->get());
+  API_END();
+}
+
 XGB_DLL int XGDMatrixFree(DMatrixHandle handle) {
   API_BEGIN();
   CHECK_HANDLE();
@@ -882,6 +984,24 @@ XGB_DLL int XGBoosterFree(BoosterHandle handle) {
   API_END();
 }
 
+XGB_DLL int XGBoosterSlice(BoosterHandle handle,
+                           xgboost::bst_ulong unit_begin,
+                           xgboost::bst_ulong unit_end,
+                           BoosterHandle *out) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto* bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  *out = new Booster(bst->learner()->Slice(unit_begin, unit_end));
+  API_END();
+}
+
+XGB_DLL int XGBoosterClone(BoosterHandle handle,
+                           BoosterHandle *out) {
+  // a clone is a slice over every tree
+  return XGBoosterSlice(handle, 0, 0, out);
+}
+
 XGB_DLL int XGBoosterSetParam(BoosterHandle handle,
                               const char *name,
                               const char *value) {
@@ -905,6 +1025,44 @@ XGB_DLL int XGBoosterUpdateOneIter(BoosterHandle handle,
   API_END();
 }
 
+XGB_DLL int XGBoosterSetCachedMargin(BoosterHandle handle,
+                                     DMatrixHandle dtrain,
+                                     const bst_float *margin,
+                                     xgboost::bst_ulong len) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto* bst = static_cast<Booster*>(handle);
+  auto* dtr =
+      static_cast<std::shared_ptr<DMatrix>*>(dtrain);
+  bst->LazyInit();
+  std::vector<bst_float> margin_vec(margin, margin + len);
+  CHECK(bst->learner()->SetCachedPredictionMargin(dtr->get(), margin_vec))
+      << "cannot seed the prediction cache: the matrix must be registered "
+      << "with the booster at creation and the booster must keep a "
+      << "prediction cache";
+  API_END();
+}
+
+XGB_DLL int XGBoosterGetCachedMargin(BoosterHandle handle,
+                                     DMatrixHandle dtrain,
+                                     xgboost::bst_ulong *out_len,
+                                     const bst_float **out_result) {
+  std::vector<bst_float>& margin =
+    XGBAPIThreadLocalStore::Get()->ret_vec_float;
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto* bst = static_cast<Booster*>(handle);
+  auto* dtr =
+      static_cast<std::shared_ptr<DMatrix>*>(dtrain);
+  bst->LazyInit();
+  if (!bst->learner()->GetCachedPredictionMargin(dtr->get(), &margin)) {
+    margin.clear();
+  }
+  *out_result = dmlc::BeginPtr(margin);
+  *out_len = static_cast<xgboost::bst_ulong>(margin.size());
+  API_END();
+}
+
 XGB_DLL int XGBoosterBoostOneIter(BoosterHandle handle,
                                   DMatrixHandle dtrain,
                                   bst_float *grad,
@@ -927,6 +1085,81 @@ XGB_DLL int XGBoosterBoostOneIter(BoosterHandle handle,
   API_END();
 }
 
+XGB_DLL int XGBoosterSetCustomObjective(BoosterHandle handle,
+                                        XGBCustomObjCallback *callback,
+                                        int parallel,
+                                        void *user_data) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto* bst = static_cast<Booster*>(handle);
+  bst->custom_obj_ = callback;
+  bst->custom_obj_parallel_ = parallel;
+  bst->custom_obj_user_data_ = user_data;
+  API_END();
+}
+
+XGB_DLL int XGBoosterUpdateOneIterCustom(BoosterHandle handle,
+                                         int iter,
+                                         DMatrixHandle dtrain) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto* bst = static_cast<Booster*>(handle);
+  auto* dtr =
+      static_cast<std::shared_ptr<DMatrix>*>(dtrain);
+  CHECK(bst->custom_obj_ != nullptr)
+      << "custom objective must be registered with "
+         "XGBoosterSetCustomObjective before UpdateOneIterCustom";
+
+  bst->LazyInit();
+  DMatrix* dmat = dtr->get();
+  bst->learner()->Predict(dmat, true, &bst->custom_preds_);
+
+  const std::vector<bst_float>& preds = bst->custom_preds_.HostVector();
+  const auto ndata = static_cast<xgboost::bst_ulong>(preds.size());
+  const MetaInfo& info = dmat->Info();
+  // labels/weights are chunk-aligned only when there is one prediction
+  // per instance; multi-class callbacks receive NULL and index the
+  // labels themselves through the begin offset
+  const bst_float* labels = info.labels_.Size() == preds.size()
+      ? info.labels_.HostVector().data() : nullptr;
+  const bst_float* weights = info.weights_.Size() == preds.size()
+      ? info.weights_.HostVector().data() : nullptr;
+
+  bst->custom_grad_.resize(ndata);
+  bst->custom_hess_.resize(ndata);
+  bst_float* grad = bst->custom_grad_.data();
+  bst_float* hess = bst->custom_hess_.data();
+
+  const xgboost::bst_ulong kChunkSize = 65536;
+  const auto nchunk = static_cast<omp_ulong>((ndata + kChunkSize - 1) / kChunkSize);
+  XGBCustomObjCallback* callback = bst->custom_obj_;
+  void* user_data = bst->custom_obj_user_data_;
+  int callback_error = 0;
+  #pragma omp parallel for schedule(static) if (bst->custom_obj_parallel_ != 0) \
+      reduction(|:callback_error)
+  for (omp_ulong c = 0; c < nchunk; ++c) {
+    const xgboost::bst_ulong begin = c * kChunkSize;
+    const xgboost::bst_ulong len = std::min(kChunkSize, ndata - begin);
+    callback_error |= callback(preds.data() + begin,
+                               labels == nullptr ? nullptr : labels + begin,
+                               weights == nullptr ? nullptr : weights + begin,
+                               begin, len,
+                               grad + begin, hess + begin, user_data);
+  }
+  CHECK_EQ(callback_error, 0)
+      << "custom objective callback returned nonzero";
+
+  bst->custom_gpair_.Resize(ndata);
+  std::vector<GradientPair>& gpair = bst->custom_gpair_.HostVector();
+  const auto nsize = static_cast<omp_ulong>(ndata);
+  #pragma omp parallel for schedule(static)
+  for (omp_ulong i = 0; i < nsize; ++i) {
+    gpair[i] = GradientPair(grad[i], hess[i]);
+  }
+  bst->learner()->BoostOneIter(iter, dmat, &bst->custom_gpair_);
+  API_END();
+}
+
 XGB_DLL int XGBoosterEvalOneIter(BoosterHandle handle,
                                  int iter,
                                  DMatrixHandle dmats[],
@@ -951,6 +1184,17 @@ XGB_DLL int XGBoosterEvalOneIter(BoosterHandle handle,
   API_END();
 }
 
+XGB_DLL int XGBoosterIterationTimings(BoosterHandle handle,
+                                      const char** out_json) {
+  std::string& ret_str = XGBAPIThreadLocalStore::Get()->ret_str;
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto* bst = static_cast<Booster*>(handle);
+  ret_str = bst->learner()->IterationTimingsJson();
+  *out_json = ret_str.c_str();
+  API_END();
+}
+
 XGB_DLL int XGBoosterPredict(BoosterHandle handle,
                              DMatrixHandle dmat,
                              int option_mask,
@@ -978,6 +1222,204 @@ XGB_DLL int XGBoosterPredict(BoosterHandle handle,
   API_END();
 }
 
+XGB_DLL int XGBoosterPredictDelta(BoosterHandle handle,
+                                  DMatrixHandle dmat,
+                                  unsigned ntree_limit,
+                                  xgboost::bst_ulong *out_len,
+                                  const bst_float **out_result) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  CHECK_GT(ntree_limit, 0U)
+      << "delta prediction needs an explicit tree limit";
+  auto *bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  auto& state = XGBAPIThreadLocalStore::Get()->delta;
+  DMatrix* dptr = static_cast<std::shared_ptr<DMatrix>*>(dmat)->get();
+  // extend the cached margins when this continues the previous sweep step,
+  // otherwise pay for one full pass and start a new sweep
+  const bool incremental = state.booster == handle && state.dmat == dmat &&
+                           state.ntree_limit > 0 &&
+                           state.ntree_limit <= ntree_limit;
+  if (incremental) {
+    bst->learner()->PredictMarginRange(dptr, &state.margins,
+                                       state.ntree_limit, ntree_limit);
+  } else {
+    bst->learner()->Predict(dptr, true, &state.margins, ntree_limit);
+  }
+  state.booster = handle;
+  state.dmat = dmat;
+  state.ntree_limit = ntree_limit;
+  const std::vector<bst_float>& preds = state.margins.HostVector();
+  *out_result = dmlc::BeginPtr(preds);
+  *out_len = static_cast<xgboost::bst_ulong>(preds.size());
+  API_END();
+}
+
+XGB_DLL int XGBoosterPredictDense(BoosterHandle handle,
+                                  const float *data,
+                                  xgboost::bst_ulong num_row,
+                                  xgboost::bst_ulong num_col,
+                                  float missing,
+                                  int option_mask,
+                                  unsigned ntree_limit,
+                                  xgboost::bst_ulong *out_len,
+                                  const float **out_result) {
+  std::vector<bst_float>& preds =
+      XGBAPIThreadLocalStore::Get()->ret_vec_float;
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto *bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  HostDeviceVector<bst_float> tmp_preds;
+  bst->learner()->PredictDense(data, num_row, num_col, missing,
+                               (option_mask & 1) != 0, &tmp_preds,
+                               ntree_limit);
+  preds = tmp_preds.HostVector();
+  *out_result = dmlc::BeginPtr(preds);
+  *out_len = static_cast<xgboost::bst_ulong>(preds.size());
+  API_END();
+}
+
+XGB_DLL int XGBoosterPredictDeviceDense(BoosterHandle handle,
+                                        const float *data,
+                                        xgboost::bst_ulong num_row,
+                                        xgboost::bst_ulong num_col,
+                                        unsigned ntree_limit,
+                                        xgboost::bst_ulong *out_len,
+                                        const float **out_result) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto *bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  size_t len = 0;
+  // the prediction buffer lives on the device and is owned by the
+  // predictor; nothing is staged through host memory here
+  bst->learner()->PredictDeviceDense(data, num_row, num_col, ntree_limit,
+                                     out_result, &len);
+  *out_len = static_cast<xgboost::bst_ulong>(len);
+  API_END();
+}
+
+XGB_DLL int XGBoosterPredictLeafInto(BoosterHandle handle,
+                                     DMatrixHandle dmat,
+                                     unsigned ntree_limit,
+                                     xgboost::bst_ulong len,
+                                     bst_float *out_result) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto *bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  // the thread local buffer keeps its capacity across calls, so once it is
+  // warm the only work besides prediction is the copy into caller memory
+  HostDeviceVector<bst_float>& tmp_preds =
+      XGBAPIThreadLocalStore::Get()->tmp_preds;
+  bst->learner()->Predict(
+      static_cast<std::shared_ptr<DMatrix>*>(dmat)->get(),
+      false, &tmp_preds, ntree_limit,
+      true, false, false, false);
+  const std::vector<bst_float>& preds = tmp_preds.HostVector();
+  CHECK_EQ(static_cast<xgboost::bst_ulong>(preds.size()), len)
+      << "output buffer must hold num_row * num_trees leaf indices";
+  std::copy(preds.begin(), preds.end(), out_result);
+  API_END();
+}
+
+XGB_DLL int XGBoosterPredictInto(BoosterHandle handle,
+                                 DMatrixHandle dmat,
+                                 int option_mask,
+                                 unsigned ntree_limit,
+                                 xgboost::bst_ulong len,
+                                 bst_float *out_result) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto *bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  // as in XGBoosterPredictLeafInto, the thread local buffer keeps its
+  // capacity across calls; steady-state cost is prediction plus the copy
+  // into caller memory
+  HostDeviceVector<bst_float>& tmp_preds =
+      XGBAPIThreadLocalStore::Get()->tmp_preds;
+  bst->learner()->Predict(
+      static_cast<std::shared_ptr<DMatrix>*>(dmat)->get(),
+      (option_mask & 1) != 0,
+      &tmp_preds, ntree_limit,
+      (option_mask & 2) != 0,
+      (option_mask & 4) != 0,
+      (option_mask & 8) != 0,
+      (option_mask & 16) != 0);
+  const std::vector<bst_float>& preds = tmp_preds.HostVector();
+  CHECK_EQ(static_cast<xgboost::bst_ulong>(preds.size()), len)
+      << "output buffer length does not match the prediction output size";
+  std::copy(preds.begin(), preds.end(), out_result);
+  API_END();
+}
+
+XGB_DLL int XGBoosterPredictContextCreate(BoosterHandle handle,
+                                          PredictContextHandle *out) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  // configure up front so the per-call path stays cheap
+  static_cast<Booster*>(handle)->LazyInit();
+  *out = new PredictContext();
+  API_END();
+}
+
+XGB_DLL int XGBoosterPredictContextFree(PredictContextHandle ctx) {
+  API_BEGIN();
+  delete static_cast<PredictContext*>(ctx);
+  API_END();
+}
+
+XGB_DLL int XGBoosterPredictSingle(BoosterHandle handle,
+                                   PredictContextHandle ctx,
+                                   const unsigned *indices,
+                                   const float *values,
+                                   xgboost::bst_ulong len,
+                                   int option_mask,
+                                   unsigned ntree_limit,
+                                   xgboost::bst_ulong *out_len,
+                                   const bst_float **out_result) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto *bst = static_cast<Booster*>(handle);
+  auto *pctx = static_cast<PredictContext*>(ctx);
+  pctx->row.clear();
+  for (xgboost::bst_ulong i = 0; i < len; ++i) {
+    pctx->row.emplace_back(indices[i], values[i]);
+  }
+  SparsePage::Inst inst(dmlc::BeginPtr(pctx->row),
+                        static_cast<SparsePage::Inst::index_type>(len));
+  bst->learner()->Predict(inst, (option_mask & 1) != 0,
+                          &pctx->ctx, ntree_limit);
+  const std::vector<bst_float>& preds = pctx->ctx.preds.HostVector();
+  *out_result = dmlc::BeginPtr(preds);
+  *out_len = static_cast<xgboost::bst_ulong>(preds.size());
+  API_END();
+}
+
+XGB_DLL int XGBoosterPredictSafe(BoosterHandle handle,
+                                 PredictContextHandle ctx,
+                                 DMatrixHandle dmat,
+                                 int option_mask,
+                                 unsigned ntree_limit,
+                                 xgboost::bst_ulong *out_len,
+                                 const bst_float **out_result) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto *bst = static_cast<Booster*>(handle);
+  auto *pctx = static_cast<PredictContext*>(ctx);
+  // no LazyInit here: context creation configured the booster, and this
+  // entry point must not touch shared booster state
+  bst->learner()->PredictSafe(
+      static_cast<std::shared_ptr<DMatrix>*>(dmat)->get(),
+      (option_mask & 1) != 0,
+      &pctx->ctx, ntree_limit);
+  const std::vector<bst_float>& preds = pctx->ctx.preds.HostVector();
+  *out_result = dmlc::BeginPtr(preds);
+  *out_len = static_cast<xgboost::bst_ulong>(preds.size());
+  API_END();
+}
+
 XGB_DLL int XGBoosterLoadModel(BoosterHandle handle, const char* fname) {
   API_BEGIN();
   CHECK_HANDLE();
@@ -1096,6 +1538,35 @@ XGB_DLL int XGBoosterDumpModelExWithFeatures(BoosterHandle handle,
   API_END();
 }
 
+XGB_DLL int XGBoosterFeatureImportance(BoosterHandle handle,
+                                       const char* importance_type,
+                                       xgboost::bst_ulong* out_len,
+                                       const unsigned** out_features,
+                                       const float** out_scores) {
+  std::vector<unsigned>& features = XGBAPIThreadLocalStore::Get()->ret_vec_uint;
+  std::vector<bst_float>& scores = XGBAPIThreadLocalStore::Get()->ret_vec_float;
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto* bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  bst->learner()->FeatureImportance(importance_type, &features, &scores);
+  *out_len = static_cast<xgboost::bst_ulong>(features.size());
+  *out_features = dmlc::BeginPtr(features);
+  *out_scores = dmlc::BeginPtr(scores);
+  API_END();
+}
+
+XGB_DLL int XGBoosterOptimizeNodeLayout(BoosterHandle handle,
+                                        DMatrixHandle dmat) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto* bst = static_cast<Booster*>(handle);
+  auto* dtr = static_cast<std::shared_ptr<DMatrix>*>(dmat);
+  bst->LazyInit();
+  bst->learner()->OptimizeNodeLayout(dtr->get());
+  API_END();
+}
+
 XGB_DLL int XGBoosterGetAttr(BoosterHandle handle,
                      const char* key,
                      const char** out,
@@ -1146,6 +1617,28 @@ XGB_DLL int XGBoosterGetAttrNames(BoosterHandle handle,
   API_END();
 }
 
+XGB_DLL int XGBProfileDump(const char** out_json) {
+  std::string& ret_str = XGBAPIThreadLocalStore::Get()->ret_str;
+  API_BEGIN();
+  ret_str = xgboost::common::Profiler::Get()->DumpJson();
+  *out_json = ret_str.c_str();
+  API_END();
+}
+
+XGB_DLL int XGBProfileReset() {
+  API_BEGIN();
+  xgboost::common::Profiler::Get()->Reset();
+  API_END();
+}
+
+XGB_DLL int XGBMemoryStatsDump(const char** out_json) {
+  std::string& ret_str = XGBAPIThreadLocalStore::Get()->ret_str;
+  API_BEGIN();
+  ret_str = xgboost::common::MemoryStats::Get()->DumpJson();
+  *out_json = ret_str.c_str();
+  API_END();
+}
+
 XGB_DLL int XGBoosterLoadRabitCheckpoint(BoosterHandle handle,
                                  int* version) {
   API_BEGIN();
@@ -8,6 +8,7 @@
 #ifndef XGBOOST_COMMON_COLUMN_MATRIX_H_
 #define XGBOOST_COMMON_COLUMN_MATRIX_H_
 
+#include <algorithm>
 #include <limits>
 #include <vector>
 #include "hist_util.h"
@@ -24,19 +25,41 @@ enum ColumnType {
 };
 
 /*! \brief a column storage, to be used with ApplySplit. Note that each
-    bin id is stored as index[i] + index_base. */
+    bin id is stored as index[i] + index_base. The element width of the
+    index array is picked per matrix from the widest feature, so consult
+    ElemSize() and read through Index<BinIdxT>() on hot paths; missing
+    entries of dense columns are tracked in a separate bitmap instead of
+    a sentinel value, one bit per row. */
 class Column {
  public:
-  Column(ColumnType type, const uint32_t* index, uint32_t index_base,
+  Column(ColumnType type, const uint8_t* index, size_t elem_size,
+         uint32_t index_base, const uint64_t* missing_bits,
          const size_t* row_ind, size_t len)
       : type_(type),
         index_(index),
+        elem_size_(elem_size),
         index_base_(index_base),
+        missing_bits_(missing_bits),
         row_ind_(row_ind),
         len_(len) {}
   size_t Size() const { return len_; }
-  uint32_t GetGlobalBinIdx(size_t idx) const { return index_base_ + index_[idx]; }
-  uint32_t GetFeatureBinIdx(size_t idx) const { return index_[idx]; }
+  /*! \brief typed view of the index array; BinIdxT must match ElemSize() */
+  template <typename BinIdxT>
+  const BinIdxT* Index() const {
+    return reinterpret_cast<const BinIdxT*>(index_);
+  }
+  /*! \brief width in bytes of one index element */
+  size_t ElemSize() const { return elem_size_; }
+  uint32_t GetGlobalBinIdx(size_t idx) const {
+    return index_base_ + GetFeatureBinIdx(idx);
+  }
+  uint32_t GetFeatureBinIdx(size_t idx) const {
+    switch (elem_size_) {
+      case sizeof(uint8_t): return Index<uint8_t>()[idx];
+      case sizeof(uint16_t): return Index<uint16_t>()[idx];
+      default: return Index<uint32_t>()[idx];
+    }
+  }
   // column.GetFeatureBinIdx(idx) + column.GetBaseIdx(idx) ==
   // column.GetGlobalBinIdx(idx)
   uint32_t GetBaseIdx() const { return index_base_; }
@@ -45,14 +68,20 @@ class Column {
     return type_ == ColumnType::kDenseColumn ? idx : row_ind_[idx];
   }
   bool IsMissing(size_t idx) const {
-    return index_[idx] == std::numeric_limits<uint32_t>::max();
+    return missing_bits_ != nullptr &&
+           ((missing_bits_[idx >> 6] >> (idx & 63)) & 1) != 0;
   }
+  /*! \brief missing bitmap of a dense column, one bit per row in row
+      order; 64 rows per word for bulk scans. nullptr for sparse columns */
+  const uint64_t* MissingBits() const { return missing_bits_; }
   const size_t* GetRowData() const { return row_ind_; }
 
  private:
   ColumnType type_;
-  const uint32_t* index_;
+  const uint8_t* index_;
+  size_t elem_size_;
   uint32_t index_base_;
+  const uint64_t* missing_bits_;
   const size_t* row_ind_;
   const size_t len_;
 };
@@ -77,9 +106,19 @@ class ColumnMatrix {
     type_.resize(nfeature);
     std::fill(feature_counts_.begin(), feature_counts_.end(), 0);
 
-    uint32_t max_val = std::numeric_limits<uint32_t>::max();
+    // per-feature bin ids are stored relative to the feature base, so the
+    // widest feature decides the element width of the whole index array
+    uint32_t max_feature_bins = 0;
     for (bst_uint fid = 0; fid < nfeature; ++fid) {
-      CHECK_LE(gmat.cut.row_ptr[fid + 1] - gmat.cut.row_ptr[fid], max_val);
+      max_feature_bins = std::max(
+          max_feature_bins, gmat.cut.row_ptr[fid + 1] - gmat.cut.row_ptr[fid]);
+    }
+    if (max_feature_bins <= (1U << 8)) {
+      elem_size_ = sizeof(uint8_t);
+    } else if (max_feature_bins <= (1U << 16)) {
+      elem_size_ = sizeof(uint16_t);
+    } else {
+      elem_size_ = sizeof(uint32_t);
     }
 
     gmat.GetFeatureCounts(&feature_counts_[0]);
@@ -96,14 +135,19 @@ class ColumnMatrix {
     // want to compute storage boundary for each feature
     // using variants of prefix sum scan
     boundary_.resize(nfeature);
+    missing_word_begin_.resize(nfeature);
+    const size_t nwords = (nrow + 63) / 64;
     size_t accum_index_ = 0;
     size_t accum_row_ind_ = 0;
+    size_t accum_missing_words_ = 0;
     for (bst_uint fid = 0; fid < nfeature; ++fid) {
       boundary_[fid].index_begin = accum_index_;
       boundary_[fid].row_ind_begin = accum_row_ind_;
+      missing_word_begin_[fid] = accum_missing_words_;
       if (type_[fid] == kDenseColumn) {
         accum_index_ += static_cast<size_t>(nrow);
         accum_row_ind_ += static_cast<size_t>(nrow);
+        accum_missing_words_ += nwords;
       } else {
         accum_index_ += feature_counts_[fid];
         accum_row_ind_ += feature_counts_[fid];
@@ -112,8 +156,12 @@ class ColumnMatrix {
       boundary_[fid].row_ind_end = accum_row_ind_;
     }
 
-    index_.resize(boundary_[nfeature - 1].index_end);
+    index_.resize(boundary_[nfeature - 1].index_end * elem_size_, 0);
     row_ind_.resize(boundary_[nfeature - 1].row_ind_end);
+    // dense columns start fully missing; every written entry clears a bit
+    missing_bits_.clear();
+    missing_bits_.resize(accum_missing_words_,
+                         std::numeric_limits<uint64_t>::max());
 
     // store least bin id for each feature
     index_base_.resize(nfeature);
@@ -121,18 +169,42 @@ class ColumnMatrix {
       index_base_[fid] = gmat.cut.row_ptr[fid];
     }
 
-    // pre-fill index_ for dense columns
-    for (bst_uint fid = 0; fid < nfeature; ++fid) {
-      if (type_[fid] == kDenseColumn) {
-        const size_t ibegin = boundary_[fid].index_begin;
-        uint32_t* begin = &index_[ibegin];
-        uint32_t* end = begin + nrow;
-        std::fill(begin, end, std::numeric_limits<uint32_t>::max());
-        // max() indicates missing values
-      }
+    switch (elem_size_) {
+      case sizeof(uint8_t):
+        this->FillData<uint8_t>(gmat, nrow, nfeature);
+        break;
+      case sizeof(uint16_t):
+        this->FillData<uint16_t>(gmat, nrow, nfeature);
+        break;
+      default:
+        this->FillData<uint32_t>(gmat, nrow, nfeature);
+        break;
     }
+  }
+
+  /* Fetch an individual column. Hot paths should dispatch on ElemSize()
+     once and read the index through Column::Index<BinIdxT>() */
+  inline Column GetColumn(unsigned fid) const {
+    Column c(type_[fid],
+             index_.data() + boundary_[fid].index_begin * elem_size_,
+             elem_size_, index_base_[fid],
+             type_[fid] == kDenseColumn
+                 ? missing_bits_.data() + missing_word_begin_[fid]
+                 : nullptr,
+             dmlc::BeginPtr(row_ind_) + boundary_[fid].row_ind_begin,
+             boundary_[fid].index_end - boundary_[fid].index_begin);
+    return c;
+  }
 
-    // loop over all rows and fill column entries
+  /*! \brief width in bytes of one index element */
+  inline size_t ElemSize() const { return elem_size_; }
+
+ private:
+  // loop over all rows and fill column entries
+  template <typename BinIdxT>
+  inline void FillData(const GHistIndexMatrix& gmat, size_t nrow,
+                       bst_uint nfeature) {
+    auto* index = reinterpret_cast<BinIdxT*>(index_.data());
     // num_nonzeros[fid] = how many nonzeros have this feature accumulated so far?
     std::vector<size_t> num_nonzeros;
     num_nonzeros.resize(nfeature);
@@ -147,11 +219,14 @@ class ColumnMatrix {
           ++fid;
         }
         if (type_[fid] == kDenseColumn) {
-          uint32_t* begin = &index_[boundary_[fid].index_begin];
-          begin[rid] = bin_id - index_base_[fid];
+          BinIdxT* begin = index + boundary_[fid].index_begin;
+          begin[rid] = static_cast<BinIdxT>(bin_id - index_base_[fid]);
+          missing_bits_[missing_word_begin_[fid] + (rid >> 6)] &=
+              ~(uint64_t{1} << (rid & 63));
         } else {
-          uint32_t* begin = &index_[boundary_[fid].index_begin];
-          begin[num_nonzeros[fid]] = bin_id - index_base_[fid];
+          BinIdxT* begin = index + boundary_[fid].index_begin;
+          begin[num_nonzeros[fid]] =
+              static_cast<BinIdxT>(bin_id - index_base_[fid]);
           row_ind_[boundary_[fid].row_ind_begin + num_nonzeros[fid]] = rid;
           ++num_nonzeros[fid];
         }
@@ -159,20 +234,10 @@ class ColumnMatrix {
     }
   }
 
-  /* Fetch an individual column. This code should be used with XGBOOST_TYPE_SWITCH
-     to determine type of bin id's */
-  inline Column GetColumn(unsigned fid) const {
-    Column c(type_[fid], &index_[boundary_[fid].index_begin], index_base_[fid],
-             &row_ind_[boundary_[fid].row_ind_begin],
-             boundary_[fid].index_end - boundary_[fid].index_begin);
-    return c;
-  }
-
- private:
   struct ColumnBoundary {
     // indicate where each column's index and row_ind is stored.
     // index_begin and index_end are logical offsets, so they should be converted to
-    // actual offsets by scaling with packing_factor_
+    // actual offsets by scaling with elem_size_
     size_t index_begin;
     size_t index_end;
     size_t row_ind_begin;
@@ -181,9 +246,14 @@ class ColumnMatrix {
 
   std::vector<size_t> feature_counts_;
   std::vector<ColumnType> type_;
-  std::vector<uint32_t> index_;  // index_: may store smaller integers; needs padding
+  std::vector<uint8_t> index_;  // bin ids packed at elem_size_ bytes each
   std::vector<size_t> row_ind_;
   std::vector<ColumnBoundary> boundary_;
+  // missing bitmaps of the dense columns, each column word-aligned so that
+  // consumers can scan 64 rows per word
+  std::vector<uint64_t> missing_bits_;
+  std::vector<size_t> missing_word_begin_;
+  size_t elem_size_{sizeof(uint32_t)};
 
   // index_base_[fid]: least bin id for feature fid
   std::vector<uint32_t> index_base_;
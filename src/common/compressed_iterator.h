@@ -158,6 +158,56 @@ class CompressedBufferWriter {
       buffer_position++;
     }
   }
+
+  /**
+   * \brief Write a run of symbols starting at an arbitrary symbol offset.
+   *
+   * Like Write, packs the symbols through a 64-bit staging word, but the run
+   * does not have to start at the beginning of the buffer, so a buffer can be
+   * filled in batches. The partial bytes at either end of the run are merged
+   * with the bits already present, preserving neighbouring symbols.
+   */
+  template <typename IterT>
+  void WriteBatch(CompressedByteT *buffer, IterT input_begin, IterT input_end,
+                  size_t offset) {
+    const int bits_per_byte = 8;
+    size_t bit_idx = offset * symbol_bits_;
+    size_t byte_idx = bit_idx / bits_per_byte + detail::kPadding;
+    // preserve the bits of the first byte that belong to preceding symbols
+    int stored_bits = static_cast<int>(bit_idx % bits_per_byte);
+    uint64_t tmp = buffer[byte_idx] >> (bits_per_byte - stored_bits);
+    const int symbol_bits = static_cast<int>(symbol_bits_);
+    const int max_stored_bits = 64 - symbol_bits;
+    const size_t num_symbols = input_end - input_begin;
+    for (size_t i = 0; i < num_symbols; i++) {
+      if (stored_bits > max_stored_bits) {
+        // Eject only full bytes
+        int tmp_bytes = stored_bits / bits_per_byte;
+        for (int j = 0; j < tmp_bytes; j++) {
+          buffer[byte_idx++] = static_cast<CompressedByteT>(
+              tmp >> (stored_bits - (j + 1) * bits_per_byte));
+        }
+        stored_bits -= tmp_bytes * bits_per_byte;
+        tmp &= (uint64_t(1) << stored_bits) - 1;
+      }
+      // Store symbol
+      tmp <<= symbol_bits;
+      tmp |= input_begin[i];
+      stored_bits += symbol_bits;
+    }
+
+    // Eject the remaining full bytes, then merge the trailing partial byte
+    // with the bits already present
+    while (stored_bits >= bits_per_byte) {
+      stored_bits -= bits_per_byte;
+      buffer[byte_idx++] = static_cast<CompressedByteT>(tmp >> stored_bits);
+    }
+    if (stored_bits > 0) {
+      int pad = bits_per_byte - stored_bits;
+      buffer[byte_idx] = static_cast<CompressedByteT>(
+          (tmp << pad) | (buffer[byte_idx] & ((1u << pad) - 1)));
+    }
+  }
 };
 
 template <typename T>
@@ -218,6 +268,37 @@ class CompressedIterator {
     offset.offset_ += idx;
     return *offset;
   }
+
+  /**
+   * \brief Decode a contiguous run of symbols [begin, begin + count) into dst.
+   *
+   * Keeps the compressed stream in a rolling 64-bit window instead of
+   * gathering five bytes per symbol like operator*, so bulk decompression of
+   * the quantized matrix runs close to memory speed and the loop body is
+   * simple enough for the compiler to pipeline.
+   */
+  void Decode(T *dst, size_t begin, size_t count) const {
+    if (count == 0) { return; }
+    const int bits_per_byte = 8;
+    size_t bit_idx = begin * symbol_bits_;
+    size_t byte_idx = bit_idx / bits_per_byte + detail::kPadding;
+    // bits of the first byte that belong to preceding symbols
+    const int skip = static_cast<int>(bit_idx % bits_per_byte);
+    uint64_t window = buffer_[byte_idx++];
+    int window_bits = bits_per_byte - skip;
+    window &= (uint64_t(1) << window_bits) - 1;
+    const int symbol_bits = static_cast<int>(symbol_bits_);
+    for (size_t i = 0; i < count; ++i) {
+      while (window_bits < symbol_bits) {
+        window = (window << bits_per_byte) | buffer_[byte_idx++];
+        window_bits += bits_per_byte;
+      }
+      window_bits -= symbol_bits;
+      // only valid bits are kept in the window, no masking required
+      dst[i] = static_cast<T>(window >> window_bits);
+      window &= (uint64_t(1) << window_bits) - 1;
+    }
+  }
 };
 }  // namespace common
 }  // namespace xgboost
@@ -2,10 +2,12 @@
  * Copyright 2017 XGBoost contributors
  */
 #pragma once
+#include <thrust/device_malloc_allocator.h>
 #include <thrust/device_ptr.h>
 #include <thrust/device_vector.h>
 #include <thrust/system/cuda/error.h>
 #include <thrust/system_error.h>
+#include <dmlc/parameter.h>
 #include <xgboost/logging.h>
 
 #include "common.h"
@@ -13,12 +15,18 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <ctime>
 #include <cub/cub.cuh>
+#include <map>
+#include <mutex>
 #include <numeric>
 #include <sstream>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
+#include "memory_stats.h"
 #include "timer.h"
 
 #ifdef XGBOOST_USE_NCCL
@@ -224,6 +232,411 @@ inline void LaunchN(int device_idx, size_t n, L lambda) {
 
 enum MemoryType { kDevice, kDeviceManaged };
 
+/**
+ * \class DeviceMemoryArena
+ *
+ * \brief Process-wide caching arena for device memory. Small allocations
+ * are rounded up to power-of-two size classes, large ones only to the
+ * driver's slab granularity; freed blocks go to a per-device free list
+ * instead of cudaFree, so steady-state loops stop paying the implicit
+ * device synchronization of cudaMalloc/cudaFree. When a block is freed an
+ * event is recorded on its device's default stream -- where this codebase
+ * launches its kernels -- and reuse waits on that event, which replaces
+ * the ordering cudaFree used to provide. When cudaMalloc runs out of
+ * memory the cached blocks are handed back to the driver and the
+ * allocation retried; ReleaseAll() purges them explicitly.
+ */
+class DeviceMemoryArena {
+ public:
+  static DeviceMemoryArena &Instance() {
+    static DeviceMemoryArena arena;
+    return arena;
+  }
+
+  void *Allocate(int device_idx, size_t bytes) {
+    if (bytes == 0) {
+      return nullptr;
+    }
+    const size_t size_class = SizeClass(bytes);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &free_list = free_blocks_[{device_idx, size_class}];
+    Block block;
+    if (!free_list.empty()) {
+      block = free_list.back();
+      free_list.pop_back();
+      // make sure work in flight on the previous owner's stream has drained
+      safe_cuda(cudaEventSynchronize(block.ready));
+    } else {
+      int saved_device;
+      safe_cuda(cudaGetDevice(&saved_device));
+      safe_cuda(cudaSetDevice(device_idx));
+      cudaError_t status = cudaMalloc(&block.ptr, size_class);
+      if (status == cudaErrorMemoryAllocation) {
+        // under memory pressure the cached blocks are worth less than
+        // the new allocation: purge them all and retry before failing
+        cudaGetLastError();  // clear the sticky error state
+        this->ReleaseAllUnlocked();
+        status = cudaMalloc(&block.ptr, size_class);
+      }
+      safe_cuda(status);
+      safe_cuda(cudaEventCreateWithFlags(&block.ready,
+                                         cudaEventDisableTiming));
+      safe_cuda(cudaSetDevice(saved_device));
+    }
+    block.device_idx = device_idx;
+    block.size_class = size_class;
+    live_blocks_[block.ptr] = block;
+    return block.ptr;
+  }
+
+  void Free(void *ptr) {
+    if (ptr == nullptr) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = live_blocks_.find(ptr);
+    CHECK(it != live_blocks_.end()) << "DeviceMemoryArena: unknown pointer";
+    Block block = it->second;
+    live_blocks_.erase(it);
+    int saved_device;
+    safe_cuda(cudaGetDevice(&saved_device));
+    safe_cuda(cudaSetDevice(block.device_idx));
+    safe_cuda(cudaEventRecord(block.ready, nullptr));
+    safe_cuda(cudaSetDevice(saved_device));
+    free_blocks_[{block.device_idx, block.size_class}].push_back(block);
+  }
+
+  /*! \brief hand all cached blocks back to the driver */
+  void ReleaseAll() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    this->ReleaseAllUnlocked();
+  }
+
+ private:
+  void ReleaseAllUnlocked() {
+    int saved_device;
+    safe_cuda(cudaGetDevice(&saved_device));
+    for (auto &kv : free_blocks_) {
+      for (Block &block : kv.second) {
+        safe_cuda(cudaSetDevice(block.device_idx));
+        safe_cuda(cudaEventDestroy(block.ready));
+        safe_cuda(cudaFree(block.ptr));
+      }
+    }
+    free_blocks_.clear();
+    safe_cuda(cudaSetDevice(saved_device));
+  }
+
+  struct Block {
+    void *ptr{nullptr};
+    int device_idx{-1};
+    size_t size_class{0};
+    cudaEvent_t ready{nullptr};
+  };
+
+  DeviceMemoryArena() = default;
+  // cached blocks are deliberately not freed here: the destructor of a
+  // function-local static may run after the CUDA runtime has shut down,
+  // and the driver reclaims device memory at process exit anyway
+  ~DeviceMemoryArena() = default;
+
+  static size_t SizeClass(size_t bytes) {
+    // power-of-two classes give good reuse across the many small
+    // transient allocations, but would waste up to 2x on the
+    // multi-gigabyte bulk blocks; large requests round to the driver's
+    // 2MB slab granularity instead, bounding the overhead at one slab
+    constexpr size_t kLargeThreshold = 16ULL << 20;
+    constexpr size_t kLargeGranularity = 2ULL << 20;
+    if (bytes > kLargeThreshold) {
+      return (bytes + kLargeGranularity - 1) / kLargeGranularity *
+             kLargeGranularity;
+    }
+    size_t rounded = 256;
+    while (rounded < bytes) {
+      rounded <<= 1;
+    }
+    return rounded;
+  }
+
+  std::map<std::pair<int, size_t>, std::vector<Block>> free_blocks_;
+  std::unordered_map<void *, Block> live_blocks_;
+  std::mutex mutex_;
+};
+
+/**
+ * \brief Thrust-compatible allocator backed by DeviceMemoryArena, for
+ * device vectors that are repeatedly created and destroyed (e.g. the
+ * per-batch staging buffers of the GPU sketcher).
+ */
+template <typename T>
+struct ArenaAllocator : thrust::device_malloc_allocator<T> {
+  using pointer = thrust::device_ptr<T>;  // NOLINT
+
+  pointer allocate(size_t n) {  // NOLINT
+    int device;
+    safe_cuda(cudaGetDevice(&device));
+    return pointer(static_cast<T *>(
+        DeviceMemoryArena::Instance().Allocate(device, n * sizeof(T))));
+  }
+
+  void deallocate(pointer p, size_t n) {  // NOLINT
+    DeviceMemoryArena::Instance().Free(p.get());
+  }
+};
+
+/*! \brief device vector whose storage is recycled through the arena */
+template <typename T>
+using ArenaVector = thrust::device_vector<T, ArenaAllocator<T>>;
+
+/**
+ * \class PinnedMemoryPool
+ *
+ * \brief Process-wide pool of pinned host buffers used to stage transfers
+ * between pageable host memory and the device. Pinned memory is a shared
+ * machine resource, so the pool is capped through the
+ * XGBOOST_PINNED_POOL_MB environment variable (default 256; 0 disables
+ * staging entirely). Acquire returns nullptr when the cap would be
+ * exceeded and callers fall back to a plain pageable copy. Buffers must
+ * not be released while transfers through them are still in flight.
+ */
+class PinnedMemoryPool {
+ public:
+  static PinnedMemoryPool &Instance() {
+    static PinnedMemoryPool pool;
+    return pool;
+  }
+
+  void *Acquire(size_t bytes) {
+    if (bytes == 0) {
+      return nullptr;
+    }
+    const size_t size_class = SizeClass(bytes);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &free_list = free_blocks_[size_class];
+    void *ptr;
+    if (!free_list.empty()) {
+      ptr = free_list.back();
+      free_list.pop_back();
+    } else {
+      if (allocated_bytes_ + size_class > CapBytes()) {
+        return nullptr;
+      }
+      if (cudaMallocHost(&ptr, size_class) != cudaSuccess) {
+        cudaGetLastError();  // clear the sticky error and fall back
+        return nullptr;
+      }
+      allocated_bytes_ += size_class;
+    }
+    live_blocks_[ptr] = size_class;
+    return ptr;
+  }
+
+  void Release(void *ptr) {
+    if (ptr == nullptr) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = live_blocks_.find(ptr);
+    CHECK(it != live_blocks_.end()) << "PinnedMemoryPool: unknown pointer";
+    free_blocks_[it->second].push_back(ptr);
+    live_blocks_.erase(it);
+  }
+
+ private:
+  PinnedMemoryPool() = default;
+  // like the device arena, cached buffers are reclaimed by the driver at
+  // process exit rather than freed after CUDA runtime shutdown
+  ~PinnedMemoryPool() = default;
+
+  static size_t CapBytes() {
+    static const size_t kCapBytes = static_cast<size_t>(
+        dmlc::GetEnv("XGBOOST_PINNED_POOL_MB", 256)) << 20;
+    return kCapBytes;
+  }
+
+  static size_t SizeClass(size_t bytes) {
+    size_t rounded = 4096;
+    while (rounded < bytes) {
+      rounded <<= 1;
+    }
+    return rounded;
+  }
+
+  std::map<size_t, std::vector<void *>> free_blocks_;
+  std::unordered_map<void *, size_t> live_blocks_;
+  size_t allocated_bytes_{0};
+  std::mutex mutex_;
+};
+
+/*
+ * Staged copies between pageable host memory and the current device.
+ * Routing through a pinned chunk reaches full PCIe bandwidth, and with
+ * two chunks the host-side memcpy of one overlaps the DMA of the other.
+ * Both helpers are synchronous on return, like the plain cudaMemcpy they
+ * replace, and degrade to it when the pinned pool is exhausted.
+ */
+inline void StagedCopyHostToDevice(void *dst, const void *src, size_t bytes) {
+  constexpr size_t kChunkBytes = 4 << 20;
+  PinnedMemoryPool &pool = PinnedMemoryPool::Instance();
+  const size_t chunk = bytes < kChunkBytes ? bytes : kChunkBytes;
+  char *staging[2] = {static_cast<char *>(pool.Acquire(chunk)), nullptr};
+  if (staging[0] == nullptr) {
+    safe_cuda(cudaMemcpy(dst, src, bytes, cudaMemcpyHostToDevice));
+    return;
+  }
+  if (bytes > kChunkBytes) {
+    staging[1] = static_cast<char *>(pool.Acquire(chunk));
+  }
+  const size_t n_buffers = staging[1] != nullptr ? 2 : 1;
+  cudaEvent_t events[2];
+  for (size_t k = 0; k < n_buffers; ++k) {
+    safe_cuda(cudaEventCreateWithFlags(&events[k], cudaEventDisableTiming));
+  }
+  for (size_t i = 0, offset = 0; offset < bytes; ++i, offset += chunk) {
+    const size_t k = i % n_buffers;
+    const size_t len = std::min(chunk, bytes - offset);
+    if (i >= n_buffers) {
+      // wait until the slot's previous chunk has been consumed by DMA
+      safe_cuda(cudaEventSynchronize(events[k]));
+    }
+    std::memcpy(staging[k], static_cast<const char *>(src) + offset, len);
+    safe_cuda(cudaMemcpyAsync(static_cast<char *>(dst) + offset, staging[k],
+                              len, cudaMemcpyHostToDevice, nullptr));
+    safe_cuda(cudaEventRecord(events[k], nullptr));
+  }
+  safe_cuda(cudaStreamSynchronize(nullptr));
+  for (size_t k = 0; k < n_buffers; ++k) {
+    safe_cuda(cudaEventDestroy(events[k]));
+    pool.Release(staging[k]);
+  }
+}
+
+inline void StagedCopyDeviceToHost(void *dst, const void *src, size_t bytes) {
+  constexpr size_t kChunkBytes = 4 << 20;
+  PinnedMemoryPool &pool = PinnedMemoryPool::Instance();
+  const size_t chunk = bytes < kChunkBytes ? bytes : kChunkBytes;
+  char *staging[2] = {static_cast<char *>(pool.Acquire(chunk)), nullptr};
+  if (staging[0] == nullptr) {
+    safe_cuda(cudaMemcpy(dst, src, bytes, cudaMemcpyDeviceToHost));
+    return;
+  }
+  if (bytes > kChunkBytes) {
+    staging[1] = static_cast<char *>(pool.Acquire(chunk));
+  }
+  const size_t n_buffers = staging[1] != nullptr ? 2 : 1;
+  cudaEvent_t events[2];
+  for (size_t k = 0; k < n_buffers; ++k) {
+    safe_cuda(cudaEventCreateWithFlags(&events[k], cudaEventDisableTiming));
+  }
+  size_t drain_offset = 0;
+  for (size_t i = 0, offset = 0; offset < bytes; ++i, offset += chunk) {
+    const size_t k = i % n_buffers;
+    const size_t len = std::min(chunk, bytes - offset);
+    safe_cuda(cudaMemcpyAsync(staging[k], static_cast<const char *>(src) + offset,
+                              len, cudaMemcpyDeviceToHost, nullptr));
+    safe_cuda(cudaEventRecord(events[k], nullptr));
+    if (i + 1 >= n_buffers) {
+      // drain the oldest in-flight chunk while the next DMA proceeds
+      const size_t p = (i + 1) % n_buffers;
+      const size_t drain_len = std::min(chunk, bytes - drain_offset);
+      safe_cuda(cudaEventSynchronize(events[p]));
+      std::memcpy(static_cast<char *>(dst) + drain_offset, staging[p], drain_len);
+      drain_offset += drain_len;
+    }
+  }
+  while (drain_offset < bytes) {
+    const size_t i = drain_offset / chunk;
+    const size_t drain_len = std::min(chunk, bytes - drain_offset);
+    safe_cuda(cudaEventSynchronize(events[i % n_buffers]));
+    std::memcpy(static_cast<char *>(dst) + drain_offset,
+                staging[i % n_buffers], drain_len);
+    drain_offset += drain_len;
+  }
+  for (size_t k = 0; k < n_buffers; ++k) {
+    safe_cuda(cudaEventDestroy(events[k]));
+    pool.Release(staging[k]);
+  }
+}
+
+/**
+ * \class DeviceCopyStreamPool
+ *
+ * \brief Process-wide cache of one asynchronous copy stream per device.
+ * Copies issued on these streams neither wait for nor block kernels on the
+ * default streams, so per-device segment copies of a sharded vector can all
+ * be in flight at once. Streams are created on first use on the calling
+ * thread's current device, so callers must have set the device, and live
+ * for the rest of the process like the pinned pool above.
+ */
+class DeviceCopyStreamPool {
+ public:
+  static DeviceCopyStreamPool &Instance() {
+    static DeviceCopyStreamPool pool;
+    return pool;
+  }
+
+  cudaStream_t Get(int device) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = streams_.find(device);
+    if (it != streams_.end()) {
+      return it->second;
+    }
+    cudaStream_t stream;
+    safe_cuda(cudaStreamCreateWithFlags(&stream, cudaStreamNonBlocking));
+    streams_[device] = stream;
+    return stream;
+  }
+
+ private:
+  DeviceCopyStreamPool() = default;
+
+  std::mutex mutex_;
+  std::map<int, cudaStream_t> streams_;
+};
+
+/**
+ * \class MemcpyBatch
+ *
+ * \brief Collects copies touching several devices, issues each
+ * asynchronously on its device's copy stream and waits for all of them
+ * through one event barrier, so a multi-GPU scatter or gather costs the
+ * largest segment rather than the sum of all segments. Add is thread safe;
+ * the caller must have set the device before calling it, and source and
+ * destination of every job must stay valid until Wait returns. Copies from
+ * pageable host memory degrade to synchronous issue, as plain
+ * cudaMemcpyAsync does.
+ */
+class MemcpyBatch {
+ public:
+  void Add(void *dst, const void *src, size_t bytes, int device) {
+    if (bytes == 0) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    cudaStream_t stream = DeviceCopyStreamPool::Instance().Get(device);
+    safe_cuda(cudaMemcpyAsync(dst, src, bytes, cudaMemcpyDefault, stream));
+    cudaEvent_t event;
+    safe_cuda(cudaEventCreateWithFlags(&event, cudaEventDisableTiming));
+    safe_cuda(cudaEventRecord(event, stream));
+    events_.push_back(event);
+  }
+
+  void Wait() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (cudaEvent_t event : events_) {
+      safe_cuda(cudaEventSynchronize(event));
+      safe_cuda(cudaEventDestroy(event));
+    }
+    events_.clear();
+  }
+
+  ~MemcpyBatch() { Wait(); }
+
+ private:
+  std::mutex mutex_;
+  std::vector<cudaEvent_t> events_;
+};
+
 template <MemoryType MemoryT>
 class BulkAllocator;
 template <typename T>
@@ -389,6 +802,13 @@ class DVec2 {
   T *other() { return buff_.Alternate(); }
 };
 
+/*! \brief MemoryStats component shared by all bulk device allocations */
+inline xgboost::common::MemoryStats::Component *DeviceBuffersComponent() {
+  static auto *component =
+      xgboost::common::MemoryStats::Get()->GetComponent("DeviceBuffers");
+  return component;
+}
+
 /*! \brief Helper for allocating large block of memory. */
 template <MemoryType MemoryT>
 class BulkAllocator {
@@ -429,10 +849,9 @@ class BulkAllocator {
   }
 
   char *AllocateDevice(int device_idx, size_t bytes, MemoryType t) {
-    char *ptr;
     safe_cuda(cudaSetDevice(device_idx));
-    safe_cuda(cudaMalloc(&ptr, bytes));
-    return ptr;
+    return static_cast<char *>(
+        DeviceMemoryArena::Instance().Allocate(device_idx, bytes));
   }
   template <typename T>
   size_t GetSizeBytes(DVec2<T> *first_vec, size_t first_size) {
@@ -472,8 +891,8 @@ class BulkAllocator {
   ~BulkAllocator() {
     for (size_t i = 0; i < d_ptr_.size(); i++) {
       if (!(d_ptr_[i] == nullptr)) {
-        safe_cuda(cudaSetDevice(device_idx_[i]));
-        safe_cuda(cudaFree(d_ptr_[i]));
+        DeviceMemoryArena::Instance().Free(d_ptr_[i]);
+        DeviceBuffersComponent()->Sub(static_cast<int64_t>(size_[i]));
         d_ptr_[i] = nullptr;
       }
     }
@@ -495,6 +914,7 @@ class BulkAllocator {
     d_ptr_.push_back(ptr);
     size_.push_back(size);
     device_idx_.push_back(device_idx);
+    DeviceBuffersComponent()->Add(static_cast<int64_t>(size));
   }
 };
 
@@ -518,14 +938,18 @@ struct CubMemory {
 
   void Free() {
     if (this->IsAllocated()) {
-      safe_cuda(cudaFree(d_temp_storage));
+      DeviceMemoryArena::Instance().Free(d_temp_storage);
+      d_temp_storage = nullptr;
+      temp_storage_bytes = 0;
     }
   }
 
   void LazyAllocate(size_t num_bytes) {
     if (num_bytes > temp_storage_bytes) {
       Free();
-      safe_cuda(cudaMalloc(&d_temp_storage, num_bytes));
+      int device;
+      safe_cuda(cudaGetDevice(&device));
+      d_temp_storage = DeviceMemoryArena::Instance().Allocate(device, num_bytes);
       temp_storage_bytes = num_bytes;
     }
   }
@@ -852,6 +1276,7 @@ class AllReducer {
 #ifdef XGBOOST_USE_NCCL
   std::vector<ncclComm_t> comms;
   std::vector<cudaStream_t> streams;
+  std::vector<cudaEvent_t> events;
   std::vector<int> device_ordinals;
 #endif
 
@@ -877,9 +1302,15 @@ class AllReducer {
                                   static_cast<int>(device_ordinals.size()),
                                   device_ordinals.data()));
     streams.resize(device_ordinals.size());
+    events.resize(device_ordinals.size());
     for (size_t i = 0; i < device_ordinals.size(); i++) {
       safe_cuda(cudaSetDevice(device_ordinals[i]));
-      safe_cuda(cudaStreamCreate(&streams[i]));
+      // non-blocking streams: collectives run concurrently with kernels on
+      // the default stream; ordering against producers is established
+      // explicitly through WaitForDefaultStreams(), and consumers must
+      // Synchronize() before reading reduced buffers
+      safe_cuda(cudaStreamCreateWithFlags(&streams[i], cudaStreamNonBlocking));
+      safe_cuda(cudaEventCreateWithFlags(&events[i], cudaEventDisableTiming));
     }
     initialised_ = true;
 #else
@@ -893,6 +1324,9 @@ class AllReducer {
       for (auto &stream : streams) {
         dh::safe_cuda(cudaStreamDestroy(stream));
       }
+      for (auto &event : events) {
+        dh::safe_cuda(cudaEventDestroy(event));
+      }
       for (auto &comm : comms) {
         ncclCommDestroy(comm);
       }
@@ -905,6 +1339,26 @@ class AllReducer {
 #endif
   }
 
+  /**
+   * \fn  void WaitForDefaultStreams()
+   *
+   * \brief Makes each device's communication stream wait on all work
+   * submitted to that device's default stream so far. The communication
+   * streams are non-blocking, so this event ordering is what sequences a
+   * collective after the kernels producing its input; it does not block
+   * the host.
+   */
+  void WaitForDefaultStreams() {
+#ifdef XGBOOST_USE_NCCL
+    CHECK(initialised_);
+    for (size_t i = 0; i < device_ordinals.size(); i++) {
+      safe_cuda(cudaSetDevice(device_ordinals[i]));
+      safe_cuda(cudaEventRecord(events[i], nullptr));
+      safe_cuda(cudaStreamWaitEvent(streams[i], events[i], 0));
+    }
+#endif
+  }
+
   /**
    * \brief Use in exactly the same way as ncclGroupStart
    */
@@ -14,6 +14,9 @@
 #ifndef XGBOOST_COMMON_GROUP_DATA_H_
 #define XGBOOST_COMMON_GROUP_DATA_H_
 
+#include <dmlc/omp.h>
+
+#include <algorithm>
 #include <vector>
 
 namespace xgboost {
@@ -72,18 +75,41 @@ struct ParallelGroupBuilder {
         rptr_.resize(thread_rptr_[tid].size() + 1);
       }
     }
-    // initialize rptr to be beginning of each segment
+    const size_t nkeys = rptr_.size() == 0 ? 0 : rptr_.size() - 1;
+    const size_t nthread = thread_rptr_.size();
+    // pass 1 (parallel over keys): total count of each key into rptr_
+    #pragma omp parallel for schedule(static)
+    for (omp_ulong i = 0; i < static_cast<omp_ulong>(nkeys); ++i) {
+      size_t ncnt = 0;
+      for (size_t tid = 0; tid < nthread; ++tid) {
+        const std::vector<SizeType> &trptr = thread_rptr_[tid];
+        if (i < trptr.size()) ncnt += trptr[i];
+      }
+      rptr_[i + 1] = ncnt;
+    }
+    // serial exclusive scan over the keys, O(nkeys) instead of the
+    // former O(nkeys * nthread) serial merge
     size_t start = 0;
-    for (size_t i = 0; i + 1 < rptr_.size(); ++i) {
-      for (size_t tid = 0; tid < thread_rptr_.size(); ++tid) {
+    for (size_t i = 0; i < nkeys; ++i) {
+      const size_t ncnt = rptr_[i + 1];
+      rptr_[i + 1] = start;
+      start += ncnt;
+    }
+    // pass 2 (parallel over keys): rewrite the per-thread counts into
+    // write cursors, laid out thread after thread within each key so
+    // every thread pushes to its own contiguous segment
+    #pragma omp parallel for schedule(static)
+    for (omp_ulong i = 0; i < static_cast<omp_ulong>(nkeys); ++i) {
+      size_t cursor = rptr_[i + 1];
+      for (size_t tid = 0; tid < nthread; ++tid) {
         std::vector<SizeType> &trptr = thread_rptr_[tid];
         if (i < trptr.size()) {
-          size_t ncnt = trptr[i];
-          trptr[i] = start;
-          start += ncnt;
+          const size_t ncnt = trptr[i];
+          trptr[i] = cursor;
+          cursor += ncnt;
         }
       }
-      rptr_[i + 1] = start;
+      rptr_[i + 1] = cursor;
     }
     data_.resize(start);
   }
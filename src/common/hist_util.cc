@@ -6,7 +6,13 @@
  */
 #include <rabit/rabit.h>
 #include <dmlc/omp.h>
+#include <dmlc/parameter.h>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <mutex>
 #include <numeric>
+#include <unordered_map>
 #include <vector>
 
 #include "./random.h"
@@ -23,52 +29,205 @@
   #define PREFETCH_READ_T0(addr) do {} while (0)
 #endif
 
+#if (defined(__x86_64__) || defined(_M_X64)) && defined(__GNUC__)
+  #define XGBOOST_HIST_KERNEL_X86 1
+  #include <immintrin.h>
+#endif
+
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+#define XGBOOST_USE_MMAP_BIN_INDEX 1
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // !defined(_WIN32) && !defined(__CYGWIN__)
+
 namespace xgboost {
 namespace common {
 
-void HistCutMatrix::Init(DMatrix* p_fmat, uint32_t max_num_bins) {
+namespace {
+std::mutex& GHistIndexRegistryMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+std::unordered_map<const DMatrix*, std::weak_ptr<const GHistIndexMatrix>>&
+GHistIndexRegistry() {
+  static std::unordered_map<const DMatrix*,
+                            std::weak_ptr<const GHistIndexMatrix>> registry;
+  return registry;
+}
+}  // anonymous namespace
+
+void PublishGHistIndex(const DMatrix* dmat,
+                       const std::shared_ptr<const GHistIndexMatrix>& gmat) {
+  std::lock_guard<std::mutex> lock(GHistIndexRegistryMutex());
+  auto& registry = GHistIndexRegistry();
+  // drop entries whose matrices are gone; the registry stays as small as
+  // the number of live quantized matrices
+  for (auto it = registry.begin(); it != registry.end();) {
+    if (it->second.expired()) {
+      it = registry.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  registry[dmat] = gmat;
+}
+
+std::shared_ptr<const GHistIndexMatrix> LookupGHistIndex(const DMatrix* dmat) {
+  std::lock_guard<std::mutex> lock(GHistIndexRegistryMutex());
+  auto& registry = GHistIndexRegistry();
+  auto it = registry.find(dmat);
+  if (it == registry.end()) {
+    return nullptr;
+  }
+  return it->second.lock();
+}
+
+BinIndexBuffer::~BinIndexBuffer() {
+  this->FreeMapping();
+}
+
+void BinIndexBuffer::SetFileBacking(const std::string& dir) {
+#ifdef XGBOOST_USE_MMAP_BIN_INDEX
+  CHECK_EQ(nbytes_, 0U) << "SetFileBacking must be called before Resize";
+  backing_dir_ = dir;
+  file_backed_ = true;
+#else
+  LOG(CONSOLE) << "file-backed bin index is not supported on this platform, "
+               << "keeping the quantized matrix in memory";
+#endif  // XGBOOST_USE_MMAP_BIN_INDEX
+}
+
+void BinIndexBuffer::ResizeMapped(size_t nbytes) {
+#ifdef XGBOOST_USE_MMAP_BIN_INDEX
+  this->FreeMapping();
+  nbytes_ = nbytes;
+  if (nbytes == 0) return;
+  std::string tmpl = backing_dir_ + "/xgboost-bin-index.XXXXXX";
+  std::vector<char> fname(tmpl.begin(), tmpl.end());
+  fname.push_back('\0');
+  int fd = mkstemp(fname.data());
+  CHECK_NE(fd, -1)
+      << "cannot create bin index spill file in \"" << backing_dir_ << "\"";
+  // unlink right away: the mapping keeps the blocks alive, and the file
+  // cannot leak if the process dies before the destructor runs
+  unlink(fname.data());
+  int err = ftruncate(fd, static_cast<off_t>(nbytes));
+  if (err != 0) {
+    close(fd);
+    LOG(FATAL) << "cannot grow bin index spill file to " << nbytes
+               << " bytes in \"" << backing_dir_ << "\"";
+  }
+  void* addr = mmap(nullptr, nbytes, PROT_READ | PROT_WRITE,
+                    MAP_SHARED, fd, 0);
+  close(fd);
+  CHECK(addr != MAP_FAILED) << "cannot map bin index spill file";
+  mapped_ = static_cast<uint8_t*>(addr);
+  mapped_size_ = nbytes;
+#else
+  LOG(FATAL) << "file-backed bin index is not supported on this platform";
+#endif  // XGBOOST_USE_MMAP_BIN_INDEX
+}
+
+void BinIndexBuffer::FreeMapping() {
+#ifdef XGBOOST_USE_MMAP_BIN_INDEX
+  if (mapped_ != nullptr) {
+    munmap(mapped_, mapped_size_);
+    mapped_ = nullptr;
+    mapped_size_ = 0;
+  }
+#endif  // XGBOOST_USE_MMAP_BIN_INDEX
+}
+
+void HistCutMatrix::Init(DMatrix* p_fmat, uint32_t max_num_bins,
+                         std::vector<size_t>* p_row_ptr) {
   const MetaInfo& info = p_fmat->Info();
+  if (p_row_ptr != nullptr) {
+    p_row_ptr->clear();
+    p_row_ptr->reserve(info.num_row_ + 1);
+    p_row_ptr->push_back(0);
+  }
 
   // safe factor for better accuracy
   constexpr int kFactor = 8;
+  const double eps = 1.0 / (max_num_bins * kFactor);
   std::vector<WXQSketch> sketchs;
 
   const int nthread = omp_get_max_threads();
-
-  auto nstep = static_cast<unsigned>((info.num_col_ + nthread - 1) / nthread);
-  auto ncol = static_cast<unsigned>(info.num_col_);
+  auto ncol = static_cast<bst_omp_uint>(info.num_col_);
   sketchs.resize(info.num_col_);
   for (auto& s : sketchs) {
-    s.Init(info.num_row_, 1.0 / (max_num_bins * kFactor));
+    s.Init(info.num_row_, eps);
+  }
+
+  // per-thread private sketches built over disjoint row ranges; every
+  // thread owns a copy of each feature so the push loop needs no
+  // synchronization and the whole batch is scanned exactly once
+  std::vector<std::vector<WXQSketch>> tsketchs(nthread);
+  for (auto& ts : tsketchs) {
+    ts.resize(info.num_col_);
+    for (auto& s : ts) {
+      s.Init(info.num_row_, eps);
+    }
   }
 
   const auto& weights = info.weights_.HostVector();
   for (const auto &batch : p_fmat->GetRowBatches()) {
-    #pragma omp parallel num_threads(nthread)
-    {
-      CHECK_EQ(nthread, omp_get_num_threads());
-      auto tid = static_cast<unsigned>(omp_get_thread_num());
-      unsigned begin = std::min(nstep * tid, ncol);
-      unsigned end = std::min(nstep * (tid + 1), ncol);
-      // do not iterate if no columns are assigned to the thread
-      if (begin < end && end <= ncol) {
-        for (size_t i = 0; i < batch.Size(); ++i) { // NOLINT(*)
-          size_t ridx = batch.base_rowid + i;
-          SparsePage::Inst inst = batch[i];
-          for (auto& ins : inst) {
-            if (ins.index >= begin && ins.index < end) {
-              sketchs[ins.index].Push(ins.fvalue,
-                                      weights.size() > 0 ? weights[ridx] : 1.0f);
-            }
-          }
-        }
+    // record the row layout while the page is resident, fusing it with
+    // the sketch sweep
+    if (p_row_ptr != nullptr) {
+      for (size_t i = 0; i < batch.Size(); ++i) {
+        p_row_ptr->push_back(batch[i].size() + p_row_ptr->back());
+      }
+    }
+    const auto bsize = static_cast<omp_ulong>(batch.Size());
+    #pragma omp parallel for num_threads(nthread) schedule(static)
+    for (omp_ulong i = 0; i < bsize; ++i) { // NOLINT(*)
+      const int tid = omp_get_thread_num();
+      const size_t ridx = batch.base_rowid + i;
+      const bst_float w = weights.size() > 0 ? weights[ridx] : 1.0f;
+      SparsePage::Inst inst = batch[i];
+      for (auto& ins : inst) {
+        tsketchs[tid][ins.index].Push(ins.fvalue, w);
       }
     }
   }
 
+  // merge the partial sketches of each feature; features are independent
+  // so the merge parallelizes over columns, and the per-thread summaries
+  // are combined in a balanced tournament instead of a sequential chain
+  #pragma omp parallel for num_threads(nthread) schedule(dynamic)
+  for (bst_omp_uint fid = 0; fid < ncol; ++fid) {
+    std::vector<WXQSketch::SummaryContainer> summaries(nthread);
+    std::vector<WXQSketch::Summary> views;
+    for (int tid = 0; tid < nthread; ++tid) {
+      tsketchs[tid][fid].GetSummary(&summaries[tid]);
+      // release the per-thread sketch as soon as it is consumed
+      tsketchs[tid][fid] = WXQSketch();
+      if (summaries[tid].size != 0) {
+        views.emplace_back(summaries[tid].data, summaries[tid].size);
+      }
+    }
+    if (!views.empty()) {
+      WXQSketch::SummaryContainer merged;
+      merged.SetMerge(dmlc::BeginPtr(views), dmlc::BeginPtr(views) + views.size());
+      sketchs[fid].PushSummary(merged);
+    }
+  }
+
   Init(&sketchs, max_num_bins);
 }
 
+// opt-in: distribute the global bin budget across features by the size of
+// their sketch summaries instead of giving every feature max_num_bins
+static bool HistAdaptiveBins() {
+  static const bool kAdaptive =
+      dmlc::GetEnv("XGBOOST_HIST_ADAPTIVE_BINS", 0) != 0;
+  return kAdaptive;
+}
+
 void HistCutMatrix::Init
 (std::vector<WXQSketch>* in_sketchs, uint32_t max_num_bins) {
   std::vector<WXQSketch>& sketchs = *in_sketchs;
@@ -86,12 +245,38 @@ void HistCutMatrix::Init
   size_t nbytes = WXQSketch::SummaryContainer::CalcMemCost(max_num_bins * kFactor);
   sreducer.Allreduce(dmlc::BeginPtr(summary_array), nbytes, summary_array.size());
 
+  // per-feature bin budget; uniform unless adaptive allocation is enabled
+  std::vector<uint32_t> bin_budget(summary_array.size(), max_num_bins);
+  if (HistAdaptiveBins() && !summary_array.empty()) {
+    /* the pruned summary size is a capped distinct-value estimate: it
+       collapses to the value count for near-constant features and
+       saturates for high-cardinality ones. Weighting features by the log
+       of that estimate and scaling to the global budget hands the bins of
+       constant-ish features to the rich ones, shrinking the total bin
+       count (and with it every histogram row) without raising any
+       feature above the requested resolution */
+    std::vector<double> weight(summary_array.size());
+    double wsum = 0.0;
+    for (size_t fid = 0; fid < summary_array.size(); ++fid) {
+      weight[fid] = std::log2(1.0 + static_cast<double>(summary_array[fid].size));
+      wsum += weight[fid];
+    }
+    if (wsum > 0.0) {
+      const double budget =
+          static_cast<double>(max_num_bins) * summary_array.size();
+      for (size_t fid = 0; fid < summary_array.size(); ++fid) {
+        auto b = static_cast<uint32_t>(budget * weight[fid] / wsum);
+        bin_budget[fid] = std::max(2U, std::min(b, max_num_bins));
+      }
+    }
+  }
+
   this->min_val.resize(sketchs.size());
   row_ptr.push_back(0);
   for (size_t fid = 0; fid < summary_array.size(); ++fid) {
     WXQSketch::SummaryContainer a;
-    a.Reserve(max_num_bins);
-    a.SetPrune(summary_array[fid], max_num_bins);
+    a.Reserve(bin_budget[fid]);
+    a.SetPrune(summary_array[fid], bin_budget[fid]);
     const bst_float mval = a.data[0].value;
     this->min_val[fid] = mval - (fabs(mval) + 1e-5);
     if (a.size > 1 && a.size <= 16) {
@@ -133,48 +318,175 @@ uint32_t HistCutMatrix::GetBinIdx(const Entry& e) {
   return idx;
 }
 
+// features with at most this many cut points are quantized with the
+// branch-free linear search below instead of std::upper_bound
+static constexpr uint32_t kLinearSearchMaxCuts = 64;
+
+// branch-free bin search: accumulate the comparison result against every
+// cut of the feature. The loop has no data-dependent branches and
+// vectorizes, so for small cut counts it is faster than binary search,
+// whose mispredicted branches dominate the quantization sweep
+static inline uint32_t SearchBinLinear(const bst_float* cuts, uint32_t ncuts,
+                                       bst_float v) {
+  uint32_t off = 0;
+  for (uint32_t k = 0; k < ncuts; ++k) {
+    off += static_cast<uint32_t>(cuts[k] <= v);
+  }
+  return off < ncuts ? off : ncuts - 1;
+}
+
+// quantize one row batch into bin indices of the requested width
+template <typename BinIdxT>
+static void FillBinIndices(const SparsePage& batch, size_t rbegin,
+                           const std::vector<size_t>& row_ptr,
+                           HistCutMatrix* p_cut, BinIdxT* index,
+                           size_t* hit_count_tloc, uint32_t nbins,
+                           int nthread) {
+  const bst_float* cut_values = dmlc::BeginPtr(p_cut->cut);
+  const uint32_t* cut_ptr = dmlc::BeginPtr(p_cut->row_ptr);
+  auto bsize = static_cast<omp_ulong>(batch.Size());
+  #pragma omp parallel for num_threads(nthread) schedule(static)
+  for (omp_ulong i = 0; i < bsize; ++i) { // NOLINT(*)
+    const int tid = omp_get_thread_num();
+    size_t ibegin = row_ptr[rbegin + i];
+    size_t iend = row_ptr[rbegin + i + 1];
+    SparsePage::Inst inst = batch[i];
+
+    CHECK_EQ(ibegin + inst.size(), iend);
+    for (bst_uint j = 0; j < inst.size(); ++j) {
+      const Entry& e = inst[j];
+      const uint32_t cbegin = cut_ptr[e.index];
+      const uint32_t cend = cut_ptr[e.index + 1];
+      const uint32_t ncuts = cend - cbegin;
+      uint32_t idx;
+      if (ncuts <= kLinearSearchMaxCuts) {
+        idx = cbegin + SearchBinLinear(cut_values + cbegin, ncuts, e.fvalue);
+      } else {
+        const bst_float* it = std::upper_bound(cut_values + cbegin,
+                                               cut_values + cend, e.fvalue);
+        idx = static_cast<uint32_t>(it - cut_values);
+        if (idx == cend) --idx;
+      }
+
+      index[ibegin + j] = static_cast<BinIdxT>(idx);
+      ++hit_count_tloc[tid * nbins + idx];
+    }
+    std::sort(index + ibegin, index + iend);
+  }
+}
+
 void GHistIndexMatrix::Init(DMatrix* p_fmat, int max_num_bins) {
-  cut.Init(p_fmat, max_num_bins);
+  // the sketch sweep also records the row layout, so the quantization
+  // sweep below fills a buffer allocated once up front; for external
+  // memory matrices both sweeps then stream pages straight from the
+  // prefetcher without growing/copying the index in between
+  cut.Init(p_fmat, max_num_bins, &row_ptr);
+  this->BuildIndex(p_fmat);
+}
 
+void GHistIndexMatrix::Init(DMatrix* p_fmat, const HistCutMatrix& cuts) {
+  cut = cuts;
+  row_ptr.clear();
+  row_ptr.push_back(0);
+  for (const auto& batch : p_fmat->GetRowBatches()) {
+    for (size_t i = 0; i < batch.Size(); ++i) {
+      row_ptr.push_back(row_ptr.back() + batch[i].size());
+    }
+  }
+  this->BuildIndex(p_fmat);
+}
+
+void GHistIndexMatrix::BuildIndex(DMatrix* p_fmat) {
   const int nthread = omp_get_max_threads();
   const uint32_t nbins = cut.row_ptr.back();
-  hit_count.resize(nbins, 0);
-  hit_count_tloc_.resize(nthread * nbins, 0);
+  hit_count.assign(nbins, 0);
+  hit_count_tloc_.assign(nthread * nbins, 0);
+  index.SetNumBins(nbins);
+  // on external-memory matrices the quantized index is the only full-data
+  // structure hist training keeps resident; back it with a disk file so
+  // the OS pages it in and out instead of the allocation failing once the
+  // dataset outgrows memory. XGBOOST_HIST_INDEX_ON_DISK overrides the
+  // default either way; the spill file lives next to the page cache.
+  const bool spill_index = dmlc::GetEnv(
+      "XGBOOST_HIST_INDEX_ON_DISK", p_fmat->SingleColBlock() ? 0 : 1) != 0;
+  if (spill_index) {
+    index.SetFileBacking(
+        dmlc::GetEnv("XGBOOST_HIST_INDEX_SPILL_DIR", std::string(".")));
+  }
+  index.Resize(row_ptr.back());
 
-  row_ptr.push_back(0);
+  CHECK_GT(cut.cut.size(), 0U);
+  CHECK_EQ(cut.row_ptr.back(), cut.cut.size());
+
+  size_t rbegin = 0;
   for (const auto &batch : p_fmat->GetRowBatches()) {
-    const size_t rbegin = row_ptr.size() - 1;
-    for (size_t i = 0; i < batch.Size(); ++i) {
-      row_ptr.push_back(batch[i].size() + row_ptr.back());
+    switch (index.ElemSize()) {
+      case sizeof(uint8_t):
+        FillBinIndices(batch, rbegin, row_ptr, &cut, index.Data<uint8_t>(),
+                       hit_count_tloc_.data(), nbins, nthread);
+        break;
+      case sizeof(uint16_t):
+        FillBinIndices(batch, rbegin, row_ptr, &cut, index.Data<uint16_t>(),
+                       hit_count_tloc_.data(), nbins, nthread);
+        break;
+      default:
+        FillBinIndices(batch, rbegin, row_ptr, &cut, index.Data<uint32_t>(),
+                       hit_count_tloc_.data(), nbins, nthread);
+        break;
     }
-    index.resize(row_ptr.back());
+    rbegin += batch.Size();
+  }
 
-    CHECK_GT(cut.cut.size(), 0U);
-    CHECK_EQ(cut.row_ptr.back(), cut.cut.size());
+  #pragma omp parallel for num_threads(nthread) schedule(static)
+  for (bst_omp_uint idx = 0; idx < bst_omp_uint(nbins); ++idx) {
+    for (int tid = 0; tid < nthread; ++tid) {
+      hit_count[idx] += hit_count_tloc_[tid * nbins + idx];
+    }
+  }
+}
 
-    auto bsize = static_cast<omp_ulong>(batch.Size());
-    #pragma omp parallel for num_threads(nthread) schedule(static)
-    for (omp_ulong i = 0; i < bsize; ++i) { // NOLINT(*)
-      const int tid = omp_get_thread_num();
-      size_t ibegin = row_ptr[rbegin + i];
-      size_t iend = row_ptr[rbegin + i + 1];
-      SparsePage::Inst inst = batch[i];
+void GHistIndexMatrix::Init(const GHistIndexMatrix& parent,
+                            const std::vector<bst_uint>& ridx) {
+  cut = parent.cut;
 
-      CHECK_EQ(ibegin + inst.size(), iend);
-      for (bst_uint j = 0; j < inst.size(); ++j) {
-        uint32_t idx = cut.GetBinIdx(inst[j]);
+  const int nthread = omp_get_max_threads();
+  const uint32_t nbins = cut.row_ptr.back();
+  hit_count.assign(nbins, 0);
+  hit_count_tloc_.assign(nthread * nbins, 0);
+
+  row_ptr.resize(ridx.size() + 1);
+  row_ptr[0] = 0;
+  for (size_t i = 0; i < ridx.size(); ++i) {
+    const bst_uint r = ridx[i];
+    CHECK_LT(r + 1, parent.row_ptr.size());
+    row_ptr[i + 1] = row_ptr[i] + (parent.row_ptr[r + 1] - parent.row_ptr[r]);
+  }
 
-        index[ibegin + j] = idx;
-        ++hit_count_tloc_[tid * nbins + idx];
-      }
-      std::sort(index.begin() + ibegin, index.begin() + iend);
+  index.SetNumBins(nbins);
+  index.Resize(row_ptr.back());
+  CHECK_EQ(index.ElemSize(), parent.index.ElemSize());
+  const size_t elem_size = index.ElemSize();
+  const auto* src = static_cast<const uint8_t*>(parent.index.RawData());
+  auto* dst = index.Data<uint8_t>();
+
+  const auto nrows = static_cast<bst_omp_uint>(ridx.size());
+  #pragma omp parallel for num_threads(nthread) schedule(static)
+  for (bst_omp_uint i = 0; i < nrows; ++i) {
+    const int tid = omp_get_thread_num();
+    const bst_uint r = ridx[i];
+    const size_t ibegin = parent.row_ptr[r];
+    const size_t iend = parent.row_ptr[r + 1];
+    std::memcpy(dst + row_ptr[i] * elem_size, src + ibegin * elem_size,
+                (iend - ibegin) * elem_size);
+    for (size_t j = ibegin; j < iend; ++j) {
+      ++hit_count_tloc_[tid * nbins + parent.index[j]];
     }
+  }
 
-    #pragma omp parallel for num_threads(nthread) schedule(static)
-    for (bst_omp_uint idx = 0; idx < bst_omp_uint(nbins); ++idx) {
-      for (int tid = 0; tid < nthread; ++tid) {
-        hit_count[idx] += hit_count_tloc_[tid * nbins + idx];
-      }
+  #pragma omp parallel for num_threads(nthread) schedule(static)
+  for (bst_omp_uint idx = 0; idx < bst_omp_uint(nbins); ++idx) {
+    for (int tid = 0; tid < nthread; ++tid) {
+      hit_count[idx] += hit_count_tloc_[tid * nbins + idx];
     }
   }
 }
@@ -185,7 +497,7 @@ static size_t GetConflictCount(const std::vector<bool>& mark,
   size_t ret = 0;
   if (column.GetType() == xgboost::common::kDenseColumn) {
     for (size_t i = 0; i < column.Size(); ++i) {
-      if (column.GetFeatureBinIdx(i) != std::numeric_limits<uint32_t>::max() && mark[i]) {
+      if (!column.IsMissing(i) && mark[i]) {
         ++ret;
         if (ret > max_cnt) {
           return max_cnt + 1;
@@ -210,7 +522,7 @@ MarkUsed(std::vector<bool>* p_mark, const Column& column) {
   std::vector<bool>& mark = *p_mark;
   if (column.GetType() == xgboost::common::kDenseColumn) {
     for (size_t i = 0; i < column.Size(); ++i) {
-      if (column.GetFeatureBinIdx(i) != std::numeric_limits<uint32_t>::max()) {
+      if (!column.IsMissing(i)) {
         mark[i] = true;
       }
     }
@@ -404,63 +716,399 @@ void GHistIndexBlockMatrix::Init(const GHistIndexMatrix& gmat,
   }
 }
 
+/*
+ * Tuning knobs for the BuildHist gather loop. The defaults work well on
+ * common server parts; both can be overridden through the environment for
+ * unusual cache hierarchies.
+ */
+static size_t HistPrefetchDistance() {
+  static const size_t kDistance = static_cast<size_t>(
+      dmlc::GetEnv("XGBOOST_HIST_PREFETCH_DISTANCE", 10));
+  return kDistance;
+}
+
+static size_t HistRowBlockSize() {
+  static const size_t kBlockSize = static_cast<size_t>(
+      dmlc::GetEnv("XGBOOST_HIST_ROW_BLOCK_SIZE", 512));
+  return kBlockSize;
+}
+
+bool HistNumaAware() {
+  static const bool kNumaAware =
+      dmlc::GetEnv("XGBOOST_HIST_NUMA_AWARE", 0) != 0;
+  return kNumaAware;
+}
+
+/*
+ * IEEE 754 binary16 conversion used by the compressed gradient path.
+ * Gradients of the common objectives are far inside the half range; the
+ * packer still saturates at +-65504 so an outlier degrades gracefully
+ * instead of turning the histogram sums into infinities.
+ */
+static inline uint16_t FloatToHalf(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  const uint32_t sign = (bits >> 16) & 0x8000U;
+  bits &= 0x7fffffffU;
+  if (bits > 0x7f800000U) {  // NaN
+    return static_cast<uint16_t>(sign | 0x7e00U);
+  }
+  if (bits >= 0x477ff000U) {  // would round past the half range: saturate
+    return static_cast<uint16_t>(sign | 0x7bffU);
+  }
+  if (bits < 0x38800000U) {  // subnormal half or zero
+    const uint32_t mant = (bits & 0x7fffffU) | 0x800000U;
+    const int shift = 113 - static_cast<int>(bits >> 23);
+    if (bits == 0 || shift > 24) {
+      return static_cast<uint16_t>(sign);
+    }
+    uint32_t half = mant >> (shift + 13);
+    const uint32_t rem = mant & ((1U << (shift + 13)) - 1);
+    const uint32_t halfway = 1U << (shift + 12);
+    if (rem > halfway || (rem == halfway && (half & 1U))) ++half;
+    return static_cast<uint16_t>(sign | half);
+  }
+  // normal case, round to nearest even; a rounding carry correctly
+  // propagates into the exponent field
+  uint32_t half = sign | (((bits >> 23) - 112) << 10) | ((bits >> 13) & 0x3ffU);
+  const uint32_t rem = bits & 0x1fffU;
+  if (rem > 0x1000U || (rem == 0x1000U && (half & 1U))) ++half;
+  return static_cast<uint16_t>(half);
+}
+
+static inline float HalfToFloat(uint16_t h) {
+  const uint32_t sign = static_cast<uint32_t>(h & 0x8000U) << 16;
+  uint32_t exp = (h >> 10) & 0x1fU;
+  uint32_t mant = h & 0x3ffU;
+  uint32_t bits;
+  if (exp == 0U) {
+    if (mant == 0U) {
+      bits = sign;
+    } else {  // subnormal half: normalize into a float
+      exp = 113U;
+      while ((mant & 0x400U) == 0U) {
+        mant <<= 1;
+        --exp;
+      }
+      bits = sign | (exp << 23) | ((mant & 0x3ffU) << 13);
+    }
+  } else if (exp == 31U) {  // inf/NaN
+    bits = sign | 0x7f800000U | (mant << 13);
+  } else {
+    bits = sign | ((exp + 112U) << 23) | (mant << 13);
+  }
+  float out;
+  std::memcpy(&out, &bits, sizeof(out));
+  return out;
+}
+
+// per-element gradient load, overloaded on the storage type
+static inline double LoadGrad(float v) { return v; }
+static inline double LoadGrad(uint16_t v) { return HalfToFloat(v); }
+
+/*
+ * Kernels for the hot gather-accumulate loop of BuildHist.
+ * Each kernel accumulates gradient pairs of rows [istart, iend) into an
+ * interleaved (sum_grad, sum_hess) histogram buffer. Since grad and hess of
+ * a bin are adjacent doubles, one bin update is a single 128-bit vector add;
+ * the vector kernels exploit this without changing the GHistEntry layout
+ * shared with split evaluation. GradT is the gradient storage type: plain
+ * float, or uint16_t holding packed binary16 when gradient compression
+ * is enabled. RowIdxT is the row index width of the caller's
+ * RowSetCollectionT instantiation. When kGradByPos is set the gradient
+ * buffer was physically reordered into partition order and is read
+ * sequentially by position i, so it needs no gather and no prefetch.
+ */
+template <typename BinIdxT, typename GradT, typename RowIdxT, bool kGradByPos>
+static void BuildHistKernelScalar(const RowIdxT* rid,
+                                  size_t istart, size_t iend, size_t nrows,
+                                  const size_t* row_ptr, const void* index_data,
+                                  const void* pgh_data, double* hist_data) {
+  const BinIdxT* index = static_cast<const BinIdxT*>(index_data);
+  const GradT* pgh = static_cast<const GradT*>(pgh_data);
+  const size_t cache_line_size = 64;
+  const size_t prefetch_offset = HistPrefetchDistance();
+  // row_ptr and gpair run ahead of the index row, so that by the time the
+  // bin indices of a row are requested its row_ptr entry is already cached
+  const size_t prefetch_far = 2 * prefetch_offset;
+  size_t no_prefetch_size = prefetch_far + cache_line_size/sizeof(*rid);
+  no_prefetch_size = no_prefetch_size > nrows ? nrows : no_prefetch_size;
+
+  for (size_t i = istart; i < iend; ++i) {
+    const size_t icol_start = row_ptr[rid[i]];
+    const size_t icol_end = row_ptr[rid[i]+1];
+
+    if (i < nrows - no_prefetch_size) {
+      PREFETCH_READ_T0(row_ptr + rid[i + prefetch_far]);
+      if (!kGradByPos) {
+        PREFETCH_READ_T0(pgh + 2*rid[i + prefetch_far]);
+      }
+      PREFETCH_READ_T0(index + row_ptr[rid[i + prefetch_offset]]);
+    }
+
+    // decode (grad, hess) of the row once, outside of the bin loop
+    const size_t idx_gh = kGradByPos ? 2*i : 2*rid[i];
+    const double g = LoadGrad(pgh[idx_gh]);
+    const double h = LoadGrad(pgh[idx_gh+1]);
+
+    for (size_t j = icol_start; j < icol_end; ++j) {
+      const uint32_t idx_bin = 2*static_cast<uint32_t>(index[j]);
+
+      hist_data[idx_bin] += g;
+      hist_data[idx_bin+1] += h;
+    }
+  }
+}
+
+#if defined(XGBOOST_HIST_KERNEL_X86)
+template <typename BinIdxT, typename RowIdxT, bool kGradByPos>
+__attribute__((target("avx2")))
+static void BuildHistKernelAvx2(const RowIdxT* rid,
+                                size_t istart, size_t iend, size_t nrows,
+                                const size_t* row_ptr, const void* index_data,
+                                const void* pgh_data, double* hist_data) {
+  const BinIdxT* index = static_cast<const BinIdxT*>(index_data);
+  const float* pgh = static_cast<const float*>(pgh_data);
+  const size_t cache_line_size = 64;
+  const size_t prefetch_offset = HistPrefetchDistance();
+  const size_t prefetch_far = 2 * prefetch_offset;
+  size_t no_prefetch_size = prefetch_far + cache_line_size/sizeof(*rid);
+  no_prefetch_size = no_prefetch_size > nrows ? nrows : no_prefetch_size;
+
+  for (size_t i = istart; i < iend; ++i) {
+    const size_t icol_start = row_ptr[rid[i]];
+    const size_t icol_end = row_ptr[rid[i]+1];
+
+    if (i < nrows - no_prefetch_size) {
+      PREFETCH_READ_T0(row_ptr + rid[i + prefetch_far]);
+      if (!kGradByPos) {
+        PREFETCH_READ_T0(pgh + 2*rid[i + prefetch_far]);
+      }
+      PREFETCH_READ_T0(index + row_ptr[rid[i + prefetch_offset]]);
+    }
+
+    // widen (grad, hess) of the row to double once per row
+    const __m128d gh = _mm_cvtps_pd(_mm_castsi128_ps(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(
+            pgh + (kGradByPos ? 2*i : 2*rid[i])))));
+
+    for (size_t j = icol_start; j < icol_end; ++j) {
+      double* bin = hist_data + 2*static_cast<uint32_t>(index[j]);
+      _mm_storeu_pd(bin, _mm_add_pd(_mm_loadu_pd(bin), gh));
+    }
+  }
+}
+
+template <typename BinIdxT, typename RowIdxT, bool kGradByPos>
+__attribute__((target("avx2,f16c")))
+static void BuildHistKernelAvx2Half(const RowIdxT* rid,
+                                    size_t istart, size_t iend, size_t nrows,
+                                    const size_t* row_ptr, const void* index_data,
+                                    const void* pgh_data, double* hist_data) {
+  const BinIdxT* index = static_cast<const BinIdxT*>(index_data);
+  const uint16_t* pgh = static_cast<const uint16_t*>(pgh_data);
+  const size_t cache_line_size = 64;
+  const size_t prefetch_offset = HistPrefetchDistance();
+  const size_t prefetch_far = 2 * prefetch_offset;
+  size_t no_prefetch_size = prefetch_far + cache_line_size/sizeof(*rid);
+  no_prefetch_size = no_prefetch_size > nrows ? nrows : no_prefetch_size;
+
+  for (size_t i = istart; i < iend; ++i) {
+    const size_t icol_start = row_ptr[rid[i]];
+    const size_t icol_end = row_ptr[rid[i]+1];
+
+    if (i < nrows - no_prefetch_size) {
+      PREFETCH_READ_T0(row_ptr + rid[i + prefetch_far]);
+      if (!kGradByPos) {
+        PREFETCH_READ_T0(pgh + 2*rid[i + prefetch_far]);
+      }
+      PREFETCH_READ_T0(index + row_ptr[rid[i + prefetch_offset]]);
+    }
+
+    // one F16C instruction expands the packed (grad, hess) to float,
+    // then widen to double once per row as in the uncompressed kernel
+    uint32_t packed;
+    std::memcpy(&packed, pgh + (kGradByPos ? 2*i : 2*rid[i]), sizeof(packed));
+    const __m128d gh = _mm_cvtps_pd(
+        _mm_cvtph_ps(_mm_cvtsi32_si128(static_cast<int>(packed))));
+
+    for (size_t j = icol_start; j < icol_end; ++j) {
+      double* bin = hist_data + 2*static_cast<uint32_t>(index[j]);
+      _mm_storeu_pd(bin, _mm_add_pd(_mm_loadu_pd(bin), gh));
+    }
+  }
+}
+#endif  // defined(XGBOOST_HIST_KERNEL_X86)
+
+/* Kernels for merging per-thread partial histograms: dst[i] += src[i]. */
+static void ReduceHistKernelScalar(double* dst, const double* src,
+                                   size_t istart, size_t iend) {
+  for (size_t i = istart; i < iend; ++i) {
+    dst[i] += src[i];
+  }
+}
+
+#if defined(XGBOOST_HIST_KERNEL_X86)
+__attribute__((target("avx2")))
+static void ReduceHistKernelAvx2(double* dst, const double* src,
+                                 size_t istart, size_t iend) {
+  size_t i = istart;
+  for (; i + 4 <= iend; i += 4) {
+    _mm256_storeu_pd(dst + i,
+                     _mm256_add_pd(_mm256_loadu_pd(dst + i),
+                                   _mm256_loadu_pd(src + i)));
+  }
+  for (; i < iend; ++i) {
+    dst[i] += src[i];
+  }
+}
+#endif  // defined(XGBOOST_HIST_KERNEL_X86)
+
+template <typename RowIdxT>
+using BuildHistKernelFn = void (*)(const RowIdxT*, size_t, size_t, size_t,
+                                   const size_t*, const void*,
+                                   const void*, double*);
+using ReduceHistKernelFn = void (*)(double*, const double*, size_t, size_t);
+
+// pick the widest kernel the executing CPU supports for the bin index width
+// and gradient storage at hand; the CPU feature probes are resolved once
+// per process. kGradByPos selects the variant reading physically
+// reordered gradients by position
+template <typename RowIdxT, bool kGradByPos>
+static BuildHistKernelFn<RowIdxT> ChooseBuildHistKernelImpl(
+    size_t bin_elem_size, bool compressed_gpair) {
+#if defined(XGBOOST_HIST_KERNEL_X86)
+  static const bool kUseAvx2 = __builtin_cpu_supports("avx2");
+  static const bool kUseF16c = __builtin_cpu_supports("f16c");
+  if (compressed_gpair && kUseAvx2 && kUseF16c) {
+    switch (bin_elem_size) {
+      case sizeof(uint8_t): return BuildHistKernelAvx2Half<uint8_t, RowIdxT, kGradByPos>;
+      case sizeof(uint16_t): return BuildHistKernelAvx2Half<uint16_t, RowIdxT, kGradByPos>;
+      default: return BuildHistKernelAvx2Half<uint32_t, RowIdxT, kGradByPos>;
+    }
+  }
+  if (!compressed_gpair && kUseAvx2) {
+    switch (bin_elem_size) {
+      case sizeof(uint8_t): return BuildHistKernelAvx2<uint8_t, RowIdxT, kGradByPos>;
+      case sizeof(uint16_t): return BuildHistKernelAvx2<uint16_t, RowIdxT, kGradByPos>;
+      default: return BuildHistKernelAvx2<uint32_t, RowIdxT, kGradByPos>;
+    }
+  }
+#endif
+  if (compressed_gpair) {
+    switch (bin_elem_size) {
+      case sizeof(uint8_t): return BuildHistKernelScalar<uint8_t, uint16_t, RowIdxT, kGradByPos>;
+      case sizeof(uint16_t): return BuildHistKernelScalar<uint16_t, uint16_t, RowIdxT, kGradByPos>;
+      default: return BuildHistKernelScalar<uint32_t, uint16_t, RowIdxT, kGradByPos>;
+    }
+  }
+  switch (bin_elem_size) {
+    case sizeof(uint8_t): return BuildHistKernelScalar<uint8_t, float, RowIdxT, kGradByPos>;
+    case sizeof(uint16_t): return BuildHistKernelScalar<uint16_t, float, RowIdxT, kGradByPos>;
+    default: return BuildHistKernelScalar<uint32_t, float, RowIdxT, kGradByPos>;
+  }
+}
+
+template <typename RowIdxT>
+static BuildHistKernelFn<RowIdxT> ChooseBuildHistKernel(
+    size_t bin_elem_size, bool compressed_gpair, bool grad_by_position) {
+  return grad_by_position
+      ? ChooseBuildHistKernelImpl<RowIdxT, true>(bin_elem_size, compressed_gpair)
+      : ChooseBuildHistKernelImpl<RowIdxT, false>(bin_elem_size, compressed_gpair);
+}
+
+static ReduceHistKernelFn ChooseReduceHistKernel() {
+#if defined(XGBOOST_HIST_KERNEL_X86)
+  if (__builtin_cpu_supports("avx2")) {
+    return ReduceHistKernelAvx2;
+  }
+#endif
+  return ReduceHistKernelScalar;
+}
+
+template <typename RowSetElemT>
 void GHistBuilder::BuildHist(const std::vector<GradientPair>& gpair,
-                             const RowSetCollection::Elem row_indices,
+                             const RowSetElemT row_indices,
                              const GHistIndexMatrix& gmat,
                              GHistRow hist) {
+  using RowIdxT = typename RowSetElemT::IndexT;
+  const BuildHistKernelFn<RowIdxT> kBuildKernel =
+      ChooseBuildHistKernel<RowIdxT>(gmat.index.ElemSize(),
+                                     use_compressed_grads_,
+                                     use_reordered_grads_);
+  static const ReduceHistKernelFn kReduceKernel = ChooseReduceHistKernel();
+
   const size_t nthread = static_cast<size_t>(this->nthread_);
-  data_.resize(nbins_ * nthread_);
+  if (partials_size_ < 2 * nbins_ * nthread) {
+    partials_.reset(new double[2 * nbins_ * nthread]);
+    partials_size_ = 2 * nbins_ * nthread;
+  }
 
-  const size_t* rid =  row_indices.begin;
+  const RowIdxT* rid =  row_indices.begin;
   const size_t nrows = row_indices.Size();
-  const uint32_t* index = gmat.index.data();
+  const void* index = gmat.index.RawData();
   const size_t* row_ptr =  gmat.row_ptr.data();
-  const float* pgh = reinterpret_cast<const float*>(gpair.data());
+  const void* pgh;
+  if (use_reordered_grads_) {
+    // advance to this node's slice of the partition-ordered copy, so the
+    // positional kernels index it from zero
+    const size_t offset = static_cast<size_t>(
+        rid - static_cast<const RowIdxT*>(reorder_base_));
+    pgh = use_compressed_grads_
+        ? static_cast<const void*>(gpair_half_pos_.data() + 2 * offset)
+        : static_cast<const void*>(gpair_pos_.data() + 2 * offset);
+  } else {
+    pgh = use_compressed_grads_
+        ? static_cast<const void*>(gpair_half_.data())
+        : static_cast<const void*>(gpair.data());
+  }
 
   double* hist_data = reinterpret_cast<double*>(hist.begin);
-  double* data = reinterpret_cast<double*>(data_.data());
+  double* data = partials_.get();
 
-  const size_t block_size = 512;
+  const size_t block_size = HistRowBlockSize();
   size_t n_blocks = nrows/block_size;
   n_blocks += !!(nrows - n_blocks*block_size);
 
   const size_t nthread_to_process = std::min(nthread,  n_blocks);
   memset(thread_init_.data(), '\0', nthread_to_process*sizeof(size_t));
 
-  const size_t cache_line_size = 64;
-  const size_t prefetch_offset = 10;
-  size_t no_prefetch_size = prefetch_offset + cache_line_size/sizeof(*rid);
-  no_prefetch_size = no_prefetch_size > nrows ? nrows : no_prefetch_size;
-
-  #pragma omp parallel for num_threads(nthread_to_process) schedule(guided)
-  for (bst_omp_uint iblock = 0; iblock < n_blocks; iblock++) {
-    dmlc::omp_uint tid = omp_get_thread_num();
-    double* data_local_hist = ((nthread_to_process == 1) ? hist_data :
-            reinterpret_cast<double*>(data_.data() + tid * nbins_));
-
-    if (!thread_init_[tid]) {
-      memset(data_local_hist, '\0', 2*nbins_*sizeof(double));
-      thread_init_[tid] = true;
+  if (HistNumaAware() && nthread_to_process > 1) {
+    /* one contiguous range of row blocks per thread, identical on every
+       call: with pinned threads each socket re-reads the rows whose index,
+       gradient and row set pages it first-touched and accumulates into its
+       node-local partial, so only the reduction below crosses sockets */
+    #pragma omp parallel num_threads(nthread_to_process)
+    {
+      const size_t tid = static_cast<size_t>(omp_get_thread_num());
+      const size_t blk_begin = n_blocks * tid / nthread_to_process;
+      const size_t blk_end = n_blocks * (tid + 1) / nthread_to_process;
+      if (blk_begin < blk_end) {
+        double* data_local_hist = data + 2 * tid * nbins_;
+        memset(data_local_hist, '\0', 2*nbins_*sizeof(double));
+        thread_init_[tid] = true;
+
+        const size_t istart = blk_begin * block_size;
+        const size_t iend =
+            ((blk_end * block_size > nrows) ? nrows : blk_end * block_size);
+        kBuildKernel(rid, istart, iend, nrows, row_ptr, index, pgh, data_local_hist);
+      }
     }
+  } else {
+    #pragma omp parallel for num_threads(nthread_to_process) schedule(guided)
+    for (bst_omp_uint iblock = 0; iblock < n_blocks; iblock++) {
+      dmlc::omp_uint tid = omp_get_thread_num();
+      double* data_local_hist = ((nthread_to_process == 1) ? hist_data :
+              data + 2 * tid * nbins_);
 
-    const size_t istart = iblock*block_size;
-    const size_t iend = (((iblock+1)*block_size > nrows) ? nrows : istart + block_size);
-    for (size_t i = istart; i < iend; ++i) {
-      const size_t icol_start = row_ptr[rid[i]];
-      const size_t icol_end = row_ptr[rid[i]+1];
-
-      if (i < nrows - no_prefetch_size) {
-        PREFETCH_READ_T0(row_ptr + rid[i + prefetch_offset]);
-        PREFETCH_READ_T0(pgh + 2*rid[i + prefetch_offset]);
+      if (!thread_init_[tid]) {
+        memset(data_local_hist, '\0', 2*nbins_*sizeof(double));
+        thread_init_[tid] = true;
       }
 
-      for (size_t j = icol_start; j < icol_end; ++j) {
-        const uint32_t idx_bin = 2*index[j];
-        const size_t idx_gh = 2*rid[i];
-
-        data_local_hist[idx_bin] += pgh[idx_gh];
-        data_local_hist[idx_bin+1] += pgh[idx_gh+1];
-      }
+      const size_t istart = iblock*block_size;
+      const size_t iend = (((iblock+1)*block_size > nrows) ? nrows : istart + block_size);
+      kBuildKernel(rid, istart, iend, nrows, row_ptr, index, pgh, data_local_hist);
     }
   }
 
@@ -477,26 +1125,155 @@ void GHistBuilder::BuildHist(const std::vector<GradientPair>& gpair,
       }
     }
 
-    #pragma omp parallel for num_threads(std::min(nthread, n_blocks)) schedule(guided)
+    /* pairwise tree reduction over the worked partials: ceil(log2(n)) passes,
+       each pass fully parallel over (pair, bin-block) tasks, so finalization
+       scales with cores instead of sweeping all partials under one block */
+    size_t n_active = n_worked_bins;
+    while (n_active > 1) {
+      const size_t n_survive = (n_active + 1) / 2;
+      const size_t n_pairs = n_active - n_survive;
+      const size_t n_tasks = n_pairs * n_blocks;
+
+      #pragma omp parallel for num_threads(std::min(nthread, n_tasks)) schedule(guided)
+      for (bst_omp_uint itask = 0; itask < n_tasks; ++itask) {
+        const size_t ipair = itask / n_blocks;
+        const size_t iblock = itask % n_blocks;
+        const size_t istart = iblock*block_size;
+        const size_t iend = (((iblock+1)*block_size > size) ? size : istart + block_size);
+
+        double* dst = data + 2*thread_init_[ipair]*nbins_;
+        const double* src = data + 2*thread_init_[ipair + n_survive]*nbins_;
+        kReduceKernel(dst, src, istart, iend);
+      }
+      n_active = n_survive;
+    }
+
+    #pragma omp parallel for num_threads(std::min(nthread, n_blocks)) schedule(static)
     for (bst_omp_uint iblock = 0; iblock < n_blocks; iblock++) {
       const size_t istart = iblock*block_size;
       const size_t iend = (((iblock+1)*block_size > size) ? size : istart + block_size);
-
       const size_t bin = 2*thread_init_[0]*nbins_;
       memcpy(hist_data + istart, (data + bin + istart), sizeof(double)*(iend - istart));
+    }
+  }
+}
 
-      for (size_t i_bin_part = 1; i_bin_part < n_worked_bins; ++i_bin_part) {
-        const size_t bin = 2*thread_init_[i_bin_part]*nbins_;
-        for (size_t i = istart; i < iend; i++) {
-          hist_data[i] += data[bin + i];
-        }
-      }
+template <typename RowSetElemT>
+void GHistBuilder::BuildHistSerial(const std::vector<GradientPair>& gpair,
+                                   const RowSetElemT row_indices,
+                                   const GHistIndexMatrix& gmat,
+                                   GHistRow hist) {
+  using RowIdxT = typename RowSetElemT::IndexT;
+  const BuildHistKernelFn<RowIdxT> kBuildKernel =
+      ChooseBuildHistKernel<RowIdxT>(gmat.index.ElemSize(),
+                                     use_compressed_grads_,
+                                     use_reordered_grads_);
+
+  const size_t nrows = row_indices.Size();
+  double* hist_data = reinterpret_cast<double*>(hist.begin);
+
+  const void* pgh;
+  if (use_reordered_grads_) {
+    const size_t offset = static_cast<size_t>(
+        row_indices.begin - static_cast<const RowIdxT*>(reorder_base_));
+    pgh = use_compressed_grads_
+        ? static_cast<const void*>(gpair_half_pos_.data() + 2 * offset)
+        : static_cast<const void*>(gpair_pos_.data() + 2 * offset);
+  } else {
+    pgh = use_compressed_grads_
+        ? static_cast<const void*>(gpair_half_.data())
+        : static_cast<const void*>(gpair.data());
+  }
+  memset(hist_data, '\0', 2*nbins_*sizeof(double));
+  kBuildKernel(row_indices.begin, 0, nrows, nrows,
+               gmat.row_ptr.data(), gmat.index.RawData(), pgh, hist_data);
+}
+
+template <typename RowSetElemT>
+void GHistBuilder::BuildHistSparse(const std::vector<GradientPair>& gpair,
+                                   const RowSetElemT row_indices,
+                                   const GHistIndexMatrix& gmat,
+                                   std::vector<uint32_t>* p_bins,
+                                   std::vector<GHistEntry>* p_entries) {
+  // one record per matrix entry of the node's rows
+  struct BinStat {
+    uint32_t bin;
+    float grad;
+    float hess;
+  };
+  const size_t nrows = row_indices.Size();
+  size_t nstats = 0;
+  for (size_t i = 0; i < nrows; ++i) {
+    const size_t rid = row_indices.begin[i];
+    nstats += gmat.row_ptr[rid + 1] - gmat.row_ptr[rid];
+  }
+  std::vector<BinStat> stats;
+  stats.reserve(nstats);
+  for (size_t i = 0; i < nrows; ++i) {
+    const size_t rid = row_indices.begin[i];
+    const GradientPair stat = gpair[rid];
+    const size_t iend = gmat.row_ptr[rid + 1];
+    for (size_t j = gmat.row_ptr[rid]; j < iend; ++j) {
+      stats.push_back({gmat.index[j], stat.GetGrad(), stat.GetHess()});
+    }
+  }
+  std::sort(stats.begin(), stats.end(),
+            [](const BinStat& a, const BinStat& b) { return a.bin < b.bin; });
+  std::vector<uint32_t>& bins = *p_bins;
+  std::vector<GHistEntry>& entries = *p_entries;
+  bins.clear();
+  entries.clear();
+  for (const BinStat& s : stats) {
+    if (bins.empty() || bins.back() != s.bin) {
+      bins.push_back(s.bin);
+      entries.push_back(GHistEntry());
+    }
+    entries.back().sum_grad += s.grad;
+    entries.back().sum_hess += s.hess;
+  }
+}
+
+void GHistBuilder::CompressGradients(const std::vector<GradientPair>& gpair) {
+  const size_t nsize = 2 * gpair.size();
+  gpair_half_.resize(nsize);
+  const float* src = reinterpret_cast<const float*>(gpair.data());
+
+  #pragma omp parallel for num_threads(nthread_) schedule(static)
+  for (bst_omp_uint i = 0; i < static_cast<bst_omp_uint>(nsize); ++i) {
+    gpair_half_[i] = FloatToHalf(src[i]);
+  }
+  use_compressed_grads_ = true;
+}
+
+template <typename RowIdxT>
+void GHistBuilder::ReorderGradients(const std::vector<GradientPair>& gpair,
+                                    const RowIdxT* row_indices, size_t nrows) {
+  const auto n = static_cast<bst_omp_uint>(nrows);
+  if (use_compressed_grads_) {
+    gpair_half_pos_.resize(2 * nrows);
+    #pragma omp parallel for num_threads(nthread_) schedule(static)
+    for (bst_omp_uint i = 0; i < n; ++i) {
+      const size_t rid = row_indices[i];
+      gpair_half_pos_[2*i] = gpair_half_[2*rid];
+      gpair_half_pos_[2*i+1] = gpair_half_[2*rid+1];
+    }
+  } else {
+    const float* src = reinterpret_cast<const float*>(gpair.data());
+    gpair_pos_.resize(2 * nrows);
+    #pragma omp parallel for num_threads(nthread_) schedule(static)
+    for (bst_omp_uint i = 0; i < n; ++i) {
+      const size_t rid = row_indices[i];
+      gpair_pos_[2*i] = src[2*rid];
+      gpair_pos_[2*i+1] = src[2*rid+1];
     }
   }
+  use_reordered_grads_ = true;
+  reorder_base_ = row_indices;
 }
 
+template <typename RowSetElemT>
 void GHistBuilder::BuildBlockHist(const std::vector<GradientPair>& gpair,
-                                  const RowSetCollection::Elem row_indices,
+                                  const RowSetElemT row_indices,
                                   const GHistIndexBlockMatrix& gmatb,
                                   GHistRow hist) {
   constexpr int kUnroll = 8;  // loop unrolling factor
@@ -547,7 +1324,64 @@ void GHistBuilder::BuildBlockHist(const std::vector<GradientPair>& gpair,
   }
 }
 
+// instantiate the histogram builders for both row index widths; updaters
+// pick the narrow width through their RowSetCollectionT alias
+template void GHistBuilder::BuildHist<RowSetCollection::Elem>(
+    const std::vector<GradientPair>&, const RowSetCollection::Elem,
+    const GHistIndexMatrix&, GHistRow);
+template void GHistBuilder::BuildHist<RowSetCollectionT<uint32_t>::Elem>(
+    const std::vector<GradientPair>&, const RowSetCollectionT<uint32_t>::Elem,
+    const GHistIndexMatrix&, GHistRow);
+template void GHistBuilder::BuildHistSerial<RowSetCollection::Elem>(
+    const std::vector<GradientPair>&, const RowSetCollection::Elem,
+    const GHistIndexMatrix&, GHistRow);
+template void GHistBuilder::BuildHistSerial<RowSetCollectionT<uint32_t>::Elem>(
+    const std::vector<GradientPair>&, const RowSetCollectionT<uint32_t>::Elem,
+    const GHistIndexMatrix&, GHistRow);
+template void GHistBuilder::BuildHistSparse<RowSetCollection::Elem>(
+    const std::vector<GradientPair>&, const RowSetCollection::Elem,
+    const GHistIndexMatrix&, std::vector<uint32_t>*, std::vector<GHistEntry>*);
+template void GHistBuilder::BuildHistSparse<RowSetCollectionT<uint32_t>::Elem>(
+    const std::vector<GradientPair>&, const RowSetCollectionT<uint32_t>::Elem,
+    const GHistIndexMatrix&, std::vector<uint32_t>*, std::vector<GHistEntry>*);
+template void GHistBuilder::BuildBlockHist<RowSetCollection::Elem>(
+    const std::vector<GradientPair>&, const RowSetCollection::Elem,
+    const GHistIndexBlockMatrix&, GHistRow);
+template void GHistBuilder::BuildBlockHist<RowSetCollectionT<uint32_t>::Elem>(
+    const std::vector<GradientPair>&, const RowSetCollectionT<uint32_t>::Elem,
+    const GHistIndexBlockMatrix&, GHistRow);
+template void GHistBuilder::ReorderGradients<RowSetCollection::RowIdx>(
+    const std::vector<GradientPair>&, const RowSetCollection::RowIdx*, size_t);
+template void GHistBuilder::ReorderGradients<uint32_t>(
+    const std::vector<GradientPair>&, const uint32_t*, size_t);
+
 void GHistBuilder::SubtractionTrick(GHistRow self, GHistRow sibling, GHistRow parent) {
+  CHECK(!self.IsSparse());
+  if (parent.IsSparse() || sibling.IsSparse()) {
+    // compact operands: densify the parent into self, then scatter the
+    // sibling's occupied bins off it. Work scales with the compact sizes
+    // plus one sweep over self, not with three dense rows.
+    if (parent.IsSparse()) {
+      std::fill_n(self.begin, nbins_, GHistEntry());
+      for (uint32_t i = 0; i < parent.size; ++i) {
+        self.begin[parent.bins[i]] = parent.begin[i];
+      }
+    } else {
+      std::copy_n(parent.begin, nbins_, self.begin);
+    }
+    if (sibling.IsSparse()) {
+      for (uint32_t i = 0; i < sibling.size; ++i) {
+        GHistEntry& e = self.begin[sibling.bins[i]];
+        e.SetSubtract(e, sibling.begin[i]);
+      }
+    } else {
+      for (uint32_t bin_id = 0; bin_id < nbins_; ++bin_id) {
+        self.begin[bin_id].SetSubtract(self.begin[bin_id],
+                                       sibling.begin[bin_id]);
+      }
+    }
+    return;
+  }
   const uint32_t nbins = static_cast<bst_omp_uint>(nbins_);
   constexpr int kUnroll = 8;  // loop unrolling factor
   const uint32_t rest = nbins % kUnroll;
@@ -8,8 +8,11 @@
 #include <thrust/functional.h>
 #include <thrust/iterator/counting_iterator.h>
 #include <thrust/iterator/transform_iterator.h>
+#include <thrust/iterator/zip_iterator.h>
 #include <thrust/reduce.h>
+#include <thrust/scan.h>
 #include <thrust/sequence.h>
+#include <thrust/tuple.h>
 
 #include <utility>
 #include <vector>
@@ -24,36 +27,109 @@ namespace common {
 
 using WXQSketch = HistCutMatrix::WXQSketch;
 
-__global__ void find_cuts_k
-(WXQSketch::Entry* __restrict__ cuts, const bst_float* __restrict__ data,
- const float* __restrict__ cum_weights, int nsamples, int ncuts) {
-  // ncuts < nsamples
-  int icut = threadIdx.x + blockIdx.x * blockDim.x;
-  if (icut >= ncuts)
+// maps a flat index in the column-major feature value matrix to its column
+struct ColumnIndexOp {
+  size_t nrows;
+  __host__ __device__ int operator()(size_t i) const {
+    return static_cast<int>(i / nrows);
+  }
+};
+
+// start offset of a sort segment; one segment per feature column
+struct SegmentOffsetOp {
+  size_t nrows;
+  __host__ __device__ int operator()(size_t i) const {
+    return static_cast<int>(i * nrows);
+  }
+};
+
+// 1-based rank within a column; serves as the cumulative weight of a sorted
+// feature value when instance weights are not present
+struct ColumnRankOp {
+  size_t nrows;
+  __host__ __device__ bst_float operator()(size_t i) const {
+    return static_cast<bst_float>(i % nrows + 1);
+  }
+};
+
+// locates the span of every column in the deduplicated (column, value) runs
+// and counts its valid entries; the NaN padding sorts to the end of each
+// column and NaN never compares equal, so it forms singleton runs that trail
+// the valid values within the span
+__global__ void find_col_spans_k
+(size_t* __restrict__ col_offsets, size_t* __restrict__ col_n_unique,
+ const int* __restrict__ cols, const bst_float* __restrict__ data,
+ size_t n_total, int ncols) {
+  int icol = threadIdx.x + blockIdx.x * blockDim.x;
+  if (icol >= ncols)
     return;
-  WXQSketch::Entry v;
-  int isample = 0;
-  if (icut == 0) {
-    isample = 0;
-  } else if (icut == ncuts - 1) {
-    isample = nsamples - 1;
-  } else {
-    bst_float rank = cum_weights[nsamples - 1] / static_cast<float>(ncuts - 1)
-      * static_cast<float>(icut);
-    // -1 is used because cum_weights is an inclusive sum
-    isample = dh::UpperBound(cum_weights, nsamples, rank);
-    isample = max(0, min(isample, nsamples - 1));
+  // columns appear in ascending order; locate the span with binary searches
+  size_t lo = 0, hi = n_total;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (cols[mid] < icol) { lo = mid + 1; } else { hi = mid; }
+  }
+  size_t begin = lo;
+  hi = n_total;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (cols[mid] <= icol) { lo = mid + 1; } else { hi = mid; }
+  }
+  size_t end = lo;
+  // first NaN run within the span
+  lo = begin;
+  hi = end;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (!isnan(data[mid])) { lo = mid + 1; } else { hi = mid; }
   }
-  // repeated values will be filtered out on the CPU
-  bst_float rmin = isample > 0 ? cum_weights[isample - 1] : 0;
-  bst_float rmax = cum_weights[isample];
-  cuts[icut] = WXQSketch::Entry(rmin, rmax, rmax - rmin, data[isample]);
+  col_offsets[icol] = begin;
+  col_n_unique[icol] = lo - begin;
 }
 
-// predictate for thrust filtering that returns true if the element is not a NaN
-struct IsNotNaN {
-  __device__ bool operator()(float a) const { return !isnan(a); }
-};
+// extracts the cuts of all columns in a single launch; one thread per
+// (column, cut) pair
+__global__ void extract_cuts_k
+(WXQSketch::Entry* __restrict__ cuts, const bst_float* __restrict__ data,
+ const float* __restrict__ cum_weights, const size_t* __restrict__ col_offsets,
+ const size_t* __restrict__ col_n_unique, size_t n_cuts, int ncols) {
+  size_t idx = threadIdx.x + size_t(blockIdx.x) * blockDim.x;
+  if (idx >= n_cuts * ncols)
+    return;
+  int icol = idx / n_cuts;
+  int icut = idx % n_cuts;
+  size_t n_unique = col_n_unique[icol];
+  const bst_float* col_data = data + col_offsets[icol];
+  const float* col_weights = cum_weights + col_offsets[icol];
+  WXQSketch::Entry* col_cuts = cuts + icol * n_cuts;
+  if (n_unique < n_cuts) {
+    // fewer unique elements than cuts: copy all elements with their weights
+    if (icut < n_unique) {
+      bst_float rmax = col_weights[icut];
+      bst_float rmin = icut > 0 ? col_weights[icut - 1] : 0;
+      col_cuts[icut] = WXQSketch::Entry(rmin, rmax, rmax - rmin, col_data[icut]);
+    }
+  } else if (n_unique > 0) {
+    // more elements than cuts: binary search on cumulative weights
+    int nsamples = n_unique;
+    int isample = 0;
+    if (icut == 0) {
+      isample = 0;
+    } else if (icut == n_cuts - 1) {
+      isample = nsamples - 1;
+    } else {
+      bst_float rank = col_weights[nsamples - 1] / static_cast<float>(n_cuts - 1)
+        * static_cast<float>(icut);
+      // -1 is used because cum_weights is an inclusive sum
+      isample = dh::UpperBound(col_weights, nsamples, rank);
+      isample = max(0, min(isample, nsamples - 1));
+    }
+    // repeated values will be filtered out on the CPU
+    bst_float rmin = isample > 0 ? col_weights[isample - 1] : 0;
+    bst_float rmax = col_weights[isample];
+    col_cuts[icut] = WXQSketch::Entry(rmin, rmax, rmax - rmin, col_data[isample]);
+  }
+}
 
 __global__ void unpack_features_k
 (float* __restrict__ fvalues, float* __restrict__ feature_weights,
@@ -96,19 +172,24 @@ struct GPUSketcher {
 
     tree::TrainParam param_;
     std::vector<WXQSketch> sketches_;
-    thrust::device_vector<size_t> row_ptrs_;
+    // device buffers live for one sketch call; the arena-backed vectors
+    // recycle their storage across calls instead of hitting cudaMalloc
+    dh::ArenaVector<size_t> row_ptrs_;
     std::vector<WXQSketch::SummaryContainer> summaries_;
-    thrust::device_vector<Entry> entries_;
-    thrust::device_vector<bst_float> fvalues_;
-    thrust::device_vector<bst_float> feature_weights_;
-    thrust::device_vector<bst_float> fvalues_cur_;
-    thrust::device_vector<WXQSketch::Entry> cuts_d_;
+    dh::ArenaVector<Entry> entries_;
+    dh::ArenaVector<bst_float> fvalues_;
+    dh::ArenaVector<bst_float> feature_weights_;
+    dh::ArenaVector<bst_float> fvalues_cur_;
+    dh::ArenaVector<WXQSketch::Entry> cuts_d_;
     thrust::host_vector<WXQSketch::Entry> cuts_h_;
-    thrust::device_vector<bst_float> weights_;
-    thrust::device_vector<bst_float> weights2_;
+    dh::ArenaVector<bst_float> weights_;
+    dh::ArenaVector<bst_float> weights2_;
+    dh::ArenaVector<bst_float> cum_weights_;
+    dh::ArenaVector<int> cols_;
+    dh::ArenaVector<size_t> col_offsets_;
+    dh::ArenaVector<size_t> col_n_unique_;
     std::vector<size_t> n_cuts_cur_;
-    thrust::device_vector<size_t> num_elements_;
-    thrust::device_vector<char> tmp_storage_;
+    dh::ArenaVector<char> tmp_storage_;
 
     DeviceShard(int device, bst_uint row_begin, bst_uint row_end,
                 tree::TrainParam param) :
@@ -154,124 +235,118 @@ struct GPUSketcher {
 
       entries_.resize(gpu_batch_nrows_ * num_cols_);
       fvalues_.resize(gpu_batch_nrows_ * num_cols_);
-      fvalues_cur_.resize(gpu_batch_nrows_);
+      fvalues_cur_.resize(gpu_batch_nrows_ * num_cols_);
       cuts_d_.resize(n_cuts_ * num_cols_);
       cuts_h_.resize(n_cuts_ * num_cols_);
       weights_.resize(gpu_batch_nrows_);
-      weights2_.resize(gpu_batch_nrows_);
-      num_elements_.resize(1);
+      weights2_.resize(gpu_batch_nrows_ * num_cols_);
+      cols_.resize(gpu_batch_nrows_ * num_cols_);
+      col_offsets_.resize(num_cols_);
+      col_n_unique_.resize(num_cols_);
 
       if (has_weights_) {
         feature_weights_.resize(gpu_batch_nrows_ * num_cols_);
+        cum_weights_.resize(gpu_batch_nrows_ * num_cols_);
       }
       n_cuts_cur_.resize(num_cols_);
 
-      // allocate storage for CUB algorithms; the size is the maximum of the sizes
-      // required for various algorithm
-      size_t tmp_size = 0, cur_tmp_size = 0;
-      // size for sorting
+      // allocate storage for the segmented sort covering all columns at once
+      size_t tmp_size = 0;
+      auto seg_offsets = thrust::make_transform_iterator
+        (thrust::make_counting_iterator<size_t>(0),
+         SegmentOffsetOp{gpu_batch_nrows_});
       if (has_weights_) {
-        cub::DeviceRadixSort::SortPairs
-          (nullptr, cur_tmp_size, fvalues_cur_.data().get(),
-           fvalues_.data().get(), weights_.data().get(), weights2_.data().get(),
-           gpu_batch_nrows_);
+        cub::DeviceSegmentedRadixSort::SortPairs
+          (nullptr, tmp_size, fvalues_.data().get(), fvalues_cur_.data().get(),
+           feature_weights_.data().get(), weights2_.data().get(),
+           gpu_batch_nrows_ * num_cols_, num_cols_,
+           seg_offsets, seg_offsets + 1);
       } else {
-        cub::DeviceRadixSort::SortKeys
-          (nullptr, cur_tmp_size, fvalues_cur_.data().get(), fvalues_.data().get(),
-           gpu_batch_nrows_);
+        cub::DeviceSegmentedRadixSort::SortKeys
+          (nullptr, tmp_size, fvalues_.data().get(), fvalues_cur_.data().get(),
+           gpu_batch_nrows_ * num_cols_, num_cols_,
+           seg_offsets, seg_offsets + 1);
       }
-      tmp_size = std::max(tmp_size, cur_tmp_size);
-      // size for inclusive scan
-      if (has_weights_) {
-        cub::DeviceScan::InclusiveSum
-          (nullptr, cur_tmp_size, weights2_.begin(), weights_.begin(), gpu_batch_nrows_);
-        tmp_size = std::max(tmp_size, cur_tmp_size);
-      }
-      // size for reduction by key
-      cub::DeviceReduce::ReduceByKey
-        (nullptr, cur_tmp_size, fvalues_.begin(),
-         fvalues_cur_.begin(), weights_.begin(), weights2_.begin(),
-         num_elements_.begin(), thrust::maximum<bst_float>(), gpu_batch_nrows_);
-      tmp_size = std::max(tmp_size, cur_tmp_size);
-      // size for filtering
-      cub::DeviceSelect::If
-        (nullptr, cur_tmp_size, fvalues_.begin(), fvalues_cur_.begin(),
-         num_elements_.begin(), gpu_batch_nrows_, IsNotNaN());
-      tmp_size = std::max(tmp_size, cur_tmp_size);
-
       tmp_storage_.resize(tmp_size);
     }
 
-    void FindColumnCuts(size_t batch_nrows, size_t icol) {
+    void FindBatchCuts() {
       size_t tmp_size = tmp_storage_.size();
-      // filter out NaNs in feature values
-      auto fvalues_begin = fvalues_.data() + icol * gpu_batch_nrows_;
-      cub::DeviceSelect::If
-        (tmp_storage_.data().get(), tmp_size, fvalues_begin,
-         fvalues_cur_.data(), num_elements_.begin(), batch_nrows, IsNotNaN());
-      size_t nfvalues_cur = 0;
-      thrust::copy_n(num_elements_.begin(), 1, &nfvalues_cur);
-
-      // compute cumulative weights using a prefix scan
+      size_t n_total = gpu_batch_nrows_ * num_cols_;
+      auto seg_offsets = thrust::make_transform_iterator
+        (thrust::make_counting_iterator<size_t>(0),
+         SegmentOffsetOp{gpu_batch_nrows_});
+      // sort all columns in a single launch; the NaN padding sorts to the end
+      // of each segment, so no separate filtering pass is needed
       if (has_weights_) {
-        // filter out NaNs in weights;
-        // since cub::DeviceSelect::If performs stable filtering,
-        // the weights are stored in the correct positions
-        auto feature_weights_begin = feature_weights_.data() +
-          icol * gpu_batch_nrows_;
-        cub::DeviceSelect::If
-          (tmp_storage_.data().get(), tmp_size, feature_weights_begin,
-           weights_.data().get(), num_elements_.begin(), batch_nrows, IsNotNaN());
-
-        // sort the values and weights
-        cub::DeviceRadixSort::SortPairs
-          (tmp_storage_.data().get(), tmp_size, fvalues_cur_.data().get(),
-           fvalues_begin.get(), weights_.data().get(), weights2_.data().get(),
-           nfvalues_cur);
-
-        // sum the weights to get cumulative weight values
-        cub::DeviceScan::InclusiveSum
-          (tmp_storage_.data().get(), tmp_size, weights2_.begin(),
-           weights_.begin(), nfvalues_cur);
+        cub::DeviceSegmentedRadixSort::SortPairs
+          (tmp_storage_.data().get(), tmp_size,
+           fvalues_.data().get(), fvalues_cur_.data().get(),
+           feature_weights_.data().get(), weights2_.data().get(),
+           n_total, num_cols_, seg_offsets, seg_offsets + 1);
+        // per-column cumulative weights in one scan; the sums beyond the
+        // valid prefix of each column run into the NaN padding and are unused
+        auto col_keys = thrust::make_transform_iterator
+          (thrust::make_counting_iterator<size_t>(0),
+           ColumnIndexOp{gpu_batch_nrows_});
+        thrust::inclusive_scan_by_key(col_keys, col_keys + n_total,
+                                      weights2_.begin(), cum_weights_.begin());
       } else {
-        // sort the batch values
-        cub::DeviceRadixSort::SortKeys
+        cub::DeviceSegmentedRadixSort::SortKeys
           (tmp_storage_.data().get(), tmp_size,
-           fvalues_cur_.data().get(), fvalues_begin.get(), nfvalues_cur);
+           fvalues_.data().get(), fvalues_cur_.data().get(),
+           n_total, num_cols_, seg_offsets, seg_offsets + 1);
+      }
 
-        // fill in cumulative weights with counting iterator
-        thrust::copy_n(thrust::make_counting_iterator(1), nfvalues_cur,
-                       weights_.begin());
+      // remove repeated items and take the maximum cumulative weight across
+      // them in a single reduction over all columns; non-negative weights
+      // are assumed
+      auto col_keys = thrust::make_transform_iterator
+        (thrust::make_counting_iterator<size_t>(0),
+         ColumnIndexOp{gpu_batch_nrows_});
+      auto keys_in = thrust::make_zip_iterator
+        (thrust::make_tuple(col_keys, fvalues_cur_.begin()));
+      auto keys_out = thrust::make_zip_iterator
+        (thrust::make_tuple(cols_.begin(), fvalues_.begin()));
+      size_t n_total_unique = 0;
+      if (has_weights_) {
+        auto ends = thrust::reduce_by_key
+          (keys_in, keys_in + n_total, cum_weights_.begin(), keys_out,
+           weights2_.begin(),
+           thrust::equal_to<thrust::tuple<int, bst_float>>(),
+           thrust::maximum<bst_float>());
+        n_total_unique = ends.first - keys_out;
+      } else {
+        // the cumulative weight of a value is its 1-based rank in the column
+        auto ranks = thrust::make_transform_iterator
+          (thrust::make_counting_iterator<size_t>(0),
+           ColumnRankOp{gpu_batch_nrows_});
+        auto ends = thrust::reduce_by_key
+          (keys_in, keys_in + n_total, ranks, keys_out, weights2_.begin(),
+           thrust::equal_to<thrust::tuple<int, bst_float>>(),
+           thrust::maximum<bst_float>());
+        n_total_unique = ends.first - keys_out;
       }
 
-      // remove repeated items and sum the weights across them;
-      // non-negative weights are assumed
-      cub::DeviceReduce::ReduceByKey
-        (tmp_storage_.data().get(), tmp_size, fvalues_begin,
-         fvalues_cur_.begin(), weights_.begin(), weights2_.begin(),
-         num_elements_.begin(), thrust::maximum<bst_float>(), nfvalues_cur);
-      size_t n_unique = 0;
-      thrust::copy_n(num_elements_.begin(), 1, &n_unique);
-
-      // extract cuts
-      n_cuts_cur_[icol] = std::min(n_cuts_, n_unique);
-      // if less elements than cuts: copy all elements with their weights
-      if (n_cuts_ > n_unique) {
-        float* weights2_ptr = weights2_.data().get();
-        float* fvalues_ptr = fvalues_cur_.data().get();
-        WXQSketch::Entry* cuts_ptr = cuts_d_.data().get() + icol * n_cuts_;
-        dh::LaunchN(device_, n_unique, [=]__device__(size_t i) {
-            bst_float rmax = weights2_ptr[i];
-            bst_float rmin = i > 0 ? weights2_ptr[i - 1] : 0;
-            cuts_ptr[i] = WXQSketch::Entry(rmin, rmax, rmax - rmin, fvalues_ptr[i]);
-          });
-      } else if (n_cuts_cur_[icol] > 0) {
-        // if more elements than cuts: use binary search on cumulative weights
-        int block = 256;
-        find_cuts_k<<<dh::DivRoundUp(n_cuts_cur_[icol], block), block>>>
-          (cuts_d_.data().get() + icol * n_cuts_, fvalues_cur_.data().get(),
-           weights2_.data().get(), n_unique, n_cuts_cur_[icol]);
-        dh::safe_cuda(cudaGetLastError());  // NOLINT
+      // locate every column's span and valid entry count in the
+      // deduplicated output
+      int block = 256;
+      find_col_spans_k<<<dh::DivRoundUp(num_cols_, block), block>>>
+        (col_offsets_.data().get(), col_n_unique_.data().get(),
+         cols_.data().get(), fvalues_.data().get(), n_total_unique, num_cols_);
+      dh::safe_cuda(cudaGetLastError());  // NOLINT
+
+      // extract the cuts of all columns in one launch
+      extract_cuts_k<<<dh::DivRoundUp(n_cuts_ * num_cols_, block), block>>>
+        (cuts_d_.data().get(), fvalues_.data().get(), weights2_.data().get(),
+         col_offsets_.data().get(), col_n_unique_.data().get(),
+         n_cuts_, num_cols_);
+      dh::safe_cuda(cudaGetLastError());  // NOLINT
+
+      // a single transfer of the per-column counts
+      thrust::host_vector<size_t> h_n_unique(col_n_unique_);
+      for (int icol = 0; icol < num_cols_; ++icol) {
+        n_cuts_cur_[icol] = std::min(n_cuts_, h_n_unique[icol]);
       }
     }
 
@@ -315,12 +390,11 @@ struct GPUSketcher {
          has_weights_ ? weights_.data().get() : nullptr, entries_.data().get(),
          gpu_batch_nrows_, num_cols_,
          offset_vec[row_begin_ + batch_row_begin], batch_nrows);
-      dh::safe_cuda(cudaGetLastError());       // NOLINT
-      dh::safe_cuda(cudaDeviceSynchronize());  // NOLINT
+      dh::safe_cuda(cudaGetLastError());  // NOLINT
 
-      for (int icol = 0; icol < num_cols_; ++icol) {
-        FindColumnCuts(batch_nrows, icol);
-      }
+      // the rows of the last batch beyond batch_nrows keep their NaN padding
+      // and are sorted out of the way together with the missing entries
+      FindBatchCuts();
 
       dh::safe_cuda(cudaDeviceSynchronize());  // NOLINT
 
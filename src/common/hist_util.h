@@ -9,9 +9,14 @@
 
 #include <xgboost/data.h>
 #include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 #include "row_set.h"
 #include "../tree/param.h"
+#include "./memory_stats.h"
 #include "./quantile.h"
 
 namespace xgboost {
@@ -63,8 +68,14 @@ struct HistCutMatrix {
   using WXQSketch = common::WXQuantileSketch<bst_float, bst_float>;
 
   // create histogram cut matrix given statistics from data
-  // using approximate quantile sketch approach
-  void Init(DMatrix* p_fmat, uint32_t max_num_bins);
+  // using approximate quantile sketch approach.
+  // when p_row_ptr is given, the cumulative row lengths of p_fmat are
+  // recorded during the sketch sweep, so callers that quantize right after
+  // (e.g. GHistIndexMatrix::Init) do not need an extra scan of the data to
+  // size their buffers; this matters for external-memory matrices where
+  // every scan streams the page cache from disk
+  void Init(DMatrix* p_fmat, uint32_t max_num_bins,
+            std::vector<size_t>* p_row_ptr = nullptr);
 
   void Init(std::vector<WXQSketch>* sketchs, uint32_t max_num_bins);
 };
@@ -88,6 +99,89 @@ struct GHistIndexRow {
       : index(index), size(size) {}
 };
 
+/*!
+ * \brief adaptive storage for bin indices.
+ *  The element width (1, 2 or 4 bytes) is picked from the total cut count,
+ *  so that typical max_bin settings move 4x less memory through the
+ *  BuildHist gather loop than a plain uint32_t buffer.
+ */
+class BinIndexBuffer {
+ public:
+  BinIndexBuffer() = default;
+  ~BinIndexBuffer();
+  BinIndexBuffer(const BinIndexBuffer&) = delete;
+  BinIndexBuffer& operator=(const BinIndexBuffer&) = delete;
+  /*! \brief pick the narrowest element type able to hold ids in [0, nbins) */
+  inline void SetNumBins(uint32_t nbins) {
+    if (nbins <= (1U << 8)) {
+      elem_size_ = sizeof(uint8_t);
+    } else if (nbins <= (1U << 16)) {
+      elem_size_ = sizeof(uint16_t);
+    } else {
+      elem_size_ = sizeof(uint32_t);
+    }
+  }
+  /*!
+   * \brief back the buffer with an unlinked disk file instead of heap
+   *  memory, so the OS can page bin indices out under memory pressure
+   *  instead of failing the allocation. Must be called before Resize.
+   *  No-op on platforms without mmap support.
+   * \param dir directory where the spill file is created
+   */
+  void SetFileBacking(const std::string& dir);
+  inline void Resize(size_t n) {
+    if (file_backed_) {
+      ResizeMapped(n * elem_size_);
+    } else {
+      data_.resize(n * elem_size_);
+      nbytes_ = data_.size();
+    }
+  }
+  inline size_t Size() const {
+    return nbytes_ / elem_size_;
+  }
+  /*! \brief bytes per stored bin index (1, 2 or 4) */
+  inline size_t ElemSize() const {
+    return elem_size_;
+  }
+  inline const void* RawData() const {
+    return Ptr();
+  }
+  template <typename BinIdxT>
+  inline BinIdxT* Data() {
+    return reinterpret_cast<BinIdxT*>(Ptr());
+  }
+  template <typename BinIdxT>
+  inline const BinIdxT* Data() const {
+    return reinterpret_cast<const BinIdxT*>(Ptr());
+  }
+  inline uint32_t operator[](size_t i) const {
+    switch (elem_size_) {
+      case sizeof(uint8_t): return Ptr()[i];
+      case sizeof(uint16_t): return Data<uint16_t>()[i];
+      default: return Data<uint32_t>()[i];
+    }
+  }
+
+ private:
+  inline uint8_t* Ptr() {
+    return file_backed_ ? mapped_ : data_.data();
+  }
+  inline const uint8_t* Ptr() const {
+    return file_backed_ ? mapped_ : data_.data();
+  }
+  void ResizeMapped(size_t nbytes);
+  void FreeMapping();
+
+  std::vector<uint8_t> data_;
+  size_t elem_size_{sizeof(uint32_t)};
+  size_t nbytes_{0};
+  bool file_backed_{false};
+  std::string backing_dir_;
+  uint8_t* mapped_{nullptr};
+  size_t mapped_size_{0};
+};
+
 /*!
  * \brief preprocessed global index matrix, in CSR format
  *  Transform floating values to integer index in histogram
@@ -96,18 +190,33 @@ struct GHistIndexRow {
 struct GHistIndexMatrix {
   /*! \brief row pointer to rows by element position */
   std::vector<size_t> row_ptr;
-  /*! \brief The index data */
-  std::vector<uint32_t> index;
+  /*! \brief The index data; element width adapts to the total bin count */
+  BinIndexBuffer index;
   /*! \brief hit count of each index */
   std::vector<size_t> hit_count;
   /*! \brief The corresponding cuts */
   HistCutMatrix cut;
   // Create a global histogram matrix, given cut
   void Init(DMatrix* p_fmat, int max_num_bins);
-  // get i-th row
-  inline GHistIndexRow operator[](size_t i) const {
-    return {&index[0] + row_ptr[i], row_ptr[i + 1] - row_ptr[i]};
-  }
+  /*!
+   * \brief quantize the matrix against previously sketched cut points,
+   *  skipping the sketch sweep. Used when a matrix merely grew in place
+   *  (rows appended) and the quantile drift is small enough that the old
+   *  cuts are still representative.
+   * \param p_fmat feature matrix to quantize
+   * \param cuts cut points to quantize against
+   */
+  void Init(DMatrix* p_fmat, const HistCutMatrix& cuts);
+  /*!
+   * \brief build the quantized matrix of a row view by gathering the
+   *  listed rows out of the parent's, sharing the parent's cut points.
+   *  Skips the sketch and quantization sweeps entirely, so slicing k
+   *  cross-validation folds costs k gathers instead of k passes over the
+   *  raw feature values.
+   * \param parent quantized matrix of the parent
+   * \param ridx rows of the parent to gather, in view row order
+   */
+  void Init(const GHistIndexMatrix& parent, const std::vector<bst_uint>& ridx);
   inline void GetFeatureCounts(size_t* counts) const {
     auto nfeature = cut.row_ptr.size() - 1;
     for (unsigned fid = 0; fid < nfeature; ++fid) {
@@ -120,9 +229,29 @@ struct GHistIndexMatrix {
   }
 
  private:
+  // the quantization sweep shared by the Init overloads; expects cut and
+  // row_ptr to be filled in already
+  void BuildIndex(DMatrix* p_fmat);
+
   std::vector<size_t> hit_count_tloc_;
 };
 
+/*!
+ * \brief publish a quantized matrix for its source DMatrix in a process-wide
+ *  registry, so that other components (notably the CPU predictor) can reuse
+ *  the bin indices instead of re-comparing float feature values. The registry
+ *  holds weak references only; an entry stays visible as long as some owner
+ *  keeps the matrix alive.
+ */
+void PublishGHistIndex(const DMatrix* dmat,
+                       const std::shared_ptr<const GHistIndexMatrix>& gmat);
+
+/*!
+ * \brief look up the published quantized matrix of a DMatrix.
+ * \return the matrix, or nullptr when none was published or it has expired
+ */
+std::shared_ptr<const GHistIndexMatrix> LookupGHistIndex(const DMatrix* dmat);
+
 struct GHistIndexBlock {
   const size_t* row_ptr;
   const uint32_t* index;
@@ -176,10 +305,20 @@ struct GHistRow {
   GHistEntry* begin;
   /*! \brief number of entries */
   uint32_t size;
+  /*!
+   * \brief when non-null the row is compact: begin holds only the `size`
+   *  occupied bins of the node, whose ascending global bin ids are in
+   *  bins[0..size). Dense rows leave this null and span all nbins.
+   */
+  const uint32_t* bins{nullptr};
 
   GHistRow() = default;
   GHistRow(GHistEntry* begin, uint32_t size)
     : begin(begin), size(size) {}
+  GHistRow(GHistEntry* begin, uint32_t size, const uint32_t* bins)
+    : begin(begin), size(size), bins(bins) {}
+
+  bool IsSparse() const { return bins != nullptr; }
 };
 
 /*!
@@ -189,6 +328,12 @@ class HistCollection {
  public:
   // access histogram for i-th node
   inline GHistRow operator[](bst_uint nid) const {
+    auto it = sparse_rows_.find(nid);
+    if (it != sparse_rows_.end()) {
+      return {const_cast<GHistEntry*>(dmlc::BeginPtr(it->second.entries)),
+              static_cast<uint32_t>(it->second.entries.size()),
+              dmlc::BeginPtr(it->second.bins)};
+    }
     constexpr uint32_t kMax = std::numeric_limits<uint32_t>::max();
     CHECK_NE(row_ptr_[nid], kMax);
     return {const_cast<GHistEntry*>(dmlc::BeginPtr(data_) + row_ptr_[nid]), nbins_};
@@ -197,7 +342,8 @@ class HistCollection {
   // have we computed a histogram for i-th node?
   inline bool RowExists(bst_uint nid) const {
     const uint32_t k_max = std::numeric_limits<uint32_t>::max();
-    return (nid < row_ptr_.size() && row_ptr_[nid] != k_max);
+    return (nid < row_ptr_.size() && row_ptr_[nid] != k_max) ||
+           sparse_rows_.count(nid) != 0;
   }
 
   // initialize histogram collection
@@ -205,9 +351,13 @@ class HistCollection {
     nbins_ = nbins;
     row_ptr_.clear();
     data_.clear();
+    free_slots_.clear();
+    sparse_rows_.clear();
+    mem_bytes_.Update(0);
   }
 
-  // create an empty histogram for i-th node
+  // create an empty histogram for i-th node, recycling a released slot
+  // from the pool when one is available
   inline void AddHistRow(bst_uint nid) {
     constexpr uint32_t kMax = std::numeric_limits<uint32_t>::max();
     if (nid >= row_ptr_.size()) {
@@ -215,8 +365,47 @@ class HistCollection {
     }
     CHECK_EQ(row_ptr_[nid], kMax);
 
-    row_ptr_[nid] = data_.size();
-    data_.resize(data_.size() + nbins_);
+    if (!free_slots_.empty()) {
+      row_ptr_[nid] = free_slots_.back();
+      free_slots_.pop_back();
+      // callers expect a zeroed histogram
+      std::fill_n(data_.begin() + row_ptr_[nid], nbins_, GHistEntry());
+    } else {
+      row_ptr_[nid] = data_.size();
+      data_.resize(data_.size() + nbins_);
+      mem_bytes_.Update(data_.size() * sizeof(GHistEntry));
+    }
+  }
+
+  /*!
+   * \brief install a compact histogram for node nid, taking ownership of
+   *  the bin id list and the matching entries by swap. The bin ids must
+   *  be ascending; operator[] then returns the row in its sparse form.
+   */
+  inline void AddSparseHistRow(bst_uint nid, std::vector<uint32_t>* bins,
+                               std::vector<GHistEntry>* entries) {
+    CHECK(!RowExists(nid));
+    CHECK_EQ(bins->size(), entries->size());
+    SparseRow& row = sparse_rows_[nid];
+    row.bins.swap(*bins);
+    row.entries.swap(*entries);
+  }
+
+  /*!
+   * \brief release the histogram of node nid back to the pool.
+   *  Once both children were built (via fresh build + SubtractionTrick) the
+   *  parent row is dead; recycling it bounds histogram memory to the
+   *  frontier width instead of the total node count of the tree.
+   */
+  inline void ReleaseHistRow(bst_uint nid) {
+    if (sparse_rows_.erase(nid) != 0) {
+      return;
+    }
+    constexpr uint32_t kMax = std::numeric_limits<uint32_t>::max();
+    if (nid < row_ptr_.size() && row_ptr_[nid] != kMax) {
+      free_slots_.push_back(row_ptr_[nid]);
+      row_ptr_[nid] = kMax;
+    }
   }
 
  private:
@@ -227,8 +416,29 @@ class HistCollection {
 
   /*! \brief row_ptr_[nid] locates bin for historgram of node nid */
   std::vector<size_t> row_ptr_;
+  /*! \brief offsets of released histograms available for reuse */
+  std::vector<size_t> free_slots_;
+  /*! \brief compact (bin id, entry) histograms of small nodes */
+  struct SparseRow {
+    std::vector<uint32_t> bins;
+    std::vector<GHistEntry> entries;
+  };
+  std::map<bst_uint, SparseRow> sparse_rows_;
+  /*! \brief bytes of data_ currently reported to MemoryStats */
+  AccountedBytes mem_bytes_{"HistCollection"};
 };
 
+/*!
+ * \brief whether NUMA-aware histogram construction was requested through
+ *  the XGBOOST_HIST_NUMA_AWARE environment variable. Meant to be combined
+ *  with thread pinning (e.g. OMP_PROC_BIND=true OMP_PLACES=cores): rows
+ *  are then assigned to threads with the same static partition during
+ *  quantization, row set initialization and histogram accumulation, so
+ *  first-touch page placement keeps every socket reading and accumulating
+ *  node-local memory, with a single cross-socket reduction at the end
+ */
+bool HistNumaAware();
+
 /*!
  * \brief builder for histograms of gradient statistics
  */
@@ -241,26 +451,101 @@ class GHistBuilder {
     thread_init_.resize(nthread_);
   }
 
-  // construct a histogram via histogram aggregation
+  // construct a histogram via histogram aggregation. RowSetElemT is the
+  // Elem type of the RowSetCollectionT instantiation the caller uses;
+  // instantiated for the size_t and uint32_t index widths
+  template <typename RowSetElemT>
   void BuildHist(const std::vector<GradientPair>& gpair,
-                 const RowSetCollection::Elem row_indices,
+                 const RowSetElemT row_indices,
                  const GHistIndexMatrix& gmat,
                  GHistRow hist);
+  // same, but single threaded and without touching the shared per-thread
+  // buffers; safe to call concurrently for different nodes
+  template <typename RowSetElemT>
+  void BuildHistSerial(const std::vector<GradientPair>& gpair,
+                       const RowSetElemT row_indices,
+                       const GHistIndexMatrix& gmat,
+                       GHistRow hist);
   // same, with feature grouping
+  template <typename RowSetElemT>
   void BuildBlockHist(const std::vector<GradientPair>& gpair,
-                      const RowSetCollection::Elem row_indices,
+                      const RowSetElemT row_indices,
                       const GHistIndexBlockMatrix& gmatb,
                       GHistRow hist);
-  // construct a histogram via subtraction trick
+  /*!
+   * \brief build the compact (bin id, entry) histogram of a small node.
+   *  The node's (bin, gradient) pairs are gathered, sorted by bin and
+   *  merged, so the cost scales with the node's entries instead of nbins;
+   *  the output lists are sorted by ascending bin id and ready for
+   *  HistCollection::AddSparseHistRow. Single threaded, like
+   *  BuildHistSerial, and safe to call concurrently for different nodes.
+   */
+  template <typename RowSetElemT>
+  void BuildHistSparse(const std::vector<GradientPair>& gpair,
+                       const RowSetElemT row_indices,
+                       const GHistIndexMatrix& gmat,
+                       std::vector<uint32_t>* p_bins,
+                       std::vector<GHistEntry>* p_entries);
+  // construct a histogram via subtraction trick; self must be dense, the
+  // sibling and parent may be in either the dense or the compact form
   void SubtractionTrick(GHistRow self, GHistRow sibling, GHistRow parent);
 
+  /*!
+   * \brief pack the gradient pairs into half precision for the duration
+   *  of one iteration.  BuildHist/BuildHistSerial then stream 4-byte
+   *  pairs instead of the 8-byte originals, halving the gradient memory
+   *  traffic of every histogram pass at a small precision cost in the
+   *  accumulated sums (values saturate at the half range, +-65504)
+   */
+  void CompressGradients(const std::vector<GradientPair>& gpair);
+  /*! \brief drop the packed copy; reads go back to full precision */
+  inline void ClearCompressedGradients() {
+    use_compressed_grads_ = false;
+  }
+
+  /*!
+   * \brief install a copy of the gradients physically reordered to the
+   *  order of the caller's row partition array, so BuildHist reads them
+   *  sequentially by position instead of gathering by row id. The copy
+   *  goes stale whenever the partition array is permuted; callers
+   *  re-install it after every level. Not supported by BuildBlockHist.
+   * \param gpair the gradient pairs, indexed by row id
+   * \param row_indices start of the partition array the copy follows
+   * \param nrows number of entries in the partition array
+   */
+  template <typename RowIdxT>
+  void ReorderGradients(const std::vector<GradientPair>& gpair,
+                        const RowIdxT* row_indices, size_t nrows);
+  /*! \brief drop the reordered copy; reads go back to gathering by row id */
+  inline void ClearReorderedGradients() {
+    use_reordered_grads_ = false;
+    reorder_base_ = nullptr;
+  }
+
  private:
   /*! \brief number of threads for parallel computation */
   size_t nthread_;
   /*! \brief number of all bins over all features */
   uint32_t nbins_;
-  std::vector<GHistEntry> data_;
+  /*! \brief per-thread partial histograms, allocated without
+   *  value-initialization so the owning thread's first memset -- not the
+   *  allocating thread -- determines NUMA page placement */
+  std::unique_ptr<double[]> partials_;
+  size_t partials_size_{0};
   std::vector<size_t> thread_init_;
+  /*! \brief packed half precision copy of the gradient pairs */
+  std::vector<uint16_t> gpair_half_;
+  /*! \brief whether the packed copy is current and should be used */
+  bool use_compressed_grads_{false};
+  /*! \brief gradients in partition order, interleaved (grad, hess) */
+  std::vector<float> gpair_pos_;
+  /*! \brief half precision variant of gpair_pos_ */
+  std::vector<uint16_t> gpair_half_pos_;
+  /*! \brief whether the reordered copy is current and should be used */
+  bool use_reordered_grads_{false};
+  /*! \brief start of the partition array the reordered copy follows;
+   *  BuildHist derives a node's slice offset from it */
+  const void* reorder_base_{nullptr};
 };
 
 
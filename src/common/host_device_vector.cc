@@ -100,6 +100,14 @@ const std::vector<T>& HostDeviceVector<T>::ConstHostVector() const {
   return impl_->data_h_;
 }
 
+template <typename T>
+common::Span<T> HostDeviceVector<T>::HostSpan(size_t begin, size_t end) {
+  CHECK_LE(begin, end);
+  CHECK_LE(end, Size());
+  return {impl_->data_h_.data() + begin,
+      static_cast<typename common::Span<T>::index_type>(end - begin)};
+}
+
 template <typename T>
 void HostDeviceVector<T>::Resize(size_t new_size, T v) {
   impl_->data_h_.resize(new_size, v);
@@ -134,6 +142,20 @@ void HostDeviceVector<T>::Copy(std::initializer_list<T> other) {
   std::copy(other.begin(), other.end(), HostVector().begin());
 }
 
+template <typename T>
+void HostDeviceVector<T>::CopyStrided(const HostDeviceVector<T>& other,
+                                      size_t stride, size_t offset) {
+  CHECK_LT(offset, stride);
+  CHECK_EQ(Size() * stride, other.Size());
+  std::vector<T>& data_h = HostVector();
+  const std::vector<T>& other_h = other.ConstHostVector();
+  auto n = static_cast<bst_omp_uint>(data_h.size());
+  #pragma omp parallel for schedule(static)
+  for (bst_omp_uint i = 0; i < n; ++i) {
+    data_h[i] = other_h[i * stride + offset];
+  }
+}
+
 template <typename T>
 bool HostDeviceVector<T>::HostCanAccess(GPUAccess access) const {
   return true;
@@ -4,6 +4,9 @@
 
 #include "./host_device_vector.h"
 #include <thrust/fill.h>
+#include <thrust/gather.h>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/iterator/transform_iterator.h>
 #include <xgboost/data.h>
 #include <algorithm>
 #include <cstdint>
@@ -13,6 +16,14 @@
 
 namespace xgboost {
 
+// maps a destination index to its source index in a strided gather
+struct StridedIndexOp {
+  size_t stride, offset;
+  __host__ __device__ size_t operator()(size_t i) const {
+    return i * stride + offset;
+  }
+};
+
 // the handler to call instead of cudaSetDevice; only used for testing
 static void (*cudaSetDeviceHandler)(int) = nullptr;  // NOLINT
 
@@ -47,7 +58,8 @@ struct HostDeviceVectorImpl {
   struct DeviceShard {
     DeviceShard()
         : proper_size_(0), device_(-1), start_(0), perm_d_(false),
-        cached_size_(~0), vec_(nullptr) {}
+        cached_size_(~0), dirty_begin_(0), dirty_end_(0), in_sync_(false),
+        vec_(nullptr) {}
 
     void Init(HostDeviceVectorImpl<T>* vec, int device) {
       if (vec_ == nullptr) { vec_ = vec; }
@@ -67,21 +79,39 @@ struct HostDeviceVectorImpl {
       SetDevice();
       data_.resize(other.data_.size());
       perm_d_ = other.perm_d_;
+      // the device buffer is not copied; force a full upload on the next sync
+      dirty_begin_ = dirty_end_ = 0;
+      in_sync_ = false;
+    }
+
+    // Records that [begin, end) of the host data was modified and has not yet
+    // been applied to this shard. Kept as a single hull interval: unioning
+    // disjoint spans over-copies the gap, but stays trivially cheap to track.
+    void MarkDirty(size_t begin, size_t end) {
+      if (begin >= end) { return; }
+      if (dirty_begin_ >= dirty_end_) {
+        dirty_begin_ = begin;
+        dirty_end_ = end;
+      } else {
+        dirty_begin_ = std::min(dirty_begin_, begin);
+        dirty_end_ = std::max(dirty_end_, end);
+      }
     }
 
-    void ScatterFrom(const T* begin) {
+    void ScatterFrom(const T* begin, dh::MemcpyBatch* batch) {
       // TODO(canonizer): avoid full copy of host data
       LazySyncDevice(GPUAccess::kWrite);
       SetDevice();
-      dh::safe_cuda(cudaMemcpy(data_.data().get(), begin + start_,
-                               data_.size() * sizeof(T), cudaMemcpyDefault));
+      // begin may point to host or device memory; let the driver resolve it
+      batch->Add(data_.data().get(), begin + start_,
+                 data_.size() * sizeof(T), device_);
     }
 
-    void GatherTo(thrust::device_ptr<T> begin) {
+    void GatherTo(thrust::device_ptr<T> begin, dh::MemcpyBatch* batch) {
       LazySyncDevice(GPUAccess::kRead);
       SetDevice();
-      dh::safe_cuda(cudaMemcpy(begin.get() + start_, data_.data().get(),
-                               proper_size_ * sizeof(T), cudaMemcpyDefault));
+      batch->Add(begin.get() + start_, data_.data().get(),
+                 proper_size_ * sizeof(T), device_);
     }
 
     void Fill(T v) {
@@ -91,21 +121,23 @@ struct HostDeviceVectorImpl {
       thrust::fill(data_.begin(), data_.end(), v);
     }
 
-    void Copy(DeviceShard* other) {
+    void Copy(DeviceShard* other, dh::MemcpyBatch* batch) {
       // TODO(canonizer): avoid full copy of host data for this (but not for other)
       LazySyncDevice(GPUAccess::kWrite);
       other->LazySyncDevice(GPUAccess::kRead);
       SetDevice();
-      dh::safe_cuda(cudaMemcpy(data_.data().get(), other->data_.data().get(),
-                               data_.size() * sizeof(T), cudaMemcpyDefault));
+      batch->Add(data_.data().get(), other->data_.data().get(),
+                 data_.size() * sizeof(T), device_);
     }
 
     void LazySyncHost(GPUAccess access) {
       SetDevice();
-      dh::safe_cuda(cudaMemcpy(vec_->data_h_.data() + start_,
-                               data_.data().get(),  proper_size_ * sizeof(T),
-                               cudaMemcpyDeviceToHost));
+      dh::StagedCopyDeviceToHost(vec_->data_h_.data() + start_,
+                                 data_.data().get(),
+                                 proper_size_ * sizeof(T));
       perm_d_.DenyComplementary(access);
+      // the device buffer now mirrors the host data
+      in_sync_ = true;
     }
 
     void LazyResize(size_t new_size) {
@@ -120,6 +152,8 @@ struct HostDeviceVectorImpl {
       SetDevice();
       data_.resize(size_d);
       cached_size_ = new_size;
+      // the resized buffer no longer mirrors the host data
+      in_sync_ = false;
     }
 
     void LazySyncDevice(GPUAccess access) {
@@ -135,9 +169,23 @@ struct HostDeviceVectorImpl {
       size_t size_h = vec_->data_h_.size();
       LazyResize(size_h);
       SetDevice();
-      dh::safe_cuda(
-          cudaMemcpy(data_.data().get(), vec_->data_h_.data() + start_,
-                     data_.size() * sizeof(T), cudaMemcpyHostToDevice));
+      if (in_sync_ && data_.size() == proper_size_) {
+        // the device buffer already mirrors the host data outside the dirty
+        // range; copy only the modified span that overlaps this shard
+        size_t begin = std::max(dirty_begin_, start_);
+        size_t end = std::min(dirty_end_, start_ + data_.size());
+        if (begin < end) {
+          dh::StagedCopyHostToDevice(data_.data().get() + (begin - start_),
+                                     vec_->data_h_.data() + begin,
+                                     (end - begin) * sizeof(T));
+        }
+      } else {
+        dh::StagedCopyHostToDevice(data_.data().get(),
+                                   vec_->data_h_.data() + start_,
+                                   data_.size() * sizeof(T));
+        in_sync_ = true;
+      }
+      dirty_begin_ = dirty_end_ = 0;
       perm_d_.Grant(access);
 
       std::lock_guard<std::mutex> lock(vec_->mutex_);
@@ -160,6 +208,12 @@ struct HostDeviceVectorImpl {
     size_t start_;
     // size of the portion to copy back to the host
     size_t proper_size_;
+    // host range modified since the last sync of this shard; empty when
+    // dirty_begin_ >= dirty_end_
+    size_t dirty_begin_;
+    size_t dirty_end_;
+    // whether the device buffer mirrors the host data outside the dirty range
+    bool in_sync_;
     Permissions perm_d_;
     HostDeviceVectorImpl<T>* vec_;
   };
@@ -271,30 +325,37 @@ struct HostDeviceVectorImpl {
   void ScatterFrom(thrust::device_ptr<const T> begin, thrust::device_ptr<const T> end) {
     CHECK_EQ(end - begin, Size());
     if (perm_h_.CanWrite()) {
-      dh::safe_cuda(cudaMemcpy(data_h_.data(), begin.get(),
-                               (end - begin) * sizeof(T),
-                               cudaMemcpyDeviceToHost));
+      dh::StagedCopyDeviceToHost(data_h_.data(), begin.get(),
+                                 (end - begin) * sizeof(T));
+      MarkHostDirty(0, data_h_.size());
     } else {
+    // issue all per-device segment copies concurrently, then wait once
+    dh::MemcpyBatch batch;
     dh::ExecuteIndexShards(&shards_, [&](int idx, DeviceShard& shard) {
-        shard.ScatterFrom(begin.get());
+        shard.ScatterFrom(begin.get(), &batch);
       });
+    batch.Wait();
     }
   }
 
   void GatherTo(thrust::device_ptr<T> begin, thrust::device_ptr<T> end) {
     CHECK_EQ(end - begin, Size());
     if (perm_h_.CanWrite()) {
-      dh::safe_cuda(cudaMemcpy(begin.get(), data_h_.data(),
-                               data_h_.size() * sizeof(T),
-                               cudaMemcpyHostToDevice));
+      dh::StagedCopyHostToDevice(begin.get(), data_h_.data(),
+                                 data_h_.size() * sizeof(T));
     } else {
-      dh::ExecuteIndexShards(&shards_, [&](int idx, DeviceShard& shard) { shard.GatherTo(begin); });
+      dh::MemcpyBatch batch;
+      dh::ExecuteIndexShards(&shards_, [&](int idx, DeviceShard& shard) {
+          shard.GatherTo(begin, &batch);
+        });
+      batch.Wait();
     }
   }
 
   void Fill(T v) {
     if (perm_h_.CanWrite()) {
       std::fill(data_h_.begin(), data_h_.end(), v);
+      MarkHostDirty(0, data_h_.size());
     } else {
       dh::ExecuteIndexShards(&shards_, [&](int idx, DeviceShard& shard) { shard.Fill(v); });
     }
@@ -305,6 +366,7 @@ struct HostDeviceVectorImpl {
     // Data is on host.
     if (perm_h_.CanWrite() && other->perm_h_.CanWrite()) {
       std::copy(other->data_h_.begin(), other->data_h_.end(), data_h_.begin());
+      MarkHostDirty(0, data_h_.size());
       return;
     }
     // Data is on device;
@@ -313,19 +375,24 @@ struct HostDeviceVectorImpl {
       Reshard(other->Distribution());
       size_d_ = other->size_d_;
     }
+    dh::MemcpyBatch batch;
     dh::ExecuteIndexShards(&shards_, [&](int i, DeviceShard& shard) {
-        shard.Copy(&other->shards_.at(i));
+        shard.Copy(&other->shards_.at(i), &batch);
       });
+    batch.Wait();
   }
 
   void Copy(const std::vector<T>& other) {
     CHECK_EQ(Size(), other.size());
     if (perm_h_.CanWrite()) {
       std::copy(other.begin(), other.end(), data_h_.begin());
+      MarkHostDirty(0, data_h_.size());
     } else {
+      dh::MemcpyBatch batch;
       dh::ExecuteIndexShards(&shards_, [&](int idx, DeviceShard& shard) {
-          shard.ScatterFrom(other.data());
+          shard.ScatterFrom(other.data(), &batch);
         });
+      batch.Wait();
     }
   }
 
@@ -333,18 +400,67 @@ struct HostDeviceVectorImpl {
     CHECK_EQ(Size(), other.size());
     if (perm_h_.CanWrite()) {
       std::copy(other.begin(), other.end(), data_h_.begin());
+      MarkHostDirty(0, data_h_.size());
     } else {
+      dh::MemcpyBatch batch;
       dh::ExecuteIndexShards(&shards_, [&](int idx, DeviceShard& shard) {
-          shard.ScatterFrom(other.begin());
+          shard.ScatterFrom(other.begin(), &batch);
         });
+      batch.Wait();
+    }
+  }
+
+  void CopyStrided(HostDeviceVectorImpl<T>* other, size_t stride, size_t offset) {
+    CHECK_LT(offset, stride);
+    CHECK_EQ(Size() * stride, other->Size());
+    GPUSet devices = distribution_.Devices();
+    // gather on the device if both vectors fit on a single common device;
+    // a general cross-shard gather is not supported, as the source shard
+    // boundaries need not be aligned to the stride
+    if (devices.Size() == 1 && other->distribution_.Devices() == devices) {
+      DeviceShard& shard = shards_.at(0);
+      // TODO(canonizer): avoid full copy of host data for this (but not for other)
+      shard.LazySyncDevice(GPUAccess::kWrite);
+      other->shards_.at(0).LazySyncDevice(GPUAccess::kRead);
+      shard.SetDevice();
+      auto map_begin = thrust::make_transform_iterator(
+          thrust::make_counting_iterator<size_t>(0),
+          StridedIndexOp{stride, offset});
+      thrust::gather(map_begin, map_begin + shard.data_.size(),
+                     other->shards_.at(0).data_.begin(), shard.data_.begin());
+    } else {
+      std::vector<T>& data_h = HostVector();
+      const std::vector<T>& other_h = other->ConstHostVector();
+      auto n = static_cast<bst_omp_uint>(data_h.size());
+      #pragma omp parallel for schedule(static)
+      for (bst_omp_uint i = 0; i < n; ++i) {
+        data_h[i] = other_h[i * stride + offset];
+      }
+    }
+  }
+
+  // marks [begin, end) of the host data as modified on all shards
+  void MarkHostDirty(size_t begin, size_t end) {
+    for (auto& shard : shards_) {
+      shard.MarkDirty(begin, end);
     }
   }
 
   std::vector<T>& HostVector() {
     LazySyncHost(GPUAccess::kWrite);
+    MarkHostDirty(0, data_h_.size());
     return data_h_;
   }
 
+  common::Span<T> HostSpan(size_t begin, size_t end) {
+    CHECK_LE(begin, end);
+    CHECK_LE(end, Size());
+    LazySyncHost(GPUAccess::kWrite);
+    MarkHostDirty(begin, end);
+    return {data_h_.data() + begin,
+        static_cast<typename common::Span<T>::index_type>(end - begin)};
+  }
+
   const std::vector<T>& ConstHostVector() {
     LazySyncHost(GPUAccess::kRead);
     return data_h_;
@@ -557,9 +673,20 @@ void HostDeviceVector<T>::Copy(std::initializer_list<T> other) {
   impl_->Copy(other);
 }
 
+template <typename T>
+void HostDeviceVector<T>::CopyStrided(const HostDeviceVector<T>& other,
+                                      size_t stride, size_t offset) {
+  impl_->CopyStrided(other.impl_, stride, offset);
+}
+
 template <typename T>
 std::vector<T>& HostDeviceVector<T>::HostVector() { return impl_->HostVector(); }
 
+template <typename T>
+common::Span<T> HostDeviceVector<T>::HostSpan(size_t begin, size_t end) {
+  return impl_->HostSpan(begin, end);
+}
+
 template <typename T>
 const std::vector<T>& HostDeviceVector<T>::ConstHostVector() const {
   return impl_->ConstHostVector();
@@ -240,10 +240,30 @@ class HostDeviceVector {
   void Copy(const std::vector<T>& other);
   void Copy(std::initializer_list<T> other);
 
+  /*!
+   * \brief Gather every stride-th element of other, starting at offset.
+   *
+   *   Used to slice the gradients of one group out of an interleaved
+   *   gradient vector. When both vectors reside on the same single device
+   *   the gather runs there; otherwise it falls back to the host.
+   */
+  void CopyStrided(const HostDeviceVector<T>& other, size_t stride, size_t offset);
+
   std::vector<T>& HostVector();
   const std::vector<T>& ConstHostVector() const;
   const std::vector<T>& HostVector() const {return ConstHostVector(); }
 
+  /*!
+   * \brief Get write access to a sub-range of the host data.
+   *
+   *   Like HostVector(), this synchronizes the data to the host and grants
+   *   host write access, but it marks only [begin, end) as modified. The next
+   *   device synchronization then transfers just the modified range instead
+   *   of the whole vector. Elements outside the returned span must not be
+   *   written through stale pointers while the span is in use.
+   */
+  common::Span<T> HostSpan(size_t begin, size_t end);
+
   bool HostCanAccess(GPUAccess access) const;
   bool DeviceCanAccess(int device, GPUAccess access) const;
 
@@ -0,0 +1,44 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file memory_stats.cc
+ * \brief Process-wide current/peak memory accounting per subsystem.
+ */
+#include "./memory_stats.h"
+
+#include <sstream>
+
+namespace xgboost {
+namespace common {
+
+MemoryStats* MemoryStats::Get() {
+  static MemoryStats instance;
+  return &instance;
+}
+
+MemoryStats::Component* MemoryStats::GetComponent(const std::string& name) {
+  std::lock_guard<std::mutex> guard(mu_);
+  for (const auto& c : components_) {
+    if (c->Name() == name) return c.get();
+  }
+  components_.emplace_back(new Component(name));
+  return components_.back().get();
+}
+
+std::string MemoryStats::DumpJson() {
+  std::lock_guard<std::mutex> guard(mu_);
+  std::ostringstream os;
+  os << "{\"memory\":[";
+  bool first = true;
+  for (const auto& c : components_) {
+    if (!first) os << ",";
+    first = false;
+    os << "{\"component\":\"" << c->Name() << "\""
+       << ",\"current_bytes\":" << c->Current()
+       << ",\"peak_bytes\":" << c->Peak() << "}";
+  }
+  os << "]}";
+  return os.str();
+}
+
+}  // namespace common
+}  // namespace xgboost
@@ -0,0 +1,101 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file memory_stats.h
+ * \brief Process-wide current/peak memory accounting per subsystem.
+ */
+#ifndef XGBOOST_COMMON_MEMORY_STATS_H_
+#define XGBOOST_COMMON_MEMORY_STATS_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace xgboost {
+namespace common {
+
+/*!
+ * \brief Byte accounting for the large buffers of the library.
+ *
+ *  Subsystems register a named component once and report allocation and
+ *  release through it; updates are relaxed atomics, cheap enough to stay
+ *  on in production. XGBMemoryStatsDump() exposes the current and peak
+ *  bytes of every component as JSON.
+ */
+class MemoryStats {
+ public:
+  class Component {
+   public:
+    explicit Component(std::string name) : name_(std::move(name)) {}
+    /*! \brief report bytes acquired; maintains the peak watermark */
+    void Add(int64_t bytes) {
+      const int64_t cur =
+          current_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+      int64_t peak = peak_.load(std::memory_order_relaxed);
+      while (cur > peak &&
+             !peak_.compare_exchange_weak(peak, cur,
+                                          std::memory_order_relaxed)) {
+      }
+    }
+    /*! \brief report bytes released */
+    void Sub(int64_t bytes) {
+      current_.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+    const std::string& Name() const { return name_; }
+    int64_t Current() const {
+      return current_.load(std::memory_order_relaxed);
+    }
+    int64_t Peak() const { return peak_.load(std::memory_order_relaxed); }
+
+   private:
+    std::string name_;
+    std::atomic<int64_t> current_{0};
+    std::atomic<int64_t> peak_{0};
+  };
+
+  /*! \brief process-wide singleton */
+  static MemoryStats* Get();
+  /*!
+   * \brief look up or register a component; the returned pointer is
+   *  stable for the process lifetime, so call sites cache it in a static
+   */
+  Component* GetComponent(const std::string& name);
+  /*! \brief current/peak bytes of every component as JSON */
+  std::string DumpJson();
+
+ private:
+  MemoryStats() = default;
+  std::mutex mu_;
+  std::vector<std::unique_ptr<Component>> components_;
+};
+
+/*!
+ * \brief helper owning the accounted footprint of one object: assign the
+ *  new footprint and the delta is reported to the component; the
+ *  remainder is released on destruction.
+ */
+class AccountedBytes {
+ public:
+  explicit AccountedBytes(const char* component)
+      : component_(MemoryStats::Get()->GetComponent(component)) {}
+  ~AccountedBytes() { component_->Sub(static_cast<int64_t>(accounted_)); }
+  AccountedBytes(const AccountedBytes&) = delete;
+  void operator=(const AccountedBytes&) = delete;
+
+  void Update(size_t bytes) {
+    component_->Add(static_cast<int64_t>(bytes) -
+                    static_cast<int64_t>(accounted_));
+    accounted_ = bytes;
+  }
+
+ private:
+  MemoryStats::Component* component_;
+  size_t accounted_{0};
+};
+
+}  // namespace common
+}  // namespace xgboost
+#endif  // XGBOOST_COMMON_MEMORY_STATS_H_
@@ -242,27 +242,23 @@ struct WQSummary {
     RType aprev_rmin = 0, bprev_rmin = 0;
     Entry *dst = this->data;
     while (a != a_end && b != b_end) {
-      // duplicated value entry
-      if (a->value == b->value) {
-        *dst = Entry(a->rmin + b->rmin,
-                     a->rmax + b->rmax,
-                     a->wmin + b->wmin, a->value);
-        aprev_rmin = a->RMinNext();
-        bprev_rmin = b->RMinNext();
-        ++dst; ++a; ++b;
-      } else if (a->value < b->value) {
-        *dst = Entry(a->rmin + bprev_rmin,
-                     a->rmax + b->RMaxPrev(),
-                     a->wmin, a->value);
-        aprev_rmin = a->RMinNext();
-        ++dst; ++a;
-      } else {
-        *dst = Entry(b->rmin + aprev_rmin,
-                     b->rmax + a->RMaxPrev(),
-                     b->wmin, b->value);
-        bprev_rmin = b->RMinNext();
-        ++dst; ++b;
-      }
+      const Entry ea = *a, eb = *b;
+      // one comparison pair covers the duplicate/less/greater cases; the
+      // rank arithmetic below is expressed with selects instead of
+      // branches so the compiler can lower it to cmov/blend and the loop
+      // body stays free of data-dependent branch mispredictions
+      const bool take_a = !(eb.value < ea.value);  // ea.value <= eb.value
+      const bool take_b = !(ea.value < eb.value);  // eb.value <= ea.value
+      const RType rmin = (take_a ? ea.rmin : aprev_rmin) +
+                         (take_b ? eb.rmin : bprev_rmin);
+      const RType rmax = (take_a ? ea.rmax : ea.rmax - ea.wmin) +
+                         (take_b ? eb.rmax : eb.rmax - eb.wmin);
+      const RType wmin = (take_a ? ea.wmin : RType(0)) +
+                         (take_b ? eb.wmin : RType(0));
+      *dst = Entry(rmin, rmax, wmin, take_a ? ea.value : eb.value);
+      ++dst;
+      if (take_a) { aprev_rmin = ea.rmin + ea.wmin; ++a; }
+      if (take_b) { bprev_rmin = eb.rmin + eb.wmin; ++b; }
     }
     if (a != a_end) {
       RType brmax = (b_end - 1)->rmax;
@@ -623,6 +619,9 @@ class QuantileSketchTemplate {
     }
     /*!
      * \brief set the space to be merge of all Summary arrays
+     *  performs a balanced tournament of pairwise combines, so merging k
+     *  summaries costs O(log k) passes over the data rather than the
+     *  O(k) of chaining them one after another
      * \param begin beginning position in the summary array
      * \param end ending position in the Summary array
      */
@@ -635,12 +634,12 @@ class QuantileSketchTemplate {
         this->CopyFrom(begin[0]);
       } else if (len == 2) {
         this->Reserve(begin[0].size + begin[1].size);
-        this->SetMerge(begin[0], begin[1]);
+        this->SetCombine(begin[0], begin[1]);
       } else {
         // recursive merge
         SummaryContainer lhs, rhs;
-        lhs.SetCombine(begin, begin + len / 2);
-        rhs.SetCombine(begin + len / 2, end);
+        lhs.SetMerge(begin, begin + len / 2);
+        rhs.SetMerge(begin + len / 2, end);
         this->Reserve(lhs.size + rhs.size);
         this->SetCombine(lhs, rhs);
       }
@@ -73,6 +73,64 @@ using GlobalRandomEngine = RandomEngine;
  */
 GlobalRandomEngine& GlobalRandom(); // NOLINT(*)
 
+/**
+ * \class AliasTable
+ *
+ * \brief Walker/Vose alias table: linear-time construction from a weight
+ * vector, constant-time weighted index draws afterwards.
+ */
+class AliasTable {
+ public:
+  /*! \brief build the table; negative weights are treated as zero */
+  void Build(const std::vector<bst_float>& weights) {
+    n_ = weights.size();
+    prob_.resize(n_);
+    alias_.resize(n_);
+    double wsum = 0.0;
+    for (bst_float w : weights) {
+      wsum += std::max(w, 0.0f);
+    }
+    if (n_ == 0 || wsum <= 0.0) {
+      n_ = 0;  // degenerate; callers should fall back to uniform sampling
+      return;
+    }
+    std::vector<double> scaled(n_);
+    std::vector<size_t> small, large;
+    for (size_t i = 0; i < n_; ++i) {
+      scaled[i] = std::max(weights[i], 0.0f) * n_ / wsum;
+      (scaled[i] < 1.0 ? small : large).push_back(i);
+    }
+    while (!small.empty() && !large.empty()) {
+      const size_t s = small.back(); small.pop_back();
+      const size_t l = large.back(); large.pop_back();
+      prob_[s] = scaled[s];
+      alias_[s] = l;
+      scaled[l] -= 1.0 - scaled[s];
+      (scaled[l] < 1.0 ? small : large).push_back(l);
+    }
+    // leftovers are 1.0 up to rounding
+    for (size_t s : small) { prob_[s] = 1.0; alias_[s] = s; }
+    for (size_t l : large) { prob_[l] = 1.0; alias_[l] = l; }
+  }
+
+  /*! \brief true if no positive weight was supplied */
+  bool Empty() const { return n_ == 0; }
+
+  /*! \brief draw one index with probability proportional to its weight */
+  template <typename Rng>
+  size_t Sample(Rng* rng) const {
+    std::uniform_real_distribution<double> unif(0.0, 1.0);
+    auto i = static_cast<size_t>(unif(*rng) * n_);
+    if (i >= n_) i = n_ - 1;
+    return unif(*rng) < prob_[i] ? i : alias_[i];
+  }
+
+ private:
+  std::vector<double> prob_;
+  std::vector<size_t> alias_;
+  size_t n_{0};
+};
+
 /**
  * \class ColumnSampler
  *
@@ -87,19 +145,83 @@ class ColumnSampler {
   float colsample_bylevel_{1.0f};
   float colsample_bytree_{1.0f};
   float colsample_bynode_{1.0f};
+  // reused working copy for the partial Fisher-Yates draw
+  std::vector<int> scratch_;
+  // recycled output sets: an entry whose only owner is the pool is free.
+  // Per-node sampling then stops allocating once the first tree has warmed
+  // the pool up
+  std::vector<std::shared_ptr<std::vector<int>>> pool_;
+  // weighted sampling state
+  AliasTable alias_;
+  bool use_weights_{false};
+  std::vector<unsigned> member_stamp_;
+  std::vector<unsigned> taken_stamp_;
+  unsigned stamp_{0};
+
+  std::shared_ptr<std::vector<int>> AllocFromPool() {
+    for (auto& p : pool_) {
+      if (p.use_count() == 1) return p;
+    }
+    pool_.push_back(std::make_shared<std::vector<int>>());
+    return pool_.back();
+  }
+
+  // draw n distinct members of features, weighted by the alias table built
+  // over all columns. Non-members and repeats are rejected through epoch
+  // stamps, so a draw is O(1) expected as long as the subset is a constant
+  // fraction of the columns
+  void SampleWeighted(const std::vector<int>& features, int n,
+                      std::vector<int>* out) {
+    ++stamp_;
+    for (int fid : features) {
+      member_stamp_[fid] = stamp_;
+    }
+    out->clear();
+    auto& rnd = common::GlobalRandom();
+    size_t attempts = 0;
+    const size_t max_attempts = 16 * static_cast<size_t>(n) + 256;
+    while (static_cast<int>(out->size()) < n && attempts < max_attempts) {
+      ++attempts;
+      const auto fid = static_cast<int>(alias_.Sample(&rnd));
+      if (member_stamp_[fid] == stamp_ && taken_stamp_[fid] != stamp_) {
+        taken_stamp_[fid] = stamp_;
+        out->push_back(fid);
+      }
+    }
+    // zero-weight features or tiny subsets can starve the rejection loop;
+    // top up deterministically from the remaining members
+    for (size_t i = 0; i < features.size()
+         && static_cast<int>(out->size()) < n; ++i) {
+      if (taken_stamp_[features[i]] != stamp_) {
+        taken_stamp_[features[i]] = stamp_;
+        out->push_back(features[i]);
+      }
+    }
+  }
 
   std::shared_ptr<std::vector<int>> ColSample
-    (std::shared_ptr<std::vector<int>> p_features, float colsample) const {
+    (std::shared_ptr<std::vector<int>> p_features, float colsample) {
     if (colsample == 1.0f) return p_features;
     const auto& features = *p_features;
     CHECK_GT(features.size(), 0);
     int n = std::max(1, static_cast<int>(colsample * features.size()));
-    auto p_new_features = std::make_shared<std::vector<int>>();
+    auto p_new_features = AllocFromPool();
     auto& new_features = *p_new_features;
-    new_features.resize(features.size());
-    std::copy(features.begin(), features.end(), new_features.begin());
-    std::shuffle(new_features.begin(), new_features.end(), common::GlobalRandom());
-    new_features.resize(n);
+
+    if (use_weights_) {
+      SampleWeighted(features, n, &new_features);
+    } else {
+      // partial Fisher-Yates: only the n handed-out slots are shuffled and
+      // the working copy lives in a reused buffer, so the draw neither
+      // allocates nor permutes the whole feature list
+      scratch_.assign(features.begin(), features.end());
+      auto& rnd = common::GlobalRandom();
+      for (int i = 0; i < n; ++i) {
+        std::uniform_int_distribution<size_t> dist(i, scratch_.size() - 1);
+        std::swap(scratch_[i], scratch_[dist(rnd)]);
+      }
+      new_features.assign(scratch_.begin(), scratch_.begin() + n);
+    }
     std::sort(new_features.begin(), new_features.end());
 
     // ensure that new_features are the same across ranks
@@ -117,13 +239,28 @@ class ColumnSampler {
    * \param colsample_bylevel
    * \param colsample_bytree
    * \param skip_index_0      (Optional) True to skip index 0.
+   * \param feature_weights   (Optional) Per-column sampling weights, e.g.
+   *                          feature importance; when given, every column
+   *                          draw is weighted through an alias table built
+   *                          once here instead of uniform.
    */
   void Init(int64_t num_col, float colsample_bynode, float colsample_bylevel,
-            float colsample_bytree, bool skip_index_0 = false) {
+            float colsample_bytree, bool skip_index_0 = false,
+            const std::vector<bst_float>* feature_weights = nullptr) {
     colsample_bylevel_ = colsample_bylevel;
     colsample_bytree_ = colsample_bytree;
     colsample_bynode_ = colsample_bynode;
 
+    use_weights_ = feature_weights != nullptr && !feature_weights->empty();
+    if (use_weights_) {
+      CHECK_EQ(static_cast<int64_t>(feature_weights->size()), num_col);
+      alias_.Build(*feature_weights);
+      use_weights_ = !alias_.Empty();
+      member_stamp_.assign(num_col, 0);
+      taken_stamp_.assign(num_col, 0);
+      stamp_ = 0;
+    }
+
     if (feature_set_tree_ == nullptr) {
       feature_set_tree_ = std::make_shared<std::vector<int>>();
     }
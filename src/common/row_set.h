@@ -14,21 +14,30 @@
 namespace xgboost {
 namespace common {
 
-/*! \brief collection of rowset */
-class RowSetCollection {
+/*!
+ * \brief collection of rowset, templated on the row index width.
+ *  Updaters working on data with fewer than 2^32 rows can pick a 32-bit
+ *  index, halving the memory traffic of the partition arrays.
+ */
+template <typename RowIdxT>
+class RowSetCollectionT {
  public:
+  /*! \brief the row index type of this collection */
+  using RowIdx = RowIdxT;
   /*! \brief data structure to store an instance set, a subset of
    *  rows (instances) associated with a particular node in a decision
    *  tree. */
   struct Elem {
-    const size_t* begin{nullptr};
-    const size_t* end{nullptr};
+    /*! \brief the row index type of the collection */
+    using IndexT = RowIdxT;
+    const RowIdxT* begin{nullptr};
+    const RowIdxT* end{nullptr};
     int node_id{-1};
       // id of node associated with this instance set; -1 means uninitialized
     Elem()
          = default;
-    Elem(const size_t* begin,
-         const size_t* end,
+    Elem(const RowIdxT* begin,
+         const RowIdxT* end,
          int node_id)
         : begin(begin), end(end), node_id(node_id) {}
 
@@ -38,15 +47,15 @@ class RowSetCollection {
   };
   /* \brief specifies how to split a rowset into two */
   struct Split {
-    std::vector<size_t> left;
-    std::vector<size_t> right;
+    std::vector<RowIdxT> left;
+    std::vector<RowIdxT> right;
   };
 
-  inline std::vector<Elem>::const_iterator begin() const {  // NOLINT
+  inline typename std::vector<Elem>::const_iterator begin() const {  // NOLINT
     return elem_of_each_node_.begin();
   }
 
-  inline std::vector<Elem>::const_iterator end() const {  // NOLINT
+  inline typename std::vector<Elem>::const_iterator end() const {  // NOLINT
     return elem_of_each_node_.end();
   }
 
@@ -62,6 +71,10 @@ class RowSetCollection {
     row_indices_.clear();
     elem_of_each_node_.clear();
   }
+  // reserve the per-node element table, so AddSplit never reallocates
+  inline void Reserve(size_t num_nodes) {
+    elem_of_each_node_.reserve(num_nodes);
+  }
   // initialize node id 0->everything
   inline void Init() {
     CHECK_EQ(elem_of_each_node_.size(), 0U);
@@ -72,14 +85,14 @@ class RowSetCollection {
       //  indicate a valid rowset that happens to have zero length and occupies
       //  the whole instance set)
       // this is okay, as BuildHist will compute (end-begin) as the set size
-      const size_t* begin = reinterpret_cast<size_t*>(20);
-      const size_t* end = begin;
+      const RowIdxT* begin = reinterpret_cast<RowIdxT*>(20);
+      const RowIdxT* end = begin;
       elem_of_each_node_.emplace_back(Elem(begin, end, 0));
       return;
     }
 
-    const size_t* begin = dmlc::BeginPtr(row_indices_);
-    const size_t* end = dmlc::BeginPtr(row_indices_) + row_indices_.size();
+    const RowIdxT* begin = dmlc::BeginPtr(row_indices_);
+    const RowIdxT* end = dmlc::BeginPtr(row_indices_) + row_indices_.size();
     elem_of_each_node_.emplace_back(Elem(begin, end, 0));
   }
   // split rowset into two
@@ -90,19 +103,29 @@ class RowSetCollection {
     const Elem e = elem_of_each_node_[node_id];
     const auto nthread = static_cast<bst_omp_uint>(row_split_tloc.size());
     CHECK(e.begin != nullptr);
-    size_t* all_begin = dmlc::BeginPtr(row_indices_);
-    size_t* begin = all_begin + (e.begin - all_begin);
-
-    size_t* it = begin;
+    RowIdxT* all_begin = dmlc::BeginPtr(row_indices_);
+    RowIdxT* begin = all_begin + (e.begin - all_begin);
+
+    /* exclusive prefix sums over the per-thread buffer sizes give every
+       thread its output offset, so the copy back into the row index array
+       runs fully in parallel while keeping the same stable order as the
+       previous serial sweep */
+    std::vector<size_t> left_offset(nthread + 1, 0);
+    std::vector<size_t> right_offset(nthread + 1, 0);
     for (bst_omp_uint tid = 0; tid < nthread; ++tid) {
-      std::copy(row_split_tloc[tid].left.begin(), row_split_tloc[tid].left.end(), it);
-      it += row_split_tloc[tid].left.size();
+      left_offset[tid + 1] = left_offset[tid] + row_split_tloc[tid].left.size();
+      right_offset[tid + 1] = right_offset[tid] + row_split_tloc[tid].right.size();
     }
-    size_t* split_pt = it;
+    const size_t n_left = left_offset[nthread];
+
+    #pragma omp parallel for schedule(static)
     for (bst_omp_uint tid = 0; tid < nthread; ++tid) {
-      std::copy(row_split_tloc[tid].right.begin(), row_split_tloc[tid].right.end(), it);
-      it += row_split_tloc[tid].right.size();
+      std::copy(row_split_tloc[tid].left.begin(), row_split_tloc[tid].left.end(),
+                begin + left_offset[tid]);
+      std::copy(row_split_tloc[tid].right.begin(), row_split_tloc[tid].right.end(),
+                begin + n_left + right_offset[tid]);
     }
+    RowIdxT* split_pt = begin + n_left;
 
     if (left_node_id >= elem_of_each_node_.size()) {
       elem_of_each_node_.resize(left_node_id + 1, Elem(nullptr, nullptr, -1));
@@ -117,13 +140,16 @@ class RowSetCollection {
   }
 
   // stores the row indices in the set
-  std::vector<size_t> row_indices_;
+  std::vector<RowIdxT> row_indices_;
 
  private:
   // vector: node_id -> elements
   std::vector<Elem> elem_of_each_node_;
 };
 
+/*! \brief the default collection keeps full width indices */
+using RowSetCollection = RowSetCollectionT<size_t>;
+
 }  // namespace common
 }  // namespace xgboost
 
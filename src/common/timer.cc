@@ -0,0 +1,190 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file timer.cc
+ * \brief Hierarchical profiler behind common::Monitor.
+ */
+#include <dmlc/parameter.h>
+#include <sstream>
+
+#include "./timer.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+  #if defined(_MSC_VER)
+    #include <intrin.h>
+  #else
+    #include <x86intrin.h>
+  #endif
+  #define XGBOOST_PROFILER_RDTSC 1
+#endif
+
+namespace xgboost {
+namespace common {
+
+struct Profiler::ThreadTree {
+  Node root;
+  Node* current{&root};
+  // tick of each open scope, innermost last
+  std::vector<uint64_t> enter_ticks;
+  ThreadTree() { root.name = "root"; }
+};
+
+Profiler* Profiler::Get() {
+  static Profiler instance;
+  return &instance;
+}
+
+bool Profiler::Enabled() {
+  static const bool kEnabled = dmlc::GetEnv("XGBOOST_PROFILE", 0) != 0;
+  return kEnabled;
+}
+
+Profiler::Profiler()
+    : base_ticks_(Now()), base_time_(std::chrono::steady_clock::now()) {}
+
+uint64_t Profiler::Now() {
+#if defined(XGBOOST_PROFILER_RDTSC)
+  return __rdtsc();
+#else
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+Profiler::ThreadTree* Profiler::GetThreadTree() {
+  static thread_local ThreadTree* tree = nullptr;
+  if (tree == nullptr) {
+    std::lock_guard<std::mutex> lock(mu_);
+    threads_.emplace_back(new ThreadTree());
+    tree = threads_.back().get();
+  }
+  return tree;
+}
+
+void Profiler::Enter(const std::string& name) {
+  if (!Enabled()) return;
+  ThreadTree* t = this->GetThreadTree();
+  Node* cur = t->current;
+  Node* child = nullptr;
+  for (auto& c : cur->children) {
+    if (c->name == name) {
+      child = c.get();
+      break;
+    }
+  }
+  if (child == nullptr) {
+    cur->children.emplace_back(new Node());
+    child = cur->children.back().get();
+    child->name = name;
+    child->parent = cur;
+  }
+  t->current = child;
+  t->enter_ticks.push_back(Now());
+}
+
+void Profiler::Leave() {
+  if (!Enabled()) return;
+  ThreadTree* t = this->GetThreadTree();
+  if (t->current == &t->root) return;  // unmatched Leave; ignore
+  t->current->ticks += Now() - t->enter_ticks.back();
+  t->enter_ticks.pop_back();
+  ++t->current->count;
+  t->current = t->current->parent;
+}
+
+void Profiler::AddBytes(uint64_t n) {
+  if (!Enabled()) return;
+  this->GetThreadTree()->current->bytes += n;
+}
+
+namespace {
+
+// merge src into the child of dst carrying the same name, by scope path
+void MergeTree(const Profiler::Node& src, Profiler::Node* dst) {
+  Profiler::Node* into = nullptr;
+  for (auto& c : dst->children) {
+    if (c->name == src.name) {
+      into = c.get();
+      break;
+    }
+  }
+  if (into == nullptr) {
+    dst->children.emplace_back(new Profiler::Node());
+    into = dst->children.back().get();
+    into->name = src.name;
+    into->parent = dst;
+  }
+  into->ticks += src.ticks;
+  into->count += src.count;
+  into->bytes += src.bytes;
+  for (const auto& c : src.children) {
+    MergeTree(*c, into);
+  }
+}
+
+void WriteJson(const Profiler::Node& node, double secs_per_tick,
+               std::ostringstream* os) {
+  *os << "{\"name\":\"" << node.name << "\""
+      << ",\"secs\":" << static_cast<double>(node.ticks) * secs_per_tick
+      << ",\"count\":" << node.count
+      << ",\"bytes\":" << node.bytes;
+  if (!node.children.empty()) {
+    *os << ",\"children\":[";
+    for (size_t i = 0; i < node.children.size(); ++i) {
+      if (i != 0) *os << ",";
+      WriteJson(*node.children[i], secs_per_tick, os);
+    }
+    *os << "]";
+  }
+  *os << "}";
+}
+
+void ZeroTree(Profiler::Node* node) {
+  node->ticks = 0;
+  node->count = 0;
+  node->bytes = 0;
+  for (auto& c : node->children) {
+    ZeroTree(c.get());
+  }
+}
+
+}  // anonymous namespace
+
+std::string Profiler::DumpJson() {
+  // tick rate from the calibration anchor laid down at construction; with
+  // the chrono fallback ticks already are nanoseconds
+  const uint64_t ticks = Now() - base_ticks_;
+  const double secs = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - base_time_).count();
+  const double secs_per_tick =
+      (ticks > 0 && secs > 0.0) ? secs / static_cast<double>(ticks) : 0.0;
+
+  Node merged;
+  merged.name = "root";
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    for (const auto& t : threads_) {
+      for (const auto& c : t->root.children) {
+        MergeTree(*c, &merged);
+      }
+    }
+  }
+  std::ostringstream os;
+  os << "{\"enabled\":" << (Enabled() ? "true" : "false")
+     << ",\"profile\":";
+  WriteJson(merged, secs_per_tick, &os);
+  os << "}";
+  return os.str();
+}
+
+void Profiler::Reset() {
+  // counters of scopes still open on other threads are reset in place;
+  // their in-flight interval is accounted when they leave
+  std::lock_guard<std::mutex> lock(mu_);
+  for (auto& t : threads_) {
+    ZeroTree(&t->root);
+  }
+}
+
+}  // namespace common
+}  // namespace xgboost
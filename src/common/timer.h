@@ -4,9 +4,13 @@
 #pragma once
 #include <xgboost/logging.h>
 #include <chrono>
+#include <cstdint>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include "common.h"
 
@@ -37,6 +41,68 @@ struct Timer {
   }
 };
 
+/*!
+ * \brief Process-wide hierarchical profiler.
+ *
+ *  Disabled unless XGBOOST_PROFILE=1 is set in the environment; when
+ *  disabled every call costs a single predictable branch. Scopes nest per
+ *  thread and each thread records into its own scope tree, so the hot path
+ *  takes no lock and does no map lookup -- entering a scope is one
+ *  timestamp read plus a linear scan over the few children of the current
+ *  node. DumpJson() merges the per-thread trees by scope path into one
+ *  JSON document with per-scope seconds, call counts and processed bytes.
+ */
+class Profiler {
+ public:
+  struct Node {
+    std::string name;
+    uint64_t ticks{0};
+    uint64_t count{0};
+    uint64_t bytes{0};
+    Node* parent{nullptr};
+    std::vector<std::unique_ptr<Node>> children;
+  };
+
+  /*! \brief process-wide singleton */
+  static Profiler* Get();
+  /*! \brief whether profiling was requested through the environment */
+  static bool Enabled();
+
+  /*! \brief open a nested scope on the calling thread */
+  void Enter(const std::string& name);
+  /*! \brief close the innermost open scope of the calling thread */
+  void Leave();
+  /*! \brief attribute processed bytes to the innermost open scope */
+  void AddBytes(uint64_t n);
+
+  /*! \brief merged snapshot of all threads as nested JSON */
+  std::string DumpJson();
+  /*! \brief zero all recorded counters, keeping the scope structure */
+  void Reset();
+
+ private:
+  struct ThreadTree;
+  Profiler();
+  ThreadTree* GetThreadTree();
+  static uint64_t Now();
+
+  std::mutex mu_;
+  std::vector<std::unique_ptr<ThreadTree>> threads_;
+  // calibration anchor mapping tick counts onto wall time
+  uint64_t base_ticks_;
+  std::chrono::steady_clock::time_point base_time_;
+};
+
+/*! \brief RAII guard opening a profiler scope for the enclosing block */
+struct ProfileScope {
+  explicit ProfileScope(const char* name) {
+    if (Profiler::Enabled()) Profiler::Get()->Enter(name);
+  }
+  ~ProfileScope() {
+    if (Profiler::Enabled()) Profiler::Get()->Leave();
+  }
+};
+
 /**
  * \struct  Monitor
  *
@@ -73,7 +139,10 @@ struct Monitor {
   void Init(std::string label) {
     this->label = label;
   }
-  void Start(const std::string &name) { statistics_map[name].timer.Start(); }
+  void Start(const std::string &name) {
+    if (Profiler::Enabled()) Profiler::Get()->Enter(name);
+    statistics_map[name].timer.Start();
+  }
   void Start(const std::string &name, GPUSet devices) {
     if (ConsoleLogger::ShouldLog(ConsoleLogger::LV::kDebug)) {
 #ifdef __CUDACC__
@@ -83,11 +152,12 @@ struct Monitor {
       }
 #endif
     }
-    statistics_map[name].timer.Start();
+    this->Start(name);
   }
   void Stop(const std::string &name) {
     statistics_map[name].timer.Stop();
     statistics_map[name].count++;
+    if (Profiler::Enabled()) Profiler::Get()->Leave();
   }
   void Stop(const std::string &name, GPUSet devices) {
     if (ConsoleLogger::ShouldLog(ConsoleLogger::LV::kDebug)) {
@@ -6,6 +6,7 @@
 
 #include <dmlc/omp.h>
 #include <xgboost/data.h>
+#include <algorithm>
 #include <vector>
 #include <type_traits>  // enable_if
 
@@ -17,10 +18,20 @@
 #include "device_helpers.cuh"
 #endif
 
+// vectorization hint for counted inner loops; OpenMP 4.0 is required for
+// the simd construct, older runtimes simply skip the hint
+#if defined(_OPENMP) && _OPENMP >= 201307
+#define XGBOOST_OMP_SIMD _Pragma("omp simd")
+#else
+#define XGBOOST_OMP_SIMD
+#endif
+
 namespace xgboost {
 namespace common {
 
 constexpr size_t kBlockThreads = 256;
+/*! \brief index chunk a CPU thread processes at a time in Transform */
+constexpr size_t kCPUBlockSize = 1024;
 
 namespace detail {
 
@@ -159,10 +170,28 @@ class Transform {
 
     template <typename... HDV>
     void LaunchCPU(Functor func, HDV*... vectors) const {
-      auto end = *(range_.end());
+      // unpack the spans once up front: re-deriving them for every index
+      // hides the non-aliasing of the underlying buffers from the compiler
+      // and keeps the functor body from vectorizing
+      this->LaunchCPUBlocked(func, UnpackHDV(vectors)...);
+    }
+
+    template <typename... SpanType>
+    void LaunchCPUBlocked(Functor func, SpanType... spans) const {
+      const auto end = static_cast<omp_ulong>(*(range_.end()));
+      const auto block_size = static_cast<omp_ulong>(kCPUBlockSize);
+      const omp_ulong nblock = (end + block_size - 1) / block_size;
+      // statically scheduled blocks keep each thread on a few long
+      // contiguous index ranges; the inner loop is a plain counted loop
+      // over value-captured spans, which the compiler can vectorize
 #pragma omp parallel for schedule(static)
-      for (omp_ulong idx = 0; idx < end; ++idx) {
-        func(idx, UnpackHDV(vectors)...);
+      for (omp_ulong block = 0; block < nblock; ++block) {
+        const omp_ulong ibegin = block * block_size;
+        const omp_ulong iend = std::min(ibegin + block_size, end);
+        XGBOOST_OMP_SIMD
+        for (omp_ulong idx = ibegin; idx < iend; ++idx) {
+          func(idx, spans...);
+        }
       }
     }
 
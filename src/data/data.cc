@@ -5,14 +5,22 @@
 #include <xgboost/data.h>
 #include <xgboost/logging.h>
 #include <dmlc/registry.h>
+#include <algorithm>
 #include <cstring>
+#include <limits>
 #include "./sparse_page_writer.h"
 #include "./simple_dmatrix.h"
 #include "./simple_csr_source.h"
+#include "./synthetic_source.h"
 #include "../common/common.h"
 #include "../common/io.h"
 
 #if DMLC_ENABLE_STD_THREAD
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <thread>
 #include "./sparse_page_source.h"
 #include "./sparse_page_dmatrix.h"
 #endif
@@ -47,6 +55,20 @@ void MetaInfo::SaveBinary(dmlc::Stream *fo) const {
   fo->Write(base_margin_.HostVector());
 }
 
+// skip a serialized POD vector without materializing it
+template <typename T>
+inline void MetaSkipVector(dmlc::Stream* fi) {
+  uint64_t sz;
+  CHECK(fi->Read(&sz, sizeof(sz)) == sizeof(sz)) << "MetaInfo: invalid format";
+  char scratch[4096];
+  size_t nbytes = sz * sizeof(T);
+  while (nbytes != 0) {
+    const size_t nread = std::min(nbytes, sizeof(scratch));
+    CHECK_EQ(fi->Read(scratch, nread), nread) << "MetaInfo: invalid format";
+    nbytes -= nread;
+  }
+}
+
 void MetaInfo::LoadBinary(dmlc::Stream *fi) {
   int version;
   CHECK(fi->Read(&version, sizeof(version)) == sizeof(version)) << "MetaInfo: invalid version";
@@ -55,14 +77,33 @@ void MetaInfo::LoadBinary(dmlc::Stream *fi) {
   CHECK(fi->Read(&num_col_, sizeof(num_col_)) == sizeof(num_col_)) << "MetaInfo: invalid format";
   CHECK(fi->Read(&num_nonzero_, sizeof(num_nonzero_)) == sizeof(num_nonzero_))
       << "MetaInfo: invalid format";
+  // scoring-only deployments can opt out of materializing the
+  // training-only fields (weights, groups, qids); labels and base margin
+  // stay loaded since evaluation and margin-initialized prediction use them
+  const bool predict_only = dmlc::GetEnv("XGBOOST_META_PREDICT_ONLY", 0) != 0;
   CHECK(fi->Read(&labels_.HostVector())) <<  "MetaInfo: invalid format";
-  CHECK(fi->Read(&group_ptr_)) << "MetaInfo: invalid format";
+  if (predict_only) {
+    MetaSkipVector<unsigned>(fi);
+    group_ptr_.clear();
+  } else {
+    CHECK(fi->Read(&group_ptr_)) << "MetaInfo: invalid format";
+  }
   if (version >= kVersionQidAdded) {
-    CHECK(fi->Read(&qids_)) << "MetaInfo: invalid format";
+    if (predict_only) {
+      MetaSkipVector<uint64_t>(fi);
+      qids_.clear();
+    } else {
+      CHECK(fi->Read(&qids_)) << "MetaInfo: invalid format";
+    }
   } else {  // old format doesn't contain qid field
     qids_.clear();
   }
-  CHECK(fi->Read(&weights_.HostVector())) << "MetaInfo: invalid format";
+  if (predict_only) {
+    MetaSkipVector<bst_float>(fi);
+    weights_.HostVector().clear();
+  } else {
+    CHECK(fi->Read(&weights_.HostVector())) << "MetaInfo: invalid format";
+  }
   CHECK(fi->Read(&root_index_)) << "MetaInfo: invalid format";
   CHECK(fi->Read(&base_margin_.HostVector())) << "MetaInfo: invalid format";
 }
@@ -96,6 +137,294 @@ inline bool MetaTryLoadFloatInfo(const std::string& fname,
   return true;
 }
 
+#if DMLC_ENABLE_STD_THREAD
+// Parse part [partid, npart] of a text file with nthread parser shards
+// running concurrently, each over its own byte range, then merge the
+// shards back in byte-range order so the rows come out the same as a
+// single threaded parse.
+inline data::SimpleCSRSource* ParseTextSharded(const std::string& fname,
+                                               const std::string& file_format,
+                                               int partid, int npart,
+                                               int nthread) {
+  std::vector<std::unique_ptr<data::SimpleCSRSource> > parts(nthread);
+  std::vector<std::exception_ptr> errors(nthread);
+  std::vector<std::thread> workers;
+  for (int t = 0; t < nthread; ++t) {
+    parts[t].reset(new data::SimpleCSRSource());
+    data::SimpleCSRSource* out = parts[t].get();
+    std::exception_ptr* error = &errors[t];
+    workers.emplace_back([&fname, &file_format, partid, npart, nthread, t,
+                          out, error] () {
+        try {
+          std::unique_ptr<dmlc::Parser<uint32_t> > parser(
+              dmlc::Parser<uint32_t>::Create(fname.c_str(),
+                                             partid * nthread + t,
+                                             npart * nthread,
+                                             file_format.c_str()));
+          out->CopyFrom(parser.get());
+        } catch (...) {
+          *error = std::current_exception();
+        }
+      });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  for (auto& error : errors) {
+    if (error != nullptr) std::rethrow_exception(error);
+  }
+  std::unique_ptr<data::SimpleCSRSource> merged(new data::SimpleCSRSource());
+  merged->Clear();
+  auto& moffset = merged->page_.offset.HostVector();
+  auto& mdata = merged->page_.data.HostVector();
+  size_t total_rows = 0, total_entries = 0;
+  for (auto& part : parts) {
+    total_rows += part->info.num_row_;
+    total_entries += part->page_.data.Size();
+  }
+  moffset.reserve(total_rows + 1);
+  mdata.reserve(total_entries);
+  auto& mlabels = merged->info.labels_.HostVector();
+  auto& mweights = merged->info.weights_.HostVector();
+  for (auto& part : parts) {
+    const auto& poffset = part->page_.offset.HostVector();
+    const auto& pdata = part->page_.data.HostVector();
+    const size_t entry_base = moffset.back();
+    mdata.insert(mdata.end(), pdata.begin(), pdata.end());
+    for (size_t i = 1; i < poffset.size(); ++i) {
+      moffset.push_back(entry_base + poffset[i]);
+    }
+    const auto& plabels = part->info.labels_.HostVector();
+    mlabels.insert(mlabels.end(), plabels.begin(), plabels.end());
+    const auto& pweights = part->info.weights_.HostVector();
+    mweights.insert(mweights.end(), pweights.begin(), pweights.end());
+    merged->info.qids_.insert(merged->info.qids_.end(),
+                              part->info.qids_.begin(), part->info.qids_.end());
+    merged->info.num_row_ += part->info.num_row_;
+    merged->info.num_col_ = std::max(merged->info.num_col_,
+                                     part->info.num_col_);
+    // release each piece as soon as it has been copied over
+    part.reset(nullptr);
+  }
+  merged->info.num_nonzero_ = mdata.size();
+  // rebuild the group pointer from the query ids: a query can straddle
+  // the byte-range boundary between two shards
+  if (!merged->info.qids_.empty()) {
+    CHECK_EQ(merged->info.qids_.size(), merged->info.num_row_);
+    auto& group_ptr = merged->info.group_ptr_;
+    group_ptr.clear();
+    const uint64_t default_max = std::numeric_limits<uint64_t>::max();
+    uint64_t last_group_id = default_max;
+    bst_uint group_size = 0;
+    for (uint64_t qid : merged->info.qids_) {
+      if (last_group_id == default_max || last_group_id != qid) {
+        group_ptr.push_back(group_size);
+      }
+      last_group_id = qid;
+      ++group_size;
+    }
+    group_ptr.push_back(group_size);
+  }
+  return merged.release();
+}
+
+// Streams one part of a dataset through `nshard` ranged sub-readers, each
+// driven by its own thread over its own connection with a bounded number
+// of parsed blocks of read-ahead, and hands the blocks back to the
+// consumer in byte-range order. Remote URIs thus keep several ranged
+// fetches in flight while the consumer is building pages, instead of
+// draining a single connection.
+class ShardedRowBlockParser : public dmlc::Parser<uint32_t> {
+ public:
+  ShardedRowBlockParser(const std::string& fname,
+                        const std::string& file_format,
+                        int partid, int npart, int nshard, size_t lookahead)
+      : shards_(nshard), bytes_read_(0) {
+    for (int t = 0; t < nshard; ++t) {
+      shards_[t].reset(new Shard(lookahead));
+    }
+    for (int t = 0; t < nshard; ++t) {
+      workers_.emplace_back(
+          [this, fname, file_format, partid, npart, nshard, t]() {
+            Shard& shard = *shards_[t];
+            try {
+              std::unique_ptr<dmlc::Parser<uint32_t> > parser(
+                  dmlc::Parser<uint32_t>::Create(fname.c_str(),
+                                                 partid * nshard + t,
+                                                 npart * nshard,
+                                                 file_format.c_str()));
+              while (parser->Next()) {
+                OwnedBlock block;
+                block.CopyFrom(parser->Value());
+                if (!shard.Push(std::move(block))) break;
+              }
+              bytes_read_ += parser->BytesRead();
+            } catch (...) {
+              shard.SetError(std::current_exception());
+            }
+            shard.Finish();
+          });
+    }
+  }
+
+  ~ShardedRowBlockParser() override {
+    for (auto& shard : shards_) {
+      shard->Abort();
+    }
+    for (auto& worker : workers_) {
+      worker.join();
+    }
+  }
+
+  void BeforeFirst() override {
+    CHECK(!consumed_) << "ShardedRowBlockParser can only be read once";
+  }
+
+  bool Next() override {
+    consumed_ = true;
+    while (cur_shard_ < shards_.size()) {
+      if (shards_[cur_shard_]->Pop(&current_)) {
+        current_.MakeView(&view_);
+        return true;
+      }
+      ++cur_shard_;
+    }
+    return false;
+  }
+
+  const dmlc::RowBlock<uint32_t>& Value() const override {
+    return view_;
+  }
+
+  size_t BytesRead() const override {
+    return bytes_read_;
+  }
+
+ private:
+  // a parsed block copied out of a sub-parser, with offsets rebased to 0
+  struct OwnedBlock {
+    size_t size{0};
+    std::vector<size_t> offset;
+    std::vector<dmlc::real_t> label, weight, value;
+    std::vector<uint64_t> qid;
+    std::vector<uint32_t> index;
+    bool has_label{false}, has_weight{false}, has_qid{false},
+         has_value{false};
+
+    void CopyFrom(const dmlc::RowBlock<uint32_t>& batch) {
+      size = batch.size;
+      const size_t base = batch.offset[0];
+      offset.resize(size + 1);
+      for (size_t i = 0; i <= size; ++i) {
+        offset[i] = batch.offset[i] - base;
+      }
+      has_label = batch.label != nullptr;
+      if (has_label) {
+        label.assign(batch.label, batch.label + size);
+      }
+      has_weight = batch.weight != nullptr;
+      if (has_weight) {
+        weight.assign(batch.weight, batch.weight + size);
+      }
+      has_qid = batch.qid != nullptr;
+      if (has_qid) {
+        qid.assign(batch.qid, batch.qid + size);
+      }
+      // index can be null for an entirely sparse block
+      if (batch.index != nullptr) {
+        index.assign(batch.index + base, batch.index + base + offset[size]);
+      } else {
+        index.clear();
+      }
+      has_value = batch.value != nullptr;
+      if (has_value) {
+        value.assign(batch.value + base, batch.value + base + offset[size]);
+      }
+    }
+
+    void MakeView(dmlc::RowBlock<uint32_t>* out) const {
+      *out = dmlc::RowBlock<uint32_t>();
+      out->size = size;
+      out->offset = dmlc::BeginPtr(offset);
+      out->label = has_label ? dmlc::BeginPtr(label) : nullptr;
+      out->weight = has_weight ? dmlc::BeginPtr(weight) : nullptr;
+      out->qid = has_qid ? dmlc::BeginPtr(qid) : nullptr;
+      out->index = dmlc::BeginPtr(index);
+      out->value = has_value ? dmlc::BeginPtr(value) : nullptr;
+    }
+  };
+
+  // bounded block queue between one producer thread and the consumer
+  class Shard {
+   public:
+    explicit Shard(size_t capacity)
+        : capacity_(std::max<size_t>(capacity, 1)) {}
+
+    // blocks while the queue is full; false once the consumer is gone
+    bool Push(OwnedBlock&& block) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      not_full_.wait(lock, [this]() {
+          return queue_.size() < capacity_ || aborted_;
+        });
+      if (aborted_) return false;
+      queue_.push(std::move(block));
+      not_empty_.notify_one();
+      return true;
+    }
+
+    // false once the shard is drained; rethrows a producer failure
+    bool Pop(OwnedBlock* out) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      not_empty_.wait(lock, [this]() {
+          return !queue_.empty() || finished_;
+        });
+      if (!queue_.empty()) {
+        *out = std::move(queue_.front());
+        queue_.pop();
+        not_full_.notify_one();
+        return true;
+      }
+      if (error_ != nullptr) std::rethrow_exception(error_);
+      return false;
+    }
+
+    void SetError(std::exception_ptr error) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      error_ = error;
+    }
+
+    void Finish() {
+      std::lock_guard<std::mutex> lock(mutex_);
+      finished_ = true;
+      not_empty_.notify_all();
+    }
+
+    void Abort() {
+      std::lock_guard<std::mutex> lock(mutex_);
+      aborted_ = true;
+      not_full_.notify_all();
+    }
+
+   private:
+    const size_t capacity_;
+    std::mutex mutex_;
+    std::condition_variable not_full_, not_empty_;
+    std::queue<OwnedBlock> queue_;
+    std::exception_ptr error_{nullptr};
+    bool finished_{false};
+    bool aborted_{false};
+  };
+
+  std::vector<std::unique_ptr<Shard> > shards_;
+  std::vector<std::thread> workers_;
+  size_t cur_shard_{0};
+  OwnedBlock current_;
+  dmlc::RowBlock<uint32_t> view_;
+  std::atomic<size_t> bytes_read_;
+  bool consumed_{false};
+};
+#endif  // DMLC_ENABLE_STD_THREAD
+
 // macro to dispatch according to specified pointer types
 #define DISPATCH_CONST_PTR(dtype, old_ptr, cast_ptr, proc)              \
   switch (dtype) {                                                      \
@@ -146,6 +475,56 @@ void MetaInfo::SetInfo(const char* key, const void* dptr, DataType dtype, size_t
   }
 }
 
+void MetaInfo::Append(const MetaInfo& other) {
+  CHECK(num_col_ == 0 || other.num_col_ == 0 || num_col_ == other.num_col_)
+      << "MetaInfo: cannot append data with " << other.num_col_
+      << " columns to data with " << num_col_ << " columns";
+  // optional per-row fields must be set on both sides or on neither;
+  // there is no sensible fill value to make up for the missing side
+  auto append_field = [this, &other](HostDeviceVector<bst_float>* dst,
+                                     const HostDeviceVector<bst_float>& src,
+                                     const char* name) {
+    if (dst->Size() == 0 && src.Size() == 0) return;
+    CHECK(num_row_ == 0 || dst->Size() != 0)
+        << "MetaInfo: appended data has " << name
+        << " but the existing data does not";
+    CHECK(other.num_row_ == 0 || src.Size() != 0)
+        << "MetaInfo: existing data has " << name
+        << " but the appended data does not";
+    auto& dst_vec = dst->HostVector();
+    const auto& src_vec = src.HostVector();
+    dst_vec.insert(dst_vec.end(), src_vec.begin(), src_vec.end());
+  };
+  append_field(&labels_, other.labels_, "labels");
+  append_field(&weights_, other.weights_, "weights");
+  append_field(&base_margin_, other.base_margin_, "base margins");
+  if (root_index_.size() != 0 || other.root_index_.size() != 0) {
+    // the field defaults to root 0 when unset, so pad either side
+    root_index_.resize(num_row_, 0U);
+    root_index_.insert(root_index_.end(),
+                       other.root_index_.begin(), other.root_index_.end());
+    root_index_.resize(num_row_ + other.num_row_, 0U);
+  }
+  if (group_ptr_.size() != 0 || other.group_ptr_.size() != 0) {
+    CHECK(num_row_ == 0 || group_ptr_.size() != 0)
+        << "MetaInfo: appended data has group information"
+        << " but the existing data does not";
+    CHECK(other.num_row_ == 0 || other.group_ptr_.size() != 0)
+        << "MetaInfo: existing data has group information"
+        << " but the appended data does not";
+    if (group_ptr_.size() == 0) group_ptr_.push_back(0);
+    const bst_uint base = group_ptr_.back();
+    for (size_t i = 1; i < other.group_ptr_.size(); ++i) {
+      group_ptr_.push_back(base + other.group_ptr_[i]);
+    }
+  }
+  qids_.insert(qids_.end(), other.qids_.begin(), other.qids_.end());
+  num_row_ += other.num_row_;
+  num_col_ = std::max(num_col_, other.num_col_);
+  num_nonzero_ += other.num_nonzero_;
+  label_order_cache_.clear();
+}
+
 
 DMatrix* DMatrix::Load(const std::string& uri,
                        bool silent,
@@ -195,6 +574,21 @@ DMatrix* DMatrix::Load(const std::string& uri,
     LOG(CONSOLE) << "Load part of data " << partid
                  << " of " << npart << " parts";
   }
+  // synthetic data generation, no file access involved
+  if (fname.compare(0, strlen(data::kSyntheticURIPrefix),
+                    data::kSyntheticURIPrefix) == 0) {
+    data::SyntheticParam sparam = data::SyntheticParam::Parse(
+        fname.substr(strlen(data::kSyntheticURIPrefix)));
+    std::unique_ptr<data::SimpleCSRSource> source =
+        data::CreateSyntheticSource(sparam, partid, npart);
+    DMatrix* dmat = DMatrix::Create(std::move(source), cache_file);
+    if (!silent) {
+      LOG(CONSOLE) << dmat->Info().num_row_ << 'x' << dmat->Info().num_col_
+                   << " matrix with " << dmat->Info().num_nonzero_
+                   << " entries generated from " << fname;
+    }
+    return dmat;
+  }
   // legacy handling of binary data loading
   if (file_format == "auto" && npart == 1) {
     int magic;
@@ -202,9 +596,15 @@ DMatrix* DMatrix::Load(const std::string& uri,
     if (fi != nullptr) {
       common::PeekableInStream is(fi.get());
       if (is.PeekRead(&magic, sizeof(magic)) == sizeof(magic) &&
-          magic == data::SimpleCSRSource::kMagic) {
+          (magic == data::SimpleCSRSource::kMagic ||
+           magic == data::SimpleCSRSource::kMagicV2)) {
         std::unique_ptr<data::SimpleCSRSource> source(new data::SimpleCSRSource());
-        source->LoadBinary(&is);
+        // v2 files are loaded through a memory mapping when possible,
+        // bulk-copying the aligned sections instead of streaming them
+        if (magic != data::SimpleCSRSource::kMagicV2 ||
+            !source->LoadBinaryMmap(fname)) {
+          source->LoadBinary(&is);
+        }
         DMatrix* dmat = DMatrix::Create(std::move(source), cache_file);
         if (!silent) {
           LOG(CONSOLE) << dmat->Info().num_row_ << 'x' << dmat->Info().num_col_ << " matrix with "
@@ -215,9 +615,32 @@ DMatrix* DMatrix::Load(const std::string& uri,
     }
   }
 
-  std::unique_ptr<dmlc::Parser<uint32_t> > parser(
-      dmlc::Parser<uint32_t>::Create(fname.c_str(), partid, npart, file_format.c_str()));
-  DMatrix* dmat = DMatrix::Create(parser.get(), cache_file);
+  DMatrix* dmat = nullptr;
+#if DMLC_ENABLE_STD_THREAD
+  // sharded load pipeline: split our byte range further across several
+  // ranged readers running concurrently. The in-memory path parses into
+  // per-shard sources merged in order; the external memory path streams
+  // the shards through a bounded read-ahead queue into the cache writer,
+  // keeping several connections busy while pages are written.
+  const int parse_nthread = dmlc::GetEnv("XGBOOST_PARSE_NTHREAD", 1);
+  if (parse_nthread > 1 && cache_file.length() == 0) {
+    std::unique_ptr<data::SimpleCSRSource> source(
+        ParseTextSharded(fname, file_format, partid, npart, parse_nthread));
+    dmat = DMatrix::Create(std::move(source), cache_file);
+  } else if (parse_nthread > 1) {
+    const size_t lookahead = static_cast<size_t>(
+        std::max(1, dmlc::GetEnv("XGBOOST_PARSE_LOOKAHEAD", 4)));
+    ShardedRowBlockParser parser(fname, file_format, partid, npart,
+                                 parse_nthread, lookahead);
+    dmat = DMatrix::Create(&parser, cache_file);
+  }
+#endif
+  if (dmat == nullptr) {
+    std::unique_ptr<dmlc::Parser<uint32_t> > parser(
+        dmlc::Parser<uint32_t>::Create(fname.c_str(), partid, npart,
+                                       file_format.c_str()));
+    dmat = DMatrix::Create(parser.get(), cache_file);
+  }
   if (!silent) {
     LOG(CONSOLE) << dmat->Info().num_row_ << 'x' << dmat->Info().num_col_ << " matrix with "
                  << dmat->Info().num_nonzero_ << " entries loaded from " << uri;
@@ -268,6 +691,60 @@ DMatrix* DMatrix::Create(dmlc::Parser<uint32_t>* parser,
   }
 }
 
+const DatasetStats& DMatrix::Stats() {
+  if (stats_) return *stats_;
+  stats_.reset(new DatasetStats());
+  DatasetStats& stats = *stats_;
+  const size_t num_col = this->Info().num_col_;
+  stats.num_row = this->Info().num_row_;
+  const int nthread = omp_get_max_threads();
+  // per-thread partials, reduced serially below
+  std::vector<std::vector<size_t>> nnz(nthread, std::vector<size_t>(num_col, 0));
+  std::vector<std::vector<bst_float>> fmin(
+      nthread, std::vector<bst_float>(num_col, std::numeric_limits<bst_float>::max()));
+  std::vector<std::vector<bst_float>> fmax(
+      nthread, std::vector<bst_float>(num_col, -std::numeric_limits<bst_float>::max()));
+  std::vector<std::vector<size_t>> hist(nthread);
+  for (const auto& batch : this->GetRowBatches()) {
+    const auto nrows = static_cast<bst_omp_uint>(batch.Size());
+#pragma omp parallel for schedule(static)
+    for (bst_omp_uint i = 0; i < nrows; ++i) {
+      const int tid = omp_get_thread_num();
+      auto inst = batch[i];
+      size_t bucket = 0;
+      while ((1ULL << bucket) <= inst.size()) ++bucket;
+      if (hist[tid].size() <= bucket) hist[tid].resize(bucket + 1, 0);
+      ++hist[tid][bucket];
+      for (const auto& e : inst) {
+        ++nnz[tid][e.index];
+        fmin[tid][e.index] = std::min(fmin[tid][e.index], e.fvalue);
+        fmax[tid][e.index] = std::max(fmax[tid][e.index], e.fvalue);
+      }
+    }
+  }
+  stats.column_nnz.assign(num_col, 0);
+  stats.column_min.assign(num_col, std::numeric_limits<bst_float>::max());
+  stats.column_max.assign(num_col, -std::numeric_limits<bst_float>::max());
+  for (int tid = 0; tid < nthread; ++tid) {
+    for (size_t cidx = 0; cidx < num_col; ++cidx) {
+      stats.column_nnz[cidx] += nnz[tid][cidx];
+      stats.column_min[cidx] = std::min(stats.column_min[cidx], fmin[tid][cidx]);
+      stats.column_max[cidx] = std::max(stats.column_max[cidx], fmax[tid][cidx]);
+    }
+    if (hist[tid].size() > stats.row_length_hist.size()) {
+      stats.row_length_hist.resize(hist[tid].size(), 0);
+    }
+    for (size_t b = 0; b < hist[tid].size(); ++b) {
+      stats.row_length_hist[b] += hist[tid][b];
+    }
+  }
+  return stats;
+}
+
+void DMatrix::AppendRows(DMatrix* other) {
+  LOG(FATAL) << "appending rows is only supported by in-memory DMatrix";
+}
+
 void DMatrix::SaveToLocalFile(const std::string& fname) {
   data::SimpleCSRSource source;
   source.CopyFrom(this);
@@ -0,0 +1,197 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file dense_dmatrix.cc
+ * \brief DMatrix borrowing a dense matrix the caller continues to own.
+ */
+#include "./dense_dmatrix.h"
+#include <xgboost/logging.h>
+#include <algorithm>
+#include "../common/math.h"
+
+namespace xgboost {
+namespace data {
+namespace {
+// byte budget of one synthesized row batch; this bounds the extra memory a
+// borrowed matrix needs during iteration
+constexpr size_t kBatchBytes = 32UL << 20;
+
+// iterator over an already materialized single page
+class SinglePageIteratorImpl : public BatchIteratorImpl {
+ public:
+  explicit SinglePageIteratorImpl(SparsePage* page) : page_(page) {}
+  const SparsePage& operator*() const override {
+    CHECK(page_ != nullptr);
+    return *page_;
+  }
+  void operator++() override { page_ = nullptr; }
+  bool AtEnd() const override { return page_ == nullptr; }
+  SinglePageIteratorImpl* Clone() override {
+    return new SinglePageIteratorImpl(*this);
+  }
+
+ private:
+  SparsePage* page_{nullptr};
+};
+}  // anonymous namespace
+
+// walks the borrowed matrix one bounded batch at a time, re-synthesizing
+// the page buffer on every step
+class DenseDMatrix::RowBatchIteratorImpl : public BatchIteratorImpl {
+ public:
+  RowBatchIteratorImpl(const DenseDMatrix* parent, size_t begin_row)
+      : parent_(parent), begin_row_(begin_row) {
+    if (!AtEnd()) {
+      this->Materialize();
+    }
+  }
+  const SparsePage& operator*() const override { return page_; }
+  void operator++() override {
+    begin_row_ += parent_->rows_per_batch_;
+    if (!AtEnd()) {
+      this->Materialize();
+    }
+  }
+  bool AtEnd() const override {
+    return begin_row_ >= parent_->info_.num_row_;
+  }
+  RowBatchIteratorImpl* Clone() override {
+    return new RowBatchIteratorImpl(parent_, begin_row_);
+  }
+
+ private:
+  void Materialize() {
+    const size_t end_row = std::min(begin_row_ + parent_->rows_per_batch_,
+                                    static_cast<size_t>(parent_->info_.num_row_));
+    parent_->MaterializeBatch(begin_row_, end_row, &page_);
+  }
+
+  const DenseDMatrix* parent_;
+  size_t begin_row_;
+  SparsePage page_;
+};
+
+DenseDMatrix::DenseDMatrix(const bst_float* data, size_t num_row,
+                           size_t num_col, bst_float missing)
+    : data_(data), missing_(missing) {
+  info_.num_row_ = num_row;
+  info_.num_col_ = num_col;
+  const size_t row_bytes = std::max(num_col, static_cast<size_t>(1)) *
+                           sizeof(Entry);
+  rows_per_batch_ = std::max(kBatchBytes / row_bytes,
+                             static_cast<size_t>(1));
+  // count the nonzero entries; this pass allocates nothing
+  const bool nan_missing = common::CheckNAN(missing);
+  const auto nelem = static_cast<omp_ulong>(num_row * num_col);
+  size_t nonzero = 0;
+  int bad_nan = 0;
+#pragma omp parallel for schedule(static) reduction(+ : nonzero) \
+    reduction(| : bad_nan)
+  for (omp_ulong i = 0; i < nelem; ++i) {
+    if (common::CheckNAN(data[i])) {
+      bad_nan |= !nan_missing;
+    } else if (nan_missing || data[i] != missing) {
+      ++nonzero;
+    }
+  }
+  CHECK(!bad_nan)
+      << "There are NAN in the matrix, however, you did not set missing=NAN";
+  info_.num_nonzero_ = nonzero;
+}
+
+MetaInfo& DenseDMatrix::Info() { return info_; }
+
+const MetaInfo& DenseDMatrix::Info() const { return info_; }
+
+void DenseDMatrix::MaterializeBatch(size_t begin_row, size_t end_row,
+                                    SparsePage* out) const {
+  const bool nan_missing = common::CheckNAN(missing_);
+  const size_t ncol = info_.num_col_;
+  out->base_rowid = begin_row;
+  auto& offset_vec = out->offset.HostVector();
+  auto& data_vec = out->data.HostVector();
+  const size_t nrows = end_row - begin_row;
+  offset_vec.resize(nrows + 1);
+  offset_vec[0] = 0;
+  const auto nsize = static_cast<omp_ulong>(nrows);
+#pragma omp parallel for schedule(static)
+  for (omp_ulong i = 0; i < nsize; ++i) {
+    const bst_float* row = data_ + (begin_row + i) * ncol;
+    size_t nelem = 0;
+    for (size_t j = 0; j < ncol; ++j) {
+      if (!common::CheckNAN(row[j]) &&
+          (nan_missing || row[j] != missing_)) {
+        ++nelem;
+      }
+    }
+    offset_vec[i + 1] = nelem;
+  }
+  for (size_t i = 0; i < nrows; ++i) {
+    offset_vec[i + 1] += offset_vec[i];
+  }
+  data_vec.resize(offset_vec.back());
+#pragma omp parallel for schedule(static)
+  for (omp_ulong i = 0; i < nsize; ++i) {
+    const bst_float* row = data_ + (begin_row + i) * ncol;
+    size_t at = offset_vec[i];
+    for (size_t j = 0; j < ncol; ++j) {
+      if (!common::CheckNAN(row[j]) &&
+          (nan_missing || row[j] != missing_)) {
+        data_vec[at++] = Entry(static_cast<bst_uint>(j), row[j]);
+      }
+    }
+  }
+}
+
+void DenseDMatrix::MaterializeColumnPage(SparsePage* out) const {
+  // the column paths need the whole matrix at once; this is the one place
+  // where the borrowed representation falls back to a full copy
+  LOG(WARNING) << "Column access on a borrowed dense matrix materializes "
+               << "a full transposed copy";
+  SparsePage page;
+  this->MaterializeBatch(0, info_.num_row_, &page);
+  *out = page.GetTranspose(info_.num_col_);
+}
+
+float DenseDMatrix::GetColDensity(size_t cidx) {
+  // scan the borrowed column directly instead of transposing
+  const bool nan_missing = common::CheckNAN(missing_);
+  size_t column_size = 0;
+  for (size_t i = 0; i < info_.num_row_; ++i) {
+    const bst_float v = data_[i * info_.num_col_ + cidx];
+    if (!common::CheckNAN(v) && (nan_missing || v != missing_)) {
+      ++column_size;
+    }
+  }
+  const size_t nmiss = info_.num_row_ - column_size;
+  return 1.0f - (static_cast<float>(nmiss)) / info_.num_row_;
+}
+
+bool DenseDMatrix::SingleColBlock() const { return true; }
+
+BatchSet DenseDMatrix::GetRowBatches() {
+  auto begin_iter = BatchIterator(new RowBatchIteratorImpl(this, 0));
+  return BatchSet(begin_iter);
+}
+
+BatchSet DenseDMatrix::GetColumnBatches() {
+  if (!column_page_) {
+    column_page_.reset(new SparsePage());
+    this->MaterializeColumnPage(column_page_.get());
+  }
+  auto begin_iter =
+      BatchIterator(new SinglePageIteratorImpl(column_page_.get()));
+  return BatchSet(begin_iter);
+}
+
+BatchSet DenseDMatrix::GetSortedColumnBatches() {
+  if (!sorted_column_page_) {
+    sorted_column_page_.reset(new SparsePage());
+    this->MaterializeColumnPage(sorted_column_page_.get());
+    sorted_column_page_->SortRows();
+  }
+  auto begin_iter =
+      BatchIterator(new SinglePageIteratorImpl(sorted_column_page_.get()));
+  return BatchSet(begin_iter);
+}
+}  // namespace data
+}  // namespace xgboost
@@ -0,0 +1,66 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file dense_dmatrix.h
+ * \brief DMatrix borrowing a dense matrix the caller continues to own.
+ */
+#ifndef XGBOOST_DATA_DENSE_DMATRIX_H_
+#define XGBOOST_DATA_DENSE_DMATRIX_H_
+
+#include <xgboost/base.h>
+#include <xgboost/data.h>
+#include <memory>
+
+namespace xgboost {
+namespace data {
+/*!
+ * \brief In-memory DMatrix backed by a dense row-major matrix that the
+ *  caller continues to own. Nothing is copied at construction; row batches
+ *  are synthesized into a bounded reusable buffer while iterating, so peak
+ *  memory stays at the borrowed matrix plus one batch instead of a second
+ *  full CSR copy of the data.
+ *
+ *  Lifetime contract: the caller must keep the matrix alive and unchanged
+ *  for the whole lifetime of this DMatrix. The column access paths used by
+ *  the exact updaters still materialize a transposed copy on first use.
+ */
+class DenseDMatrix : public DMatrix {
+ public:
+  DenseDMatrix(const bst_float* data, size_t num_row, size_t num_col,
+               bst_float missing);
+
+  MetaInfo& Info() override;
+
+  const MetaInfo& Info() const override;
+
+  float GetColDensity(size_t cidx) override;
+
+  bool SingleColBlock() const override;
+
+  BatchSet GetRowBatches() override;
+
+  BatchSet GetColumnBatches() override;
+
+  BatchSet GetSortedColumnBatches() override;
+
+ private:
+  class RowBatchIteratorImpl;
+
+  // convert the rows [begin_row, end_row) of the borrowed matrix into out
+  void MaterializeBatch(size_t begin_row, size_t end_row,
+                        SparsePage* out) const;
+  // build the transposed page backing the column access paths
+  void MaterializeColumnPage(SparsePage* out) const;
+
+  // borrowed, caller-owned row-major matrix
+  const bst_float* data_;
+  bst_float missing_;
+  // rows per synthesized batch, sized to bound the buffer memory
+  size_t rows_per_batch_;
+  MetaInfo info_;
+
+  std::unique_ptr<SparsePage> column_page_;
+  std::unique_ptr<SparsePage> sorted_column_page_;
+};
+}  // namespace data
+}  // namespace xgboost
+#endif  // XGBOOST_DATA_DENSE_DMATRIX_H_
@@ -3,16 +3,49 @@
  * \file simple_csr_source.cc
  */
 #include <dmlc/base.h>
+#include <dmlc/memory_io.h>
 #include <xgboost/logging.h>
+#include <cstring>
 #include <limits>
+#include <string>
 #include "./simple_csr_source.h"
 
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+#define XGBOOST_USE_MMAP_BINARY_LOAD 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // !defined(_WIN32) && !defined(__CYGWIN__)
+
+namespace {
+
+// round a file offset up to the next 64 byte boundary
+inline uint64_t Align64(uint64_t pos) {
+  return (pos + 63) / 64 * 64;
+}
+
+inline void WritePadding(dmlc::Stream* fo, size_t nbytes) {
+  const char zeros[64] = {0};
+  CHECK_LE(nbytes, sizeof(zeros));
+  if (nbytes != 0) fo->Write(zeros, nbytes);
+}
+
+inline void SkipPadding(dmlc::Stream* fi, size_t nbytes) {
+  char scratch[64];
+  CHECK_LE(nbytes, sizeof(scratch));
+  if (nbytes != 0) CHECK_EQ(fi->Read(scratch, nbytes), nbytes);
+}
+
+}  // anonymous namespace
+
 namespace xgboost {
 namespace data {
 
 void SimpleCSRSource::Clear() {
   page_.Clear();
   this->info.Clear();
+  this->UpdateMemoryStats();
 }
 
 void SimpleCSRSource::CopyFrom(DMatrix* src) {
@@ -21,6 +54,7 @@ void SimpleCSRSource::CopyFrom(DMatrix* src) {
   for (const auto &batch : src->GetRowBatches()) {
     page_.Push(batch);
   }
+  this->UpdateMemoryStats();
 }
 
 void SimpleCSRSource::CopyFrom(dmlc::Parser<uint32_t>* parser) {
@@ -83,23 +117,149 @@ void SimpleCSRSource::CopyFrom(dmlc::Parser<uint32_t>* parser) {
   this->info.num_nonzero_ = static_cast<uint64_t>(page_.data.Size());
   // Either every row has query ID or none at all
   CHECK(info.qids_.empty() || info.qids_.size() == info.num_row_);
+  this->UpdateMemoryStats();
+}
+
+void SimpleCSRSource::Adopt(std::vector<size_t>&& offset,
+                            std::vector<Entry>&& data, uint64_t num_col) {
+  this->Clear();
+  CHECK_GE(offset.size(), 1U);
+  CHECK_EQ(offset.front(), 0U);
+  CHECK_EQ(offset.back(), data.size());
+  if (num_col == 0) {
+    for (const Entry& e : data) {
+      num_col = std::max(num_col, static_cast<uint64_t>(e.index + 1));
+    }
+  }
+  info.num_row_ = offset.size() - 1;
+  info.num_col_ = num_col;
+  info.num_nonzero_ = data.size();
+  page_.offset.HostVector() = std::move(offset);
+  page_.data.HostVector() = std::move(data);
+  this->UpdateMemoryStats();
 }
 
 void SimpleCSRSource::LoadBinary(dmlc::Stream* fi) {
   int tmagic;
   CHECK(fi->Read(&tmagic, sizeof(tmagic)) == sizeof(tmagic)) << "invalid input file format";
-  CHECK_EQ(tmagic, kMagic) << "invalid format, magic number mismatch";
-  info.LoadBinary(fi);
-  fi->Read(&page_.offset.HostVector());
-  fi->Read(&page_.data.HostVector());
+  if (tmagic == kMagic) {
+    // legacy streamed layout
+    info.LoadBinary(fi);
+    fi->Read(&page_.offset.HostVector());
+    fi->Read(&page_.data.HostVector());
+    this->UpdateMemoryStats();
+    return;
+  }
+  CHECK_EQ(tmagic, kMagicV2) << "invalid format, magic number mismatch";
+  uint64_t header[6];
+  CHECK_EQ(fi->Read(header, sizeof(header)), sizeof(header))
+      << "invalid input file format";
+  std::string info_blob;
+  info_blob.resize(header[1]);
+  if (header[1] != 0) {
+    CHECK_EQ(fi->Read(&info_blob[0], header[1]), header[1])
+        << "invalid input file format";
+  }
+  dmlc::MemoryFixSizeBuffer ms(&info_blob[0], info_blob.length());
+  info.LoadBinary(&ms);
+  SkipPadding(fi, header[2] - (header[0] + header[1]));
+  auto& offset_vec = page_.offset.HostVector();
+  auto& data_vec = page_.data.HostVector();
+  offset_vec.resize(header[3]);
+  CHECK_EQ(fi->Read(dmlc::BeginPtr(offset_vec), header[3] * sizeof(size_t)),
+           header[3] * sizeof(size_t)) << "invalid input file format";
+  SkipPadding(fi, header[4] - (header[2] + header[3] * sizeof(size_t)));
+  data_vec.resize(header[5]);
+  if (header[5] != 0) {
+    CHECK_EQ(fi->Read(dmlc::BeginPtr(data_vec), header[5] * sizeof(Entry)),
+             header[5] * sizeof(Entry)) << "invalid input file format";
+  }
+  this->UpdateMemoryStats();
+}
+
+bool SimpleCSRSource::LoadBinaryMmap(const std::string& fname) {
+#ifdef XGBOOST_USE_MMAP_BINARY_LOAD
+  int fd = open(fname.c_str(), O_RDONLY);
+  if (fd == -1) return false;
+  struct stat sb;
+  if (fstat(fd, &sb) != 0 || sb.st_size <= 0) {
+    close(fd);
+    return false;
+  }
+  const size_t file_size = static_cast<size_t>(sb.st_size);
+  void* addr = mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) return false;
+  const char* base = static_cast<const char*>(addr);
+  int tmagic;
+  uint64_t header[6];
+  if (file_size < sizeof(tmagic) + sizeof(header)) {
+    munmap(addr, file_size);
+    return false;
+  }
+  std::memcpy(&tmagic, base, sizeof(tmagic));
+  if (tmagic != kMagicV2) {
+    // the legacy layout interleaves serialized vectors, only the v2
+    // sectioned layout can be bulk-copied out of a mapping
+    munmap(addr, file_size);
+    return false;
+  }
+  std::memcpy(header, base + sizeof(tmagic), sizeof(header));
+  CHECK_LE(header[0] + header[1], file_size) << "invalid input file format";
+  CHECK_LE(header[2] + header[3] * sizeof(size_t), file_size)
+      << "invalid input file format";
+  CHECK_LE(header[4] + header[5] * sizeof(Entry), file_size)
+      << "invalid input file format";
+  madvise(addr, file_size, MADV_SEQUENTIAL);
+  {
+    std::string info_blob(base + header[0], header[1]);
+    dmlc::MemoryFixSizeBuffer ms(&info_blob[0], info_blob.length());
+    info.LoadBinary(&ms);
+  }
+  auto& offset_vec = page_.offset.HostVector();
+  auto& data_vec = page_.data.HostVector();
+  offset_vec.resize(header[3]);
+  std::memcpy(dmlc::BeginPtr(offset_vec), base + header[2],
+              header[3] * sizeof(size_t));
+  data_vec.resize(header[5]);
+  if (header[5] != 0) {
+    std::memcpy(dmlc::BeginPtr(data_vec), base + header[4],
+                header[5] * sizeof(Entry));
+  }
+  munmap(addr, file_size);
+  this->UpdateMemoryStats();
+  return true;
+#else
+  return false;
+#endif  // XGBOOST_USE_MMAP_BINARY_LOAD
 }
 
 void SimpleCSRSource::SaveBinary(dmlc::Stream* fo) const {
-  int tmagic = kMagic;
+  const auto& offset_vec = page_.offset.HostVector();
+  const auto& data_vec = page_.data.HostVector();
+  // v2 layout: magic, fixed header of absolute section offsets, MetaInfo
+  // blob, then the raw offset and data arrays on 64 byte boundaries so a
+  // loader can bulk-copy them straight out of a memory mapped file
+  int tmagic = kMagicV2;
+  std::string info_blob;
+  dmlc::MemoryBufferStream ms(&info_blob);
+  info.SaveBinary(&ms);
+  uint64_t header[6];
+  header[0] = sizeof(tmagic) + sizeof(header);      // MetaInfo offset
+  header[1] = info_blob.length();                   // MetaInfo bytes
+  header[2] = Align64(header[0] + header[1]);       // offset section
+  header[3] = offset_vec.size();
+  header[4] = Align64(header[2] + header[3] * sizeof(size_t));  // data section
+  header[5] = data_vec.size();
   fo->Write(&tmagic, sizeof(tmagic));
-  info.SaveBinary(fo);
-  fo->Write(page_.offset.HostVector());
-  fo->Write(page_.data.HostVector());
+  fo->Write(header, sizeof(header));
+  fo->Write(dmlc::BeginPtr(info_blob), info_blob.length());
+  WritePadding(fo, header[2] - (header[0] + header[1]));
+  fo->Write(dmlc::BeginPtr(offset_vec), header[3] * sizeof(size_t));
+  WritePadding(fo, header[4] - (header[2] + header[3] * sizeof(size_t)));
+  if (!data_vec.empty()) {
+    fo->Write(dmlc::BeginPtr(data_vec), header[5] * sizeof(Entry));
+  }
 }
 
 void SimpleCSRSource::BeforeFirst() {
@@ -10,9 +10,12 @@
 
 #include <xgboost/base.h>
 #include <xgboost/data.h>
+#include <string>
 #include <vector>
 #include <algorithm>
 
+#include "../common/memory_stats.h"
+
 
 namespace xgboost {
 namespace data {
@@ -34,6 +37,8 @@ class SimpleCSRSource : public DataSource {
   SimpleCSRSource() = default;
   /*! \brief destructor */
   ~SimpleCSRSource() override = default;
+  /*! \brief re-report the footprint after page_ changed */
+  void UpdateMemoryStats() { mem_bytes_.Update(page_.MemCostBytes()); }
   /*! \brief clear the data structure */
   void Clear();
   /*!
@@ -48,10 +53,29 @@ class SimpleCSRSource : public DataSource {
    */
   void CopyFrom(dmlc::Parser<uint32_t>* src);
   /*!
-   * \brief Load data from binary stream.
+   * \brief Adopt buffers that are already in xgboost's internal CSR
+   *  layout without copying them. The offsets must start at 0 and the
+   *  entries must contain no NaN values.
+   * \param offset row offsets, one per row plus the closing offset.
+   * \param data the entries, sized to the last offset.
+   * \param num_col number of columns; 0 to infer from the entries.
+   */
+  void Adopt(std::vector<size_t>&& offset, std::vector<Entry>&& data,
+             uint64_t num_col);
+  /*!
+   * \brief Load data from binary stream. Understands both the legacy
+   *  streamed layout and the v2 sectioned layout.
    * \param fi the pointer to load data from.
    */
   void LoadBinary(dmlc::Stream* fi);
+  /*!
+   * \brief Load a v2 binary file through a memory mapping, bulk-copying
+   *  the aligned offset and data sections instead of streaming them.
+   * \param fname name of the local file to load.
+   * \return whether the file could be loaded this way; on false the
+   *  caller should fall back to stream loading.
+   */
+  bool LoadBinaryMmap(const std::string& fname);
   /*!
    * \brief Save data into binary stream
    * \param fo The output stream.
@@ -65,10 +89,14 @@ class SimpleCSRSource : public DataSource {
   const SparsePage &Value() const override;
   /*! \brief magic number used to identify SimpleCSRSource */
   static const int kMagic = 0xffffab01;
+  /*! \brief magic number of the v2 binary layout with aligned sections */
+  static const int kMagicV2 = 0xffffab03;
 
  private:
   /*! \brief internal variable, used to support iterator interface */
   bool at_first_{true};
+  /*! \brief bytes of page_ currently reported to MemoryStats */
+  common::AccountedBytes mem_bytes_{"SimpleCSRSource"};
 };
 }  // namespace data
 }  // namespace xgboost
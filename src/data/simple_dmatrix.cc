@@ -55,7 +55,7 @@ BatchSet SimpleDMatrix::GetRowBatches() {
 BatchSet SimpleDMatrix::GetColumnBatches() {
   // column page doesn't exist, generate it
   if (!column_page_) {
-    auto page = dynamic_cast<SimpleCSRSource*>(source_.get())->page_;
+    const auto& page = dynamic_cast<SimpleCSRSource*>(source_.get())->page_;
     column_page_.reset(
         new SparsePage(page.GetTranspose(source_->info.num_col_)));
   }
@@ -67,7 +67,7 @@ BatchSet SimpleDMatrix::GetColumnBatches() {
 BatchSet SimpleDMatrix::GetSortedColumnBatches() {
   // Sorted column page doesn't exist, generate it
   if (!sorted_column_page_) {
-    auto page = dynamic_cast<SimpleCSRSource*>(source_.get())->page_;
+    const auto& page = dynamic_cast<SimpleCSRSource*>(source_.get())->page_;
     sorted_column_page_.reset(
         new SparsePage(page.GetTranspose(source_->info.num_col_)));
     sorted_column_page_->SortRows();
@@ -78,5 +78,20 @@ BatchSet SimpleDMatrix::GetSortedColumnBatches() {
 }
 
 bool SimpleDMatrix::SingleColBlock() const { return true; }
+
+void SimpleDMatrix::AppendRows(DMatrix* other) {
+  CHECK(other != this) << "cannot append a DMatrix to itself";
+  auto* source = dynamic_cast<SimpleCSRSource*>(source_.get());
+  CHECK(source != nullptr)
+      << "appending rows is only supported by in-memory DMatrix";
+  for (const auto& batch : other->GetRowBatches()) {
+    source->page_.Push(batch);
+  }
+  source->info.Append(other->Info());
+  // derived structures are rebuilt from the extended page on next use
+  column_page_.reset();
+  sorted_column_page_.reset();
+  this->ResetStats();
+}
 }  // namespace data
 }  // namespace xgboost
@@ -36,6 +36,8 @@ class SimpleDMatrix : public DMatrix {
 
   BatchSet GetSortedColumnBatches() override;
 
+  void AppendRows(DMatrix* other) override;
+
  private:
   // source data pointer.
   std::unique_ptr<DataSource> source_;
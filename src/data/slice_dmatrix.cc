@@ -0,0 +1,182 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file slice_dmatrix.cc
+ * \brief Row view over another DMatrix, for zero-copy fold construction.
+ */
+#include "./slice_dmatrix.h"
+#include <xgboost/data.h>
+#include <algorithm>
+#include <utility>
+
+namespace xgboost {
+namespace data {
+
+SliceDMatrix::SliceDMatrix(std::shared_ptr<DMatrix> parent,
+                           std::vector<bst_uint> ridx)
+    : parent_(std::move(parent)), ridx_(std::move(ridx)) {
+  // flatten views of views, so row gathering always reads a materialized
+  // page whose lifetime is tied to the parent matrix
+  auto* view = dynamic_cast<SliceDMatrix*>(parent_.get());
+  if (view != nullptr) {
+    std::vector<bst_uint> flat;
+    flat.reserve(ridx_.size());
+    for (bst_uint r : ridx_) {
+      CHECK_LT(r, view->ridx_.size()) << "slice index out of range";
+      flat.push_back(view->ridx_[r]);
+    }
+    std::shared_ptr<DMatrix> grand = view->parent_;
+    ridx_ = std::move(flat);
+    parent_ = std::move(grand);
+  }
+  CHECK(parent_->SingleColBlock())
+      << "slice views require an in-memory parent matrix";
+  const MetaInfo& src = parent_->Info();
+  if (src.group_ptr_.size() != 0) {
+    // grouped data can only be sliced along group boundaries: the index
+    // list must cover each selected group completely and in row order, and
+    // the view carries the rebuilt group pointer
+    info_.group_ptr_.push_back(0);
+    size_t i = 0;
+    while (i < ridx_.size()) {
+      CHECK_LT(ridx_[i], src.group_ptr_.back()) << "slice index out of range";
+      auto it = std::upper_bound(src.group_ptr_.begin(),
+                                 src.group_ptr_.end(), ridx_[i]);
+      const size_t g = (it - src.group_ptr_.begin()) - 1;
+      const bst_uint gsize = src.group_ptr_[g + 1] - src.group_ptr_[g];
+      CHECK_EQ(ridx_[i], src.group_ptr_[g])
+          << "slice of grouped data must cover whole groups";
+      CHECK_LE(i + gsize, ridx_.size())
+          << "slice of grouped data must cover whole groups";
+      for (bst_uint j = 1; j < gsize; ++j) {
+        CHECK_EQ(ridx_[i + j], src.group_ptr_[g] + j)
+            << "slice of grouped data must cover whole groups";
+      }
+      info_.group_ptr_.push_back(info_.group_ptr_.back() + gsize);
+      i += gsize;
+    }
+  }
+
+  info_.num_row_ = ridx_.size();
+  info_.num_col_ = src.num_col_;
+
+  const SparsePage& page = *parent_->GetRowBatches().begin();
+  const auto& src_labels = src.labels_.ConstHostVector();
+  const auto& src_weights = src.weights_.ConstHostVector();
+  const auto& src_base_margin = src.base_margin_.ConstHostVector();
+  auto& labels = info_.labels_.HostVector();
+  auto& weights = info_.weights_.HostVector();
+  auto& base_margin = info_.base_margin_.HostVector();
+  for (bst_uint r : ridx_) {
+    CHECK_LT(r, page.Size()) << "slice index out of range";
+    info_.num_nonzero_ += page[r].size();
+    if (src_labels.size() != 0) {
+      labels.push_back(src_labels[r]);
+    }
+    if (src_weights.size() != 0) {
+      weights.push_back(src_weights[r]);
+    }
+    if (src_base_margin.size() != 0) {
+      base_margin.push_back(src_base_margin[r]);
+    }
+    if (src.root_index_.size() != 0) {
+      info_.root_index_.push_back(src.root_index_[r]);
+    }
+    if (src.qids_.size() != 0) {
+      info_.qids_.push_back(src.qids_[r]);
+    }
+  }
+}
+
+MetaInfo& SliceDMatrix::Info() { return info_; }
+
+const MetaInfo& SliceDMatrix::Info() const { return info_; }
+
+float SliceDMatrix::GetColDensity(size_t cidx) {
+  size_t column_size = 0;
+  // Use whatever version of column batches already exists
+  if (sorted_column_page_) {
+    auto batch = this->GetSortedColumnBatches();
+    column_size = (*batch.begin())[cidx].size();
+  } else {
+    auto batch = this->GetColumnBatches();
+    column_size = (*batch.begin())[cidx].size();
+  }
+
+  size_t nmiss = this->Info().num_row_ - column_size;
+  return 1.0f - (static_cast<float>(nmiss)) / this->Info().num_row_;
+}
+
+// single-page iterator with shared ownership of the page, so a gathered
+// page is released once the last iterator over it is gone
+class SharedPageBatchIteratorImpl : public BatchIteratorImpl {
+ public:
+  explicit SharedPageBatchIteratorImpl(std::shared_ptr<SparsePage> page)
+      : page_(std::move(page)) {}
+  const SparsePage& operator*() const override {
+    CHECK(page_ != nullptr);
+    return *page_;
+  }
+  void operator++() override { page_ = nullptr; }
+  bool AtEnd() const override { return page_ == nullptr; }
+  SharedPageBatchIteratorImpl* Clone() override {
+    return new SharedPageBatchIteratorImpl(*this);
+  }
+
+ private:
+  std::shared_ptr<SparsePage> page_;
+};
+
+std::shared_ptr<SparsePage> SliceDMatrix::GatherRowPage() {
+  auto page = std::make_shared<SparsePage>();
+  const SparsePage& src = *parent_->GetRowBatches().begin();
+  auto& offset_vec = page->offset.HostVector();
+  auto& data_vec = page->data.HostVector();
+  offset_vec.reserve(ridx_.size() + 1);
+  data_vec.reserve(info_.num_nonzero_);
+  for (bst_uint r : ridx_) {
+    auto inst = src[r];
+    data_vec.insert(data_vec.end(), inst.data(), inst.data() + inst.size());
+    offset_vec.push_back(offset_vec.back() + inst.size());
+  }
+  return page;
+}
+
+BatchSet SliceDMatrix::GetRowBatches() {
+  auto begin_iter =
+      BatchIterator(new SharedPageBatchIteratorImpl(this->GatherRowPage()));
+  return BatchSet(begin_iter);
+}
+
+BatchSet SliceDMatrix::GetColumnBatches() {
+  // column page doesn't exist, generate it from the gathered rows
+  if (!column_page_) {
+    column_page_.reset(
+        new SparsePage(this->GatherRowPage()->GetTranspose(info_.num_col_)));
+  }
+  auto begin_iter =
+      BatchIterator(new SharedPageBatchIteratorImpl(column_page_));
+  return BatchSet(begin_iter);
+}
+
+BatchSet SliceDMatrix::GetSortedColumnBatches() {
+  // Sorted column page doesn't exist, generate it from the gathered rows
+  if (!sorted_column_page_) {
+    sorted_column_page_.reset(
+        new SparsePage(this->GatherRowPage()->GetTranspose(info_.num_col_)));
+    sorted_column_page_->SortRows();
+  }
+  auto begin_iter =
+      BatchIterator(new SharedPageBatchIteratorImpl(sorted_column_page_));
+  return BatchSet(begin_iter);
+}
+
+bool SliceDMatrix::SingleColBlock() const { return true; }
+
+DMatrix* SliceDMatrix::ViewParent(const std::vector<bst_uint>** out_ridx) {
+  if (out_ridx != nullptr) {
+    *out_ridx = &ridx_;
+  }
+  return parent_.get();
+}
+}  // namespace data
+}  // namespace xgboost
@@ -0,0 +1,67 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file slice_dmatrix.h
+ * \brief Row view over another DMatrix, for zero-copy fold construction.
+ */
+#ifndef XGBOOST_DATA_SLICE_DMATRIX_H_
+#define XGBOOST_DATA_SLICE_DMATRIX_H_
+
+#include <xgboost/base.h>
+#include <xgboost/data.h>
+#include <memory>
+#include <vector>
+
+namespace xgboost {
+namespace data {
+
+/*!
+ * \brief A DMatrix that presents a subset of the rows of a parent matrix,
+ *  holding only the row index list and the sliced per-row meta info.
+ *  Construction is O(rows in the view); the feature entries stay in the
+ *  parent. Row batches are gathered into a page owned by the iterators on
+ *  demand, so the gathered copy lives only while somebody iterates, and
+ *  the hist updater bypasses even that by gathering the parent's
+ *  quantized matrix directly (see DMatrix::ViewParent). Column batches,
+ *  needed by the exact method, fall back to materializing the view's
+ *  transpose.
+ */
+class SliceDMatrix : public DMatrix {
+ public:
+  /*!
+   * \brief construct a view over parent containing the rows in ridx,
+   *  in that order. The parent must be an in-memory matrix; grouped
+   *  data may only be sliced along group boundaries, with ridx covering
+   *  each selected group completely and in row order.
+   */
+  SliceDMatrix(std::shared_ptr<DMatrix> parent, std::vector<bst_uint> ridx);
+
+  MetaInfo& Info() override;
+
+  const MetaInfo& Info() const override;
+
+  float GetColDensity(size_t cidx) override;
+
+  bool SingleColBlock() const override;
+
+  BatchSet GetRowBatches() override;
+
+  BatchSet GetColumnBatches() override;
+
+  BatchSet GetSortedColumnBatches() override;
+
+  DMatrix* ViewParent(const std::vector<bst_uint>** out_ridx) override;
+
+ private:
+  // gather the view's rows out of the parent's row page
+  std::shared_ptr<SparsePage> GatherRowPage();
+
+  std::shared_ptr<DMatrix> parent_;
+  std::vector<bst_uint> ridx_;
+  MetaInfo info_;
+
+  std::shared_ptr<SparsePage> sorted_column_page_;
+  std::shared_ptr<SparsePage> column_page_;
+};
+}  // namespace data
+}  // namespace xgboost
+#endif  // XGBOOST_DATA_SLICE_DMATRIX_H_
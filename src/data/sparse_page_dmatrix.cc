@@ -5,6 +5,7 @@
  * \author Tianqi Chen
  */
 #include <dmlc/base.h>
+#include <dmlc/parameter.h>
 #include <dmlc/timer.h>
 #include <xgboost/logging.h>
 #include <memory>
@@ -43,6 +44,11 @@ class SparseBatchIteratorImpl : public BatchIteratorImpl {
 
 BatchSet SparsePageDMatrix::GetRowBatches() {
   auto cast = dynamic_cast<SparsePageSource*>(row_source_.get());
+  // opt-in knob until the tree updaters request page sampling themselves
+  const float page_subsample = dmlc::GetEnv("XGBOOST_PAGE_SUBSAMPLE", 1.0f);
+  if (page_subsample < 1.0f) {
+    cast->SetSampling(page_subsample, 0);
+  }
   cast->BeforeFirst();
   cast->Next();
   auto begin_iter = BatchIterator(new SparseBatchIteratorImpl(cast));
@@ -50,9 +56,15 @@ BatchSet SparsePageDMatrix::GetRowBatches() {
 }
 
 BatchSet SparsePageDMatrix::GetSortedColumnBatches() {
-  // Lazily instantiate
+  // Lazily instantiate; a complete cache from an earlier run over the
+  // same data is reused so the transpose and sort are skipped entirely
   if (!sorted_column_source_) {
-    SparsePageSource::CreateColumnPage(this, cache_info_, true);
+    if (!SparsePageSource::CacheStampValid(cache_info_, ".sorted.col.page",
+                                           this->Info())) {
+      SparsePageSource::CreateColumnPage(this, cache_info_, true);
+    } else {
+      LOG(CONSOLE) << "SparsePageSource: Reusing sorted column page cache";
+    }
     sorted_column_source_.reset(
         new SparsePageSource(cache_info_, ".sorted.col.page"));
   }
@@ -64,9 +76,15 @@ BatchSet SparsePageDMatrix::GetSortedColumnBatches() {
 }
 
 BatchSet SparsePageDMatrix::GetColumnBatches() {
-  // Lazily instantiate
+  // Lazily instantiate; a complete cache from an earlier run over the
+  // same data is reused so the transpose is skipped entirely
   if (!column_source_) {
-    SparsePageSource::CreateColumnPage(this, cache_info_, false);
+    if (!SparsePageSource::CacheStampValid(cache_info_, ".col.page",
+                                           this->Info())) {
+      SparsePageSource::CreateColumnPage(this, cache_info_, false);
+    } else {
+      LOG(CONSOLE) << "SparsePageSource: Reusing column page cache";
+    }
     column_source_.reset(new SparsePageSource(cache_info_, ".col.page"));
   }
   column_source_->BeforeFirst();
@@ -76,6 +94,12 @@ BatchSet SparsePageDMatrix::GetColumnBatches() {
   return BatchSet(begin_iter);
 }
 
+void SparsePageDMatrix::SetPageSubsample(float keep_prob, uint64_t seed) {
+  // only the row pages are sampled; column batches always see all rows
+  auto cast = dynamic_cast<SparsePageSource*>(row_source_.get());
+  cast->SetSampling(keep_prob, seed);
+}
+
 float SparsePageDMatrix::GetColDensity(size_t cidx) {
   // Finds densities if we don't already have them
   if (col_density_.empty()) {
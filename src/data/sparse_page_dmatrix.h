@@ -33,6 +33,8 @@ class SparsePageDMatrix : public DMatrix {
 
   BatchSet GetColumnBatches() override;
 
+  void SetPageSubsample(float keep_prob, uint64_t seed) override;
+
   float GetColDensity(size_t cidx) override;
 
   bool SingleColBlock() const override;
@@ -5,6 +5,7 @@
  */
 #include <xgboost/data.h>
 #include <dmlc/registry.h>
+#include <cstring>
 #include "./sparse_page_writer.h"
 
 namespace xgboost {
@@ -79,6 +80,72 @@ class SparsePageRawFormat : public SparsePageFormat {
     return true;
   }
 
+  bool SupportsMemoryRead() const override {
+    return true;
+  }
+
+  bool Read(SparsePage* page, const char* image,
+            size_t size, size_t* cursor) override {
+    // the raw format is a flat dump of the offset and data arrays, so a
+    // page can be decoded from a memory mapped cache file without going
+    // through a stream
+    size_t pos = *cursor;
+    uint64_t noffset;
+    if (pos + sizeof(noffset) > size) return false;
+    std::memcpy(&noffset, image + pos, sizeof(noffset));
+    pos += sizeof(noffset);
+    CHECK_NE(noffset, 0U) << "Invalid SparsePage file";
+    auto& offset_vec = page->offset.HostVector();
+    CHECK_LE(pos + noffset * sizeof(size_t), size)
+        << "Invalid SparsePage file";
+    offset_vec.resize(noffset);
+    std::memcpy(dmlc::BeginPtr(offset_vec), image + pos,
+                noffset * sizeof(size_t));
+    pos += noffset * sizeof(size_t);
+    auto& data_vec = page->data.HostVector();
+    data_vec.resize(offset_vec.back());
+    if (page->data.Size() != 0) {
+      CHECK_LE(pos + page->data.Size() * sizeof(Entry), size)
+          << "Invalid SparsePage file";
+      std::memcpy(dmlc::BeginPtr(data_vec), image + pos,
+                  page->data.Size() * sizeof(Entry));
+      pos += page->data.Size() * sizeof(Entry);
+    }
+    *cursor = pos;
+    return true;
+  }
+
+  bool SkipPage(SparsePage* scratch, dmlc::SeekStream* fi,
+                size_t* out_rows) override {
+    // only the offset array is needed to find the end of the page, the
+    // entries can be seeked over without touching them
+    if (!fi->Read(&disk_offset_)) return false;
+    CHECK_NE(disk_offset_.size(), 0U) << "Invalid SparsePage file";
+    *out_rows = disk_offset_.size() - 1;
+    fi->Seek(fi->Tell() + disk_offset_.back() * sizeof(Entry));
+    return true;
+  }
+
+  bool SkipPage(const char* image, size_t size, size_t* cursor,
+                size_t* out_rows) override {
+    size_t pos = *cursor;
+    uint64_t noffset;
+    if (pos + sizeof(noffset) > size) return false;
+    std::memcpy(&noffset, image + pos, sizeof(noffset));
+    pos += sizeof(noffset);
+    CHECK_NE(noffset, 0U) << "Invalid SparsePage file";
+    CHECK_LE(pos + noffset * sizeof(size_t), size)
+        << "Invalid SparsePage file";
+    size_t nentry;
+    std::memcpy(&nentry, image + pos + (noffset - 1) * sizeof(size_t),
+                sizeof(nentry));
+    pos += noffset * sizeof(size_t) + nentry * sizeof(Entry);
+    CHECK_LE(pos, size) << "Invalid SparsePage file";
+    *out_rows = noffset - 1;
+    *cursor = pos;
+    return true;
+  }
+
   void Write(const SparsePage& page, dmlc::Stream* fo) override {
     const auto& offset_vec = page.offset.HostVector();
     const auto& data_vec = page.data.HostVector();
@@ -3,9 +3,11 @@
  * \file sparse_page_source.cc
  */
 #include <dmlc/base.h>
+#include <dmlc/parameter.h>
 #include <dmlc/timer.h>
 #include <xgboost/logging.h>
 #include <memory>
+#include <random>
 #include <vector>
 #include <string>
 #include <locale>
@@ -14,6 +16,15 @@
 #include "./sparse_page_source.h"
 #include "../common/common.h"
 
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+#define XGBOOST_USE_MMAP_PAGE_CACHE 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // !defined(_WIN32) && !defined(__CYGWIN__)
+#include <cstring>
+
 namespace {
 
 // Split a cache info string with delimiter ':'
@@ -38,6 +49,77 @@ GetCacheShards(const std::string& cache_info) {
 namespace xgboost {
 namespace data {
 
+/*!
+ * \brief Read-only memory mapping of a page cache file. Pages are decoded
+ *  straight out of the mapping, so the OS page cache backs the reads and
+ *  no stream buffer has to be maintained per prefetcher.
+ */
+class MmapFile {
+ public:
+  ~MmapFile() {
+#ifdef XGBOOST_USE_MMAP_PAGE_CACHE
+    if (addr_ != nullptr) {
+      munmap(addr_, size_);
+    }
+#endif
+  }
+  /*!
+   * \brief Map the given local file; returns nullptr when the file cannot
+   *  be mapped (remote filesystem path, empty file, or unsupported OS).
+   */
+  static MmapFile* Open(const std::string& path) {
+#ifdef XGBOOST_USE_MMAP_PAGE_CACHE
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) return nullptr;
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || sb.st_size <= 0) {
+      close(fd);
+      return nullptr;
+    }
+    void* addr = mmap(nullptr, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping keeps its own reference to the file
+    close(fd);
+    if (addr == MAP_FAILED) return nullptr;
+    auto* out = new MmapFile();
+    out->addr_ = addr;
+    out->size_ = static_cast<size_t>(sb.st_size);
+    return out;
+#else
+    return nullptr;
+#endif
+  }
+  /*! \brief start of the mapped file image */
+  const char* data() const {
+    return static_cast<const char*>(addr_);
+  }
+  /*! \brief size of the mapped file in bytes */
+  size_t size() const {
+    return size_;
+  }
+
+ private:
+  MmapFile() = default;
+
+  void* addr_{nullptr};
+  size_t size_{0};
+};
+
+namespace {
+// decode a dmlc serialized string from a file image; returns false when
+// the image is too small to hold it
+inline bool ReadStringFromImage(const MmapFile& file, size_t* cursor,
+                                std::string* out) {
+  uint64_t len;
+  if (*cursor + sizeof(len) > file.size()) return false;
+  std::memcpy(&len, file.data() + *cursor, sizeof(len));
+  *cursor += sizeof(len);
+  if (*cursor + len > file.size()) return false;
+  out->assign(file.data() + *cursor, len);
+  *cursor += len;
+  return true;
+}
+}  // anonymous namespace
+
 SparsePageSource::SparsePageSource(const std::string& cache_info,
                                    const std::string& page_type)
     : base_rowid_(0), page_(nullptr), clock_ptr_(0) {
@@ -51,27 +133,123 @@ SparsePageSource::SparsePageSource(const std::string& cache_info,
     CHECK_EQ(finfo->Read(&tmagic, sizeof(tmagic)), sizeof(tmagic));
     this->info.LoadBinary(finfo.get());
   }
+  {
+    // the writer records which shard each page went to when it balanced
+    // load instead of going round-robin; without the sidecar we fall back
+    // to the round-robin clock rotation
+    std::string name_order = cache_shards[0] + page_type + ".order";
+    std::unique_ptr<dmlc::Stream> forder(
+        dmlc::Stream::Create(name_order.c_str(), "r", true));
+    if (forder != nullptr) {
+      CHECK(forder->Read(&shard_order_)) << "Invalid page order file";
+    }
+  }
+  {
+    // per-page row counts, written by newer caches; needed to skip pages
+    // on disk while keeping base row ids aligned with the meta info
+    std::string name_rows = cache_shards[0] + page_type + ".rows";
+    std::unique_ptr<dmlc::Stream> frows(
+        dmlc::Stream::Create(name_rows.c_str(), "r", true));
+    if (frows != nullptr) {
+      CHECK(frows->Read(&page_rows_)) << "Invalid page row count file";
+    }
+  }
   files_.resize(cache_shards.size());
+  mmaps_.resize(cache_shards.size());
   formats_.resize(cache_shards.size());
   prefetchers_.resize(cache_shards.size());
+  plans_.resize(cache_shards.size());
+
+  // number of decoded pages each shard keeps in flight; deeper pipelines
+  // ride out compute bursts that would otherwise drain the buffer and
+  // stall the train loop on I/O
+  const size_t prefetch_depth = static_cast<size_t>(
+      std::max(1, dmlc::GetEnv("XGBOOST_PAGE_PREFETCH_DEPTH", 4)));
 
   // read in the cache files.
   for (size_t i = 0; i < cache_shards.size(); ++i) {
     std::string name_row = cache_shards[i] + page_type;
+    // serve the shard out of a memory mapping when the file is a local
+    // file and the format can decode in place; the OS page cache then
+    // backs the reads instead of a per-prefetcher stream buffer
+    mmaps_[i].reset(MmapFile::Open(name_row));
+    if (mmaps_[i] != nullptr) {
+      const MmapFile* map = mmaps_[i].get();
+      size_t header = 0;
+      std::string format;
+      if (ReadStringFromImage(*map, &header, &format)) {
+        std::unique_ptr<SparsePageFormat> fmt(SparsePageFormat::Create(format));
+        if (fmt->SupportsMemoryRead()) {
+          formats_[i] = std::move(fmt);
+          std::unique_ptr<SparsePageFormat>& f = formats_[i];
+          std::shared_ptr<SamplePlan>* plan_slot = &plans_[i];
+          auto cursor = std::make_shared<size_t>(header);
+          auto pos = std::make_shared<size_t>(0);
+          const size_t fbegin = header;
+          prefetchers_[i].reset(
+              new dmlc::ThreadedIter<SparsePage>(prefetch_depth));
+          prefetchers_[i]->Init(
+              [&f, map, cursor, plan_slot, pos] (SparsePage** dptr) {
+              if (*dptr == nullptr) {
+                *dptr = new SparsePage();
+              }
+              std::shared_ptr<SamplePlan> plan = std::atomic_load(plan_slot);
+              for (;;) {
+                bool keep = true;
+                if (plan != nullptr && *pos < plan->keep.size()) {
+                  keep = plan->keep[*pos] != 0;
+                  ++*pos;
+                }
+                if (keep) {
+                  return f->Read(*dptr, map->data(), map->size(),
+                                 cursor.get());
+                }
+                size_t nrows;
+                if (!f->SkipPage(map->data(), map->size(), cursor.get(),
+                                 &nrows)) {
+                  return false;
+                }
+              }
+            }, [cursor, fbegin, pos] () { *cursor = fbegin; *pos = 0; });
+          continue;
+        }
+      }
+      mmaps_[i].reset();
+    }
     files_[i].reset(dmlc::SeekStream::CreateForRead(name_row.c_str()));
     std::unique_ptr<dmlc::SeekStream>& fi = files_[i];
     std::string format;
     CHECK(fi->Read(&format)) << "Invalid page format";
     formats_[i].reset(SparsePageFormat::Create(format));
     std::unique_ptr<SparsePageFormat>& fmt = formats_[i];
+    std::shared_ptr<SamplePlan>* plan_slot = &plans_[i];
+    auto pos = std::make_shared<size_t>(0);
+    // scratch page for formats whose SkipPage has to decode and discard
+    auto scratch = std::make_shared<SparsePage>();
     size_t fbegin = fi->Tell();
-    prefetchers_[i].reset(new dmlc::ThreadedIter<SparsePage>(4));
-    prefetchers_[i]->Init([&fi, &fmt] (SparsePage** dptr) {
+    prefetchers_[i].reset(
+        new dmlc::ThreadedIter<SparsePage>(prefetch_depth));
+    prefetchers_[i]->Init(
+        [&fi, &fmt, plan_slot, pos, scratch] (SparsePage** dptr) {
         if (*dptr == nullptr) {
           *dptr = new SparsePage();
         }
-        return fmt->Read(*dptr, fi.get());
-      }, [&fi, fbegin] () { fi->Seek(fbegin); });
+        std::shared_ptr<SamplePlan> plan = std::atomic_load(plan_slot);
+        for (;;) {
+          bool keep = true;
+          if (plan != nullptr && *pos < plan->keep.size()) {
+            keep = plan->keep[*pos] != 0;
+            ++*pos;
+          }
+          if (keep) {
+            return fmt->Read(*dptr, fi.get());
+          }
+          size_t nrows;
+          if (!fmt->SkipPage(scratch.get(), fi.get(), &nrows)) {
+            return false;
+          }
+        }
+      }, [&fi, fbegin, pos] () { fi->Seek(fbegin); *pos = 0; });
   }
 }
 
@@ -80,14 +258,35 @@ SparsePageSource::~SparsePageSource() {
 }
 
 bool SparsePageSource::Next() {
-  // doing clock rotation over shards.
+  // pick the shard holding the next page: follow this epoch's sampling
+  // plan when sampling, else the recorded write order when present,
+  // otherwise do clock rotation over shards.
+  size_t shard;
+  if (sample_keep_ < 1.0f) {
+    if (sample_pos_ >= kept_shard_.size()) return false;
+    shard = kept_shard_[sample_pos_];
+  } else if (!shard_order_.empty()) {
+    if (order_pos_ >= shard_order_.size()) return false;
+    shard = static_cast<size_t>(shard_order_[order_pos_]);
+    CHECK_LT(shard, prefetchers_.size()) << "Invalid page order file";
+  } else {
+    shard = clock_ptr_;
+  }
   if (page_ != nullptr) {
-    size_t n = prefetchers_.size();
-    prefetchers_[(clock_ptr_ + n - 1) % n]->Recycle(&page_);
+    prefetchers_[last_shard_]->Recycle(&page_);
   }
-  if (prefetchers_[clock_ptr_]->Next(&page_)) {
-    page_->base_rowid = base_rowid_;
-    base_rowid_ += page_->Size();
+  if (prefetchers_[shard]->Next(&page_)) {
+    if (sample_keep_ < 1.0f) {
+      // a kept page keeps the base row id it had in the full pass so
+      // its rows still line up with labels and gradients
+      page_->base_rowid = kept_base_rowid_[sample_pos_];
+      ++sample_pos_;
+    } else {
+      page_->base_rowid = base_rowid_;
+      base_rowid_ += page_->Size();
+      ++order_pos_;
+    }
+    last_shard_ = shard;
     // advance clock
     clock_ptr_ = (clock_ptr_ + 1) % prefetchers_.size();
     return true;
@@ -99,11 +298,64 @@ bool SparsePageSource::Next() {
 void SparsePageSource::BeforeFirst() {
   base_rowid_ = 0;
   clock_ptr_ = 0;
+  order_pos_ = 0;
+  sample_pos_ = 0;
+  kept_shard_.clear();
+  kept_base_rowid_.clear();
+  const size_t nshard = prefetchers_.size();
+  if (sample_keep_ < 1.0f) {
+    // draw this epoch's page sample up front: which shard holds each
+    // global page fixes both the per-shard skip plans handed to the
+    // prefetchers and the base row id every kept page must carry
+    if (!shard_order_.empty()) {
+      CHECK_EQ(shard_order_.size(), page_rows_.size())
+          << "Inconsistent page cache sidecar files";
+    }
+    std::vector<std::shared_ptr<SamplePlan> > plans(nshard);
+    for (auto& p : plans) {
+      p = std::make_shared<SamplePlan>();
+    }
+    std::mt19937 rng(static_cast<uint32_t>(sample_seed_ + epoch_));
+    std::bernoulli_distribution coin(sample_keep_);
+    size_t row = 0;
+    for (size_t g = 0; g < page_rows_.size(); ++g) {
+      const size_t shard = shard_order_.empty()
+          ? g % nshard : static_cast<size_t>(shard_order_[g]);
+      const bool keep = coin(rng);
+      plans[shard]->keep.push_back(keep ? 1 : 0);
+      if (keep) {
+        kept_shard_.push_back(shard);
+        kept_base_rowid_.push_back(row);
+      }
+      row += page_rows_[g];
+    }
+    for (size_t i = 0; i < nshard; ++i) {
+      std::atomic_store(&plans_[i], plans[i]);
+    }
+  } else {
+    for (size_t i = 0; i < nshard; ++i) {
+      std::atomic_store(&plans_[i], std::shared_ptr<SamplePlan>());
+    }
+  }
+  ++epoch_;
   for (auto& p : prefetchers_) {
     p->BeforeFirst();
   }
 }
 
+void SparsePageSource::SetSampling(float keep_prob, uint64_t seed) {
+  CHECK_GT(keep_prob, 0.0f);
+  CHECK_LE(keep_prob, 1.0f);
+  if (keep_prob < 1.0f && page_rows_.empty()) {
+    LOG(WARNING) << "Page cache has no row count sidecar, "
+                 << "page-level subsampling is disabled; "
+                 << "regenerate the cache files to enable it";
+    return;
+  }
+  sample_keep_ = keep_prob;
+  sample_seed_ = seed;
+}
+
 const SparsePage& SparsePageSource::Value() const {
   return *page_;
 }
@@ -125,6 +377,29 @@ bool SparsePageSource::CacheExist(const std::string& cache_info,
   return true;
 }
 
+bool SparsePageSource::CacheStampValid(const std::string& cache_info,
+                                       const std::string& page_type,
+                                       const MetaInfo& info) {
+  if (!CacheExist(cache_info, page_type)) return false;
+  std::vector<std::string> cache_shards = GetCacheShards(cache_info);
+  CHECK_NE(cache_shards.size(), 0U);
+  std::string name_stamp = cache_shards[0] + page_type + ".stamp";
+  std::unique_ptr<dmlc::Stream> fs(
+      dmlc::Stream::Create(name_stamp.c_str(), "r", true));
+  if (fs == nullptr) return false;
+  int tmagic;
+  uint64_t num_row, num_col, num_nonzero;
+  if (fs->Read(&tmagic, sizeof(tmagic)) != sizeof(tmagic)) return false;
+  if (tmagic != kMagic) return false;
+  if (fs->Read(&num_row, sizeof(num_row)) != sizeof(num_row)) return false;
+  if (fs->Read(&num_col, sizeof(num_col)) != sizeof(num_col)) return false;
+  if (fs->Read(&num_nonzero, sizeof(num_nonzero)) != sizeof(num_nonzero)) {
+    return false;
+  }
+  return num_row == info.num_row_ && num_col == info.num_col_ &&
+         num_nonzero == info.num_nonzero_;
+}
+
 void SparsePageSource::CreateRowPage(dmlc::Parser<uint32_t>* src,
                               const std::string& cache_info) {
   const std::string page_type = ".row.page";
@@ -137,8 +412,16 @@ void SparsePageSource::CreateRowPage(dmlc::Parser<uint32_t>* src,
     name_shards.push_back(prefix + page_type);
     format_shards.push_back(SparsePageFormat::DecideFormat(prefix).first);
   }
+  // in-flight memory budget while spilling: each page is bounded by the
+  // page size and the writer recycles a bounded pool of them, so peak
+  // ingestion memory stays at roughly page_size * (extra_buffers + shards)
+  const size_t page_size = static_cast<size_t>(std::max(
+      1, dmlc::GetEnv("XGBOOST_PAGE_SIZE_MB",
+                      static_cast<int>(kPageSize >> 20UL)))) << 20UL;
+  const size_t extra_buffers = static_cast<size_t>(
+      std::max(1, dmlc::GetEnv("XGBOOST_PAGE_WRITE_BUFFERS", 6)));
   {
-    SparsePageWriter writer(name_shards, format_shards, 6);
+    SparsePageWriter writer(name_shards, format_shards, extra_buffers);
     std::shared_ptr<SparsePage> page;
     writer.Alloc(&page); page->Clear();
 
@@ -183,7 +466,7 @@ void SparsePageSource::CreateRowPage(dmlc::Parser<uint32_t>* src,
                                 static_cast<uint64_t>(index + 1));
       }
       page->Push(batch);
-      if (page->MemCostBytes() >= kPageSize) {
+      if (page->MemCostBytes() >= page_size) {
         bytes_write += page->MemCostBytes();
         writer.PushWrite(std::move(page));
         writer.Alloc(&page);
@@ -215,6 +498,22 @@ void SparsePageSource::CreateRowPage(dmlc::Parser<uint32_t>* src,
     // Either every row has query ID or none at all
     CHECK(info.qids_.empty() || info.qids_.size() == info.num_row_);
     info.SaveBinary(fo.get());
+    if (name_shards.size() > 1) {
+      // record which shard each page went to so readers can restore the
+      // original page order under load-balanced writing
+      std::string name_order = name_info + page_type + ".order";
+      std::unique_ptr<dmlc::Stream> fo_order(
+          dmlc::Stream::Create(name_order.c_str(), "w"));
+      fo_order->Write(writer.ShardAssignment());
+    }
+    {
+      // per-page row counts, so a sampling-aware reader can skip pages
+      // on disk while keeping base row ids aligned
+      std::string name_rows = name_info + page_type + ".rows";
+      std::unique_ptr<dmlc::Stream> fo_rows(
+          dmlc::Stream::Create(name_rows.c_str(), "w"));
+      fo_rows->Write(writer.PageRows());
+    }
   }
   LOG(CONSOLE) << "SparsePageSource: Finished writing to " << name_info;
 }
@@ -273,6 +572,37 @@ void SparsePageSource::CreatePageFromDMatrix(DMatrix* src,
     int tmagic = kMagic;
     fo->Write(&tmagic, sizeof(tmagic));
     info.SaveBinary(fo.get());
+    if (name_shards.size() > 1) {
+      // record which shard each page went to so readers can restore the
+      // original page order under load-balanced writing
+      std::string name_order = name_info + page_type + ".order";
+      std::unique_ptr<dmlc::Stream> fo_order(
+          dmlc::Stream::Create(name_order.c_str(), "w"));
+      fo_order->Write(writer.ShardAssignment());
+    }
+    {
+      // row count sidecar for page-skipping readers
+      std::string name_rows = name_info + page_type + ".rows";
+      std::unique_ptr<dmlc::Stream> fo_rows(
+          dmlc::Stream::Create(name_rows.c_str(), "w"));
+      fo_rows->Write(writer.PageRows());
+    }
+  }
+  {
+    // the writer threads have joined here, so the pages are on disk;
+    // stamp the cache so later runs can tell a complete, matching cache
+    // from a partial or stale one
+    std::string name_stamp = name_info + page_type + ".stamp";
+    std::unique_ptr<dmlc::Stream> fs(
+        dmlc::Stream::Create(name_stamp.c_str(), "w"));
+    int tmagic = kMagic;
+    fs->Write(&tmagic, sizeof(tmagic));
+    uint64_t num_row = src->Info().num_row_;
+    uint64_t num_col = src->Info().num_col_;
+    uint64_t num_nonzero = src->Info().num_nonzero_;
+    fs->Write(&num_row, sizeof(num_row));
+    fs->Write(&num_col, sizeof(num_col));
+    fs->Write(&num_nonzero, sizeof(num_nonzero));
   }
   LOG(CONSOLE) << "SparsePageSource: Finished writing to " << name_info;
 }
@@ -12,11 +12,15 @@
 #include <dmlc/threadediter.h>
 #include <vector>
 #include <algorithm>
+#include <memory>
 #include <string>
 #include "sparse_page_writer.h"
 
 namespace xgboost {
 namespace data {
+
+class MmapFile;  // read-only memory mapping of a cache file
+
 /*!
  * \brief External memory data source.
  * \code
@@ -41,6 +45,18 @@ class SparsePageSource : public DataSource {
   void BeforeFirst() override;
   // implement Value
   const SparsePage& Value() const override;
+  /*!
+   * \brief Request page-level row subsampling for subsequent iterations.
+   *  Each page is kept with probability keep_prob; skipped pages are
+   *  seeked over on disk without being decoded, so I/O drops roughly in
+   *  proportion. Kept pages retain their original base row ids. A new
+   *  sample is drawn on every BeforeFirst from seed plus the epoch
+   *  counter. Requires the row count sidecar written alongside the cache;
+   *  without it the request is ignored with a warning.
+   * \param keep_prob probability of keeping each page; 1 disables sampling.
+   * \param seed seed of the sampling sequence.
+   */
+  void SetSampling(float keep_prob, uint64_t seed);
   /*!
    * \brief Create source by taking data from parser.
    * \param src source parser.
@@ -70,12 +86,32 @@ class SparsePageSource : public DataSource {
    */
   static bool CacheExist(const std::string& cache_info,
                          const std::string& page_type);
+  /*!
+   * \brief Check that a derived page cache was written completely and
+   *  still matches the source data it was derived from.
+   * \param cache_info The cache prefix of files.
+   * \param page_type Type of the page.
+   * \param info Meta information of the source data.
+   * \return Whether the cached pages can be reused.
+   */
+  static bool CacheStampValid(const std::string& cache_info,
+                              const std::string& page_type,
+                              const MetaInfo& info);
   /*! \brief page size 32 MB */
   static const size_t kPageSize = 32UL << 20UL;
   /*! \brief magic number used to identify Page */
   static const int kMagic = 0xffffab02;
 
  private:
+  /*!
+   * \brief Per-shard page sampling plan of one epoch. Immutable once
+   *  built; the prefetcher threads pick up a fresh plan through an
+   *  atomic shared_ptr swap when they restart on BeforeFirst.
+   */
+  struct SamplePlan {
+    /*! \brief keep flag of each page of the shard, in shard order */
+    std::vector<char> keep;
+  };
   static void CreatePageFromDMatrix(DMatrix* src, const std::string& cache_info,
                                     const std::string& page_type);
   /*! \brief number of rows */
@@ -84,8 +120,32 @@ class SparsePageSource : public DataSource {
   SparsePage *page_;
   /*! \brief internal clock ptr */
   size_t clock_ptr_;
+  /*! \brief shard each page was written to, empty for round-robin caches */
+  std::vector<int> shard_order_;
+  /*! \brief position in shard_order_ */
+  size_t order_pos_{0};
+  /*! \brief shard the page on hold came from */
+  size_t last_shard_{0};
+  /*! \brief row count of each page in write order, empty for old caches */
+  std::vector<size_t> page_rows_;
+  /*! \brief probability of keeping each page, 1 disables sampling */
+  float sample_keep_{1.0f};
+  /*! \brief seed of the page sampling sequence */
+  uint64_t sample_seed_{0};
+  /*! \brief number of BeforeFirst calls, advances the sampling stream */
+  uint64_t epoch_{0};
+  /*! \brief per-shard keep flags of the current epoch */
+  std::vector<std::shared_ptr<SamplePlan> > plans_;
+  /*! \brief shard of each kept page, in global page order */
+  std::vector<size_t> kept_shard_;
+  /*! \brief original base row id of each kept page */
+  std::vector<size_t> kept_base_rowid_;
+  /*! \brief position in kept_shard_ */
+  size_t sample_pos_{0};
   /*! \brief file pointer to the row blob file. */
   std::vector<std::unique_ptr<dmlc::SeekStream> > files_;
+  /*! \brief memory mappings of the blob files, when served mmap-ed. */
+  std::vector<std::unique_ptr<MmapFile> > mmaps_;
   /*! \brief Sparse page format file. */
   std::vector<std::unique_ptr<SparsePageFormat> > formats_;
   /*! \brief internal prefetcher. */
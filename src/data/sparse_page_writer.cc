@@ -3,32 +3,132 @@
  * \file sparse_batch_writer.cc
  * \param Writer class sparse page.
  */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE  // for O_DIRECT
+#endif
+
 #include <xgboost/base.h>
 #include <xgboost/logging.h>
+#include <dmlc/parameter.h>
 #include "./sparse_page_writer.h"
 
 #if DMLC_ENABLE_STD_THREAD
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#if defined(O_DIRECT)
+#define XGBOOST_USE_DIRECT_IO 1
+#endif
+#endif  // defined(__linux__)
+
 namespace xgboost {
 namespace data {
 
+#ifdef XGBOOST_USE_DIRECT_IO
+namespace {
+/*!
+ * \brief Write-only stream over an O_DIRECT file descriptor. Data is staged
+ *  in an aligned buffer and flushed in block-aligned chunks, bypassing the
+ *  kernel page cache so cache writes do not evict training data. The final
+ *  partial block is padded and the file trimmed back on close.
+ */
+class DirectIOStream : public dmlc::Stream {
+ public:
+  /*! \brief open path for direct writing; nullptr when unsupported */
+  static DirectIOStream* Create(const std::string& path) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0666);
+    if (fd == -1) return nullptr;
+    void* buffer = nullptr;
+    if (posix_memalign(&buffer, kAlign, kBufferSize) != 0) {
+      close(fd);
+      return nullptr;
+    }
+    return new DirectIOStream(fd, static_cast<char*>(buffer));
+  }
+  ~DirectIOStream() override {
+    if (in_buffer_ != 0) {
+      const size_t padded = (in_buffer_ + kAlign - 1) / kAlign * kAlign;
+      std::memset(buffer_ + in_buffer_, 0, padded - in_buffer_);
+      CHECK_EQ(write(fd_, buffer_, padded), static_cast<ssize_t>(padded))
+          << "direct write failed";
+    }
+    CHECK_EQ(ftruncate(fd_, total_bytes_), 0) << "ftruncate failed";
+    close(fd_);
+    free(buffer_);
+  }
+  size_t Read(void* ptr, size_t size) override {
+    LOG(FATAL) << "DirectIOStream is write-only";
+    return 0;
+  }
+  void Write(const void* ptr, size_t size) override {
+    const char* src = static_cast<const char*>(ptr);
+    total_bytes_ += size;
+    while (size != 0) {
+      const size_t nfill = std::min(size, kBufferSize - in_buffer_);
+      std::memcpy(buffer_ + in_buffer_, src, nfill);
+      in_buffer_ += nfill;
+      src += nfill;
+      size -= nfill;
+      if (in_buffer_ == kBufferSize) {
+        CHECK_EQ(write(fd_, buffer_, kBufferSize),
+                 static_cast<ssize_t>(kBufferSize))
+            << "direct write failed";
+        in_buffer_ = 0;
+      }
+    }
+  }
+
+ private:
+  DirectIOStream(int fd, char* buffer) : fd_(fd), buffer_(buffer) {}
+
+  // O_DIRECT alignment requirement for buffer, size and file offset
+  static const size_t kAlign = 4096;
+  // staging buffer size, multiple of kAlign
+  static const size_t kBufferSize = 1 << 20;
+
+  int fd_;
+  char* buffer_;
+  size_t in_buffer_{0};
+  size_t total_bytes_{0};
+};
+}  // anonymous namespace
+#endif  // XGBOOST_USE_DIRECT_IO
+
 SparsePageWriter::SparsePageWriter(
     const std::vector<std::string>& name_shards,
     const std::vector<std::string>& format_shards,
     size_t extra_buffer_capacity)
     : num_free_buffer_(extra_buffer_capacity + name_shards.size()),
       clock_ptr_(0),
+      pending_(new std::atomic<size_t>[name_shards.size()]),
       workers_(name_shards.size()),
       qworkers_(name_shards.size()) {
   CHECK_EQ(name_shards.size(), format_shards.size());
   // start writer threads
   for (size_t i = 0; i < name_shards.size(); ++i) {
+    pending_[i] = 0;
     std::string name_shard = name_shards[i];
     std::string format_shard = format_shards[i];
     auto* wqueue = &qworkers_[i];
     workers_[i].reset(new std::thread(
-        [this, name_shard, format_shard, wqueue] () {
-          std::unique_ptr<dmlc::Stream> fo(
-              dmlc::Stream::Create(name_shard.c_str(), "w"));
+        [this, i, name_shard, format_shard, wqueue] () {
+          std::unique_ptr<dmlc::Stream> fo;
+#ifdef XGBOOST_USE_DIRECT_IO
+          if (dmlc::GetEnv("XGBOOST_PAGE_WRITE_DIRECT", 0) != 0) {
+            fo.reset(DirectIOStream::Create(name_shard));
+            if (fo == nullptr) {
+              LOG(WARNING) << "O_DIRECT open failed for " << name_shard
+                           << ", falling back to buffered I/O";
+            }
+          }
+#endif
+          if (fo == nullptr) {
+            fo.reset(dmlc::Stream::Create(name_shard.c_str(), "w"));
+          }
           std::unique_ptr<SparsePageFormat> fmt(
               SparsePageFormat::Create(format_shard));
           fo->Write(format_shard);
@@ -36,6 +136,7 @@ SparsePageWriter::SparsePageWriter(
           while (wqueue->Pop(&page)) {
             if (page == nullptr) break;
             fmt->Write(*page, fo.get());
+            pending_[i].fetch_sub(1, std::memory_order_relaxed);
             qrecycle_.Push(std::move(page));
           }
           fo.reset(nullptr);
@@ -56,7 +157,21 @@ SparsePageWriter::~SparsePageWriter() {
 }
 
 void SparsePageWriter::PushWrite(std::shared_ptr<SparsePage>&& page) {
-  qworkers_[clock_ptr_].Push(std::move(page));
+  // route the page to the shard with the fewest pages in flight so one
+  // slow device does not gate the others; ties follow the rotating clock
+  size_t best = clock_ptr_;
+  size_t best_depth = pending_[best].load(std::memory_order_relaxed);
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    const size_t depth = pending_[i].load(std::memory_order_relaxed);
+    if (depth < best_depth) {
+      best = i;
+      best_depth = depth;
+    }
+  }
+  pending_[best].fetch_add(1, std::memory_order_relaxed);
+  shard_assignment_.push_back(static_cast<int>(best));
+  page_rows_.push_back(page->Size());
+  qworkers_[best].Push(std::move(page));
   clock_ptr_ = (clock_ptr_ + 1) % workers_.size();
 }
 
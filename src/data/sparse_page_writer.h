@@ -18,6 +18,7 @@
 
 #if DMLC_ENABLE_STD_THREAD
 #include <dmlc/concurrency.h>
+#include <atomic>
 #include <thread>
 #endif
 
@@ -47,6 +48,54 @@ class SparsePageFormat {
   virtual bool Read(SparsePage* page,
                     dmlc::SeekStream* fi,
                     const std::vector<bst_uint>& sorted_index_set) = 0;
+  /*!
+   * \brief Whether this format can decode pages straight out of an
+   *  in-memory image of the cache file, e.g. a memory mapping.
+   */
+  virtual bool SupportsMemoryRead() const {
+    return false;
+  }
+  /*!
+   * \brief Load one page from an in-memory image of the cache file.
+   *  Only supported when SupportsMemoryRead() returns true.
+   * \param page The data to read page into.
+   * \param image start of the file image, positioned at the first page
+   * \param size total size of the image in bytes
+   * \param cursor read position in the image, advanced past the page
+   * \return true if a page was loaded, false if the end was reached
+   */
+  virtual bool Read(SparsePage* page, const char* image,
+                    size_t size, size_t* cursor) {
+    return false;
+  }
+  /*!
+   * \brief Advance fi past one page without materializing it. The
+   *  generic implementation decodes into scratch and discards; formats
+   *  that can seek past the payload override it to avoid the work.
+   * \param scratch reusable page for the generic fallback
+   * \param fi the input stream of the file
+   * \param out_rows number of rows the skipped page held
+   * \return true if a page was skipped, false if the end was reached
+   */
+  virtual bool SkipPage(SparsePage* scratch, dmlc::SeekStream* fi,
+                        size_t* out_rows) {
+    if (!this->Read(scratch, fi)) return false;
+    *out_rows = scratch->Size();
+    return true;
+  }
+  /*!
+   * \brief Advance cursor past one page of an in-memory image without
+   *  decoding it. Only supported when SupportsMemoryRead() returns true.
+   * \param image start of the file image
+   * \param size total size of the image in bytes
+   * \param cursor read position in the image, advanced past the page
+   * \param out_rows number of rows the skipped page held
+   * \return true if a page was skipped, false if the end was reached
+   */
+  virtual bool SkipPage(const char* image, size_t size, size_t* cursor,
+                        size_t* out_rows) {
+    return false;
+  }
   /*!
    * \brief save the data to fo, when a page was written.
    * \param fo output stream
@@ -96,12 +145,34 @@ class SparsePageWriter {
    * \param out_page Used to store the allocated pages.
    */
   void Alloc(std::shared_ptr<SparsePage>* out_page);
+  /*!
+   * \brief The shard each pushed page was routed to, in push order.
+   *  Readers need this to restore the original page order when the
+   *  writer balanced load across shards instead of going round-robin.
+   */
+  const std::vector<int>& ShardAssignment() const {
+    return shard_assignment_;
+  }
+  /*!
+   * \brief Number of rows in each pushed page, in push order.
+   *  Sampling-aware readers use this to skip pages on disk while still
+   *  assigning the remaining pages their original base row ids.
+   */
+  const std::vector<size_t>& PageRows() const {
+    return page_rows_;
+  }
 
  private:
   /*! \brief number of allocated pages */
   size_t num_free_buffer_;
   /*! \brief clock_pointer */
   size_t clock_ptr_;
+  /*! \brief pages queued but not yet written, per worker */
+  std::unique_ptr<std::atomic<size_t>[]> pending_;
+  /*! \brief shard id of each pushed page, in push order */
+  std::vector<int> shard_assignment_;
+  /*! \brief row count of each pushed page, in push order */
+  std::vector<size_t> page_rows_;
   /*! \brief writer threads */
   std::vector<std::unique_ptr<std::thread> > workers_;
   /*! \brief recycler queue */
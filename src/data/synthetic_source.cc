@@ -0,0 +1,147 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file synthetic_source.cc
+ * \brief implementation of the parameterized synthetic dataset generator.
+ */
+#include "./synthetic_source.h"
+
+#include <xgboost/logging.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "../common/common.h"
+
+namespace xgboost {
+namespace data {
+
+const char kSyntheticURIPrefix[] = "synthetic://";
+
+SyntheticParam SyntheticParam::Parse(const std::string& spec) {
+  SyntheticParam param;
+  std::vector<std::string> tokens = common::Split(spec, ',');
+  CHECK_GE(tokens.size(), 2U)
+      << "synthetic:// URI must at least specify rows,cols";
+  param.rows = static_cast<size_t>(atoll(tokens[0].c_str()));
+  param.cols = static_cast<size_t>(atoll(tokens[1].c_str()));
+  CHECK_GT(param.rows, 0U) << "synthetic:// rows must be positive";
+  CHECK_GT(param.cols, 0U) << "synthetic:// cols must be positive";
+  for (size_t i = 2; i < tokens.size(); ++i) {
+    const size_t eq = tokens[i].find('=');
+    CHECK_NE(eq, std::string::npos)
+        << "synthetic:// option '" << tokens[i] << "' is not key=value";
+    const std::string key = tokens[i].substr(0, eq);
+    const std::string value = tokens[i].substr(eq + 1);
+    if (key == "sparsity") {
+      param.sparsity = static_cast<float>(atof(value.c_str()));
+      CHECK(param.sparsity >= 0.0f && param.sparsity < 1.0f)
+          << "synthetic:// sparsity must be in [0, 1)";
+    } else if (key == "alpha") {
+      param.alpha = static_cast<float>(atof(value.c_str()));
+      CHECK_GE(param.alpha, 0.0f) << "synthetic:// alpha must be nonnegative";
+    } else if (key == "corr") {
+      param.corr = static_cast<float>(atof(value.c_str()));
+      CHECK(param.corr >= 0.0f && param.corr <= 1.0f)
+          << "synthetic:// corr must be in [0, 1]";
+    } else if (key == "group_size") {
+      param.group_size = static_cast<size_t>(atoll(value.c_str()));
+    } else if (key == "noise") {
+      param.noise = static_cast<float>(atof(value.c_str()));
+      CHECK_GE(param.noise, 0.0f) << "synthetic:// noise must be nonnegative";
+    } else if (key == "classes") {
+      param.classes = atoi(value.c_str());
+      CHECK_GE(param.classes, 2) << "synthetic:// classes must be >= 2";
+    } else if (key == "seed") {
+      param.seed = static_cast<uint32_t>(atoll(value.c_str()));
+    } else {
+      LOG(FATAL) << "unknown synthetic:// option '" << key << "'";
+    }
+  }
+  return param;
+}
+
+std::unique_ptr<SimpleCSRSource> CreateSyntheticSource(
+    const SyntheticParam& param, int partid, int npart) {
+  CHECK(partid >= 0 && npart >= 1 && partid < npart);
+  // shard the rows the same way a row-split file load would
+  const size_t nrow = param.rows / npart +
+      (static_cast<size_t>(partid) < param.rows % npart ? 1 : 0);
+  // distinct deterministic stream per part
+  std::mt19937 rng(param.seed + 2654435761U * (partid + 1));
+  std::uniform_real_distribution<float> unif(0.0f, 1.0f);
+  std::normal_distribution<float> normal(0.0f, 1.0f);
+
+  // per-feature density profile: proportional to (j+1)^-alpha, scaled so
+  // the mean matches the requested overall density; with alpha > 0 the
+  // head features stay dense while the tail thins out, the shape long
+  // one-hot heavy production datasets have
+  std::vector<float> density(param.cols);
+  double weight_sum = 0.0;
+  for (size_t j = 0; j < param.cols; ++j) {
+    density[j] = std::pow(static_cast<float>(j + 1), -param.alpha);
+    weight_sum += density[j];
+  }
+  const double scale = (1.0 - param.sparsity) * param.cols / weight_sum;
+  for (size_t j = 0; j < param.cols; ++j) {
+    density[j] = std::min(1.0f, static_cast<float>(density[j] * scale));
+  }
+
+  // fixed linear model the labels are drawn from, shared by all parts
+  std::mt19937 model_rng(param.seed);
+  std::vector<float> model_weight(param.cols);
+  for (auto& w : model_weight) {
+    w = 2.0f * unif(model_rng) - 1.0f;
+  }
+
+  std::vector<size_t> offset(nrow + 1, 0);
+  std::vector<Entry> entries;
+  entries.reserve(static_cast<size_t>(
+      nrow * param.cols * (1.0 - param.sparsity) + 1));
+  std::vector<bst_float> labels(nrow);
+  for (size_t i = 0; i < nrow; ++i) {
+    // shared latent factor inducing correlation between the features of
+    // one row
+    const float latent = unif(rng);
+    double margin = 0.0;
+    for (size_t j = 0; j < param.cols; ++j) {
+      if (unif(rng) >= density[j]) continue;
+      const float value =
+          (1.0f - param.corr) * unif(rng) + param.corr * latent;
+      entries.emplace_back(static_cast<bst_uint>(j), value);
+      margin += value * model_weight[j];
+    }
+    offset[i + 1] = entries.size();
+    float label = static_cast<float>(margin) + param.noise * normal(rng);
+    if (param.classes >= 2) {
+      // bucket through the logistic response
+      const float prob = 1.0f / (1.0f + std::exp(-label));
+      label = std::min<float>(param.classes - 1,
+                              std::floor(prob * param.classes));
+    }
+    labels[i] = label;
+  }
+
+  std::unique_ptr<SimpleCSRSource> source(new SimpleCSRSource());
+  source->Adopt(std::move(offset), std::move(entries), param.cols);
+  source->info.labels_.HostVector() = std::move(labels);
+  if (param.group_size != 0) {
+    // ranking groups with poisson-distributed sizes around the mean
+    std::poisson_distribution<size_t> group_dist(
+        static_cast<double>(param.group_size));
+    std::vector<bst_uint>& group_ptr = source->info.group_ptr_;
+    group_ptr.push_back(0);
+    while (group_ptr.back() < nrow) {
+      const size_t size = std::max<size_t>(1, group_dist(rng));
+      group_ptr.push_back(static_cast<bst_uint>(
+          std::min<size_t>(nrow, group_ptr.back() + size)));
+    }
+  }
+  return source;
+}
+
+}  // namespace data
+}  // namespace xgboost
@@ -0,0 +1,66 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file synthetic_source.h
+ * \brief parameterized synthetic dataset generator, reachable from the
+ *  CLI through synthetic:// URIs and from the benchmark suite directly.
+ *  Meant to reproduce the structure of large production workloads --
+ *  power-law feature sparsity, correlated features, grouped ranking
+ *  data, label noise -- without shipping the data itself.
+ */
+#ifndef XGBOOST_DATA_SYNTHETIC_SOURCE_H_
+#define XGBOOST_DATA_SYNTHETIC_SOURCE_H_
+
+#include <memory>
+#include <string>
+
+#include "./simple_csr_source.h"
+
+namespace xgboost {
+namespace data {
+
+/*! \brief URI scheme the data loader dispatches on */
+extern const char kSyntheticURIPrefix[];
+
+/*!
+ * \brief parameters of the synthetic generator, parsed from a URI of
+ *  the form
+ *
+ *    synthetic://rows,cols[,key=value...]
+ *
+ *  with keys:
+ *   - sparsity: base fraction of missing entries, default 0
+ *   - alpha: power-law exponent of the per-feature density profile;
+ *     0 keeps all features equally dense
+ *   - corr: blend factor of a shared per-row latent factor into every
+ *     feature value, inducing feature correlation
+ *   - group_size: mean size of ranking groups; 0 generates no groups
+ *   - noise: standard deviation of gaussian label noise
+ *   - classes: >= 2 buckets the labels for classification tasks
+ *   - seed: generator seed
+ */
+struct SyntheticParam {
+  size_t rows{0};
+  size_t cols{0};
+  float sparsity{0.0f};
+  float alpha{0.0f};
+  float corr{0.0f};
+  size_t group_size{0};
+  float noise{0.0f};
+  int classes{0};
+  uint32_t seed{0};
+  /*! \brief parse the specification behind the synthetic:// prefix */
+  static SyntheticParam Parse(const std::string& spec);
+};
+
+/*!
+ * \brief materialize a synthetic dataset. partid/npart shard the rows
+ *  the same way row-split distributed loading shards a file; every part
+ *  draws from its own deterministic stream, so workers generate
+ *  disjoint rows and repeated runs see identical data.
+ */
+std::unique_ptr<SimpleCSRSource> CreateSyntheticSource(
+    const SyntheticParam& param, int partid = 0, int npart = 1);
+
+}  // namespace data
+}  // namespace xgboost
+#endif  // XGBOOST_DATA_SYNTHETIC_SOURCE_H_
@@ -113,8 +113,41 @@ class GBLinear : public GradientBooster {
                unsigned ntree_limit,
                unsigned root_index) override {
     const int ngroup = model_.param.num_output_group;
+    bst_float *preds = dmlc::BeginPtr(*out_preds);
     for (int gid = 0; gid < ngroup; ++gid) {
-      this->Pred(inst, dmlc::BeginPtr(*out_preds), gid, base_margin_);
+      preds[gid] = model_.bias()[gid] + base_margin_;
+    }
+    this->PredRowAllGroups(inst, preds);
+  }
+
+  void PredictBatchSafe(DMatrix *p_fmat,
+               PredictionContext *ctx,
+               unsigned ntree_limit) override {
+    CHECK_EQ(ntree_limit, 0U)
+        << "GBLinear::Predict ntrees is only valid for gbtree predictor";
+    CHECK(!model_.weight.empty())
+        << "thread-safe prediction needs a trained or loaded model";
+    // reads only the trained weights, writes only the context; unlike
+    // PredictBatchInternal this skips the prediction cache and the
+    // monitor, so concurrent calls with distinct contexts are safe
+    const MetaInfo &info = p_fmat->Info();
+    const std::vector<bst_float> &base_margin =
+        info.base_margin_.ConstHostVector();
+    const int ngroup = model_.param.num_output_group;
+    std::vector<bst_float> &preds = ctx->preds.HostVector();
+    preds.resize(info.num_row_ * ngroup);
+    for (const auto &batch : p_fmat->GetRowBatches()) {
+      const size_t nsize = batch.Size();
+      for (size_t i = 0; i < nsize; ++i) {
+        const size_t ridx = batch.base_rowid + i;
+        bst_float *p = &preds[ridx * ngroup];
+        for (int gid = 0; gid < ngroup; ++gid) {
+          const bst_float margin = (base_margin.size() != 0) ?
+              base_margin[ridx * ngroup + gid] : base_margin_;
+          p[gid] = model_.bias()[gid] + margin;
+        }
+        this->PredRowAllGroups(batch[i], p);
+      }
     }
   }
 
@@ -198,12 +231,15 @@ class GBLinear : public GradientBooster {
       #pragma omp parallel for schedule(static)
       for (omp_ulong i = 0; i < nsize; ++i) {
         const size_t ridx = batch.base_rowid + i;
-        // loop over output groups
+        bst_float *p = &preds[ridx * ngroup];
+        // seed every group with bias and margin, then accumulate all
+        // groups in a single pass over the sparse row
         for (int gid = 0; gid < ngroup; ++gid) {
-          bst_float margin =  (base_margin.size() != 0) ?
+          const bst_float margin = (base_margin.size() != 0) ?
               base_margin[ridx * ngroup + gid] : base_margin_;
-          this->Pred(batch[i], &preds[ridx * ngroup], gid, margin);
+          p[gid] = model_.bias()[gid] + margin;
         }
+        this->PredRowAllGroups(batch[i], p);
       }
     }
     monitor_.Stop("PredictBatchInternal");
@@ -248,14 +284,36 @@ class GBLinear : public GradientBooster {
     }
   }
 
-  inline void Pred(const SparsePage::Inst &inst, bst_float *preds, int gid,
-                   bst_float base) {
-    bst_float psum = model_.bias()[gid] + base;
-    for (const auto& ins : inst) {
-      if (ins.index >= model_.param.num_feature) continue;
-      psum += ins.fvalue * model_[ins.index][gid];
+  /*!
+   * \brief accumulate the dot products of one sparse row against all
+   *  output groups in a single pass. Weights of one feature are stored
+   *  contiguously across groups, so the inner loop is a unit-stride
+   *  multiply-accumulate of length num_output_group that vectorizes;
+   *  single-group models keep the sum in a register instead. preds must
+   *  already hold bias plus margin per group. The old per-group Pred
+   *  walked the row once per group.
+   */
+  inline void PredRowAllGroups(const SparsePage::Inst &inst, bst_float *preds) {
+    const int ngroup = model_.param.num_output_group;
+    const bst_uint nfeat = model_.param.num_feature;
+    const bst_float *w = dmlc::BeginPtr(model_.weight);
+    if (ngroup == 1) {
+      bst_float psum = preds[0];
+      for (const auto& ins : inst) {
+        if (ins.index >= nfeat) continue;
+        psum += ins.fvalue * w[ins.index];
+      }
+      preds[0] = psum;
+    } else {
+      for (const auto& ins : inst) {
+        if (ins.index >= nfeat) continue;
+        const bst_float v = ins.fvalue;
+        const bst_float *wrow = w + static_cast<size_t>(ins.index) * ngroup;
+        for (int gid = 0; gid < ngroup; ++gid) {
+          preds[gid] += v * wrow[gid];
+        }
+      }
     }
-    preds[gid] = psum;
   }
   // biase margin score
   bst_float base_margin_;
@@ -4,6 +4,7 @@
  * \brief Registry of gradient boosters.
  */
 #include <xgboost/gbm.h>
+#include <xgboost/predictor.h>
 #include <dmlc/registry.h>
 
 namespace dmlc {
@@ -11,6 +12,38 @@ DMLC_REGISTRY_ENABLE(::xgboost::GradientBoosterReg);
 }  // namespace dmlc
 
 namespace xgboost {
+void GradientBooster::PredictMarginRange(DMatrix* dmat,
+                                         HostDeviceVector<bst_float>* io_preds,
+                                         unsigned old_ntree_limit,
+                                         unsigned ntree_limit) {
+  this->PredictBatch(dmat, io_preds, ntree_limit);
+}
+
+void GradientBooster::PredictInstance(const SparsePage::Inst& inst,
+                                      PredictionContext* ctx,
+                                      unsigned ntree_limit) {
+  this->PredictInstance(inst, &ctx->preds.HostVector(), ntree_limit);
+}
+
+void GradientBooster::PredictBatchSafe(DMatrix* dmat,
+                                       PredictionContext* ctx,
+                                       unsigned ntree_limit) {
+  LOG(FATAL) << "thread-safe batch prediction is not supported by this booster";
+}
+
+void GradientBooster::SaveDelta(dmlc::Stream* fo, size_t unit_begin) const {
+  LOG(FATAL) << "delta serialization is not supported by this booster";
+}
+
+void GradientBooster::LoadDelta(dmlc::Stream* fi) {
+  LOG(FATAL) << "delta serialization is not supported by this booster";
+}
+
+void GradientBooster::Slice(size_t unit_begin, size_t unit_end,
+                            GradientBooster* out) const {
+  LOG(FATAL) << "slicing is not supported by this booster";
+}
+
 GradientBooster* GradientBooster::Create(
     const std::string& name,
     const std::vector<std::shared_ptr<DMatrix> >& cache_mats,
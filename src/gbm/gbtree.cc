@@ -12,6 +12,7 @@
 #include <xgboost/predictor.h>
 #include <xgboost/tree_updater.h>
 #include <vector>
+#include <map>
 #include <memory>
 #include <utility>
 #include <string>
@@ -20,6 +21,7 @@
 #include "../common/common.h"
 #include "../common/host_device_vector.h"
 #include "../common/random.h"
+#include "../data/synthetic_source.h"
 #include "gbtree_model.h"
 #include "../common/timer.h"
 
@@ -46,6 +48,10 @@ struct GBTreeTrainParam : public dmlc::Parameter<GBTreeTrainParam> {
   /*! \brief type of boosting process to run */
   int process_type;
   std::string predictor;
+  /*! \brief whether to route small prediction batches to the cpu predictor */
+  bool predictor_auto_dispatch;
+  /*! \brief whether to grow one vector-leaf tree per round for multi-class */
+  bool vector_leaf;
   // declare parameters
   DMLC_DECLARE_PARAMETER(GBTreeTrainParam) {
     DMLC_DECLARE_FIELD(num_parallel_tree)
@@ -67,6 +73,17 @@ struct GBTreeTrainParam : public dmlc::Parameter<GBTreeTrainParam> {
     DMLC_DECLARE_FIELD(predictor)
       .set_default("cpu_predictor")
       .describe("Predictor algorithm type");
+    DMLC_DECLARE_FIELD(predictor_auto_dispatch)
+        .set_default(true)
+        .describe("When a gpu predictor is configured, automatically route"
+                  " prediction batches below the cpu/gpu crossover size to"
+                  " the cpu predictor. The crossover is measured once per"
+                  " model by a short self-benchmark.");
+    DMLC_DECLARE_FIELD(vector_leaf)
+        .set_default(false)
+        .describe("Grow a single tree with vector leaves per boosting round"
+                  " instead of one tree per output group."
+                  " Requires grow_quantile_histmaker.");
   }
 };
 
@@ -137,7 +154,10 @@ class GBTree : public GradientBooster {
     // initialize the updaters only when needed.
     std::string updater_seq = tparam_.updater_seq;
     tparam_.InitAllowUnknown(cfg);
-    if (updater_seq != tparam_.updater_seq) updaters_.clear();
+    if (updater_seq != tparam_.updater_seq) {
+      updaters_.clear();
+      updater_names_.clear();
+    }
     for (const auto& up : updaters_) {
       up->Init(cfg);
     }
@@ -146,9 +166,29 @@ class GBTree : public GradientBooster {
       model_.InitTreesToUpdate();
     }
 
-    // configure predictor
-    predictor_ = std::unique_ptr<Predictor>(Predictor::Create(tparam_.predictor));
+    // configure predictor: recreate only when the requested type
+    // changes, so its prediction caches survive reconfiguration
+    if (predictor_ == nullptr || predictor_name_ != tparam_.predictor) {
+      predictor_ =
+          std::unique_ptr<Predictor>(Predictor::Create(tparam_.predictor));
+      predictor_name_ = tparam_.predictor;
+      dispatch_calibrated_ = false;
+    }
     predictor_->Init(cfg, cache_);
+    // a gpu predictor pays a fixed per-call launch and transfer cost, so
+    // single rows score faster on the cpu while large batches score faster
+    // on the device; keep a cpu predictor around and route each batch by
+    // its size
+    if (tparam_.predictor_auto_dispatch &&
+        tparam_.predictor == "gpu_predictor") {
+      if (dispatch_cpu_predictor_ == nullptr) {
+        dispatch_cpu_predictor_ =
+            std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+      }
+      dispatch_cpu_predictor_->Init(cfg, cache_);
+    } else {
+      dispatch_cpu_predictor_.reset();
+    }
     monitor_.Init("GBTree");
   }
 
@@ -164,6 +204,32 @@ class GBTree : public GradientBooster {
     model_.Save(fo);
   }
 
+  size_t NumBoostedUnits() const override {
+    return model_.trees.size();
+  }
+
+  void SaveDelta(dmlc::Stream* fo, size_t unit_begin) const override {
+    model_.SaveDelta(fo, unit_begin);
+  }
+
+  void LoadDelta(dmlc::Stream* fi) override {
+    model_.LoadDelta(fi);
+  }
+
+  void Slice(size_t unit_begin, size_t unit_end,
+             GradientBooster* out) const override {
+    auto* p = dynamic_cast<GBTree*>(out);
+    CHECK(p != nullptr) << "Slice: the output booster must be a tree booster";
+    if (unit_end == 0) {
+      unit_end = model_.trees.size();
+    }
+    p->model_.SliceFrom(model_, unit_begin, unit_end);
+    // mirror Load: the view is ready for configuration and prediction
+    p->cfg_.clear();
+    p->cfg_.emplace_back(std::string("num_feature"),
+                         common::ToString(p->model_.param.num_feature));
+  }
+
   bool AllowLazyCheckPoint() const override {
     return model_.param.num_output_group == 1 ||
         tparam_.updater_seq.find("distcol") != std::string::npos;
@@ -172,29 +238,67 @@ class GBTree : public GradientBooster {
   void DoBoost(DMatrix* p_fmat,
                HostDeviceVector<GradientPair>* in_gpair,
                ObjFunction* obj) override {
-    std::vector<std::vector<std::unique_ptr<RegTree> > > new_trees;
+    std::vector<std::vector<std::shared_ptr<RegTree> > > new_trees;
     const int ngroup = model_.param.num_output_group;
+    if (model_.param.size_leaf_vector > 0) {
+      CHECK(tparam_.vector_leaf)
+          << "this model was trained with vector_leaf;"
+          << " set vector_leaf=true to continue training it";
+    }
+    updater_timings_.clear();
     monitor_.Start("BoostNewTrees");
     if (ngroup == 1) {
-      std::vector<std::unique_ptr<RegTree> > ret;
+      std::vector<std::shared_ptr<RegTree> > ret;
       BoostNewTrees(in_gpair, p_fmat, 0, &ret);
       new_trees.push_back(std::move(ret));
+    } else if (tparam_.vector_leaf) {
+      // one tree per round with a weight vector per leaf; the updater
+      // reads the gradients of all groups at once
+      CHECK_EQ(tparam_.num_parallel_tree, 1)
+          << "vector_leaf does not support boosted random forest";
+      CHECK(tparam_.updater_seq.find("grow_quantile_histmaker") !=
+            std::string::npos)
+          << "vector_leaf requires tree_method=hist";
+      CHECK_EQ(in_gpair->Size() % ngroup, 0U)
+          << "must have exactly ngroup*nrow gpairs";
+      model_.param.size_leaf_vector = ngroup;
+      std::vector<std::shared_ptr<RegTree> > ret;
+      if (obj != nullptr && obj->ClassMajorGradient()) {
+        // the updater wants the group index fastest; transpose the
+        // class major blocks written by the objective
+        const size_t nrow = in_gpair->Size() / ngroup;
+        HostDeviceVector<GradientPair> tmp(in_gpair->Size());
+        const auto& h_in = in_gpair->ConstHostVector();
+        auto& h_tmp = tmp.HostVector();
+        for (int gid = 0; gid < ngroup; ++gid) {
+          for (size_t i = 0; i < nrow; ++i) {
+            h_tmp[i * ngroup + gid] = h_in[gid * nrow + i];
+          }
+        }
+        BoostNewTrees(&tmp, p_fmat, 0, &ret);
+      } else {
+        BoostNewTrees(in_gpair, p_fmat, 0, &ret);
+      }
+      new_trees.push_back(std::move(ret));
     } else {
       CHECK_EQ(in_gpair->Size() % ngroup, 0U)
           << "must have exactly ngroup*nrow gpairs";
-      // TODO(canonizer): perform this on GPU if HostDeviceVector has device set.
+      const size_t nrow = in_gpair->Size() / ngroup;
+      const bool class_major = obj != nullptr && obj->ClassMajorGradient();
       HostDeviceVector<GradientPair> tmp
-        (in_gpair->Size() / ngroup, GradientPair(),
+        (nrow, GradientPair(),
          GPUDistribution::Block(in_gpair->Distribution().Devices()));
-      const auto& gpair_h = in_gpair->ConstHostVector();
-      auto nsize = static_cast<bst_omp_uint>(tmp.Size());
       for (int gid = 0; gid < ngroup; ++gid) {
-        std::vector<GradientPair>& tmp_h = tmp.HostVector();
-        #pragma omp parallel for schedule(static)
-        for (bst_omp_uint i = 0; i < nsize; ++i) {
-          tmp_h[i] = gpair_h[i * ngroup + gid];
+        if (class_major) {
+          // the objective wrote a contiguous block per group
+          const auto& h_in = in_gpair->ConstHostVector();
+          std::copy_n(h_in.begin() + gid * nrow, nrow,
+                      tmp.HostVector().begin());
+        } else {
+          // the gather stays on the device if the gradients are resident there
+          tmp.CopyStrided(*in_gpair, ngroup, gid);
         }
-        std::vector<std::unique_ptr<RegTree> > ret;
+        std::vector<std::shared_ptr<RegTree> > ret;
         BoostNewTrees(&tmp, p_fmat, gid, &ret);
         new_trees.push_back(std::move(ret));
       }
@@ -205,10 +309,96 @@ class GBTree : public GradientBooster {
     monitor_.Stop("CommitModel");
   }
 
+  void CollectIterationTimings(
+      std::map<std::string, double>* timings) const override {
+    timings->insert(updater_timings_.begin(), updater_timings_.end());
+  }
+
   void PredictBatch(DMatrix* p_fmat,
                HostDeviceVector<bst_float>* out_preds,
                unsigned ntree_limit) override {
-    predictor_->PredictBatch(p_fmat, out_preds, model_, 0, ntree_limit);
+    this->DispatchPredictor(p_fmat)
+        ->PredictBatch(p_fmat, out_preds, model_, 0, ntree_limit);
+  }
+
+  /*!
+   * \brief pick the predictor for a batch. Matrices registered in the
+   *  active predictor's cache always stay there: CommitModel keeps their
+   *  cached predictions current with an O(new trees) delta update, which
+   *  the cold fallback would replace with a full-ensemble recompute.
+   *  Other batches below the cpu/gpu crossover go to the cpu fallback;
+   *  the crossover is measured once per booster by
+   *  CalibratePredictorDispatch.
+   */
+  Predictor* DispatchPredictor(DMatrix* p_fmat) {
+    if (dispatch_cpu_predictor_ == nullptr) {
+      return predictor_.get();
+    }
+    if (predictor_->PredictionCached(p_fmat)) {
+      return predictor_.get();
+    }
+    if (!dispatch_calibrated_) {
+      this->CalibratePredictorDispatch();
+    }
+    return p_fmat->Info().num_row_ < dispatch_crossover_rows_
+        ? dispatch_cpu_predictor_.get() : predictor_.get();
+  }
+
+  /*!
+   * \brief measure the batch size above which the configured predictor
+   *  beats the cpu fallback. Times both predictors on two synthetic
+   *  batches of different sizes, fits a fixed-overhead plus per-row cost
+   *  model to each and intersects the two lines. XGBOOST_PRED_DISPATCH_ROWS
+   *  overrides the measurement with a fixed crossover.
+   */
+  void CalibratePredictorDispatch() {
+    dispatch_calibrated_ = true;
+    const int fixed = dmlc::GetEnv("XGBOOST_PRED_DISPATCH_ROWS", -1);
+    if (fixed >= 0) {
+      dispatch_crossover_rows_ = static_cast<size_t>(fixed);
+      return;
+    }
+    monitor_.Start("CalibratePredictorDispatch");
+    const size_t sizes[2] = {64, 8192};
+    Predictor* preds[2] = {dispatch_cpu_predictor_.get(), predictor_.get()};
+    double elapsed[2][2];
+    for (int s = 0; s < 2; ++s) {
+      data::SyntheticParam sparam;
+      sparam.rows = sizes[s];
+      sparam.cols = model_.param.num_feature;
+      sparam.seed = 7;
+      std::unique_ptr<DMatrix> dmat(
+          DMatrix::Create(data::CreateSyntheticSource(sparam)));
+      HostDeviceVector<bst_float> scratch;
+      for (int p = 0; p < 2; ++p) {
+        // the first call absorbs one-time setup (thread pools, device
+        // context); time the second
+        preds[p]->PredictBatch(dmat.get(), &scratch, model_, 0, 0);
+        const double tstart = dmlc::GetTime();
+        preds[p]->PredictBatch(dmat.get(), &scratch, model_, 0, 0);
+        elapsed[p][s] = dmlc::GetTime() - tstart;
+      }
+    }
+    // per predictor: cost(n) = overhead + per_row * n
+    double per_row[2], overhead[2];
+    for (int p = 0; p < 2; ++p) {
+      per_row[p] = (elapsed[p][1] - elapsed[p][0]) /
+                   static_cast<double>(sizes[1] - sizes[0]);
+      overhead[p] = std::max(
+          elapsed[p][0] - per_row[p] * static_cast<double>(sizes[0]), 0.0);
+    }
+    if (per_row[0] <= per_row[1]) {
+      // the fallback wins per row as well; route everything to it
+      dispatch_crossover_rows_ = std::numeric_limits<size_t>::max();
+    } else {
+      const double cross =
+          (overhead[1] - overhead[0]) / (per_row[0] - per_row[1]);
+      dispatch_crossover_rows_ =
+          cross > 0.0 ? static_cast<size_t>(cross) : 0;
+    }
+    monitor_.Stop("CalibratePredictorDispatch");
+    LOG(INFO) << "predictor dispatch crossover: "
+              << dispatch_crossover_rows_ << " rows";
   }
 
   void PredictInstance(const SparsePage::Inst& inst,
@@ -219,6 +409,60 @@ class GBTree : public GradientBooster {
                                ntree_limit, root_index);
   }
 
+  bool SetCachedPredictionMargin(
+      DMatrix* dmat, const std::vector<bst_float>& margin) override {
+    CHECK_EQ(margin.size(),
+             dmat->Info().num_row_ * model_.param.num_output_group)
+        << "margin must cover every row and output group of the matrix";
+    return predictor_->SeedPredictionCache(dmat, margin);
+  }
+
+  bool GetCachedPredictionMargin(
+      DMatrix* dmat, std::vector<bst_float>* out_margin) const override {
+    return predictor_->LookupPredictionCache(dmat, out_margin);
+  }
+
+  void PredictDeviceDense(const float* d_data, size_t num_row, size_t num_col,
+                          unsigned ntree_limit, const float** out_d_preds,
+                          size_t* out_len) override {
+    CHECK_EQ(num_col, static_cast<size_t>(model_.param.num_feature))
+        << "device dense input must have one column per feature";
+    predictor_->PredictDeviceDense(d_data, num_row, num_col, model_,
+                                   ntree_limit, out_d_preds, out_len);
+  }
+
+  void PredictDense(const float* data, size_t num_row, size_t num_col,
+                    float missing, unsigned ntree_limit,
+                    std::vector<bst_float>* out_preds) override {
+    predictor_->PredictDense(data, num_row, num_col, missing, model_,
+                             ntree_limit, out_preds);
+  }
+
+  void PredictMarginRange(DMatrix* dmat,
+                          HostDeviceVector<bst_float>* io_preds,
+                          unsigned old_ntree_limit,
+                          unsigned ntree_limit) override {
+    const auto ngroup = static_cast<unsigned>(model_.param.num_output_group);
+    CHECK_LE(old_ntree_limit * ngroup, model_.trees.size());
+    CHECK_EQ(io_preds->Size(), dmat->Info().num_row_ * ngroup)
+        << "io_preds must hold the margins at old_ntree_limit";
+    predictor_->PredictBatch(dmat, io_preds, model_,
+                             static_cast<int>(old_ntree_limit * ngroup),
+                             ntree_limit);
+  }
+
+  void PredictInstance(const SparsePage::Inst& inst,
+               PredictionContext* ctx,
+               unsigned ntree_limit) override {
+    predictor_->PredictInstance(inst, ctx, model_, ntree_limit);
+  }
+
+  void PredictBatchSafe(DMatrix* dmat,
+               PredictionContext* ctx,
+               unsigned ntree_limit) override {
+    predictor_->PredictBatchSafe(dmat, ctx, model_, ntree_limit);
+  }
+
   void PredictLeaf(DMatrix* p_fmat,
                    std::vector<bst_float>* out_preds,
                    unsigned ntree_limit) override {
@@ -245,6 +489,95 @@ class GBTree : public GradientBooster {
     return model_.DumpModel(fmap, with_stats, format);
   }
 
+  void FeatureImportance(const std::string& importance_type,
+                         std::vector<bst_uint>* out_features,
+                         std::vector<bst_float>* out_scores) const override {
+    const int kind = importance_type == "weight" ? 0
+                   : importance_type == "gain" ? 1
+                   : importance_type == "cover" ? 2 : -1;
+    CHECK_NE(kind, -1)
+        << "unknown importance type " << importance_type
+        << ", expect one of weight, gain or cover";
+    const size_t nfeature = model_.param.num_feature;
+    const int nthread = omp_get_max_threads();
+    // trees are scanned in parallel into per-thread accumulators,
+    // which are reduced over features afterwards
+    std::vector<size_t> counts(nthread * nfeature, 0);
+    std::vector<double> totals;
+    if (kind != 0) {
+      totals.resize(nthread * nfeature, 0.0);
+    }
+    const omp_ulong ntree = static_cast<omp_ulong>(model_.trees.size());
+    #pragma omp parallel for schedule(static)
+    for (omp_ulong i = 0; i < ntree; ++i) {
+      const size_t off = static_cast<size_t>(omp_get_thread_num()) * nfeature;
+      const RegTree& tree = *model_.trees[i];
+      for (int nid = 0; nid < tree.param.num_nodes; ++nid) {
+        const RegTree::Node& node = tree[nid];
+        if (node.IsDeleted() || node.IsLeaf()) continue;
+        const unsigned split_index = node.SplitIndex();
+        ++counts[off + split_index];
+        if (kind == 1) {
+          totals[off + split_index] += tree.Stat(nid).loss_chg;
+        } else if (kind == 2) {
+          totals[off + split_index] += tree.Stat(nid).sum_hess;
+        }
+      }
+    }
+    out_features->clear();
+    out_scores->clear();
+    for (size_t fid = 0; fid < nfeature; ++fid) {
+      size_t count = 0;
+      double total = 0.0;
+      for (int tid = 0; tid < nthread; ++tid) {
+        count += counts[tid * nfeature + fid];
+        if (kind != 0) {
+          total += totals[tid * nfeature + fid];
+        }
+      }
+      if (count == 0) continue;
+      out_features->push_back(static_cast<bst_uint>(fid));
+      // gain and cover are averaged per split, matching the scores the
+      // bindings used to derive from the text dump
+      out_scores->push_back(kind == 0 ? static_cast<bst_float>(count)
+                                      : static_cast<bst_float>(total / count));
+    }
+  }
+
+  void OptimizeNodeLayout(DMatrix* p_fmat) override {
+    // record the root-to-leaf path of every sample row before any tree is
+    // rewritten; the leaf indices refer to the current layout
+    std::vector<bst_float> leaf_preds;
+    predictor_->PredictLeaf(p_fmat, &leaf_preds, model_, 0);
+    const omp_ulong ntree = static_cast<omp_ulong>(model_.trees.size());
+    if (ntree == 0) return;
+    const size_t nrow = leaf_preds.size() / ntree;
+    // the rewrite happens in place; copy any tree shared with a sliced or
+    // cloned model first so the other owner keeps its layout
+    for (auto& tree : model_.trees) {
+      if (tree.use_count() != 1) {
+        tree = std::make_shared<RegTree>(*tree);
+      }
+    }
+    #pragma omp parallel for schedule(dynamic)
+    for (omp_ulong i = 0; i < ntree; ++i) {
+      RegTree& tree = *model_.trees[i];
+      std::vector<size_t> counts(tree.param.num_nodes, 0);
+      for (size_t ridx = 0; ridx < nrow; ++ridx) {
+        int nid = static_cast<int>(leaf_preds[ridx * ntree + i]);
+        while (true) {
+          ++counts[nid];
+          if (tree[nid].IsRoot()) break;
+          nid = tree[nid].Parent();
+        }
+      }
+      tree.ReorderNodes(counts);
+    }
+    // the rewrite changed node contents without changing any shape;
+    // invalidate device replicas of the model
+    ++model_.generation;
+  }
+
  protected:
   // initialize updater before using them
   inline void InitUpdater() {
@@ -255,6 +588,7 @@ class GBTree : public GradientBooster {
       std::unique_ptr<TreeUpdater> up(TreeUpdater::Create(pstr.c_str()));
       up->Init(this->cfg_);
       updaters_.push_back(std::move(up));
+      updater_names_.push_back(pstr);
     }
   }
 
@@ -262,7 +596,7 @@ class GBTree : public GradientBooster {
   inline void BoostNewTrees(HostDeviceVector<GradientPair>* gpair,
                             DMatrix *p_fmat,
                             int bst_group,
-                            std::vector<std::unique_ptr<RegTree> >* ret) {
+                            std::vector<std::shared_ptr<RegTree> >* ret) {
     this->InitUpdater();
     std::vector<RegTree*> new_trees;
     ret->clear();
@@ -272,6 +606,7 @@ class GBTree : public GradientBooster {
         // create new tree
         std::unique_ptr<RegTree> ptr(new RegTree());
         ptr->param.InitAllowUnknown(this->cfg_);
+        ptr->param.size_leaf_vector = model_.param.size_leaf_vector;
         new_trees.push_back(ptr.get());
         ret->push_back(std::move(ptr));
       } else if (tparam_.process_type == kUpdate) {
@@ -284,18 +619,22 @@ class GBTree : public GradientBooster {
       }
     }
     // update the trees
-    for (auto& up : updaters_) {
-      up->Update(gpair, p_fmat, new_trees);
-}
+    for (size_t i = 0; i < updaters_.size(); ++i) {
+      const double tstart = dmlc::GetTime();
+      updaters_[i]->Update(gpair, p_fmat, new_trees);
+      updater_timings_["updater." + updater_names_[i]] +=
+          dmlc::GetTime() - tstart;
+    }
   }
 
   // commit new trees all at once
   virtual void
-  CommitModel(std::vector<std::vector<std::unique_ptr<RegTree>>>&& new_trees) {
+  CommitModel(std::vector<std::vector<std::shared_ptr<RegTree>>>&& new_trees) {
+    // one entry per output group, or a single entry of vector-leaf trees
     int num_new_trees = 0;
-    for (int gid = 0; gid < model_.param.num_output_group; ++gid) {
+    for (size_t gid = 0; gid < new_trees.size(); ++gid) {
       num_new_trees += new_trees[gid].size();
-      model_.CommitModel(std::move(new_trees[gid]), gid);
+      model_.CommitModel(std::move(new_trees[gid]), static_cast<int>(gid));
     }
     predictor_->UpdatePredictionCache(model_, &updaters_, num_new_trees);
   }
@@ -309,9 +648,21 @@ class GBTree : public GradientBooster {
   std::vector<std::pair<std::string, std::string> > cfg_;
   // the updaters that can be applied to each of tree
   std::vector<std::unique_ptr<TreeUpdater>> updaters_;
+  // registry names of the updaters, index-aligned with updaters_
+  std::vector<std::string> updater_names_;
+  // per-updater wall time of the last DoBoost, in seconds
+  std::map<std::string, double> updater_timings_;
   // Cached matrices
   std::vector<std::shared_ptr<DMatrix>> cache_;
   std::unique_ptr<Predictor> predictor_;
+  // type the current predictor was created as
+  std::string predictor_name_;
+  // cpu fallback serving small batches when a gpu predictor is configured;
+  // null when auto dispatch is disabled
+  std::unique_ptr<Predictor> dispatch_cpu_predictor_;
+  // batches below this many rows go to the cpu fallback
+  size_t dispatch_crossover_rows_{0};
+  bool dispatch_calibrated_{false};
   common::Monitor monitor_;
 };
 
@@ -320,6 +671,31 @@ class Dart : public GBTree {
  public:
   explicit Dart(bst_float base_margin) : GBTree(base_margin) {}
 
+  // dart rescales every tree by its drop weight and never reads the
+  // predictor cache, so seeded margins would silently go stale
+  bool SetCachedPredictionMargin(
+      DMatrix* dmat, const std::vector<bst_float>& margin) override {
+    return false;
+  }
+  bool GetCachedPredictionMargin(
+      DMatrix* dmat, std::vector<bst_float>* out_margin) const override {
+    return false;
+  }
+
+  // the predictor knows nothing about drop weights, so the inherited
+  // device path would score unweighted trees
+  void PredictDeviceDense(const float* d_data, size_t num_row, size_t num_col,
+                          unsigned ntree_limit, const float** out_d_preds,
+                          size_t* out_len) override {
+    LOG(FATAL) << "predict from device memory is not supported by dart";
+  }
+
+  void PredictDense(const float* data, size_t num_row, size_t num_col,
+                    float missing, unsigned ntree_limit,
+                    std::vector<bst_float>* out_preds) override {
+    LOG(FATAL) << "in-place dense prediction is not supported by dart";
+  }
+
   void Configure(const std::vector<std::pair<std::string, std::string> >& cfg) override {
     GBTree::Configure(cfg);
     if (model_.trees.size() == 0) {
@@ -342,11 +718,33 @@ class Dart : public GBTree {
     }
   }
 
+  // dart carries the per-tree weights behind the tree sections, which the
+  // delta format does not cover; report no units so checkpoints stay full
+  size_t NumBoostedUnits() const override {
+    return 0;
+  }
+
+  void Slice(size_t unit_begin, size_t unit_end,
+             GradientBooster* out) const override {
+    GBTree::Slice(unit_begin, unit_end, out);
+    auto* p = dynamic_cast<Dart*>(out);
+    CHECK(p != nullptr) << "Slice: a dart model can only be sliced into dart";
+    if (unit_end == 0) {
+      unit_end = weight_drop_.size();
+    }
+    p->weight_drop_.assign(weight_drop_.begin() + unit_begin,
+                           weight_drop_.begin() + unit_end);
+  }
+
   // predict the leaf scores with dropout if ntree_limit = 0
   void PredictBatch(DMatrix* p_fmat,
                     HostDeviceVector<bst_float>* out_preds,
                     unsigned ntree_limit) override {
     DropTrees(ntree_limit);
+    if (ntree_limit == 0 &&
+        this->PredictBatchMemoized(p_fmat, &out_preds->HostVector())) {
+      return;
+    }
     PredLoopInternal<Dart>(p_fmat, &out_preds->HostVector(), 0, ntree_limit, true);
   }
 
@@ -372,6 +770,70 @@ class Dart : public GBTree {
     }
   }
 
+  void PredictInstance(const SparsePage::Inst& inst,
+               PredictionContext* ctx,
+               unsigned ntree_limit) override {
+    // dropout weighting needs the dart specific traversal; route the
+    // context variant through the vector overload above
+    GradientBooster::PredictInstance(inst, ctx, ntree_limit);
+  }
+
+  void PredictBatchSafe(DMatrix* dmat,
+               PredictionContext* ctx,
+               unsigned ntree_limit) override {
+    // inference semantics: no dropout is sampled, every tree contributes
+    // its normalized weight. The walk touches only the immutable model and
+    // the context, matching the contract of Predictor::PredictBatchSafe.
+    const MetaInfo& info = dmat->Info();
+    if (ctx->feats.Size() !=
+        static_cast<size_t>(model_.param.num_feature)) {
+      ctx->feats.Init(model_.param.num_feature);
+    }
+    const int ngroup = model_.param.num_output_group;
+    ntree_limit *= ngroup;
+    if (ntree_limit == 0 || ntree_limit > model_.trees.size()) {
+      ntree_limit = static_cast<unsigned>(model_.trees.size());
+    }
+    const size_t n = info.num_row_ * ngroup;
+    const std::vector<bst_float>& base_margin =
+        info.base_margin_.ConstHostVector();
+    std::vector<bst_float>& preds = ctx->preds.HostVector();
+    preds.resize(n);
+    for (const auto& batch : dmat->GetRowBatches()) {
+      const size_t nsize = batch.Size();
+      for (size_t i = 0; i < nsize; ++i) {
+        const size_t ridx = batch.base_rowid + i;
+        const unsigned root_id = info.GetRoot(ridx);
+        const SparsePage::Inst inst = batch[i];
+        ctx->feats.Fill(inst);
+        for (int gid = 0; gid < ngroup; ++gid) {
+          bst_float margin = (base_margin.size() == n)
+                                 ? base_margin[ridx * ngroup + gid]
+                                 : model_.base_margin;
+          for (unsigned t = 0; t < ntree_limit; ++t) {
+            if (model_.tree_info[t] == gid) {
+              const RegTree& tree = *model_.trees[t];
+              const int nid = tree.GetLeafIndex(ctx->feats, root_id);
+              margin += weight_drop_[t] * tree[nid].LeafValue();
+            }
+          }
+          preds[ridx * ngroup + gid] = margin;
+        }
+        ctx->feats.Drop(inst);
+      }
+    }
+  }
+
+  void PredictMarginRange(DMatrix* dmat,
+                          HostDeviceVector<bst_float>* io_preds,
+                          unsigned old_ntree_limit,
+                          unsigned ntree_limit) override {
+    // per-tree dropout weights make partial margins non-additive; keep
+    // the recompute-from-scratch default
+    GradientBooster::PredictMarginRange(dmat, io_preds, old_ntree_limit,
+                                        ntree_limit);
+  }
+
  protected:
   friend class GBTree;
   // internal prediction loop
@@ -469,17 +931,105 @@ class Dart : public GBTree {
 
   // commit new trees all at once
   void
-  CommitModel(std::vector<std::vector<std::unique_ptr<RegTree>>>&& new_trees) override {
+  CommitModel(std::vector<std::vector<std::shared_ptr<RegTree>>>&& new_trees) override {
+    CHECK_EQ(model_.param.size_leaf_vector, 0)
+        << "vector_leaf is not supported by dart";
     int num_new_trees = 0;
-    for (int gid = 0; gid < model_.param.num_output_group; ++gid) {
+    for (size_t gid = 0; gid < new_trees.size(); ++gid) {
       num_new_trees += new_trees[gid].size();
-      model_.CommitModel(std::move(new_trees[gid]), gid);
+      model_.CommitModel(std::move(new_trees[gid]), static_cast<int>(gid));
     }
     size_t num_drop = NormalizeTrees(num_new_trees);
     LOG(INFO) << "drop " << num_drop << " trees, "
               << "weight = " << weight_drop_.back();
   }
 
+  /*!
+   * \brief full-ensemble prediction from memoized per-tree outputs.
+   *  Dropout rescales committed tree weights every round, so a plain
+   *  prediction cache is useless for dart; instead the unweighted leaf
+   *  values of each tree are cached per row for the booster's cached
+   *  matrices (training and evaluation data). A dropout round then only
+   *  traverses the newly committed trees once and recombines the cached
+   *  columns with the current weights — an axpy per tree instead of a
+   *  full traversal of the ensemble.
+   * \return whether the memoized path served the prediction; test
+   *  matrices outside the booster cache and over-budget caches fall
+   *  back to the traversal loop.
+   */
+  inline bool PredictBatchMemoized(DMatrix* p_fmat,
+                                   std::vector<bst_float>* out_preds) {
+    bool is_cached_fmat = false;
+    for (const auto& c : cache_) {
+      if (c.get() == p_fmat) { is_cached_fmat = true; break; }
+    }
+    if (!is_cached_fmat) { return false; }
+
+    const int ngroup = model_.param.num_output_group;
+    const size_t nrow = p_fmat->Info().num_row_;
+    const size_t ntree = model_.trees.size();
+    static const size_t budget_bytes = static_cast<size_t>(
+        dmlc::GetEnv("XGBOOST_DART_CACHE_MB", 2048)) << 20;
+    if (ntree * nrow * sizeof(bst_float) > budget_bytes) { return false; }
+
+    const MetaInfo& info = p_fmat->Info();
+    std::vector<std::vector<bst_float>>& tree_values =
+        tree_value_cache_[p_fmat];
+    // memoize trees committed since the last round; trees are immutable
+    // once committed, so the cache is append-only
+    const size_t first_new = tree_values.size();
+    if (first_new < ntree) {
+      tree_values.resize(ntree);
+      for (size_t t = first_new; t < ntree; ++t) {
+        tree_values[t].resize(nrow);
+      }
+      const int nthread = omp_get_max_threads();
+      InitThreadTemp(nthread);
+      for (const auto& batch : p_fmat->GetRowBatches()) {
+        const auto nsize = static_cast<bst_omp_uint>(batch.Size());
+        #pragma omp parallel for schedule(static)
+        for (bst_omp_uint i = 0; i < nsize; ++i) {
+          const int tid = omp_get_thread_num();
+          RegTree::FVec& feats = thread_temp_[tid];
+          const size_t ridx = batch.base_rowid + i;
+          const SparsePage::Inst inst = batch[i];
+          feats.Fill(inst);
+          for (size_t t = first_new; t < ntree; ++t) {
+            const int nid =
+                model_.trees[t]->GetLeafIndex(feats, info.GetRoot(ridx));
+            tree_values[t][ridx] = (*model_.trees[t])[nid].LeafValue();
+          }
+          feats.Drop(inst);
+        }
+      }
+    }
+
+    // seed with the base margin, then recombine the cached columns
+    std::vector<bst_float>& preds = *out_preds;
+    const auto& base_margin = info.base_margin_.ConstHostVector();
+    preds.resize(nrow * ngroup);
+    if (base_margin.size() != 0) {
+      CHECK_EQ(preds.size(), base_margin.size());
+      std::copy(base_margin.begin(), base_margin.end(), preds.begin());
+    } else {
+      std::fill(preds.begin(), preds.end(), model_.base_margin);
+    }
+    for (size_t t = 0; t < ntree; ++t) {
+      if (std::binary_search(idx_drop_.begin(), idx_drop_.end(), t)) {
+        continue;
+      }
+      const bst_float w = weight_drop_[t];
+      const int gid = model_.tree_info[t];
+      const bst_float* vals = tree_values[t].data();
+      const auto nsize = static_cast<bst_omp_uint>(nrow);
+      #pragma omp parallel for schedule(static)
+      for (bst_omp_uint r = 0; r < nsize; ++r) {
+        preds[r * ngroup + gid] += w * vals[r];
+      }
+    }
+    return true;
+  }
+
   // predict the leaf scores without dropped trees
   inline bst_float PredValue(const SparsePage::Inst &inst,
                              int bst_group,
@@ -598,6 +1148,8 @@ class Dart : public GBTree {
   DartTrainParam dparam_;
   /*! \brief prediction buffer */
   std::vector<bst_float> weight_drop_;
+  /*! \brief per-tree unweighted leaf values for cached matrices */
+  std::map<DMatrix*, std::vector<std::vector<bst_float>>> tree_value_cache_;
   // indexes of dropped trees
   std::vector<size_t> idx_drop_;
   // temporal storage for per thread
@@ -5,6 +5,8 @@
 #include <dmlc/parameter.h>
 #include <dmlc/io.h>
 #include <xgboost/tree_model.h>
+#include <cstring>
+#include <memory>
 #include <utility>
 #include <string>
 #include <vector>
@@ -71,23 +73,92 @@ struct GBTreeModel {
   void InitTreesToUpdate() {
     if (trees_to_update.size() == 0u) {
       for (auto & tree : trees) {
+        // a tree may be shared with a sliced or cloned model; the update
+        // process mutates it in place, so give this model its own copy
+        // first (copy-on-write)
+        if (tree.use_count() != 1) {
+          tree = std::make_shared<RegTree>(*tree);
+        }
         trees_to_update.push_back(std::move(tree));
       }
       trees.clear();
       param.num_trees = 0;
       tree_info.clear();
+      ++generation;
     }
   }
 
+  /*!
+   * \brief marker stored in param.reserved[0] for the bulk tree layout:
+   *  all tree parameters, then all node arrays, then all statistics
+   *  arrays as three contiguous sections. Loading an ensemble then
+   *  costs three bulk reads instead of three stream reads per tree.
+   *  Files written before the marker existed carry 0 there and go
+   *  through the per-tree loader.
+   */
+  static const int kBulkTreeLayout = 1;
+
   void Load(dmlc::Stream* fi) {
     CHECK_EQ(fi->Read(&param, sizeof(param)), sizeof(param))
         << "GBTree: invalid model file";
     trees.clear();
     trees_to_update.clear();
-    for (int i = 0; i < param.num_trees; ++i) {
-      std::unique_ptr<RegTree> ptr(new RegTree());
-      ptr->Load(fi);
-      trees.push_back(std::move(ptr));
+    if (param.reserved[0] == kBulkTreeLayout) {
+      param.reserved[0] = 0;
+      const int ntree = param.num_trees;
+      std::vector<TreeParam> tree_params(ntree);
+      size_t total_nodes = 0;
+      if (ntree != 0) {
+        CHECK_EQ(fi->Read(dmlc::BeginPtr(tree_params),
+                          sizeof(TreeParam) * ntree),
+                 sizeof(TreeParam) * ntree)
+            << "GBTree: invalid model file";
+        for (const TreeParam& tp : tree_params) {
+          total_nodes += tp.num_nodes;
+        }
+      }
+      std::vector<RegTree::Node> nodes(total_nodes);
+      std::vector<RTreeNodeStat> stats(total_nodes);
+      if (total_nodes != 0) {
+        CHECK_EQ(fi->Read(dmlc::BeginPtr(nodes),
+                          sizeof(RegTree::Node) * total_nodes),
+                 sizeof(RegTree::Node) * total_nodes)
+            << "GBTree: invalid model file";
+        CHECK_EQ(fi->Read(dmlc::BeginPtr(stats),
+                          sizeof(RTreeNodeStat) * total_nodes),
+                 sizeof(RTreeNodeStat) * total_nodes)
+            << "GBTree: invalid model file";
+      }
+      size_t total_leaf = 0;
+      for (const TreeParam& tp : tree_params) {
+        total_leaf += static_cast<size_t>(tp.num_nodes) * tp.size_leaf_vector;
+      }
+      std::vector<bst_float> leaf_vectors(total_leaf);
+      if (total_leaf != 0) {
+        CHECK_EQ(fi->Read(dmlc::BeginPtr(leaf_vectors),
+                          sizeof(bst_float) * total_leaf),
+                 sizeof(bst_float) * total_leaf)
+            << "GBTree: invalid model file";
+      }
+      size_t offset = 0, leaf_offset = 0;
+      for (int i = 0; i < ntree; ++i) {
+        std::unique_ptr<RegTree> ptr(new RegTree());
+        ptr->Load(tree_params[i], dmlc::BeginPtr(nodes) + offset,
+                  dmlc::BeginPtr(stats) + offset);
+        offset += tree_params[i].num_nodes;
+        if (tree_params[i].size_leaf_vector != 0) {
+          ptr->LoadLeafVectors(dmlc::BeginPtr(leaf_vectors) + leaf_offset);
+          leaf_offset += static_cast<size_t>(tree_params[i].num_nodes) *
+                         tree_params[i].size_leaf_vector;
+        }
+        trees.push_back(std::move(ptr));
+      }
+    } else {
+      for (int i = 0; i < param.num_trees; ++i) {
+        std::unique_ptr<RegTree> ptr(new RegTree());
+        ptr->Load(fi);
+        trees.push_back(std::move(ptr));
+      }
     }
     tree_info.resize(param.num_trees);
     if (param.num_trees != 0) {
@@ -95,24 +166,179 @@ struct GBTreeModel {
           fi->Read(dmlc::BeginPtr(tree_info), sizeof(int) * param.num_trees),
           sizeof(int) * param.num_trees);
     }
+    ++generation;
   }
 
   void Save(dmlc::Stream* fo) const {
     CHECK_EQ(param.num_trees, static_cast<int>(trees.size()));
-    fo->Write(&param, sizeof(param));
-    for (const auto & tree : trees) {
-      tree->Save(fo);
+    GBTreeModelParam p = param;
+    p.reserved[0] = kBulkTreeLayout;
+    fo->Write(&p, sizeof(p));
+    // gather each of the three bulk sections into one contiguous buffer
+    // -- the offsets follow from the node counts -- copying the trees in
+    // parallel, then write every section with a single call; large
+    // ensembles become a handful of sequential writes instead of three
+    // small ones per tree
+    const auto ntree = static_cast<omp_ulong>(trees.size());
+    std::vector<TreeParam> tree_params(ntree);
+    std::vector<size_t> node_offset(ntree + 1, 0);
+    std::vector<size_t> leaf_offset(ntree + 1, 0);
+    for (omp_ulong i = 0; i < ntree; ++i) {
+      CHECK_NE(trees[i]->param.num_nodes, 0);
+      if (trees[i]->param.size_leaf_vector != 0) {
+        CHECK_EQ(trees[i]->GetLeafVectors().size(),
+                 static_cast<size_t>(trees[i]->param.num_nodes) *
+                     trees[i]->param.size_leaf_vector);
+      }
+      tree_params[i] = trees[i]->param;
+      node_offset[i + 1] =
+          node_offset[i] + trees[i]->param.num_nodes;
+      leaf_offset[i + 1] =
+          leaf_offset[i] + static_cast<size_t>(trees[i]->param.num_nodes) *
+                               trees[i]->param.size_leaf_vector;
+    }
+    std::vector<RegTree::Node> nodes(node_offset[ntree]);
+    std::vector<RTreeNodeStat> stats(node_offset[ntree]);
+    std::vector<bst_float> leaf_vectors(leaf_offset[ntree]);
+    #pragma omp parallel for schedule(static)
+    for (omp_ulong i = 0; i < ntree; ++i) {
+      const auto nnode = static_cast<size_t>(tree_params[i].num_nodes);
+      std::memcpy(dmlc::BeginPtr(nodes) + node_offset[i],
+                  dmlc::BeginPtr(trees[i]->GetNodes()),
+                  sizeof(RegTree::Node) * nnode);
+      std::memcpy(dmlc::BeginPtr(stats) + node_offset[i], &trees[i]->Stat(0),
+                  sizeof(RTreeNodeStat) * nnode);
+      if (tree_params[i].size_leaf_vector != 0) {
+        std::memcpy(dmlc::BeginPtr(leaf_vectors) + leaf_offset[i],
+                    dmlc::BeginPtr(trees[i]->GetLeafVectors()),
+                    sizeof(bst_float) * nnode * tree_params[i].size_leaf_vector);
+      }
+    }
+    if (ntree != 0) {
+      // section 1: tree parameters
+      fo->Write(dmlc::BeginPtr(tree_params), sizeof(TreeParam) * ntree);
+      // section 2: node arrays, back to back
+      fo->Write(dmlc::BeginPtr(nodes), sizeof(RegTree::Node) * nodes.size());
+      // section 3: node statistics, back to back
+      fo->Write(dmlc::BeginPtr(stats), sizeof(RTreeNodeStat) * stats.size());
+      // section 4: leaf value vectors of vector trees; absent for scalar
+      // trees, so files without vector trees keep their old byte layout
+      if (leaf_vectors.size() != 0) {
+        fo->Write(dmlc::BeginPtr(leaf_vectors),
+                  sizeof(bst_float) * leaf_vectors.size());
+      }
     }
     if (tree_info.size() != 0) {
       fo->Write(dmlc::BeginPtr(tree_info), sizeof(int) * tree_info.size());
     }
   }
 
+  /*!
+   * \brief save only the trees committed at or after index tree_begin,
+   *  the tail section of an incremental checkpoint. The trees use the
+   *  same three-section bulk layout as Save; the receiver appends them
+   *  to an earlier full save with LoadDelta.
+   */
+  void SaveDelta(dmlc::Stream* fo, size_t tree_begin) const {
+    CHECK_EQ(param.num_trees, static_cast<int>(trees.size()));
+    CHECK_LE(tree_begin, trees.size());
+    const auto ntail = static_cast<uint64_t>(trees.size() - tree_begin);
+    fo->Write(&ntail, sizeof(ntail));
+    for (size_t i = tree_begin; i < trees.size(); ++i) {
+      fo->Write(&trees[i]->param, sizeof(TreeParam));
+    }
+    for (size_t i = tree_begin; i < trees.size(); ++i) {
+      CHECK_NE(trees[i]->param.num_nodes, 0);
+      fo->Write(dmlc::BeginPtr(trees[i]->GetNodes()),
+                sizeof(RegTree::Node) * trees[i]->param.num_nodes);
+    }
+    for (size_t i = tree_begin; i < trees.size(); ++i) {
+      fo->Write(&trees[i]->Stat(0),
+                sizeof(RTreeNodeStat) * trees[i]->param.num_nodes);
+    }
+    for (size_t i = tree_begin; i < trees.size(); ++i) {
+      if (trees[i]->param.size_leaf_vector != 0) {
+        fo->Write(dmlc::BeginPtr(trees[i]->GetLeafVectors()),
+                  sizeof(bst_float) * trees[i]->GetLeafVectors().size());
+      }
+    }
+    if (ntail != 0) {
+      fo->Write(dmlc::BeginPtr(tree_info) + tree_begin, sizeof(int) * ntail);
+    }
+  }
+
+  /*! \brief append the trees written by SaveDelta */
+  void LoadDelta(dmlc::Stream* fi) {
+    uint64_t ntail;
+    CHECK_EQ(fi->Read(&ntail, sizeof(ntail)), sizeof(ntail))
+        << "GBTree: invalid model delta";
+    std::vector<TreeParam> tree_params(ntail);
+    size_t total_nodes = 0;
+    if (ntail != 0) {
+      CHECK_EQ(fi->Read(dmlc::BeginPtr(tree_params),
+                        sizeof(TreeParam) * ntail),
+               sizeof(TreeParam) * ntail)
+          << "GBTree: invalid model delta";
+      for (const TreeParam& tp : tree_params) {
+        total_nodes += tp.num_nodes;
+      }
+    }
+    std::vector<RegTree::Node> nodes(total_nodes);
+    std::vector<RTreeNodeStat> stats(total_nodes);
+    if (total_nodes != 0) {
+      CHECK_EQ(fi->Read(dmlc::BeginPtr(nodes),
+                        sizeof(RegTree::Node) * total_nodes),
+               sizeof(RegTree::Node) * total_nodes)
+          << "GBTree: invalid model delta";
+      CHECK_EQ(fi->Read(dmlc::BeginPtr(stats),
+                        sizeof(RTreeNodeStat) * total_nodes),
+               sizeof(RTreeNodeStat) * total_nodes)
+          << "GBTree: invalid model delta";
+    }
+    size_t total_leaf = 0;
+    for (const TreeParam& tp : tree_params) {
+      total_leaf += static_cast<size_t>(tp.num_nodes) * tp.size_leaf_vector;
+    }
+    std::vector<bst_float> leaf_vectors(total_leaf);
+    if (total_leaf != 0) {
+      CHECK_EQ(fi->Read(dmlc::BeginPtr(leaf_vectors),
+                        sizeof(bst_float) * total_leaf),
+               sizeof(bst_float) * total_leaf)
+          << "GBTree: invalid model delta";
+    }
+    size_t offset = 0, leaf_offset = 0;
+    for (uint64_t i = 0; i < ntail; ++i) {
+      std::unique_ptr<RegTree> ptr(new RegTree());
+      ptr->Load(tree_params[i], dmlc::BeginPtr(nodes) + offset,
+                dmlc::BeginPtr(stats) + offset);
+      offset += tree_params[i].num_nodes;
+      if (tree_params[i].size_leaf_vector != 0) {
+        ptr->LoadLeafVectors(dmlc::BeginPtr(leaf_vectors) + leaf_offset);
+        leaf_offset += static_cast<size_t>(tree_params[i].num_nodes) *
+                       tree_params[i].size_leaf_vector;
+      }
+      trees.push_back(std::move(ptr));
+    }
+    const size_t old_size = tree_info.size();
+    tree_info.resize(old_size + ntail);
+    if (ntail != 0) {
+      CHECK_EQ(fi->Read(dmlc::BeginPtr(tree_info) + old_size,
+                        sizeof(int) * ntail),
+               sizeof(int) * ntail)
+          << "GBTree: invalid model delta";
+    }
+    param.num_trees += static_cast<int>(ntail);
+    ++generation;
+  }
+
   std::vector<std::string> DumpModel(const FeatureMap& fmap, bool with_stats,
                                      std::string format) const {
-    std::vector<std::string> dump;
-    for (const auto & tree : trees) {
-      dump.push_back(tree->DumpModel(fmap, with_stats, format));
+    // per-tree dumps are independent of each other; dump them in parallel
+    std::vector<std::string> dump(trees.size());
+    const omp_ulong ntree = static_cast<omp_ulong>(trees.size());
+    #pragma omp parallel for schedule(dynamic)
+    for (omp_ulong i = 0; i < ntree; ++i) {
+      dump[i] = trees[i]->DumpModel(fmap, with_stats, format);
     }
     return dump;
   }
@@ -123,18 +349,56 @@ struct GBTreeModel {
       tree_info.push_back(bst_group);
     }
     param.num_trees += static_cast<int>(new_trees.size());
+    ++generation;
+  }
+  void CommitModel(std::vector<std::shared_ptr<RegTree> >&& new_trees,
+                   int bst_group) {
+    for (auto & new_tree : new_trees) {
+      trees.push_back(std::move(new_tree));
+      tree_info.push_back(bst_group);
+    }
+    param.num_trees += static_cast<int>(new_trees.size());
+    ++generation;
+  }
+
+  /*!
+   * \brief make this model a view over the trees [tree_begin, tree_end)
+   *  of src. The tree storage is shared, not copied, so building a view
+   *  costs one pointer per tree regardless of the tree sizes; further
+   *  training appends to the view without touching src, and the update
+   *  process copies a shared tree before mutating it (InitTreesToUpdate).
+   */
+  void SliceFrom(const GBTreeModel& src, size_t tree_begin, size_t tree_end) {
+    CHECK_LE(tree_begin, tree_end);
+    CHECK_LE(tree_end, src.trees.size());
+    CHECK_EQ(src.param.num_trees, static_cast<int>(src.trees.size()));
+    param = src.param;
+    base_margin = src.base_margin;
+    trees.assign(src.trees.begin() + tree_begin,
+                 src.trees.begin() + tree_end);
+    tree_info.assign(src.tree_info.begin() + tree_begin,
+                     src.tree_info.begin() + tree_end);
+    trees_to_update.clear();
+    param.num_trees = static_cast<int>(trees.size());
+    ++generation;
   }
 
   // base margin
   bst_float base_margin;
   // model parameter
   GBTreeModelParam param;
-  /*! \brief vector of trees stored in the model */
-  std::vector<std::unique_ptr<RegTree> > trees;
+  /*! \brief vector of trees stored in the model; the storage may be
+   *  shared with models produced by SliceFrom */
+  std::vector<std::shared_ptr<RegTree> > trees;
   /*! \brief for the update process, a place to keep the initial trees */
-  std::vector<std::unique_ptr<RegTree> > trees_to_update;
+  std::vector<std::shared_ptr<RegTree> > trees_to_update;
   /*! \brief some information indicator of the tree, reserved */
   std::vector<int> tree_info;
+  /*! \brief bumped whenever the tree contents change -- commits, loads
+   *  and in-place rewrites -- so cached device replicas of the model can
+   *  key their freshness on it instead of inferring it from the shape;
+   *  never serialized */
+  size_t generation{0};
 };
 }  // namespace gbm
 }  // namespace xgboost
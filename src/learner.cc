@@ -8,15 +8,19 @@
 #include <dmlc/timer.h>
 #include <xgboost/learner.h>
 #include <xgboost/logging.h>
+#include <xgboost/predictor.h>
 #include <algorithm>
 #include <iomanip>
 #include <limits>
 #include <sstream>
 #include <string>
 #include <ios>
+#include <numeric>
+#include <thread>
 #include <utility>
 #include <vector>
 #include "./common/common.h"
+#include "./data/slice_dmatrix.h"
 #include "./common/host_device_vector.h"
 #include "./common/io.h"
 #include "./common/random.h"
@@ -67,12 +71,90 @@ bool Learner::AllowLazyCheckPoint() const {
   return gbm_->AllowLazyCheckPoint();
 }
 
+size_t Learner::NumBoostedUnits() const {
+  return gbm_ == nullptr ? 0 : gbm_->NumBoostedUnits();
+}
+
+std::string Learner::FlushEvalOneIter() {
+  return std::string();
+}
+
+void Learner::SaveDelta(dmlc::Stream* fo, size_t unit_begin) const {
+  CHECK(gbm_ != nullptr) << "SaveDelta must happen after Load or InitModel";
+  gbm_->SaveDelta(fo, unit_begin);
+}
+
+void Learner::LoadDelta(dmlc::Stream* fi) {
+  CHECK(gbm_ != nullptr) << "LoadDelta must happen after Load or InitModel";
+  gbm_->LoadDelta(fi);
+}
+
+void Learner::PredictMarginRange(DMatrix* data,
+                                 HostDeviceVector<bst_float>* io_preds,
+                                 unsigned old_ntree_limit,
+                                 unsigned ntree_limit) const {
+  gbm_->PredictMarginRange(data, io_preds, old_ntree_limit, ntree_limit);
+}
+
+bool Learner::SetCachedPredictionMargin(
+    DMatrix* data, const std::vector<bst_float>& margin) {
+  CHECK(gbm_ != nullptr)
+      << "SetCachedPredictionMargin must happen after Load or InitModel";
+  return gbm_->SetCachedPredictionMargin(data, margin);
+}
+
+bool Learner::GetCachedPredictionMargin(
+    DMatrix* data, std::vector<bst_float>* out_margin) const {
+  CHECK(gbm_ != nullptr)
+      << "GetCachedPredictionMargin must happen after Load or InitModel";
+  return gbm_->GetCachedPredictionMargin(data, out_margin);
+}
+
+void Learner::PredictDeviceDense(const float* d_data, size_t num_row,
+                                 size_t num_col, unsigned ntree_limit,
+                                 const float** out_d_preds, size_t* out_len) {
+  CHECK(gbm_ != nullptr)
+      << "PredictDeviceDense must happen after Load or InitModel";
+  gbm_->PredictDeviceDense(d_data, num_row, num_col, ntree_limit, out_d_preds,
+                           out_len);
+}
+
+void Learner::Predict(const SparsePage::Inst& inst,
+                      bool output_margin,
+                      PredictionContext* ctx,
+                      unsigned ntree_limit) const {
+  gbm_->PredictInstance(inst, ctx, ntree_limit);
+  if (!output_margin) {
+    obj_->PredTransform(&ctx->preds);
+  }
+}
+
+void Learner::PredictSafe(DMatrix* data,
+                          bool output_margin,
+                          PredictionContext* ctx,
+                          unsigned ntree_limit) const {
+  gbm_->PredictBatchSafe(data, ctx, ntree_limit);
+  if (!output_margin) {
+    obj_->PredTransform(&ctx->preds);
+  }
+}
+
 std::vector<std::string> Learner::DumpModel(const FeatureMap& fmap,
                                             bool with_stats,
                                             std::string format) const {
   return gbm_->DumpModel(fmap, with_stats, format);
 }
 
+void Learner::FeatureImportance(const std::string& importance_type,
+                                std::vector<bst_uint>* out_features,
+                                std::vector<bst_float>* out_scores) const {
+  gbm_->FeatureImportance(importance_type, out_features, out_scores);
+}
+
+void Learner::OptimizeNodeLayout(DMatrix* p_fmat) {
+  gbm_->OptimizeNodeLayout(p_fmat);
+}
+
 /*! \brief training parameter for regression */
 struct LearnerModelParam : public dmlc::Parameter<LearnerModelParam> {
   /* \brief global bias */
@@ -124,6 +206,12 @@ struct LearnerTrainParam : public dmlc::Parameter<LearnerTrainParam> {
   int nthread;
   // flag to disable default metric
   int disable_default_eval_metric;
+  // fraction of each evaluation set metrics are computed on
+  float eval_subsample;
+  // period of full evaluation passes when eval_subsample < 1
+  int eval_full_period;
+  // whether evaluation runs in a background thread, one round delayed
+  bool eval_async;
   // declare parameters
   DMLC_DECLARE_PARAMETER(LearnerTrainParam) {
     DMLC_DECLARE_FIELD(seed).set_default(0).describe(
@@ -156,6 +244,32 @@ struct LearnerTrainParam : public dmlc::Parameter<LearnerTrainParam> {
     DMLC_DECLARE_FIELD(disable_default_eval_metric)
         .set_default(0)
         .describe("flag to disable default metric. Set to >0 to disable");
+    DMLC_DECLARE_FIELD(eval_subsample)
+        .set_range(0.0f, 1.0f)
+        .set_default(1.0f)
+        .describe(
+            "Fraction of each evaluation set metrics are computed on. Rows "
+            "(whole groups for ranking data) are split into 1/eval_subsample "
+            "deterministic label-stratified folds and every round evaluates "
+            "the next fold in rotation, so consecutive rounds together cover "
+            "the full set. 1 evaluates everything every round.");
+    DMLC_DECLARE_FIELD(eval_full_period)
+        .set_lower_bound(0)
+        .set_default(10)
+        .describe(
+            "With eval_subsample < 1, still evaluate the full set every this "
+            "many rounds, so stopping decisions are periodically confirmed "
+            "on exact metrics. 0 never forces a full pass.");
+    DMLC_DECLARE_FIELD(eval_async)
+        .set_default(false)
+        .describe(
+            "Evaluate each round on a shared-storage model snapshot in a "
+            "background thread, overlapping with the next boosting "
+            "iteration. Every EvalOneIter call returns the previous "
+            "round's metrics, so stopping decisions apply one round "
+            "delayed; the final round is collected with FlushEvalOneIter. "
+            "Ignored in distributed training; eval_subsample does not "
+            "apply to asynchronous evaluation.");
   }
 };
 
@@ -175,6 +289,12 @@ class LearnerImpl : public Learner {
     name_gbm_ = "gbtree";
   }
 
+  ~LearnerImpl() override {
+    if (async_eval_worker_.joinable()) {
+      async_eval_worker_.join();
+    }
+  }
+
   static void AssertGPUSupport() {
 #ifndef XGBOOST_USE_CUDA
     LOG(FATAL) << "XGBoost version not compiled with GPU support.";
@@ -209,7 +329,13 @@ class LearnerImpl : public Learner {
       cfg_["updater"] = "grow_histmaker,prune";
       break;
      case TreeMethod::kExact:
-      cfg_["updater"] = "grow_colmaker,prune";
+      if (tparam_.dsplit == DataSplitMode::kCol && rabit::IsDistributed()) {
+        // feature-parallel training; the distributed colmaker prunes and
+        // synchronizes the tree itself
+        cfg_["updater"] = "distcol";
+      } else {
+        cfg_["updater"] = "grow_colmaker,prune";
+      }
       break;
      case TreeMethod::kHist:
       LOG(INFO) <<
@@ -239,6 +365,13 @@ class LearnerImpl : public Learner {
 
   void Configure(
       const std::vector<std::pair<std::string, std::string> >& args) override {
+    // differential configuration: a repeat call with the same arguments
+    // (tuning loops push the full parameter list through SetParam before
+    // every fit) leaves all configured components untouched
+    if (this->ModelInitialized() && args == last_configure_args_) {
+      return;
+    }
+    last_configure_args_ = args;
     // add to configurations
     tparam_.InitAllowUnknown(args);
     ConsoleLogger::Configure(args.cbegin(), args.cend());
@@ -306,6 +439,8 @@ class LearnerImpl : public Learner {
     }
     if (obj_ != nullptr) {
       obj_->Configure(cfg_.begin(), cfg_.end());
+      // tree boosters slice one contiguous gradient block per class
+      obj_->SetClassMajorGradient(name_gbm_ == "gbtree" || name_gbm_ == "dart");
     }
 
     for (auto& p_metric : metrics_) {
@@ -408,12 +543,41 @@ class LearnerImpl : public Learner {
     cfg_["num_class"] = common::ToString(mparam_.num_class);
     cfg_["num_feature"] = common::ToString(mparam_.num_feature);
     obj_->Configure(cfg_.begin(), cfg_.end());
+    obj_->SetClassMajorGradient(name_gbm_ == "gbtree" || name_gbm_ == "dart");
 
     for (auto& p_metric : metrics_) {
       p_metric->Configure(cfg_.begin(), cfg_.end());
     }
   }
 
+  Learner* Slice(size_t unit_begin, size_t unit_end) const override {
+    CHECK(gbm_ != nullptr) << "Slice must happen after Load or InitModel";
+    std::unique_ptr<LearnerImpl> out(
+        new LearnerImpl(std::vector<std::shared_ptr<DMatrix> >{}));
+    out->mparam_ = mparam_;
+    out->tparam_ = tparam_;
+    out->cfg_ = cfg_;
+    out->attributes_ = attributes_;
+    out->name_obj_ = name_obj_;
+    out->name_gbm_ = name_gbm_;
+    // mirror the initialization order of Load; the booster shares the
+    // tree storage with this learner instead of reading a stream
+    out->obj_.reset(ObjFunction::Create(name_obj_));
+    out->gbm_.reset(
+        GradientBooster::Create(name_gbm_, out->cache_, mparam_.base_score));
+    gbm_->Slice(unit_begin, unit_end, out->gbm_.get());
+    for (auto& ev : metrics_) {
+      out->metrics_.emplace_back(Metric::Create(ev->Name()));
+    }
+    out->obj_->Configure(out->cfg_.begin(), out->cfg_.end());
+    out->obj_->SetClassMajorGradient(name_gbm_ == "gbtree" ||
+                                     name_gbm_ == "dart");
+    for (auto& p_metric : out->metrics_) {
+      p_metric->Configure(out->cfg_.begin(), out->cfg_.end());
+    }
+    return out.release();
+  }
+
   // rabit save model to rabit checkpoint
   void Save(dmlc::Stream* fo) const override {
     LearnerModelParam mparam = mparam_;  // make a copy to potentially modify
@@ -480,13 +644,22 @@ class LearnerImpl : public Learner {
       common::GlobalRandom().seed(tparam_.seed * kRandSeedMagic + iter);
     }
     this->PerformTreeMethodHeuristic(train);
+    iter_timings_.clear();
+    timing_iter_ = iter;
     monitor_.Start("PredictRaw");
+    double tstart = dmlc::GetTime();
     this->PredictRaw(train, &preds_);
+    iter_timings_["predict_raw"] = dmlc::GetTime() - tstart;
     monitor_.Stop("PredictRaw");
     monitor_.Start("GetGradient");
+    tstart = dmlc::GetTime();
     obj_->GetGradient(preds_, train->Info(), iter, &gpair_);
+    iter_timings_["get_gradient"] = dmlc::GetTime() - tstart;
     monitor_.Stop("GetGradient");
+    tstart = dmlc::GetTime();
     gbm_->DoBoost(train, &gpair_, obj_.get());
+    iter_timings_["boost"] = dmlc::GetTime() - tstart;
+    gbm_->CollectIterationTimings(&iter_timings_);
     monitor_.Stop("UpdateOneIter");
   }
 
@@ -497,33 +670,131 @@ class LearnerImpl : public Learner {
       common::GlobalRandom().seed(tparam_.seed * kRandSeedMagic + iter);
     }
     this->PerformTreeMethodHeuristic(train);
+    iter_timings_.clear();
+    timing_iter_ = iter;
+    const double tstart = dmlc::GetTime();
     gbm_->DoBoost(train, in_gpair);
+    iter_timings_["boost"] = dmlc::GetTime() - tstart;
+    gbm_->CollectIterationTimings(&iter_timings_);
     monitor_.Stop("BoostOneIter");
   }
 
   std::string EvalOneIter(int iter, const std::vector<DMatrix*>& data_sets,
                           const std::vector<std::string>& data_names) override {
+    if (tparam_.eval_async && !rabit::IsDistributed() &&
+        tparam_.dsplit != DataSplitMode::kRow) {
+      return this->EvalOneIterAsync(iter, data_sets, data_names);
+    }
     monitor_.Start("EvalOneIter");
+    const double eval_tstart = dmlc::GetTime();
     std::ostringstream os;
     os << '[' << iter << ']' << std::setiosflags(std::ios::fixed);
     if (metrics_.size() == 0 && tparam_.disable_default_eval_metric <= 0) {
       metrics_.emplace_back(Metric::Create(obj_->DefaultEvalMetric()));
       metrics_.back()->Configure(cfg_.begin(), cfg_.end());
     }
-    for (size_t i = 0; i < data_sets.size(); ++i) {
-      this->PredictRaw(data_sets[i], &preds_);
-      obj_->EvalTransform(&preds_);
-      for (auto& ev : metrics_) {
-        os << '\t' << data_names[i] << '-' << ev->Name() << ':'
-           << ev->Eval(preds_, data_sets[i]->Info(),
-                       tparam_.dsplit == DataSplitMode::kRow);
+    bool distributed = tparam_.dsplit == DataSplitMode::kRow;
+    // sampled evaluation: intermediate rounds compute metrics on a
+    // deterministic rotating fold of each eval set instead of the full
+    // matrix, with a full pass every eval_full_period rounds to confirm
+    // stopping decisions on exact values. The views only live through
+    // this call; fused metric lookups miss them by identity and fall
+    // through to the regular metric pass.
+    std::vector<std::shared_ptr<DMatrix> > eval_views;
+    std::vector<DMatrix*> eval_sets(data_sets);
+    const bool full_round =
+        tparam_.eval_full_period > 0 &&
+        (iter + 1) % tparam_.eval_full_period == 0;
+    if (tparam_.eval_subsample < 1.0f && !full_round) {
+      for (size_t i = 0; i < data_sets.size(); ++i) {
+        std::shared_ptr<DMatrix> view = MakeEvalFold(data_sets[i], iter);
+        if (view != nullptr) {
+          eval_views.push_back(view);
+          eval_sets[i] = view.get();
+        }
+      }
+    }
+    // pipeline the two phases: while the metrics of one eval set run in a
+    // background thread, the prediction of the next set proceeds on the
+    // main thread. The metric pass only reads its own prediction buffer,
+    // so two buffers suffice. Distributed evaluation stays serial to keep
+    // the rabit call ordering identical on every worker.
+    const bool pipeline = !distributed && data_sets.size() > 1;
+    std::vector<std::ostringstream> set_os(data_sets.size());
+    std::thread metric_worker;
+    for (size_t i = 0; i < eval_sets.size(); ++i) {
+      set_os[i] << std::setiosflags(std::ios::fixed);
+      HostDeviceVector<bst_float>* buf =
+          (i % 2 == 0) ? &preds_ : &eval_preds_;
+      this->PredictRaw(eval_sets[i], buf);
+      obj_->EvalTransform(buf);
+      // objectives can report the training metric computed during the
+      // gradient pass, saving a separate pass over the predictions;
+      // resolve those lookups here so only this thread touches obj_
+      std::vector<std::pair<bool, bst_float> > fused(metrics_.size());
+      if (!distributed) {
+        for (size_t m = 0; m < metrics_.size(); ++m) {
+          fused[m].first = obj_->GetFusedMetric(
+              eval_sets[i]->Info(), metrics_[m]->Name(), &fused[m].second);
+        }
+      }
+      auto eval_set = [this, buf, i, distributed, fused,
+                       &eval_sets, &data_names, &set_os]() {
+        for (size_t m = 0; m < metrics_.size(); ++m) {
+          bst_float metric_value;
+          if (!distributed && fused[m].first) {
+            metric_value = fused[m].second;
+          } else {
+            metric_value =
+                metrics_[m]->Eval(*buf, eval_sets[i]->Info(), distributed);
+          }
+          set_os[i] << '\t' << data_names[i] << '-' << metrics_[m]->Name()
+                    << ':' << metric_value;
+        }
+      };
+      if (pipeline) {
+        if (metric_worker.joinable()) metric_worker.join();
+        metric_worker = std::thread(eval_set);
+      } else {
+        eval_set();
       }
     }
+    if (metric_worker.joinable()) metric_worker.join();
+    for (auto& set_result : set_os) {
+      os << set_result.str();
+    }
 
+    iter_timings_["eval"] = dmlc::GetTime() - eval_tstart;
     monitor_.Stop("EvalOneIter");
     return os.str();
   }
 
+  std::string FlushEvalOneIter() override {
+    if (async_eval_worker_.joinable()) {
+      async_eval_worker_.join();
+    }
+    std::string res;
+    res.swap(async_eval_result_);
+    return res;
+  }
+
+  std::string IterationTimingsJson() const override {
+    std::ostringstream os;
+    os << '{';
+    bool first = true;
+    if (timing_iter_ >= 0) {
+      os << "\"iter\":" << timing_iter_;
+      first = false;
+    }
+    for (const auto& kv : iter_timings_) {
+      if (!first) os << ',';
+      os << '"' << kv.first << "\":" << kv.second;
+      first = false;
+    }
+    os << '}';
+    return os.str();
+  }
+
   void SetAttr(const std::string& key, const std::string& value) override {
     attributes_[key] = value;
     mparam_.contain_extra_attrs = 1;
@@ -598,15 +869,28 @@ class LearnerImpl : public Learner {
     }
 
     const TreeMethod current_tree_method = tparam_.tree_method;
-    if (rabit::IsDistributed()) {
+    if (rabit::IsDistributed() && tparam_.dsplit == DataSplitMode::kCol) {
+      /* Feature-parallel training: every worker holds a feature shard of
+       * all rows and only the exact colmaker has a column-split
+       * implementation ('distcol') */
+      switch (current_tree_method) {
+       case TreeMethod::kAuto:
+        LOG(WARNING) <<
+            "Tree method is automatically selected to be 'exact' "
+            "for column-wise distributed training.";
+        break;
+       case TreeMethod::kExact:
+        // things are okay, do nothing
+        break;
+       default:
+        LOG(FATAL) << "Column-wise data split is only supported by "
+                      "tree_method 'exact'";
+      }
+      tparam_.tree_method = TreeMethod::kExact;
+    } else if (rabit::IsDistributed()) {
       /* Choose tree_method='approx' when distributed training is activated */
       CHECK(tparam_.dsplit != DataSplitMode::kAuto)
         << "Precondition violated; dsplit cannot be 'auto' in distributed mode";
-      if (tparam_.dsplit == DataSplitMode::kCol) {
-        // 'distcol' updater hidden until it becomes functional again
-        // See discussion at https://github.com/dmlc/xgboost/issues/1832
-        LOG(FATAL) << "Column-wise data split is currently not supported.";
-      }
       switch (current_tree_method) {
        case TreeMethod::kAuto:
         LOG(WARNING) <<
@@ -708,6 +992,7 @@ class LearnerImpl : public Learner {
     CHECK(obj_ == nullptr && gbm_ == nullptr);
     obj_.reset(ObjFunction::Create(name_obj_));
     obj_->Configure(cfg_.begin(), cfg_.end());
+    obj_->SetClassMajorGradient(name_gbm_ == "gbtree" || name_gbm_ == "dart");
     // reset the base score
     mparam_.base_score = obj_->ProbToMargin(mparam_.base_score);
     gbm_.reset(GradientBooster::Create(name_gbm_, cache_, mparam_.base_score));
@@ -727,12 +1012,151 @@ class LearnerImpl : public Learner {
     gbm_->PredictBatch(data, out_preds, ntree_limit);
   }
 
+  /*!
+   * \brief build the rotating evaluation fold of dmat for this round.
+   *  Rows (whole groups for ranking data) are split round-robin into
+   *  1/eval_subsample folds over the label-sorted order, so every fold
+   *  keeps the label distribution, and round iter evaluates fold
+   *  iter % k. The stratified order is computed once per matrix and
+   *  cached; the fold view itself is cheap to build.
+   * \return the fold view, or nullptr when the matrix cannot or should
+   *  not be sliced
+   */
+  std::shared_ptr<DMatrix> MakeEvalFold(DMatrix* dmat, int iter) {
+    if (!dmat->SingleColBlock()) {
+      return nullptr;  // external memory matrices cannot be sliced
+    }
+    const MetaInfo& info = dmat->Info();
+    const size_t num_group =
+        info.group_ptr_.size() == 0 ? 0 : info.group_ptr_.size() - 1;
+    const size_t num_unit = num_group == 0 ? info.num_row_ : num_group;
+    const double frac =
+        std::max(static_cast<double>(tparam_.eval_subsample), 1e-6);
+    const size_t k = std::max(static_cast<size_t>(1.0 / frac + 0.5),
+                              static_cast<size_t>(2));
+    if (num_unit < k * 2) {
+      return nullptr;  // too small for sampling to pay off
+    }
+    std::vector<bst_uint>& order = eval_fold_order_[dmat];
+    if (order.size() != num_unit) {
+      order.resize(num_unit);
+      std::iota(order.begin(), order.end(), 0U);
+      const auto& labels = info.labels_.ConstHostVector();
+      if (num_group == 0 && labels.size() == num_unit) {
+        // over the label-sorted sequence every k-th element lands in the
+        // same fold, so each fold samples the label distribution evenly
+        std::stable_sort(order.begin(), order.end(),
+                         [&labels](bst_uint a, bst_uint b) {
+                           return labels[a] < labels[b];
+                         });
+      }
+    }
+    std::vector<bst_uint> units;
+    for (size_t i = static_cast<size_t>(iter) % k; i < order.size(); i += k) {
+      units.push_back(order[i]);
+    }
+    std::sort(units.begin(), units.end());
+    std::vector<bst_uint> ridx;
+    if (num_group == 0) {
+      ridx = std::move(units);
+    } else {
+      // grouped data rotates whole groups, keeping the list structure of
+      // ranking metrics intact
+      for (bst_uint g : units) {
+        for (bst_uint r = info.group_ptr_[g]; r < info.group_ptr_[g + 1];
+             ++r) {
+          ridx.push_back(r);
+        }
+      }
+    }
+    // non-owning alias: the view lives only through the current
+    // evaluation call, strictly inside the lifetime of the eval matrix
+    std::shared_ptr<DMatrix> parent(dmat, [](DMatrix*) {});
+    return std::make_shared<data::SliceDMatrix>(parent, std::move(ridx));
+  }
+
+  /*!
+   * \brief asynchronous evaluation round: spawn a worker that evaluates
+   *  the current model through a shared-storage snapshot, and return the
+   *  result of the worker spawned the previous round. The snapshot pins
+   *  the committed trees — training only appends new ones, and the
+   *  copy-on-write guards in the tree boosters keep in-place rewrites off
+   *  shared storage — so the next UpdateOneIter can run concurrently.
+   *  The per-set margins persist across rounds and each round only
+   *  predicts the trees committed since the last one.
+   */
+  std::string EvalOneIterAsync(int iter, const std::vector<DMatrix*>& data_sets,
+                               const std::vector<std::string>& data_names) {
+    monitor_.Start("EvalOneIter");
+    const double eval_tstart = dmlc::GetTime();
+    std::string prev = this->FlushEvalOneIter();
+    if (metrics_.size() == 0 && tparam_.disable_default_eval_metric <= 0) {
+      metrics_.emplace_back(Metric::Create(obj_->DefaultEvalMetric()));
+      metrics_.back()->Configure(cfg_.begin(), cfg_.end());
+    }
+    // the snapshot shares the tree storage but owns its booster,
+    // objective and metrics, so the worker never touches the members the
+    // training thread is using
+    std::shared_ptr<LearnerImpl> snap(
+        static_cast<LearnerImpl*>(this->Slice(0, 0)));
+    snap->Configure(last_configure_args_);
+    // materialize the lazily computed per-matrix state from this thread,
+    // so the worker does not race the training thread on the first call
+    for (DMatrix* dmat : data_sets) {
+      dmat->Stats();
+    }
+    const size_t ngroup =
+        mparam_.num_class == 0 ? 1 : static_cast<size_t>(mparam_.num_class);
+    std::vector<DMatrix*> sets(data_sets);
+    std::vector<std::string> names(data_names);
+    async_eval_worker_ = std::thread([this, snap, iter, ngroup, sets,
+                                      names]() {
+      std::ostringstream os;
+      os << '[' << iter << ']' << std::setiosflags(std::ios::fixed);
+      for (size_t i = 0; i < sets.size(); ++i) {
+        DMatrix* dmat = sets[i];
+        HostDeviceVector<bst_float>& margin = async_eval_margins_[dmat];
+        size_t& covered = async_eval_margin_trees_[dmat];
+        const size_t num_trees = snap->NumBoostedUnits();
+        if (num_trees != 0 && num_trees % ngroup == 0 &&
+            covered % ngroup == 0 && covered <= num_trees &&
+            margin.Size() == dmat->Info().num_row_ * ngroup) {
+          // extend the persisted margins by the trees committed since the
+          // last round
+          snap->PredictMarginRange(dmat, &margin,
+                                   static_cast<unsigned>(covered / ngroup));
+        } else {
+          // first round, or the booster does not report boosted units
+          // (e.g. dart): fall back to a full prediction pass
+          snap->PredictRaw(dmat, &margin);
+        }
+        covered = num_trees;
+        // the metrics consume a transformed copy; the margins themselves
+        // stay raw for the next round's delta
+        HostDeviceVector<bst_float> buf;
+        buf.Resize(margin.Size());
+        buf.Copy(margin);
+        snap->obj_->EvalTransform(&buf);
+        for (size_t m = 0; m < snap->metrics_.size(); ++m) {
+          os << '\t' << names[i] << '-' << snap->metrics_[m]->Name() << ':'
+             << snap->metrics_[m]->Eval(buf, dmat->Info(), false);
+        }
+      }
+      async_eval_result_ = os.str();
+    });
+    iter_timings_["eval"] = dmlc::GetTime() - eval_tstart;
+    monitor_.Stop("EvalOneIter");
+    return prev;
+  }
+
   // model parameter
   LearnerModelParam mparam_;
   // training parameter
   LearnerTrainParam tparam_;
   // configurations
   std::map<std::string, std::string> cfg_;
+  // arguments of the last Configure call, to skip no-op reconfiguration
+  std::vector<std::pair<std::string, std::string> > last_configure_args_;
   // attributes
   std::map<std::string, std::string> attributes_;
   // name of gbm
@@ -741,6 +1165,9 @@ class LearnerImpl : public Learner {
   std::string name_obj_;
   // temporal storages for prediction
   HostDeviceVector<bst_float> preds_;
+  // second prediction buffer, so the pipelined evaluation can predict the
+  // next eval set while the metrics of the previous one are computed
+  HostDeviceVector<bst_float> eval_preds_;
   // gradient pairs
   HostDeviceVector<GradientPair> gpair_;
 
@@ -751,6 +1178,21 @@ class LearnerImpl : public Learner {
   std::vector<std::shared_ptr<DMatrix> > cache_;
 
   common::Monitor monitor_;
+  // cached stratified orders of the evaluation sets, for the rotating
+  // subsample folds
+  std::map<DMatrix*, std::vector<bst_uint> > eval_fold_order_;
+  // background worker of the asynchronous evaluation mode and the result
+  // it produced, collected by the following round or FlushEvalOneIter
+  std::thread async_eval_worker_;
+  std::string async_eval_result_;
+  // persisted raw margins of each eval set and the number of trees they
+  // cover, so every asynchronous round only predicts the new trees
+  std::map<DMatrix*, HostDeviceVector<bst_float> > async_eval_margins_;
+  std::map<DMatrix*, size_t> async_eval_margin_trees_;
+  // phase wall times of the most recent iteration, in seconds
+  std::map<std::string, double> iter_timings_;
+  // iteration the timings belong to, -1 before the first iteration
+  int timing_iter_{-1};
 };
 
 Learner* Learner::Create(
@@ -4,7 +4,10 @@
  */
 #pragma once
 #include <algorithm>
+#include <cstdint>
+#include <list>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 #include <limits>
@@ -79,11 +82,12 @@ inline std::pair<double, double> GetGradient(int group_idx, int num_group, int f
                                              DMatrix *p_fmat) {
   double sum_grad = 0.0, sum_hess = 0.0;
   for (const auto &batch : p_fmat->GetColumnBatches()) {
-    auto col = batch[fidx];
-    const auto ndata = static_cast<bst_omp_uint>(col.size());
+    auto col_value = batch.RowValues(fidx);
+    auto col_index = batch.RowIndices(fidx);
+    const auto ndata = static_cast<bst_omp_uint>(col_value.size());
     for (bst_omp_uint j = 0; j < ndata; ++j) {
-      const bst_float v = col[j].fvalue;
-      auto &p = gpair[col[j].index * num_group + group_idx];
+      const bst_float v = col_value[j];
+      auto &p = gpair[col_index[j] * num_group + group_idx];
       if (p.GetHess() < 0.0f) continue;
       sum_grad += p.GetGrad() * v;
       sum_hess += p.GetHess() * v * v;
@@ -108,12 +112,13 @@ inline std::pair<double, double> GetGradientParallel(int group_idx, int num_grou
                                                      DMatrix *p_fmat) {
   double sum_grad = 0.0, sum_hess = 0.0;
   for (const auto &batch : p_fmat->GetColumnBatches()) {
-    auto col = batch[fidx];
-    const auto ndata = static_cast<bst_omp_uint>(col.size());
+    auto col_value = batch.RowValues(fidx);
+    auto col_index = batch.RowIndices(fidx);
+    const auto ndata = static_cast<bst_omp_uint>(col_value.size());
 #pragma omp parallel for schedule(static) reduction(+ : sum_grad, sum_hess)
     for (bst_omp_uint j = 0; j < ndata; ++j) {
-      const bst_float v = col[j].fvalue;
-      auto &p = gpair[col[j].index * num_group + group_idx];
+      const bst_float v = col_value[j];
+      auto &p = gpair[col_index[j] * num_group + group_idx];
       if (p.GetHess() < 0.0f) continue;
       sum_grad += p.GetGrad() * v;
       sum_hess += p.GetHess() * v * v;
@@ -122,6 +127,110 @@ inline std::pair<double, double> GetGradientParallel(int group_idx, int num_grou
   return std::make_pair(sum_grad, sum_hess);
 }
 
+/**
+ * \brief Compact cache of hot feature columns for coordinate updates.
+ *
+ * Coordinate descent revisits the same top-k features across update
+ * rounds; walking the DMatrix column iterator every step re-touches the
+ * paged CSC structures. The cache copies a requested column into
+ * contiguous value / 32-bit row index arrays and serves repeats from
+ * there under a byte budget, evicting the least recently used column.
+ * Columns depend only on the feature matrix, so entries stay valid
+ * until a different DMatrix is seen.
+ */
+class ColumnCache {
+ public:
+  struct Column {
+    std::vector<bst_float> values;
+    std::vector<uint32_t> rowids;
+
+    size_t Bytes() const {
+      return values.size() * (sizeof(bst_float) + sizeof(uint32_t));
+    }
+  };
+
+  ColumnCache() : budget_bytes_(static_cast<size_t>(dmlc::GetEnv(
+                      "XGBOOST_COLUMN_CACHE_MB", 256)) << 20) {}
+
+  const Column& Get(int fidx, DMatrix *p_fmat) {
+    if (p_fmat != p_fmat_) {
+      entries_.clear();
+      lookup_.clear();
+      used_bytes_ = 0;
+      p_fmat_ = p_fmat;
+    }
+    auto it = lookup_.find(fidx);
+    if (it != lookup_.end()) {
+      // move to the front of the LRU list
+      entries_.splice(entries_.begin(), entries_, it->second);
+      return entries_.front().second;
+    }
+    entries_.emplace_front(fidx, Column());
+    Column &col = entries_.front().second;
+    for (const auto &batch : p_fmat->GetColumnBatches()) {
+      auto c = batch[fidx];
+      col.values.reserve(col.values.size() + c.size());
+      col.rowids.reserve(col.rowids.size() + c.size());
+      for (const auto &e : c) {
+        col.values.push_back(e.fvalue);
+        col.rowids.push_back(static_cast<uint32_t>(e.index));
+      }
+    }
+    used_bytes_ += col.Bytes();
+    lookup_[fidx] = entries_.begin();
+    while (used_bytes_ > budget_bytes_ && entries_.size() > 1) {
+      used_bytes_ -= entries_.back().second.Bytes();
+      lookup_.erase(entries_.back().first);
+      entries_.pop_back();
+    }
+    return entries_.front().second;
+  }
+
+ private:
+  size_t budget_bytes_;
+  size_t used_bytes_{0};
+  DMatrix *p_fmat_{nullptr};
+  // most recently used columns at the front
+  std::list<std::pair<int, Column>> entries_;
+  std::unordered_map<int, std::list<std::pair<int, Column>>::iterator> lookup_;
+};
+
+/**
+ * \brief Cached-column variant of GetGradientParallel: reduces over the
+ * contiguous value / row index arrays instead of the column iterator.
+ */
+inline std::pair<double, double> GetGradientParallel(
+    int group_idx, int num_group, const ColumnCache::Column &col,
+    const std::vector<GradientPair> &gpair) {
+  double sum_grad = 0.0, sum_hess = 0.0;
+  const auto ndata = static_cast<bst_omp_uint>(col.values.size());
+#pragma omp parallel for schedule(static) reduction(+ : sum_grad, sum_hess)
+  for (bst_omp_uint j = 0; j < ndata; ++j) {
+    const bst_float v = col.values[j];
+    auto &p = gpair[col.rowids[j] * num_group + group_idx];
+    if (p.GetHess() < 0.0f) continue;
+    sum_grad += p.GetGrad() * v;
+    sum_hess += p.GetHess() * v * v;
+  }
+  return std::make_pair(sum_grad, sum_hess);
+}
+
+/**
+ * \brief Cached-column variant of UpdateResidualParallel.
+ */
+inline void UpdateResidualParallel(int group_idx, int num_group, float dw,
+                                   const ColumnCache::Column &col,
+                                   std::vector<GradientPair> *in_gpair) {
+  if (dw == 0.0f) return;
+  const auto ndata = static_cast<bst_omp_uint>(col.values.size());
+#pragma omp parallel for schedule(static)
+  for (bst_omp_uint j = 0; j < ndata; ++j) {
+    GradientPair &p = (*in_gpair)[col.rowids[j] * num_group + group_idx];
+    if (p.GetHess() < 0.0f) continue;
+    p += GradientPair(p.GetHess() * col.values[j] * dw, 0);
+  }
+}
+
 /**
  * \brief Get the gradient with respect to the bias. Row-wise multithreaded.
  *
@@ -163,14 +272,15 @@ inline void UpdateResidualParallel(int fidx, int group_idx, int num_group,
                                    DMatrix *p_fmat) {
   if (dw == 0.0f) return;
   for (const auto &batch : p_fmat->GetColumnBatches()) {
-    auto col = batch[fidx];
+    auto col_value = batch.RowValues(fidx);
+    auto col_index = batch.RowIndices(fidx);
     // update grad value
-    const auto num_row = static_cast<bst_omp_uint>(col.size());
+    const auto num_row = static_cast<bst_omp_uint>(col_value.size());
 #pragma omp parallel for schedule(static)
     for (bst_omp_uint j = 0; j < num_row; ++j) {
-      GradientPair &p = (*in_gpair)[col[j].index * num_group + group_idx];
+      GradientPair &p = (*in_gpair)[col_index[j] * num_group + group_idx];
       if (p.GetHess() < 0.0f) continue;
-      p += GradientPair(p.GetHess() * col[j].fvalue * dw, 0);
+      p += GradientPair(p.GetHess() * col_value[j] * dw, 0);
     }
   }
 }
@@ -294,12 +404,16 @@ class RandomFeatureSelector : public FeatureSelector {
 
 /**
  * \brief Select coordinate with the greatest gradient magnitude.
- * \note It has O(num_feature^2) complexity. It is fully deterministic.
+ * \note It is fully deterministic. All features are scored once per
+ * update round; after that a lazily re-evaluated max-heap over the
+ * scores serves the selections. Each NextFeature call re-scores only
+ * the features it pops from the top of the heap (one column scan each)
+ * until the refreshed top outranks the runner-up bound, so a coordinate
+ * step costs a few column scans instead of a full pass over the matrix.
  *
  * \note It allows restricting the selection to top_k features per group with
  * the largest magnitude of univariate weight change, by passing the top_k value
- * through the `param` argument of Setup(). That would reduce the complexity to
- * O(num_feature*top_k).
+ * through the `param` argument of Setup().
  */
 class GreedyFeatureSelector : public FeatureSelector {
  public:
@@ -307,14 +421,49 @@ class GreedyFeatureSelector : public FeatureSelector {
              const std::vector<GradientPair> &gpair,
              DMatrix *p_fmat, float alpha, float lambda, int param) override {
     top_k_ = static_cast<bst_uint>(param);
-    const bst_uint ngroup = model.param.num_output_group;
     if (param <= 0) top_k_ = std::numeric_limits<bst_uint>::max();
+    const bst_uint ngroup = model.param.num_output_group;
+    const bst_omp_uint nfeat = model.param.num_feature;
     if (counter_.size() == 0) {
       counter_.resize(ngroup);
-      gpair_sums_.resize(model.param.num_feature * ngroup);
+      gpair_sums_.resize(nfeat * ngroup);
+      heaps_.resize(ngroup);
     }
+    // Calculate univariate gradient sums for every feature once per round
+    std::fill(gpair_sums_.begin(), gpair_sums_.end(), std::make_pair(0., 0.));
+    for (const auto &batch : p_fmat->GetColumnBatches()) {
+      // materialize the SoA mirror before entering the parallel region
+      batch.Values();
+#pragma omp parallel for schedule(static)
+      for (bst_omp_uint i = 0; i < nfeat; ++i) {
+        const auto col_value = batch.RowValues(i);
+        const auto col_index = batch.RowIndices(i);
+        const auto ndata = static_cast<bst_uint>(col_value.size());
+        for (bst_uint gid = 0u; gid < ngroup; ++gid) {
+          auto &sums = gpair_sums_[gid * nfeat + i];
+          for (bst_uint j = 0u; j < ndata; ++j) {
+            const bst_float v = col_value[j];
+            auto &p = gpair[col_index[j] * ngroup + gid];
+            if (p.GetHess() < 0.f) continue;
+            sums.first += p.GetGrad() * v;
+            sums.second += p.GetHess() * v * v;
+          }
+        }
+      }
+    }
+    // build a max-heap of weight change magnitudes per group
     for (bst_uint gid = 0u; gid < ngroup; ++gid) {
       counter_[gid] = 0u;
+      auto &heap = heaps_[gid];
+      heap.clear();
+      heap.reserve(nfeat);
+      for (bst_omp_uint i = 0; i < nfeat; ++i) {
+        auto &s = gpair_sums_[gid * nfeat + i];
+        const auto dw = std::abs(static_cast<bst_float>(
+            CoordinateDelta(s.first, s.second, model[i][gid], alpha, lambda)));
+        heap.emplace_back(dw, static_cast<bst_uint>(i));
+      }
+      std::make_heap(heap.begin(), heap.end());
     }
   }
 
@@ -328,42 +477,48 @@ class GreedyFeatureSelector : public FeatureSelector {
 
     const int ngroup = model.param.num_output_group;
     const bst_omp_uint nfeat = model.param.num_feature;
-    // Calculate univariate gradient sums
-    std::fill(gpair_sums_.begin(), gpair_sums_.end(), std::make_pair(0., 0.));
-  for (const auto &batch : p_fmat->GetColumnBatches()) {
-      #pragma omp parallel for schedule(static)
-      for (bst_omp_uint i = 0; i < nfeat; ++i) {
-        const auto col = batch[i];
-        const bst_uint ndata = col.size();
-        auto &sums = gpair_sums_[group_idx * nfeat + i];
+    auto &heap = heaps_[group_idx];
+    // lazy greedy: scores in the heap are bounds from when the feature
+    // was last scanned. Refresh only the current top; once it still
+    // outranks the runner-up bound it is the exact argmax, since the
+    // other entries can only have gone stale downwards through residual
+    // shrinkage. Selected features are consumed and not revisited
+    // within the round.
+    while (!heap.empty()) {
+      std::pop_heap(heap.begin(), heap.end());
+      const bst_uint fidx = heap.back().second;
+      heap.pop_back();
+      auto &sums = gpair_sums_[group_idx * nfeat + fidx];
+      sums = std::make_pair(0., 0.);
+      for (const auto &batch : p_fmat->GetColumnBatches()) {
+        const auto col_value = batch.RowValues(fidx);
+        const auto col_index = batch.RowIndices(fidx);
+        const auto ndata = static_cast<bst_uint>(col_value.size());
         for (bst_uint j = 0u; j < ndata; ++j) {
-          const bst_float v = col[j].fvalue;
-          auto &p = gpair[col[j].index * ngroup + group_idx];
+          const bst_float v = col_value[j];
+          auto &p = gpair[col_index[j] * ngroup + group_idx];
           if (p.GetHess() < 0.f) continue;
           sums.first += p.GetGrad() * v;
           sums.second += p.GetHess() * v * v;
         }
       }
-    }
-    // Find a feature with the largest magnitude of weight change
-    int best_fidx = 0;
-    double best_weight_update = 0.0f;
-    for (bst_omp_uint fidx = 0; fidx < nfeat; ++fidx) {
-      auto &s = gpair_sums_[group_idx * nfeat + fidx];
-      float dw = std::abs(static_cast<bst_float>(
-                 CoordinateDelta(s.first, s.second, model[fidx][group_idx], alpha, lambda)));
-      if (dw > best_weight_update) {
-        best_weight_update = dw;
-        best_fidx = fidx;
+      const auto dw = std::abs(static_cast<bst_float>(CoordinateDelta(
+          sums.first, sums.second, model[fidx][group_idx], alpha, lambda)));
+      if (heap.empty() || dw >= heap.front().first) {
+        return fidx;
       }
+      heap.emplace_back(dw, fidx);
+      std::push_heap(heap.begin(), heap.end());
     }
-    return best_fidx;
+    return -1;
   }
 
  protected:
   bst_uint top_k_;
   std::vector<bst_uint> counter_;
   std::vector<std::pair<double, double>> gpair_sums_;
+  // per-group max-heaps of (last scored |delta w|, feature index)
+  std::vector<std::vector<std::pair<bst_float, bst_uint>>> heaps_;
 };
 
 /**
@@ -396,16 +551,19 @@ class ThriftyFeatureSelector : public FeatureSelector {
     // Calculate univariate gradient sums
     std::fill(gpair_sums_.begin(), gpair_sums_.end(), std::make_pair(0., 0.));
     for (const auto &batch : p_fmat->GetColumnBatches()) {
+      // materialize the SoA mirror before entering the parallel region
+      batch.Values();
 // column-parallel is usually faster than row-parallel
 #pragma omp parallel for schedule(static)
       for (bst_omp_uint i = 0; i < nfeat; ++i) {
-        const auto col = batch[i];
-        const bst_uint ndata = col.size();
+        const auto col_value = batch.RowValues(i);
+        const auto col_index = batch.RowIndices(i);
+        const auto ndata = static_cast<bst_uint>(col_value.size());
         for (bst_uint gid = 0u; gid < ngroup; ++gid) {
           auto &sums = gpair_sums_[gid * nfeat + i];
           for (bst_uint j = 0u; j < ndata; ++j) {
-            const bst_float v = col[j].fvalue;
-            auto &p = gpair[col[j].index * ngroup + gid];
+            const bst_float v = col_value[j];
+            auto &p = gpair[col_index[j] * ngroup + gid];
             if (p.GetHess() < 0.f) continue;
             sums.first += p.GetGrad() * v;
             sums.second += p.GetHess() * v * v;
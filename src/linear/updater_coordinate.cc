@@ -68,20 +68,24 @@ class CoordinateUpdater : public LinearUpdater {
                             DMatrix *p_fmat, gbm::GBLinearModel *model) {
     const int ngroup = model->param.num_output_group;
     bst_float &w = (*model)[fidx][group_idx];
-    auto gradient =
-        GetGradientParallel(group_idx, ngroup, fidx, *in_gpair, p_fmat);
+    // coordinate updates revisit the same top-k features every round, so
+    // serve the column from the compact cache instead of the column
+    // iterator
+    const ColumnCache::Column &col = ccache_.Get(fidx, p_fmat);
+    auto gradient = GetGradientParallel(group_idx, ngroup, col, *in_gpair);
     auto dw = static_cast<float>(
         tparam_.learning_rate *
         CoordinateDelta(gradient.first, gradient.second, w, tparam_.reg_alpha_denorm,
                         tparam_.reg_lambda_denorm));
     w += dw;
-    UpdateResidualParallel(fidx, group_idx, ngroup, dw, in_gpair, p_fmat);
+    UpdateResidualParallel(group_idx, ngroup, dw, col, in_gpair);
   }
 
   CoordinateParam cparam_;
   // training parameter
   LinearTrainParam tparam_;
   std::unique_ptr<FeatureSelector> selector;
+  ColumnCache ccache_;
   common::Monitor monitor;
 };
 
@@ -7,6 +7,8 @@
 #include <thrust/inner_product.h>
 #include <xgboost/data.h>
 #include <xgboost/linear_updater.h>
+#include <algorithm>
+#include <vector>
 #include "../common/common.h"
 #include "../common/span.h"
 #include "../common/device_helpers.cuh"
@@ -19,6 +21,25 @@ namespace linear {
 
 DMLC_REGISTRY_FILE_TAG(updater_gpu_coordinate);
 
+// training parameters specific to this updater
+struct GPUCoordinateTrainParam
+    : public dmlc::Parameter<GPUCoordinateTrainParam> {
+  int feature_batch_size;
+  // declare parameters
+  DMLC_DECLARE_PARAMETER(GPUCoordinateTrainParam) {
+    DMLC_DECLARE_FIELD(feature_batch_size)
+        .set_lower_bound(1)
+        .set_default(1)
+        .describe(
+            "Number of features whose gradients are computed per device "
+            "synchronization. With a batch larger than one, the updates "
+            "within a batch use the residual from the start of the batch "
+            "(parallel coordinate descent).");
+  }
+};
+
+DMLC_REGISTER_PARAMETER(GPUCoordinateTrainParam);
+
 void RescaleIndices(size_t ridx_begin, dh::DVec<xgboost::Entry> *data) {
   auto d_data = data->GetSpan();
   dh::LaunchN(data->DeviceIdx(), data->Size(),
@@ -130,6 +151,64 @@ class DeviceShard {
     return dh::SumReduction(temp_, multiply_iterator, col_size);
   }
 
+  // Like GetGradient, but reduces a batch of columns with a single device
+  // synchronization: the per-column reductions are launched back to back and
+  // the results are retrieved with one copy at the end.
+  std::vector<GradientPair> GetGradientBatch(int group_idx, int num_group,
+                                             const std::vector<int> &fidxs) {
+    std::vector<GradientPair> result(fidxs.size());
+    size_t max_col_size = 0;
+    for (auto fidx : fidxs) {
+      max_col_size = std::max(max_col_size, row_ptr_[fidx + 1] - row_ptr_[fidx]);
+    }
+    if (max_col_size == 0) { return result; }
+    dh::safe_cuda(cudaSetDevice(device_id_));
+    common::Span<GradientPair> d_gpair = gpair_.GetSpan();
+    auto counting = thrust::make_counting_iterator(0ull);
+    // the per-feature results are stored in front of the cub workspace
+    size_t results_bytes =
+        dh::DivRoundUp(sizeof(GradientPair) * fidxs.size(), 256) * 256;
+    size_t tmp_bytes = 0;
+    void *d_tmp = nullptr;
+    GradientPair *d_out = nullptr;
+    for (size_t i = 0; i < fidxs.size(); ++i) {
+      int fidx = fidxs[i];
+      common::Span<xgboost::Entry> d_col =
+          data_.GetSpan().subspan(row_ptr_[fidx]);
+      size_t col_size = row_ptr_[fidx + 1] - row_ptr_[fidx];
+      if (col_size == 0) { continue; }  // the results were zero-initialized
+      auto f = [=] __device__(size_t idx) {
+        auto entry = d_col[idx];
+        auto g = d_gpair[entry.index * num_group + group_idx];
+        return GradientPair(g.GetGrad() * entry.fvalue,
+                            g.GetHess() * entry.fvalue * entry.fvalue);
+      };  // NOLINT
+      thrust::transform_iterator<decltype(f), decltype(counting), GradientPair>
+          multiply_iterator(counting, f);
+      if (d_tmp == nullptr) {
+        // size the workspace for the largest column of the batch
+        GradientPair *dummy_out = nullptr;
+        dh::safe_cuda(cub::DeviceReduce::Sum(nullptr, tmp_bytes,
+                                             multiply_iterator, dummy_out,
+                                             static_cast<int>(max_col_size)));
+        temp_.LazyAllocate(results_bytes + tmp_bytes);
+        d_out = reinterpret_cast<GradientPair *>(temp_.d_temp_storage);
+        d_tmp = reinterpret_cast<char *>(temp_.d_temp_storage) + results_bytes;
+        dh::safe_cuda(cudaMemsetAsync(d_out, 0,
+                                      sizeof(GradientPair) * fidxs.size()));
+      }
+      // asynchronous; consecutive reductions serialize on the stream, so the
+      // workspace can be shared between them
+      dh::safe_cuda(cub::DeviceReduce::Sum(d_tmp, tmp_bytes, multiply_iterator,
+                                           d_out + i,
+                                           static_cast<int>(col_size)));
+    }
+    dh::safe_cuda(cudaMemcpy(result.data(), d_out,
+                             sizeof(GradientPair) * result.size(),
+                             cudaMemcpyDeviceToHost));
+    return result;
+  }
+
   void UpdateResidual(float dw, int group_idx, int num_groups, int fidx) {
     common::Span<GradientPair> d_gpair = gpair_.GetSpan();
     common::Span<Entry> d_col = data_.GetSpan().subspan(row_ptr_[fidx]);
@@ -154,6 +233,7 @@ class GPUCoordinateUpdater : public LinearUpdater {
   void Init(
       const std::vector<std::pair<std::string, std::string>> &args) override {
     tparam_.InitAllowUnknown(args);
+    gpu_param_.InitAllowUnknown(args);
     selector.reset(FeatureSelector::Create(tparam_.feature_selector));
     monitor.Init("GPUCoordinateUpdater");
   }
@@ -217,14 +297,27 @@ class GPUCoordinateUpdater : public LinearUpdater {
                     tparam_.reg_alpha_denorm, tparam_.reg_lambda_denorm,
                     coord_param_.top_k);
     monitor.Start("UpdateFeature");
+    auto batch_size = static_cast<size_t>(gpu_param_.feature_batch_size);
     for (auto group_idx = 0; group_idx < model->param.num_output_group;
          ++group_idx) {
-      for (auto i = 0U; i < model->param.num_feature; i++) {
-        auto fidx = selector->NextFeature(
-            i, *model, group_idx, in_gpair->ConstHostVector(), p_fmat,
-            tparam_.reg_alpha_denorm, tparam_.reg_lambda_denorm);
-        if (fidx < 0) break;
-        this->UpdateFeature(fidx, group_idx, &in_gpair->HostVector(), model);
+      bool exhausted = false;
+      for (auto i = 0U; i < model->param.num_feature && !exhausted;) {
+        // schedule up to feature_batch_size features per synchronization
+        std::vector<int> batch;
+        while (batch.size() < batch_size && i < model->param.num_feature) {
+          auto fidx = selector->NextFeature(
+              i, *model, group_idx, in_gpair->ConstHostVector(), p_fmat,
+              tparam_.reg_alpha_denorm, tparam_.reg_lambda_denorm);
+          ++i;
+          if (fidx < 0) {
+            exhausted = true;
+            break;
+          }
+          batch.push_back(fidx);
+        }
+        if (!batch.empty()) {
+          this->UpdateFeatures(batch, group_idx, model);
+        }
       }
     }
     monitor.Stop("UpdateFeature");
@@ -260,36 +353,48 @@ class GPUCoordinateUpdater : public LinearUpdater {
     }
   }
 
-  void UpdateFeature(int fidx, int group_idx,
-                     std::vector<GradientPair> *in_gpair,
-                     gbm::GBLinearModel *model) {
-    bst_float &w = (*model)[fidx][group_idx];
-    // Get gradient
-    auto grad = dh::ReduceShards<GradientPair>(
-        &shards, [&](std::unique_ptr<DeviceShard> &shard) {
-          if (!shard->IsEmpty()) {
-            return shard->GetGradient(group_idx, model->param.num_output_group,
-                                      fidx);
-          }
-          return GradientPair(0, 0);
-        });
-
-    auto dw = static_cast<float>(tparam_.learning_rate *
-                                 CoordinateDelta(grad.GetGrad(), grad.GetHess(),
-                                                 w, tparam_.reg_alpha_denorm,
-                                                 tparam_.reg_lambda_denorm));
-    w += dw;
-
+  void UpdateFeatures(const std::vector<int> &batch, int group_idx,
+                      gbm::GBLinearModel *model) {
+    // Get gradients for the whole batch, with one synchronization per shard
+    // instead of one per feature. With a batch larger than one, the deltas
+    // below are computed from the residual at the start of the batch.
+    std::vector<std::vector<GradientPair>> partial_sums(shards.size());
     dh::ExecuteIndexShards(&shards, [&](int idx,
                                         std::unique_ptr<DeviceShard> &shard) {
       if (!shard->IsEmpty()) {
-        shard->UpdateResidual(dw, group_idx, model->param.num_output_group, fidx);
+        partial_sums[idx] = shard->GetGradientBatch(
+            group_idx, model->param.num_output_group, batch);
+      } else {
+        partial_sums[idx].resize(batch.size());
       }
     });
+    for (size_t i = 0; i < batch.size(); ++i) {
+      int fidx = batch[i];
+      GradientPair grad;
+      for (const auto &partial_sum : partial_sums) {
+        grad += partial_sum[i];
+      }
+      bst_float &w = (*model)[fidx][group_idx];
+      auto dw = static_cast<float>(
+          tparam_.learning_rate *
+          CoordinateDelta(grad.GetGrad(), grad.GetHess(), w,
+                          tparam_.reg_alpha_denorm, tparam_.reg_lambda_denorm));
+      w += dw;
+      if (dw == 0.0f) continue;
+      // residual updates are asynchronous kernel launches
+      dh::ExecuteIndexShards(&shards, [&](int idx,
+                                          std::unique_ptr<DeviceShard> &shard) {
+        if (!shard->IsEmpty()) {
+          shard->UpdateResidual(dw, group_idx, model->param.num_output_group,
+                                fidx);
+        }
+      });
+    }
   }
 
   // training parameter
   LinearTrainParam tparam_;
+  GPUCoordinateTrainParam gpu_param_;
   CoordinateParam coord_param_;
   GPUDistribution dist_;
   std::unique_ptr<FeatureSelector> selector;
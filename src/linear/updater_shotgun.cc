@@ -39,11 +39,21 @@ class ShotgunUpdater : public LinearUpdater {
       UpdateBiasResidualParallel(gid, ngroup, dbias, &in_gpair->HostVector(), p_fmat);
     }
 
-    // lock-free parallel updates of weights
+    // lock-free parallel updates of weights. GradientPairInternal is a
+    // standard-layout {grad, hess} float pair, so the gradient of row i,
+    // group gid lives at 2 * (i * ngroup + gid) of the float view; the
+    // residual accumulation goes through omp atomic on that slot instead
+    // of a plain read-modify-write, which lost updates whenever two
+    // correlated features touched the same rows concurrently.
+    static_assert(sizeof(GradientPair) == 2 * sizeof(bst_float),
+                  "residual accumulation relies on the {grad, hess} layout");
+    auto* residual = reinterpret_cast<bst_float*>(gpair.data());
     selector_->Setup(*model, in_gpair->ConstHostVector(), p_fmat,
                      param_.reg_alpha_denorm, param_.reg_lambda_denorm, 0);
     for (const auto &batch : p_fmat->GetColumnBatches()) {
       const auto nfeat = static_cast<bst_omp_uint>(batch.Size());
+      // materialize the SoA mirror before entering the parallel region
+      batch.Values();
 #pragma omp parallel for schedule(static)
       for (bst_omp_uint i = 0; i < nfeat; ++i) {
         int ii = selector_->NextFeature
@@ -51,13 +61,15 @@ class ShotgunUpdater : public LinearUpdater {
            param_.reg_lambda_denorm);
         if (ii < 0) continue;
         const bst_uint fid = ii;
-        auto col = batch[ii];
+        auto col_value = batch.RowValues(ii);
+        auto col_index = batch.RowIndices(ii);
+        const auto ndata = static_cast<size_t>(col_value.size());
         for (int gid = 0; gid < ngroup; ++gid) {
           double sum_grad = 0.0, sum_hess = 0.0;
-          for (auto& c : col) {
-            const GradientPair &p = gpair[c.index * ngroup + gid];
+          for (size_t j = 0; j < ndata; ++j) {
+            const GradientPair &p = gpair[col_index[j] * ngroup + gid];
             if (p.GetHess() < 0.0f) continue;
-            const bst_float v = c.fvalue;
+            const bst_float v = col_value[j];
             sum_grad += p.GetGrad() * v;
             sum_hess += p.GetHess() * v * v;
           }
@@ -68,11 +80,14 @@ class ShotgunUpdater : public LinearUpdater {
                               param_.reg_lambda_denorm));
           if (dw == 0.f) continue;
           w += dw;
-          // update grad values
-          for (auto& c : col) {
-            GradientPair &p = gpair[c.index * ngroup + gid];
+          // update grad values; the hessian is never written during the
+          // sweep, so only the gradient slot needs the atomic
+          for (size_t j = 0; j < ndata; ++j) {
+            const GradientPair &p = gpair[col_index[j] * ngroup + gid];
             if (p.GetHess() < 0.0f) continue;
-            p += GradientPair(p.GetHess() * c.fvalue * dw, 0);
+            const bst_float delta = p.GetHess() * col_value[j] * dw;
+#pragma omp atomic
+            residual[2 * (col_index[j] * ngroup + gid)] += delta;
           }
         }
       }
@@ -52,20 +52,34 @@ class MetricsReduction {
       const HostDeviceVector<bst_float>& weights,
       const HostDeviceVector<bst_float>& labels,
       const HostDeviceVector<bst_float>& preds) const {
-    size_t ndata = labels.Size();
-
-    const auto& h_labels = labels.HostVector();
-    const auto& h_weights = weights.HostVector();
-    const auto& h_preds = preds.HostVector();
-
-    bst_float residue_sum = 0;
-    bst_float weights_sum = 0;
-
+    const auto ndata = static_cast<omp_ulong>(labels.Size());
+
+    const bst_float* __restrict__ h_labels = labels.HostVector().data();
+    const bst_float* __restrict__ h_preds = preds.HostVector().data();
+    const bst_float* __restrict__ h_weights =
+        weights.Size() > 0 ? weights.HostVector().data() : nullptr;
+
+    double residue_sum = 0;
+    double weights_sum = 0;
+    // local copy so the policy state stays in registers inside the loop
+    const EvalRow policy = policy_;
+
+    if (h_weights == nullptr) {
+      // unweighted case: a plain loop over two contiguous arrays, which
+      // vectorizes for branch-free EvalRow policies; the omp reduction
+      // gives each thread its own partial sum
+#pragma omp parallel for reduction(+: residue_sum) schedule(static)
+      for (omp_ulong i = 0; i < ndata; ++i) {
+        residue_sum += policy.EvalRow(h_labels[i], h_preds[i]);
+      }
+      weights_sum = static_cast<double>(ndata);
+    } else {
 #pragma omp parallel for reduction(+: residue_sum, weights_sum) schedule(static)
-    for (omp_ulong i = 0; i < ndata; ++i) {
-      const bst_float wt = h_weights.size() > 0 ? h_weights[i] : 1.0f;
-      residue_sum += policy_.EvalRow(h_labels[i], h_preds[i]) * wt;
-      weights_sum += wt;
+      for (omp_ulong i = 0; i < ndata; ++i) {
+        const bst_float wt = h_weights[i];
+        residue_sum += policy.EvalRow(h_labels[i], h_preds[i]) * wt;
+        weights_sum += wt;
+      }
     }
     PackedReduceResult res { residue_sum, weights_sum };
     return res;
@@ -189,14 +203,10 @@ struct EvalRowLogLoss {
 
   XGBOOST_DEVICE bst_float EvalRow(bst_float y, bst_float py) const {
     const bst_float eps = 1e-16f;
-    const bst_float pneg = 1.0f - py;
-    if (py < eps) {
-      return -y * std::log(eps) - (1.0f - y)  * std::log(1.0f - eps);
-    } else if (pneg < eps) {
-      return -y * std::log(1.0f - eps) - (1.0f - y)  * std::log(eps);
-    } else {
-      return -y * std::log(py) - (1.0f - y) * std::log(pneg);
-    }
+    // clamping into [eps, 1 - eps] is equivalent to the old three-way
+    // branch and keeps the reduction loop branch-free
+    const bst_float p = fminf(fmaxf(py, eps), 1.0f - eps);
+    return -y * std::log(p) - (1.0f - y) * std::log(1.0f - p);
   }
 
   static bst_float GetFinal(bst_float esum, bst_float wsum) {
@@ -250,7 +260,7 @@ struct EvalPoissonNegLogLik {
 
   XGBOOST_DEVICE bst_float EvalRow(bst_float y, bst_float py) const {
     const bst_float eps = 1e-16f;
-    if (py < eps) py = eps;
+    py = fmaxf(py, eps);
     return common::LogGamma(y + 1.0f) + py - std::log(py) * y;
   }
 
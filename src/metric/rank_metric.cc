@@ -9,6 +9,7 @@
 #include <dmlc/registry.h>
 #include <cmath>
 
+#include <map>
 #include <vector>
 
 #include "../common/host_device_vector.h"
@@ -104,42 +105,106 @@ struct EvalAuc : public Metric {
     // sum statistics
     bst_float sum_auc = 0.0f;
     int auc_error = 0;
-    // each thread takes a local rec
-    std::vector< std::pair<bst_float, unsigned> > rec;
     const auto& labels = info.labels_.HostVector();
     const std::vector<bst_float>& h_preds = preds.HostVector();
-    for (bst_omp_uint k = 0; k < ngroup; ++k) {
-      rec.clear();
-      for (unsigned j = gptr[k]; j < gptr[k + 1]; ++j) {
-        rec.emplace_back(h_preds[j], j);
+    if (ngroup == 1) {
+      // ungrouped case: parallel sort plus a chunked rank-sum reduction,
+      // so a single huge group does not serialize on one thread
+      const size_t ndata = info.labels_.Size();
+      std::vector< std::pair<bst_float, unsigned> > rec(ndata);
+      #pragma omp parallel for schedule(static)
+      for (bst_omp_uint j = 0; j < static_cast<bst_omp_uint>(ndata); ++j) {
+        rec[j] = std::make_pair(h_preds[j], static_cast<unsigned>(j));
       }
       XGBOOST_PARALLEL_SORT(rec.begin(), rec.end(), common::CmpFirst);
-      // calculate AUC
-      double sum_pospair = 0.0;
-      double sum_npos = 0.0, sum_nneg = 0.0, buf_pos = 0.0, buf_neg = 0.0;
-      for (size_t j = 0; j < rec.size(); ++j) {
-        const bst_float wt = info.GetWeight(rec[j].second);
-        const bst_float ctr = labels[rec[j].second];
-        // keep bucketing predictions in same bucket
-        if (j != 0 && rec[j].first != rec[j - 1].first) {
-          sum_pospair += buf_neg * (sum_npos + buf_pos *0.5);
-          sum_npos += buf_pos;
-          sum_nneg += buf_neg;
-          buf_neg = buf_pos = 0.0f;
+      // chunk boundaries shifted forward onto prediction-tie boundaries
+      // so no bucket straddles two chunks
+      const int nthread = omp_get_max_threads();
+      std::vector<size_t> chunk(nthread + 1, ndata);
+      chunk[0] = 0;
+      for (int t = 1; t < nthread; ++t) {
+        size_t b = ndata * t / nthread;
+        while (b > 0 && b < ndata && rec[b].first == rec[b - 1].first) ++b;
+        chunk[t] = b;
+      }
+      std::vector<double> chunk_pair(nthread, 0.0);
+      std::vector<double> chunk_pos(nthread, 0.0);
+      std::vector<double> chunk_neg(nthread, 0.0);
+      #pragma omp parallel for schedule(static, 1)
+      for (int t = 0; t < nthread; ++t) {
+        double pospair = 0.0, npos = 0.0, nneg = 0.0;
+        double buf_pos = 0.0, buf_neg = 0.0;
+        for (size_t j = chunk[t]; j < chunk[t + 1]; ++j) {
+          const bst_float wt = info.GetWeight(rec[j].second);
+          const bst_float ctr = labels[rec[j].second];
+          // keep bucketing predictions in same bucket
+          if (j != chunk[t] && rec[j].first != rec[j - 1].first) {
+            pospair += buf_neg * (npos + buf_pos * 0.5);
+            npos += buf_pos;
+            nneg += buf_neg;
+            buf_neg = buf_pos = 0.0f;
+          }
+          buf_pos += ctr * wt;
+          buf_neg += (1.0f - ctr) * wt;
         }
-        buf_pos += ctr * wt;
-        buf_neg += (1.0f - ctr) * wt;
+        pospair += buf_neg * (npos + buf_pos * 0.5);
+        chunk_pair[t] = pospair;
+        chunk_pos[t] = npos + buf_pos;
+        chunk_neg[t] = nneg + buf_neg;
+      }
+      // ordered combine: negatives of a chunk also lose to the positives
+      // of every earlier (higher prediction) chunk
+      double sum_pospair = 0.0, sum_npos = 0.0, sum_nneg = 0.0;
+      for (int t = 0; t < nthread; ++t) {
+        sum_pospair += chunk_pair[t] + chunk_neg[t] * sum_npos;
+        sum_npos += chunk_pos[t];
+        sum_nneg += chunk_neg[t];
       }
-      sum_pospair += buf_neg * (sum_npos + buf_pos *0.5);
-      sum_npos += buf_pos;
-      sum_nneg += buf_neg;
-      // check weird conditions
       if (sum_npos <= 0.0 || sum_nneg <= 0.0) {
         auc_error = 1;
-        continue;
+      } else {
+        sum_auc += sum_pospair / (sum_npos * sum_nneg);
+      }
+    } else {
+      #pragma omp parallel reduction(+:sum_auc) reduction(|:auc_error)
+      {
+        // each thread takes a local rec
+        std::vector< std::pair<bst_float, unsigned> > rec;
+        #pragma omp for schedule(static)
+        for (bst_omp_uint k = 0; k < ngroup; ++k) {
+          rec.clear();
+          for (unsigned j = gptr[k]; j < gptr[k + 1]; ++j) {
+            rec.emplace_back(h_preds[j], j);
+          }
+          std::sort(rec.begin(), rec.end(), common::CmpFirst);
+          // calculate AUC
+          double sum_pospair = 0.0;
+          double sum_npos = 0.0, sum_nneg = 0.0, buf_pos = 0.0, buf_neg = 0.0;
+          for (size_t j = 0; j < rec.size(); ++j) {
+            const bst_float wt = info.GetWeight(rec[j].second);
+            const bst_float ctr = labels[rec[j].second];
+            // keep bucketing predictions in same bucket
+            if (j != 0 && rec[j].first != rec[j - 1].first) {
+              sum_pospair += buf_neg * (sum_npos + buf_pos *0.5);
+              sum_npos += buf_pos;
+              sum_nneg += buf_neg;
+              buf_neg = buf_pos = 0.0f;
+            }
+            buf_pos += ctr * wt;
+            buf_neg += (1.0f - ctr) * wt;
+          }
+          sum_pospair += buf_neg * (sum_npos + buf_pos *0.5);
+          sum_npos += buf_pos;
+          sum_nneg += buf_neg;
+          // check weird conditions
+          if (sum_npos <= 0.0 || sum_nneg <= 0.0) {
+            auc_error = 1;
+            continue;
+          }
+          // this is the AUC
+          sum_auc += sum_pospair / (sum_npos*sum_nneg);
+        }
       }
-      // this is the AUC
-      sum_auc += sum_pospair / (sum_npos*sum_nneg);
     }
     CHECK(!auc_error)
       << "AUC: the dataset only contains pos or neg samples";
@@ -180,15 +245,30 @@ struct EvalRankList : public Metric {
     const auto& labels = info.labels_.HostVector();
 
     const std::vector<bst_float>& h_preds = preds.HostVector();
+    // between consecutive rounds most group orderings barely change, so
+    // keep the permutation of the previous round and repair it with an
+    // adaptive insertion pass instead of sorting from scratch
+    PermCache& cache = this->GetCache(&info, gptr);
 #pragma omp parallel reduction(+:sum_metric)
     {
       // each thread takes a local rec
       std::vector< std::pair<bst_float, unsigned> > rec;
+      std::vector< std::pair<bst_float, unsigned> > sorted;
       #pragma omp for schedule(static)
       for (bst_omp_uint k = 0; k < ngroup; ++k) {
-        rec.clear();
+        // (pred, row) in the previous round's order
+        sorted.clear();
         for (unsigned j = gptr[k]; j < gptr[k + 1]; ++j) {
-          rec.emplace_back(h_preds[j], static_cast<int>(labels[j]));
+          sorted.emplace_back(h_preds[cache.order[j]], cache.order[j]);
+        }
+        if (!InsertionRepair(&sorted)) {
+          std::sort(sorted.begin(), sorted.end(), common::CmpFirst);
+        }
+        rec.clear();
+        for (size_t i = 0; i < sorted.size(); ++i) {
+          cache.order[gptr[k] + i] = sorted[i].second;
+          rec.emplace_back(sorted[i].first,
+                           static_cast<int>(labels[sorted[i].second]));
         }
         sum_metric += this->EvalMetric(rec);
       }
@@ -227,13 +307,68 @@ struct EvalRankList : public Metric {
       topn_ = std::numeric_limits<unsigned>::max();
     }
   }
-  /*! \return evaluation metric, given the pair_sort record, (pred,label) */
+  /*!
+   * \return evaluation metric, given the pair_sort record, (pred,label),
+   *  already sorted by prediction in decreasing order
+   */
   virtual bst_float EvalMetric(std::vector<std::pair<bst_float, unsigned> > &pair_sort) const = 0; // NOLINT(*)
 
  protected:
   unsigned topn_;
   std::string name_;
   bool minus_;
+
+ private:
+  /*! \brief per-dataset permutation kept across evaluation rounds */
+  struct PermCache {
+    std::vector<unsigned> order;
+    std::vector<unsigned> gptr;
+  };
+
+  inline PermCache& GetCache(const MetaInfo* info,
+                             const std::vector<unsigned>& gptr) {
+    // evaluation normally touches a handful of datasets; guard against
+    // unbounded growth all the same
+    if (cache_.size() > 8) cache_.clear();
+    PermCache& c = cache_[info];
+    if (c.gptr != gptr) {
+      c.gptr = gptr;
+      c.order.resize(gptr.back());
+      for (unsigned j = 0; j < gptr.back(); ++j) {
+        c.order[j] = j;
+      }
+    }
+    return c;
+  }
+
+  /*!
+   * \brief repair a nearly decreasing list with insertion sort, which is
+   *  near-linear on nearly-sorted data. Bails out once the shift budget
+   *  is exhausted (leaving a valid permutation) so that heavily shuffled
+   *  rounds fall back to a full sort instead of going quadratic.
+   */
+  inline static bool InsertionRepair(
+      std::vector<std::pair<bst_float, unsigned> >* p_vec) {
+    std::vector<std::pair<bst_float, unsigned> >& vec = *p_vec;
+    size_t budget = vec.size() * 4 + 16;
+    for (size_t i = 1; i < vec.size(); ++i) {
+      if (!(vec[i - 1].first < vec[i].first)) continue;
+      const std::pair<bst_float, unsigned> v = vec[i];
+      size_t j = i;
+      while (j > 0 && vec[j - 1].first < v.first) {
+        vec[j] = vec[j - 1];
+        --j;
+        if (--budget == 0) {
+          vec[j] = v;
+          return false;
+        }
+      }
+      vec[j] = v;
+    }
+    return true;
+  }
+
+  std::map<const MetaInfo*, PermCache> cache_;
 };
 
 /*! \brief Precision at N, for both classification and rank */
@@ -243,8 +378,7 @@ struct EvalPrecision : public EvalRankList{
 
  protected:
   bst_float EvalMetric(std::vector< std::pair<bst_float, unsigned> > &rec) const override {
-    // calculate Precision
-    std::sort(rec.begin(), rec.end(), common::CmpFirst);
+    // calculate Precision; rec arrives sorted by prediction
     unsigned nhit = 0;
     for (size_t j = 0; j < rec.size() && j < this->topn_; ++j) {
       nhit += (rec[j].second != 0);
@@ -270,7 +404,7 @@ struct EvalNDCG : public EvalRankList{
     return sumdcg;
   }
   virtual bst_float EvalMetric(std::vector<std::pair<bst_float, unsigned> > &rec) const { // NOLINT(*)
-    XGBOOST_PARALLEL_STABLE_SORT(rec.begin(), rec.end(), common::CmpFirst);
+    // rec arrives sorted by prediction
     bst_float dcg = this->CalcDCG(rec);
     XGBOOST_PARALLEL_STABLE_SORT(rec.begin(), rec.end(), common::CmpSecond);
     bst_float idcg = this->CalcDCG(rec);
@@ -292,7 +426,7 @@ struct EvalMAP : public EvalRankList {
 
  protected:
   bst_float EvalMetric(std::vector< std::pair<bst_float, unsigned> > &rec) const override {
-    std::sort(rec.begin(), rec.end(), common::CmpFirst);
+    // rec arrives sorted by prediction
     unsigned nhits = 0;
     double sumap = 0.0;
     for (size_t i = 0; i < rec.size(); ++i) {
@@ -391,51 +525,135 @@ struct EvalAucPR : public Metric {
     const auto& h_labels = info.labels_.HostVector();
     const std::vector<bst_float>& h_preds = preds.HostVector();
 
-    for (bst_omp_uint k = 0; k < ngroup; ++k) {
-      double total_pos = 0.0;
-      double total_neg = 0.0;
-      rec.clear();
-      for (unsigned j = gptr[k]; j < gptr[k + 1]; ++j) {
+    if (ngroup == 1) {
+      // ungrouped case: parallel sort, then integrate the precision-recall
+      // curve in chunks. Each chunk starts at a prediction-tie boundary,
+      // so given its prefix tp/fp counts it integrates independently.
+      const size_t ndata = info.labels_.Size();
+      double total_pos = 0.0, total_neg = 0.0;
+      rec.resize(ndata);
+      #pragma omp parallel for schedule(static) reduction(+:total_pos, total_neg)
+      for (bst_omp_uint j = 0; j < static_cast<bst_omp_uint>(ndata); ++j) {
         total_pos += info.GetWeight(j) * h_labels[j];
         total_neg += info.GetWeight(j) * (1.0f - h_labels[j]);
-        rec.emplace_back(h_preds[j], j);
+        rec[j] = std::make_pair(h_preds[j], static_cast<unsigned>(j));
       }
       XGBOOST_PARALLEL_SORT(rec.begin(), rec.end(), common::CmpFirst);
       // we need pos > 0 && neg > 0
       if (0.0 == total_pos || 0.0 == total_neg) {
         auc_error = 1;
       }
-      // calculate AUC
-      double tp = 0.0, prevtp = 0.0, fp = 0.0, prevfp = 0.0, h = 0.0, a = 0.0, b = 0.0;
-      for (size_t j = 0; j < rec.size(); ++j) {
-        tp += info.GetWeight(rec[j].second) * h_labels[rec[j].second];
-        fp += info.GetWeight(rec[j].second) * (1.0f - h_labels[rec[j].second]);
-        if ((j < rec.size() - 1 && rec[j].first != rec[j + 1].first) || j  == rec.size() - 1) {
-          if (tp == prevtp) {
-            a = 1.0;
-            b = 0.0;
-          } else {
-            h = (fp - prevfp) / (tp - prevtp);
-            a = 1.0 + h;
-            b = (prevfp - h * prevtp) / total_pos;
-          }
-          if (0.0 != b) {
-            auc += (tp / total_pos - prevtp / total_pos -
-                    b / a * (std::log(a * tp / total_pos + b) -
-                             std::log(a * prevtp / total_pos + b))) / a;
-          } else {
-            auc += (tp / total_pos - prevtp / total_pos) / a;
-          }
-          if (auc > 1.0) {
-            auc_gt_one = 1;
+      const int nthread = omp_get_max_threads();
+      std::vector<size_t> chunk(nthread + 1, ndata);
+      chunk[0] = 0;
+      for (int t = 1; t < nthread; ++t) {
+        size_t b = ndata * t / nthread;
+        while (b > 0 && b < ndata && rec[b].first == rec[b - 1].first) ++b;
+        chunk[t] = b;
+      }
+      // pass 1: tp/fp totals per chunk, then prefix them so pass 2 knows
+      // the cumulative counts at each chunk entry
+      std::vector<double> start_tp(nthread + 1, 0.0);
+      std::vector<double> start_fp(nthread + 1, 0.0);
+      #pragma omp parallel for schedule(static, 1)
+      for (int t = 0; t < nthread; ++t) {
+        double tp = 0.0, fp = 0.0;
+        for (size_t j = chunk[t]; j < chunk[t + 1]; ++j) {
+          tp += info.GetWeight(rec[j].second) * h_labels[rec[j].second];
+          fp += info.GetWeight(rec[j].second) * (1.0f - h_labels[rec[j].second]);
+        }
+        start_tp[t + 1] = tp;
+        start_fp[t + 1] = fp;
+      }
+      for (int t = 0; t < nthread; ++t) {
+        start_tp[t + 1] += start_tp[t];
+        start_fp[t + 1] += start_fp[t];
+      }
+      // pass 2: integrate each chunk from its known starting point
+      std::vector<double> chunk_auc(nthread, 0.0);
+      #pragma omp parallel for schedule(static, 1)
+      for (int t = 0; t < nthread; ++t) {
+        double tp = start_tp[t], prevtp = start_tp[t];
+        double fp = start_fp[t], prevfp = start_fp[t];
+        double h = 0.0, a = 0.0, b = 0.0, local_auc = 0.0;
+        for (size_t j = chunk[t]; j < chunk[t + 1]; ++j) {
+          tp += info.GetWeight(rec[j].second) * h_labels[rec[j].second];
+          fp += info.GetWeight(rec[j].second) * (1.0f - h_labels[rec[j].second]);
+          if (j + 1 == chunk[t + 1] || rec[j].first != rec[j + 1].first) {
+            if (tp == prevtp) {
+              a = 1.0;
+              b = 0.0;
+            } else {
+              h = (fp - prevfp) / (tp - prevtp);
+              a = 1.0 + h;
+              b = (prevfp - h * prevtp) / total_pos;
+            }
+            if (0.0 != b) {
+              local_auc += (tp / total_pos - prevtp / total_pos -
+                            b / a * (std::log(a * tp / total_pos + b) -
+                                     std::log(a * prevtp / total_pos + b))) / a;
+            } else {
+              local_auc += (tp / total_pos - prevtp / total_pos) / a;
+            }
+            prevtp = tp;
+            prevfp = fp;
           }
-          prevtp = tp;
-          prevfp = fp;
         }
+        chunk_auc[t] = local_auc;
+      }
+      for (int t = 0; t < nthread; ++t) {
+        auc += chunk_auc[t];
+      }
+      if (auc > 1.0) {
+        auc_gt_one = 1;
       }
-      // sanity check
-      if (tp < 0 || prevtp < 0 || fp < 0 || prevfp < 0) {
-        CHECK(!auc_error) << "AUC-PR: error in calculation";
+    } else {
+      for (bst_omp_uint k = 0; k < ngroup; ++k) {
+        double total_pos = 0.0;
+        double total_neg = 0.0;
+        rec.clear();
+        for (unsigned j = gptr[k]; j < gptr[k + 1]; ++j) {
+          total_pos += info.GetWeight(j) * h_labels[j];
+          total_neg += info.GetWeight(j) * (1.0f - h_labels[j]);
+          rec.emplace_back(h_preds[j], j);
+        }
+        XGBOOST_PARALLEL_SORT(rec.begin(), rec.end(), common::CmpFirst);
+        // we need pos > 0 && neg > 0
+        if (0.0 == total_pos || 0.0 == total_neg) {
+          auc_error = 1;
+        }
+        // calculate AUC
+        double tp = 0.0, prevtp = 0.0, fp = 0.0, prevfp = 0.0, h = 0.0, a = 0.0, b = 0.0;
+        for (size_t j = 0; j < rec.size(); ++j) {
+          tp += info.GetWeight(rec[j].second) * h_labels[rec[j].second];
+          fp += info.GetWeight(rec[j].second) * (1.0f - h_labels[rec[j].second]);
+          if ((j < rec.size() - 1 && rec[j].first != rec[j + 1].first) || j  == rec.size() - 1) {
+            if (tp == prevtp) {
+              a = 1.0;
+              b = 0.0;
+            } else {
+              h = (fp - prevfp) / (tp - prevtp);
+              a = 1.0 + h;
+              b = (prevfp - h * prevtp) / total_pos;
+            }
+            if (0.0 != b) {
+              auc += (tp / total_pos - prevtp / total_pos -
+                      b / a * (std::log(a * tp / total_pos + b) -
+                               std::log(a * prevtp / total_pos + b))) / a;
+            } else {
+              auc += (tp / total_pos - prevtp / total_pos) / a;
+            }
+            if (auc > 1.0) {
+              auc_gt_one = 1;
+            }
+            prevtp = tp;
+            prevfp = fp;
+          }
+        }
+        // sanity check
+        if (tp < 0 || prevtp < 0 || fp < 0 || prevfp < 0) {
+          CHECK(!auc_error) << "AUC-PR: error in calculation";
+        }
       }
     }
     CHECK(!auc_error) << "AUC-PR: the dataset only contains pos or neg samples";
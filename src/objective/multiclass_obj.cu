@@ -73,6 +73,11 @@ class SoftmaxMultiClassObj : public ObjFunction {
     label_correct_.Fill(1);
 
     const bool is_null_weight = info.weights_.Size() == 0;
+    // on CPU, write gradients class-major so per-class tree builds read
+    // contiguous blocks; the GPU path keeps the row-granular interleaving
+    // its sharding is built around
+    const bool class_major = this->ClassMajorGradient();
+    const auto nrow = static_cast<size_t>(ndata);
     common::Transform<>::Init(
         [=] XGBOOST_DEVICE(size_t idx,
                            common::Span<GradientPair> gpair,
@@ -86,7 +91,7 @@ class SoftmaxMultiClassObj : public ObjFunction {
           bst_float wmax = std::numeric_limits<bst_float>::min();
           for (auto const i : point) { wmax = fmaxf(i, wmax); }
           double wsum = 0.0f;
-          for (auto const i : point) { wsum += expf(i - wmax); }
+          for (auto const i : point) { wsum += common::ExpFast(i - wmax); }
           auto label = labels[idx];
           if (label < 0 || label >= nclass) {
             _label_correct[0] = 0;
@@ -95,11 +100,12 @@ class SoftmaxMultiClassObj : public ObjFunction {
           bst_float wt = is_null_weight ? 1.0f : weights[idx];
           for (int k = 0; k < nclass; ++k) {
             // Computation duplicated to avoid creating a cache.
-            bst_float p = expf(point[k] - wmax) / static_cast<float>(wsum);
+            bst_float p = common::ExpFast(point[k] - wmax) / static_cast<float>(wsum);
             const float eps = 1e-16f;
             const bst_float h = fmax(2.0f * p * (1.0f - p) * wt, eps);
             p = label == k ? p - 1.0f : p;
-            gpair[idx * nclass + k] = GradientPair(p * wt, h);
+            const size_t gidx = class_major ? k * nrow + idx : idx * nclass + k;
+            gpair[gidx] = GradientPair(p * wt, h);
           }
         }, common::Range{0, ndata}, devices_, false)
         .Eval(out_gpair, &info.labels_, &preds, &info.weights_, &label_correct_);
@@ -121,6 +127,16 @@ class SoftmaxMultiClassObj : public ObjFunction {
     return "merror";
   }
 
+  bool ClassMajorGradient() const override {
+    // class-major writes are incompatible with the row-granular GPU
+    // sharding of the gradient vector
+    return class_major_hint_ && devices_.IsEmpty();
+  }
+
+  void SetClassMajorGradient(bool enable) override {
+    class_major_hint_ = enable;
+  }
+
   inline void Transform(HostDeviceVector<bst_float> *io_preds, bool prob) {
     const int nclass = param_.num_class;
     const auto ndata = static_cast<int64_t>(io_preds->Size() / nclass);
@@ -131,7 +147,9 @@ class SoftmaxMultiClassObj : public ObjFunction {
           [=] XGBOOST_DEVICE(size_t _idx, common::Span<bst_float> _preds) {
             common::Span<bst_float> point =
                 _preds.subspan(_idx * nclass, nclass);
-            common::Softmax(point.begin(), point.end());
+            // ExpFast keeps the error below float roundoff noise while the
+            // contiguous loops vectorize, unlike the libm-based Softmax
+            common::SoftmaxFast(point.data(), point.data() + point.size());
           },
           common::Range{0, ndata}, GPUDistribution::Granular(devices_, nclass))
         .Eval(io_preds);
@@ -160,6 +178,8 @@ class SoftmaxMultiClassObj : public ObjFunction {
  private:
   // output probability
   bool output_prob_;
+  // booster asked for class-major gradients
+  bool class_major_hint_{false};
   // parameter
   SoftmaxMultiClassParam param_;
   GPUSet devices_;
@@ -0,0 +1,536 @@
+/*!
+ * Copyright 2015 by Contributors
+ * \file rank.cc
+ * \brief Definition of rank loss.
+ * \author Tianqi Chen, Kailong Chen
+ */
+#include <dmlc/omp.h>
+#include <xgboost/logging.h>
+#include <xgboost/objective.h>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include "../common/math.h"
+#include "../common/random.h"
+#include "../common/common.h"
+#include "../common/host_device_vector.h"
+
+#if defined(__CUDACC__)
+#include <thrust/device_vector.h>
+#include "../common/device_helpers.cuh"
+#endif
+
+namespace xgboost {
+namespace obj {
+
+#if defined(XGBOOST_USE_CUDA)
+DMLC_REGISTRY_FILE_TAG(rank_obj_gpu);
+#endif
+
+struct LambdaRankParam : public dmlc::Parameter<LambdaRankParam> {
+  int num_pairsample;
+  float fix_list_weight;
+  int n_gpus;
+  int gpu_id;
+  // declare parameters
+  DMLC_DECLARE_PARAMETER(LambdaRankParam) {
+    DMLC_DECLARE_FIELD(num_pairsample).set_lower_bound(1).set_default(1)
+        .describe("Number of pair generated for each instance.");
+    DMLC_DECLARE_FIELD(fix_list_weight).set_lower_bound(0.0f).set_default(0.0f)
+        .describe("Normalize the weight of each list by this value,"
+                  " if equals 0, no effect will happen");
+    DMLC_DECLARE_FIELD(n_gpus).set_default(1).set_lower_bound(GPUSet::kAll)
+        .describe("Number of GPUs to use for multi-gpu algorithms.");
+    DMLC_DECLARE_FIELD(gpu_id)
+        .set_lower_bound(0)
+        .set_default(0)
+        .describe("gpu to use for objective function evaluation");
+  }
+};
+
+// objective for lambda rank
+class LambdaRankObj : public ObjFunction {
+ public:
+  void Configure(const std::vector<std::pair<std::string, std::string> >& args) override {
+    param_.InitAllowUnknown(args);
+    devices_ = GPUSet::All(param_.gpu_id, param_.n_gpus);
+    // pairs reach across arbitrary rows of a group, so the device path
+    // keeps the whole prediction and gradient vectors on a single GPU
+    if (devices_.Size() > 1) {
+      devices_ = GPUSet::Range(param_.gpu_id, 1);
+    }
+  }
+
+  void GetGradient(const HostDeviceVector<bst_float>& preds,
+                   const MetaInfo& info,
+                   int iter,
+                   HostDeviceVector<GradientPair>* out_gpair) override {
+    CHECK_EQ(preds.Size(), info.labels_.Size()) << "label size predict size not match";
+    out_gpair->Resize(preds.Size());
+    // quick consistency when group is not available
+    std::vector<unsigned> tgptr(2, 0); tgptr[1] = static_cast<unsigned>(info.labels_.Size());
+    const std::vector<unsigned> &gptr = info.group_ptr_.size() == 0 ? tgptr : info.group_ptr_;
+    CHECK(gptr.size() != 0 && gptr.back() == info.labels_.Size())
+        << "group structure not consistent with #rows";
+
+#if defined(__CUDACC__)
+    if (!devices_.IsEmpty() && this->SupportsDeviceGradient()) {
+      this->GetGradientDevice(preds, info, iter, gptr, out_gpair);
+      return;
+    }
+#endif
+
+    const auto& preds_h = preds.HostVector();
+    std::vector<GradientPair>& gpair = out_gpair->HostVector();
+    const auto ngroup = static_cast<bst_omp_uint>(gptr.size() - 1);
+    const auto& labels = info.labels_.HostVector();
+    // equal-label buckets are a property of the dataset, not the
+    // iteration; build them once and reuse across iterations
+    this->InitBuckets(labels, gptr);
+    #pragma omp parallel
+    {
+      // parall construct, declare random number generator here, so that each
+      // thread use its own random number generator, seed by thread id and current iteration
+      common::RandomEngine rnd(iter * 1111 + omp_get_thread_num());
+
+      std::vector<LambdaPair> pairs;
+      std::vector<ListEntry>  lst;
+      std::vector<unsigned> pos_of_row;
+      bst_float sum_weights = 0;
+      for (bst_omp_uint k = 0; k < ngroup; ++k) {
+        sum_weights += info.GetWeight(k);
+      }
+      bst_float weight_normalization_factor = ngroup/sum_weights;
+      #pragma omp for schedule(static)
+      for (bst_omp_uint k = 0; k < ngroup; ++k) {
+        lst.clear(); pairs.clear();
+        for (unsigned j = gptr[k]; j < gptr[k+1]; ++j) {
+          lst.emplace_back(preds_h[j], labels[j], j);
+          gpair[j] = GradientPair(0.0f, 0.0f);
+        }
+        std::sort(lst.begin(), lst.end(), ListEntry::CmpPred);
+        // map each row back to its position in the prediction-sorted list
+        pos_of_row.resize(lst.size());
+        for (unsigned i = 0; i < lst.size(); ++i) {
+          pos_of_row[lst[i].rindex - gptr[k]] = i;
+        }
+        // stratified sampling over the precomputed label buckets: for each
+        // item, grab another sample with a different label uniformly
+        const unsigned nitems = gptr[k + 1] - gptr[k];
+        const bst_float pweight = info.GetWeight(k) * weight_normalization_factor;
+        for (size_t b = buckets_.group_ptr[k]; b + 1 < buckets_.group_ptr[k + 1]; ++b) {
+          const size_t ibeg = buckets_.bucket_ptr[b];
+          const size_t iend = buckets_.bucket_ptr[b + 1];
+          // bucket [ibeg,iend) in label order, get a sample outside bucket
+          const auto nleft = static_cast<unsigned>(ibeg - gptr[k]);
+          const unsigned nright = nitems - static_cast<unsigned>(iend - gptr[k]);
+          if (nleft + nright != 0) {
+            const auto bsize = static_cast<unsigned>(iend - ibeg);
+            int nsample = param_.num_pairsample;
+            while (nsample --) {
+              for (size_t p = ibeg; p < iend; ++p) {
+                const unsigned pid = pos_of_row[buckets_.order[p] - gptr[k]];
+                unsigned ridx = std::uniform_int_distribution<unsigned>(0, nleft + nright - 1)(rnd);
+                if (ridx >= nleft) ridx += bsize;  // skip past own bucket
+                const unsigned oid = pos_of_row[buckets_.order[gptr[k] + ridx] - gptr[k]];
+                if (ridx < nleft) {
+                  pairs.emplace_back(oid, pid, pweight);
+                } else {
+                  pairs.emplace_back(pid, oid, pweight);
+                }
+              }
+            }
+          }
+        }
+        // get lambda weight for the pairs
+        this->GetLambdaWeight(lst, &pairs);
+        // rescale each gradient and hessian so that the lst have constant weighted
+        float scale = 1.0f / param_.num_pairsample;
+        if (param_.fix_list_weight != 0.0f) {
+          scale *= param_.fix_list_weight / (gptr[k + 1] - gptr[k]);
+        }
+        for (auto & pair : pairs) {
+          const ListEntry &pos = lst[pair.pos_index];
+          const ListEntry &neg = lst[pair.neg_index];
+          const bst_float w = pair.weight * scale;
+          const float eps = 1e-16f;
+          bst_float p = common::Sigmoid(pos.pred - neg.pred);
+          bst_float g = p - 1.0f;
+          bst_float h = std::max(p * (1.0f - p), eps);
+          // accumulate gradient and hessian in both pid, and nid
+          gpair[pos.rindex] += GradientPair(g * w, 2.0f*w*h);
+          gpair[neg.rindex] += GradientPair(-g * w, 2.0f*w*h);
+        }
+      }
+    }
+  }
+  const char* DefaultEvalMetric() const override {
+    return "map";
+  }
+
+ protected:
+  /*! \brief helper information in a list */
+  struct ListEntry {
+    /*! \brief the predict score we in the data */
+    bst_float pred;
+    /*! \brief the actual label of the entry */
+    bst_float label;
+    /*! \brief row index in the data matrix */
+    unsigned rindex;
+    // constructor
+    ListEntry(bst_float pred, bst_float label, unsigned rindex)
+        : pred(pred), label(label), rindex(rindex) {}
+    // comparator by prediction
+    inline static bool CmpPred(const ListEntry &a, const ListEntry &b) {
+      return a.pred > b.pred;
+    }
+    // comparator by label
+    inline static bool CmpLabel(const ListEntry &a, const ListEntry &b) {
+      return a.label > b.label;
+    }
+  };
+  /*! \brief a pair in the lambda rank */
+  struct LambdaPair {
+    /*! \brief positive index: this is a position in the list */
+    unsigned pos_index;
+    /*! \brief negative index: this is a position in the list */
+    unsigned neg_index;
+    /*! \brief weight to be filled in */
+    bst_float weight;
+    // constructor
+    LambdaPair(unsigned pos_index, unsigned neg_index)
+        : pos_index(pos_index), neg_index(neg_index), weight(1.0f) {}
+    // constructor
+    LambdaPair(unsigned pos_index, unsigned neg_index, bst_float weight)
+        : pos_index(pos_index), neg_index(neg_index), weight(weight) {}
+  };
+  /*!
+   * \brief get lambda weight for existing pairs
+   * \param list a list that is sorted by pred score
+   * \param io_pairs record of pairs, containing the pairs to fill in weights
+   */
+  virtual void GetLambdaWeight(const std::vector<ListEntry> &sorted_list,
+                               std::vector<LambdaPair> *io_pairs) = 0;
+  /*!
+   * \brief whether GetGradient may run on the device. Only the pairwise
+   *  objective qualifies: its pair weight is constant, while the
+   *  NDCG/MAP deltas need positions in the prediction-sorted list and
+   *  stay on the CPU path.
+   */
+  virtual bool SupportsDeviceGradient() const { return false; }
+
+  // devices selected through gpu_id/n_gpus, clamped to one device
+  GPUSet devices_ = GPUSet::Empty();
+
+#if defined(__CUDACC__)
+  /*!
+   * \brief device counterpart of the CPU gradient loop, one thread per
+   *  (row, sample). Each thread draws a partner with a different label
+   *  from the row's group by rejection sampling, which matches the
+   *  uniform different-label draw of the CPU sampler except for the
+   *  bounded number of trials, and accumulates the lambda gradient into
+   *  both pair endpoints with atomics. Gradients stay in the device
+   *  buffer consumed by the GPU tree builders.
+   */
+  void GetGradientDevice(const HostDeviceVector<bst_float>& preds,
+                         const MetaInfo& info,
+                         int iter,
+                         const std::vector<unsigned>& gptr,
+                         HostDeviceVector<GradientPair>* out_gpair) {
+    const int device = devices_.DeviceId(0);
+    dh::safe_cuda(cudaSetDevice(device));
+    const size_t ndata = preds.Size();
+    const size_t ngroup = gptr.size() - 1;
+
+    // fold the group weight, the weight normalization and the CPU
+    // path's 1/num_pairsample rescale into one per-group pair weight
+    bst_float sum_weights = 0;
+    for (size_t k = 0; k < ngroup; ++k) {
+      sum_weights += info.GetWeight(k);
+    }
+    const bst_float weight_normalization_factor = ngroup / sum_weights;
+    std::vector<bst_float> pair_weight(ngroup);
+    for (size_t k = 0; k < ngroup; ++k) {
+      bst_float scale = 1.0f / param_.num_pairsample;
+      if (param_.fix_list_weight != 0.0f) {
+        scale *= param_.fix_list_weight / (gptr[k + 1] - gptr[k]);
+      }
+      pair_weight[k] = info.GetWeight(k) * weight_normalization_factor * scale;
+    }
+    group_ptr_d_ = gptr;
+    pair_weight_d_ = pair_weight;
+
+    const GPUSet single = GPUSet::Range(device, 1);
+    preds.Reshard(single);
+    info.labels_.Reshard(single);
+    out_gpair->Reshard(single);
+    out_gpair->Fill(GradientPair(0.0f, 0.0f));
+
+    const bst_float* s_preds = preds.ConstDevicePointer(device);
+    const bst_float* s_labels = info.labels_.ConstDevicePointer(device);
+    GradientPair* s_gpair = out_gpair->DevicePointer(device);
+    const unsigned* s_gptr = group_ptr_d_.data().get();
+    const bst_float* s_pweight = pair_weight_d_.data().get();
+    const auto seed = static_cast<uint32_t>(iter) * 1111u;
+    const auto nsample = static_cast<size_t>(param_.num_pairsample);
+
+    dh::LaunchN(device, ndata * nsample, [=] __device__(size_t idx) {
+      const size_t i = idx % ndata;
+      // locate the group of row i
+      size_t lo = 0, hi = ngroup;
+      while (hi - lo > 1) {
+        const size_t mid = (lo + hi) / 2;
+        if (s_gptr[mid] <= i) { lo = mid; } else { hi = mid; }
+      }
+      const unsigned beg = s_gptr[lo];
+      const unsigned end = s_gptr[lo + 1];
+      const unsigned gsize = end - beg;
+      if (gsize < 2) { return; }
+      // hash-seeded LCG, decorrelated across threads and iterations
+      uint32_t rng = seed + static_cast<uint32_t>(idx) * 2654435761u;
+      const bst_float label_i = s_labels[i];
+      unsigned j = 0;
+      bool found = false;
+      for (int trial = 0; trial < 16; ++trial) {
+        rng = rng * 1664525u + 1013904223u;
+        j = beg + (rng >> 8) % gsize;
+        if (s_labels[j] != label_i) { found = true; break; }
+      }
+      if (!found) { return; }
+      const size_t pos = s_labels[j] > label_i ? j : i;
+      const size_t neg = s_labels[j] > label_i ? i : j;
+      const bst_float w = s_pweight[lo];
+      const float eps = 1e-16f;
+      const bst_float p = common::Sigmoid(s_preds[pos] - s_preds[neg]);
+      const bst_float g = p - 1.0f;
+      const bst_float h = fmaxf(p * (1.0f - p), eps);
+      auto* pos_ptr = reinterpret_cast<bst_float*>(&s_gpair[pos]);
+      auto* neg_ptr = reinterpret_cast<bst_float*>(&s_gpair[neg]);
+      atomicAdd(pos_ptr, g * w);
+      atomicAdd(pos_ptr + 1, 2.0f * w * h);
+      atomicAdd(neg_ptr, -g * w);
+      atomicAdd(neg_ptr + 1, 2.0f * w * h);
+    });
+  }
+#endif
+
+ private:
+  /*!
+   * \brief per-group runs of equal labels, in decreasing label order.
+   *  For group k the boundaries live in
+   *  bucket_ptr[group_ptr[k]:group_ptr[k+1]]; order holds the row indices
+   *  sorted by label within each group. Rebuilt only when the labels or
+   *  the group structure change.
+   */
+  struct LabelBuckets {
+    std::vector<unsigned> order;
+    std::vector<size_t> bucket_ptr;
+    std::vector<size_t> group_ptr;
+    // snapshots used to detect dataset changes
+    std::vector<bst_float> labels;
+    std::vector<unsigned> gptr;
+  };
+
+  inline void InitBuckets(const std::vector<bst_float>& labels,
+                          const std::vector<unsigned>& gptr) {
+    if (labels == buckets_.labels && gptr == buckets_.gptr) return;
+    const auto ngroup = static_cast<bst_omp_uint>(gptr.size() - 1);
+    buckets_.order.resize(labels.size());
+    #pragma omp parallel for schedule(static)
+    for (bst_omp_uint k = 0; k < ngroup; ++k) {
+      for (unsigned j = gptr[k]; j < gptr[k + 1]; ++j) {
+        buckets_.order[j] = j;
+      }
+      std::sort(buckets_.order.begin() + gptr[k],
+                buckets_.order.begin() + gptr[k + 1],
+                [&labels](unsigned a, unsigned b) {
+                  return labels[a] > labels[b];
+                });
+    }
+    buckets_.bucket_ptr.clear();
+    buckets_.group_ptr.assign(1, 0);
+    for (bst_omp_uint k = 0; k < ngroup; ++k) {
+      for (unsigned j = gptr[k]; j < gptr[k + 1]; ++j) {
+        if (j == gptr[k] ||
+            labels[buckets_.order[j]] != labels[buckets_.order[j - 1]]) {
+          buckets_.bucket_ptr.push_back(j);
+        }
+      }
+      buckets_.bucket_ptr.push_back(gptr[k + 1]);
+      buckets_.group_ptr.push_back(buckets_.bucket_ptr.size());
+    }
+    buckets_.labels = labels;
+    buckets_.gptr = gptr;
+  }
+
+  LambdaRankParam param_;
+  LabelBuckets buckets_;
+#if defined(__CUDACC__)
+  // device copies of the group pointer and the folded pair weights,
+  // refreshed each iteration (one entry per group, cheap to upload)
+  thrust::device_vector<unsigned> group_ptr_d_;
+  thrust::device_vector<bst_float> pair_weight_d_;
+#endif
+};
+
+class PairwiseRankObj: public LambdaRankObj{
+ protected:
+  void GetLambdaWeight(const std::vector<ListEntry> &sorted_list,
+                       std::vector<LambdaPair> *io_pairs) override {}
+  bool SupportsDeviceGradient() const override { return true; }
+};
+
+// beta version: NDCG lambda rank
+class LambdaRankObjNDCG : public LambdaRankObj {
+ protected:
+  void GetLambdaWeight(const std::vector<ListEntry> &sorted_list,
+                       std::vector<LambdaPair> *io_pairs) override {
+    std::vector<LambdaPair> &pairs = *io_pairs;
+    float IDCG;  // NOLINT
+    {
+      std::vector<bst_float> labels(sorted_list.size());
+      for (size_t i = 0; i < sorted_list.size(); ++i) {
+        labels[i] = sorted_list[i].label;
+      }
+      std::sort(labels.begin(), labels.end(), std::greater<bst_float>());
+      IDCG = CalcDCG(labels);
+    }
+    if (IDCG == 0.0) {
+      for (auto & pair : pairs) {
+        pair.weight = 0.0f;
+      }
+    } else {
+      IDCG = 1.0f / IDCG;
+      for (auto & pair : pairs) {
+        unsigned pos_idx = pair.pos_index;
+        unsigned neg_idx = pair.neg_index;
+        float pos_loginv = 1.0f / std::log2(pos_idx + 2.0f);
+        float neg_loginv = 1.0f / std::log2(neg_idx + 2.0f);
+        auto pos_label = static_cast<int>(sorted_list[pos_idx].label);
+        auto neg_label = static_cast<int>(sorted_list[neg_idx].label);
+        bst_float original =
+            ((1 << pos_label) - 1) * pos_loginv + ((1 << neg_label) - 1) * neg_loginv;
+        float changed  =
+            ((1 << neg_label) - 1) * pos_loginv + ((1 << pos_label) - 1) * neg_loginv;
+        bst_float delta = (original - changed) * IDCG;
+        if (delta < 0.0f) delta = - delta;
+        pair.weight *= delta;
+      }
+    }
+  }
+  inline static bst_float CalcDCG(const std::vector<bst_float> &labels) {
+    double sumdcg = 0.0;
+    for (size_t i = 0; i < labels.size(); ++i) {
+      const auto rel = static_cast<unsigned>(labels[i]);
+      if (rel != 0) {
+        sumdcg += ((1 << rel) - 1) / std::log2(static_cast<bst_float>(i + 2));
+      }
+    }
+    return static_cast<bst_float>(sumdcg);
+  }
+};
+
+class LambdaRankObjMAP : public LambdaRankObj {
+ protected:
+  struct MAPStats {
+    /*! \brief the accumulated precision */
+    float ap_acc;
+    /*!
+     * \brief the accumulated precision,
+     *   assuming a positive instance is missing
+     */
+    float ap_acc_miss;
+    /*!
+     * \brief the accumulated precision,
+     * assuming that one more positive instance is inserted ahead
+     */
+    float ap_acc_add;
+    /* \brief the accumulated positive instance count */
+    float hits;
+    MAPStats() = default;
+    MAPStats(float ap_acc, float ap_acc_miss, float ap_acc_add, float hits)
+        : ap_acc(ap_acc), ap_acc_miss(ap_acc_miss), ap_acc_add(ap_acc_add), hits(hits) {}
+  };
+  /*!
+   * \brief Obtain the delta MAP if trying to switch the positions of instances in index1 or index2
+   *        in sorted triples
+   * \param sorted_list the list containing entry information
+   * \param index1,index2 the instances switched
+   * \param map_stats a vector containing the accumulated precisions for each position in a list
+   */
+  inline bst_float GetLambdaMAP(const std::vector<ListEntry> &sorted_list,
+                                int index1, int index2,
+                                std::vector<MAPStats> *p_map_stats) {
+    std::vector<MAPStats> &map_stats = *p_map_stats;
+    if (index1 == index2 || map_stats[map_stats.size() - 1].hits == 0) {
+      return 0.0f;
+    }
+    if (index1 > index2) std::swap(index1, index2);
+    bst_float original = map_stats[index2].ap_acc;
+    if (index1 != 0) original -= map_stats[index1 - 1].ap_acc;
+    bst_float changed = 0;
+    bst_float label1 = sorted_list[index1].label > 0.0f ? 1.0f : 0.0f;
+    bst_float label2 = sorted_list[index2].label > 0.0f ? 1.0f : 0.0f;
+    if (label1 == label2) {
+      return 0.0;
+    } else if (label1 < label2) {
+      changed += map_stats[index2 - 1].ap_acc_add - map_stats[index1].ap_acc_add;
+      changed += (map_stats[index1].hits + 1.0f) / (index1 + 1);
+    } else {
+      changed += map_stats[index2 - 1].ap_acc_miss - map_stats[index1].ap_acc_miss;
+      changed += map_stats[index2].hits / (index2 + 1);
+    }
+    bst_float ans = (changed - original) / (map_stats[map_stats.size() - 1].hits);
+    if (ans < 0) ans = -ans;
+    return ans;
+  }
+  /*
+   * \brief obtain preprocessing results for calculating delta MAP
+   * \param sorted_list the list containing entry information
+   * \param map_stats a vector containing the accumulated precisions for each position in a list
+   */
+  inline void GetMAPStats(const std::vector<ListEntry> &sorted_list,
+                          std::vector<MAPStats> *p_map_acc) {
+    std::vector<MAPStats> &map_acc = *p_map_acc;
+    map_acc.resize(sorted_list.size());
+    bst_float hit = 0, acc1 = 0, acc2 = 0, acc3 = 0;
+    for (size_t i = 1; i <= sorted_list.size(); ++i) {
+      if (sorted_list[i - 1].label > 0.0f) {
+        hit++;
+        acc1 += hit / i;
+        acc2 += (hit - 1) / i;
+        acc3 += (hit + 1) / i;
+      }
+      map_acc[i - 1] = MAPStats(acc1, acc2, acc3, hit);
+    }
+  }
+  void GetLambdaWeight(const std::vector<ListEntry> &sorted_list,
+                       std::vector<LambdaPair> *io_pairs) override {
+    std::vector<LambdaPair> &pairs = *io_pairs;
+    std::vector<MAPStats> map_stats;
+    GetMAPStats(sorted_list, &map_stats);
+    for (auto & pair : pairs) {
+      pair.weight *=
+          GetLambdaMAP(sorted_list, pair.pos_index,
+                       pair.neg_index, &map_stats);
+    }
+  }
+};
+
+// register the objective functions
+DMLC_REGISTER_PARAMETER(LambdaRankParam);
+
+XGBOOST_REGISTER_OBJECTIVE(PairwiseRankObj, "rank:pairwise")
+.describe("Pairwise rank objective.")
+.set_body([]() { return new PairwiseRankObj(); });
+
+XGBOOST_REGISTER_OBJECTIVE(LambdaRankNDCG, "rank:ndcg")
+.describe("LambdaRank with NDCG as objective.")
+.set_body([]() { return new LambdaRankObjNDCG(); });
+
+XGBOOST_REGISTER_OBJECTIVE(LambdaRankObjMAP, "rank:map")
+.describe("LambdaRank with MAP as objective.")
+.set_body([]() { return new LambdaRankObjMAP(); });
+
+}  // namespace obj
+}  // namespace xgboost
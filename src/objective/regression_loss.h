@@ -7,6 +7,7 @@
 #include <dmlc/omp.h>
 #include <xgboost/logging.h>
 #include <algorithm>
+#include <cmath>
 #include "../common/math.h"
 
 namespace xgboost {
@@ -34,6 +35,16 @@ struct LinearSquareLoss {
   static bst_float ProbToMargin(bst_float base_score) { return base_score; }
   static const char* LabelErrorMsg() { return ""; }
   static const char* DefaultEvalMetric() { return "rmse"; }
+  // row residue and final value of the default metric, for the fused
+  // gradient + metric pass; must match the registered metric
+  XGBOOST_DEVICE static bst_float EvalRow(bst_float label, bst_float pred) {
+    bst_float diff = label - pred;
+    return diff * diff;
+  }
+  static bst_float GetFinalMetric(bst_float esum, bst_float wsum) {
+    return std::sqrt(esum / wsum);
+  }
+  static bool FusedMetricSupported() { return true; }
 };
 
 // logistic loss for probability regression task
@@ -67,11 +78,26 @@ struct LogisticRegression {
     return "label must be in [0,1] for logistic regression";
   }
   static const char* DefaultEvalMetric() { return "rmse"; }
+  XGBOOST_DEVICE static bst_float EvalRow(bst_float label, bst_float pred) {
+    bst_float diff = label - pred;
+    return diff * diff;
+  }
+  static bst_float GetFinalMetric(bst_float esum, bst_float wsum) {
+    return std::sqrt(esum / wsum);
+  }
+  static bool FusedMetricSupported() { return true; }
 };
 
 // logistic loss for binary classification task
 struct LogisticClassification : public LogisticRegression {
   static const char* DefaultEvalMetric() { return "error"; }
+  XGBOOST_DEVICE static bst_float EvalRow(bst_float label, bst_float pred) {
+    // assume label is in [0,1]
+    return pred > 0.5f ? 1.0f - label : label;
+  }
+  static bst_float GetFinalMetric(bst_float esum, bst_float wsum) {
+    return esum / wsum;
+  }
 };
 
 // logistic loss, but predict un-transformed margin
@@ -102,6 +128,8 @@ struct LogisticRaw : public LogisticRegression {
     return std::max(predt * (T(1.0f) - predt), eps);
   }
   static const char* DefaultEvalMetric() { return "auc"; }
+  // auc is not an elementwise metric and cannot be fused
+  static bool FusedMetricSupported() { return false; }
 };
 
 }  // namespace obj
@@ -12,12 +12,20 @@
 #include <memory>
 #include <vector>
 
+#include "../common/math.h"
 #include "../common/span.h"
 #include "../common/transform.h"
 #include "../common/common.h"
 #include "../common/host_device_vector.h"
 #include "./regression_loss.h"
 
+#if defined(XGBOOST_USE_CUDA)
+#include <thrust/execution_policy.h>
+#include <thrust/reduce.h>
+
+#include "../common/device_helpers.cuh"
+#endif  // XGBOOST_USE_CUDA
+
 
 namespace xgboost {
 namespace obj {
@@ -26,10 +34,38 @@ namespace obj {
 DMLC_REGISTRY_FILE_TAG(regression_obj_gpu);
 #endif
 
+// Sum of a vector in double precision, on the devices when the data is
+// distributed there.
+inline double SumAcrossDevices(GPUSet devices,
+                               const HostDeviceVector<bst_float>& vec) {
+  double sum = 0;
+#if defined(XGBOOST_USE_CUDA)
+  if (!devices.IsEmpty()) {
+    for (int i = 0; i < devices.Size(); ++i) {
+      int device = devices.DeviceId(i);
+      auto span = vec.ConstDeviceSpan(device);
+      dh::safe_cuda(cudaSetDevice(device));
+      sum += thrust::reduce(thrust::device, span.data(),
+                            span.data() + span.size(), 0.0,
+                            thrust::plus<double>());
+    }
+    return sum;
+  }
+#endif  // XGBOOST_USE_CUDA
+  const auto& h_vec = vec.ConstHostVector();
+  const auto ndata = static_cast<omp_ulong>(h_vec.size());
+#pragma omp parallel for reduction(+: sum) schedule(static)
+  for (omp_ulong i = 0; i < ndata; ++i) {
+    sum += h_vec[i];
+  }
+  return sum;
+}
+
 struct RegLossParam : public dmlc::Parameter<RegLossParam> {
   float scale_pos_weight;
   int n_gpus;
   int gpu_id;
+  bool fused_eval_metric;
   // declare parameters
   DMLC_DECLARE_PARAMETER(RegLossParam) {
     DMLC_DECLARE_FIELD(scale_pos_weight).set_default(1.0f).set_lower_bound(0.0f)
@@ -40,6 +76,11 @@ struct RegLossParam : public dmlc::Parameter<RegLossParam> {
       .set_lower_bound(0)
       .set_default(0)
       .describe("gpu to use for objective function evaluation");
+    DMLC_DECLARE_FIELD(fused_eval_metric).set_default(false)
+      .describe("Compute the default evaluation metric on the training data "
+                "in the same pass as the gradients. The reported training "
+                "metric then reflects the model before the current boosting "
+                "round.");
   }
 };
 
@@ -71,28 +112,83 @@ class RegLossObj : public ObjFunction {
 
     bool is_null_weight = info.weights_.Size() == 0;
     auto scale_pos_weight = param_.scale_pos_weight;
-    common::Transform<>::Init(
-        [=] XGBOOST_DEVICE(size_t _idx,
-                           common::Span<int> _label_correct,
-                           common::Span<GradientPair> _out_gpair,
-                           common::Span<const bst_float> _preds,
-                           common::Span<const bst_float> _labels,
-                           common::Span<const bst_float> _weights) {
-          bst_float p = Loss::PredTransform(_preds[_idx]);
-          bst_float w = is_null_weight ? 1.0f : _weights[_idx];
-          bst_float label = _labels[_idx];
-          if (label == 1.0f) {
-            w *= scale_pos_weight;
-          }
-          if (!Loss::CheckLabel(label)) {
-            // If there is an incorrect label, the host code will know.
-            _label_correct[0] = 0;
-          }
-          _out_gpair[_idx] = GradientPair(Loss::FirstOrderGradient(p, label) * w,
-                                          Loss::SecondOrderGradient(p, label) * w);
-        },
-        common::Range{0, static_cast<int64_t>(ndata)}, devices_).Eval(
-            &label_correct_, out_gpair, &preds, &info.labels_, &info.weights_);
+    bool fused_metric = param_.fused_eval_metric && Loss::FusedMetricSupported();
+    if (fused_metric) {
+      // evaluate the default metric in the same pass over the predictions;
+      // the per-row residues are reduced below
+      residue_.Resize(ndata);
+      common::Transform<>::Init(
+          [=] XGBOOST_DEVICE(size_t _idx,
+                             common::Span<int> _label_correct,
+                             common::Span<GradientPair> _out_gpair,
+                             common::Span<bst_float> _residue,
+                             common::Span<const bst_float> _preds,
+                             common::Span<const bst_float> _labels,
+                             common::Span<const bst_float> _weights) {
+            bst_float w = is_null_weight ? 1.0f : _weights[_idx];
+            bst_float label = _labels[_idx];
+            if (!Loss::CheckLabel(label)) {
+              // If there is an incorrect label, the host code will know.
+              _label_correct[0] = 0;
+            }
+            if (w == 0.0f) {
+              // a zero-weight row contributes neither gradient nor metric
+              // residue; skip the loss arithmetic entirely
+              _residue[_idx] = 0.0f;
+              _out_gpair[_idx] = GradientPair(0.0f, 0.0f);
+              return;
+            }
+            bst_float p = Loss::PredTransform(_preds[_idx]);
+            // the metric weight excludes scale_pos_weight
+            _residue[_idx] = Loss::EvalRow(label, p) * w;
+            if (label == 1.0f) {
+              w *= scale_pos_weight;
+            }
+            _out_gpair[_idx] =
+                GradientPair(Loss::FirstOrderGradient(p, label) * w,
+                             Loss::SecondOrderGradient(p, label) * w);
+          },
+          common::Range{0, static_cast<int64_t>(ndata)}, devices_).Eval(
+              &label_correct_, out_gpair, &residue_, &preds, &info.labels_,
+              &info.weights_);
+      double residue_sum = SumAcrossDevices(devices_, residue_);
+      double weights_sum = is_null_weight
+          ? static_cast<double>(ndata)
+          : SumAcrossDevices(devices_, info.weights_);
+      fused_metric_value_ = Loss::GetFinalMetric(residue_sum, weights_sum);
+      fused_metric_info_ = &info;
+    } else {
+      common::Transform<>::Init(
+          [=] XGBOOST_DEVICE(size_t _idx,
+                             common::Span<int> _label_correct,
+                             common::Span<GradientPair> _out_gpair,
+                             common::Span<const bst_float> _preds,
+                             common::Span<const bst_float> _labels,
+                             common::Span<const bst_float> _weights) {
+            bst_float w = is_null_weight ? 1.0f : _weights[_idx];
+            bst_float label = _labels[_idx];
+            if (!Loss::CheckLabel(label)) {
+              // If there is an incorrect label, the host code will know.
+              _label_correct[0] = 0;
+            }
+            if (w == 0.0f) {
+              // a zero-weight row contributes no gradient; skip the loss
+              // arithmetic entirely
+              _out_gpair[_idx] = GradientPair(0.0f, 0.0f);
+              return;
+            }
+            bst_float p = Loss::PredTransform(_preds[_idx]);
+            if (label == 1.0f) {
+              w *= scale_pos_weight;
+            }
+            _out_gpair[_idx] =
+                GradientPair(Loss::FirstOrderGradient(p, label) * w,
+                             Loss::SecondOrderGradient(p, label) * w);
+          },
+          common::Range{0, static_cast<int64_t>(ndata)}, devices_).Eval(
+              &label_correct_, out_gpair, &preds, &info.labels_,
+              &info.weights_);
+    }
 
     // copy "label correct" flags back to host
     std::vector<int>& label_correct_h = label_correct_.HostVector();
@@ -103,6 +199,15 @@ class RegLossObj : public ObjFunction {
     }
   }
 
+  bool GetFusedMetric(const MetaInfo& info, const std::string& metric,
+                      bst_float* value) const override {
+    if (fused_metric_info_ != &info || metric != Loss::DefaultEvalMetric()) {
+      return false;
+    }
+    *value = fused_metric_value_;
+    return true;
+  }
+
  public:
   const char* DefaultEvalMetric() const override {
     return Loss::DefaultEvalMetric();
@@ -123,6 +228,10 @@ class RegLossObj : public ObjFunction {
  protected:
   RegLossParam param_;
   GPUSet devices_;
+  // per-row metric residues of the fused pass, and the resulting value
+  HostDeviceVector<bst_float> residue_;
+  bst_float fused_metric_value_ { 0.0f };
+  const MetaInfo* fused_metric_info_ { nullptr };
 };
 
 // register the objective functions
@@ -225,8 +334,9 @@ class PoissonRegression : public ObjFunction {
           if (y < 0.0f) {
             _label_correct[0] = 0;
           }
-          _out_gpair[_idx] = GradientPair{(expf(p) - y) * w,
-                                          expf(p + max_delta_step) * w};
+          // fast-exp is plenty for gradients; predictions keep full expf
+          _out_gpair[_idx] = GradientPair{(common::ExpFast(p) - y) * w,
+                                          common::ExpFast(p + max_delta_step) * w};
         },
         common::Range{0, static_cast<int64_t>(ndata)}, devices_).Eval(
             &label_correct_, out_gpair, &preds, &info.labels_, &info.weights_);
@@ -405,7 +515,8 @@ class GammaRegression : public ObjFunction {
           if (y < 0.0f) {
             _label_correct[0] = 0;
           }
-          _out_gpair[_idx] = GradientPair((1 - y / expf(p)) * w, y / expf(p) * w);
+          const bst_float expp = common::ExpFast(p);
+          _out_gpair[_idx] = GradientPair((1 - y / expp) * w, y / expp * w);
         },
         common::Range{0, static_cast<int64_t>(ndata)}, devices_).Eval(
             &label_correct_, out_gpair, &preds, &info.labels_, &info.weights_);
@@ -502,10 +613,10 @@ class TweedieRegression : public ObjFunction {
           if (y < 0.0f) {
             _label_correct[0] = 0;
           }
-          bst_float grad = -y * expf((1 - rho) * p) + expf((2 - rho) * p);
-          bst_float hess =
-              -y * (1 - rho) * \
-              std::exp((1 - rho) * p) + (2 - rho) * expf((2 - rho) * p);
+          const bst_float exp1 = common::ExpFast((1 - rho) * p);
+          const bst_float exp2 = common::ExpFast((2 - rho) * p);
+          bst_float grad = -y * exp1 + exp2;
+          bst_float hess = -y * (1 - rho) * exp1 + (2 - rho) * exp2;
           _out_gpair[_idx] = GradientPair(grad * w, hess * w);
         },
         common::Range{0, static_cast<int64_t>(ndata), 1}, devices_)
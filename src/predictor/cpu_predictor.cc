@@ -4,25 +4,317 @@
 #include <xgboost/predictor.h>
 #include <xgboost/tree_model.h>
 #include <xgboost/tree_updater.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
 #include "dmlc/logging.h"
+#include "../common/hist_util.h"
 #include "../common/host_device_vector.h"
+#include "../common/random.h"
+#include "../common/timer.h"
+
+#if (defined(__x86_64__) || defined(_M_X64)) && defined(__GNUC__)
+  #define XGBOOST_PREDICT_KERNEL_X86 1
+  #include <immintrin.h>
+#endif
 
 namespace xgboost {
 namespace predictor {
 
 DMLC_REGISTRY_FILE_TAG(cpu_predictor);
 
+/*! \brief prediction parameters */
+struct CPUPredictorParam : public dmlc::Parameter<CPUPredictorParam> {
+  float contribution_tree_sample;
+  float contribution_row_sample;
+  int prediction_cache_mb;
+  int cascade_stage_size;
+  int half_node_calibration_rows;
+  int sparse_traversal_ratio;
+  // declare parameters
+  DMLC_DECLARE_PARAMETER(CPUPredictorParam) {
+    DMLC_DECLARE_FIELD(sparse_traversal_ratio)
+        .set_lower_bound(0)
+        .set_default(64)
+        .describe(
+            "Traverse trees directly over the sorted CSR entries of a row, "
+            "instead of densifying it into a feature vector first, once "
+            "num_feature exceeds this many times the mean row nonzeros. "
+            "Scoring then scales with the nonzeros rather than the width "
+            "of the feature space. 0 disables the sparse traversal.");
+    DMLC_DECLARE_FIELD(cascade_stage_size)
+        .set_lower_bound(0)
+        .set_default(0)
+        .describe(
+            "Evaluate trees in stages of this many rather than all at once "
+            "during batch prediction of single-output models, stopping a "
+            "row as soon as the remaining trees can no longer change the "
+            "sign of its margin. Early-exited rows report their partial "
+            "margin, so only the sign is guaranteed to match full "
+            "evaluation. 0 disables staging.");
+    DMLC_DECLARE_FIELD(half_node_calibration_rows)
+        .set_lower_bound(0)
+        .set_default(0)
+        .describe(
+            "Freeze trees into an 8 byte node layout with half precision "
+            "split thresholds and 16 bit indices, halving the model's cache "
+            "footprint during batch prediction. The rounded thresholds are "
+            "validated against the full precision walk on this many leading "
+            "rows of the batch; any disagreement falls back to the full "
+            "precision layout. 0 disables the half layout.");
+    DMLC_DECLARE_FIELD(prediction_cache_mb)
+        .set_lower_bound(0)
+        .set_default(256)
+        .describe(
+            "Byte cap in megabytes of the process-level prediction cache "
+            "shared across learners; 0 disables it.");
+    DMLC_DECLARE_FIELD(contribution_tree_sample)
+        .set_range(0.0f, 1.0f)
+        .set_default(1.0f)
+        .describe(
+            "Fraction of trees sampled per row in approximate contribution "
+            "prediction; contributions are rescaled to stay unbiased.");
+    DMLC_DECLARE_FIELD(contribution_row_sample)
+        .set_range(0.0f, 1.0f)
+        .set_default(1.0f)
+        .describe(
+            "Fraction of rows scored in approximate contribution "
+            "prediction; skipped rows are left at zero.");
+  }
+};
+DMLC_REGISTER_PARAMETER(CPUPredictorParam);
+
+/**
+ * \struct  CompactPredictionNode
+ *
+ * \brief Packed 12 byte representation of a tree node holding only the
+ * fields read at prediction time. RegTree::Node additionally carries the
+ * parent pointer and a second child index, which a frozen tree does not
+ * need: the nodes are re-laid out in BFS order, so the right child always
+ * directly follows the left one.
+ */
+struct CompactPredictionNode {
+  // split feature index; the highest bit marks the default-left direction
+  unsigned sindex;
+  union {
+    bst_float split_cond;
+    bst_float leaf_value;
+  };
+  // index of the left child; the right child is cleft + 1; -1 marks a leaf
+  int cleft;
+
+  bool IsLeaf() const { return cleft == -1; }
+  unsigned SplitIndex() const { return sindex & ((1U << 31) - 1U); }
+  bool DefaultLeft() const { return (sindex >> 31) != 0; }
+};
+
+/**
+ * \struct  QuantizedPredictionNode
+ *
+ * \brief Quantized counterpart of CompactPredictionNode: the float split
+ * threshold is pre-converted to a global bin id of the quantized matrix, so
+ * traversal compares narrow integer bin indices instead of floats. The bin
+ * semantics match the hist updater's row partitioning: a row goes left when
+ * its bin id is <= split_cond, which coincides with fvalue < threshold.
+ */
+struct QuantizedPredictionNode {
+  // split feature index; the highest bit marks the default-left direction
+  unsigned sindex;
+  union {
+    bst_float leaf_value;
+    // global bin id of the split; -1 when the threshold is below all cuts
+    int32_t split_cond;
+  };
+  // index of the left child; the right child is cleft + 1; -1 marks a leaf
+  int cleft;
+
+  bool IsLeaf() const { return cleft == -1; }
+  unsigned SplitIndex() const { return sindex & ((1U << 31) - 1U); }
+  bool DefaultLeft() const { return (sindex >> 31) != 0; }
+};
+
+/**
+ * \struct  HalfPredictionNode
+ *
+ * \brief Further packed 8 byte node: the split threshold is stored in half
+ * precision and the feature and child indices in 16 bits, halving the per
+ * node footprint of CompactPredictionNode so twice the trees fit in cache.
+ * Leaf values stay fp32, so the margins a row accumulates are exact; only
+ * the split comparisons see rounded thresholds, and the freeze is rejected
+ * after calibration when any rounding changes a prediction. Requires
+ * num_feature below 2^15 and fewer than 2^16 nodes per tree.
+ */
+struct HalfPredictionNode {
+  // split feature index; the highest bit marks the default-left direction
+  uint16_t sindex;
+  // index of the left child; the right child is cleft + 1; 0 marks a leaf,
+  // which never collides with a child index since the BFS layout appends
+  // children after the roots
+  uint16_t cleft;
+  union {
+    bst_float leaf_value;
+    // split threshold rounded up to the nearest half precision value
+    uint16_t split_cond;
+  };
+
+  bool IsLeaf() const { return cleft == 0; }
+  unsigned SplitIndex() const { return sindex & 0x7fffU; }
+  bool DefaultLeft() const { return (sindex & 0x8000U) != 0; }
+};
+
+// expand an IEEE half precision value to float by widening the bit fields
+inline float Half2Float(uint16_t h) {
+  const uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+  uint32_t exp = (h >> 10) & 0x1f;
+  uint32_t mant = h & 0x3ff;
+  uint32_t bits;
+  if (exp == 0) {
+    if (mant == 0) {
+      bits = sign;  // +-0
+    } else {
+      // subnormal half: renormalize into the wider float exponent range
+      exp = 113;
+      while ((mant & 0x400) == 0) {
+        mant <<= 1;
+        --exp;
+      }
+      bits = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+    }
+  } else if (exp == 31) {
+    bits = sign | 0x7f800000 | (mant << 13);  // inf / nan
+  } else {
+    bits = sign | ((exp + 112) << 23) | (mant << 13);
+  }
+  float out;
+  std::memcpy(&out, &bits, sizeof(out));
+  return out;
+}
+
+// smallest half precision value >= v, so rounding a threshold can only move
+// the fvalue < threshold boundary upward, never below a value that used to
+// pass; the caller guarantees v is finite and within the half range
+inline uint16_t Float2HalfCeil(float v) {
+  uint32_t bits;
+  std::memcpy(&bits, &v, sizeof(bits));
+  const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+  const int32_t exp = static_cast<int32_t>((bits >> 23) & 0xff) - 112;
+  const uint32_t mant = bits & 0x7fffff;
+  uint16_t h;
+  uint32_t lost;
+  if (exp <= 0) {
+    if (exp < -10) {
+      // magnitude below the smallest subnormal half
+      h = sign;
+      lost = bits & 0x7fffffff;
+    } else {
+      // subnormal half: shift the implicit leading one into the mantissa
+      const int shift = 14 - exp;
+      h = sign | static_cast<uint16_t>((mant | 0x800000) >> shift);
+      lost = (mant | 0x800000) & ((1U << shift) - 1);
+    }
+  } else {
+    h = sign | static_cast<uint16_t>(exp << 10) |
+        static_cast<uint16_t>(mant >> 13);
+    lost = mant & 0x1fff;
+  }
+  // truncation moved a negative value toward zero, i.e. already upward; a
+  // positive value needs the next representable half, which an increment of
+  // the bit pattern yields even across an exponent boundary
+  if (lost != 0 && sign == 0) {
+    ++h;
+  }
+  return h;
+}
+
+#if defined(XGBOOST_PREDICT_KERNEL_X86)
+/*
+ * Advance 8 rows through one frozen tree in AVX2 registers: the node fields
+ * and feature values of all lanes are gathered and the child selection is a
+ * masked blend, so the unpredictable per-row branch of the scalar walk
+ * disappears. Lanes that reach a leaf park there until every lane is done.
+ * tile_fvalues holds the dense feature values of the 8 rows back to back
+ * (num_feature floats per lane); missing entries carry the FVec flag
+ * pattern 0xFFFFFFFF.
+ */
+__attribute__((target("avx2")))
+static void PredValueCompactAvx2(const CompactPredictionNode* nodes,
+                                 const int* roots, const float* tile_fvalues,
+                                 int num_feature, float* psum) {
+  const int* base = reinterpret_cast<const int*>(nodes);
+  const __m256i kMinusOne = _mm256_set1_epi32(-1);
+  const __m256i kOne = _mm256_set1_epi32(1);
+  // a CompactPredictionNode is three ints: sindex, split_cond, cleft
+  const __m256i kNodeInts = _mm256_set1_epi32(3);
+  const __m256i kIndexMask = _mm256_set1_epi32(0x7fffffff);
+  const __m256i lane_base = _mm256_setr_epi32(
+      0, num_feature, 2 * num_feature, 3 * num_feature, 4 * num_feature,
+      5 * num_feature, 6 * num_feature, 7 * num_feature);
+  __m256i nid = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(roots));
+  for (;;) {
+    const __m256i node_off = _mm256_mullo_epi32(nid, kNodeInts);
+    const __m256i cleft = _mm256_i32gather_epi32(base + 2, node_off, 4);
+    const __m256i done = _mm256_cmpeq_epi32(cleft, kMinusOne);
+    if (_mm256_movemask_epi8(done) == -1) {
+      break;
+    }
+    const __m256i sindex = _mm256_i32gather_epi32(base, node_off, 4);
+    const __m256 split = _mm256_castsi256_ps(
+        _mm256_i32gather_epi32(base + 1, node_off, 4));
+    const __m256i foff = _mm256_add_epi32(
+        lane_base, _mm256_and_si256(sindex, kIndexMask));
+    const __m256i fbits = _mm256_i32gather_epi32(
+        reinterpret_cast<const int*>(tile_fvalues), foff, 4);
+    const __m256i missing = _mm256_cmpeq_epi32(fbits, kMinusOne);
+    const __m256i lt = _mm256_castps_si256(_mm256_cmp_ps(
+        _mm256_castsi256_ps(fbits), split, _CMP_LT_OQ));
+    // the default-left bit is the sign bit of sindex
+    const __m256i dleft = _mm256_srai_epi32(sindex, 31);
+    const __m256i go_left = _mm256_or_si256(
+        _mm256_andnot_si256(missing, lt), _mm256_and_si256(missing, dleft));
+    // go_left is 0 or -1, so this selects cleft + 1 or cleft
+    const __m256i next =
+        _mm256_add_epi32(_mm256_add_epi32(cleft, kOne), go_left);
+    nid = _mm256_blendv_epi8(next, nid, done);
+  }
+  // every lane sits on a leaf; its value shares the slot of split_cond
+  const __m256i node_off = _mm256_mullo_epi32(nid, kNodeInts);
+  const __m256 leaf = _mm256_castsi256_ps(
+      _mm256_i32gather_epi32(base + 1, node_off, 4));
+  _mm256_storeu_ps(psum, _mm256_add_ps(_mm256_loadu_ps(psum), leaf));
+}
+#endif
+
 class CPUPredictor : public Predictor {
  protected:
+  // consult the updater sequence back to front; in-place tree
+  // transformers (prune, refresh) decline the cache update and defer to
+  // the grower before them, whose row-to-leaf assignments read the
+  // final tree state
+  static bool DelegatePredictionCache(
+      std::vector<std::unique_ptr<TreeUpdater>>* updaters,
+      const DMatrix* data, HostDeviceVector<bst_float>* out_preds) {
+    for (auto it = updaters->rbegin(); it != updaters->rend(); ++it) {
+      if ((*it)->UpdatePredictionCache(data, out_preds)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
   static bst_float PredValue(const  SparsePage::Inst& inst,
-                             const std::vector<std::unique_ptr<RegTree>>& trees,
+                             const std::vector<std::shared_ptr<RegTree>>& trees,
                              const std::vector<int>& tree_info, int bst_group,
                              unsigned root_index, RegTree::FVec* p_feats,
                              unsigned tree_begin, unsigned tree_end) {
     bst_float psum = 0.0f;
     p_feats->Fill(inst);
     for (size_t i = tree_begin; i < tree_end; ++i) {
-      if (tree_info[i] == bst_group) {
+      if (trees[i]->param.size_leaf_vector > 0) {
+        // a vector-leaf tree carries the weights of every group
+        int tid = trees[i]->GetLeafIndex(*p_feats, root_index);
+        psum += trees[i]->LeafVector(tid)[bst_group];
+      } else if (tree_info[i] == bst_group) {
         int tid = trees[i]->GetLeafIndex(*p_feats, root_index);
         psum += (*trees[i])[tid].LeafValue();
       }
@@ -31,6 +323,381 @@ class CPUPredictor : public Predictor {
     return psum;
   }
 
+  // freeze a trained tree into the compact prediction layout; the nodes are
+  // renumbered in BFS order, which makes the right child implicit, drops
+  // deleted nodes and keeps the top levels of the tree contiguous
+  static void FreezeTree(const RegTree& tree,
+                         std::vector<CompactPredictionNode>* out) {
+    static_assert(sizeof(CompactPredictionNode) == 12,
+                  "CompactPredictionNode: 12 byte pack");
+    out->clear();
+    // old node ids in BFS order; the position in this list is the new id
+    std::vector<int> order;
+    for (int i = 0; i < tree.param.num_roots; ++i) {
+      order.push_back(i);
+    }
+    for (size_t head = 0; head < order.size(); ++head) {
+      const RegTree::Node& n = tree[order[head]];
+      CompactPredictionNode cn;
+      if (n.IsLeaf()) {
+        cn.sindex = 0;
+        cn.leaf_value = n.LeafValue();
+        cn.cleft = -1;
+      } else {
+        cn.sindex = n.SplitIndex();
+        if (n.DefaultLeft()) {
+          cn.sindex |= (1U << 31);
+        }
+        cn.split_cond = n.SplitCond();
+        cn.cleft = static_cast<int>(order.size());
+        order.push_back(n.LeftChild());
+        order.push_back(n.RightChild());
+      }
+      out->push_back(cn);
+    }
+  }
+
+  // walk a single frozen tree for a feature vector that is already filled
+  static bst_float PredValueCompact(const RegTree::FVec& feats,
+                                    const CompactPredictionNode* tree,
+                                    unsigned root_index) {
+    int nid = static_cast<int>(root_index);
+    while (!tree[nid].IsLeaf()) {
+      const unsigned split_index = tree[nid].SplitIndex();
+      if (feats.IsMissing(split_index)) {
+        nid = tree[nid].cleft + !tree[nid].DefaultLeft();
+      } else {
+        nid = tree[nid].cleft +
+              !(feats.Fvalue(split_index) < tree[nid].split_cond);
+      }
+    }
+    return tree[nid].leaf_value;
+  }
+
+  // as PredValueCompact, but looking split features up in the row's sorted
+  // entry span by binary search instead of a dense feature vector; entries
+  // absent from the span take the default direction
+  static bst_float PredValueCompactSparse(const SparsePage::Inst& inst,
+                                          const CompactPredictionNode* tree,
+                                          unsigned root_index) {
+    const Entry* begin = inst.data();
+    const Entry* end = begin + inst.size();
+    int nid = static_cast<int>(root_index);
+    while (!tree[nid].IsLeaf()) {
+      const unsigned split_index = tree[nid].SplitIndex();
+      const Entry* it = std::lower_bound(
+          begin, end, split_index,
+          [](const Entry& e, unsigned fid) { return e.index < fid; });
+      if (it != end && it->index == split_index) {
+        nid = tree[nid].cleft + !(it->fvalue < tree[nid].split_cond);
+      } else {
+        nid = tree[nid].cleft + !tree[nid].DefaultLeft();
+      }
+    }
+    return tree[nid].leaf_value;
+  }
+
+  // freeze a trained tree into the quantized layout, converting every split
+  // threshold to a bin id of the given cuts, the same way ApplySplit does
+  // during training. Returns false when a threshold does not correspond to
+  // any cut, i.e. the tree was not grown from this quantization.
+  static bool FreezeTreeQuantized(const RegTree& tree,
+                                  const common::HistCutMatrix& cut,
+                                  std::vector<QuantizedPredictionNode>* out) {
+    out->clear();
+    std::vector<int> order;
+    for (int i = 0; i < tree.param.num_roots; ++i) {
+      order.push_back(i);
+    }
+    for (size_t head = 0; head < order.size(); ++head) {
+      const RegTree::Node& n = tree[order[head]];
+      QuantizedPredictionNode qn;
+      if (n.IsLeaf()) {
+        qn.sindex = 0;
+        qn.leaf_value = n.LeafValue();
+        qn.cleft = -1;
+      } else {
+        const bst_uint fid = n.SplitIndex();
+        if (fid + 1 >= cut.row_ptr.size()) {
+          return false;
+        }
+        const bst_float split_pt = n.SplitCond();
+        int32_t split_cond = -1;
+        for (uint32_t i = cut.row_ptr[fid]; i < cut.row_ptr[fid + 1]; ++i) {
+          if (split_pt == cut.cut[i]) {
+            split_cond = static_cast<int32_t>(i);
+          }
+        }
+        if (split_cond == -1 && split_pt != cut.min_val[fid]) {
+          return false;
+        }
+        qn.sindex = fid;
+        if (n.DefaultLeft()) {
+          qn.sindex |= (1U << 31);
+        }
+        qn.split_cond = split_cond;
+        qn.cleft = static_cast<int>(order.size());
+        order.push_back(n.LeftChild());
+        order.push_back(n.RightChild());
+      }
+      out->push_back(qn);
+    }
+    return true;
+  }
+
+  // walk a single quantized tree for one row of bin indices
+  template <typename BinIdxT>
+  static bst_float PredValueQuantized(
+      const BinIdxT* row_index, size_t row_size, size_t num_feature,
+      const uint32_t* cut_ptr,
+      const std::vector<QuantizedPredictionNode>& tree, unsigned root_index) {
+    int nid = static_cast<int>(root_index);
+    while (!tree[nid].IsLeaf()) {
+      const unsigned fid = tree[nid].SplitIndex();
+      int32_t gbin = -1;  // -1 marks a missing feature
+      if (row_size == num_feature) {
+        // dense row: one entry per feature, in feature order
+        gbin = static_cast<int32_t>(row_index[fid]);
+      } else {
+        // the bin ids of feature fid fall in [cut_ptr[fid], cut_ptr[fid+1])
+        const BinIdxT* it = std::lower_bound(
+            row_index, row_index + row_size, cut_ptr[fid],
+            [](BinIdxT a, uint32_t b) { return a < b; });
+        if (it != row_index + row_size && *it < cut_ptr[fid + 1]) {
+          gbin = static_cast<int32_t>(*it);
+        }
+      }
+      if (gbin < 0) {
+        nid = tree[nid].cleft + !tree[nid].DefaultLeft();
+      } else {
+        nid = tree[nid].cleft + !(gbin <= tree[nid].split_cond);
+      }
+    }
+    return tree[nid].leaf_value;
+  }
+
+  template <typename BinIdxT>
+  inline void PredLoopQuantized(const common::GHistIndexMatrix& gmat,
+                                const MetaInfo& info,
+                                std::vector<bst_float>* out_preds,
+                                const gbm::GBTreeModel& model, int num_group,
+                                unsigned tree_begin, unsigned tree_end) {
+    std::vector<bst_float>& preds = *out_preds;
+    const BinIdxT* index = gmat.index.Data<BinIdxT>();
+    const uint32_t* cut_ptr = gmat.cut.row_ptr.data();
+    const size_t num_feature = gmat.cut.row_ptr.size() - 1;
+    const auto nsize = static_cast<bst_omp_uint>(info.num_row_);
+#pragma omp parallel for schedule(static)
+    for (bst_omp_uint i = 0; i < nsize; ++i) {
+      const size_t row_begin = gmat.row_ptr[i];
+      const size_t row_size = gmat.row_ptr[i + 1] - row_begin;
+      const unsigned root_index = info.GetRoot(i);
+      for (int gid = 0; gid < num_group; ++gid) {
+        bst_float psum = 0.0f;
+        for (size_t j = tree_begin; j < tree_end; ++j) {
+          if (model.tree_info[j] == gid) {
+            psum += PredValueQuantized(index + row_begin, row_size,
+                                       num_feature, cut_ptr,
+                                       quantized_trees_[j], root_index);
+          }
+        }
+        preds[i * num_group + gid] += psum;
+      }
+    }
+  }
+
+  /*
+   * The quantized fast path: when the hist updater has published a
+   * quantized matrix for this DMatrix, convert the tree thresholds to bin
+   * ids once and traverse the already-quantized bin indices, so the
+   * in-training prediction passes compare narrow integers instead of
+   * floats. Binning uses upper_bound, so bin id <= split bin holds exactly
+   * when fvalue < threshold and the result matches the float path.
+   */
+  bool TryPredictQuantized(DMatrix* p_fmat, std::vector<bst_float>* out_preds,
+                           const gbm::GBTreeModel& model, int num_group,
+                           unsigned tree_begin, unsigned tree_end) {
+    std::shared_ptr<const common::GHistIndexMatrix> gmat =
+        common::LookupGHistIndex(p_fmat);
+    if (gmat == nullptr || gmat->row_ptr.size() != p_fmat->Info().num_row_ + 1) {
+      return false;
+    }
+    quantized_trees_.resize(tree_end);
+    for (unsigned i = tree_begin; i < tree_end; ++i) {
+      if (!FreezeTreeQuantized(*model.trees[i], gmat->cut,
+                               &quantized_trees_[i])) {
+        return false;
+      }
+    }
+    switch (gmat->index.ElemSize()) {
+      case sizeof(uint8_t):
+        PredLoopQuantized<uint8_t>(*gmat, p_fmat->Info(), out_preds, model,
+                                   num_group, tree_begin, tree_end);
+        break;
+      case sizeof(uint16_t):
+        PredLoopQuantized<uint16_t>(*gmat, p_fmat->Info(), out_preds, model,
+                                    num_group, tree_begin, tree_end);
+        break;
+      default:
+        PredLoopQuantized<uint32_t>(*gmat, p_fmat->Info(), out_preds, model,
+                                    num_group, tree_begin, tree_end);
+        break;
+    }
+    return true;
+  }
+
+  // freeze a trained tree into the half precision layout, the same BFS
+  // renumbering as FreezeTree. Returns false when the tree does not fit the
+  // narrow fields or a threshold falls outside the half range; rounding
+  // error is not checked here but by calibration against the full
+  // precision walk.
+  static bool FreezeTreeHalf(const RegTree& tree,
+                             std::vector<HalfPredictionNode>* out) {
+    static_assert(sizeof(HalfPredictionNode) == 8,
+                  "HalfPredictionNode: 8 byte pack");
+    out->clear();
+    std::vector<int> order;
+    for (int i = 0; i < tree.param.num_roots; ++i) {
+      order.push_back(i);
+    }
+    for (size_t head = 0; head < order.size(); ++head) {
+      const RegTree::Node& n = tree[order[head]];
+      HalfPredictionNode hn;
+      if (n.IsLeaf()) {
+        hn.sindex = 0;
+        hn.cleft = 0;
+        hn.leaf_value = n.LeafValue();
+      } else {
+        const bst_uint fid = n.SplitIndex();
+        const bst_float split_pt = n.SplitCond();
+        if (fid >= (1U << 15) || order.size() + 2 > (1U << 16) ||
+            !std::isfinite(split_pt) || std::fabs(split_pt) > 65504.0f) {
+          return false;
+        }
+        hn.sindex = static_cast<uint16_t>(fid);
+        if (n.DefaultLeft()) {
+          hn.sindex |= 0x8000U;
+        }
+        hn.cleft = static_cast<uint16_t>(order.size());
+        hn.split_cond = Float2HalfCeil(split_pt);
+        order.push_back(n.LeftChild());
+        order.push_back(n.RightChild());
+      }
+      out->push_back(hn);
+    }
+    return true;
+  }
+
+  // walk a single half precision tree for a feature vector that is already
+  // filled
+  static bst_float PredValueHalf(const RegTree::FVec& feats,
+                                 const HalfPredictionNode* tree,
+                                 unsigned root_index) {
+    int nid = static_cast<int>(root_index);
+    while (!tree[nid].IsLeaf()) {
+      const unsigned split_index = tree[nid].SplitIndex();
+      if (feats.IsMissing(split_index)) {
+        nid = tree[nid].cleft + !tree[nid].DefaultLeft();
+      } else {
+        nid = tree[nid].cleft +
+              !(feats.Fvalue(split_index) < Half2Float(tree[nid].split_cond));
+      }
+    }
+    return tree[nid].leaf_value;
+  }
+
+  /*
+   * The half precision fast path: freeze the tree range into 8 byte nodes
+   * and calibrate them on the leading rows of the batch, scoring each row
+   * through both the full precision and the half precision walk. Only when
+   * every calibration row lands on the same leaves is the rounded layout
+   * trusted for the remaining rows; otherwise the freeze is discarded and
+   * the caller proceeds with the full precision loops.
+   */
+  bool TryPredLoopHalf(DMatrix* p_fmat, std::vector<bst_float>* out_preds,
+                       const gbm::GBTreeModel& model, int num_group,
+                       unsigned tree_begin, unsigned tree_end) {
+    if (model.param.num_feature >= (1 << 15)) {
+      return false;
+    }
+    half_trees_.resize(tree_end);
+    for (unsigned i = tree_begin; i < tree_end; ++i) {
+      if (!FreezeTreeHalf(*model.trees[i], &half_trees_[i])) {
+        return false;
+      }
+    }
+    const MetaInfo& info = p_fmat->Info();
+    const int nthread = omp_get_max_threads();
+    InitThreadTemp(nthread, model.param.num_feature);
+    for (const auto& batch : p_fmat->GetRowBatches()) {
+      const auto nsize = static_cast<bst_omp_uint>(std::min(
+          batch.Size(),
+          static_cast<size_t>(param_.half_node_calibration_rows)));
+      bst_omp_uint mismatch = 0;
+#pragma omp parallel for schedule(static) reduction(+ : mismatch)
+      for (bst_omp_uint i = 0; i < nsize; ++i) {
+        const int tid = omp_get_thread_num();
+        RegTree::FVec& feats = thread_temp[tid];
+        auto inst = batch[i];
+        const unsigned root_id = info.GetRoot(batch.base_rowid + i);
+        feats.Fill(inst);
+        for (unsigned t = tree_begin; t < tree_end; ++t) {
+          if (PredValueCompact(feats, compact_trees_[t].data(), root_id) !=
+              PredValueHalf(feats, half_trees_[t].data(), root_id)) {
+            ++mismatch;
+            break;
+          }
+        }
+        feats.Drop(inst);
+      }
+      if (mismatch != 0) {
+        return false;
+      }
+      break;  // the leading rows of the first batch are enough
+    }
+    std::vector<bst_float>& preds = *out_preds;
+    for (const auto& batch : p_fmat->GetRowBatches()) {
+      const auto nsize = static_cast<bst_omp_uint>(batch.Size());
+#pragma omp parallel for schedule(static)
+      for (bst_omp_uint i = 0; i < nsize; ++i) {
+        const int tid = omp_get_thread_num();
+        RegTree::FVec& feats = thread_temp[tid];
+        const auto ridx = static_cast<size_t>(batch.base_rowid + i);
+        const unsigned root_id = info.GetRoot(ridx);
+        auto inst = batch[i];
+        feats.Fill(inst);
+        for (int gid = 0; gid < num_group; ++gid) {
+          bst_float psum = 0.0f;
+          for (unsigned t = tree_begin; t < tree_end; ++t) {
+            if (model.tree_info[t] == gid) {
+              psum += PredValueHalf(feats, half_trees_[t].data(), root_id);
+            }
+          }
+          preds[ridx * num_group + gid] += psum;
+        }
+        feats.Drop(inst);
+      }
+    }
+    return true;
+  }
+
+  // as PredValue, but over frozen trees and for a feature vector that is
+  // already filled; used by the blocked prediction loop, which walks several
+  // tree batches over the same row before dropping its features
+  static bst_float PredValueFilled(
+      const RegTree::FVec& feats,
+      const std::vector<std::vector<CompactPredictionNode>>& trees,
+      const std::vector<int>& tree_info, int bst_group, unsigned root_index,
+      unsigned tree_begin, unsigned tree_end) {
+    bst_float psum = 0.0f;
+    for (size_t i = tree_begin; i < tree_end; ++i) {
+      if (tree_info[i] == bst_group) {
+        psum += PredValueCompact(feats, trees[i].data(), root_index);
+      }
+    }
+    return psum;
+  }
+
   // init thread buffers
   inline void InitThreadTemp(int nthread, int num_feature) {
     int prev_thread_temp_size = thread_temp.size();
@@ -41,27 +708,246 @@ class CPUPredictor : public Predictor {
       }
     }
   }
+  // staged prediction with early exit: trees are walked in stages of
+  // cascade_stage_size, and a row stops as soon as the leaf ranges of the
+  // remaining trees can no longer flip the sign of its margin. For models
+  // where most rows are decided by the leading trees this cuts the average
+  // cost several-fold while preserving every sign decision exactly.
+  inline void PredLoopCascade(DMatrix* p_fmat,
+                              std::vector<bst_float>* out_preds,
+                              const gbm::GBTreeModel& model,
+                              unsigned tree_begin, unsigned tree_end) {
+    const MetaInfo& info = p_fmat->Info();
+    const int nthread = omp_get_max_threads();
+    InitThreadTemp(nthread, model.param.num_feature);
+    std::vector<bst_float>& preds = *out_preds;
+    compact_trees_.resize(tree_end);
+    for (unsigned i = tree_begin; i < tree_end; ++i) {
+      FreezeTree(*model.trees[i], &compact_trees_[i]);
+    }
+    // suffix leaf ranges: bounds[t] holds the least and largest margin the
+    // trees [tree_begin + t, tree_end) can still contribute
+    std::vector<std::pair<bst_float, bst_float>> bounds(
+        tree_end - tree_begin + 1, {0.0f, 0.0f});
+    for (unsigned t = tree_end; t-- > tree_begin;) {
+      bst_float lo = std::numeric_limits<bst_float>::max();
+      bst_float hi = std::numeric_limits<bst_float>::lowest();
+      for (const CompactPredictionNode& node : compact_trees_[t]) {
+        if (node.IsLeaf()) {
+          lo = std::min(lo, node.leaf_value);
+          hi = std::max(hi, node.leaf_value);
+        }
+      }
+      bounds[t - tree_begin] = {bounds[t - tree_begin + 1].first + lo,
+                                bounds[t - tree_begin + 1].second + hi};
+    }
+    const auto stage = static_cast<unsigned>(param_.cascade_stage_size);
+    for (const auto& batch : p_fmat->GetRowBatches()) {
+      const auto nsize = static_cast<bst_omp_uint>(batch.Size());
+#pragma omp parallel for schedule(static)
+      for (bst_omp_uint i = 0; i < nsize; ++i) {
+        const int tid = omp_get_thread_num();
+        RegTree::FVec& feats = thread_temp[tid];
+        const auto ridx = static_cast<size_t>(batch.base_rowid + i);
+        const unsigned root_id = info.GetRoot(ridx);
+        auto inst = batch[i];
+        feats.Fill(inst);
+        bst_float margin = preds[ridx];
+        unsigned t = tree_begin;
+        while (t < tree_end) {
+          const unsigned stage_end = std::min(t + stage, tree_end);
+          for (; t < stage_end; ++t) {
+            margin += PredValueCompact(feats, compact_trees_[t].data(),
+                                       root_id);
+          }
+          const std::pair<bst_float, bst_float>& rest =
+              bounds[t - tree_begin];
+          if (margin + rest.second < 0.0f || margin + rest.first > 0.0f) {
+            break;  // the sign can no longer change
+          }
+        }
+        preds[ridx] = margin;
+        feats.Drop(inst);
+      }
+    }
+  }
+
+  // CSR-direct traversal for extreme sparsity: with millions of features
+  // and a handful of nonzeros per row, filling and dropping the dense
+  // feature vector dominates scoring, so split lookups binary-search the
+  // row's sorted entry span instead. Rows whose entries are not sorted by
+  // feature index fall back to the dense vector.
+  inline void PredLoopSparse(DMatrix* p_fmat,
+                             std::vector<bst_float>* out_preds,
+                             const gbm::GBTreeModel& model, int num_group,
+                             unsigned tree_begin, unsigned tree_end) {
+    const MetaInfo& info = p_fmat->Info();
+    const int nthread = omp_get_max_threads();
+    InitThreadTemp(nthread, model.param.num_feature);
+    std::vector<bst_float>& preds = *out_preds;
+    for (const auto& batch : p_fmat->GetRowBatches()) {
+      const auto nsize = static_cast<bst_omp_uint>(batch.Size());
+#pragma omp parallel for schedule(static)
+      for (bst_omp_uint i = 0; i < nsize; ++i) {
+        const auto ridx = static_cast<size_t>(batch.base_rowid + i);
+        const unsigned root_id = info.GetRoot(ridx);
+        auto inst = batch[i];
+        bool sorted = true;
+        for (size_t j = 1; j < inst.size(); ++j) {
+          if (inst[j - 1].index >= inst[j].index) {
+            sorted = false;
+            break;
+          }
+        }
+        if (sorted) {
+          for (int gid = 0; gid < num_group; ++gid) {
+            bst_float psum = 0.0f;
+            for (unsigned t = tree_begin; t < tree_end; ++t) {
+              if (model.tree_info[t] == gid) {
+                psum += PredValueCompactSparse(inst, compact_trees_[t].data(),
+                                               root_id);
+              }
+            }
+            preds[ridx * num_group + gid] += psum;
+          }
+        } else {
+          const int tid = omp_get_thread_num();
+          RegTree::FVec& feats = thread_temp[tid];
+          feats.Fill(inst);
+          for (int gid = 0; gid < num_group; ++gid) {
+            preds[ridx * num_group + gid] +=
+                PredValueFilled(feats, compact_trees_, model.tree_info, gid,
+                                root_id, tree_begin, tree_end);
+          }
+          feats.Drop(inst);
+        }
+      }
+    }
+  }
+
+  // prediction loop for vector-leaf trees: one traversal per tree yields
+  // the margins of every output group at once, so the per-group loop of
+  // the scalar path collapses to a scatter of the leaf vector
+  inline void PredLoopVectorLeaf(DMatrix* p_fmat,
+                                 std::vector<bst_float>* out_preds,
+                                 const gbm::GBTreeModel& model, int num_group,
+                                 unsigned tree_begin, unsigned tree_end) {
+    const MetaInfo& info = p_fmat->Info();
+    const int nthread = omp_get_max_threads();
+    InitThreadTemp(nthread, model.param.num_feature);
+    std::vector<bst_float>& preds = *out_preds;
+    for (const auto& batch : p_fmat->GetRowBatches()) {
+      const auto nsize = static_cast<bst_omp_uint>(batch.Size());
+#pragma omp parallel for schedule(static)
+      for (bst_omp_uint i = 0; i < nsize; ++i) {
+        const int tid = omp_get_thread_num();
+        RegTree::FVec& feats = thread_temp[tid];
+        const auto ridx = static_cast<int64_t>(batch.base_rowid + i);
+        const SparsePage::Inst inst = batch[i];
+        const unsigned root_id = info.GetRoot(ridx);
+        feats.Fill(inst);
+        for (unsigned t = tree_begin; t < tree_end; ++t) {
+          const RegTree& tree = *model.trees[t];
+          const int nid = tree.GetLeafIndex(feats, root_id);
+          if (tree.param.size_leaf_vector > 0) {
+            const bst_float* leaf = tree.LeafVector(nid);
+            for (int gid = 0; gid < num_group; ++gid) {
+              preds[ridx * num_group + gid] += leaf[gid];
+            }
+          } else {
+            // scalar trees may precede the vector ones when training
+            // continued from an earlier model
+            preds[ridx * num_group + model.tree_info[t]] +=
+                tree[nid].LeafValue();
+          }
+        }
+        feats.Drop(inst);
+      }
+    }
+  }
+
   inline void PredLoopSpecalize(DMatrix* p_fmat,
                                 std::vector<bst_float>* out_preds,
                                 const gbm::GBTreeModel& model, int num_group,
                                 unsigned tree_begin, unsigned tree_end) {
     const MetaInfo& info = p_fmat->Info();
     const int nthread = omp_get_max_threads();
-    InitThreadTemp(nthread, model.param.num_feature);
+    constexpr int kUnroll = 8;
+    // number of trees walked over a row tile before moving to the next batch;
+    // sized so a batch of typical depth-6 trees stays resident in L2, instead
+    // of streaming the whole model through the cache once per row tile
+    constexpr unsigned kTreeBatch = 256;
+    // each thread holds a full tile of filled feature vectors
+    InitThreadTemp(nthread * kUnroll, model.param.num_feature);
     std::vector<bst_float>& preds = *out_preds;
-    CHECK_EQ(model.param.size_leaf_vector, 0)
-        << "size_leaf_vector is enforced to 0 so far";
     CHECK_EQ(preds.size(), p_fmat->Info().num_row_ * num_group);
+    if (model.param.size_leaf_vector > 0) {
+      // vector-leaf trees produce all group margins from one traversal
+      // and do not fit the group-filtered loops below
+      CHECK_EQ(model.param.size_leaf_vector, num_group)
+          << "vector-leaf model must carry one weight per output group";
+      this->PredLoopVectorLeaf(p_fmat, out_preds, model, num_group,
+                               tree_begin, tree_end);
+      return;
+    }
+    // staged evaluation with early exit once the sign of the margin is
+    // settled; only meaningful for single-output (binary or regression)
+    // models, where a sign decision exists
+    if (param_.cascade_stage_size > 0 && num_group == 1) {
+      this->PredLoopCascade(p_fmat, out_preds, model, tree_begin, tree_end);
+      return;
+    }
+    // reuse the hist updater's quantization when one exists for this matrix
+    if (this->TryPredictQuantized(p_fmat, out_preds, model, num_group,
+                                  tree_begin, tree_end)) {
+      return;
+    }
+    // freeze the requested tree range into the compact prediction layout;
+    // the cost is linear in the number of nodes and amortized over the rows
+    compact_trees_.resize(tree_end);
+    for (unsigned i = tree_begin; i < tree_end; ++i) {
+      FreezeTree(*model.trees[i], &compact_trees_[i]);
+    }
+    // feature space much wider than the rows are dense: scale with the
+    // nonzeros instead of the feature count
+    if (param_.sparse_traversal_ratio > 0 && info.num_row_ > 0) {
+      const double mean_nnz =
+          static_cast<double>(info.num_nonzero_) / info.num_row_;
+      if (static_cast<double>(model.param.num_feature) >
+          param_.sparse_traversal_ratio * std::max(mean_nnz, 1.0)) {
+        this->PredLoopSparse(p_fmat, out_preds, model, num_group,
+                             tree_begin, tree_end);
+        return;
+      }
+    }
+    // optionally shrink the frozen trees to 8 byte nodes; the layout is
+    // only used when calibration shows the rounded thresholds reproduce
+    // the full precision predictions on the leading rows
+    if (param_.half_node_calibration_rows > 0 &&
+        this->TryPredLoopHalf(p_fmat, out_preds, model, num_group,
+                              tree_begin, tree_end)) {
+      return;
+    }
+#if defined(XGBOOST_PREDICT_KERNEL_X86)
+    static const bool kUseAvx2 = __builtin_cpu_supports("avx2");
+    const size_t tile_stride = model.param.num_feature;
+    if (kUseAvx2 &&
+        tile_fvalues_.size() < nthread * kUnroll * tile_stride) {
+      tile_fvalues_.resize(nthread * kUnroll * tile_stride);
+      // all entries carry the missing sentinel between tiles
+      std::memset(tile_fvalues_.data(), -1,
+                  tile_fvalues_.size() * sizeof(float));
+    }
+#endif
     // start collecting the prediction
     for (const auto &batch : p_fmat->GetRowBatches()) {
       // parallel over local batch
-      constexpr int kUnroll = 8;
       const auto nsize = static_cast<bst_omp_uint>(batch.Size());
       const bst_omp_uint rest = nsize % kUnroll;
 #pragma omp parallel for schedule(static)
       for (bst_omp_uint i = 0; i < nsize - rest; i += kUnroll) {
         const int tid = omp_get_thread_num();
-        RegTree::FVec& feats = thread_temp[tid];
+        RegTree::FVec* feats = &thread_temp[tid * kUnroll];
         int64_t ridx[kUnroll];
         SparsePage::Inst inst[kUnroll];
         for (int k = 0; k < kUnroll; ++k) {
@@ -70,14 +956,71 @@ class CPUPredictor : public Predictor {
         for (int k = 0; k < kUnroll; ++k) {
           inst[k] = batch[i + k];
         }
+#if defined(XGBOOST_PREDICT_KERNEL_X86)
+        if (kUseAvx2) {
+          // fill the dense tile once; it is reused by every tree batch
+          float* tile =
+              &tile_fvalues_[static_cast<size_t>(tid) * kUnroll * tile_stride];
+          for (int k = 0; k < kUnroll; ++k) {
+            for (bst_uint j = 0; j < inst[k].size(); ++j) {
+              if (inst[k][j].index < tile_stride) {
+                tile[k * tile_stride + inst[k][j].index] = inst[k][j].fvalue;
+              }
+            }
+          }
+          int roots[kUnroll];
+          for (int k = 0; k < kUnroll; ++k) {
+            roots[k] = static_cast<int>(info.GetRoot(ridx[k]));
+          }
+          for (unsigned tbegin = tree_begin; tbegin < tree_end;
+               tbegin += kTreeBatch) {
+            const unsigned tbatch_end = std::min(tbegin + kTreeBatch, tree_end);
+            for (int gid = 0; gid < num_group; ++gid) {
+              float psum[kUnroll] = {0.0f};
+              for (unsigned t = tbegin; t < tbatch_end; ++t) {
+                if (model.tree_info[t] == gid) {
+                  PredValueCompactAvx2(compact_trees_[t].data(), roots, tile,
+                                       static_cast<int>(tile_stride), psum);
+                }
+              }
+              for (int k = 0; k < kUnroll; ++k) {
+                preds[ridx[k] * num_group + gid] += psum[k];
+              }
+            }
+          }
+          // restore the missing sentinel, as FVec::Drop does
+          auto* tile_bits = reinterpret_cast<int*>(tile);
+          for (int k = 0; k < kUnroll; ++k) {
+            for (bst_uint j = 0; j < inst[k].size(); ++j) {
+              if (inst[k][j].index < tile_stride) {
+                tile_bits[k * tile_stride + inst[k][j].index] = -1;
+              }
+            }
+          }
+          continue;
+        }
+#endif
+        // fill the whole row tile once; it is reused by every tree batch
         for (int k = 0; k < kUnroll; ++k) {
-          for (int gid = 0; gid < num_group; ++gid) {
-            const size_t offset = ridx[k] * num_group + gid;
-            preds[offset] += this->PredValue(
-                inst[k], model.trees, model.tree_info, gid,
-                info.GetRoot(ridx[k]), &feats, tree_begin, tree_end);
+          feats[k].Fill(inst[k]);
+        }
+        for (unsigned tbegin = tree_begin; tbegin < tree_end;
+             tbegin += kTreeBatch) {
+          const unsigned tbatch_end =
+              std::min(tbegin + kTreeBatch, tree_end);
+          for (int k = 0; k < kUnroll; ++k) {
+            for (int gid = 0; gid < num_group; ++gid) {
+              const size_t offset = ridx[k] * num_group + gid;
+              // the margins of the tile stay cached across tree batches
+              preds[offset] += PredValueFilled(
+                  feats[k], compact_trees_, model.tree_info, gid,
+                  info.GetRoot(ridx[k]), tbegin, tbatch_end);
+            }
           }
         }
+        for (int k = 0; k < kUnroll; ++k) {
+          feats[k].Drop(inst[k]);
+        }
       }
       for (bst_omp_uint i = nsize - rest; i < nsize; ++i) {
         RegTree::FVec& feats = thread_temp[0];
@@ -152,14 +1095,57 @@ class CPUPredictor : public Predictor {
   }
 
  public:
+  CPUPredictor() {
+    // standalone use may never call Init; start from parameter defaults
+    param_.InitAllowUnknown(std::vector<std::pair<std::string, std::string>>());
+  }
+
+  void Init(const std::vector<std::pair<std::string, std::string>>& cfg,
+            const std::vector<std::shared_ptr<DMatrix>>& cache) override {
+    Predictor::Init(cfg, cache);
+    param_.InitAllowUnknown(cfg);
+    GlobalPredictionCache::Get()->SetCapacityBytes(
+        static_cast<size_t>(param_.prediction_cache_mb) << 20);
+  }
+
   void PredictBatch(DMatrix* dmat, HostDeviceVector<bst_float>* out_preds,
                     const gbm::GBTreeModel& model, int tree_begin,
                     unsigned ntree_limit = 0) override {
-    if (this->PredictFromCache(dmat, out_preds, model, ntree_limit)) {
+    common::ProfileScope profile_scope("CPUPredictor::PredictBatch");
+    if (common::Profiler::Enabled()) {
+      common::Profiler::Get()->AddBytes(dmat->Info().num_nonzero_ *
+                                        sizeof(Entry));
+    }
+    // a nonzero tree_begin continues from margins the caller already
+    // accumulated in out_preds (delta prediction); only full passes go
+    // through the caches and the base margin initialization
+    const bool full_pass = tree_begin == 0;
+    if (full_pass &&
+        this->PredictFromCache(dmat, out_preds, model, ntree_limit)) {
       return;
     }
 
-    this->InitOutPredictions(dmat->Info(), out_preds, model);
+    // the process-level cache catches repeated scoring of the same matrix
+    // across learners and evaluation passes; cascade margins are partial
+    // and must not leak into it
+    const bool use_global_cache = full_pass &&
+                                  param_.prediction_cache_mb > 0 &&
+                                  param_.cascade_stage_size == 0;
+    const unsigned requested_ntree_limit = ntree_limit;
+    if (use_global_cache) {
+      std::vector<bst_float> cached;
+      if (GlobalPredictionCache::Get()->Lookup(model, dmat,
+                                               requested_ntree_limit,
+                                               &cached)) {
+        out_preds->Resize(cached.size());
+        out_preds->HostVector() = std::move(cached);
+        return;
+      }
+    }
+
+    if (full_pass) {
+      this->InitOutPredictions(dmat->Info(), out_preds, model);
+    }
 
     ntree_limit *= model.param.num_output_group;
     if (ntree_limit == 0 || ntree_limit > model.trees.size()) {
@@ -168,6 +1154,61 @@ class CPUPredictor : public Predictor {
 
     this->PredLoopInternal(dmat, &out_preds->HostVector(), model,
                            tree_begin, ntree_limit);
+
+    if (use_global_cache) {
+      GlobalPredictionCache::Get()->Store(model, dmat, requested_ntree_limit,
+                                          out_preds->HostVector());
+    }
+  }
+
+  void PredictDense(const float* data, size_t num_row, size_t num_col,
+                    float missing, const gbm::GBTreeModel& model,
+                    unsigned ntree_limit,
+                    std::vector<bst_float>* out_preds) override {
+    CHECK_EQ(num_col, static_cast<size_t>(model.param.num_feature))
+        << "dense input must have one column per feature";
+    CHECK_EQ(model.param.size_leaf_vector, 0);
+    unsigned tree_end = ntree_limit * model.param.num_output_group;
+    if (ntree_limit == 0 || tree_end > model.trees.size()) {
+      tree_end = static_cast<unsigned>(model.trees.size());
+    }
+    const int num_group = model.param.num_output_group;
+    const int nthread = omp_get_max_threads();
+    InitThreadTemp(nthread, model.param.num_feature);
+    compact_trees_.resize(tree_end);
+    for (unsigned i = 0; i < tree_end; ++i) {
+      FreezeTree(*model.trees[i], &compact_trees_[i]);
+    }
+    std::vector<bst_float>& preds = *out_preds;
+    preds.resize(num_row * num_group);
+    std::fill(preds.begin(), preds.end(), model.base_margin);
+    const bool nan_missing = std::isnan(missing);
+    // per-thread sparse views over the dense rows; capacity is retained
+    // across rows, so past warmup the loop allocates nothing
+    std::vector<std::vector<Entry>> row_entries(nthread);
+    const auto nsize = static_cast<bst_omp_uint>(num_row);
+#pragma omp parallel for schedule(static)
+    for (bst_omp_uint i = 0; i < nsize; ++i) {
+      const int tid = omp_get_thread_num();
+      std::vector<Entry>& row = row_entries[tid];
+      row.clear();
+      const float* values = data + static_cast<size_t>(i) * num_col;
+      for (size_t j = 0; j < num_col; ++j) {
+        const float v = values[j];
+        if (std::isnan(v) || (!nan_missing && v == missing)) { continue; }
+        row.emplace_back(static_cast<bst_uint>(j), v);
+      }
+      SparsePage::Inst inst(
+          dmlc::BeginPtr(row),
+          static_cast<SparsePage::Inst::index_type>(row.size()));
+      RegTree::FVec& feats = thread_temp[tid];
+      feats.Fill(inst);
+      for (int gid = 0; gid < num_group; ++gid) {
+        preds[static_cast<size_t>(i) * num_group + gid] += PredValueFilled(
+            feats, compact_trees_, model.tree_info, gid, 0, 0, tree_end);
+      }
+      feats.Drop(inst);
+    }
   }
 
   void UpdatePredictionCache(
@@ -185,8 +1226,8 @@ class CPUPredictor : public Predictor {
                          model.trees.size());
       } else if (model.param.num_output_group == 1 && updaters->size() > 0 &&
                  num_new_trees == 1 &&
-                 updaters->back()->UpdatePredictionCache(e.data.get(),
-                                                         &(e.predictions))) {
+                 DelegatePredictionCache(updaters, e.data.get(),
+                                         &(e.predictions))) {
         {}  // do nothing
       } else {
         PredLoopInternal(e.data.get(), &(e.predictions.HostVector()), model, old_ntree,
@@ -217,6 +1258,28 @@ class CPUPredictor : public Predictor {
           model.base_margin;
     }
   }
+  // context variant: all mutable state lives in the caller owned context, so
+  // the call is thread-safe and, once the context is warm, allocation free
+  void PredictInstance(const SparsePage::Inst& inst, PredictionContext* ctx,
+                       const gbm::GBTreeModel& model,
+                       unsigned ntree_limit) override {
+    if (ctx->feats.Size() !=
+        static_cast<size_t>(model.param.num_feature)) {
+      ctx->feats.Init(model.param.num_feature);
+    }
+    ntree_limit *= model.param.num_output_group;
+    if (ntree_limit == 0 || ntree_limit > model.trees.size()) {
+      ntree_limit = static_cast<unsigned>(model.trees.size());
+    }
+    std::vector<bst_float>& preds = ctx->preds.HostVector();
+    preds.resize(model.param.num_output_group *
+                 (model.param.size_leaf_vector + 1));
+    for (int gid = 0; gid < model.param.num_output_group; ++gid) {
+      preds[gid] = PredValue(inst, model.trees, model.tree_info, gid, 0,
+                             &ctx->feats, 0, ntree_limit) +
+                   model.base_margin;
+    }
+  }
   void PredictLeaf(DMatrix* p_fmat, std::vector<bst_float>* out_preds,
                    const gbm::GBTreeModel& model, unsigned ntree_limit) override {
     const int nthread = omp_get_max_threads();
@@ -275,12 +1338,40 @@ class CPUPredictor : public Predictor {
       model.trees[i]->FillNodeMeanValues();
     }
     const std::vector<bst_float>& base_margin = info.base_margin_.HostVector();
+    // in approximate mode trees and rows may be subsampled for exploratory
+    // analysis; sampled tree contributions are rescaled by the inverse
+    // sample rate so the estimate stays unbiased in expectation, while
+    // skipped rows are simply left at zero
+    std::vector<int> tree_used(ntree_limit, 1);
+    bst_float tree_scale = 1.0f;
+    if (approximate && param_.contribution_tree_sample < 1.0f) {
+      std::bernoulli_distribution coin_flip(param_.contribution_tree_sample);
+      auto& rnd = common::GlobalRandom();
+      for (unsigned j = 0; j < ntree_limit; ++j) {
+        tree_used[j] = coin_flip(rnd);
+      }
+      if (param_.contribution_tree_sample > 0.0f) {
+        tree_scale = 1.0f / param_.contribution_tree_sample;
+      }
+    }
     // start collecting the contributions
     for (const auto &batch : p_fmat->GetRowBatches()) {
       // parallel over local batch
       const auto nsize = static_cast<bst_omp_uint>(batch.Size());
+      std::vector<int> row_used;
+      if (approximate && param_.contribution_row_sample < 1.0f) {
+        std::bernoulli_distribution coin_flip(param_.contribution_row_sample);
+        auto& rnd = common::GlobalRandom();
+        row_used.resize(nsize);
+        for (bst_omp_uint i = 0; i < nsize; ++i) {
+          row_used[i] = coin_flip(rnd);
+        }
+      }
 #pragma omp parallel for schedule(static)
       for (bst_omp_uint i = 0; i < nsize; ++i) {
+        if (!row_used.empty() && row_used[i] == 0) {
+          continue;
+        }
         auto row_idx = static_cast<size_t>(batch.base_rowid + i);
         unsigned root_id = info.GetRoot(row_idx);
         RegTree::FVec& feats = thread_temp[omp_get_thread_num()];
@@ -291,7 +1382,7 @@ class CPUPredictor : public Predictor {
           feats.Fill(batch[i]);
           // calculate contributions
           for (unsigned j = 0; j < ntree_limit; ++j) {
-            if (model.tree_info[j] != gid) {
+            if (model.tree_info[j] != gid || tree_used[j] == 0) {
               continue;
             }
             if (!approximate) {
@@ -302,6 +1393,11 @@ class CPUPredictor : public Predictor {
             }
           }
           feats.Drop(batch[i]);
+          if (tree_scale != 1.0f) {
+            for (size_t k = 0; k < ncolumns; ++k) {
+              p_contribs[k] *= tree_scale;
+            }
+          }
           // add base margin to BIAS
           if (base_margin.size() != 0) {
             p_contribs[ncolumns - 1] += base_margin[row_idx * ngroup + gid];
@@ -356,7 +1452,18 @@ class CPUPredictor : public Predictor {
       }
     }
   }
+  CPUPredictorParam param_;
   std::vector<RegTree::FVec> thread_temp;
+  // frozen trees indexed by tree id, rebuilt for the range of each
+  // prediction loop
+  std::vector<std::vector<CompactPredictionNode>> compact_trees_;
+  // quantized frozen trees, used when a quantized matrix is available
+  std::vector<std::vector<QuantizedPredictionNode>> quantized_trees_;
+  // half precision frozen trees, used once calibration validates them
+  std::vector<std::vector<HalfPredictionNode>> half_trees_;
+  // per-thread dense feature tiles for the vectorized traversal; missing
+  // entries hold the FVec flag pattern
+  std::vector<float> tile_fvalues_;
 };
 
 XGBOOST_REGISTER_PREDICTOR(CPUPredictor, "cpu_predictor")
@@ -159,8 +159,22 @@ struct ElementLoader {
   }
 };
 
+/*! \brief loader for dense row-major device data, missing encoded as NaN */
+struct DenseElementLoader {
+  const float* d_data;
+  size_t num_features;
+
+  __device__ DenseElementLoader(const float* d_data, size_t num_features)
+      : d_data(d_data), num_features(num_features) {}
+
+  __device__ float GetFvalue(int ridx, int fidx) {
+    return d_data[static_cast<size_t>(ridx) * num_features + fidx];
+  }
+};
+
+template <typename Loader>
 __device__ float GetLeafWeight(bst_uint ridx, const DevicePredictionNode* tree,
-                               ElementLoader* loader) {
+                               Loader* loader) {
   DevicePredictionNode n = tree[0];
   while (!n.IsLeaf()) {
     float fvalue = loader->GetFvalue(ridx, n.GetFidx());
@@ -187,12 +201,59 @@ __global__ void PredictKernel(common::Span<const DevicePredictionNode> d_nodes,
                               common::Span<const Entry> d_data, size_t tree_begin,
                               size_t tree_end, size_t num_features,
                               size_t num_rows, size_t entry_start,
-                              bool use_shared, int num_group) {
+                              bool use_shared, bool nodes_in_shared,
+                              int num_group) {
   extern __shared__ float smem[];
   bst_uint global_idx = blockDim.x * blockIdx.x + threadIdx.x;
-  ElementLoader loader(use_shared, d_row_ptr, d_data, num_features, smem,
-                       num_rows, entry_start);
+  // Tree traversal reads nodes in a divergent, data-dependent order; when the
+  // trees fit, stage them into shared memory at the start of the smem area so
+  // every level of every traversal hits on-chip storage instead of DRAM.
+  const DevicePredictionNode* nodes = d_nodes.data();
+  float* feature_smem = smem;
+  if (nodes_in_shared) {
+    auto* s_nodes = reinterpret_cast<DevicePredictionNode*>(smem);
+    size_t n_nodes = d_nodes.size();
+    for (size_t i = threadIdx.x; i < n_nodes; i += BLOCK_THREADS) {
+      s_nodes[i] = d_nodes[i];
+    }
+    __syncthreads();
+    nodes = s_nodes;
+    feature_smem = smem +
+        d_nodes.size() * (sizeof(DevicePredictionNode) / sizeof(float));
+  }
+  ElementLoader loader(use_shared, d_row_ptr, d_data, num_features,
+                       feature_smem, num_rows, entry_start);
+  if (global_idx >= num_rows) return;
+  if (num_group == 1) {
+    float sum = 0;
+    for (int tree_idx = tree_begin; tree_idx < tree_end; tree_idx++) {
+      const DevicePredictionNode* d_tree =
+          &nodes[d_tree_segments[tree_idx - tree_begin]];
+      sum += GetLeafWeight(global_idx, d_tree, &loader);
+    }
+    d_out_predictions[global_idx] += sum;
+  } else {
+    for (int tree_idx = tree_begin; tree_idx < tree_end; tree_idx++) {
+      int tree_group = d_tree_group[tree_idx];
+      const DevicePredictionNode* d_tree =
+          &nodes[d_tree_segments[tree_idx - tree_begin]];
+      bst_uint out_prediction_idx = global_idx * num_group + tree_group;
+      d_out_predictions[out_prediction_idx] +=
+          GetLeafWeight(global_idx, d_tree, &loader);
+    }
+  }
+}
+
+template <int BLOCK_THREADS>
+__global__ void PredictDenseKernel(
+    common::Span<const DevicePredictionNode> d_nodes,
+    common::Span<float> d_out_predictions,
+    common::Span<size_t> d_tree_segments, common::Span<int> d_tree_group,
+    const float* d_data, size_t tree_begin, size_t tree_end,
+    size_t num_features, size_t num_rows, int num_group) {
+  bst_uint global_idx = blockDim.x * blockIdx.x + threadIdx.x;
   if (global_idx >= num_rows) return;
+  DenseElementLoader loader(d_data, num_features);
   if (num_group == 1) {
     float sum = 0;
     for (int tree_idx = tree_begin; tree_idx < tree_end; tree_idx++) {
@@ -243,6 +304,41 @@ class GPUPredictor : public xgboost::Predictor {
       this->device_ = device;
       max_shared_memory_bytes = dh::MaxSharedMemory(this->device_);
      }
+    void LoadModel(const gbm::GBTreeModel& model,
+                   const thrust::host_vector<size_t>& h_tree_segments,
+                   const thrust::host_vector<DevicePredictionNode>& h_nodes,
+                   size_t tree_begin, size_t tree_end) {
+      dh::safe_cuda(cudaSetDevice(device_));
+      // The same tree segment is scored against every cached matrix during
+      // UpdatePredictionCache and against every batch of a matrix; keep the
+      // device replica of the model and re-upload only when the segment or
+      // the model generation changes. The generation is bumped on every
+      // commit, load and in-place rewrite, so trees mutated without a
+      // shape change (process_type=update with refresh or prune) still
+      // invalidate the replica.
+      if (!model_loaded_ || model_generation_ != model.generation ||
+          model_tree_begin_ != tree_begin || model_tree_end_ != tree_end) {
+        nodes.resize(h_nodes.size());
+        dh::safe_cuda(cudaMemcpy(dh::Raw(nodes), h_nodes.data(),
+                                 sizeof(DevicePredictionNode) * h_nodes.size(),
+                                 cudaMemcpyHostToDevice));
+        tree_segments.resize(h_tree_segments.size());
+
+        dh::safe_cuda(cudaMemcpy(dh::Raw(tree_segments), h_tree_segments.data(),
+                                 sizeof(size_t) * h_tree_segments.size(),
+                                 cudaMemcpyHostToDevice));
+        tree_group.resize(model.tree_info.size());
+
+        dh::safe_cuda(cudaMemcpy(dh::Raw(tree_group), model.tree_info.data(),
+                                 sizeof(int) * model.tree_info.size(),
+                                 cudaMemcpyHostToDevice));
+        model_tree_begin_ = tree_begin;
+        model_tree_end_ = tree_end;
+        model_generation_ = model.generation;
+        model_loaded_ = true;
+      }
+    }
+
     void PredictInternal
     (const SparsePage& batch, const MetaInfo& info,
      HostDeviceVector<bst_float>* predictions,
@@ -250,21 +346,7 @@ class GPUPredictor : public xgboost::Predictor {
      const thrust::host_vector<size_t>& h_tree_segments,
      const thrust::host_vector<DevicePredictionNode>& h_nodes,
      size_t tree_begin, size_t tree_end) {
-      dh::safe_cuda(cudaSetDevice(device_));
-      nodes.resize(h_nodes.size());
-      dh::safe_cuda(cudaMemcpy(dh::Raw(nodes), h_nodes.data(),
-                               sizeof(DevicePredictionNode) * h_nodes.size(),
-                               cudaMemcpyHostToDevice));
-      tree_segments.resize(h_tree_segments.size());
-
-      dh::safe_cuda(cudaMemcpy(dh::Raw(tree_segments), h_tree_segments.data(),
-                               sizeof(size_t) * h_tree_segments.size(),
-                               cudaMemcpyHostToDevice));
-      tree_group.resize(model.tree_info.size());
-
-      dh::safe_cuda(cudaMemcpy(dh::Raw(tree_group), model.tree_info.data(),
-                               sizeof(int) * model.tree_info.size(),
-                               cudaMemcpyHostToDevice));
+      LoadModel(model, h_tree_segments, h_nodes, tree_begin, tree_end);
 
       const int BLOCK_THREADS = 128;
       size_t num_rows = batch.offset.DeviceSize(device_) - 1;
@@ -272,13 +354,21 @@ class GPUPredictor : public xgboost::Predictor {
 
       const int GRID_SIZE = static_cast<int>(dh::DivRoundUp(num_rows, BLOCK_THREADS));
 
-      int shared_memory_bytes = static_cast<int>
-        (sizeof(float) * info.num_col_ * BLOCK_THREADS);
+      size_t shared_memory_bytes = sizeof(float) * info.num_col_ * BLOCK_THREADS;
       bool use_shared = true;
       if (shared_memory_bytes > max_shared_memory_bytes) {
         shared_memory_bytes = 0;
         use_shared = false;
       }
+      // stage the trees themselves into shared memory when they fit alongside
+      // the feature staging area; for the incremental segments predicted
+      // during training this is usually just a handful of trees
+      size_t node_bytes = sizeof(DevicePredictionNode) * h_nodes.size();
+      bool nodes_in_shared =
+          shared_memory_bytes + node_bytes <= max_shared_memory_bytes;
+      if (nodes_in_shared) {
+        shared_memory_bytes += node_bytes;
+      }
       const auto& data_distr = batch.data.Distribution();
       size_t entry_start = data_distr.ShardStart(batch.data.Size(),
                                                  data_distr.Devices().Index(device_));
@@ -287,8 +377,27 @@ class GPUPredictor : public xgboost::Predictor {
         (dh::ToSpan(nodes), predictions->DeviceSpan(device_), dh::ToSpan(tree_segments),
          dh::ToSpan(tree_group), batch.offset.DeviceSpan(device_),
          batch.data.DeviceSpan(device_), tree_begin, tree_end, info.num_col_,
-         num_rows, entry_start, use_shared, model.param.num_output_group);
+         num_rows, entry_start, use_shared, nodes_in_shared,
+         model.param.num_output_group);
+
+      dh::safe_cuda(cudaGetLastError());
+      dh::safe_cuda(cudaDeviceSynchronize());
+    }
 
+    void PredictDense(const float* d_data, size_t num_rows, size_t num_cols,
+                      common::Span<float> d_out, const gbm::GBTreeModel& model,
+                      const thrust::host_vector<size_t>& h_tree_segments,
+                      const thrust::host_vector<DevicePredictionNode>& h_nodes,
+                      size_t tree_begin, size_t tree_end) {
+      LoadModel(model, h_tree_segments, h_nodes, tree_begin, tree_end);
+      if (num_rows < 1) { return; }
+      const int BLOCK_THREADS = 128;
+      const int GRID_SIZE =
+          static_cast<int>(dh::DivRoundUp(num_rows, BLOCK_THREADS));
+      PredictDenseKernel<BLOCK_THREADS><<<GRID_SIZE, BLOCK_THREADS>>>(
+          dh::ToSpan(nodes), d_out, dh::ToSpan(tree_segments),
+          dh::ToSpan(tree_group), d_data, tree_begin, tree_end, num_cols,
+          num_rows, model.param.num_output_group);
       dh::safe_cuda(cudaGetLastError());
       dh::safe_cuda(cudaDeviceSynchronize());
     }
@@ -298,17 +407,21 @@ class GPUPredictor : public xgboost::Predictor {
     thrust::device_vector<size_t> tree_segments;
     thrust::device_vector<int> tree_group;
     size_t max_shared_memory_bytes;
+    /*! \brief tree segment currently resident in the device replica */
+    size_t model_tree_begin_{0};
+    size_t model_tree_end_{0};
+    /*! \brief model generation the replica was uploaded from */
+    size_t model_generation_{0};
+    bool model_loaded_{false};
   };
 
-  void DevicePredictInternal(DMatrix* dmat,
-                             HostDeviceVector<bst_float>* out_preds,
-                             const gbm::GBTreeModel& model, size_t tree_begin,
-                             size_t tree_end) {
-    if (tree_end - tree_begin == 0) { return; }
-
-    CHECK_EQ(model.param.size_leaf_vector, 0);
-    // Copy decision trees to device
-    thrust::host_vector<size_t> h_tree_segments;
+  // Pack the trees of [tree_begin, tree_end) into flat node and segment
+  // arrays for upload to the devices.
+  static void ExtractModelNodes(
+      const gbm::GBTreeModel& model, size_t tree_begin, size_t tree_end,
+      thrust::host_vector<size_t>* p_tree_segments,
+      thrust::host_vector<DevicePredictionNode>* p_nodes) {
+    thrust::host_vector<size_t>& h_tree_segments = *p_tree_segments;
     h_tree_segments.reserve((tree_end - tree_begin) + 1);
     size_t sum = 0;
     h_tree_segments.push_back(sum);
@@ -317,12 +430,26 @@ class GPUPredictor : public xgboost::Predictor {
       h_tree_segments.push_back(sum);
     }
 
-    thrust::host_vector<DevicePredictionNode> h_nodes(h_tree_segments.back());
+    thrust::host_vector<DevicePredictionNode>& h_nodes = *p_nodes;
+    h_nodes.resize(h_tree_segments.back());
     for (auto tree_idx = tree_begin; tree_idx < tree_end; tree_idx++) {
       auto& src_nodes = model.trees.at(tree_idx)->GetNodes();
       std::copy(src_nodes.begin(), src_nodes.end(),
                 h_nodes.begin() + h_tree_segments[tree_idx - tree_begin]);
     }
+  }
+
+  void DevicePredictInternal(DMatrix* dmat,
+                             HostDeviceVector<bst_float>* out_preds,
+                             const gbm::GBTreeModel& model, size_t tree_begin,
+                             size_t tree_end) {
+    if (tree_end - tree_begin == 0) { return; }
+
+    CHECK_EQ(model.param.size_leaf_vector, 0);
+    // Copy decision trees to device
+    thrust::host_vector<size_t> h_tree_segments;
+    thrust::host_vector<DevicePredictionNode> h_nodes;
+    ExtractModelNodes(model, tree_begin, tree_end, &h_tree_segments, &h_nodes);
 
     size_t i_batch = 0;
 
@@ -352,10 +479,14 @@ class GPUPredictor : public xgboost::Predictor {
         param.gpu_id, param.n_gpus, dmat->Info().num_row_);
     ConfigureShards(devices);
 
-    if (this->PredictFromCache(dmat, out_preds, model, ntree_limit)) {
-      return;
+    // a nonzero tree_begin continues from margins the caller already
+    // accumulated in out_preds (delta prediction) and bypasses the cache
+    if (tree_begin == 0) {
+      if (this->PredictFromCache(dmat, out_preds, model, ntree_limit)) {
+        return;
+      }
+      this->InitOutPredictions(dmat->Info(), out_preds, model);
     }
-    this->InitOutPredictions(dmat->Info(), out_preds, model);
 
     int tree_end = ntree_limit * model.param.num_output_group;
 
@@ -366,6 +497,40 @@ class GPUPredictor : public xgboost::Predictor {
     DevicePredictInternal(dmat, out_preds, model, tree_begin, tree_end);
   }
 
+  void PredictDeviceDense(const float* d_data, size_t num_row, size_t num_col,
+                          const gbm::GBTreeModel& model, unsigned ntree_limit,
+                          const float** out_d_preds,
+                          size_t* out_len) override {
+    CHECK_EQ(model.param.size_leaf_vector, 0);
+    CHECK_EQ(num_col, static_cast<size_t>(model.param.num_feature));
+    // the input lives on a single device, so score it there; the dense
+    // scoring shard is separate from the batch shards to avoid thrashing
+    // their model replicas and distribution state
+    if (dense_shard_.device_ < 0) {
+      dense_shard_.Init(param.gpu_id);
+    }
+
+    size_t tree_end = ntree_limit * model.param.num_output_group;
+    if (ntree_limit == 0 || tree_end > model.trees.size()) {
+      tree_end = model.trees.size();
+    }
+
+    thrust::host_vector<size_t> h_tree_segments;
+    thrust::host_vector<DevicePredictionNode> h_nodes;
+    ExtractModelNodes(model, 0, tree_end, &h_tree_segments, &h_nodes);
+
+    dh::safe_cuda(cudaSetDevice(param.gpu_id));
+    const size_t n = num_row * model.param.num_output_group;
+    dense_predictions_.resize(n);
+    thrust::fill(dense_predictions_.begin(), dense_predictions_.end(),
+                 model.base_margin);
+    dense_shard_.PredictDense(d_data, num_row, num_col,
+                              dh::ToSpan(dense_predictions_), model,
+                              h_tree_segments, h_nodes, 0, tree_end);
+    *out_d_preds = dh::Raw(dense_predictions_);
+    *out_len = n;
+  }
+
  protected:
   void InitOutPredictions(const MetaInfo& info,
                           HostDeviceVector<bst_float>* out_preds,
@@ -416,9 +581,18 @@ class GPUPredictor : public xgboost::Predictor {
         this->InitOutPredictions(dmat->Info(), &predictions, model);
       }
 
-      if (model.param.num_output_group == 1 && updaters->size() > 0 &&
-          num_new_trees == 1 &&
-          updaters->back()->UpdatePredictionCache(e.data.get(), &predictions)) {
+      // consult the updater sequence back to front: in-place tree
+      // transformers (prune, refresh) decline and defer to the grower
+      bool cache_updated = false;
+      if (model.param.num_output_group == 1 && num_new_trees == 1) {
+        for (auto it = updaters->rbegin(); it != updaters->rend(); ++it) {
+          if ((*it)->UpdatePredictionCache(e.data.get(), &predictions)) {
+            cache_updated = true;
+            break;
+          }
+        }
+      }
+      if (cache_updated) {
         // do nothing
       } else {
         DevicePredictInternal(dmat, &predictions, model, old_ntree, model.trees.size());
@@ -432,6 +606,16 @@ class GPUPredictor : public xgboost::Predictor {
                        unsigned root_index) override {
     cpu_predictor->PredictInstance(inst, out_preds, model, root_index);
   }
+
+  void PredictDense(const float* data, size_t num_row, size_t num_col,
+                    float missing, const gbm::GBTreeModel& model,
+                    unsigned ntree_limit,
+                    std::vector<bst_float>* out_preds) override {
+    // host buffer in, host buffer out: the copy to the device would defeat
+    // the point of the in-place path
+    cpu_predictor->PredictDense(data, num_row, num_col, missing, model,
+                                ntree_limit, out_preds);
+  }
   void PredictLeaf(DMatrix* p_fmat, std::vector<bst_float>* out_preds,
                    const gbm::GBTreeModel& model,
                    unsigned ntree_limit) override {
@@ -484,6 +668,9 @@ class GPUPredictor : public xgboost::Predictor {
   std::unique_ptr<Predictor> cpu_predictor;
   std::vector<DeviceShard> shards;
   GPUSet devices_;
+  /*! \brief shard and output buffer of the device-pointer dense path */
+  DeviceShard dense_shard_;
+  thrust::device_vector<bst_float> dense_predictions_;
 };
 
 XGBOOST_REGISTER_PREDICTOR(GPUPredictor, "gpu_predictor")
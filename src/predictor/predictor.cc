@@ -3,11 +3,233 @@
  */
 #include <dmlc/registry.h>
 #include <xgboost/predictor.h>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <sstream>
 
 namespace dmlc {
 DMLC_REGISTRY_ENABLE(::xgboost::PredictorReg);
 }  // namespace dmlc
 namespace xgboost {
+
+namespace {
+// emit the subtree rooted at nid as nested branches accumulating into sum
+void EmitTreeNode(const RegTree& tree, int nid, int indent_level,
+                  std::stringstream* fo) {
+  const std::string indent(2 * indent_level, ' ');
+  const RegTree::Node& n = tree[nid];
+  if (n.IsLeaf()) {
+    *fo << indent << "sum += " << n.LeafValue() << "f;\n";
+  } else {
+    const unsigned fid = n.SplitIndex();
+    *fo << indent << "if (isnan(f[" << fid << "]) ? "
+        << (n.DefaultLeft() ? 1 : 0) << " : (f[" << fid << "] < "
+        << n.SplitCond() << "f)) {\n";
+    EmitTreeNode(tree, n.LeftChild(), indent_level + 1, fo);
+    *fo << indent << "} else {\n";
+    EmitTreeNode(tree, n.RightChild(), indent_level + 1, fo);
+    *fo << indent << "}\n";
+  }
+}
+
+/*
+ * Content key of (model state, matrix, tree range). The ensemble is folded
+ * in node by node, so the key survives address recycling of short-lived
+ * learners and lets two boosters holding identical trees share an entry;
+ * in-place tree rewrites (refresh, process_type=update) change it as well.
+ * The matrix side anchors the pointer with shape, nonzero count and a
+ * bounded sample of leading entries, since a recycled address alone could
+ * alias an unrelated matrix.
+ */
+uint64_t PredictionCacheKey(const gbm::GBTreeModel& model, DMatrix* dmat,
+                            unsigned ntree_limit) {
+  constexpr uint64_t kPrime = 1099511628211ULL;
+  uint64_t h = 14695981039346656037ULL;  // FNV-1a offset basis
+  auto mix = [&h, kPrime](uint64_t v) {
+    h = (h ^ v) * kPrime;
+  };
+
+  mix(model.trees.size());
+  mix(static_cast<uint64_t>(model.param.num_output_group));
+  uint32_t mbits;
+  std::memcpy(&mbits, &model.base_margin, sizeof(mbits));
+  mix(mbits);
+  for (const auto& tree : model.trees) {
+    const std::vector<RegTree::Node>& nodes = tree->GetNodes();
+    const auto* words = reinterpret_cast<const uint32_t*>(nodes.data());
+    const size_t nwords =
+        nodes.size() * sizeof(RegTree::Node) / sizeof(uint32_t);
+    for (size_t i = 0; i < nwords; ++i) {
+      mix(words[i]);
+    }
+  }
+  mix(ntree_limit);
+
+  mix(reinterpret_cast<uintptr_t>(dmat));
+  const MetaInfo& info = dmat->Info();
+  mix(info.num_row_);
+  mix(info.num_col_);
+  mix(info.num_nonzero_);
+  constexpr size_t kMaxSampledEntries = 64;
+  size_t sampled = 0;
+  for (const auto& batch : dmat->GetRowBatches()) {
+    for (size_t i = 0; i < batch.Size() && sampled < kMaxSampledEntries; ++i) {
+      SparsePage::Inst inst = batch[i];
+      for (size_t j = 0; j < inst.size() && sampled < kMaxSampledEntries; ++j) {
+        uint32_t fbits;
+        std::memcpy(&fbits, &inst[j].fvalue, sizeof(fbits));
+        mix(inst[j].index);
+        mix(fbits);
+        ++sampled;
+      }
+    }
+    break;  // the first batch is enough
+  }
+  return h;
+}
+}  // anonymous namespace
+
+GlobalPredictionCache* GlobalPredictionCache::Get() {
+  static GlobalPredictionCache instance;
+  return &instance;
+}
+
+void GlobalPredictionCache::SetCapacityBytes(size_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  capacity_bytes_ = bytes;
+  while (size_bytes_ > capacity_bytes_ && !lru_.empty()) {
+    const Entry& last = lru_.back();
+    size_bytes_ -= last.preds.size() * sizeof(bst_float);
+    index_.erase(last.key);
+    lru_.pop_back();
+  }
+}
+
+bool GlobalPredictionCache::Lookup(const gbm::GBTreeModel& model,
+                                   DMatrix* dmat, unsigned ntree_limit,
+                                   std::vector<bst_float>* out_preds) {
+  const uint64_t key = PredictionCacheKey(model, dmat, ntree_limit);
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(key);
+  if (it == index_.end()) {
+    return false;
+  }
+  lru_.splice(lru_.begin(), lru_, it->second);
+  *out_preds = it->second->preds;
+  return true;
+}
+
+void GlobalPredictionCache::Store(const gbm::GBTreeModel& model,
+                                  DMatrix* dmat, unsigned ntree_limit,
+                                  const std::vector<bst_float>& preds) {
+  const size_t bytes = preds.size() * sizeof(bst_float);
+  const uint64_t key = PredictionCacheKey(model, dmat, ntree_limit);
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (bytes == 0 || bytes > capacity_bytes_) {
+    return;
+  }
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    // refreshed entry: move to the front, the content is identical by key
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return;
+  }
+  lru_.push_front(Entry{key, preds});
+  index_[key] = lru_.begin();
+  size_bytes_ += bytes;
+  while (size_bytes_ > capacity_bytes_) {
+    const Entry& last = lru_.back();
+    size_bytes_ -= last.preds.size() * sizeof(bst_float);
+    index_.erase(last.key);
+    lru_.pop_back();
+  }
+}
+
+std::string Predictor::EmitNativeCode(const gbm::GBTreeModel& model,
+                                      unsigned ntree_limit) const {
+  const int num_group = model.param.num_output_group;
+  auto ntrees = static_cast<unsigned>(model.trees.size());
+  if (ntree_limit != 0 && ntree_limit * num_group < ntrees) {
+    ntrees = ntree_limit * num_group;
+  }
+  std::stringstream fo;
+  fo << std::setprecision(std::numeric_limits<bst_float>::max_digits10);
+  fo << "/* generated by xgboost; compile and link into the scoring tier */\n"
+     << "#include <math.h>\n"
+     << "\n"
+     << "#define XGBOOST_NUM_FEATURE " << model.param.num_feature << "\n"
+     << "#define XGBOOST_NUM_OUTPUT_GROUP " << num_group << "\n"
+     << "\n"
+     << "/* f: XGBOOST_NUM_FEATURE feature values, NAN marks a missing\n"
+     << "   feature; out: XGBOOST_NUM_OUTPUT_GROUP margins */\n"
+     << "void xgboost_predict(const float* f, float* out) {\n";
+  for (int gid = 0; gid < num_group; ++gid) {
+    fo << "  {\n"
+       << "    float sum = " << model.base_margin << "f;\n";
+    for (unsigned i = 0; i < ntrees; ++i) {
+      if (model.tree_info[i] != gid) {
+        continue;
+      }
+      fo << "    /* tree " << i << " */\n";
+      EmitTreeNode(*model.trees[i], 0, 2, &fo);
+    }
+    fo << "    out[" << gid << "] = sum;\n"
+       << "  }\n";
+  }
+  fo << "}\n";
+  return fo.str();
+}
+
+void Predictor::PredictInstance(const SparsePage::Inst& inst,
+                                PredictionContext* ctx,
+                                const gbm::GBTreeModel& model,
+                                unsigned ntree_limit) {
+  this->PredictInstance(inst, &ctx->preds.HostVector(), model, ntree_limit, 0);
+}
+
+void Predictor::PredictBatchSafe(DMatrix* dmat, PredictionContext* ctx,
+                                 const gbm::GBTreeModel& model,
+                                 unsigned ntree_limit) {
+  const MetaInfo& info = dmat->Info();
+  if (ctx->feats.Size() != static_cast<size_t>(model.param.num_feature)) {
+    ctx->feats.Init(model.param.num_feature);
+  }
+  ntree_limit *= model.param.num_output_group;
+  if (ntree_limit == 0 || ntree_limit > model.trees.size()) {
+    ntree_limit = static_cast<unsigned>(model.trees.size());
+  }
+  const int ngroup = model.param.num_output_group;
+  const size_t n = info.num_row_ * ngroup;
+  const std::vector<bst_float>& base_margin =
+      info.base_margin_.ConstHostVector();
+  std::vector<bst_float>& preds = ctx->preds.HostVector();
+  preds.resize(n);
+  for (const auto& batch : dmat->GetRowBatches()) {
+    const size_t nsize = batch.Size();
+    for (size_t i = 0; i < nsize; ++i) {
+      const size_t ridx = batch.base_rowid + i;
+      const unsigned root_id = info.GetRoot(ridx);
+      const SparsePage::Inst inst = batch[i];
+      ctx->feats.Fill(inst);
+      for (int gid = 0; gid < ngroup; ++gid) {
+        bst_float margin = (base_margin.size() == n)
+                               ? base_margin[ridx * ngroup + gid]
+                               : model.base_margin;
+        for (unsigned t = 0; t < ntree_limit; ++t) {
+          if (model.tree_info[t] == gid) {
+            const RegTree& tree = *model.trees[t];
+            const int nid = tree.GetLeafIndex(ctx->feats, root_id);
+            margin += tree[nid].LeafValue();
+          }
+        }
+        preds[ridx * ngroup + gid] = margin;
+      }
+      ctx->feats.Drop(inst);
+    }
+  }
+}
+
 void Predictor::Init(
     const std::vector<std::pair<std::string, std::string>>& cfg,
     const std::vector<std::shared_ptr<DMatrix>>& cache) {
@@ -15,6 +237,45 @@ void Predictor::Init(
     cache_[d.get()].data = d;
   }
 }
+
+bool Predictor::SeedPredictionCache(DMatrix* dmat,
+                                    const std::vector<bst_float>& margin) {
+  auto it = cache_.find(dmat);
+  if (it == cache_.end()) return false;
+  HostDeviceVector<bst_float>& preds = it->second.predictions;
+  preds.Resize(margin.size());
+  std::copy(margin.begin(), margin.end(), preds.HostVector().begin());
+  return true;
+}
+
+bool Predictor::LookupPredictionCache(DMatrix* dmat,
+                                      std::vector<bst_float>* out_margin) const {
+  auto it = cache_.find(dmat);
+  if (it == cache_.end() || it->second.predictions.Size() == 0) return false;
+  *out_margin = it->second.predictions.HostVector();
+  return true;
+}
+
+bool Predictor::PredictionCached(DMatrix* dmat) const {
+  return cache_.find(dmat) != cache_.end();
+}
+
+void Predictor::PredictDeviceDense(const float* d_data, size_t num_row,
+                                   size_t num_col,
+                                   const gbm::GBTreeModel& model,
+                                   unsigned ntree_limit,
+                                   const float** out_d_preds,
+                                   size_t* out_len) {
+  LOG(FATAL) << "Prediction from device memory requires gpu_predictor";
+}
+
+void Predictor::PredictDense(const float* data, size_t num_row, size_t num_col,
+                             float missing, const gbm::GBTreeModel& model,
+                             unsigned ntree_limit,
+                             std::vector<bst_float>* out_preds) {
+  LOG(FATAL) << "In-place dense prediction is not supported by this predictor";
+}
+
 Predictor* Predictor::Create(std::string name) {
   auto* e = ::dmlc::Registry<PredictorReg>::Get()->Find(name);
   if (e == nullptr) {
@@ -83,7 +83,7 @@ struct TrainParam : public dmlc::Parameter<TrainParam> {
   // percentage threshold for treating a feature as sparse
   // e.g. 0.2 indicates a feature with fewer than 20% nonzeros is considered sparse
   double sparse_threshold;
-  // use feature grouping? (default yes)
+  // use feature grouping? (>0 on, 0 off, -1 decide automatically from data)
   int enable_feature_grouping;
   // when grouping features, how many "conflicts" to allow.
   // conflict is when an instance has nonzero values for two or more features
@@ -94,6 +94,21 @@ struct TrainParam : public dmlc::Parameter<TrainParam> {
   // for that feature; to save time, only up to (max_search_group) of existing groups
   // will be considered. If set to zero, ALL existing groups will be examined
   unsigned max_search_group;
+  // store gradient pairs as half precision during histogram construction,
+  // halving the gradient memory traffic at a small precision cost
+  bool compress_grad_pairs;
+  // keep a copy of the gradient pairs physically reordered into
+  // leaf-contiguous order each level, turning the gradient gathers of
+  // deep-node histogram builds into sequential reads
+  bool reorder_grad_pairs;
+  // occupancy threshold below which small nodes build compact
+  // (bin id, entry) histograms instead of dense nbins arrays; 0 disables
+  double sparse_histogram_occupancy;
+  // drop rows whose gradient pair is exactly zero (e.g. zero-weight rows)
+  // from the row set, so partitioning and histogram costs follow the
+  // effective sample size; trades the updater's prediction cache away
+  // whenever rows were actually dropped
+  bool elide_zero_gradient_rows;
 
   // declare the parameters
   DMLC_DECLARE_PARAMETER(TrainParam) {
@@ -206,9 +221,10 @@ struct TrainParam : public dmlc::Parameter<TrainParam> {
     // ------ From cpu quantile histogram -------.
     DMLC_DECLARE_FIELD(sparse_threshold).set_range(0, 1.0).set_default(0.2)
         .describe("percentage threshold for treating a feature as sparse");
-    DMLC_DECLARE_FIELD(enable_feature_grouping).set_lower_bound(0).set_default(0)
+    DMLC_DECLARE_FIELD(enable_feature_grouping).set_lower_bound(-1).set_default(-1)
         .describe("if >0, enable feature grouping to ameliorate work imbalance "
-                  "among worker threads");
+                  "among worker threads; if 0, disable it; if -1 (default), "
+                  "decide automatically from the data");
     DMLC_DECLARE_FIELD(max_conflict_rate).set_range(0, 1.0).set_default(0)
         .describe("when grouping features, how many \"conflicts\" to allow."
        "conflict is when an instance has nonzero values for two or more features."
@@ -219,6 +235,29 @@ struct TrainParam : public dmlc::Parameter<TrainParam> {
                   "groups before creating a new group for that feature; to save time, "
                   "only up to (max_search_group) of existing groups will be "
                   "considered. If set to zero, ALL existing groups will be examined.");
+    DMLC_DECLARE_FIELD(compress_grad_pairs).set_default(false)
+        .describe("store gradient pairs as half precision during histogram "
+                  "construction; halves the gradient memory traffic of every "
+                  "histogram pass at a small precision cost");
+    DMLC_DECLARE_FIELD(reorder_grad_pairs).set_default(false)
+        .describe("keep a copy of the gradient pairs reordered into "
+                  "leaf-contiguous order each level of histogram growth, "
+                  "trading a linear compaction pass per level for sequential "
+                  "gradient reads in deep-node histogram builds");
+    DMLC_DECLARE_FIELD(sparse_histogram_occupancy)
+        .set_range(0.0, 1.0).set_default(0.0)
+        .describe("nodes whose rows can occupy at most this fraction of the "
+                  "histogram bins build compact (bin id, entry) lists instead "
+                  "of dense arrays, cutting memory and split-scan work for "
+                  "deep trees under high max_bin. 0 disables the compact "
+                  "form. Not used in distributed training.");
+    DMLC_DECLARE_FIELD(elide_zero_gradient_rows).set_default(false)
+        .describe("drop rows whose gradient pair is exactly zero, e.g. rows "
+                  "with instance weight 0, from the working row set; "
+                  "partitioning and histogram construction then cost "
+                  "proportionally to the effective sample size. When rows "
+                  "were dropped the updater cannot refresh the prediction "
+                  "cache and the predictor recomputes the new trees instead.");
 
     // add alias of parameters
     DMLC_DECLARE_ALIAS(reg_lambda, lambda);
@@ -7,7 +7,7 @@
 #include <dmlc/json.h>
 #include <dmlc/registry.h>
 #include <algorithm>
-#include <unordered_set>
+#include <cstdint>
 #include <vector>
 #include <limits>
 #include <string>
@@ -44,6 +44,10 @@ SplitEvaluator* SplitEvaluator::Create(const std::string& name) {
 void SplitEvaluator::Init(
     const std::vector<std::pair<std::string, std::string> >& args) {}
 void SplitEvaluator::Reset() {}
+bool SplitEvaluator::IsElasticNetOnly() const { return false; }
+bool SplitEvaluator::SplitAllowed(bst_uint nodeid, bst_uint featureid) const {
+  return true;
+}
 void SplitEvaluator::AddSplit(bst_uint nodeid,
                               bst_uint leftid,
                               bst_uint rightid,
@@ -109,6 +113,8 @@ class ElasticNet final : public SplitEvaluator {
     return r;
   }
 
+  bool IsElasticNetOnly() const override { return true; }
+
   bst_float ComputeSplitScore(bst_uint nodeid,
                              bst_uint featureid,
                              const GradStats& left_stats,
@@ -244,6 +250,10 @@ class MonotonicConstraint final : public SplitEvaluator {
     }
   }
 
+  bool SplitAllowed(bst_uint nodeid, bst_uint featureid) const override {
+    return inner_->SplitAllowed(nodeid, featureid);
+  }
+
   bst_float ComputeScore(bst_uint parentID, const GradStats& stats, bst_float weight)
       const override {
     return inner_->ComputeScore(parentID, stats, weight);
@@ -363,29 +373,28 @@ class InteractionConstraint final : public SplitEvaluator {
     if (params_.interaction_constraints.empty()) {
       return;  // short-circuit if no constraint is specified
     }
+    nwords_ = (params_.num_feature + kBitsPerWord - 1) / kBitsPerWord;
 
-    // Parse interaction constraints
+    // Parse interaction constraints into one feature bitset per group
     std::istringstream iss(params_.interaction_constraints);
     dmlc::JSONReader reader(&iss);
-    // Read std::vector<std::vector<bst_uint>> first and then
-    //   convert to std::vector<std::unordered_set<bst_uint>>
     std::vector<std::vector<bst_uint>> tmp;
     reader.Read(&tmp);
+    interaction_constraints_.clear();
     for (const auto& e : tmp) {
-      interaction_constraints_.emplace_back(e.begin(), e.end());
+      std::vector<uint64_t> group(nwords_, 0);
+      for (bst_uint fid : e) {
+        CHECK_LT(fid, params_.num_feature);
+        group[fid / kBitsPerWord] |= uint64_t(1) << (fid % kBitsPerWord);
+      }
+      interaction_constraints_.push_back(std::move(group));
     }
 
     // Initialise interaction constraints record with all variables permitted for the first node
-    int_cont_.clear();
-    int_cont_.resize(1, std::unordered_set<bst_uint>());
-    int_cont_[0].reserve(params_.num_feature);
-    for (bst_uint i = 0; i < params_.num_feature; ++i) {
-      int_cont_[0].insert(i);
-    }
+    int_cont_.assign(nwords_, ~uint64_t(0));
 
     // Initialise splits record
-    splits_.clear();
-    splits_.resize(1, std::unordered_set<bst_uint>());
+    splits_.assign(nwords_, 0);
   }
 
   SplitEvaluator* GetHostClone() const override {
@@ -428,6 +437,11 @@ class InteractionConstraint final : public SplitEvaluator {
     return inner_->ComputeWeight(parentID, stats);
   }
 
+  bool SplitAllowed(bst_uint nodeid, bst_uint featureid) const override {
+    return CheckInteractionConstraint(featureid, nodeid) &&
+           inner_->SplitAllowed(nodeid, featureid);
+  }
+
   void AddSplit(bst_uint nodeid,
                 bst_uint leftid,
                 bst_uint rightid,
@@ -439,66 +453,67 @@ class InteractionConstraint final : public SplitEvaluator {
     if (params_.interaction_constraints.empty()) {
       return;  // short-circuit if no constraint is specified
     }
-    bst_uint newsize = std::max(leftid, rightid) + 1;
-
-    // Record previous splits for child nodes
-    std::unordered_set<bst_uint> feature_splits = splits_[nodeid];  // fid history of current node
-    feature_splits.insert(featureid);  // add feature of current node
-    splits_.resize(newsize);
-    splits_[leftid] = feature_splits;
-    splits_[rightid] = feature_splits;
-
-    // Resize constraints record, initialise all features to be not permitted for new nodes
-    int_cont_.resize(newsize, std::unordered_set<bst_uint>());
-
-    // Permit features used in previous splits
-    for (bst_uint fid : feature_splits) {
-      int_cont_[leftid].insert(fid);
-      int_cont_[rightid].insert(fid);
+    const size_t newsize = (std::max(leftid, rightid) + 1) * nwords_;
+
+    // Feature history of the children: the path of the current node plus
+    // the feature it just split on. Copied out before the resize so the
+    // source words cannot be invalidated.
+    std::vector<uint64_t> path(splits_.begin() + nodeid * nwords_,
+                               splits_.begin() + (nodeid + 1) * nwords_);
+    path[featureid / kBitsPerWord] |=
+        uint64_t(1) << (featureid % kBitsPerWord);
+    if (splits_.size() < newsize) {
+      splits_.resize(newsize, 0);
+      int_cont_.resize(newsize, 0);
     }
+    std::copy(path.begin(), path.end(), splits_.begin() + leftid * nwords_);
+    std::copy(path.begin(), path.end(), splits_.begin() + rightid * nwords_);
 
-    // Loop across specified interactions in constraints
+    // Features used on the path are always permitted; every constraint
+    // group that contains the whole path contributes its features too
+    std::copy(path.begin(), path.end(), int_cont_.begin() + leftid * nwords_);
+    std::copy(path.begin(), path.end(), int_cont_.begin() + rightid * nwords_);
     for (const auto& constraint : interaction_constraints_) {
-      bst_uint flag = 1;  // flags whether the specified interaction is still relevant
-
-      // Test relevance of specified interaction by checking all previous features are included
-      for (bst_uint checkvar : feature_splits) {
-        if (constraint.count(checkvar) == 0) {
-          flag = 0;
-          break;  // interaction is not relevant due to unmet constraint
+      bool relevant = true;  // whether the path is a subset of the group
+      for (size_t w = 0; w < nwords_; ++w) {
+        if (path[w] & ~constraint[w]) {
+          relevant = false;
+          break;
         }
       }
-
-      // If interaction is still relevant, permit all other features in the interaction
-      if (flag == 1) {
-        for (bst_uint k : constraint) {
-          int_cont_[leftid].insert(k);
-          int_cont_[rightid].insert(k);
+      if (relevant) {
+        for (size_t w = 0; w < nwords_; ++w) {
+          int_cont_[leftid * nwords_ + w] |= constraint[w];
+          int_cont_[rightid * nwords_ + w] |= constraint[w];
         }
       }
     }
   }
 
  private:
+  static const bst_uint kBitsPerWord = 64;
+
   InteractionConstraintParams params_;
   std::unique_ptr<SplitEvaluator> inner_;
-  // interaction_constraints_[constraint_id] contains a single interaction
-  //   constraint, which specifies a group of feature IDs that can interact
-  //   with each other
-  std::vector< std::unordered_set<bst_uint> > interaction_constraints_;
-  // int_cont_[nid] contains the set of all feature IDs that are allowed to
-  //   be used for a split at node nid
-  std::vector< std::unordered_set<bst_uint> > int_cont_;
-  // splits_[nid] contains the set of all feature IDs that have been used for
-  //   splits in node nid and its parents
-  std::vector< std::unordered_set<bst_uint> > splits_;
+  // number of 64-bit words in each feature bitset
+  size_t nwords_{0};
+  // interaction_constraints_[constraint_id] is the feature bitset of a
+  //   single constraint: a group of feature IDs allowed to interact
+  std::vector<std::vector<uint64_t> > interaction_constraints_;
+  // flat per-node bitsets; words [nid*nwords_, (nid+1)*nwords_) hold the
+  //   feature IDs that are allowed to be used for a split at node nid
+  std::vector<uint64_t> int_cont_;
+  // flat per-node bitsets of the feature IDs used for splits on the path
+  //   from the root to node nid, inclusive
+  std::vector<uint64_t> splits_;
 
   // Check interaction constraints. Returns true if a given feature ID is
   //   permissible in a given node; returns false otherwise
   inline bool CheckInteractionConstraint(bst_uint featureid, bst_uint nodeid) const {
     // short-circuit if no constraint is specified
-    return (params_.interaction_constraints.empty()
-            || int_cont_[nodeid].count(featureid) > 0);
+    if (params_.interaction_constraints.empty()) return true;
+    return (int_cont_[nodeid * nwords_ + featureid / kBitsPerWord] >>
+            (featureid % kBitsPerWord)) & 1;
   }
 };
 
@@ -40,6 +40,21 @@ class SplitEvaluator {
   // This will create a clone of the SplitEvaluator in host memory
   virtual SplitEvaluator* GetHostClone() const = 0;
 
+  // Whether this evaluator is exactly the unconstrained elastic net
+  // penalty, i.e. its split score is pure arithmetic on the accumulated
+  // stats with the same reg_lambda/reg_alpha/max_delta_step as TrainParam.
+  // Hot enumeration loops query this once per update and inline the
+  // computation instead of paying a virtual call per candidate bin.
+  // Constraint evaluators return false; note that unconfigured constraint
+  // wrappers already drop themselves in GetHostClone().
+  virtual bool IsElasticNetOnly() const;
+
+  // Whether a feature may be used to split the given node at all.
+  // Enumeration loops call this before touching a feature's histogram,
+  // so constraint evaluators can prune the search up front instead of
+  // scoring the forbidden split as -inf after the work is done.
+  virtual bool SplitAllowed(bst_uint nodeid, bst_uint featureid) const;
+
   // Computes the score (negative loss) resulting from performing this split
   virtual bst_float ComputeSplitScore(bst_uint nodeid,
                                       bst_uint featureid,
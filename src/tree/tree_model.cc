@@ -4,10 +4,12 @@
  * \brief model structure for tree
  */
 #include <xgboost/tree_model.h>
-#include <sstream>
+#include <cstdio>
+#include <algorithm>
 #include <limits>
 #include <cmath>
-#include <iomanip>
+#include <string>
+#include <utility>
 #include "./param.h"
 
 namespace xgboost {
@@ -17,42 +19,55 @@ DMLC_REGISTER_PARAMETER(TreeParam);
 namespace tree {
 DMLC_REGISTER_PARAMETER(TrainParam);
 }
-// internal function to dump regression tree to text
-void DumpRegTree(std::stringstream& fo,  // NOLINT(*)
+namespace {
+// append a floating point value with the same "%g"-style formatting that
+// an ostream produces under setprecision(max_digits10), without paying the
+// stringstream formatting cost once per node
+inline void DumpFloat(std::string* fo, bst_float value) {
+  char buf[32];
+  const int len = snprintf(buf, sizeof(buf), "%.*g",
+                           std::numeric_limits<bst_float>::max_digits10,
+                           static_cast<double>(value));
+  fo->append(buf, static_cast<size_t>(len));
+}
+}  // anonymous namespace
+
+// internal function to dump regression tree to text,
+// appending into a caller supplied buffer
+void DumpRegTree(std::string* fo,
                  const RegTree& tree,
                  const FeatureMap& fmap,
                  int nid, int depth, int add_comma,
-                 bool with_stats, std::string format) {
-  int float_max_precision = std::numeric_limits<bst_float>::max_digits10;
-  if (format == "json") {
+                 bool with_stats, bool json) {
+  if (json) {
     if (add_comma) {
-      fo << ",";
+      fo->append(",");
     }
     if (depth != 0) {
-      fo << std::endl;
-    }
-    for (int i = 0; i < depth + 1; ++i) {
-      fo << "  ";
+      fo->append("\n");
     }
+    fo->append(2 * (depth + 1), ' ');
   } else {
-    for (int i = 0; i < depth; ++i) {
-      fo << '\t';
-    }
+    fo->append(depth, '\t');
   }
   if (tree[nid].IsLeaf()) {
-    if (format == "json") {
-      fo << "{ \"nodeid\": " << nid
-         << ", \"leaf\": " << std::setprecision(float_max_precision) << tree[nid].LeafValue();
+    if (json) {
+      fo->append("{ \"nodeid\": ").append(std::to_string(nid))
+         .append(", \"leaf\": ");
+      DumpFloat(fo, tree[nid].LeafValue());
       if (with_stats) {
-        fo << ", \"cover\": " << std::setprecision(float_max_precision) << tree.Stat(nid).sum_hess;
+        fo->append(", \"cover\": ");
+        DumpFloat(fo, tree.Stat(nid).sum_hess);
       }
-      fo << " }";
+      fo->append(" }");
     } else {
-      fo << nid << ":leaf=" << std::setprecision(float_max_precision) << tree[nid].LeafValue();
+      fo->append(std::to_string(nid)).append(":leaf=");
+      DumpFloat(fo, tree[nid].LeafValue());
       if (with_stats) {
-        fo << ",cover=" << std::setprecision(float_max_precision) << tree.Stat(nid).sum_hess;
+        fo->append(",cover=");
+        DumpFloat(fo, tree.Stat(nid).sum_hess);
       }
-      fo << '\n';
+      fo->append("\n");
     }
   } else {
     // right then left,
@@ -63,15 +78,17 @@ void DumpRegTree(std::stringstream& fo,  // NOLINT(*)
         case FeatureMap::kIndicator: {
           int nyes = tree[nid].DefaultLeft() ?
               tree[nid].RightChild() : tree[nid].LeftChild();
-          if (format == "json") {
-            fo << "{ \"nodeid\": " << nid
-               << ", \"depth\": " << depth
-               << ", \"split\": \"" << fmap.Name(split_index) << "\""
-               << ", \"yes\": " << nyes
-               << ", \"no\": " << tree[nid].DefaultChild();
+          if (json) {
+            fo->append("{ \"nodeid\": ").append(std::to_string(nid))
+               .append(", \"depth\": ").append(std::to_string(depth))
+               .append(", \"split\": \"").append(fmap.Name(split_index))
+               .append("\", \"yes\": ").append(std::to_string(nyes))
+               .append(", \"no\": ").append(std::to_string(tree[nid].DefaultChild()));
           } else {
-            fo << nid << ":[" << fmap.Name(split_index) << "] yes=" << nyes
-               << ",no=" << tree[nid].DefaultChild();
+            fo->append(std::to_string(nid))
+               .append(":[").append(fmap.Name(split_index))
+               .append("] yes=").append(std::to_string(nyes))
+               .append(",no=").append(std::to_string(tree[nid].DefaultChild()));
           }
           break;
         }
@@ -80,82 +97,90 @@ void DumpRegTree(std::stringstream& fo,  // NOLINT(*)
           const int integer_threshold
             = (floored == cond) ? static_cast<int>(floored)
                                 : static_cast<int>(floored) + 1;
-          if (format == "json") {
-            fo << "{ \"nodeid\": " << nid
-               << ", \"depth\": " << depth
-               << ", \"split\": \"" << fmap.Name(split_index) << "\""
-               << ", \"split_condition\": " << integer_threshold
-               << ", \"yes\": " << tree[nid].LeftChild()
-               << ", \"no\": " << tree[nid].RightChild()
-               << ", \"missing\": " << tree[nid].DefaultChild();
+          if (json) {
+            fo->append("{ \"nodeid\": ").append(std::to_string(nid))
+               .append(", \"depth\": ").append(std::to_string(depth))
+               .append(", \"split\": \"").append(fmap.Name(split_index))
+               .append("\", \"split_condition\": ").append(std::to_string(integer_threshold))
+               .append(", \"yes\": ").append(std::to_string(tree[nid].LeftChild()))
+               .append(", \"no\": ").append(std::to_string(tree[nid].RightChild()))
+               .append(", \"missing\": ").append(std::to_string(tree[nid].DefaultChild()));
           } else {
-            fo << nid << ":[" << fmap.Name(split_index) << "<"
-               << integer_threshold
-               << "] yes=" << tree[nid].LeftChild()
-               << ",no=" << tree[nid].RightChild()
-               << ",missing=" << tree[nid].DefaultChild();
+            fo->append(std::to_string(nid))
+               .append(":[").append(fmap.Name(split_index))
+               .append("<").append(std::to_string(integer_threshold))
+               .append("] yes=").append(std::to_string(tree[nid].LeftChild()))
+               .append(",no=").append(std::to_string(tree[nid].RightChild()))
+               .append(",missing=").append(std::to_string(tree[nid].DefaultChild()));
           }
           break;
         }
         case FeatureMap::kFloat:
         case FeatureMap::kQuantitive: {
-          if (format == "json") {
-            fo << "{ \"nodeid\": " << nid
-               << ", \"depth\": " << depth
-               << ", \"split\": \"" << fmap.Name(split_index) << "\""
-               << ", \"split_condition\": " << std::setprecision(float_max_precision) << cond
-               << ", \"yes\": " << tree[nid].LeftChild()
-               << ", \"no\": " << tree[nid].RightChild()
-               << ", \"missing\": " << tree[nid].DefaultChild();
+          if (json) {
+            fo->append("{ \"nodeid\": ").append(std::to_string(nid))
+               .append(", \"depth\": ").append(std::to_string(depth))
+               .append(", \"split\": \"").append(fmap.Name(split_index))
+               .append("\", \"split_condition\": ");
+            DumpFloat(fo, cond);
+            fo->append(", \"yes\": ").append(std::to_string(tree[nid].LeftChild()))
+               .append(", \"no\": ").append(std::to_string(tree[nid].RightChild()))
+               .append(", \"missing\": ").append(std::to_string(tree[nid].DefaultChild()));
           } else {
-            fo << nid << ":[" << fmap.Name(split_index)
-               << "<" << std::setprecision(float_max_precision) << cond
-               << "] yes=" << tree[nid].LeftChild()
-               << ",no=" << tree[nid].RightChild()
-               << ",missing=" << tree[nid].DefaultChild();
+            fo->append(std::to_string(nid))
+               .append(":[").append(fmap.Name(split_index)).append("<");
+            DumpFloat(fo, cond);
+            fo->append("] yes=").append(std::to_string(tree[nid].LeftChild()))
+               .append(",no=").append(std::to_string(tree[nid].RightChild()))
+               .append(",missing=").append(std::to_string(tree[nid].DefaultChild()));
           }
           break;
         }
         default: LOG(FATAL) << "unknown fmap type";
         }
     } else {
-      if (format == "json") {
-        fo << "{ \"nodeid\": " << nid
-           << ", \"depth\": " << depth
-           << ", \"split\": " << split_index
-           << ", \"split_condition\": " << std::setprecision(float_max_precision) << cond
-           << ", \"yes\": " << tree[nid].LeftChild()
-           << ", \"no\": " << tree[nid].RightChild()
-           << ", \"missing\": " << tree[nid].DefaultChild();
+      if (json) {
+        fo->append("{ \"nodeid\": ").append(std::to_string(nid))
+           .append(", \"depth\": ").append(std::to_string(depth))
+           .append(", \"split\": ").append(std::to_string(split_index))
+           .append(", \"split_condition\": ");
+        DumpFloat(fo, cond);
+        fo->append(", \"yes\": ").append(std::to_string(tree[nid].LeftChild()))
+           .append(", \"no\": ").append(std::to_string(tree[nid].RightChild()))
+           .append(", \"missing\": ").append(std::to_string(tree[nid].DefaultChild()));
       } else {
-        fo << nid << ":[f" << split_index << "<"<< std::setprecision(float_max_precision) << cond
-           << "] yes=" << tree[nid].LeftChild()
-           << ",no=" << tree[nid].RightChild()
-           << ",missing=" << tree[nid].DefaultChild();
+        fo->append(std::to_string(nid))
+           .append(":[f").append(std::to_string(split_index)).append("<");
+        DumpFloat(fo, cond);
+        fo->append("] yes=").append(std::to_string(tree[nid].LeftChild()))
+           .append(",no=").append(std::to_string(tree[nid].RightChild()))
+           .append(",missing=").append(std::to_string(tree[nid].DefaultChild()));
       }
     }
     if (with_stats) {
-      if (format == "json") {
-        fo << ", \"gain\": " << std::setprecision(float_max_precision) << tree.Stat(nid).loss_chg
-           << ", \"cover\": " << std::setprecision(float_max_precision) << tree.Stat(nid).sum_hess;
+      if (json) {
+        fo->append(", \"gain\": ");
+        DumpFloat(fo, tree.Stat(nid).loss_chg);
+        fo->append(", \"cover\": ");
+        DumpFloat(fo, tree.Stat(nid).sum_hess);
       } else {
-        fo << ",gain=" << std::setprecision(float_max_precision) << tree.Stat(nid).loss_chg
-           << ",cover=" << std::setprecision(float_max_precision) << tree.Stat(nid).sum_hess;
+        fo->append(",gain=");
+        DumpFloat(fo, tree.Stat(nid).loss_chg);
+        fo->append(",cover=");
+        DumpFloat(fo, tree.Stat(nid).sum_hess);
       }
     }
-    if (format == "json") {
-      fo << ", \"children\": [";
+    if (json) {
+      fo->append(", \"children\": [");
     } else {
-      fo << '\n';
+      fo->append("\n");
     }
-    DumpRegTree(fo, tree, fmap, tree[nid].LeftChild(), depth + 1, false, with_stats, format);
-    DumpRegTree(fo, tree, fmap, tree[nid].RightChild(), depth + 1, true, with_stats, format);
-    if (format == "json") {
-      fo << std::endl;
-      for (int i = 0; i < depth + 1; ++i) {
-        fo << "  ";
-      }
-      fo << "]}";
+    DumpRegTree(fo, tree, fmap, tree[nid].LeftChild(), depth + 1, false, with_stats, json);
+    DumpRegTree(fo, tree, fmap, tree[nid].RightChild(), depth + 1, true, with_stats, json);
+    if (json) {
+      fo->append("\n");
+      fo->append(2 * (depth + 1), ' ');
+      fo->append("]}");
     }
   }
 }
@@ -163,12 +188,119 @@ void DumpRegTree(std::stringstream& fo,  // NOLINT(*)
 std::string RegTree::DumpModel(const FeatureMap& fmap,
                                bool with_stats,
                                std::string format) const {
-  std::stringstream fo("");
+  // resolve the format once instead of comparing strings at every node;
+  // unrecognized formats keep falling back to the text dump
+  const bool json = (format == "json");
+  std::string result;
+  // one node line rarely exceeds this many characters, so reserving up
+  // front keeps the dump to a handful of allocations per tree
+  result.reserve(static_cast<size_t>(param.num_nodes) * 64 + 64);
   for (int i = 0; i < param.num_roots; ++i) {
-    DumpRegTree(fo, *this, fmap, i, 0, false, with_stats, format);
+    DumpRegTree(&result, *this, fmap, i, 0, false, with_stats, json);
+  }
+  return result;
+}
+void RegTree::ReorderNodes(const std::vector<size_t>& visit_counts) {
+  const int num_nodes = param.num_nodes;
+  CHECK_EQ(visit_counts.size(), static_cast<size_t>(num_nodes));
+  // new position -> old node id; roots keep their slots so traversal can
+  // still start at the root index directly
+  std::vector<int> order;
+  order.reserve(num_nodes);
+  for (int rid = 0; rid < param.num_roots; ++rid) {
+    order.push_back(rid);
+  }
+  std::vector<int> cold;
+  std::vector<int> stack;
+  // the colder child is pushed first so the hotter one takes the slot
+  // right after its parent, keeping frequent paths contiguous
+  auto expand = [&](int nid) {
+    const Node& node = nodes_[nid];
+    if (node.IsLeaf()) return;
+    int hot = node.LeftChild();
+    int chill = node.RightChild();
+    if (visit_counts[hot] < visit_counts[chill]) {
+      std::swap(hot, chill);
+    }
+    stack.push_back(chill);
+    stack.push_back(hot);
+  };
+  for (int rid = 0; rid < param.num_roots; ++rid) {
+    expand(rid);
+    while (!stack.empty()) {
+      const int nid = stack.back();
+      stack.pop_back();
+      if (visit_counts[nid] == 0) {
+        // defer the whole unvisited subtree to the tail
+        cold.push_back(nid);
+        continue;
+      }
+      order.push_back(nid);
+      expand(nid);
+    }
+  }
+  for (const int cold_root : cold) {
+    stack.push_back(cold_root);
+    while (!stack.empty()) {
+      const int nid = stack.back();
+      stack.pop_back();
+      order.push_back(nid);
+      expand(nid);
+    }
+  }
+  // deleted nodes are unreachable from the roots; keep them at the end
+  std::vector<int> new_pos(num_nodes, -1);
+  for (size_t i = 0; i < order.size(); ++i) {
+    new_pos[order[i]] = static_cast<int>(i);
+  }
+  for (int nid = 0; nid < num_nodes; ++nid) {
+    if (new_pos[nid] == -1) {
+      new_pos[nid] = static_cast<int>(order.size());
+      order.push_back(nid);
+    }
+  }
+  CHECK_EQ(order.size(), static_cast<size_t>(num_nodes));
+  // apply the permutation to nodes, statistics and leaf vectors
+  std::vector<Node> new_nodes(num_nodes);
+  std::vector<RTreeNodeStat> new_stats(num_nodes);
+  for (int i = 0; i < num_nodes; ++i) {
+    Node node = nodes_[order[i]];
+    if (!node.IsRoot()) {
+      node.SetParent(new_pos[node.Parent()], node.IsLeftChild());
+    }
+    if (!node.IsLeaf()) {
+      node.SetLeftChild(new_pos[node.LeftChild()]);
+      node.SetRightChild(new_pos[node.RightChild()]);
+    }
+    new_nodes[i] = node;
+    new_stats[i] = stats_[order[i]];
   }
-  return fo.str();
+  nodes_ = std::move(new_nodes);
+  stats_ = std::move(new_stats);
+  if (!leaf_vector_.empty()) {
+    const size_t stride = param.size_leaf_vector;
+    std::vector<bst_float> new_leaf(leaf_vector_.size());
+    for (int i = 0; i < num_nodes; ++i) {
+      std::copy(leaf_vector_.begin() + order[i] * stride,
+                leaf_vector_.begin() + (order[i] + 1) * stride,
+                new_leaf.begin() + i * stride);
+    }
+    leaf_vector_ = std::move(new_leaf);
+  }
+  if (node_mean_values_.size() == static_cast<size_t>(num_nodes)) {
+    std::vector<bst_float> new_means(num_nodes);
+    for (int i = 0; i < num_nodes; ++i) {
+      new_means[i] = node_mean_values_[order[i]];
+    }
+    node_mean_values_ = std::move(new_means);
+  }
+  deleted_nodes_.resize(0);
+  for (int i = param.num_roots; i < num_nodes; ++i) {
+    if (nodes_[i].IsDeleted()) deleted_nodes_.push_back(i);
+  }
+  CHECK_EQ(static_cast<int>(deleted_nodes_.size()), param.num_deleted);
 }
+
 void RegTree::FillNodeMeanValues() {
   size_t num_nodes = this->param.num_nodes;
   if (this->node_mean_values_.size() == num_nodes) {
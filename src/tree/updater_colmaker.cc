@@ -16,6 +16,15 @@
 #include "../common/bitmap.h"
 #include "split_evaluator.h"
 
+#if defined(XGBOOST_MM_PREFETCH_PRESENT)
+  #include <xmmintrin.h>
+  #define PREFETCH_READ_T0(addr) _mm_prefetch(reinterpret_cast<const char*>(addr), _MM_HINT_T0)
+#elif defined(XGBOOST_BUILTIN_PREFETCH_PRESENT)
+  #define PREFETCH_READ_T0(addr) __builtin_prefetch(reinterpret_cast<const char*>(addr), 0, 3)
+#else  // no SW pre-fetching available; PREFETCH_READ_T0 is no-op
+  #define PREFETCH_READ_T0(addr) do {} while (0)
+#endif
+
 namespace xgboost {
 namespace tree {
 
@@ -38,16 +47,69 @@ class ColMaker: public TreeUpdater {
     float lr = param_.learning_rate;
     param_.learning_rate = lr / trees.size();
     // build tree
-    for (auto tree : trees) {
-      Builder builder(
-        param_,
-        std::unique_ptr<SplitEvaluator>(spliteval_->GetHostClone()));
-      builder.Update(gpair->ConstHostVector(), dmat, tree);
+    if (trees.size() > 1 && dmat->SingleColBlock() &&
+        !rabit::IsDistributed()) {
+      this->UpdateTaskParallel(gpair, dmat, trees);
+    } else {
+      for (auto tree : trees) {
+        builder_.reset(new Builder(
+          param_,
+          std::unique_ptr<SplitEvaluator>(spliteval_->GetHostClone())));
+        builder_->Update(gpair->ConstHostVector(), dmat, tree);
+      }
     }
     param_.learning_rate = lr;
   }
 
+  bool UpdatePredictionCache(const DMatrix* data,
+                             HostDeviceVector<bst_float>* out_preds) override {
+    if (builder_ == nullptr) {
+      return false;
+    }
+    return builder_->UpdatePredictionCache(data, out_preds);
+  }
+
  protected:
+  // the num_parallel_tree trees of a random-forest round are independent
+  // given the gradients, so their builders run task-parallel over the
+  // shared column page. Nested parallel regions are disabled by default,
+  // which turns the parallel loops inside each builder into serial ones,
+  // so the round scales with the tree count instead of oversubscribing.
+  // Restricted to single-block matrices, where concurrent batch iteration
+  // is safe, and to non-distributed runs, where the collective inside
+  // column sampling is a no-op.
+  void UpdateTaskParallel(HostDeviceVector<GradientPair>* gpair,
+                          DMatrix* dmat,
+                          const std::vector<RegTree*>& trees) {
+    // the per-tree builders are transient here, so the prediction cache
+    // cannot be served from this round (the predictor skips delegation
+    // for multi-tree commits anyway)
+    builder_.reset();
+    // materialize the sorted column page and the host gradients once,
+    // before the builders share them
+    for (const auto& batch : dmat->GetSortedColumnBatches()) {
+      (void)batch;
+      break;
+    }
+    const std::vector<GradientPair>& gpair_h = gpair->ConstHostVector();
+    // clone the evaluators serially, and draw one seed per tree from the
+    // caller's engine: the thread-local engines of the workers would
+    // otherwise repeat the same row and column sampling sequences
+    std::vector<std::unique_ptr<SplitEvaluator>> evaluators;
+    std::vector<uint32_t> seeds;
+    for (size_t i = 0; i < trees.size(); ++i) {
+      evaluators.emplace_back(spliteval_->GetHostClone());
+      seeds.push_back(static_cast<uint32_t>(common::GlobalRandom()()));
+    }
+    const auto ntrees = static_cast<bst_omp_uint>(trees.size());
+    #pragma omp parallel for schedule(dynamic)
+    for (bst_omp_uint i = 0; i < ntrees; ++i) {
+      common::GlobalRandom().seed(seeds[i]);
+      Builder builder(param_, std::move(evaluators[i]));
+      builder.Update(gpair_h, dmat, trees[i]);
+    }
+  }
+
   // training parameter
   TrainParam param_;
   // SplitEvaluator that will be cloned for each Builder
@@ -131,9 +193,52 @@ class ColMaker: public TreeUpdater {
         p_tree->Stat(nid).base_weight = snode_[nid].weight;
         p_tree->Stat(nid).sum_hess = static_cast<float>(snode_[nid].stats.sum_hess);
       }
+      // remember the matrix and tree the final row positions belong to,
+      // so the prediction cache can be updated from them
+      p_last_fmat_ = p_fmat;
+      p_last_tree_ = p_tree;
+    }
+
+    /*!
+     * \brief add the new tree's leaf values onto the cached predictions.
+     *  position_ tracks every row -- including rows dropped by row
+     *  sampling, through the ~nid encoding -- down to its final leaf, so
+     *  the update is a flat sweep instead of a full PredictBatch over the
+     *  training data.
+     */
+    bool UpdatePredictionCache(const DMatrix* data,
+                               HostDeviceVector<bst_float>* p_out_preds) const {
+      if (p_last_fmat_ == nullptr || p_last_tree_ == nullptr ||
+          data != p_last_fmat_) {
+        return false;
+      }
+      std::vector<bst_float>& out_preds = p_out_preds->HostVector();
+      if (out_preds.size() != position_.size()) {
+        return false;
+      }
+      const RegTree& tree = *p_last_tree_;
+      const auto ndata = static_cast<bst_omp_uint>(position_.size());
+      #pragma omp parallel for schedule(static)
+      for (bst_omp_uint ridx = 0; ridx < ndata; ++ridx) {
+        int nid = this->DecodePosition(ridx);
+        // the pruner runs after the grower and may have deleted the leaf
+        // the row ended in; walk up to the leaf that replaced it
+        while (tree[nid].IsDeleted()) {
+          nid = tree[nid].Parent();
+          CHECK_GE(nid, 0);
+        }
+        out_preds[ridx] += tree[nid].LeafValue();
+      }
+      return true;
     }
 
    protected:
+    // number of features the column sampler draws from; the distributed
+    // column maker overrides this with the global count, since a worker's
+    // shard materializes only part of the feature space
+    virtual int64_t GetNumFeature(const DMatrix& fmat) const {
+      return static_cast<int64_t>(fmat.Info().num_col_);
+    }
     // initialize temp data structure
     inline void InitData(const std::vector<GradientPair>& gpair,
                          const DMatrix& fmat,
@@ -168,7 +273,7 @@ class ColMaker: public TreeUpdater {
         }
       }
       {
-        column_sampler_.Init(fmat.Info().num_col_, param_.colsample_bynode,
+        column_sampler_.Init(this->GetNumFeature(fmat), param_.colsample_bynode,
                              param_.colsample_bylevel, param_.colsample_bytree);
       }
       {
@@ -252,8 +357,9 @@ class ColMaker: public TreeUpdater {
       // TODO(tqchen): double check stats order.
       const MetaInfo& info = p_fmat->Info();
       const bool ind = col.size() != 0 && col[0].fvalue == col[col.size() - 1].fvalue;
-      bool need_forward = param_.NeedForwardSearch(p_fmat->GetColDensity(fid), ind);
-      bool need_backward = param_.NeedBackwardSearch(p_fmat->GetColDensity(fid), ind);
+      const float density = p_fmat->Stats().Density(fid);
+      bool need_forward = param_.NeedForwardSearch(density, ind);
+      bool need_backward = param_.NeedBackwardSearch(density, ind);
       const std::vector<int> &qexpand = qexpand_;
       #pragma omp parallel
       {
@@ -390,8 +496,12 @@ class ColMaker: public TreeUpdater {
       }
     }
     // update enumeration solution
+    // d_step is a template argument so the direction-dependent branches
+    // below resolve at compile time; the variant is picked once per
+    // column in UpdateSolution
+    template <int d_step>
     inline void UpdateEnumeration(int nid, GradientPair gstats,
-                                  bst_float fvalue, int d_step, bst_uint fid,
+                                  bst_float fvalue, bst_uint fid,
                                   GradStats &c, std::vector<ThreadEntry> &temp) { // NOLINT(*)
       // get the statistics of nid
       ThreadEntry &e = temp[nid];
@@ -425,9 +535,9 @@ class ColMaker: public TreeUpdater {
       }
     }
     // same as EnumerateSplit, with cacheline prefetch optimization
+    template <int d_step>
     inline void EnumerateSplitCacheOpt(const Entry *begin,
                                        const Entry *end,
-                                       int d_step,
                                        bst_uint fid,
                                        const std::vector<GradientPair> &gpair,
                                        std::vector<ThreadEntry> &temp) { // NOLINT(*)
@@ -455,16 +565,31 @@ class ColMaker: public TreeUpdater {
       // internal cached loop
       for (it = begin; it != align_end; it += align_step) {
         const Entry *p;
+        // gather pass: pull the dependent position/gradient loads of the
+        // whole block together so they overlap, and prefetch the next
+        // block's cache lines while this one is being consumed
+        const bool has_next = (it + align_step) != align_end;
         for (i = 0, p = it; i < kBuffer; ++i, p += d_step) {
+          if (has_next) {
+            const Entry *q = p + align_step;
+            PREFETCH_READ_T0(&position_[q->index]);
+            PREFETCH_READ_T0(&gpair[q->index]);
+          }
           buf_position[i] = position_[p->index];
           buf_gpair[i] = gpair[p->index];
         }
+        // warm the per-node stat entries touched by this block before the
+        // scan pass updates them
+        for (i = 0; i < kBuffer; ++i) {
+          if (buf_position[i] >= 0) {
+            PREFETCH_READ_T0(&temp[buf_position[i]]);
+          }
+        }
         for (i = 0, p = it; i < kBuffer; ++i, p += d_step) {
           const int nid = buf_position[i];
           if (nid < 0) continue;
-          this->UpdateEnumeration(nid, buf_gpair[i],
-                                  p->fvalue, d_step,
-                                  fid, c, temp);
+          this->UpdateEnumeration<d_step>(nid, buf_gpair[i],
+                                          p->fvalue, fid, c, temp);
         }
       }
       // finish up the ending piece
@@ -475,9 +600,8 @@ class ColMaker: public TreeUpdater {
       for (it = align_end, i = 0; it != end; ++i, it += d_step) {
         const int nid = buf_position[i];
         if (nid < 0) continue;
-        this->UpdateEnumeration(nid, buf_gpair[i],
-                                it->fvalue, d_step,
-                                fid, c, temp);
+        this->UpdateEnumeration<d_step>(nid, buf_gpair[i],
+                                        it->fvalue, fid, c, temp);
       }
       // finish updating all statistics, check if it is possible to include all sum statistics
       for (int nid : qexpand) {
@@ -503,16 +627,16 @@ class ColMaker: public TreeUpdater {
     }
 
     // enumerate the split values of specific feature
+    template <int d_step>
     inline void EnumerateSplit(const Entry *begin,
                                const Entry *end,
-                               int d_step,
                                bst_uint fid,
                                const std::vector<GradientPair> &gpair,
                                const MetaInfo &info,
                                std::vector<ThreadEntry> &temp) { // NOLINT(*)
       // use cacheline aware optimization
       if (GradStats::kSimpleStats != 0 && param_.cache_opt != 0) {
-        EnumerateSplitCacheOpt(begin, end, d_step, fid, gpair, temp);
+        EnumerateSplitCacheOpt<d_step>(begin, end, fid, gpair, temp);
         return;
       }
       const std::vector<int> &qexpand = qexpand_;
@@ -587,6 +711,9 @@ class ColMaker: public TreeUpdater {
                                 const std::vector<GradientPair> &gpair,
                                 DMatrix*p_fmat) {
       const MetaInfo& info = p_fmat->Info();
+      // per-column densities come precomputed; taking the reference here
+      // also makes sure the statistics pass runs outside the parallel loop
+      const DatasetStats& dmat_stats = p_fmat->Stats();
       // start enumeration
       const auto num_features = static_cast<bst_omp_uint>(feat_set.size());
       #if defined(_OPENMP)
@@ -594,26 +721,40 @@ class ColMaker: public TreeUpdater {
       #endif
       int poption = param_.parallel_option;
       if (poption == 2) {
-        poption = static_cast<int>(num_features) * 2 < this->nthread_ ? 1 : 0;
+        // choose intra-column parallelism when there are too few columns to
+        // keep all threads busy, or when the columns are long enough that
+        // segmenting each of them across threads pays for the boundary merge
+        // in ParallelFindSplit
+        constexpr size_t kMinRowsPerThread = 64 * 1024;
+        const bool few_cols = static_cast<int>(num_features) * 2 < this->nthread_;
+        const bool long_cols =
+            static_cast<int>(num_features) < this->nthread_ &&
+            info.num_row_ >= kMinRowsPerThread * static_cast<size_t>(this->nthread_);
+        poption = (few_cols || long_cols) ? 1 : 0;
       }
       if (poption == 0) {
         #pragma omp parallel for schedule(dynamic, batch_size)
         for (bst_omp_uint i = 0; i < num_features; ++i) {
           int fid = feat_set[i];
+          // under column-wise data split a worker enumerates only the
+          // features of its shard; candidates for the rest arrive through
+          // SyncBestSolution
+          if (static_cast<size_t>(fid) >= batch.Size()) continue;
           const int tid = omp_get_thread_num();
           auto c = batch[fid];
           const bool ind = c.size() != 0 && c[0].fvalue == c[c.size() - 1].fvalue;
-          if (param_.NeedForwardSearch(p_fmat->GetColDensity(fid), ind)) {
-            this->EnumerateSplit(c.data(), c.data() + c.size(), +1,
-                                 fid, gpair, info, stemp_[tid]);
+          if (param_.NeedForwardSearch(dmat_stats.Density(fid), ind)) {
+            this->EnumerateSplit<+1>(c.data(), c.data() + c.size(),
+                                     fid, gpair, info, stemp_[tid]);
           }
-          if (param_.NeedBackwardSearch(p_fmat->GetColDensity(fid), ind)) {
-            this->EnumerateSplit(c.data() + c.size() - 1, c.data() - 1, -1,
-                                 fid, gpair, info, stemp_[tid]);
+          if (param_.NeedBackwardSearch(dmat_stats.Density(fid), ind)) {
+            this->EnumerateSplit<-1>(c.data() + c.size() - 1, c.data() - 1,
+                                     fid, gpair, info, stemp_[tid]);
           }
         }
       } else {
         for (bst_omp_uint fid = 0; fid < num_features; ++fid) {
+          if (static_cast<size_t>(fid) >= batch.Size()) continue;
           this->ParallelFindSplit(batch[fid], fid,
                                   p_fmat, gpair);
         }
@@ -747,7 +888,14 @@ class ColMaker: public TreeUpdater {
     std::vector<int> qexpand_;
     // Evaluates splits and computes optimal weights for a given split
     std::unique_ptr<SplitEvaluator> spliteval_;
+    // matrix and tree of the last Update, consumed by the prediction
+    // cache update
+    DMatrix* p_last_fmat_{nullptr};
+    const RegTree* p_last_tree_{nullptr};
   };
+  // builder of the last sequentially grown tree, kept alive so its final
+  // row positions can answer UpdatePredictionCache
+  std::unique_ptr<Builder> builder_;
 };
 
 // distributed column maker
@@ -799,6 +947,14 @@ class DistColMaker : public ColMaker {
     }
 
    protected:
+    int64_t GetNumFeature(const DMatrix& fmat) const override {
+      // workers hold disjoint feature shards under column-wise data split;
+      // sample from the union, so the feature sets broadcast by the column
+      // sampler cover every shard
+      auto num_col = static_cast<int64_t>(fmat.Info().num_col_);
+      rabit::Allreduce<rabit::op::Max>(&num_col, 1);
+      return num_col;
+    }
     void SetNonDefaultPosition(const std::vector<int> &qexpand, DMatrix *p_fmat,
                                const RegTree &tree) override {
       // step 2, classify the non-default data into right places
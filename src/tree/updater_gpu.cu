@@ -534,6 +534,8 @@ class GPUMaker : public TreeUpdater {
   dh::DVec<GradientPair> gradSums;
   dh::DVec<GradientPair> gradScans;
   dh::DVec<ExactSplitCandidate> nodeSplits;
+  /** number of nodes split at the current level, tracked on the device */
+  dh::DVec<int> activeSplitCount;
   int nVals;
   int nRows;
   int nCols;
@@ -599,6 +601,13 @@ class GPUMaker : public TreeUpdater {
       NodeIdT nodeStart = nNodes - 1;
       initNodeData(i, nodeStart, nNodes);
       findSplit(i, nodeStart, nNodes);
+      // the active frontier is tracked on the device by split2node; a single
+      // scalar read-back per level lets us stop orchestrating kernel waves
+      // over levels whose nodes are all leaves. The dense per-level work
+      // below grows as 2^level, so bailing out early matters at depth.
+      if (activeSplitCount.AsVector()[0] == 0) {
+        break;
+      }
     }
     // mark all the used nodes with unused children as leaf nodes
     markLeaves();
@@ -606,6 +615,7 @@ class GPUMaker : public TreeUpdater {
   }
 
   void split2node(int nNodes, NodeIdT nodeStart) {
+    activeSplitCount.Fill(0);
     auto d_nodes = nodes.GetSpan();
     auto d_gradScans = gradScans.GetSpan();
     auto d_gradSums = gradSums.GetSpan();
@@ -613,6 +623,7 @@ class GPUMaker : public TreeUpdater {
     auto d_colIds = colIds.GetSpan();
     auto d_vals = vals.Current();
     auto d_nodeSplits = nodeSplits.Data();
+    auto d_activeSplitCount = activeSplitCount.Data();
     int nUniqKeys = nNodes;
     float min_split_loss = param.min_split_loss;
     auto gpu_param = GPUTrainingParam(param);
@@ -647,6 +658,7 @@ class GPUMaker : public TreeUpdater {
         d_nodes[absNodeId].SetSplit(thresh, colId,
                                     missingLeft ? kLeftDir : kRightDir, lGradSum,
                                     rGradSum);
+        atomicAdd(d_activeSplitCount, 1);
       } else {
         // cannot be split further, so this node is a leaf!
         d_nodes[absNodeId].root_gain = -FLT_MAX;
@@ -673,7 +685,8 @@ class GPUMaker : public TreeUpdater {
                 &colOffsets, offsetSize, &gradsInst, nRows, &nodeAssigns, nVals,
                 &nodeLocations, nVals, &nodes, maxNodes, &nodeAssignsPerInst,
                 nRows, &gradSums, maxLeaves * nCols, &gradScans, nVals,
-                &nodeSplits, maxLeaves, &tmpScanGradBuff, tmpBuffSize,
+                &nodeSplits, maxLeaves, &activeSplitCount, 1,
+                &tmpScanGradBuff, tmpBuffSize,
                 &tmpScanKeyBuff, tmpBuffSize, &colIds, nVals);
   }
 
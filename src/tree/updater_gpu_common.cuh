@@ -48,6 +48,38 @@ DEV_INLINE void AtomicAddGpair(OutputGradientT* dest,
             static_cast<typename OutputGradientT::ValueT>(gpair.GetHess()));
 }
 
+// Atomic add to a single-precision accumulator that feeds the rounding error
+// of each addition back into the destination. atomicAdd returns the previous
+// value, so the error of the rounded sum can be reconstructed exactly with
+// Knuth's TwoSum; adding it back bounds the error at O(ulp) per call instead
+// of growing with the length of the sum (Kahan-Babuska summation). For
+// double-precision accumulators this compensation is unnecessary and the
+// function degenerates to AtomicAddGpair.
+template <typename OutputGradientT, typename InputGradientT>
+DEV_INLINE void AtomicAddGpairCompensated(OutputGradientT* dest,
+                                          const InputGradientT& gpair) {
+  using ValueT = typename OutputGradientT::ValueT;
+  if (sizeof(ValueT) == sizeof(double)) {
+    AtomicAddGpair(dest, gpair);
+    return;
+  }
+  auto dst_ptr = reinterpret_cast<ValueT*>(dest);
+  ValueT g = static_cast<ValueT>(gpair.GetGrad());
+  ValueT h = static_cast<ValueT>(gpair.GetHess());
+  ValueT old_g = atomicAdd(dst_ptr, g);
+  ValueT old_h = atomicAdd(dst_ptr + 1, h);
+  // the hardware rounds old + g the same way as the sum below, so the
+  // residual of TwoSum is exactly the error the atomic add committed
+  ValueT sum_g = old_g + g;
+  ValueT v_g = sum_g - old_g;
+  ValueT err_g = (old_g - (sum_g - v_g)) + (g - v_g);
+  ValueT sum_h = old_h + h;
+  ValueT v_h = sum_h - old_h;
+  ValueT err_h = (old_h - (sum_h - v_h)) + (h - v_h);
+  if (err_g != ValueT(0)) { atomicAdd(dst_ptr, err_g); }
+  if (err_h != ValueT(0)) { atomicAdd(dst_ptr + 1, err_h); }
+}
+
 struct GPUTrainingParam {
   // minimum amount of hessian(weight) allowed in a child
   float min_child_weight;
@@ -10,6 +10,7 @@
 #include <xgboost/tree_updater.h>
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <memory>
 #include <limits>
 #include <queue>
@@ -39,7 +40,9 @@ struct GPUHistMakerTrainParam
   // declare parameters
   DMLC_DECLARE_PARAMETER(GPUHistMakerTrainParam) {
     DMLC_DECLARE_FIELD(single_precision_histogram).set_default(false).describe(
-        "Use single precision to build histograms.");
+        "Use single precision to build histograms. Halves the shared memory "
+        "footprint of the histogram kernels; global accumulation is "
+        "error-compensated.");
     DMLC_DECLARE_FIELD(gpu_batch_nrows)
         .set_lower_bound(-1)
         .set_default(0)
@@ -161,19 +164,26 @@ __device__ void EvaluateFeature(
   }
 }
 
+// Everything specific to one node when several nodes are evaluated in a
+// single launch
+template <typename GradientSumT>
+struct NodeSplitInputs {
+  common::Span<const GradientSumT> histogram;
+  DeviceNodeStats node;
+  ValueConstraint value_constraint;
+};
+
 template <int BLOCK_THREADS, typename GradientSumT>
-__global__ void EvaluateSplitKernel(
-    common::Span<const GradientSumT>
-        node_histogram,               // histogram for gradients
+__global__ void EvaluateSplitsKernel(
+    common::Span<const NodeSplitInputs<GradientSumT>>
+        d_nodes,                          // nodes sharing this launch
     common::Span<const int> feature_set,  // Selected features
-    DeviceNodeStats node,
     common::Span<const uint32_t>
         d_feature_segments,                       // row_ptr form HistCutMatrix
     common::Span<const float> d_fidx_min_map,     // min_value
     common::Span<const float> d_gidx_fvalue_map,  // cut
     GPUTrainingParam gpu_param,
-    common::Span<DeviceSplitCandidate> split_candidates,  // resulting split
-    ValueConstraint value_constraint,
+    common::Span<DeviceSplitCandidate> split_candidates,  // resulting splits
     common::Span<int> d_monotonic_constraints) {
   // KeyValuePair here used as threadIdx.x -> gain_value
   typedef cub::KeyValuePair<int, float> ArgMaxT;
@@ -200,14 +210,17 @@ __global__ void EvaluateSplitKernel(
 
   __syncthreads();
 
-  // One block for each feature. Features are sampled, so fidx != blockIdx.x
-  int fidx = feature_set[blockIdx.x];
+  // One block for each (node, feature) pair. Features are sampled, so
+  // fidx != blockIdx.x
+  const NodeSplitInputs<GradientSumT>& inputs =
+      d_nodes[blockIdx.x / feature_set.size()];
+  int fidx = feature_set[blockIdx.x % feature_set.size()];
   int constraint = d_monotonic_constraints[fidx];
   EvaluateFeature<BLOCK_THREADS, SumReduceT, BlockScanT, MaxReduceT>(
-      fidx, node_histogram,
+      fidx, inputs.histogram,
       d_feature_segments, d_fidx_min_map[fidx], d_gidx_fvalue_map,
-      &best_split, node, gpu_param, &temp_storage, constraint,
-      value_constraint);
+      &best_split, inputs.node, gpu_param, &temp_storage, constraint,
+      inputs.value_constraint);
 
   __syncthreads();
 
@@ -382,7 +395,9 @@ __global__ void SharedMemHistKernel(size_t row_stride, const bst_uint* d_ridx,
   }
   __syncthreads();
   for (auto i : dh::BlockStrideRange(0, null_gidx_value)) {
-    AtomicAddGpair(d_node_hist + i, smem_arr[i]);
+    // block partials form long global accumulation chains; compensate them
+    // so that single-precision histograms stay accurate
+    AtomicAddGpairCompensated(d_node_hist + i, smem_arr[i]);
   }
 }
 
@@ -501,6 +516,16 @@ struct DeviceShard {
   thrust::device_vector<size_t> row_ptrs;
   /*! \brief On-device feature set, only actually used on one of the devices */
   thrust::device_vector<int> feature_set_d;
+  /*!
+   * \brief the feature set feature_set_d currently holds. Holding the
+   *  shared_ptr pins the host copy: the sampler pool never recycles a
+   *  set that is still referenced, and the only pinned vector Init
+   *  rewrites in place is the full-feature list, which it rewrites with
+   *  identical contents. Pointer equality therefore means the device
+   *  copy is current and the upload can be skipped; per-level sets are
+   *  stable within a tree, so each depth uploads once.
+   */
+  std::shared_ptr<std::vector<int>> uploaded_feature_set_;
   /*! The row offset for this shard. */
   bst_uint row_begin_idx;
   bst_uint row_end_idx;
@@ -527,13 +552,13 @@ struct DeviceShard {
         param(_param),
         prediction_cache_initialised(false) {}
 
-  /* Init row_ptrs and row_stride */
-  void InitRowPtrs(const SparsePage& row_batch) {
+  /* Init row_ptrs and row_stride from the concatenated row offsets of all
+     pages */
+  void InitRowPtrs(const std::vector<size_t>& row_offsets) {
     dh::safe_cuda(cudaSetDevice(device_id_));
-    const auto& offset_vec = row_batch.offset.HostVector();
     row_ptrs.resize(n_rows + 1);
-    thrust::copy(offset_vec.data() + row_begin_idx,
-                 offset_vec.data() + row_end_idx + 1,
+    thrust::copy(row_offsets.data() + row_begin_idx,
+                 row_offsets.data() + row_end_idx + 1,
                  row_ptrs.begin());
     auto row_iter = row_ptrs.begin();
     // find the maximum row size for converting to ELLPack
@@ -555,10 +580,53 @@ struct DeviceShard {
      min_fvalue, feature_segments, node_sum_gradients, ridx_segments,
      hist
   */
-  void InitCompressedData(
-      const common::HistCutMatrix& hmat, const SparsePage& row_batch);
+  void InitCompressedData(const common::HistCutMatrix& hmat);
+
+  /* Upper bound, in bytes, on the device memory InitCompressedData and
+     subsequent histogram growth will need for this shard. Mirrors the
+     allocation list in InitCompressedData; keep the two in sync. Valid
+     once InitRowPtrs has computed row_stride. */
+  size_t EstimateRequiredMemory(const common::HistCutMatrix& hmat) const {
+    int max_nodes =
+        param.max_leaves > 0 ? param.max_leaves * 2 : MaxNodesDepth(param.max_depth);
+    size_t n_total_bins = hmat.row_ptr.back();
+    size_t bytes = 0;
+    // per-row working set: gpair, double-buffered ridx and position,
+    // prediction cache
+    bytes += static_cast<size_t>(n_rows) *
+             (sizeof(GradientPair) + 2 * sizeof(bst_uint) + 2 * sizeof(int) +
+              sizeof(bst_float));
+    bytes += static_cast<size_t>(max_nodes) * sizeof(GradientPair);
+    bytes += hmat.row_ptr.size() * sizeof(uint32_t) +
+             (hmat.cut.size() + hmat.min_val.size()) * sizeof(bst_float);
+    bytes += param.monotone_constraints.size() * sizeof(int);
+    // row offsets are resident while pages stream through compression
+    bytes += (static_cast<size_t>(n_rows) + 1) * sizeof(size_t);
+    // compressed ELLPack matrix
+    bytes += common::CompressedBufferWriter::CalculateBufferSize(
+        row_stride * n_rows, n_total_bins + 1);
+    // node histograms grow until the recycling threshold kicks in
+    size_t hist_elements = std::min<size_t>(
+        static_cast<size_t>(max_nodes) * n_total_bins * 2,
+        hist.kStopGrowingSize + n_total_bins * 2);
+    bytes += hist_elements * sizeof(typename GradientSumT::ValueT);
+    return bytes;
+  }
 
-  void CreateHistIndices(const SparsePage& row_batch);
+  /* Compress the intersection of this shard's rows with one page into the
+     ELLPack buffer. Called once per page; only the compressed form stays
+     resident on the device, so multi-page (external memory) matrices
+     stream through without their raw entries ever being held here.
+     row_offsets are the concatenated row offsets of all pages. */
+  void CreateHistIndices(const SparsePage& row_batch,
+                         const std::vector<size_t>& row_offsets);
+
+  /* Release structures only needed while pages are being compressed */
+  void FinishCompressedData() {
+    dh::safe_cuda(cudaSetDevice(device_id_));
+    row_ptrs.resize(0);
+    row_ptrs.shrink_to_fit();
+  }
 
   ~DeviceShard() {
   }
@@ -580,37 +648,77 @@ struct DeviceShard {
     hist.Reset();
   }
 
-  DeviceSplitCandidate EvaluateSplit(int nidx,
-                                     const std::vector<int>& feature_set,
-                                     ValueConstraint value_constraint) {
+  /* Evaluate the splits of several nodes (e.g. both children of one expanded
+     node) with a single kernel launch, one synchronization and one
+     device-to-host transfer. For deep trees the per-node launch latency and
+     sync gaps dominate, so sibling nodes share one trip through the
+     pipeline. */
+  std::vector<DeviceSplitCandidate> EvaluateSplits(
+      const std::vector<int>& nidxs,
+      const std::shared_ptr<std::vector<int>>& feature_set,
+      const std::vector<ValueConstraint>& value_constraints) {
     dh::safe_cuda(cudaSetDevice(device_id_));
-    auto d_split_candidates = temp_memory.GetSpan<DeviceSplitCandidate>(feature_set.size());
-    feature_set_d.resize(feature_set.size());
+    size_t n_nodes = nidxs.size();
+    size_t n_features = feature_set->size();
+    // lay out the per-node inputs followed by the split candidates in a
+    // single temporary allocation
+    size_t inputs_bytes = sizeof(NodeSplitInputs<GradientSumT>) * n_nodes;
+    auto d_temp = temp_memory.GetSpan<char>(
+        inputs_bytes + sizeof(DeviceSplitCandidate) * n_nodes * n_features);
+    auto d_node_inputs = common::Span<NodeSplitInputs<GradientSumT>>(
+        reinterpret_cast<NodeSplitInputs<GradientSumT>*>(d_temp.data()),
+        n_nodes);
+    auto d_split_candidates = common::Span<DeviceSplitCandidate>(
+        reinterpret_cast<DeviceSplitCandidate*>(d_temp.data() + inputs_bytes),
+        n_nodes * n_features);
+    // with column sampling the set of a depth only changes when the
+    // sampler hands out a different vector; skip the host round trip
+    // while the uploaded copy is current
+    if (uploaded_feature_set_ != feature_set) {
+      feature_set_d.resize(n_features);
+      dh::safe_cuda(cudaMemcpy(feature_set_d.data().get(),
+                               feature_set->data(),
+                               sizeof(int) * n_features, cudaMemcpyDefault));
+      uploaded_feature_set_ = feature_set;
+    }
     auto d_features = common::Span<int>(feature_set_d.data().get(),
-                                        feature_set_d.size());
-    dh::safe_cuda(cudaMemcpy(d_features.data(), feature_set.data(),
-                             d_features.size_bytes(), cudaMemcpyDefault));
-    DeviceNodeStats node(node_sum_gradients[nidx], nidx, param);
+                                        n_features);
+
+    std::vector<NodeSplitInputs<GradientSumT>> h_node_inputs(n_nodes);
+    for (size_t i = 0; i < n_nodes; ++i) {
+      int nidx = nidxs[i];
+      h_node_inputs[i] = NodeSplitInputs<GradientSumT>{
+          hist.GetNodeHistogram(nidx),
+          DeviceNodeStats(node_sum_gradients[nidx], nidx, param),
+          value_constraints[i]};
+    }
+    dh::safe_cuda(cudaMemcpy(d_node_inputs.data(), h_node_inputs.data(),
+                             inputs_bytes, cudaMemcpyDefault));
 
-    // One block for each feature
+    // One block for each (node, feature) pair
     int constexpr BLOCK_THREADS = 256;
-    EvaluateSplitKernel<BLOCK_THREADS, GradientSumT>
-      <<<uint32_t(feature_set.size()), BLOCK_THREADS, 0>>>
-      (hist.GetNodeHistogram(nidx), d_features, node,
+    EvaluateSplitsKernel<BLOCK_THREADS, GradientSumT>
+      <<<uint32_t(n_nodes * n_features), BLOCK_THREADS, 0>>>
+      (common::Span<const NodeSplitInputs<GradientSumT>>(
+           d_node_inputs.data(), d_node_inputs.size()),
+       d_features,
        cut_.feature_segments.GetSpan(), cut_.min_fvalue.GetSpan(),
        cut_.gidx_fvalue_map.GetSpan(), GPUTrainingParam(param),
-       d_split_candidates, value_constraint, monotone_constraints.GetSpan());
+       d_split_candidates, monotone_constraints.GetSpan());
 
-    dh::safe_cuda(cudaDeviceSynchronize());
-    std::vector<DeviceSplitCandidate> split_candidates(feature_set.size());
+    // the blocking copy below also serializes with the kernel on the
+    // default stream
+    std::vector<DeviceSplitCandidate> split_candidates(n_nodes * n_features);
     dh::safe_cuda(cudaMemcpy(split_candidates.data(), d_split_candidates.data(),
                              split_candidates.size() * sizeof(DeviceSplitCandidate),
                              cudaMemcpyDeviceToHost));
-    DeviceSplitCandidate best_split;
-    for (auto candidate : split_candidates) {
-      best_split.Update(candidate, param);
+    std::vector<DeviceSplitCandidate> best_splits(n_nodes);
+    for (size_t i = 0; i < n_nodes; ++i) {
+      for (size_t j = 0; j < n_features; ++j) {
+        best_splits[i].Update(split_candidates[i * n_features + j], param);
+      }
     }
-    return best_split;
+    return best_splits;
   }
 
   void BuildHist(int nidx) {
@@ -793,7 +901,9 @@ struct GlobalMemHistBuilder : public GPUHistBuilderBase<GradientSumT> {
         int gidx = d_gidx[ridx * row_stride + idx % row_stride];
 
         if (gidx != null_gidx_value) {
-          AtomicAddGpair(d_node_hist + gidx, d_gpair[ridx]);
+          // every element accumulates directly into global memory here, so
+          // single-precision histograms need the compensated add
+          AtomicAddGpairCompensated(d_node_hist + gidx, d_gpair[ridx]);
         }
       });
   }
@@ -801,7 +911,7 @@ struct GlobalMemHistBuilder : public GPUHistBuilderBase<GradientSumT> {
 
 template <typename GradientSumT>
 inline void DeviceShard<GradientSumT>::InitCompressedData(
-    const common::HistCutMatrix& hmat, const SparsePage& row_batch) {
+    const common::HistCutMatrix& hmat) {
   n_bins = hmat.row_ptr.back();
   null_gidx_value = hmat.row_ptr.back();
 
@@ -843,8 +953,6 @@ inline void DeviceShard<GradientSumT>::InitCompressedData(
 
   int nbits = common::detail::SymbolBits(num_symbols);
 
-  CreateHistIndices(row_batch);
-
   gidx = common::CompressedIterator<uint32_t>(gidx_buffer.Data(), num_symbols);
 
   // check if we can use shared memory for building histograms
@@ -863,54 +971,92 @@ inline void DeviceShard<GradientSumT>::InitCompressedData(
 
 
 template <typename GradientSumT>
-inline void DeviceShard<GradientSumT>::CreateHistIndices(const SparsePage& row_batch) {
+inline void DeviceShard<GradientSumT>::CreateHistIndices(
+    const SparsePage& row_batch, const std::vector<size_t>& row_offsets) {
+  // intersection of this shard's rows with the page
+  const size_t page_row_begin =
+      std::max<size_t>(row_begin_idx, row_batch.base_rowid);
+  const size_t page_row_end =
+      std::min<size_t>(row_end_idx, row_batch.base_rowid + row_batch.Size());
+  if (page_row_begin >= page_row_end) return;
+  const size_t span_nrows = page_row_end - page_row_begin;
+  // entry offset of the page start; in-page entry positions are relative
+  // to it while row_offsets are global
+  const size_t page_ent_begin = row_offsets[row_batch.base_rowid];
+
+  dh::safe_cuda(cudaSetDevice(device_id_));
   int num_symbols = n_bins + 1;
-  // bin and compress entries in batches of rows
+  // bin and compress entries in batches of rows; the batch size heuristic
+  // is halved relative to the single-buffered version since the pipeline
+  // below keeps two staging buffers alive
   size_t gpu_batch_nrows =
       std::min
-      (dh::TotalMemory(device_id_) / (16 * row_stride * sizeof(Entry)),
-       static_cast<size_t>(n_rows));
+      (dh::TotalMemory(device_id_) / (32 * row_stride * sizeof(Entry)),
+       span_nrows);
   const std::vector<Entry>& data_vec = row_batch.data.HostVector();
 
-  thrust::device_vector<Entry> entries_d(gpu_batch_nrows * row_stride);
-  size_t gpu_nbatches = dh::DivRoundUp(n_rows, gpu_batch_nrows);
+  size_t gpu_nbatches = dh::DivRoundUp(span_nrows, gpu_batch_nrows);
+
+  /* double-buffered pipeline: while one batch is in flight on its stream
+     (async H2D copy, then the compression kernel), the next batch is
+     staged into the other pinned buffer on the host. The compression
+     kernel writes the shared ELLPack words atomically, so concurrent
+     batches are safe, and setup time is bounded by the PCIe copy instead
+     of a serialized stage-copy-compress sequence per batch */
+  constexpr size_t kPipelineDepth = 2;
+  cudaStream_t streams[kPipelineDepth];
+  Entry* staging[kPipelineDepth];
+  thrust::device_vector<Entry> entries_d[kPipelineDepth];
+  for (size_t k = 0; k < kPipelineDepth; ++k) {
+    dh::safe_cuda(cudaStreamCreateWithFlags(&streams[k], cudaStreamNonBlocking));
+    dh::safe_cuda(cudaMallocHost(&staging[k],
+                                 gpu_batch_nrows * row_stride * sizeof(Entry)));
+    entries_d[k].resize(gpu_batch_nrows * row_stride);
+  }
 
   for (size_t gpu_batch = 0; gpu_batch < gpu_nbatches; ++gpu_batch) {
-    size_t batch_row_begin = gpu_batch * gpu_batch_nrows;
-    size_t batch_row_end = (gpu_batch + 1) * gpu_batch_nrows;
-    if (batch_row_end > n_rows) {
-      batch_row_end = n_rows;
+    const size_t k = gpu_batch % kPipelineDepth;
+    // global row range of this batch
+    size_t batch_row_begin = page_row_begin + gpu_batch * gpu_batch_nrows;
+    size_t batch_row_end = batch_row_begin + gpu_batch_nrows;
+    if (batch_row_end > page_row_end) {
+      batch_row_end = page_row_end;
     }
     size_t batch_nrows = batch_row_end - batch_row_begin;
+    const size_t ent_begin = row_offsets[batch_row_begin];
+    const size_t ent_end = row_offsets[batch_row_end];
     // number of entries in this batch.
-    size_t n_entries = row_ptrs[batch_row_end] - row_ptrs[batch_row_begin];
+    size_t n_entries = ent_end - ent_begin;
+    // drain the slot's previous batch before overwriting its staging buffer
+    dh::safe_cuda(cudaStreamSynchronize(streams[k]));
+    std::memcpy(staging[k], data_vec.data() + (ent_begin - page_ent_begin),
+                n_entries * sizeof(Entry));
     // copy data entries to device.
     dh::safe_cuda
-        (cudaMemcpy
-         (entries_d.data().get(), data_vec.data() + row_ptrs[batch_row_begin],
-          n_entries * sizeof(Entry), cudaMemcpyDefault));
+        (cudaMemcpyAsync
+         (entries_d[k].data().get(), staging[k],
+          n_entries * sizeof(Entry), cudaMemcpyHostToDevice, streams[k]));
     const dim3 block3(32, 8, 1);  // 256 threads
-    const dim3 grid3(dh::DivRoundUp(n_rows, block3.x),
+    const dim3 grid3(dh::DivRoundUp(batch_nrows, block3.x),
                      dh::DivRoundUp(row_stride, block3.y), 1);
-    compress_bin_ellpack_k<<<grid3, block3>>>
+    compress_bin_ellpack_k<<<grid3, block3, 0, streams[k]>>>
         (common::CompressedBufferWriter(num_symbols),
          gidx_buffer.Data(),
-         row_ptrs.data().get() + batch_row_begin,
-         entries_d.data().get(),
+         row_ptrs.data().get() + (batch_row_begin - row_begin_idx),
+         entries_d[k].data().get(),
          cut_.gidx_fvalue_map.Data(), cut_.feature_segments.Data(),
-         batch_row_begin, batch_nrows,
-         row_ptrs[batch_row_begin],
+         batch_row_begin - row_begin_idx, batch_nrows,
+         ent_begin,
          row_stride, null_gidx_value);
 
     dh::safe_cuda(cudaGetLastError());
-    dh::safe_cuda(cudaDeviceSynchronize());
   }
 
-  // free the memory that is no longer needed
-  row_ptrs.resize(0);
-  row_ptrs.shrink_to_fit();
-  entries_d.resize(0);
-  entries_d.shrink_to_fit();
+  for (size_t k = 0; k < kPipelineDepth; ++k) {
+    dh::safe_cuda(cudaStreamSynchronize(streams[k]));
+    dh::safe_cuda(cudaStreamDestroy(streams[k]));
+    dh::safe_cuda(cudaFreeHost(staging[k]));
+  }
 }
 
 
@@ -956,6 +1102,12 @@ class GPUHistMakerSpecialised{
     } catch (const std::exception& e) {
       LOG(FATAL) << "Exception in gpu_hist: " << e.what() << std::endl;
     }
+    // snapshot the shape of the last tree: the cache update recomputes
+    // leaf weights from the builder's own node sums instead of reading
+    // the tree, so it must decline if a later updater restructured it
+    p_last_tree_ = trees.back();
+    last_num_nodes_ = p_last_tree_->param.num_nodes;
+    last_num_deleted_ = p_last_tree_->param.num_deleted;
     param_.learning_rate = lr;
     monitor_.Stop("Update", dist_.Devices());
   }
@@ -973,8 +1125,23 @@ class GPUHistMakerSpecialised{
 
     reducer_.Init(device_list_);
 
-    auto batch_iter = dmat->GetRowBatches().begin();
-    const SparsePage& batch = *batch_iter;
+    // Concatenate the row offsets of all pages once on the host; for
+    // multi-page (external memory) matrices this 8-byte-per-row vector is
+    // the only full-size host structure the updater keeps while pages
+    // stream through compression.
+    std::vector<size_t> row_offsets;
+    row_offsets.reserve(info_->num_row_ + 1);
+    row_offsets.push_back(0);
+    size_t n_batches = 0;
+    for (const auto& batch : dmat->GetRowBatches()) {
+      const auto& offset_vec = batch.offset.HostVector();
+      const size_t base = row_offsets.back();
+      for (size_t i = 1; i < offset_vec.size(); ++i) {
+        row_offsets.push_back(base + offset_vec[i]);
+      }
+      ++n_batches;
+    }
+
     // Create device shards
     shards_.resize(n_devices);
     dh::ExecuteIndexShards(&shards_, [&](int i, std::unique_ptr<DeviceShard<GradientSumT>>& shard) {
@@ -983,23 +1150,61 @@ class GPUHistMakerSpecialised{
         shard = std::unique_ptr<DeviceShard<GradientSumT>>
                 (new DeviceShard<GradientSumT>(dist_.Devices().DeviceId(i),
                                  start, start + size, param_));
-        shard->InitRowPtrs(batch);
+        shard->InitRowPtrs(row_offsets);
       });
 
     // Find the cuts.
     monitor_.Start("Quantiles", dist_.Devices());
-    common::DeviceSketch(batch, *info_, param_, &hmat_, hist_maker_param_.gpu_batch_nrows);
+    if (n_batches == 1) {
+      common::DeviceSketch(*dmat->GetRowBatches().begin(), *info_, param_,
+                           &hmat_, hist_maker_param_.gpu_batch_nrows);
+    } else {
+      // multi-page matrices are sketched with the multi-threaded host
+      // sketcher, which already streams pages from the prefetcher
+      hmat_.Init(dmat, param_.max_bin);
+    }
     n_bins_ = hmat_.row_ptr.back();
     monitor_.Stop("Quantiles", dist_.Devices());
 
+    // Up-front memory plan: the compressed matrix and histograms are the
+    // dominant allocations and their sizes are known here, so report the
+    // plan and fail fast with guidance instead of letting cudaMalloc abort
+    // halfway through compression.
+    for (const auto& shard : shards_) {
+      const size_t required = shard->EstimateRequiredMemory(hmat_);
+      const size_t available = dh::AvailableMemory(shard->device_id_);
+      LOG(CONSOLE) << "gpu_hist: device " << shard->device_id_ << " needs ~"
+                   << required / (1024 * 1024) << " MB for " << shard->n_rows
+                   << " rows at max_bin=" << param_.max_bin << ", "
+                   << available / (1024 * 1024) << " MB free";
+      if (required > available) {
+        LOG(FATAL) << "gpu_hist: insufficient memory on device "
+                   << shard->device_id_ << ": ~" << required / (1024 * 1024)
+                   << " MB required but only " << available / (1024 * 1024)
+                   << " MB free. Reduce max_bin or max_depth, train on more "
+                   << "GPUs (n_gpus), or shrink the data per device.";
+      }
+    }
+
+    // Compress pages into the device-resident ELLPack buffers, one page at
+    // a time: only the compressed form is ever held on the device, so the
+    // raw data may be several times larger than device memory.
     monitor_.Start("BinningCompression", dist_.Devices());
     dh::ExecuteIndexShards(&shards_, [&](int idx,
       std::unique_ptr<DeviceShard<GradientSumT>>& shard) {
-        shard->InitCompressedData(hmat_, batch);
+        shard->InitCompressedData(hmat_);
+      });
+    for (const auto& batch : dmat->GetRowBatches()) {
+      dh::ExecuteIndexShards(&shards_, [&](int idx,
+        std::unique_ptr<DeviceShard<GradientSumT>>& shard) {
+          shard->CreateHistIndices(batch, row_offsets);
+        });
+    }
+    dh::ExecuteIndexShards(&shards_, [&](int idx,
+      std::unique_ptr<DeviceShard<GradientSumT>>& shard) {
+        shard->FinishCompressedData();
       });
     monitor_.Stop("BinningCompression", dist_.Devices());
-    ++batch_iter;
-    CHECK(batch_iter.AtEnd()) << "External memory not supported";
 
     p_last_fmat_ = dmat;
     initialised_ = true;
@@ -1027,21 +1232,33 @@ class GPUHistMakerSpecialised{
     monitor_.Stop("InitDataReset", dist_.Devices());
   }
 
+  /**
+   * \brief Allreduce one node's histogram across shards with a single fused
+   * NCCL ring operation. Grouping is thread-local in NCCL, so the
+   * collectives are enqueued for all shards from this thread instead of one
+   * thread per shard; enqueuing is cheap and the fused launch avoids the
+   * rank-at-a-time serialization that flattens scaling past a few GPUs.
+   * The reduction runs asynchronously on the reducer's streams, overlapped
+   * with subsequently launched kernels; callers must synchronize the
+   * reducer before consuming the result.
+   */
   void AllReduceHist(int nidx) {
     if (shards_.size() == 1) return;
 
     monitor_.Start("AllReduce");
-    dh::ExecuteIndexShards(
-        &shards_,
-        [&](int idx, std::unique_ptr<DeviceShard<GradientSumT>>& shard) {
-          auto d_node_hist = shard->hist.GetNodeHistogram(nidx).data();
-          reducer_.AllReduceSum(
-              dist_.Devices().Index(shard->device_id_),
-              reinterpret_cast<typename GradientSumT::ValueT*>(d_node_hist),
-              reinterpret_cast<typename GradientSumT::ValueT*>(d_node_hist),
-              n_bins_ * (sizeof(GradientSumT) /
-                         sizeof(typename GradientSumT::ValueT)));
-        });
+    // order the collective after the histogram kernels already in flight
+    reducer_.WaitForDefaultStreams();
+    reducer_.GroupStart();
+    for (auto& shard : shards_) {
+      auto d_node_hist = shard->hist.GetNodeHistogram(nidx).data();
+      reducer_.AllReduceSum(
+          dist_.Devices().Index(shard->device_id_),
+          reinterpret_cast<typename GradientSumT::ValueT*>(d_node_hist),
+          reinterpret_cast<typename GradientSumT::ValueT*>(d_node_hist),
+          n_bins_ * (sizeof(GradientSumT) /
+                     sizeof(typename GradientSumT::ValueT)));
+    }
+    reducer_.GroupEnd();
     monitor_.Stop("AllReduce");
   }
 
@@ -1083,6 +1300,9 @@ class GPUHistMakerSpecialised{
     }
 
     if (do_subtraction_trick) {
+      // the subtraction kernel reads the reduced histogram: wait for the
+      // in-flight reduction before launching it
+      reducer_.Synchronize();
       // Calculate other histogram using subtraction trick
       dh::ExecuteIndexShards(
           &shards_,
@@ -1091,7 +1311,8 @@ class GPUHistMakerSpecialised{
                                     subtraction_trick_nidx);
           });
     } else {
-      // Calculate other histogram manually
+      // Calculate other histogram manually; the build kernels do not
+      // depend on the first reduction, so they overlap with it
       dh::ExecuteIndexShards(
           &shards_,
           [&](int idx, std::unique_ptr<DeviceShard<GradientSumT>>& shard) {
@@ -1099,13 +1320,25 @@ class GPUHistMakerSpecialised{
           });
 
       this->AllReduceHist(subtraction_trick_nidx);
+      reducer_.Synchronize();
     }
   }
 
+  /* Evaluate several nodes of the same depth in one launch; sibling nodes
+     share the column sample of their depth. */
+  std::vector<DeviceSplitCandidate> EvaluateSplits(const std::vector<int>& nidxs,
+                                                   RegTree* p_tree) {
+    std::vector<ValueConstraint> constraints(nidxs.size());
+    for (size_t i = 0; i < nidxs.size(); ++i) {
+      constraints[i] = node_value_constraints_[nidxs[i]];
+    }
+    return shards_.front()->EvaluateSplits(
+        nidxs, column_sampler_.GetFeatureSet(p_tree->GetDepth(nidxs.front())),
+        constraints);
+  }
+
   DeviceSplitCandidate EvaluateSplit(int nidx, RegTree* p_tree) {
-    return shards_.front()->EvaluateSplit(
-        nidx, *column_sampler_.GetFeatureSet(p_tree->GetDepth(nidx)),
-        node_value_constraints_[nidx]);
+    return this->EvaluateSplits({nidx}, p_tree).front();
   }
 
   void InitRoot(RegTree* p_tree) {
@@ -1131,6 +1364,7 @@ class GPUHistMakerSpecialised{
         });
 
     this->AllReduceHist(root_nidx);
+    reducer_.Synchronize();
 
     // Remember root stats
     p_tree->Stat(root_nidx).sum_hess = sum_gradient.GetHess();
@@ -1258,16 +1492,14 @@ class GPUHistMakerSpecialised{
         monitor_.Stop("BuildHist", dist_.Devices());
 
         monitor_.Start("EvaluateSplits", dist_.Devices());
-        auto left_child_split =
-            this->EvaluateSplit(left_child_nidx, p_tree);
-        auto right_child_split =
-            this->EvaluateSplit(right_child_nidx, p_tree);
+        auto child_splits =
+            this->EvaluateSplits({left_child_nidx, right_child_nidx}, p_tree);
         qexpand_->push(ExpandEntry(left_child_nidx,
-                                   tree.GetDepth(left_child_nidx), left_child_split,
-                                   timestamp++));
+                                   tree.GetDepth(left_child_nidx),
+                                   child_splits[0], timestamp++));
         qexpand_->push(ExpandEntry(right_child_nidx,
-                                   tree.GetDepth(right_child_nidx), right_child_split,
-                                   timestamp++));
+                                   tree.GetDepth(right_child_nidx),
+                                   child_splits[1], timestamp++));
         monitor_.Stop("EvaluateSplits", dist_.Devices());
       }
     }
@@ -1278,6 +1510,13 @@ class GPUHistMakerSpecialised{
     monitor_.Start("UpdatePredictionCache", dist_.Devices());
     if (shards_.empty() || p_last_fmat_ == nullptr || p_last_fmat_ != data)
       return false;
+    // a later updater pruned the tree this builder grew; the cached node
+    // sums no longer describe the surviving leaves
+    if (p_last_tree_ == nullptr ||
+        p_last_tree_->param.num_nodes != last_num_nodes_ ||
+        p_last_tree_->param.num_deleted != last_num_deleted_) {
+      return false;
+    }
     p_out_preds->Reshard(dist_.Devices());
     dh::ExecuteIndexShards(
         &shards_,
@@ -1359,6 +1598,11 @@ class GPUHistMakerSpecialised{
   std::vector<int> device_list_;
 
   DMatrix* p_last_fmat_;
+  // shape snapshot of the last grown tree, used to detect restructuring
+  // by later updaters before serving the prediction cache
+  const RegTree* p_last_tree_{nullptr};
+  int last_num_nodes_{0};
+  int last_num_deleted_{0};
   GPUDistribution dist_;
 };
 
@@ -7,6 +7,9 @@
 #include <rabit/rabit.h>
 #include <xgboost/base.h>
 #include <xgboost/tree_updater.h>
+#include <atomic>
+#include <thread>
+#include <utility>
 #include <vector>
 #include <algorithm>
 
@@ -120,6 +123,45 @@ class HistMaker: public BaseMaker {
   ThreadWSpace wspace_;
   // reducer for histogram
   rabit::Reducer<TStats, TStats::Reduce> histred_;
+  // whether histogram reductions go through the fp32 compression layer,
+  // opt-in via XGBOOST_COMPRESS_HISTOGRAM=1; only simple double-pair
+  // statistics can be reinterpreted for encoding
+  inline bool CompressHistogram() const {
+    return TStats::kSimpleStats != 0 && rabit::IsDistributed() &&
+           dmlc::GetEnv("XGBOOST_COMPRESS_HISTOGRAM", 0) != 0;
+  }
+  // reduce n statistics across workers through an fp32 wire format,
+  // halving allreduce traffic. Error feedback makes the compression
+  // loss transient instead of permanent: the fp64 residual of this
+  // round's encoding is kept in a persistent buffer and added to the
+  // next round's values before they are quantized, so it is
+  // re-transmitted rather than folded into the reduced result. Every
+  // rank takes exactly the reduced fp32 sums, keeping the synced
+  // histograms bit-identical across ranks so the locally picked splits
+  // agree.
+  inline void SyncHistogramCompressed(TStats* stats, size_t n) {
+    const size_t nval = n * (sizeof(TStats) / sizeof(double));
+    auto* vals = reinterpret_cast<double*>(stats);
+    compress_buf_.resize(nval);
+    if (compress_residual_.size() < nval) {
+      compress_residual_.resize(nval, 0.0);
+    }
+    for (size_t i = 0; i < nval; ++i) {
+      const double feedback = vals[i] + compress_residual_[i];
+      compress_buf_[i] = static_cast<float>(feedback);
+      compress_residual_[i] =
+          feedback - static_cast<double>(compress_buf_[i]);
+    }
+    rabit::Allreduce<rabit::op::Sum>(dmlc::BeginPtr(compress_buf_), nval);
+    for (size_t i = 0; i < nval; ++i) {
+      vals[i] = static_cast<double>(compress_buf_[i]);
+    }
+  }
+  // fp32 staging buffer of the compression layer
+  std::vector<float> compress_buf_;
+  // per-slot encoding residuals carried into the next round's
+  // transmission; rank local, never reduced
+  std::vector<double> compress_residual_;
   // set of working features
   std::vector<bst_uint> fwork_set_;
   // update function implementation
@@ -176,7 +218,6 @@ class HistMaker: public BaseMaker {
                           const std::vector <bst_uint> &fset,
                           const RegTree &tree)  = 0;
 
- private:
   inline void EnumerateSplit(const HistUnit &hist,
                              const TStats &node_sum,
                              bst_uint fid,
@@ -212,18 +253,26 @@ class HistMaker: public BaseMaker {
       }
     }
   }
-  inline void FindSplit(int depth,
-                        const std::vector<GradientPair> &gpair,
-                        DMatrix *p_fmat,
-                        const std::vector <bst_uint> &fset,
-                        RegTree *p_tree) {
+  virtual void FindSplit(int depth,
+                         const std::vector<GradientPair> &gpair,
+                         DMatrix *p_fmat,
+                         const std::vector <bst_uint> &fset,
+                         RegTree *p_tree) {
+    this->FindSplitRange(0, static_cast<bst_omp_uint>(qexpand_.size()),
+                         fset, p_tree);
+  }
+  // split search over the work indices [wbegin, wend); a range so a
+  // pipelined subclass can enumerate nodes whose histograms are already
+  // reduced while the rest are still in flight
+  inline void FindSplitRange(bst_omp_uint wbegin, bst_omp_uint wend,
+                             const std::vector <bst_uint> &fset,
+                             RegTree *p_tree) {
     const size_t num_feature = fset.size();
     // get the best split condition for each node
     std::vector<SplitEntry> sol(qexpand_.size());
     std::vector<TStats> left_sum(qexpand_.size());
-    auto nexpand = static_cast<bst_omp_uint>(qexpand_.size());
     #pragma omp parallel for schedule(dynamic, 1)
-    for (bst_omp_uint wid = 0; wid < nexpand; ++wid) {
+    for (bst_omp_uint wid = wbegin; wid < wend; ++wid) {
       const int nid = qexpand_[wid];
       CHECK_EQ(node2workindex_[nid], static_cast<int>(wid));
       SplitEntry &best = sol[wid];
@@ -234,7 +283,7 @@ class HistMaker: public BaseMaker {
       }
     }
     // get the best result, we can synchronize the solution
-    for (bst_omp_uint wid = 0; wid < nexpand; ++wid) {
+    for (bst_omp_uint wid = wbegin; wid < wend; ++wid) {
       const int nid = qexpand_[wid];
       const SplitEntry &best = sol[wid];
       const TStats &node_sum = wspace_.hset[0][num_feature + wid * (num_feature + 1)].data[0];
@@ -367,6 +416,12 @@ class CQHistMaker: public HistMaker<TStats> {
     // sync the histogram
     // if it is C++11, use lazy evaluation for Allreduce
 #if __cplusplus >= 201103L
+    if (this->CompressHistogram()) {
+      lazy_get_hist();
+      this->SyncHistogramCompressed(dmlc::BeginPtr(this->wspace_.hset[0].data),
+                                    this->wspace_.hset[0].data.size());
+      return;
+    }
     this->histred_.Allreduce(dmlc::BeginPtr(this->wspace_.hset[0].data),
                             this->wspace_.hset[0].data.size(), lazy_get_hist);
 #else
@@ -650,9 +705,16 @@ class GlobalProposalHistMaker: public CQHistMaker<TStats> {
                           DMatrix *p_fmat,
                           const std::vector<bst_uint> &fset,
                           const RegTree &tree) override {
-    if (this->qexpand_.size() == 1) {
+    // the global proposal depends on the data and the sampled feature set,
+    // not on the tree being grown, so it is kept across iterations; the
+    // gradients only reweight the sketch, which the proposal tolerates by
+    // construction.  drop the cache only when the data or the feature
+    // sample actually changes
+    if (cached_dmatrix_ != p_fmat || cached_fset_ != fset) {
       cached_rptr_.clear();
       cached_cut_.clear();
+      cached_dmatrix_ = p_fmat;
+      cached_fset_ = fset;
     }
     if (cached_rptr_.size() == 0) {
       CHECK_EQ(this->qexpand_.size(), 1U);
@@ -691,7 +753,11 @@ class GlobalProposalHistMaker: public CQHistMaker<TStats> {
     }
     // start to work
     this->wspace_.Init(this->param_, 1);
+    // if it is C++11, use lazy evaluation for Allreduce,
     // to gain speedup in recovery
+#if __cplusplus >= 201103L
+    auto lazy_get_hist = [&]()
+#endif
     {
       this->thread_hist_.resize(omp_get_max_threads());
 
@@ -731,11 +797,112 @@ class GlobalProposalHistMaker: public CQHistMaker<TStats> {
         this->wspace_.hset[0][fset.size() + wid * (fset.size()+1)]
             .data[0] = this->node_stats_[nid];
       }
+    };
+    // sync the histograms of the whole frontier in one call: the workspace
+    // lays out every (node, feature) histogram plus the per-node sums in a
+    // single contiguous buffer, so one allreduce per level carries all of
+    // them and the collective count stays independent of the tree width
+#if __cplusplus >= 201103L
+    if (rabit::IsDistributed() && this->qexpand_.size() >= 2) {
+      // pipelined mode: reduce the frontier in per-node chunks on a
+      // communication thread, letting split enumeration on already
+      // reduced chunks hide the allreduce wait of the remaining ones
+      lazy_get_hist();
+      this->StartPipelinedReduce(fset.size());
+      return;
+    }
+    if (this->CompressHistogram()) {
+      lazy_get_hist();
+      this->SyncHistogramCompressed(dmlc::BeginPtr(this->wspace_.hset[0].data),
+                                    this->wspace_.hset[0].data.size());
+      return;
     }
+    this->histred_.Allreduce(dmlc::BeginPtr(this->wspace_.hset[0].data),
+                            this->wspace_.hset[0].data.size(), lazy_get_hist);
+#else
     this->histred_.Allreduce(dmlc::BeginPtr(this->wspace_.hset[0].data),
                             this->wspace_.hset[0].data.size());
+#endif
+  }
+
+  void FindSplit(int depth,
+                 const std::vector<GradientPair> &gpair,
+                 DMatrix *p_fmat,
+                 const std::vector <bst_uint> &fset,
+                 RegTree *p_tree) override {
+    if (!pipeline_active_) {
+      HistMaker<TStats>::FindSplit(depth, gpair, p_fmat, fset, p_tree);
+      return;
+    }
+    // walk the chunks in reduction order: enumerate splits of each chunk
+    // as soon as its histograms arrive, overlapping with the reduction of
+    // the chunks still in flight
+    for (size_t k = 0; k < chunk_ranges_.size(); ++k) {
+      while (chunks_reduced_.load(std::memory_order_acquire) <=
+             static_cast<int>(k)) {
+        std::this_thread::yield();
+      }
+      this->FindSplitRange(
+          static_cast<bst_omp_uint>(chunk_ranges_[k].first),
+          static_cast<bst_omp_uint>(chunk_ranges_[k].second), fset, p_tree);
+    }
+    reduce_thread_.join();
+    pipeline_active_ = false;
+  }
+
+  // start reducing the frontier in chunks of work indices on a dedicated
+  // thread. Chunk boundaries depend only on the frontier and feature-set
+  // sizes, which are identical on every rank, so all ranks issue the same
+  // sequence of collectives; no other rabit call happens until FindSplit
+  // has joined the thread.
+  void StartPipelinedReduce(size_t num_feature) {
+    const size_t nexpand = this->qexpand_.size();
+    const size_t nchunk = std::min<size_t>(nexpand, kReduceChunks);
+    chunk_ranges_.clear();
+    for (size_t k = 0; k < nchunk; ++k) {
+      chunk_ranges_.emplace_back(k * nexpand / nchunk,
+                                 (k + 1) * nexpand / nchunk);
+    }
+    chunks_reduced_.store(0);
+    pipeline_active_ = true;
+    reduce_thread_ = std::thread([this, num_feature]() {
+      for (const std::pair<size_t, size_t>& range : chunk_ranges_) {
+        // work index w owns the units [w*(nf+1), (w+1)*(nf+1)), so a
+        // chunk of work indices is one contiguous span of the buffer
+        const size_t ubegin = range.first * (num_feature + 1);
+        const size_t uend = range.second * (num_feature + 1);
+        const size_t dbegin = this->wspace_.rptr[ubegin];
+        const size_t dend = this->wspace_.rptr[uend];
+        if (this->CompressHistogram()) {
+          this->SyncHistogramCompressed(
+              dmlc::BeginPtr(this->wspace_.hset[0].data) + dbegin,
+              dend - dbegin);
+        } else {
+          this->histred_.Allreduce(
+              dmlc::BeginPtr(this->wspace_.hset[0].data) + dbegin,
+              dend - dbegin);
+        }
+        chunks_reduced_.fetch_add(1, std::memory_order_release);
+      }
+    });
   }
 
+  // number of chunks the frontier reduction is split into; enough to
+  // overlap communication with enumeration without inflating the
+  // per-level collective count
+  static const size_t kReduceChunks = 4;
+  // communication thread of the in-flight pipelined reduction
+  std::thread reduce_thread_;
+  // number of chunks whose histograms have been reduced so far
+  std::atomic<int> chunks_reduced_{0};
+  // work index ranges of the chunks
+  std::vector<std::pair<size_t, size_t> > chunk_ranges_;
+  // whether a pipelined reduction is in flight
+  bool pipeline_active_{false};
+  // data matrix the cached proposal was built from
+  const DMatrix* cached_dmatrix_{nullptr};
+  // feature sample the cached proposal was built from
+  std::vector<bst_uint> cached_fset_;
   // cached unit pointer
   std::vector<unsigned> cached_rptr_;
   // cached cut value.
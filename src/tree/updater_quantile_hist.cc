@@ -10,13 +10,16 @@
 #include <xgboost/tree_updater.h>
 
 #include <cmath>
+#include <cstring>
 #include <memory>
+#include <mutex>
 #include <vector>
 #include <algorithm>
 #include <queue>
 #include <iomanip>
 #include <numeric>
 #include <string>
+#include <unordered_map>
 #include <utility>
 
 #include "./param.h"
@@ -26,6 +29,7 @@
 #include "../common/hist_util.h"
 #include "../common/row_set.h"
 #include "../common/column_matrix.h"
+#include "../common/timer.h"
 
 namespace xgboost {
 namespace tree {
@@ -39,7 +43,7 @@ void QuantileHistMaker::Init(const std::vector<std::pair<std::string, std::strin
   }
   pruner_->Init(args);
   param_.InitAllowUnknown(args);
-  is_gmat_initialized_ = false;
+  args_ = args;
 
   // initialise the split evaluator
   if (!spliteval_) {
@@ -49,33 +53,251 @@ void QuantileHistMaker::Init(const std::vector<std::pair<std::string, std::strin
   spliteval_->Init(args);
 }
 
+/*
+ * Content fingerprint of a DMatrix under given quantization parameters.
+ * Shape alone is not enough -- an unrelated matrix may be allocated at a
+ * recycled address with identical dimensions -- so a bounded sample of
+ * leading entries is folded in as well.
+ */
+static uint64_t GMatFingerprint(DMatrix* dmat, const TrainParam& param) {
+  constexpr uint64_t kPrime = 1099511628211ULL;
+  uint64_t h = 14695981039346656037ULL;  // FNV-1a offset basis
+  auto mix = [&h, kPrime](uint64_t v) {
+    h = (h ^ v) * kPrime;
+  };
+
+  const MetaInfo& info = dmat->Info();
+  mix(static_cast<uint64_t>(param.max_bin));
+  mix(static_cast<uint64_t>(param.sparse_threshold * (1 << 16)));
+  mix(info.num_row_);
+  mix(info.num_col_);
+  mix(info.num_nonzero_);
+
+  const std::vector<bst_uint>* view_ridx = nullptr;
+  DMatrix* view_parent = dmat->ViewParent(&view_ridx);
+  if (view_parent != nullptr) {
+    // a row view shares its parent's entries; fingerprint the parent and
+    // the index list instead of gathering the view's rows every call.
+    // sibling cross-validation folds share their leading indices, so the
+    // sample strides across the whole list and pins the last entry rather
+    // than taking the head
+    mix(GMatFingerprint(view_parent, param));
+    constexpr size_t kMaxSampledIndices = 64;
+    const size_t nindex = view_ridx->size();
+    mix(nindex);
+    const size_t stride =
+        nindex > kMaxSampledIndices ? nindex / kMaxSampledIndices : 1;
+    for (size_t i = 0; i < nindex; i += stride) {
+      mix((*view_ridx)[i]);
+    }
+    if (nindex != 0) {
+      mix((*view_ridx)[nindex - 1]);
+    }
+    return h;
+  }
+
+  constexpr size_t kMaxSampledEntries = 64;
+  size_t sampled = 0;
+  for (const auto& batch : dmat->GetRowBatches()) {
+    for (size_t i = 0; i < batch.Size() && sampled < kMaxSampledEntries; ++i) {
+      SparsePage::Inst inst = batch[i];
+      for (size_t j = 0; j < inst.size() && sampled < kMaxSampledEntries; ++j) {
+        uint32_t fbits;
+        std::memcpy(&fbits, &inst[j].fvalue, sizeof(fbits));
+        mix(inst[j].index);
+        mix(fbits);
+        ++sampled;
+      }
+    }
+    break;  // the first batch is enough for a fingerprint
+  }
+  return h;
+}
+
+/*
+ * Estimate whether the blocked (feature-grouped) histogram layout is likely
+ * to win for this data. Grouping pays off when the full histogram blows the
+ * L2 cache and features rarely co-occur (one-hot style sparsity), so that
+ * bundled features shrink the per-block working set.
+ */
+static bool ShouldUseFeatureGrouping(const GHistIndexMatrix& gmat,
+                                     const MetaInfo& info) {
+  const size_t nbins = gmat.cut.row_ptr.back();
+  const size_t hist_bytes = nbins * sizeof(GHistEntry);
+  constexpr size_t kAssumedL2Bytes = 1U << 20;
+  if (hist_bytes <= kAssumedL2Bytes) {
+    return false;  // histogram is cache resident; blocking only adds overhead
+  }
+  if (info.num_row_ == 0 || info.num_col_ == 0) {
+    return false;
+  }
+  const double density = static_cast<double>(info.num_nonzero_) /
+                         info.num_row_ / info.num_col_;
+  return density <= 0.1;
+}
+
+// materialize the block matrix, keeping it only if grouping actually merged
+// a meaningful share of the features
+static void TryBuildBlockMatrix(QuantileHistMaker::GMatCacheEntry* entry,
+                                const TrainParam& param) {
+  entry->gmatb.Init(*entry->gmat, entry->column_matrix, param);
+  const size_t nfeature = entry->gmat->cut.row_ptr.size() - 1;
+  if (param.enable_feature_grouping < 0 &&
+      entry->gmatb.GetNumBlock() > nfeature * 3 / 4) {
+    // hardly any features were bundled; stick to the flat layout
+    entry->gmatb = GHistIndexBlockMatrix();
+    return;
+  }
+  entry->has_blocks = true;
+}
+
+// assumes cache_mutex is held by the caller; recurses at most once, to
+// quantize the parent of a row view
+static std::shared_ptr<QuantileHistMaker::GMatCacheEntry> GetGMatCacheEntryLocked(
+    DMatrix* dmat, const TrainParam& param,
+    std::unordered_map<DMatrix*,
+        std::shared_ptr<QuantileHistMaker::GMatCacheEntry>>* p_cache) {
+  auto& cache = *p_cache;
+  // keep a handful of quantized matrices alive; hyperparameter sweeps rarely
+  // juggle more DMatrix objects than this at the same time
+  constexpr size_t kMaxCachedMatrices = 8;
+
+  const uint64_t fingerprint = GMatFingerprint(dmat, param);
+
+  auto it = cache.find(dmat);
+  if (it != cache.end() && it->second->fingerprint == fingerprint) {
+    auto entry = it->second;
+    if (param.enable_feature_grouping > 0 && !entry->has_blocks) {
+      TryBuildBlockMatrix(entry.get(), param);
+    }
+    return entry;
+  }
+
+  double tstart = dmlc::GetTime();
+  auto entry = std::make_shared<QuantileHistMaker::GMatCacheEntry>();
+  entry->gmat = std::make_shared<GHistIndexMatrix>();
+  const std::vector<bst_uint>* view_ridx = nullptr;
+  DMatrix* view_parent = dmat->ViewParent(&view_ridx);
+  if (view_parent != nullptr) {
+    // quantize the parent once and gather the view's rows out of it:
+    // slicing k cross-validation folds then costs k gathers instead of k
+    // sketch passes, and every fold shares the parent's cut points
+    auto parent_entry = GetGMatCacheEntryLocked(view_parent, param, p_cache);
+    entry->gmat->Init(*parent_entry->gmat, *view_ridx);
+  } else {
+    // when the same matrix merely grew in place (rows appended through
+    // AppendRows), requantize against the previous cut points instead of
+    // re-sketching, as long as the growth stays under the refresh
+    // threshold; larger drift falls through to a full rebuild
+    const GHistIndexMatrix* prev =
+        it != cache.end() && it->second->max_bin == param.max_bin
+            ? it->second->gmat.get() : nullptr;
+    const size_t prev_rows = prev != nullptr && prev->row_ptr.size() > 0
+        ? prev->row_ptr.size() - 1 : 0;
+    const size_t new_rows = dmat->Info().num_row_;
+    const double refresh_threshold = dmlc::GetEnv(
+        "XGBOOST_CUT_REFRESH_THRESHOLD", 0.1f);
+    if (prev_rows != 0 && new_rows > prev_rows &&
+        prev->cut.row_ptr.size() == dmat->Info().num_col_ + 1 &&
+        static_cast<double>(new_rows - prev_rows) <=
+            refresh_threshold * static_cast<double>(prev_rows)) {
+      entry->gmat->Init(dmat, prev->cut);
+    } else {
+      entry->gmat->Init(dmat, static_cast<int>(param.max_bin));
+    }
+  }
+  entry->max_bin = param.max_bin;
+  entry->column_matrix.Init(*entry->gmat, param.sparse_threshold);
+  if (param.enable_feature_grouping > 0 ||
+      (param.enable_feature_grouping < 0 &&
+       ShouldUseFeatureGrouping(*entry->gmat, dmat->Info()))) {
+    TryBuildBlockMatrix(entry.get(), param);
+  }
+  entry->fingerprint = fingerprint;
+  LOG(INFO) << "Generating gmat: " << dmlc::GetTime() - tstart << " sec";
+  // make the quantization visible to the CPU predictor for in-training
+  // prediction on the same matrix
+  common::PublishGHistIndex(dmat, entry->gmat);
+
+  if (cache.size() >= kMaxCachedMatrices) {
+    // evict entries nobody references anymore (stale or replaced matrices)
+    for (auto cit = cache.begin(); cit != cache.end();) {
+      if (cit->second.use_count() == 1) {
+        cit = cache.erase(cit);
+      } else {
+        ++cit;
+      }
+    }
+  }
+  cache[dmat] = entry;
+  return entry;
+}
+
+static std::shared_ptr<QuantileHistMaker::GMatCacheEntry> GetGMatCacheEntry(
+    DMatrix* dmat, const TrainParam& param) {
+  static std::mutex cache_mutex;
+  static std::unordered_map<DMatrix*,
+      std::shared_ptr<QuantileHistMaker::GMatCacheEntry>> cache;
+
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  return GetGMatCacheEntryLocked(dmat, param, &cache);
+}
+
 void QuantileHistMaker::Update(HostDeviceVector<GradientPair> *gpair,
                            DMatrix *dmat,
                            const std::vector<RegTree *> &trees) {
   GradStats::CheckInfo(dmat->Info());
-  if (is_gmat_initialized_ == false) {
-    double tstart = dmlc::GetTime();
-    gmat_.Init(dmat, static_cast<uint32_t>(param_.max_bin));
-    column_matrix_.Init(gmat_, param_.sparse_threshold);
-    if (param_.enable_feature_grouping > 0) {
-      gmatb_.Init(gmat_, column_matrix_, param_);
-    }
-    is_gmat_initialized_ = true;
-    LOG(INFO) << "Generating gmat: " << dmlc::GetTime() - tstart << " sec";
-  }
+  gmat_cache_ = GetGMatCacheEntry(dmat, param_);
   // rescale learning rate according to size of trees
   float lr = param_.learning_rate;
   param_.learning_rate = lr / trees.size();
   // build tree
-  if (!builder_) {
-    builder_.reset(new Builder(
-        param_,
-        std::move(pruner_),
-        std::unique_ptr<SplitEvaluator>(spliteval_->GetHostClone())));
-  }
-  for (auto tree : trees) {
-    builder_->Update
-        (gmat_, gmatb_, column_matrix_, gpair, dmat, tree);
+  if (trees.size() > 1 && dmat->SingleColBlock() &&
+      !rabit::IsDistributed()) {
+    // a forest round: the trees are independent given the gradients, so
+    // one builder per tree runs task-parallel over the shared quantized
+    // matrix. Nested parallel regions are off by default, hence each
+    // builder runs serially inside and the round scales with the tree
+    // count. Seeds are drawn from the caller's engine up front so the
+    // workers' thread-local engines do not repeat the same sampling.
+    const std::vector<GradientPair>& gpair_h = gpair->ConstHostVector();
+    (void)gpair_h;  // materialize the host copy before it is shared
+    std::vector<std::unique_ptr<Builder>> builders;
+    std::vector<uint32_t> seeds;
+    for (size_t i = 0; i < trees.size(); ++i) {
+      std::unique_ptr<TreeUpdater> pruner(TreeUpdater::Create("prune"));
+      pruner->Init(args_);
+      builders.emplace_back(new Builder(
+          param_, std::move(pruner),
+          std::unique_ptr<SplitEvaluator>(spliteval_->GetHostClone())));
+      seeds.push_back(static_cast<uint32_t>(common::GlobalRandom()()));
+    }
+    const auto ntrees = static_cast<bst_omp_uint>(trees.size());
+    #pragma omp parallel for schedule(dynamic)
+    for (bst_omp_uint i = 0; i < ntrees; ++i) {
+      common::GlobalRandom().seed(seeds[i]);
+      builders[i]->Update(*gmat_cache_->gmat, gmat_cache_->gmatb,
+                          gmat_cache_->column_matrix, gpair, dmat, trees[i]);
+    }
+    // builder_ did not see this round; drop it so a stale prediction
+    // cache is never served
+    builder_.reset();
+  } else {
+    if (!builder_) {
+      if (!pruner_) {
+        // consumed by a builder that a task-parallel round dropped
+        pruner_.reset(TreeUpdater::Create("prune"));
+        pruner_->Init(args_);
+      }
+      builder_.reset(new Builder(
+          param_,
+          std::move(pruner_),
+          std::unique_ptr<SplitEvaluator>(spliteval_->GetHostClone())));
+    }
+    for (auto tree : trees) {
+      builder_->Update(*gmat_cache_->gmat, gmat_cache_->gmatb,
+                       gmat_cache_->column_matrix, gpair, dmat, tree);
+    }
   }
   param_.learning_rate = lr;
 }
@@ -97,6 +319,7 @@ void QuantileHistMaker::Builder::Update(const GHistIndexMatrix& gmat,
                                     DMatrix* p_fmat,
                                     RegTree* p_tree) {
   double gstart = dmlc::GetTime();
+  common::ProfileScope update_scope("QuantileHist::Update");
 
   int num_leaves = 0;
   unsigned timestamp = 0;
@@ -110,27 +333,109 @@ void QuantileHistMaker::Builder::Update(const GHistIndexMatrix& gmat,
 
   const std::vector<GradientPair>& gpair_h = gpair->ConstHostVector();
 
+  // vector-leaf mode: the gradient vector carries the pairs of all
+  // classes of a row back to back; split them into per-class copies for
+  // the histogram builds and a pooled copy for the row-level passes
+  num_class_ = p_tree->param.size_leaf_vector > 1
+                   ? p_tree->param.size_leaf_vector : 0;
+  if (num_class_ > 0) {
+    const size_t nrow = p_fmat->Info().num_row_;
+    CHECK_EQ(gpair_h.size(), nrow * num_class_)
+        << "vector-leaf tree expects one gradient pair per row and class";
+    CHECK(spliteval_->IsElasticNetOnly())
+        << "vector_leaf does not support monotone or interaction constraints";
+    gpair_class_.resize(num_class_);
+    for (int k = 0; k < num_class_; ++k) {
+      gpair_class_[k].resize(nrow);
+    }
+    gpair_pooled_.resize(nrow);
+    const auto nrows = static_cast<bst_omp_uint>(nrow);
+    #pragma omp parallel for schedule(static)
+    for (bst_omp_uint i = 0; i < nrows; ++i) {
+      float grad = 0.0f, hess = 0.0f;
+      for (int k = 0; k < num_class_; ++k) {
+        const GradientPair& g =
+            gpair_h[static_cast<size_t>(i) * num_class_ + k];
+        gpair_class_[k][i] = g;
+        grad += g.GetGrad();
+        hess += g.GetHess();
+      }
+      gpair_pooled_[i] = GradientPair(grad, hess);
+    }
+  }
+  const std::vector<GradientPair>& gpair_row =
+      num_class_ > 0 ? gpair_pooled_ : gpair_h;
+
   spliteval_->Reset();
 
   tstart = dmlc::GetTime();
-  this->InitData(gmat, gpair_h, *p_fmat, *p_tree);
+  {
+    common::ProfileScope scope("InitData");
+    this->InitData(gmat, gpair_row, *p_fmat, *p_tree);
+  }
   time_init_data = dmlc::GetTime() - tstart;
 
+  {
+    // pre-size the growth structures from the leaf budget; capacity is
+    // retained across trees, so after the first tree node expansion no
+    // longer goes back to the allocator. This is the practical
+    // substitute for a per-update arena given the public std::vector
+    // layout of RegTree.
+    const MetaInfo& info = p_fmat->Info();
+    size_t leaf_bound = param_.max_leaves > 0
+        ? static_cast<size_t>(param_.max_leaves)
+        : (param_.max_depth > 0 && param_.max_depth < 31
+           ? static_cast<size_t>(1) << param_.max_depth
+           : info.num_row_);
+    leaf_bound = std::min(leaf_bound, static_cast<size_t>(info.num_row_));
+    // do not pre-commit absurd bounds; past this the geometric growth of
+    // the vectors takes over
+    constexpr size_t kMaxReserve = 1UL << 20;
+    const size_t node_bound = std::min(2 * leaf_bound + 1, kMaxReserve);
+    p_tree->Reserve(node_bound);
+    row_set_collection_.Reserve(node_bound);
+    snode_.reserve(node_bound);
+  }
+
+  // (optional) keep a copy of the gradients physically reordered to the
+  // partition array, so histogram builds read them sequentially; the copy
+  // is refreshed after every level below. The block-matrix path has its
+  // own row loop and does not support the positional layout
+  const bool reorder_gpair = param_.reorder_grad_pairs &&
+      gmatb.GetNumBlock() == 0 && num_class_ == 0;
+  if (reorder_gpair) {
+    hist_builder_.ReorderGradients(
+        gpair_h, dmlc::BeginPtr(row_set_collection_.row_indices_),
+        row_set_collection_.row_indices_.size());
+  } else {
+    hist_builder_.ClearReorderedGradients();
+  }
+
   // FIXME(hcho3): this code is broken when param.num_roots > 1. Please fix it
   CHECK_EQ(p_tree->param.num_roots, 1)
       << "tree_method=hist does not support multiple roots at this moment";
   for (int nid = 0; nid < p_tree->param.num_roots; ++nid) {
     tstart = dmlc::GetTime();
-    hist_.AddHistRow(nid);
-    BuildHist(gpair_h, row_set_collection_[nid], gmat, gmatb, hist_[nid]);
+    {
+      common::ProfileScope scope("BuildHist");
+      hist_.AddHistRow(nid);
+      BuildHist(gpair_row, row_set_collection_[nid], gmat, gmatb, hist_[nid]);
+      this->ReduceHistograms(std::vector<int>{nid});
+    }
     time_build_hist += dmlc::GetTime() - tstart;
 
     tstart = dmlc::GetTime();
-    this->InitNewNode(nid, gmat, gpair_h, *p_fmat, *p_tree);
+    {
+      common::ProfileScope scope("InitNewNode");
+      this->InitNewNode(nid, gmat, gpair_row, *p_fmat, *p_tree);
+    }
     time_init_new_node += dmlc::GetTime() - tstart;
 
     tstart = dmlc::GetTime();
-    this->EvaluateSplit(nid, gmat, hist_, *p_fmat, *p_tree);
+    {
+      common::ProfileScope scope("EvaluateSplit");
+      this->EvaluateSplit(nid, gmat, hist_, *p_fmat, *p_tree);
+    }
     time_evaluate_split += dmlc::GetTime() - tstart;
     qexpand_->push(ExpandEntry(nid, p_tree->GetDepth(nid),
                                snode_[nid].best.loss_chg,
@@ -138,54 +443,193 @@ void QuantileHistMaker::Builder::Update(const GHistIndexMatrix& gmat,
     ++num_leaves;
   }
 
+  // nodes split in one round, along with the child picked for a fresh
+  // histogram build; the sibling uses the subtraction trick
+  struct SplitNode {
+    int nid;
+    int cbuild;
+    int csubtract;
+  };
+  // per-round scratch, hoisted out of the loop so its capacity carries
+  // over between rounds instead of being reallocated
+  std::vector<ExpandEntry> frontier;
+  std::vector<SplitNode> expanded;
+  std::vector<int> small_builds;
+  std::vector<int> sparse_builds;
+  std::vector<std::vector<uint32_t>> sparse_bins;
+  std::vector<std::vector<GHistEntry>> sparse_entries;
+  std::vector<int> built_nodes;
+  std::vector<int> new_nodes;
+
   while (!qexpand_->empty()) {
-    const ExpandEntry candidate = qexpand_->top();
-    const int nid = candidate.nid;
+    /* drain the ready frontier and process it as one batch. Under lossguide
+       the leaf budget decides which node may expand next, so keep the strict
+       one-at-a-time order there */
+    frontier.clear();
+    expanded.clear();
+    frontier.push_back(qexpand_->top());
     qexpand_->pop();
-    if (candidate.loss_chg <= kRtEps
-        || (param_.max_depth > 0 && candidate.depth == param_.max_depth)
-        || (param_.max_leaves > 0 && num_leaves == param_.max_leaves) ) {
-      (*p_tree)[nid].SetLeaf(snode_[nid].weight * param_.learning_rate);
-    } else {
+    if (param_.grow_policy != TrainParam::kLossGuide) {
+      while (!qexpand_->empty()) {
+        frontier.push_back(qexpand_->top());
+        qexpand_->pop();
+      }
+    }
+
+    for (const ExpandEntry& candidate : frontier) {
+      const int nid = candidate.nid;
+      /* in-growth pruning: a split below min_split_loss would fall to the
+         pruner post-pass anyway, so cut it here before the partition and
+         the child histograms are paid for. Unlike the bottom-up pruner
+         this also discards deeper splits sitting behind a low-gain one,
+         which the post-pass keeps when the deeper gain clears the
+         threshold */
+      if (candidate.loss_chg <= kRtEps
+          || param_.NeedPrune(candidate.loss_chg, candidate.depth)
+          || (param_.max_depth > 0 && candidate.depth == param_.max_depth)
+          || (param_.max_leaves > 0 && num_leaves == param_.max_leaves) ) {
+        this->SetNodeLeaf(p_tree, nid);
+      } else {
+        tstart = dmlc::GetTime();
+        {
+          common::ProfileScope scope("ApplySplit");
+          this->ApplySplit(nid, gmat, column_matrix, hist_, *p_fmat, p_tree);
+        }
+        time_apply_split += dmlc::GetTime() - tstart;
+
+        const int cleft = (*p_tree)[nid].LeftChild();
+        const int cright = (*p_tree)[nid].RightChild();
+        if (rabit::IsDistributed()) {
+          // workers must agree on which sibling is freshly built, since the
+          // histogram allreduce pairs buffers by position; local row counts
+          // differ between workers, so always build the left child
+          expanded.push_back({nid, cleft, cright});
+        } else if (row_set_collection_[cleft].Size() <
+                   row_set_collection_[cright].Size()) {
+          expanded.push_back({nid, cleft, cright});
+        } else {
+          expanded.push_back({nid, cright, cleft});
+        }
+        // the sibling derived by subtraction always gets a dense row; the
+        // freshly built child may use the compact form when small enough,
+        // in which case its storage is installed after the build
+        const SplitNode& e = expanded.back();
+        hist_.AddHistRow(e.csubtract);
+        if (!this->SparseHistEligible(row_set_collection_[e.cbuild].Size(),
+                                      gmat, gmatb)) {
+          hist_.AddHistRow(e.cbuild);
+        }
+        ++num_leaves;  // give two and take one, as parent is no longer a leaf
+      }
+    }
+
+    if (reorder_gpair && !expanded.empty()) {
+      // the splits permuted the partition array; refresh the
+      // partition-ordered gradient copy before the child builds read it
       tstart = dmlc::GetTime();
-      this->ApplySplit(nid, gmat, column_matrix, hist_, *p_fmat, p_tree);
+      hist_builder_.ReorderGradients(
+          gpair_h, dmlc::BeginPtr(row_set_collection_.row_indices_),
+          row_set_collection_.row_indices_.size());
       time_apply_split += dmlc::GetTime() - tstart;
+    }
 
-      tstart = dmlc::GetTime();
-      const int cleft = (*p_tree)[nid].LeftChild();
-      const int cright = (*p_tree)[nid].RightChild();
-      hist_.AddHistRow(cleft);
-      hist_.AddHistRow(cright);
-      if (row_set_collection_[cleft].Size() < row_set_collection_[cright].Size()) {
-        BuildHist(gpair_h, row_set_collection_[cleft], gmat, gmatb, hist_[cleft]);
-        SubtractionTrick(hist_[cright], hist_[cleft], hist_[nid]);
+    tstart = dmlc::GetTime();
+    common::Profiler::Get()->Enter("BuildHist");
+    /* per-node work estimate decides intra-node vs inter-node parallelism:
+       nodes too small to occupy all threads on their own are built
+       concurrently, one thread each; the rest keep the parallel builder */
+    const size_t min_rows_intra_node = 512 * static_cast<size_t>(nthread_);
+    small_builds.clear();
+    sparse_builds.clear();
+    for (const SplitNode& e : expanded) {
+      // the serial path builds one scalar-width histogram per node; in
+      // vector-leaf mode every node needs all class slices, so it always
+      // goes through the wrapper
+      if (this->SparseHistEligible(row_set_collection_[e.cbuild].Size(),
+                                   gmat, gmatb)) {
+        sparse_builds.push_back(e.cbuild);
+      } else if (gmatb.GetNumBlock() == 0 && num_class_ == 0 &&
+                 expanded.size() > 1 &&
+                 row_set_collection_[e.cbuild].Size() < min_rows_intra_node) {
+        small_builds.push_back(e.cbuild);
       } else {
-        BuildHist(gpair_h, row_set_collection_[cright], gmat, gmatb, hist_[cright]);
-        SubtractionTrick(hist_[cleft], hist_[cright], hist_[nid]);
+        BuildHist(gpair_row, row_set_collection_[e.cbuild], gmat, gmatb, hist_[e.cbuild]);
       }
-      time_build_hist += dmlc::GetTime() - tstart;
+    }
+    const auto n_small = static_cast<bst_omp_uint>(small_builds.size());
+    #pragma omp parallel for schedule(dynamic) num_threads(nthread_)
+    for (bst_omp_uint i = 0; i < n_small; ++i) {
+      hist_builder_.BuildHistSerial(gpair_h, row_set_collection_[small_builds[i]],
+                                    gmat, hist_[small_builds[i]]);
+    }
+    // compact builds: gather-sort-merge per node, one thread each; the
+    // rows are installed serially since the collection is not thread safe
+    const auto n_sparse = static_cast<bst_omp_uint>(sparse_builds.size());
+    sparse_bins.resize(sparse_builds.size());
+    sparse_entries.resize(sparse_builds.size());
+    #pragma omp parallel for schedule(dynamic) num_threads(nthread_)
+    for (bst_omp_uint i = 0; i < n_sparse; ++i) {
+      hist_builder_.BuildHistSparse(gpair_h,
+                                    row_set_collection_[sparse_builds[i]],
+                                    gmat, &sparse_bins[i], &sparse_entries[i]);
+    }
+    for (size_t i = 0; i < sparse_builds.size(); ++i) {
+      hist_.AddSparseHistRow(sparse_builds[i], &sparse_bins[i],
+                             &sparse_entries[i]);
+    }
+    // reduce the freshly built child histograms across workers before the
+    // siblings are derived from them; parents were reduced when built, so
+    // the subtraction trick stays valid on globally consistent histograms
+    built_nodes.clear();
+    for (const SplitNode& e : expanded) {
+      built_nodes.push_back(e.cbuild);
+    }
+    this->ReduceHistograms(built_nodes);
+    for (const SplitNode& e : expanded) {
+      SubtractionTrick(hist_[e.csubtract], hist_[e.cbuild], hist_[e.nid]);
+      // both children exist now; recycle the parent histogram
+      hist_.ReleaseHistRow(e.nid);
+    }
+    if (common::Profiler::Enabled()) {
+      // gradient pairs gathered by the fresh builds; bin index traffic
+      // depends on row lengths and is not counted here
+      size_t batch_rows = 0;
+      for (const SplitNode& e : expanded) {
+        batch_rows += row_set_collection_[e.cbuild].Size();
+      }
+      common::Profiler::Get()->AddBytes(batch_rows * sizeof(GradientPair));
+    }
+    common::Profiler::Get()->Leave();
+    time_build_hist += dmlc::GetTime() - tstart;
 
-      tstart = dmlc::GetTime();
-      this->InitNewNode(cleft, gmat, gpair_h, *p_fmat, *p_tree);
-      this->InitNewNode(cright, gmat, gpair_h, *p_fmat, *p_tree);
-      bst_uint featureid = snode_[nid].best.SplitIndex();
-      spliteval_->AddSplit(nid, cleft, cright, featureid,
+    tstart = dmlc::GetTime();
+    common::Profiler::Get()->Enter("InitNewNode");
+    new_nodes.clear();
+    for (const SplitNode& e : expanded) {
+      const int cleft = (*p_tree)[e.nid].LeftChild();
+      const int cright = (*p_tree)[e.nid].RightChild();
+      this->InitNewNode(cleft, gmat, gpair_row, *p_fmat, *p_tree);
+      this->InitNewNode(cright, gmat, gpair_row, *p_fmat, *p_tree);
+      bst_uint featureid = snode_[e.nid].best.SplitIndex();
+      spliteval_->AddSplit(e.nid, cleft, cright, featureid,
                            snode_[cleft].weight, snode_[cright].weight);
-      time_init_new_node += dmlc::GetTime() - tstart;
+      new_nodes.push_back(cleft);
+      new_nodes.push_back(cright);
+    }
+    common::Profiler::Get()->Leave();
+    time_init_new_node += dmlc::GetTime() - tstart;
 
-      tstart = dmlc::GetTime();
-      this->EvaluateSplit(cleft, gmat, hist_, *p_fmat, *p_tree);
-      this->EvaluateSplit(cright, gmat, hist_, *p_fmat, *p_tree);
-      time_evaluate_split += dmlc::GetTime() - tstart;
+    tstart = dmlc::GetTime();
+    {
+      common::ProfileScope scope("EvaluateSplit");
+      this->EvaluateSplits(new_nodes, gmat, hist_, *p_fmat, *p_tree);
+    }
+    time_evaluate_split += dmlc::GetTime() - tstart;
 
-      qexpand_->push(ExpandEntry(cleft, p_tree->GetDepth(cleft),
-                                 snode_[cleft].best.loss_chg,
-                                 timestamp++));
-      qexpand_->push(ExpandEntry(cright, p_tree->GetDepth(cright),
-                                 snode_[cright].best.loss_chg,
+    for (int nid : new_nodes) {
+      qexpand_->push(ExpandEntry(nid, p_tree->GetDepth(nid),
+                                 snode_[nid].best.loss_chg,
                                  timestamp++));
-
-      ++num_leaves;  // give two and take one, as parent is no longer a leaf
     }
   }
 
@@ -195,7 +639,7 @@ void QuantileHistMaker::Builder::Update(const GHistIndexMatrix& gmat,
   while (!qexpand_->empty()) {
     const int nid = qexpand_->top().nid;
     qexpand_->pop();
-    (*p_tree)[nid].SetLeaf(snode_[nid].weight * param_.learning_rate);
+    this->SetNodeLeaf(p_tree, nid);
   }
   // remember auxiliary statistics in the tree node
   for (int nid = 0; nid < p_tree->param.num_nodes; ++nid) {
@@ -204,7 +648,12 @@ void QuantileHistMaker::Builder::Update(const GHistIndexMatrix& gmat,
     p_tree->Stat(nid).sum_hess = static_cast<float>(snode_[nid].stats.sum_hess);
   }
 
-  pruner_->Update(gpair, p_fmat, std::vector<RegTree*>{p_tree});
+  // vector-leaf trees skip the pruner post-pass: the in-growth pruning
+  // above already enforces min_split_loss, and the pruner would recompute
+  // scalar leaf values without knowing about the weight vectors
+  if (num_class_ == 0) {
+    pruner_->Update(gpair, p_fmat, std::vector<RegTree*>{p_tree});
+  }
 
   double total_time = dmlc::GetTime() - gstart;
   LOG(INFO) << "\nInitData:          "
@@ -242,6 +691,16 @@ bool QuantileHistMaker::Builder::UpdatePredictionCache(
   if (!p_last_fmat_ || !p_last_tree_ || data != p_last_fmat_) {
     return false;
   }
+  if (rows_elided_) {
+    // zero-gradient rows were left out of the row sets, so their new leaf
+    // values are unknown here; the predictor recomputes the new trees
+    return false;
+  }
+  if (num_class_ > 0) {
+    // the cached predictions are strided by output group; scattering the
+    // leaf vectors is left to the predictor
+    return false;
+  }
 
   if (leaf_value_cache_.empty()) {
     leaf_value_cache_.resize(p_last_tree_->param.num_nodes,
@@ -264,7 +723,7 @@ bool QuantileHistMaker::Builder::UpdatePredictionCache(
       }
       leaf_value = (*p_last_tree_)[nid].LeafValue();
 
-      for (const size_t* it = rowset.begin; it < rowset.end; ++it) {
+      for (const auto* it = rowset.begin; it < rowset.end; ++it) {
         out_preds[*it] += leaf_value;
       }
     }
@@ -287,15 +746,20 @@ void QuantileHistMaker::Builder::InitData(const GHistIndexMatrix& gmat,
                                 << "when grow_policy is depthwise.";
   }
   const auto& info = fmat.Info();
+  // the row set stores 32-bit indices; the quantized matrix lives in memory,
+  // so this bound is unreachable in practice
+  CHECK_LE(info.num_row_, std::numeric_limits<uint32_t>::max())
+      << "hist method supports at most 2^32-1 rows";
 
   {
     // initialize the row set
     row_set_collection_.Clear();
     // clear local prediction cache
     leaf_value_cache_.clear();
-    // initialize histogram collection
+    // initialize histogram collection; a vector-leaf tree keeps one
+    // scalar-width histogram per class in each row
     uint32_t nbins = gmat.cut.row_ptr.back();
-    hist_.Init(nbins);
+    hist_.Init(num_class_ > 0 ? nbins * num_class_ : nbins);
 
     // initialize histogram builder
 #pragma omp parallel
@@ -303,21 +767,66 @@ void QuantileHistMaker::Builder::InitData(const GHistIndexMatrix& gmat,
       this->nthread_ = omp_get_num_threads();
     }
     hist_builder_.Init(this->nthread_, nbins);
+    // (optional) pack this iteration's gradient pairs into half precision,
+    // so every BuildHist pass over them moves half the memory; the packed
+    // copy covers a single gradient vector, so vector-leaf builds, which
+    // cycle through the per-class copies, keep full precision
+    if (param_.compress_grad_pairs && num_class_ == 0) {
+      hist_builder_.CompressGradients(gpair);
+    } else {
+      hist_builder_.ClearCompressedGradients();
+    }
 
     CHECK_EQ(info.root_index_.size(), 0U);
-    std::vector<size_t>& row_indices = row_set_collection_.row_indices_;
+    auto& row_indices = row_set_collection_.row_indices_;
+    using RowIdx = RowSetCollection::RowIdx;
+    const auto num_row = static_cast<RowIdx>(info.num_row_);
+    // an exactly zero pair (e.g. a zero-weight row) contributes nothing to
+    // any histogram, node statistic or split gain, so the row may be left
+    // out of the working set entirely; the local prediction cache walks
+    // the row sets and cannot serve left-out rows, hence the flag
+    const bool elide_zero = param_.elide_zero_gradient_rows;
+    rows_elided_ = false;
+    auto keep_row = [&](RowIdx i) {
+      if (gpair[i].GetHess() < 0.0f) {
+        return false;
+      }
+      if (elide_zero && gpair[i].GetGrad() == 0.0f &&
+          gpair[i].GetHess() == 0.0f) {
+        rows_elided_ = true;
+        return false;
+      }
+      return true;
+    };
     // mark subsample and build list of member rows
     if (param_.subsample < 1.0f) {
       std::bernoulli_distribution coin_flip(param_.subsample);
       auto& rnd = common::GlobalRandom();
-      for (size_t i = 0; i < info.num_row_; ++i) {
-        if (gpair[i].GetHess() >= 0.0f && coin_flip(rnd)) {
+      for (RowIdx i = 0; i < num_row; ++i) {
+        if (keep_row(i) && coin_flip(rnd)) {
           row_indices.push_back(i);
         }
       }
+    } else if (common::HistNumaAware()) {
+      // first-touch the row set with the same static partition BuildHist
+      // assigns rows by, then compact out deleted rows in place; the
+      // compaction rewrites values but does not move pages between nodes
+      row_indices.resize(info.num_row_);
+      const auto nrows = static_cast<bst_omp_uint>(info.num_row_);
+      #pragma omp parallel for num_threads(this->nthread_) schedule(static)
+      for (bst_omp_uint i = 0; i < nrows; ++i) {
+        row_indices[i] = i;
+      }
+      size_t nkept = 0;
+      for (RowIdx i = 0; i < num_row; ++i) {
+        if (keep_row(i)) {
+          row_indices[nkept++] = i;
+        }
+      }
+      row_indices.resize(nkept);
     } else {
-      for (size_t i = 0; i < info.num_row_; ++i) {
-        if (gpair[i].GetHess() >= 0.0f) {
+      for (RowIdx i = 0; i < num_row; ++i) {
+        if (keep_row(i)) {
           row_indices.push_back(i);
         }
       }
@@ -377,14 +886,19 @@ void QuantileHistMaker::Builder::InitData(const GHistIndexMatrix& gmat,
     CHECK_GT(min_nbins_per_feature, 0U);
   }
   {
-    snode_.reserve(256);
+    // capacity is reserved once per update, right after this returns
     snode_.clear();
+    snode_multi_.clear();
   }
   {
+    // hand the queue a pre-sized container; frontiers rarely outgrow it
+    // and the container grows geometrically past it
+    std::vector<ExpandEntry> entry_storage;
+    entry_storage.reserve(256);
     if (param_.grow_policy == TrainParam::kLossGuide) {
-      qexpand_.reset(new ExpandQueue(LossGuide));
+      qexpand_.reset(new ExpandQueue(LossGuide, std::move(entry_storage)));
     } else {
-      qexpand_.reset(new ExpandQueue(DepthWise));
+      qexpand_.reset(new ExpandQueue(DepthWise, std::move(entry_storage)));
     }
   }
 }
@@ -394,28 +908,90 @@ void QuantileHistMaker::Builder::EvaluateSplit(int nid,
                                            const HistCollection& hist,
                                            const DMatrix& fmat,
                                            const RegTree& tree) {
+  this->EvaluateSplits(std::vector<int>{nid}, gmat, hist, fmat, tree);
+}
+
+void QuantileHistMaker::Builder::EvaluateSplits(const std::vector<int>& nodes,
+                                            const GHistIndexMatrix& gmat,
+                                            const HistCollection& hist,
+                                            const DMatrix& fmat,
+                                            const RegTree& tree) {
+  if (nodes.empty()) {
+    return;
+  }
   // start enumeration
   const MetaInfo& info = fmat.Info();
-  auto p_feature_set = column_sampler_.GetFeatureSet(tree.GetDepth(nid));
-  const auto& feature_set = *p_feature_set;
-  const auto nfeature = static_cast<bst_uint>(feature_set.size());
   const auto nthread = static_cast<bst_omp_uint>(this->nthread_);
-  best_split_tloc_.resize(nthread);
+
+  // flatten (node, feature) pairs into a single task list so that split
+  // enumeration for the whole frontier shares one parallel region
+  struct SplitTask {
+    size_t node_in_set;
+    bst_uint fid;
+  };
+  std::vector<SplitTask> tasks;
+  std::vector<std::shared_ptr<std::vector<int>>> feature_sets;
+  for (size_t k = 0; k < nodes.size(); ++k) {
+    auto p_feature_set = column_sampler_.GetFeatureSet(tree.GetDepth(nodes[k]));
+    for (auto fid : *p_feature_set) {
+      // constraint evaluators veto features up front, so forbidden
+      // features never have their histograms scanned
+      if (!spliteval_->SplitAllowed(nodes[k], static_cast<bst_uint>(fid))) {
+        continue;
+      }
+      tasks.push_back({k, static_cast<bst_uint>(fid)});
+    }
+    // keep the sampled sets alive while tasks reference them
+    feature_sets.push_back(std::move(p_feature_set));
+  }
+
+  best_split_tloc_.resize(nthread * nodes.size());
+  prefix_sums_tloc_.resize(nthread);
 #pragma omp parallel for schedule(static) num_threads(nthread)
   for (bst_omp_uint tid = 0; tid < nthread; ++tid) {
-    best_split_tloc_[tid] = snode_[nid].best;
+    for (size_t k = 0; k < nodes.size(); ++k) {
+      best_split_tloc_[k * nthread + tid] = snode_[nodes[k]].best;
+    }
   }
+  const auto ntask = static_cast<bst_omp_uint>(tasks.size());
+  // select the enumeration variant once: with the plain elastic net
+  // evaluator the gain is inlined into the bin loop, dropping the
+  // per-bin virtual dispatch; with dense data the backward scan is
+  // compiled out entirely
+  const bool inline_spliteval = spliteval_->IsElasticNetOnly();
+  const bool any_missing = (data_layout_ == kSparseData);
 #pragma omp parallel for schedule(dynamic) num_threads(nthread)
-  for (bst_omp_uint i = 0; i < nfeature; ++i) {
-    const bst_uint fid = feature_set[i];
+  for (bst_omp_uint i = 0; i < ntask; ++i) {
+    const size_t k = tasks[i].node_in_set;
+    const int nid = nodes[k];
+    const bst_uint fid = tasks[i].fid;
     const unsigned tid = omp_get_thread_num();
-    this->EnumerateSplit(-1, gmat, hist[nid], snode_[nid], info,
-                         &best_split_tloc_[tid], fid, nid);
-    this->EnumerateSplit(+1, gmat, hist[nid], snode_[nid], info,
-                         &best_split_tloc_[tid], fid, nid);
+    SplitEntry* best = &best_split_tloc_[k * nthread + tid];
+    std::vector<GHistEntry>* prefix_sums = &prefix_sums_tloc_[tid];
+    if (num_class_ > 0) {
+      this->EnumerateSplitMulti(gmat, hist[nid], nid, best, fid, prefix_sums);
+    } else if (inline_spliteval) {
+      if (any_missing) {
+        this->EnumerateSplit<true, true>(gmat, hist[nid], snode_[nid], info,
+                                         best, fid, nid, prefix_sums);
+      } else {
+        this->EnumerateSplit<true, false>(gmat, hist[nid], snode_[nid], info,
+                                          best, fid, nid, prefix_sums);
+      }
+    } else {
+      if (any_missing) {
+        this->EnumerateSplit<false, true>(gmat, hist[nid], snode_[nid], info,
+                                          best, fid, nid, prefix_sums);
+      } else {
+        this->EnumerateSplit<false, false>(gmat, hist[nid], snode_[nid], info,
+                                           best, fid, nid, prefix_sums);
+      }
+    }
   }
-  for (unsigned tid = 0; tid < nthread; ++tid) {
-    snode_[nid].best.Update(best_split_tloc_[tid]);
+  for (size_t k = 0; k < nodes.size(); ++k) {
+    for (unsigned tid = 0; tid < nthread; ++tid) {
+      snode_[nodes[k]].best.Update(best_split_tloc_[k * nthread + tid]);
+    }
   }
 }
 
@@ -459,17 +1035,45 @@ void QuantileHistMaker::Builder::ApplySplit(int nid,
 
   Column column = column_matrix.GetColumn(fid);
   if (column.GetType() == xgboost::common::kDenseColumn) {
-    ApplySplitDenseData(rowset, gmat, &row_split_tloc_, column, split_cond,
-                        default_left);
+    switch (column.ElemSize()) {
+      case sizeof(uint8_t):
+        ApplySplitDenseData<uint8_t>(rowset, gmat, &row_split_tloc_, column,
+                                     split_cond, default_left);
+        break;
+      case sizeof(uint16_t):
+        ApplySplitDenseData<uint16_t>(rowset, gmat, &row_split_tloc_, column,
+                                      split_cond, default_left);
+        break;
+      default:
+        ApplySplitDenseData<uint32_t>(rowset, gmat, &row_split_tloc_, column,
+                                      split_cond, default_left);
+        break;
+    }
   } else {
-    ApplySplitSparseData(rowset, gmat, &row_split_tloc_, column, lower_bound,
-                         upper_bound, split_cond, default_left);
+    switch (column.ElemSize()) {
+      case sizeof(uint8_t):
+        ApplySplitSparseData<uint8_t>(rowset, gmat, &row_split_tloc_, column,
+                                      lower_bound, upper_bound, split_cond,
+                                      default_left);
+        break;
+      case sizeof(uint16_t):
+        ApplySplitSparseData<uint16_t>(rowset, gmat, &row_split_tloc_, column,
+                                       lower_bound, upper_bound, split_cond,
+                                       default_left);
+        break;
+      default:
+        ApplySplitSparseData<uint32_t>(rowset, gmat, &row_split_tloc_, column,
+                                       lower_bound, upper_bound, split_cond,
+                                       default_left);
+        break;
+    }
   }
 
   row_set_collection_.AddSplit(
       nid, row_split_tloc_, (*p_tree)[nid].LeftChild(), (*p_tree)[nid].RightChild());
 }
 
+template <typename BinIdxT>
 void QuantileHistMaker::Builder::ApplySplitDenseData(
     const RowSetCollection::Elem rowset,
     const GHistIndexMatrix& gmat,
@@ -478,6 +1082,7 @@ void QuantileHistMaker::Builder::ApplySplitDenseData(
     bst_int split_cond,
     bool default_left) {
   std::vector<RowSetCollection::Split>& row_split_tloc = *p_row_split_tloc;
+  const BinIdxT* index = column.Index<BinIdxT>();
   constexpr int kUnroll = 8;  // loop unrolling factor
   const size_t nrows = rowset.end - rowset.begin;
   const size_t rest = nrows % kUnroll;
@@ -487,16 +1092,16 @@ void QuantileHistMaker::Builder::ApplySplitDenseData(
     const bst_uint tid = omp_get_thread_num();
     auto& left = row_split_tloc[tid].left;
     auto& right = row_split_tloc[tid].right;
-    size_t rid[kUnroll];
+    RowSetCollection::RowIdx rid[kUnroll];
     uint32_t rbin[kUnroll];
     for (int k = 0; k < kUnroll; ++k) {
       rid[k] = rowset.begin[i + k];
     }
     for (int k = 0; k < kUnroll; ++k) {
-      rbin[k] = column.GetFeatureBinIdx(rid[k]);
+      rbin[k] = index[rid[k]];
     }
     for (int k = 0; k < kUnroll; ++k) {                      // NOLINT
-      if (rbin[k] == std::numeric_limits<uint32_t>::max()) {  // missing value
+      if (column.IsMissing(rid[k])) {  // missing value
         if (default_left) {
           left.push_back(rid[k]);
         } else {
@@ -514,15 +1119,15 @@ void QuantileHistMaker::Builder::ApplySplitDenseData(
   for (size_t i = nrows - rest; i < nrows; ++i) {
     auto& left = row_split_tloc[nthread_-1].left;
     auto& right = row_split_tloc[nthread_-1].right;
-    const size_t rid = rowset.begin[i];
-    const uint32_t rbin = column.GetFeatureBinIdx(rid);
-    if (rbin == std::numeric_limits<uint32_t>::max()) {  // missing value
+    const auto rid = rowset.begin[i];
+    if (column.IsMissing(rid)) {  // missing value
       if (default_left) {
         left.push_back(rid);
       } else {
         right.push_back(rid);
       }
     } else {
+      const uint32_t rbin = index[rid];
       if (static_cast<int32_t>(rbin + column.GetBaseIdx()) <= split_cond) {
         left.push_back(rid);
       } else {
@@ -532,6 +1137,7 @@ void QuantileHistMaker::Builder::ApplySplitDenseData(
   }
 }
 
+template <typename BinIdxT>
 void QuantileHistMaker::Builder::ApplySplitSparseData(
     const RowSetCollection::Elem rowset,
     const GHistIndexMatrix& gmat,
@@ -542,6 +1148,7 @@ void QuantileHistMaker::Builder::ApplySplitSparseData(
     bst_int split_cond,
     bool default_left) {
   std::vector<RowSetCollection::Split>& row_split_tloc = *p_row_split_tloc;
+  const BinIdxT* index = column.Index<BinIdxT>();
   const size_t nrows = rowset.end - rowset.begin;
 
 #pragma omp parallel num_threads(nthread_)
@@ -561,14 +1168,14 @@ void QuantileHistMaker::Builder::ApplySplitSparseData(
         size_t cursor = p - column.GetRowData();
 
         for (size_t i = ibegin; i < iend; ++i) {
-          const size_t rid = rowset.begin[i];
+          const auto rid = rowset.begin[i];
           while (cursor < column.Size()
                  && column.GetRowIdx(cursor) < rid
                  && column.GetRowIdx(cursor) <= rowset.begin[iend - 1]) {
             ++cursor;
           }
           if (cursor < column.Size() && column.GetRowIdx(cursor) == rid) {
-            const uint32_t rbin = column.GetFeatureBinIdx(cursor);
+            const uint32_t rbin = index[cursor];
             if (static_cast<int32_t>(rbin + column.GetBaseIdx()) <= split_cond) {
               left.push_back(rid);
             } else {
@@ -587,13 +1194,11 @@ void QuantileHistMaker::Builder::ApplySplitSparseData(
       } else {  // all rows in [ibegin, iend) have missing values
         if (default_left) {
           for (size_t i = ibegin; i < iend; ++i) {
-            const size_t rid = rowset.begin[i];
-            left.push_back(rid);
+            left.push_back(rowset.begin[i]);
           }
         } else {
           for (size_t i = ibegin; i < iend; ++i) {
-            const size_t rid = rowset.begin[i];
-            right.push_back(rid);
+            right.push_back(rowset.begin[i]);
           }
         }
       }
@@ -601,6 +1206,45 @@ void QuantileHistMaker::Builder::ApplySplitSparseData(
   }
 }
 
+bool QuantileHistMaker::Builder::SparseHistEligible(
+    size_t nrows,
+    const GHistIndexMatrix& gmat,
+    const GHistIndexBlockMatrix& gmatb) const {
+  // the compact form never participates in the histogram allreduce, the
+  // vector-leaf class slices or the feature-grouped builder
+  if (param_.sparse_histogram_occupancy <= 0.0 || rabit::IsDistributed() ||
+      num_class_ > 0 || gmatb.GetNumBlock() != 0) {
+    return false;
+  }
+  // a node's rows can occupy at most one bin per row and feature, so
+  // nrows * num_feature bounds the stored entries from above
+  const size_t num_feature = gmat.cut.row_ptr.size() - 1;
+  const auto nbins = static_cast<double>(gmat.cut.row_ptr.back());
+  return static_cast<double>(nrows) * num_feature <=
+         param_.sparse_histogram_occupancy * nbins;
+}
+
+void QuantileHistMaker::Builder::ReduceHistograms(const std::vector<int>& nodes) {
+  if (!rabit::IsDistributed() || nodes.empty()) {
+    return;
+  }
+  // histogram rows live in pool slots that are not necessarily contiguous;
+  // stage them into one buffer so all nodes share a single allreduce round
+  const size_t nbins = hist_[nodes[0]].size;
+  hist_reduce_buf_.resize(2 * nbins * nodes.size());
+  for (size_t k = 0; k < nodes.size(); ++k) {
+    std::memcpy(hist_reduce_buf_.data() + 2 * nbins * k,
+                hist_[nodes[k]].begin, 2 * nbins * sizeof(double));
+  }
+  rabit::Allreduce<rabit::op::Sum>(hist_reduce_buf_.data(),
+                                   hist_reduce_buf_.size());
+  for (size_t k = 0; k < nodes.size(); ++k) {
+    std::memcpy(hist_[nodes[k]].begin,
+                hist_reduce_buf_.data() + 2 * nbins * k,
+                2 * nbins * sizeof(double));
+  }
+}
+
 void QuantileHistMaker::Builder::InitNewNode(int nid,
                                          const GHistIndexMatrix& gmat,
                                          const std::vector<GradientPair>& gpair,
@@ -610,6 +1254,56 @@ void QuantileHistMaker::Builder::InitNewNode(int nid,
     snode_.resize(tree.param.num_nodes, NodeEntry(param_));
   }
 
+  if (num_class_ > 0) {
+    // vector-leaf mode: per-class statistics drive the gains and leaf
+    // weights; the pooled entry in snode_ keeps the scalar bookkeeping
+    // (Stat output, split evaluator state) meaningful
+    snode_multi_.resize(
+        static_cast<size_t>(tree.param.num_nodes) * num_class_,
+        GradStats(param_));
+    GradStats* cls = &snode_multi_[static_cast<size_t>(nid) * num_class_];
+    const uint32_t nbins_total = gmat.cut.row_ptr.back();
+    if (data_layout_ == kDenseDataZeroBased || data_layout_ == kDenseDataOneBased) {
+      // dense data: sum the class slice of the least-binned feature,
+      // mirroring the scalar shortcut below
+      GHistRow hist = hist_[nid];
+      const std::vector<uint32_t>& row_ptr = gmat.cut.row_ptr;
+      const uint32_t ibegin = row_ptr[fid_least_bins_];
+      const uint32_t iend = row_ptr[fid_least_bins_ + 1];
+      for (int k = 0; k < num_class_; ++k) {
+        const GHistEntry* slice =
+            hist.begin + static_cast<size_t>(k) * nbins_total;
+        for (uint32_t i = ibegin; i < iend; ++i) {
+          cls[k].Add(slice[i].sum_grad, slice[i].sum_hess);
+        }
+      }
+    } else {
+      const RowSetCollection::Elem e = row_set_collection_[nid];
+      for (int k = 0; k < num_class_; ++k) {
+        const std::vector<GradientPair>& gp = gpair_class_[k];
+        for (const auto* it = e.begin; it < e.end; ++it) {
+          cls[k].Add(gp[*it]);
+        }
+      }
+      if (rabit::IsDistributed()) {
+        // as in the scalar path: the dense shortcut reads the reduced
+        // histogram, the sparse path sums local rows only
+        rabit::Allreduce<rabit::op::Sum>(&cls[0].sum_grad, 2 * num_class_);
+      }
+    }
+    auto& stats = snode_[nid].stats;
+    double root_gain = 0.0;
+    for (int k = 0; k < num_class_; ++k) {
+      stats.Add(cls[k]);
+      root_gain += cls[k].CalcGain(param_);
+    }
+    bst_uint parentid = tree[nid].Parent();
+    snode_[nid].weight = static_cast<float>(
+        spliteval_->ComputeWeight(parentid, stats));
+    snode_[nid].root_gain = static_cast<float>(root_gain);
+    return;
+  }
+
   {
     auto& stats = snode_[nid].stats;
     if (data_layout_ == kDenseDataZeroBased || data_layout_ == kDenseDataOneBased) {
@@ -621,15 +1315,33 @@ void QuantileHistMaker::Builder::InitNewNode(int nid,
 
       const uint32_t ibegin = row_ptr[fid_least_bins_];
       const uint32_t iend = row_ptr[fid_least_bins_ + 1];
-      for (uint32_t i = ibegin; i < iend; ++i) {
-        const GHistEntry et = hist.begin[i];
-        stats.Add(et.sum_grad, et.sum_hess);
+      if (hist.IsSparse()) {
+        // compact row: only its occupied bins inside the feature range
+        const uint32_t* lo =
+            std::lower_bound(hist.bins, hist.bins + hist.size, ibegin);
+        const uint32_t* hi =
+            std::lower_bound(lo, hist.bins + hist.size, iend);
+        for (const uint32_t* it = lo; it != hi; ++it) {
+          const GHistEntry et = hist.begin[it - hist.bins];
+          stats.Add(et.sum_grad, et.sum_hess);
+        }
+      } else {
+        for (uint32_t i = ibegin; i < iend; ++i) {
+          const GHistEntry et = hist.begin[i];
+          stats.Add(et.sum_grad, et.sum_hess);
+        }
       }
     } else {
       const RowSetCollection::Elem e = row_set_collection_[nid];
-      for (const size_t* it = e.begin; it < e.end; ++it) {
+      for (const auto* it = e.begin; it < e.end; ++it) {
         stats.Add(gpair[*it]);
       }
+      if (rabit::IsDistributed()) {
+        // the dense layout derives stats from the already-reduced histogram;
+        // the sparse path sums local rows only, so reduce explicitly before
+        // weights and gains are computed from them
+        rabit::Allreduce<rabit::op::Sum>(&stats.sum_grad, 2);
+      }
     }
   }
 
@@ -643,74 +1355,301 @@ void QuantileHistMaker::Builder::InitNewNode(int nid,
   }
 }
 
+void QuantileHistMaker::Builder::SetNodeLeaf(RegTree* p_tree, int nid) {
+  (*p_tree)[nid].SetLeaf(snode_[nid].weight * param_.learning_rate);
+  if (num_class_ > 0) {
+    const GradStats* cls = &snode_multi_[static_cast<size_t>(nid) * num_class_];
+    std::vector<bst_float> leaf(num_class_);
+    for (int k = 0; k < num_class_; ++k) {
+      leaf[k] = static_cast<bst_float>(
+          cls[k].CalcWeight(param_) * param_.learning_rate);
+    }
+    p_tree->SetLeafVector(nid, leaf);
+  }
+}
+
 // enumerate the split values of specific feature
-void QuantileHistMaker::Builder::EnumerateSplit(int d_step,
-                                            const GHistIndexMatrix& gmat,
+template <bool inline_spliteval, bool any_missing>
+void QuantileHistMaker::Builder::EnumerateSplit(const GHistIndexMatrix& gmat,
                                             const GHistRow& hist,
                                             const NodeEntry& snode,
                                             const MetaInfo& info,
                                             SplitEntry* p_best,
                                             bst_uint fid,
-                                            bst_uint nodeID) {
-  CHECK(d_step == +1 || d_step == -1);
-
+                                            bst_uint nodeID,
+                                            std::vector<GHistEntry>* p_prefix_sums) {
   // aliases
   const std::vector<uint32_t>& cut_ptr = gmat.cut.row_ptr;
   const std::vector<bst_float>& cut_val = gmat.cut.cut;
 
-  // statistics on both sides of split
-  GradStats c(param_);
-  GradStats e(param_);
-  // best split so far
-  SplitEntry best;
-
   // bin boundaries
   CHECK_LE(cut_ptr[fid],
            static_cast<uint32_t>(std::numeric_limits<int32_t>::max()));
   CHECK_LE(cut_ptr[fid + 1],
            static_cast<uint32_t>(std::numeric_limits<int32_t>::max()));
-  // imin: index (offset) of the minimum value for feature fid
-  //       need this for backward enumeration
-  const auto imin = static_cast<int32_t>(cut_ptr[fid]);
-  // ibegin, iend: smallest/largest cut points for feature fid
-  // use int to allow for value -1
-  int32_t ibegin, iend;
-  if (d_step > 0) {
-    ibegin = static_cast<int32_t>(cut_ptr[fid]);
-    iend = static_cast<int32_t>(cut_ptr[fid + 1]);
-  } else {
-    ibegin = static_cast<int32_t>(cut_ptr[fid + 1]) - 1;
-    iend = static_cast<int32_t>(cut_ptr[fid]) - 1;
+  const uint32_t ibegin = cut_ptr[fid];
+  const uint32_t nbin = cut_ptr[fid + 1] - ibegin;
+  if (nbin == 0) {
+    return;
   }
 
-  for (int32_t i = ibegin; i != iend; i += d_step) {
-    // start working
-    // try to find a split
-    e.Add(hist.begin[i].sum_grad, hist.begin[i].sum_hess);
+  if (hist.IsSparse()) {
+    /* compact row: only the occupied bins carry mass, and a split at an
+       empty bin partitions this node's rows exactly like the nearest
+       occupied bin to its left, so scanning the stored bins enumerates
+       every distinct partition. Scan work follows the node's occupancy
+       instead of nbin */
+    const uint32_t* lo =
+        std::lower_bound(hist.bins, hist.bins + hist.size, ibegin);
+    const uint32_t* hi =
+        std::lower_bound(lo, hist.bins + hist.size, ibegin + nbin);
+    const auto n = static_cast<uint32_t>(hi - lo);
+    if (n == 0) {
+      return;
+    }
+    std::vector<GHistEntry>& prefix_sums = *p_prefix_sums;
+    prefix_sums.resize(n);
+    prefix_sums[0] = hist.begin[lo - hist.bins];
+    for (uint32_t k = 1; k < n; ++k) {
+      prefix_sums[k] = prefix_sums[k - 1];
+      prefix_sums[k].Add(hist.begin[(lo - hist.bins) + k]);
+    }
+    const GHistEntry total = prefix_sums[n - 1];
+    GradStats c(param_);
+    GradStats e(param_);
+    SplitEntry best;
+    // forward enumeration: split at the right bound of each occupied bin
+    for (uint32_t k = 0; k < n; ++k) {
+      e.sum_grad = prefix_sums[k].sum_grad;
+      e.sum_hess = prefix_sums[k].sum_hess;
+      if (e.sum_hess >= param_.min_child_weight) {
+        c.SetSubstract(snode.stats, e);
+        if (c.sum_hess >= param_.min_child_weight) {
+          bst_float loss_chg;
+          if (inline_spliteval) {
+            loss_chg = static_cast<bst_float>(
+                e.CalcGain(param_) + c.CalcGain(param_) - snode.root_gain);
+          } else {
+            loss_chg = static_cast<bst_float>(
+                spliteval_->ComputeSplitScore(nodeID, fid, e, c) -
+                snode.root_gain);
+          }
+          best.Update(loss_chg, fid, cut_val[lo[k]], false);
+        }
+      }
+    }
+    // backward enumeration: split at the left bound of each occupied bin
+    if (any_missing) {
+      for (uint32_t k = n; k-- > 0;) {
+        e.sum_grad =
+            total.sum_grad - (k == 0 ? 0.0 : prefix_sums[k - 1].sum_grad);
+        e.sum_hess =
+            total.sum_hess - (k == 0 ? 0.0 : prefix_sums[k - 1].sum_hess);
+        if (e.sum_hess >= param_.min_child_weight) {
+          c.SetSubstract(snode.stats, e);
+          if (c.sum_hess >= param_.min_child_weight) {
+            bst_float loss_chg;
+            if (inline_spliteval) {
+              loss_chg = static_cast<bst_float>(
+                  c.CalcGain(param_) + e.CalcGain(param_) - snode.root_gain);
+            } else {
+              loss_chg = static_cast<bst_float>(
+                  spliteval_->ComputeSplitScore(nodeID, fid, c, e) -
+                  snode.root_gain);
+            }
+            bst_float split_pt;
+            if (lo[k] == ibegin) {
+              // for the leftmost bin, the left bound is the smallest
+              // feature value
+              split_pt = gmat.cut.min_val[fid];
+            } else {
+              split_pt = cut_val[lo[k] - 1];
+            }
+            best.Update(loss_chg, fid, split_pt, true);
+          }
+        }
+      }
+    }
+    p_best->Update(best);
+    return;
+  }
+
+  /* one shared pass over the feature's bins: prefix_sums[k] accumulates
+     bins [ibegin, ibegin + k]. grad and hess are adjacent doubles, so every
+     step is a single 128-bit vector add; both the forward and the backward
+     scan below then read the precomputed sums instead of re-accumulating */
+  std::vector<GHistEntry>& prefix_sums = *p_prefix_sums;
+  prefix_sums.resize(nbin);
+  prefix_sums[0] = hist.begin[ibegin];
+  for (uint32_t k = 1; k < nbin; ++k) {
+    prefix_sums[k] = prefix_sums[k - 1];
+    prefix_sums[k].Add(hist.begin[ibegin + k]);
+  }
+  const GHistEntry total = prefix_sums[nbin - 1];
+
+  // statistics on both sides of split
+  GradStats c(param_);
+  GradStats e(param_);
+  // best split so far
+  SplitEntry best;
+
+  // forward enumeration: split at right bound of each bin,
+  // missing values default to the right child
+  for (uint32_t k = 0; k < nbin; ++k) {
+    e.sum_grad = prefix_sums[k].sum_grad;
+    e.sum_hess = prefix_sums[k].sum_hess;
     if (e.sum_hess >= param_.min_child_weight) {
       c.SetSubstract(snode.stats, e);
       if (c.sum_hess >= param_.min_child_weight) {
         bst_float loss_chg;
-        bst_float split_pt;
-        if (d_step > 0) {
-          // forward enumeration: split at right bound of each bin
+        if (inline_spliteval) {
+          // compile-time branch: pure elastic net arithmetic on param_
           loss_chg = static_cast<bst_float>(
-              spliteval_->ComputeSplitScore(nodeID, fid, e, c) -
-              snode.root_gain);
-          split_pt = cut_val[i];
+              e.CalcGain(param_) + c.CalcGain(param_) - snode.root_gain);
         } else {
-          // backward enumeration: split at left bound of each bin
           loss_chg = static_cast<bst_float>(
-              spliteval_->ComputeSplitScore(nodeID, fid, c, e) -
+              spliteval_->ComputeSplitScore(nodeID, fid, e, c) -
               snode.root_gain);
-          if (i == imin) {
+        }
+        best.Update(loss_chg, fid, cut_val[ibegin + k], false);
+      }
+    }
+  }
+
+  // backward enumeration: split at left bound of each bin,
+  // missing values default to the left child.
+  // compiled out for dense data, where every backward candidate
+  // partitions the rows exactly like a forward one
+  if (any_missing) {
+    for (uint32_t k = nbin; k-- > 0;) {
+      e.sum_grad = total.sum_grad - (k == 0 ? 0.0 : prefix_sums[k - 1].sum_grad);
+      e.sum_hess = total.sum_hess - (k == 0 ? 0.0 : prefix_sums[k - 1].sum_hess);
+      if (e.sum_hess >= param_.min_child_weight) {
+        c.SetSubstract(snode.stats, e);
+        if (c.sum_hess >= param_.min_child_weight) {
+          bst_float loss_chg;
+          if (inline_spliteval) {
+            loss_chg = static_cast<bst_float>(
+                c.CalcGain(param_) + e.CalcGain(param_) - snode.root_gain);
+          } else {
+            loss_chg = static_cast<bst_float>(
+                spliteval_->ComputeSplitScore(nodeID, fid, c, e) -
+                snode.root_gain);
+          }
+          bst_float split_pt;
+          if (k == 0) {
             // for leftmost bin, left bound is the smallest feature value
             split_pt = gmat.cut.min_val[fid];
           } else {
-            split_pt = cut_val[i - 1];
+            split_pt = cut_val[ibegin + k - 1];
           }
+          best.Update(loss_chg, fid, split_pt, true);
+        }
+      }
+    }
+  }
+  p_best->Update(best);
+}
+
+// enumerate the split values of one feature of a vector-leaf tree. The
+// histogram row holds num_class_ scalar-width histograms back to back;
+// one prefix-sum pass per class, then the forward (and, with missing
+// values, backward) scans combine the per-class elastic net gains
+void QuantileHistMaker::Builder::EnumerateSplitMulti(
+    const GHistIndexMatrix& gmat,
+    const GHistRow& hist,
+    int nid,
+    SplitEntry* p_best,
+    bst_uint fid,
+    std::vector<GHistEntry>* p_prefix_sums) {
+  const std::vector<uint32_t>& cut_ptr = gmat.cut.row_ptr;
+  const std::vector<bst_float>& cut_val = gmat.cut.cut;
+  const uint32_t nbins_total = cut_ptr.back();
+  const int nclass = num_class_;
+
+  CHECK_LE(cut_ptr[fid + 1],
+           static_cast<uint32_t>(std::numeric_limits<int32_t>::max()));
+  const uint32_t ibegin = cut_ptr[fid];
+  const uint32_t nbin = cut_ptr[fid + 1] - ibegin;
+  if (nbin == 0) {
+    return;
+  }
+
+  std::vector<GHistEntry>& prefix_sums = *p_prefix_sums;
+  prefix_sums.resize(static_cast<size_t>(nbin) * nclass);
+  for (int k = 0; k < nclass; ++k) {
+    const GHistEntry* slice =
+        hist.begin + static_cast<size_t>(k) * nbins_total + ibegin;
+    GHistEntry* ps = prefix_sums.data() + static_cast<size_t>(k) * nbin;
+    ps[0] = slice[0];
+    for (uint32_t j = 1; j < nbin; ++j) {
+      ps[j] = ps[j - 1];
+      ps[j].Add(slice[j]);
+    }
+  }
+
+  const GradStats* cls = &snode_multi_[static_cast<size_t>(nid) * nclass];
+  const NodeEntry& snode = snode_[nid];
+  SplitEntry best;
+
+  // forward enumeration: split at right bound of each bin,
+  // missing values default to the right child
+  for (uint32_t j = 0; j < nbin; ++j) {
+    double e_hess = 0.0;
+    for (int k = 0; k < nclass; ++k) {
+      e_hess += prefix_sums[static_cast<size_t>(k) * nbin + j].sum_hess;
+    }
+    const double c_hess = snode.stats.sum_hess - e_hess;
+    if (e_hess >= param_.min_child_weight &&
+        c_hess >= param_.min_child_weight) {
+      double gain = 0.0;
+      for (int k = 0; k < nclass; ++k) {
+        const GHistEntry& p = prefix_sums[static_cast<size_t>(k) * nbin + j];
+        gain += CalcGain(param_, p.sum_grad, p.sum_hess) +
+                CalcGain(param_, cls[k].sum_grad - p.sum_grad,
+                         cls[k].sum_hess - p.sum_hess);
+      }
+      const auto loss_chg = static_cast<bst_float>(gain - snode.root_gain);
+      best.Update(loss_chg, fid, cut_val[ibegin + j], false);
+    }
+  }
+
+  // backward enumeration: split at left bound of each bin, missing values
+  // default to the left child; pointless on dense data, as in the scalar
+  // enumeration
+  if (data_layout_ == kSparseData) {
+    for (uint32_t j = nbin; j-- > 0;) {
+      double e_hess = 0.0;
+      for (int k = 0; k < nclass; ++k) {
+        const size_t base = static_cast<size_t>(k) * nbin;
+        e_hess += prefix_sums[base + nbin - 1].sum_hess -
+                  (j == 0 ? 0.0 : prefix_sums[base + j - 1].sum_hess);
+      }
+      const double c_hess = snode.stats.sum_hess - e_hess;
+      if (e_hess >= param_.min_child_weight &&
+          c_hess >= param_.min_child_weight) {
+        double gain = 0.0;
+        for (int k = 0; k < nclass; ++k) {
+          const size_t base = static_cast<size_t>(k) * nbin;
+          const double eg =
+              prefix_sums[base + nbin - 1].sum_grad -
+              (j == 0 ? 0.0 : prefix_sums[base + j - 1].sum_grad);
+          const double eh =
+              prefix_sums[base + nbin - 1].sum_hess -
+              (j == 0 ? 0.0 : prefix_sums[base + j - 1].sum_hess);
+          gain += CalcGain(param_, eg, eh) +
+                  CalcGain(param_, cls[k].sum_grad - eg,
+                           cls[k].sum_hess - eh);
+        }
+        const auto loss_chg = static_cast<bst_float>(gain - snode.root_gain);
+        bst_float split_pt;
+        if (j == 0) {
+          // for leftmost bin, left bound is the smallest feature value
+          split_pt = gmat.cut.min_val[fid];
+        } else {
+          split_pt = cut_val[ibegin + j - 1];
         }
-        best.Update(loss_chg, fid, split_pt, d_step == -1);
+        best.Update(loss_chg, fid, split_pt, true);
       }
     }
   }
@@ -32,7 +32,9 @@ using xgboost::common::GHistIndexBlockMatrix;
 using xgboost::common::GHistIndexRow;
 using xgboost::common::GHistEntry;
 using xgboost::common::HistCollection;
-using xgboost::common::RowSetCollection;
+// the quantized matrix is held in memory, so row counts always fit 32 bits;
+// the narrow index halves the memory traffic of the partition arrays
+using RowSetCollection = xgboost::common::RowSetCollectionT<uint32_t>;
 using xgboost::common::GHistRow;
 using xgboost::common::GHistBuilder;
 using xgboost::common::ColumnMatrix;
@@ -50,16 +52,36 @@ class QuantileHistMaker: public TreeUpdater {
   bool UpdatePredictionCache(const DMatrix* data,
                              HostDeviceVector<bst_float>* out_preds) override;
 
+  /*!
+   * \brief quantized data matrix together with the structures derived from
+   *  it. Entries live in a process-wide cache keyed by the DMatrix and a
+   *  content fingerprint, so repeated train() calls -- including ones from
+   *  a fresh Learner -- reuse the quantization instead of rebuilding it.
+   */
+  struct GMatCacheEntry {
+    // quantized data matrix; shared so it can also be published in the
+    // process-wide registry consumed by the CPU predictor
+    std::shared_ptr<GHistIndexMatrix> gmat;
+    // (optional) data matrix with feature grouping
+    GHistIndexBlockMatrix gmatb;
+    // column accessor
+    ColumnMatrix column_matrix;
+    // content fingerprint the entry was built from
+    uint64_t fingerprint{0};
+    // max_bin the cut points were sketched with
+    int max_bin{0};
+    // whether gmatb was materialized
+    bool has_blocks{false};
+  };
+
  protected:
   // training parameter
   TrainParam param_;
-  // quantized data matrix
-  GHistIndexMatrix gmat_;
-  // (optional) data matrix with feature grouping
-  GHistIndexBlockMatrix gmatb_;
-  // column accessor
-  ColumnMatrix column_matrix_;
-  bool is_gmat_initialized_;
+  // arguments of the last Init call, needed to outfit the per-tree
+  // builders of a task-parallel forest round with their own pruners
+  std::vector<std::pair<std::string, std::string> > args_;
+  // hold the quantized matrix entry for the DMatrix being trained on
+  std::shared_ptr<GMatCacheEntry> gmat_cache_;
 
   // data structure
   struct NodeEntry {
@@ -100,7 +122,24 @@ class QuantileHistMaker: public TreeUpdater {
                           const GHistIndexMatrix& gmat,
                           const GHistIndexBlockMatrix& gmatb,
                           GHistRow hist) {
-      if (param_.enable_feature_grouping > 0) {
+      if (num_class_ > 0) {
+        // vector-leaf mode: one scalar-width histogram per class, laid out
+        // back to back inside the K-wide row. The gpair argument is the
+        // pooled copy and only the per-class copies are aggregated here
+        const uint32_t nbins = hist.size / num_class_;
+        for (int k = 0; k < num_class_; ++k) {
+          GHistRow slice(hist.begin + static_cast<size_t>(k) * nbins, nbins);
+          if (gmatb.GetNumBlock() > 0) {
+            hist_builder_.BuildBlockHist(gpair_class_[k], row_indices, gmatb, slice);
+          } else {
+            hist_builder_.BuildHist(gpair_class_[k], row_indices, gmat, slice);
+          }
+        }
+        return;
+      }
+      // a materialized block matrix means feature grouping was selected,
+      // whether explicitly or by the data-driven auto tuner
+      if (gmatb.GetNumBlock() > 0) {
         hist_builder_.BuildBlockHist(gpair, row_indices, gmatb, hist);
       } else {
         hist_builder_.BuildHist(gpair, row_indices, gmat, hist);
@@ -108,6 +147,16 @@ class QuantileHistMaker: public TreeUpdater {
     }
 
     inline void SubtractionTrick(GHistRow self, GHistRow sibling, GHistRow parent) {
+      if (num_class_ > 0) {
+        const uint32_t nbins = self.size / num_class_;
+        for (int k = 0; k < num_class_; ++k) {
+          const size_t off = static_cast<size_t>(k) * nbins;
+          hist_builder_.SubtractionTrick(GHistRow(self.begin + off, nbins),
+                                         GHistRow(sibling.begin + off, nbins),
+                                         GHistRow(parent.begin + off, nbins));
+        }
+        return;
+      }
       hist_builder_.SubtractionTrick(self, sibling, parent);
     }
 
@@ -127,6 +176,14 @@ class QuantileHistMaker: public TreeUpdater {
                        const DMatrix& fmat,
                        const RegTree& tree);
 
+    // evaluate splits for a batch of frontier nodes in one parallel region,
+    // distributing (node, feature) pairs over threads
+    void EvaluateSplits(const std::vector<int>& nodes,
+                        const GHistIndexMatrix& gmat,
+                        const HistCollection& hist,
+                        const DMatrix& fmat,
+                        const RegTree& tree);
+
     void ApplySplit(int nid,
                     const GHistIndexMatrix& gmat,
                     const ColumnMatrix& column_matrix,
@@ -134,6 +191,9 @@ class QuantileHistMaker: public TreeUpdater {
                     const DMatrix& fmat,
                     RegTree* p_tree);
 
+    // BinIdxT is the element width of the column matrix; ApplySplit
+    // dispatches on ColumnMatrix::ElemSize() once per split
+    template <typename BinIdxT>
     void ApplySplitDenseData(const RowSetCollection::Elem rowset,
                              const GHistIndexMatrix& gmat,
                              std::vector<RowSetCollection::Split>* p_row_split_tloc,
@@ -141,6 +201,7 @@ class QuantileHistMaker: public TreeUpdater {
                              bst_int split_cond,
                              bool default_left);
 
+    template <typename BinIdxT>
     void ApplySplitSparseData(const RowSetCollection::Elem rowset,
                               const GHistIndexMatrix& gmat,
                               std::vector<RowSetCollection::Split>* p_row_split_tloc,
@@ -156,15 +217,50 @@ class QuantileHistMaker: public TreeUpdater {
                      const DMatrix& fmat,
                      const RegTree& tree);
 
-    // enumerate the split values of specific feature
-    void EnumerateSplit(int d_step,
-                        const GHistIndexMatrix& gmat,
+    // mark nid as a leaf; in vector-leaf mode the per-class weights are
+    // stored alongside the scalar (pooled) leaf value
+    void SetNodeLeaf(RegTree* p_tree, int nid);
+
+    // allreduce the histograms of the given nodes across workers in one
+    // fused call; no-op outside of distributed mode
+    void ReduceHistograms(const std::vector<int>& nodes);
+
+    // whether a freshly built child histogram over this many rows should
+    // use the compact (bin id, entry) form instead of a dense row
+    bool SparseHistEligible(size_t nrows,
+                            const GHistIndexMatrix& gmat,
+                            const GHistIndexBlockMatrix& gmatb) const;
+
+    // enumerate the split values of specific feature, scanning forward and
+    // backward over one shared pass of prefix-summed histogram bins.
+    // p_prefix_sums is caller-provided (per-thread) scratch space.
+    // when inline_spliteval is set the evaluator is known to be the plain
+    // elastic net penalty and the gain is computed inline from param_,
+    // keeping virtual dispatch out of the per-bin loop; when any_missing
+    // is clear the data is dense and the backward scan is dropped, since
+    // without missing values it would enumerate the same partitions as
+    // the forward one.  both variants are selected once per batch of
+    // nodes in EvaluateSplits
+    template <bool inline_spliteval, bool any_missing>
+    void EnumerateSplit(const GHistIndexMatrix& gmat,
                         const GHistRow& hist,
                         const NodeEntry& snode,
                         const MetaInfo& info,
                         SplitEntry* p_best,
                         bst_uint fid,
-                        bst_uint nodeID);
+                        bst_uint nodeID,
+                        std::vector<GHistEntry>* p_prefix_sums);
+
+    // split enumeration for vector-leaf trees: one prefix-sum pass per
+    // class over the K-wide histogram row, candidate gain is the sum of
+    // the per-class elastic net gains, min_child_weight applies to the
+    // class-pooled hessian
+    void EnumerateSplitMulti(const GHistIndexMatrix& gmat,
+                             const GHistRow& hist,
+                             int nid,
+                             SplitEntry* p_best,
+                             bst_uint fid,
+                             std::vector<GHistEntry>* p_prefix_sums);
 
     /* tree growing policies */
     struct ExpandEntry {
@@ -200,8 +296,23 @@ class QuantileHistMaker: public TreeUpdater {
     // the temp space for split
     std::vector<RowSetCollection::Split> row_split_tloc_;
     std::vector<SplitEntry> best_split_tloc_;
+    // per-thread scratch for prefix sums used in split enumeration
+    std::vector<std::vector<GHistEntry>> prefix_sums_tloc_;
+    // staging buffer for the fused histogram allreduce
+    std::vector<double> hist_reduce_buf_;
     /*! \brief TreeNode Data: statistics for each constructed node */
     std::vector<NodeEntry> snode_;
+    // number of output classes when growing a vector-leaf tree
+    // (tree.param.size_leaf_vector > 1); 0 selects the scalar code paths
+    int num_class_{0};
+    // per-class gradient copies, num_class_ x num_row; the histogram
+    // builds gather one class at a time
+    std::vector<std::vector<GradientPair>> gpair_class_;
+    // gradients pooled over the classes of each row, for row filtering
+    // and the scalar node statistics
+    std::vector<GradientPair> gpair_pooled_;
+    // per-class node statistics, num_nodes x num_class_
+    std::vector<GradStats> snode_multi_;
     /*! \brief culmulative histogram of gradients. */
     HistCollection hist_;
     /*! \brief feature with least # of bins. to be used for dense specialization
@@ -209,6 +320,9 @@ class QuantileHistMaker: public TreeUpdater {
     uint32_t fid_least_bins_;
     /*! \brief local prediction cache; maps node id to leaf value */
     std::vector<float> leaf_value_cache_;
+    /*! \brief whether the last InitData left zero-gradient rows out of the
+     *         row sets; the local prediction cache is then unusable */
+    bool rows_elided_{false};
 
     GHistBuilder hist_builder_;
     std::unique_ptr<TreeUpdater> pruner_;
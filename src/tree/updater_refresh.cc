@@ -31,25 +31,27 @@ class TreeRefresher: public TreeUpdater {
               const std::vector<RegTree*> &trees) override {
     if (trees.size() == 0) return;
     const std::vector<GradientPair> &gpair_h = gpair->ConstHostVector();
-    // number of threads
-    // thread temporal space
-    std::vector<std::vector<TStats> > stemp;
-    std::vector<RegTree::FVec> fvec_temp;
-    // setup temp space for each thread
     const int nthread = omp_get_max_threads();
-    fvec_temp.resize(nthread, RegTree::FVec());
-    stemp.resize(nthread, std::vector<TStats>());
-    #pragma omp parallel
-    {
-      int tid = omp_get_thread_num();
-      int num_nodes = 0;
-      for (auto tree : trees) {
-        num_nodes += tree->param.num_nodes;
-      }
-      stemp[tid].resize(num_nodes, TStats(param_));
-      std::fill(stemp[tid].begin(), stemp[tid].end(), TStats(param_));
-      fvec_temp[tid].Init(trees[0]->param.num_feature);
+    // rows walked as a tile sharing their feature vector fills across all
+    // trees of a group, the way the CPU predictor tiles prediction
+    constexpr int kUnroll = 8;
+    // per-thread scratch budget in nodes; trees are processed in groups
+    // no larger than this, so refreshing a huge model no longer allocates
+    // nthread full copies of every tree's statistics
+    constexpr int kMaxGroupNodes = 64 * 1024;
+    // node offset of each tree in the flat statistics array
+    std::vector<int> tree_offset(trees.size() + 1, 0);
+    for (size_t t = 0; t < trees.size(); ++t) {
+      tree_offset[t + 1] = tree_offset[t] + trees[t]->param.num_nodes;
+    }
+    // final statistics of all trees; the allreduce runs over this buffer
+    std::vector<TStats> stats(tree_offset.back(), TStats(param_));
+    // per-thread tile of feature vectors and group-sized scratch
+    std::vector<RegTree::FVec> fvec_temp(nthread * kUnroll);
+    for (auto &feats : fvec_temp) {
+      feats.Init(trees[0]->param.num_feature);
     }
+    std::vector<std::vector<TStats> > stemp(nthread);
     // if it is C++11, use lazy evaluation for Allreduce,
     // to gain speedup in recovery
 #if __cplusplus >= 201103L
@@ -57,49 +59,89 @@ class TreeRefresher: public TreeUpdater {
 #endif
     {
       const MetaInfo &info = p_fmat->Info();
-      // start accumulating statistics
-      for (const auto &batch : p_fmat->GetRowBatches()) {
-        CHECK_LT(batch.Size(), std::numeric_limits<unsigned>::max());
-        const auto nbatch = static_cast<bst_omp_uint>(batch.Size());
-        #pragma omp parallel for schedule(static)
-        for (bst_omp_uint i = 0; i < nbatch; ++i) {
-          SparsePage::Inst inst = batch[i];
+      size_t tbegin = 0;
+      while (tbegin < trees.size()) {
+        // grow the group until the scratch budget is reached; a single
+        // oversized tree still forms a group of its own
+        size_t tend = tbegin + 1;
+        while (tend < trees.size() &&
+               tree_offset[tend + 1] - tree_offset[tbegin] <= kMaxGroupNodes) {
+          ++tend;
+        }
+        const int group_base = tree_offset[tbegin];
+        const int group_nodes = tree_offset[tend] - group_base;
+        #pragma omp parallel num_threads(nthread)
+        {
           const int tid = omp_get_thread_num();
-          const auto ridx = static_cast<bst_uint>(batch.base_rowid + i);
-          RegTree::FVec &feats = fvec_temp[tid];
-          feats.Fill(inst);
-          int offset = 0;
-          for (auto tree : trees) {
-            AddStats(*tree, feats, gpair_h, info, ridx,
-                     dmlc::BeginPtr(stemp[tid]) + offset);
-            offset += tree->param.num_nodes;
+          stemp[tid].resize(group_nodes, TStats(param_));
+          std::fill(stemp[tid].begin(), stemp[tid].end(), TStats(param_));
+        }
+        // accumulate the statistics of this group; external memory pays
+        // one pass over the data per group
+        for (const auto &batch : p_fmat->GetRowBatches()) {
+          CHECK_LT(batch.Size(), std::numeric_limits<unsigned>::max());
+          const auto nbatch = static_cast<bst_omp_uint>(batch.Size());
+          const bst_omp_uint rest = nbatch % kUnroll;
+          #pragma omp parallel for schedule(static)
+          for (bst_omp_uint i = 0; i < nbatch - rest; i += kUnroll) {
+            const int tid = omp_get_thread_num();
+            RegTree::FVec *feats = &fvec_temp[tid * kUnroll];
+            SparsePage::Inst inst[kUnroll];
+            for (int k = 0; k < kUnroll; ++k) {
+              inst[k] = batch[i + k];
+              feats[k].Fill(inst[k]);
+            }
+            // trees outer, rows inner: the upper levels of one tree stay
+            // cached across the whole row tile
+            TStats *gstats = dmlc::BeginPtr(stemp[tid]);
+            for (size_t t = tbegin; t < tend; ++t) {
+              const int offset = tree_offset[t] - group_base;
+              for (int k = 0; k < kUnroll; ++k) {
+                const auto ridx =
+                    static_cast<bst_uint>(batch.base_rowid + i + k);
+                AddStats(*trees[t], feats[k], gpair_h, info, ridx,
+                         gstats + offset);
+              }
+            }
+            for (int k = 0; k < kUnroll; ++k) {
+              feats[k].Drop(inst[k]);
+            }
+          }
+          for (bst_omp_uint i = nbatch - rest; i < nbatch; ++i) {
+            SparsePage::Inst inst = batch[i];
+            const auto ridx = static_cast<bst_uint>(batch.base_rowid + i);
+            RegTree::FVec &feats = fvec_temp[0];
+            feats.Fill(inst);
+            for (size_t t = tbegin; t < tend; ++t) {
+              AddStats(*trees[t], feats, gpair_h, info, ridx,
+                       dmlc::BeginPtr(stemp[0]) + tree_offset[t] - group_base);
+            }
+            feats.Drop(inst);
           }
-          feats.Drop(inst);
         }
-      }
-      // aggregate the statistics
-      auto num_nodes = static_cast<int>(stemp[0].size());
-      #pragma omp parallel for schedule(static)
-      for (int nid = 0; nid < num_nodes; ++nid) {
-        for (int tid = 1; tid < nthread; ++tid) {
-          stemp[0][nid].Add(stemp[tid][nid]);
+        // reduce the thread copies, parallel over node ranges
+        #pragma omp parallel for schedule(static)
+        for (int nid = 0; nid < group_nodes; ++nid) {
+          TStats &sum = stats[group_base + nid];
+          for (int tid = 0; tid < nthread; ++tid) {
+            sum.Add(stemp[tid][nid]);
+          }
         }
+        tbegin = tend;
       }
     };
 #if __cplusplus >= 201103L
-    reducer_.Allreduce(dmlc::BeginPtr(stemp[0]), stemp[0].size(), lazy_get_stats);
+    reducer_.Allreduce(dmlc::BeginPtr(stats), stats.size(), lazy_get_stats);
 #else
-    reducer_.Allreduce(dmlc::BeginPtr(stemp[0]), stemp[0].size());
+    reducer_.Allreduce(dmlc::BeginPtr(stats), stats.size());
 #endif
     // rescale learning rate according to size of trees
     float lr = param_.learning_rate;
     param_.learning_rate = lr / trees.size();
-    int offset = 0;
-    for (auto tree : trees) {
-      for (int rid = 0; rid < tree->param.num_roots; ++rid) {
-        this->Refresh(dmlc::BeginPtr(stemp[0]) + offset, rid, tree);
+    for (size_t t = 0; t < trees.size(); ++t) {
+      for (int rid = 0; rid < trees[t]->param.num_roots; ++rid) {
+        this->Refresh(dmlc::BeginPtr(stats) + tree_offset[t], rid, trees[t]);
       }
-      offset += tree->param.num_nodes;
     }
     // set learning rate back
     param_.learning_rate = lr;
@@ -133,9 +133,18 @@ class SketchMaker: public BaseMaker {
                           DMatrix *p_fmat,
                           const RegTree &tree) {
     const MetaInfo& info = p_fmat->Info();
-    sketchs_.resize(this->qexpand_.size() * tree.param.num_feature * 3);
-    for (auto & sketch : sketchs_) {
-      sketch.Init(info.num_row_, this->param_.sketch_eps);
+    // pool the per (node,feature) sketches across levels: the arrays only
+    // grow, and Init keeps the capacity of each sketch, so the upper
+    // levels reuse the buffers allocated by the widest level instead of
+    // reallocating 3 * nodes * features sketches every depth
+    const size_t nactive = this->qexpand_.size() * tree.param.num_feature * 3;
+    if (sketchs_.size() < nactive) {
+      sketchs_.resize(nactive);
+    }
+    const auto nsketch = static_cast<bst_omp_uint>(nactive);
+    #pragma omp parallel for schedule(static)
+    for (bst_omp_uint i = 0; i < nsketch; ++i) {
+      sketchs_[i].Init(info.num_row_, this->param_.sketch_eps);
     }
     thread_sketch_.resize(omp_get_max_threads());
     // number of rows in
@@ -155,16 +164,22 @@ class SketchMaker: public BaseMaker {
     }
     // setup maximum size
     unsigned max_size = param_.MaxSketchSize();
-    // synchronize sketch
-    summary_array_.resize(sketchs_.size());
-    for (size_t i = 0; i < sketchs_.size(); ++i) {
+    // refine each sketch into its pruned summary in parallel; the
+    // summaries are independent and the containers are pooled like the
+    // sketches above
+    if (summary_array_.size() < nactive) {
+      summary_array_.resize(nactive);
+    }
+    #pragma omp parallel for schedule(static)
+    for (bst_omp_uint i = 0; i < nsketch; ++i) {
       common::WXQuantileSketch<bst_float, bst_float>::SummaryContainer out;
       sketchs_[i].GetSummary(&out);
       summary_array_[i].Reserve(max_size);
       summary_array_[i].SetPrune(out, max_size);
     }
+    // synchronize only this level's summaries as one packed payload
     size_t nbytes = WXQSketch::SummaryContainer::CalcMemCost(max_size);
-    sketch_reducer_.Allreduce(dmlc::BeginPtr(summary_array_), nbytes, summary_array_.size());
+    sketch_reducer_.Allreduce(dmlc::BeginPtr(summary_array_), nbytes, nactive);
   }
   // update sketch information in column fid
   inline void UpdateSketchCol(const std::vector<GradientPair> &gpair,
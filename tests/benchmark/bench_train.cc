@@ -0,0 +1,318 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file bench_train.cc
+ * \brief end-to-end training throughput benchmark. Runs a fixed grid of
+ *  recipes -- tree method x density x in-core/external memory -- over the
+ *  synthetic generator, reports rows/sec, peak RSS and the per-phase
+ *  breakdown collected from Learner::IterationTimingsJson, and emits the
+ *  results as machine readable JSON. Given a baseline file produced by an
+ *  earlier build it fails when throughput regresses past a threshold, so
+ *  cross-version training slowdowns surface before an upgrade reaches
+ *  production.
+ *
+ *  usage: bench_train [rows=N] [cols=N] [rounds=N] [nthread=N]
+ *                     [tmpdir=DIR] [json=FILE] [baseline=FILE]
+ *                     [threshold=F]
+ */
+#include <dmlc/timer.h>
+#include <xgboost/base.h>
+#include <xgboost/data.h>
+#include <xgboost/learner.h>
+
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#endif  // !defined(_WIN32)
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../../src/common/host_device_vector.h"
+#include "./cpp/benchmark_helpers.h"
+
+namespace xgboost {
+namespace bench {
+
+struct Recipe {
+  std::string tree_method;
+  float sparsity;
+  bool external;
+
+  std::string Name() const {
+    return tree_method + (sparsity > 0.0f ? "_sparse" : "_dense") +
+           (external ? "_extmem" : "_incore");
+  }
+};
+
+struct RecipeResult {
+  double train_sec{0.0};
+  double rows_per_sec{0.0};
+  double peak_rss_mb{0.0};
+  std::map<std::string, double> phases;
+};
+
+/*! \brief high-water mark of the resident set, in megabytes */
+double PeakRSSMb() {
+#if defined(_WIN32)
+  return 0.0;
+#elif defined(__APPLE__)
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss / 1024.0;
+#endif
+}
+
+/*!
+ * \brief parse the numeric fields of a flat JSON object such as the one
+ *  IterationTimingsJson returns; nested objects are not needed here
+ */
+std::map<std::string, double> ParseFlatJson(const std::string& json) {
+  std::map<std::string, double> out;
+  size_t pos = 0;
+  while ((pos = json.find('"', pos)) != std::string::npos) {
+    const size_t end = json.find('"', pos + 1);
+    if (end == std::string::npos) break;
+    const std::string key = json.substr(pos + 1, end - pos - 1);
+    const size_t colon = json.find(':', end);
+    if (colon == std::string::npos) break;
+    out[key] = std::strtod(json.c_str() + colon + 1, nullptr);
+    pos = colon + 1;
+  }
+  return out;
+}
+
+/*!
+ * \brief write the same synthetic distribution CreateDMatrix draws to a
+ *  libsvm file, so the external memory recipes train on comparable data
+ */
+void WriteLibSVM(const std::string& path, int rows, int cols, float sparsity,
+                 int seed) {
+  std::ofstream fout(path.c_str());
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+  for (int i = 0; i < rows; ++i) {
+    fout << dis(gen);
+    for (int j = 0; j < cols; ++j) {
+      if (dis(gen) >= sparsity) {
+        fout << ' ' << j << ':' << dis(gen);
+      }
+    }
+    fout << '\n';
+  }
+}
+
+RecipeResult RunRecipe(const Recipe& recipe, int rows, int cols, int rounds,
+                       int nthread, const std::string& tmpdir) {
+  std::shared_ptr<DMatrix> dmat;
+  std::string data_path;
+  if (recipe.external) {
+    data_path = tmpdir + "/bench_train." + recipe.Name() + ".libsvm";
+    WriteLibSVM(data_path, rows, cols, recipe.sparsity, 3);
+    dmat.reset(DMatrix::Load(data_path + "#" + data_path + ".cache",
+                             true, false));
+  } else {
+    dmat = CreateDMatrix(rows, cols, recipe.sparsity, 3);
+    auto& labels = dmat->Info().labels_.HostVector();
+    labels.resize(rows);
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+    for (auto& v : labels) {
+      v = dis(gen);
+    }
+  }
+
+  std::vector<std::shared_ptr<DMatrix> > cache{dmat};
+  std::unique_ptr<Learner> learner(Learner::Create(cache));
+  learner->Configure({{"tree_method", recipe.tree_method},
+                      {"max_depth", "6"},
+                      {"nthread", std::to_string(nthread)}});
+  learner->InitModel();
+
+  RecipeResult res;
+  const double tstart = dmlc::GetTime();
+  for (int iter = 0; iter < rounds; ++iter) {
+    learner->UpdateOneIter(iter, dmat.get());
+    for (const auto& kv : ParseFlatJson(learner->IterationTimingsJson())) {
+      if (kv.first != "iter") {
+        res.phases[kv.first] += kv.second;
+      }
+    }
+  }
+  res.train_sec = dmlc::GetTime() - tstart;
+  res.rows_per_sec =
+      static_cast<double>(rows) * rounds / std::max(res.train_sec, 1e-9);
+  res.peak_rss_mb = PeakRSSMb();
+
+  if (recipe.external) {
+    // the page cache of one recipe is useless to the next
+    std::remove(data_path.c_str());
+    for (const char* suffix : {".cache", ".cache.row.page",
+                               ".cache.col.page", ".cache.sorted.col.page"}) {
+      std::remove((data_path + suffix).c_str());
+    }
+  }
+  return res;
+}
+
+std::vector<Recipe> MakeRecipes() {
+  std::vector<Recipe> recipes;
+  for (const char* method : {"hist", "exact", "approx"}) {
+    for (float sparsity : {0.0f, 0.8f}) {
+      recipes.push_back(Recipe{method, sparsity, false});
+      // the exact method needs single-block column access and would
+      // silently fall back to approx on an external memory matrix
+      if (std::string(method) != "exact") {
+        recipes.push_back(Recipe{method, sparsity, true});
+      }
+    }
+  }
+  return recipes;
+}
+
+/*! \brief read name -> rows_per_sec pairs back out of an emitted report */
+std::map<std::string, double> LoadBaseline(const std::string& path) {
+  std::ifstream fin(path.c_str());
+  if (!fin) {
+    std::fprintf(stderr, "bench_train: cannot open baseline %s\n",
+                 path.c_str());
+    std::exit(2);
+  }
+  const std::string all((std::istreambuf_iterator<char>(fin)),
+                        std::istreambuf_iterator<char>());
+  std::map<std::string, double> out;
+  size_t pos = 0;
+  while ((pos = all.find("\"name\":\"", pos)) != std::string::npos) {
+    const size_t beg = pos + 8;
+    const size_t end = all.find('"', beg);
+    if (end == std::string::npos) break;
+    const std::string name = all.substr(beg, end - beg);
+    const size_t rp = all.find("\"rows_per_sec\":", end);
+    if (rp == std::string::npos) break;
+    out[name] = std::strtod(all.c_str() + rp + 15, nullptr);
+    pos = rp;
+  }
+  return out;
+}
+
+}  // namespace bench
+}  // namespace xgboost
+
+int main(int argc, char* argv[]) {
+  using xgboost::bench::Recipe;
+  using xgboost::bench::RecipeResult;
+
+  int rows = 200000;
+  int cols = 50;
+  int rounds = 20;
+  int nthread = 0;
+  std::string tmpdir = ".";
+  std::string json_path;
+  std::string baseline_path;
+  double threshold = 0.95;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const size_t eq = arg.find('=');
+    if (eq == std::string::npos) {
+      std::fprintf(stderr, "bench_train: malformed argument %s\n",
+                   arg.c_str());
+      return 2;
+    }
+    const std::string key = arg.substr(0, eq);
+    const std::string value = arg.substr(eq + 1);
+    if (key == "rows") {
+      rows = std::atoi(value.c_str());
+    } else if (key == "cols") {
+      cols = std::atoi(value.c_str());
+    } else if (key == "rounds") {
+      rounds = std::atoi(value.c_str());
+    } else if (key == "nthread") {
+      nthread = std::atoi(value.c_str());
+    } else if (key == "tmpdir") {
+      tmpdir = value;
+    } else if (key == "json") {
+      json_path = value;
+    } else if (key == "baseline") {
+      baseline_path = value;
+    } else if (key == "threshold") {
+      threshold = std::atof(value.c_str());
+    } else {
+      std::fprintf(stderr, "bench_train: unknown argument %s\n", key.c_str());
+      return 2;
+    }
+  }
+
+  std::map<std::string, double> baseline;
+  if (!baseline_path.empty()) {
+    baseline = xgboost::bench::LoadBaseline(baseline_path);
+  }
+
+  std::ostringstream os;
+  os << "{\"rows\":" << rows << ",\"cols\":" << cols
+     << ",\"rounds\":" << rounds << ",\"recipes\":[";
+  std::vector<std::string> regressions;
+  bool first = true;
+  for (const Recipe& recipe : xgboost::bench::MakeRecipes()) {
+    const std::string name = recipe.Name();
+    std::fprintf(stderr, "bench_train: running %s\n", name.c_str());
+    const RecipeResult res = xgboost::bench::RunRecipe(
+        recipe, rows, cols, rounds, nthread, tmpdir);
+    std::fprintf(stderr,
+                 "bench_train: %s %.0f rows/sec, %.2f sec, %.0f MB peak\n",
+                 name.c_str(), res.rows_per_sec, res.train_sec,
+                 res.peak_rss_mb);
+
+    if (!first) os << ',';
+    first = false;
+    os << "{\"name\":\"" << name << "\""
+       << ",\"tree_method\":\"" << recipe.tree_method << "\""
+       << ",\"sparsity\":" << recipe.sparsity
+       << ",\"external_memory\":" << (recipe.external ? "true" : "false")
+       << ",\"train_sec\":" << res.train_sec
+       << ",\"rows_per_sec\":" << res.rows_per_sec
+       << ",\"peak_rss_mb\":" << res.peak_rss_mb
+       << ",\"phases\":{";
+    bool first_phase = true;
+    for (const auto& kv : res.phases) {
+      if (!first_phase) os << ',';
+      first_phase = false;
+      os << '"' << kv.first << "\":" << kv.second;
+    }
+    os << "}}";
+
+    auto it = baseline.find(name);
+    if (it != baseline.end() && res.rows_per_sec < it->second * threshold) {
+      std::ostringstream msg;
+      msg << name << ": " << res.rows_per_sec << " rows/sec vs baseline "
+          << it->second << " (threshold " << threshold << ")";
+      regressions.push_back(msg.str());
+    }
+  }
+  os << "]}";
+
+  if (json_path.empty()) {
+    std::printf("%s\n", os.str().c_str());
+  } else {
+    std::ofstream fout(json_path.c_str());
+    fout << os.str() << '\n';
+  }
+
+  if (!regressions.empty()) {
+    for (const std::string& msg : regressions) {
+      std::fprintf(stderr, "bench_train: REGRESSION %s\n", msg.c_str());
+    }
+    return 1;
+  }
+  return 0;
+}
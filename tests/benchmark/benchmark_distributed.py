@@ -0,0 +1,120 @@
+# pylint: skip-file
+"""Distributed scaling benchmark.
+
+Launches a distributed training workload on N local workers and reports
+per-phase timings -- local compute vs. time lost waiting for the
+allreduce stragglers -- so changes to the rabit paths (fused buffers,
+histogram compression, sketch allreduce) have a measurable baseline.
+
+Run through the dmlc tracker, e.g. from this directory:
+
+    PYTHONPATH=../../python-package/ \
+        python ../../dmlc-core/tracker/dmlc-submit --cluster=local \
+        --num-workers=4 python benchmark_distributed.py --rows 100000
+
+or use benchmark_distributed.sh. Every worker generates its own shard
+of synthetic data, so no input files are needed.
+"""
+import argparse
+import ctypes
+import json
+import time
+
+import numpy as np
+import xgboost as xgb
+from xgboost.core import _LIB, _check_call
+
+# rabit reduction operators (engine::mpi::OpType)
+OP_MAX = 0
+OP_SUM = 2
+
+
+def iteration_timings(bst):
+    """Per-phase wall times of the last iteration, as reported by the booster."""
+    ret = ctypes.c_char_p()
+    _check_call(_LIB.XGBoosterIterationTimings(bst.handle, ctypes.byref(ret)))
+    return json.loads(ret.value.decode())
+
+
+def run_benchmark(args):
+    xgb.rabit.init()
+    rank = xgb.rabit.get_rank()
+    nworker = xgb.rabit.get_world_size()
+
+    # each worker draws a disjoint deterministic shard
+    uri = 'synthetic://%d,%d,sparsity=%g,seed=%d' % (
+        args.rows, args.columns, args.sparsity, 7 + rank)
+    dtrain = xgb.DMatrix(uri)
+
+    param = {
+        'tree_method': args.tree_method,
+        'max_depth': args.max_depth,
+        'max_bin': args.max_bin,
+        'eta': 0.1,
+        'silent': 1,
+        'objective': 'reg:linear',
+    }
+    bst = xgb.Booster(param, [dtrain])
+
+    phase_sums = {}
+    round_wall = 0.0
+    straggler_wait = 0.0
+    for i in range(args.rounds):
+        tstart = time.time()
+        bst.update(dtrain, i)
+        local_elapsed = time.time() - tstart
+        # a no-op allreduce right after the round returns once the slowest
+        # worker arrives; its duration is the time this worker would have
+        # spent waiting anyway, i.e. the load-imbalance share of the round
+        twait = time.time()
+        xgb.rabit.allreduce(np.zeros(1, dtype=np.float32), OP_MAX)
+        straggler_wait += time.time() - twait
+        round_wall += local_elapsed
+        for phase, sec in iteration_timings(bst).items():
+            if phase == 'iter':
+                continue
+            phase_sums[phase] = phase_sums.get(phase, 0.0) + sec
+
+    # aggregate across workers: mean shows the typical cost of a phase,
+    # max shows the straggler that the allreduce waits for
+    phases = sorted(phase_sums.keys())
+    local = np.array([round_wall, straggler_wait] +
+                     [phase_sums[p] for p in phases], dtype=np.float64)
+    mean = xgb.rabit.allreduce(local.copy(), OP_SUM) / nworker
+    peak = xgb.rabit.allreduce(local.copy(), OP_MAX)
+
+    if rank == 0:
+        lines = []
+        lines.append('workers=%d rows/worker=%d cols=%d rounds=%d '
+                     'tree_method=%s max_bin=%d' %
+                     (nworker, args.rows, args.columns, args.rounds,
+                      args.tree_method, args.max_bin))
+        lines.append('%-16s %10s %10s' % ('phase', 'mean(s)', 'max(s)'))
+        lines.append('%-16s %10.4f %10.4f' % ('round total', mean[0], peak[0]))
+        lines.append('%-16s %10.4f %10.4f' %
+                     ('straggler wait', mean[1], peak[1]))
+        for j, p in enumerate(phases):
+            lines.append('%-16s %10.4f %10.4f' % (p, mean[2 + j], peak[2 + j]))
+        xgb.rabit.tracker_print('\n'.join(lines) + '\n')
+
+    xgb.rabit.finalize()
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='distributed scaling benchmark')
+    parser.add_argument('--rows', type=int, default=100000,
+                        help='rows of synthetic data per worker')
+    parser.add_argument('--columns', type=int, default=50)
+    parser.add_argument('--sparsity', type=float, default=0.0)
+    parser.add_argument('--rounds', type=int, default=20)
+    parser.add_argument('--max-depth', type=int, default=6)
+    parser.add_argument('--max-bin', type=int, default=256)
+    parser.add_argument('--tree-method', type=str, default='approx',
+                        help='approx exercises the distributed HistMaker;'
+                             ' hist exercises the quantile hist updater')
+    run_benchmark(parser.parse_args())
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,13 @@
+#!/bin/bash
+# Distributed scaling benchmark on local workers.
+#
+#   ./benchmark_distributed.sh [num-workers] [benchmark_distributed.py args...]
+#
+# e.g. ./benchmark_distributed.sh 8 --rows 500000 --tree-method approx
+
+NWORKERS=${1:-4}
+if [ $# -gt 0 ]; then shift; fi
+
+PYTHONPATH=../../python-package/ python ../../dmlc-core/tracker/dmlc-submit \
+  --cluster=local --num-workers=${NWORKERS} \
+  python benchmark_distributed.py "$@"
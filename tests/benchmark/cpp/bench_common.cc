@@ -0,0 +1,80 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \brief microbenchmarks of common building blocks: bit-packed symbol
+ *  decoding and quantile summary merging.
+ */
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "../../../src/common/compressed_iterator.h"
+#include "../../../src/common/quantile.h"
+
+namespace xgboost {
+namespace common {
+namespace {
+
+// args: number of elements, alphabet size (controls bits per symbol)
+void BM_CompressedIteratorDecode(benchmark::State& state) {  // NOLINT
+  const size_t n = static_cast<size_t>(state.range(0));
+  const size_t num_symbols = static_cast<size_t>(state.range(1));
+
+  std::vector<CompressedByteT> buffer(
+      CompressedBufferWriter::CalculateBufferSize(n, num_symbols));
+  CompressedBufferWriter writer(num_symbols);
+  for (size_t i = 0; i < n; ++i) {
+    writer.WriteSymbol(buffer.data(),
+                       static_cast<uint32_t>(i % num_symbols), i);
+  }
+
+  CompressedIterator<uint32_t> it(buffer.data(),
+                                  static_cast<int>(num_symbols));
+  std::vector<uint32_t> decoded(n);
+  for (auto _ : state) {
+    it.Decode(decoded.data(), 0, n);
+    benchmark::DoNotOptimize(decoded.data());
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+// args: entries per input summary
+void BM_WQSummarySetCombine(benchmark::State& state) {  // NOLINT
+  using Summary = WQSummary<bst_float, bst_float>;
+  const size_t n = static_cast<size_t>(state.range(0));
+
+  // interleaved, strictly increasing values with unit weights
+  std::vector<Summary::Entry> entries_a(n), entries_b(n);
+  for (size_t i = 0; i < n; ++i) {
+    const bst_float rank = static_cast<bst_float>(i);
+    entries_a[i] = Summary::Entry(rank, rank + 1.0f, 1.0f,
+                                  static_cast<bst_float>(2 * i));
+    entries_b[i] = Summary::Entry(rank, rank + 1.0f, 1.0f,
+                                  static_cast<bst_float>(2 * i + 1));
+  }
+  Summary sa(entries_a.data(), n);
+  Summary sb(entries_b.data(), n);
+  std::vector<Summary::Entry> out_space(2 * n);
+  Summary out(out_space.data(), 0);
+  for (auto _ : state) {
+    out.SetCombine(sa, sb);
+    benchmark::DoNotOptimize(out.size);
+  }
+  state.SetItemsProcessed(state.iterations() * 2 * n);
+}
+
+}  // namespace
+
+BENCHMARK(BM_CompressedIteratorDecode)
+    ->Args({1 << 20, 256})
+    ->Args({1 << 20, 1 << 16})
+    ->Args({1 << 24, 256})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_WQSummarySetCombine)
+    ->Arg(1 << 10)
+    ->Arg(1 << 14)
+    ->Arg(1 << 18)
+    ->Unit(benchmark::kMicrosecond);
+
+}  // namespace common
+}  // namespace xgboost
@@ -0,0 +1,62 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \brief microbenchmark of batch prediction on the CPU predictor,
+ *  covering the blocked prediction loop over the frozen tree layout.
+ */
+#include <benchmark/benchmark.h>
+#include <xgboost/predictor.h>
+
+#include <memory>
+#include <vector>
+
+#include "../../../src/gbm/gbtree_model.h"
+#include "./benchmark_helpers.h"
+
+namespace xgboost {
+namespace {
+
+// args: rows, cols, trees
+void BM_PredictBatch(benchmark::State& state) {  // NOLINT
+  const int rows = static_cast<int>(state.range(0));
+  const int cols = static_cast<int>(state.range(1));
+  const int n_trees = static_cast<int>(state.range(2));
+
+  auto dmat = bench::CreateDMatrix(rows, cols, 0.0f, 3);
+
+  std::vector<std::unique_ptr<RegTree> > trees;
+  for (int i = 0; i < n_trees; ++i) {
+    trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+    RegTree& tree = *trees.back();
+    // two levels of real splits so the walk exercises the node layout
+    tree.ExpandNode(0, i % cols, 0.5f, i % 2 == 0);
+    tree.ExpandNode(1, (i + 1) % cols, 0.25f, true);
+    tree[2].SetLeaf(-0.5f);
+    tree[3].SetLeaf(1.5f);
+    tree[4].SetLeaf(0.5f);
+  }
+  gbm::GBTreeModel model(0.5);
+  model.param.num_feature = cols;
+  model.param.num_output_group = 1;
+  model.base_margin = 0.0f;
+  model.CommitModel(std::move(trees), 0);
+
+  std::unique_ptr<Predictor> predictor(Predictor::Create("cpu_predictor"));
+  // no cache matrices registered, so every iteration runs the full loop
+  HostDeviceVector<bst_float> out_preds;
+  for (auto _ : state) {
+    predictor->PredictBatch(dmat.get(), &out_preds, model, 0);
+    benchmark::DoNotOptimize(out_preds.HostVector().data());
+  }
+  state.SetItemsProcessed(state.iterations() * rows * n_trees);
+}
+
+}  // namespace
+
+BENCHMARK(BM_PredictBatch)
+    ->Args({10000, 50, 100})
+    ->Args({100000, 50, 100})
+    ->Args({100000, 50, 500})
+    ->Args({1000000, 20, 100})
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace xgboost
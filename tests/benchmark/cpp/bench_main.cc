@@ -0,0 +1,6 @@
+/*!
+ * Copyright 2018 by Contributors
+ */
+#include <benchmark/benchmark.h>
+
+BENCHMARK_MAIN();
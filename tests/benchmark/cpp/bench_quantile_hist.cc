@@ -0,0 +1,133 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \brief microbenchmarks of the hot paths of the 'hist' tree method:
+ *  histogram accumulation and split enumeration over the quantized
+ *  matrix, across row count, feature count, density and bin budget.
+ */
+#include <benchmark/benchmark.h>
+#include <xgboost/tree_updater.h>
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../../../src/common/hist_util.h"
+#include "../../../src/tree/param.h"
+#include "../../../src/tree/updater_quantile_hist.h"
+#include "./benchmark_helpers.h"
+
+namespace xgboost {
+namespace tree {
+
+// reaches the protected builder internals the same way the unit tests do
+class QuantileHistBench : public QuantileHistMaker {
+ public:
+  struct BuilderBench : public QuantileHistMaker::Builder {
+    using RealImpl = QuantileHistMaker::Builder;
+
+    BuilderBench(const TrainParam& param,
+                 std::unique_ptr<TreeUpdater> pruner,
+                 std::unique_ptr<SplitEvaluator> spliteval)
+        : RealImpl(param, std::move(pruner), std::move(spliteval)) {}
+
+    void BenchBuildHist(benchmark::State* state,
+                        const GHistIndexMatrix& gmat,
+                        const std::vector<GradientPair>& gpair,
+                        const DMatrix& fmat, const RegTree& tree) {
+      RealImpl::InitData(gmat, gpair, fmat, tree);
+      hist_.AddHistRow(0);
+      GHistIndexBlockMatrix no_blocks;
+      for (auto _ : *state) {
+        BuildHist(gpair, row_set_collection_[0], gmat, no_blocks, hist_[0]);
+      }
+      state->SetItemsProcessed(state->iterations() * fmat.Info().num_row_);
+    }
+
+    void BenchEvaluateSplit(benchmark::State* state,
+                            const GHistIndexMatrix& gmat,
+                            const std::vector<GradientPair>& gpair,
+                            const DMatrix& fmat, const RegTree& tree) {
+      RealImpl::InitData(gmat, gpair, fmat, tree);
+      hist_.AddHistRow(0);
+      GHistIndexBlockMatrix no_blocks;
+      BuildHist(gpair, row_set_collection_[0], gmat, no_blocks, hist_[0]);
+      RealImpl::InitNewNode(0, gmat, gpair, fmat, tree);
+      for (auto _ : *state) {
+        RealImpl::EvaluateSplit(0, gmat, hist_, fmat, tree);
+        benchmark::DoNotOptimize(snode_[0].best);
+      }
+      state->SetItemsProcessed(state->iterations() * fmat.Info().num_col_);
+    }
+  };
+
+  explicit QuantileHistBench(
+      const std::vector<std::pair<std::string, std::string> >& args) {
+    QuantileHistMaker::Init(args);
+    builder_.reset(
+        new BuilderBench(
+            param_,
+            std::move(pruner_),
+            std::unique_ptr<SplitEvaluator>(spliteval_->GetHostClone())));
+  }
+
+  BuilderBench* GetBuilder() { return builder_.get(); }
+
+ private:
+  std::shared_ptr<BuilderBench> builder_;
+};
+
+namespace {
+
+// args: rows, cols, sparsity percent, max_bin
+void RunHistBench(benchmark::State* state, bool evaluate_split) {
+  const int rows = static_cast<int>(state->range(0));
+  const int cols = static_cast<int>(state->range(1));
+  const float sparsity = state->range(2) / 100.0f;
+  const int max_bin = static_cast<int>(state->range(3));
+
+  auto dmat = bench::CreateDMatrix(rows, cols, sparsity, 3);
+  common::GHistIndexMatrix gmat;
+  gmat.Init(dmat.get(), max_bin);
+  const std::vector<GradientPair> gpair = bench::GenerateGradients(rows, 3);
+
+  std::vector<std::pair<std::string, std::string> > cfg
+      {{"num_feature", std::to_string(cols)},
+       {"max_bin", std::to_string(max_bin)},
+       {"enable_feature_grouping", std::to_string(0)}};
+  RegTree tree;
+  tree.param.InitAllowUnknown(cfg);
+  QuantileHistBench maker(cfg);
+  if (evaluate_split) {
+    maker.GetBuilder()->BenchEvaluateSplit(state, gmat, gpair, *dmat, tree);
+  } else {
+    maker.GetBuilder()->BenchBuildHist(state, gmat, gpair, *dmat, tree);
+  }
+}
+
+void BM_BuildHist(benchmark::State& state) {  // NOLINT
+  RunHistBench(&state, false);
+}
+
+void BM_EvaluateSplit(benchmark::State& state) {  // NOLINT
+  RunHistBench(&state, true);
+}
+
+}  // namespace
+
+BENCHMARK(BM_BuildHist)
+    ->Args({10000, 50, 0, 256})
+    ->Args({100000, 50, 0, 256})
+    ->Args({100000, 50, 80, 256})
+    ->Args({100000, 200, 0, 64})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_EvaluateSplit)
+    ->Args({10000, 50, 0, 256})
+    ->Args({10000, 200, 0, 256})
+    ->Args({10000, 200, 80, 256})
+    ->Args({10000, 1000, 0, 64})
+    ->Unit(benchmark::kMicrosecond);
+
+}  // namespace tree
+}  // namespace xgboost
@@ -0,0 +1,59 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file benchmark_helpers.h
+ * \brief synthetic data generators shared by the microbenchmarks.
+ *  Mirrors the generators of tests/cpp/helpers.cc without pulling in
+ *  gtest, which the benchmark binary does not link.
+ */
+#ifndef XGBOOST_TESTS_BENCHMARK_CPP_BENCHMARK_HELPERS_H_
+#define XGBOOST_TESTS_BENCHMARK_CPP_BENCHMARK_HELPERS_H_
+
+#include <xgboost/base.h>
+#include <xgboost/c_api.h>
+#include <xgboost/data.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace xgboost {
+namespace bench {
+
+/*!
+ * \brief create a dmatrix with uniform random data in [0, 1).
+ * \param rows      number of rows
+ * \param columns   number of columns
+ * \param sparsity  fraction of entries that are missing
+ * \param seed      generator seed
+ */
+inline std::shared_ptr<DMatrix> CreateDMatrix(int rows, int columns,
+                                              float sparsity, int seed = 0) {
+  const float missing_value = -1;
+  std::vector<float> data(static_cast<size_t>(rows) * columns);
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+  for (auto& e : data) {
+    e = dis(gen) < sparsity ? missing_value : dis(gen);
+  }
+  DMatrixHandle handle;
+  XGDMatrixCreateFromMat(data.data(), rows, columns, missing_value, &handle);
+  std::shared_ptr<DMatrix> out =
+      *static_cast<std::shared_ptr<DMatrix>*>(handle);
+  XGDMatrixFree(handle);
+  return out;
+}
+
+/*! \brief random gradient pairs with strictly positive hessians */
+inline std::vector<GradientPair> GenerateGradients(int rows, int seed = 0) {
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+  std::vector<GradientPair> gpair(rows);
+  for (auto& g : gpair) {
+    g = GradientPair(dis(gen) - 0.5f, dis(gen) + 0.1f);
+  }
+  return gpair;
+}
+
+}  // namespace bench
+}  // namespace xgboost
+#endif  // XGBOOST_TESTS_BENCHMARK_CPP_BENCHMARK_HELPERS_H_
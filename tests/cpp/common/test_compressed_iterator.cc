@@ -51,5 +51,38 @@ TEST(CompressedIterator, Test) {
   }
 }
 
+TEST(CompressedIterator, BulkDecodeAndWriteBatch) {
+  std::vector<int> test_cases = {3, 426, 256, 100000};
+  int num_elements = 1000;
+  srand(7);
+
+  for (auto alphabet_size : test_cases) {
+    std::vector<int> input(num_elements);
+    std::generate(input.begin(), input.end(),
+      [=]() { return rand() % alphabet_size; });
+    CompressedBufferWriter cbw(alphabet_size);
+
+    // Write the array in batches at arbitrary symbol offsets
+    std::vector<unsigned char> buffer(
+      CompressedBufferWriter::CalculateBufferSize(input.size(),
+        alphabet_size));
+    size_t split = 337;
+    cbw.WriteBatch(buffer.data(), input.begin(), input.begin() + split, 0);
+    cbw.WriteBatch(buffer.data(), input.begin() + split, input.end(), split);
+
+    CompressedIterator<int> ci(buffer.data(), alphabet_size);
+    std::vector<int> output(input.size());
+    ci.Decode(output.data(), 0, output.size());
+    ASSERT_TRUE(input == output);
+
+    // Decode a sub-range not aligned to byte boundaries
+    std::vector<int> sub(101);
+    ci.Decode(sub.data(), 499, sub.size());
+    for (size_t i = 0; i < sub.size(); i++) {
+      ASSERT_EQ(sub[i], input[499 + i]);
+    }
+  }
+}
+
 }  // namespace common
 }  // namespace xgboost
@@ -0,0 +1,42 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "../../../src/common/group_data.h"
+
+namespace xgboost {
+namespace common {
+TEST(ParallelGroupBuilder, TwoThreadMerge) {
+  // thread 0 contributes keys {0, 2, 2}, thread 1 contributes {1, 2, 0}
+  std::vector<size_t> rptr;
+  std::vector<int> data;
+  ParallelGroupBuilder<int> builder(&rptr, &data);
+  builder.InitBudget(0, 2);
+  builder.AddBudget(0, 0);
+  builder.AddBudget(2, 0);
+  builder.AddBudget(2, 0);
+  builder.AddBudget(1, 1);
+  builder.AddBudget(2, 1);
+  builder.AddBudget(0, 1);
+  builder.InitStorage();
+
+  ASSERT_EQ(rptr.size(), 4U);
+  EXPECT_EQ(rptr[0], 0U);
+  EXPECT_EQ(rptr[1], 2U);
+  EXPECT_EQ(rptr[2], 3U);
+  EXPECT_EQ(rptr[3], 6U);
+
+  builder.Push(0, 10, 0);
+  builder.Push(2, 20, 0);
+  builder.Push(2, 21, 0);
+  builder.Push(1, 30, 1);
+  builder.Push(2, 31, 1);
+  builder.Push(0, 32, 1);
+  // within each key, thread 0's entries precede thread 1's
+  EXPECT_EQ(data[0], 10);
+  EXPECT_EQ(data[1], 32);
+  EXPECT_EQ(data[2], 30);
+  EXPECT_EQ(data[3], 20);
+  EXPECT_EQ(data[4], 21);
+  EXPECT_EQ(data[5], 31);
+}
+}  // namespace common
+}  // namespace xgboost
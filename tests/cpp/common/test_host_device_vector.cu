@@ -4,6 +4,7 @@
 
 #include <gtest/gtest.h>
 #include <thrust/equal.h>
+#include <thrust/host_vector.h>
 #include <thrust/iterator/counting_iterator.h>
 
 #include "../../../src/common/device_helpers.cuh"
@@ -210,6 +211,51 @@ TEST(HostDeviceVector, Span) {
   ASSERT_EQ(vec.ConstDevicePointer(0), span.data());
 }
 
+TEST(HostDeviceVector, HostSpan) {
+  size_t n = 1001;
+  int n_devices = 2;
+  auto distribution = GPUDistribution::Block(GPUSet::Range(0, n_devices));
+  std::vector<size_t> starts{0, 501};
+  SetCudaSetDeviceHandler(SetDevice);
+  HostDeviceVector<int> v;
+  InitHostDeviceVector(n, distribution, &v);
+  PlusOne(&v);  // sync the data to the devices
+  // modify a sub-range on the host; only it should be re-uploaded
+  auto span = v.HostSpan(100, 200);
+  ASSERT_EQ(span.size(), 100);
+  ASSERT_TRUE(v.HostCanAccess(GPUAccess::kWrite));
+  std::fill(span.begin(), span.end(), -1);
+  for (int i = 0; i < n_devices; ++i) {
+    SetDevice(i);
+    thrust::host_vector<int> data_d(v.tcbegin(i), v.tcend(i));
+    for (size_t j = 0; j < data_d.size(); ++j) {
+      size_t idx = starts[i] + j;
+      int expected = idx >= 100 && idx < 200 ? -1 : static_cast<int>(idx) + 1;
+      ASSERT_EQ(data_d[j], expected);
+    }
+  }
+  SetCudaSetDeviceHandler(nullptr);
+}
+
+TEST(HostDeviceVector, CopyStrided) {
+  size_t n = 501, stride = 3, offset = 1;
+  auto distribution = GPUDistribution::Block(GPUSet::Range(0, 1));
+  SetCudaSetDeviceHandler(SetDevice);
+  HostDeviceVector<int> v;
+  InitHostDeviceVector(n * stride, distribution, &v);
+  PlusOne(&v);  // sync the data to the device
+  HostDeviceVector<int> tmp(n, 0, distribution);
+  tmp.CopyStrided(v, stride, offset);
+  // the gather should run on the device without granting host access
+  ASSERT_FALSE(tmp.HostCanAccess(GPUAccess::kRead));
+  ASSERT_FALSE(v.HostCanAccess(GPUAccess::kRead));
+  const std::vector<int>& data_h = tmp.ConstHostVector();
+  for (size_t i = 0; i < n; ++i) {
+    ASSERT_EQ(data_h.at(i), static_cast<int>(i * stride + offset) + 1);
+  }
+  SetCudaSetDeviceHandler(nullptr);
+}
+
 // Multi-GPUs' test
 #if defined(XGBOOST_USE_NCCL)
 TEST(HostDeviceVector, MGPU_Reshard) {
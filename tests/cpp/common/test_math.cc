@@ -0,0 +1,31 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
+#include "../../../src/common/math.h"
+
+namespace xgboost {
+namespace common {
+TEST(Math, ExpFast) {
+  for (float x = -80.0f; x <= 80.0f; x += 0.37f) {
+    const float ref = std::exp(x);
+    ASSERT_NEAR(ExpFast(x), ref, 1e-6f * ref) << "x = " << x;
+  }
+  // out-of-range inputs clamp instead of producing inf/zero surprises
+  ASSERT_GT(ExpFast(-1000.0f), 0.0f);
+  ASSERT_TRUE(std::isfinite(ExpFast(1000.0f)));
+}
+
+TEST(Math, SoftmaxFast) {
+  std::vector<bst_float> fast = {1.0f, 0.5f, -2.0f, 3.5f, 0.0f};
+  std::vector<bst_float> ref = fast;
+  SoftmaxFast(fast.data(), fast.data() + fast.size());
+  Softmax(ref.begin(), ref.end());
+  bst_float sum = 0.0f;
+  for (size_t i = 0; i < fast.size(); ++i) {
+    ASSERT_NEAR(fast[i], ref[i], 1e-6f);
+    sum += fast[i];
+  }
+  ASSERT_NEAR(sum, 1.0f, 1e-6f);
+}
+}  // namespace common
+}  // namespace xgboost
@@ -0,0 +1,45 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "../../../src/common/memory_stats.h"
+
+namespace xgboost {
+namespace common {
+TEST(MemoryStats, CurrentAndPeak) {
+  auto* comp = MemoryStats::Get()->GetComponent("TestComponent");
+  // the registry returns the same component for the same name
+  ASSERT_EQ(comp, MemoryStats::Get()->GetComponent("TestComponent"));
+  const int64_t base_current = comp->Current();
+
+  comp->Add(1024);
+  comp->Add(512);
+  ASSERT_EQ(comp->Current(), base_current + 1536);
+  ASSERT_GE(comp->Peak(), base_current + 1536);
+  const int64_t peak = comp->Peak();
+  comp->Sub(1536);
+  // releases lower current but never the watermark
+  ASSERT_EQ(comp->Current(), base_current);
+  ASSERT_EQ(comp->Peak(), peak);
+
+  AccountedBytes tracked("TestComponent");
+  tracked.Update(256);
+  ASSERT_EQ(comp->Current(), base_current + 256);
+  tracked.Update(64);
+  ASSERT_EQ(comp->Current(), base_current + 64);
+
+  const std::string json = MemoryStats::Get()->DumpJson();
+  ASSERT_NE(json.find("\"component\":\"TestComponent\""), std::string::npos);
+  ASSERT_NE(json.find("\"peak_bytes\""), std::string::npos);
+}
+
+TEST(MemoryStats, AccountedBytesRelease) {
+  auto* comp = MemoryStats::Get()->GetComponent("TestRelease");
+  {
+    AccountedBytes tracked("TestRelease");
+    tracked.Update(4096);
+    ASSERT_EQ(comp->Current(), 4096);
+  }
+  // destruction gives back whatever was still accounted
+  ASSERT_EQ(comp->Current(), 0);
+}
+}  // namespace common
+}  // namespace xgboost
@@ -29,5 +29,23 @@ TEST(Monitor, Logging) {
   output = testing::internal::GetCapturedStderr();
   ASSERT_EQ(output.size(), 0);
 }
+
+TEST(Profiler, Dump) {
+  auto* prof = Profiler::Get();
+  prof->Enter("scope_a");
+  prof->Enter("scope_b");
+  prof->Leave();
+  prof->Leave();
+  prof->Leave();  // unmatched; must be ignored
+  const std::string json = prof->DumpJson();
+  ASSERT_NE(json.find("\"profile\""), std::string::npos);
+  ASSERT_NE(json.find("\"name\":\"root\""), std::string::npos);
+  // scopes are recorded only when XGBOOST_PROFILE=1 was set at load time
+  if (Profiler::Enabled()) {
+    ASSERT_NE(json.find("scope_a"), std::string::npos);
+    ASSERT_NE(json.find("scope_b"), std::string::npos);
+  }
+  prof->Reset();
+}
 }  // namespace common
 }  // namespace xgboost
@@ -45,5 +45,38 @@ TEST(ColumnSampler, Test) {
   ASSERT_EQ(cs.GetFeatureSet(0)->size(), 1);
 
 }
+
+TEST(ColumnSampler, WeightedTest) {
+  int n = 16;
+  ColumnSampler cs;
+
+  // a zero-weight feature must never be drawn; the rest stay reachable
+  std::vector<bst_float> weights(n, 1.0f);
+  weights[3] = 0.0f;
+  cs.Init(n, 0.5f, 1.0f, 1.0f, false, &weights);
+  for (int trial = 0; trial < 32; ++trial) {
+    auto set = *cs.GetFeatureSet(0);
+    ASSERT_EQ(set.size(), 8);
+    for (size_t i = 0; i < set.size(); ++i) {
+      ASSERT_NE(set[i], 3);
+      ASSERT_GE(set[i], 0);
+      ASSERT_LT(set[i], n);
+      if (i > 0) {
+        ASSERT_LT(set[i - 1], set[i]);  // sorted and distinct
+      }
+    }
+  }
+
+  // heavily skewed weights should make the hot feature (near) permanent
+  std::vector<bst_float> skewed(n, 1e-3f);
+  skewed[7] = 1.0f;
+  cs.Init(n, 0.25f, 1.0f, 1.0f, false, &skewed);
+  int hits = 0;
+  for (int trial = 0; trial < 32; ++trial) {
+    auto set = *cs.GetFeatureSet(0);
+    hits += std::count(set.begin(), set.end(), 7);
+  }
+  ASSERT_GT(hits, 16);
+}
 }  // namespace common
 }  // namespace xgboost
@@ -59,5 +59,26 @@ TEST(Transform, DeclareUnifiedTest(Basic)) {
   ASSERT_TRUE(std::equal(h_sol.begin(), h_sol.end(), res.begin()));
 }
 
+// a size that is not a multiple of the CPU block size, covering the
+// partial tail block of the blocked host path
+TEST(Transform, DeclareUnifiedTest(BlockedTail)) {
+  const size_t size {kCPUBlockSize * 2 + 355};
+  std::vector<bst_float> h_in(size);
+  InitializeRange(h_in.begin(), h_in.end());
+
+  const HostDeviceVector<bst_float> in_vec{h_in, TRANSFORM_GPU_DIST};
+  HostDeviceVector<bst_float> out_vec{std::vector<bst_float>(size),
+                                      TRANSFORM_GPU_DIST};
+  out_vec.Fill(0);
+
+  Transform<>::Init(TestTransformRange<bst_float>{},
+                    Range{0, static_cast<Range::DifferenceType>(size)},
+                    TRANSFORM_GPU_RANGE)
+      .Eval(&out_vec, &in_vec);
+  std::vector<bst_float> res = out_vec.HostVector();
+
+  ASSERT_TRUE(std::equal(h_in.begin(), h_in.end(), res.begin()));
+}
+
 } // namespace common
 } // namespace xgboost
@@ -0,0 +1,62 @@
+// Copyright by Contributors
+#include <xgboost/data.h>
+#include <limits>
+#include "../../../src/data/dense_dmatrix.h"
+
+#include "../helpers.h"
+
+TEST(DenseDMatrix, MetaInfo) {
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  // two rows, three columns, one missing entry
+  const float data[] = {1.0f, 0.0f, 20.0f,
+                        0.5f, nan,  2.0f};
+  xgboost::data::DenseDMatrix dmat(data, 2, 3, nan);
+
+  EXPECT_EQ(dmat.Info().num_row_, 2);
+  EXPECT_EQ(dmat.Info().num_col_, 3);
+  EXPECT_EQ(dmat.Info().num_nonzero_, 5);
+}
+
+TEST(DenseDMatrix, RowAccess) {
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  const float data[] = {1.0f, 0.0f, 20.0f,
+                        0.5f, nan,  2.0f};
+  xgboost::data::DenseDMatrix dmat(data, 2, 3, nan);
+
+  // Loop over the batches and count the records
+  long row_count = 0;
+  for (auto &batch : dmat.GetRowBatches()) {
+    row_count += batch.Size();
+  }
+  EXPECT_EQ(row_count, dmat.Info().num_row_);
+  // Test the data read into the first row
+  auto &batch = *dmat.GetRowBatches().begin();
+  auto first_row = batch[0];
+  ASSERT_EQ(first_row.size(), 3);
+  EXPECT_EQ(first_row[2].index, 2);
+  EXPECT_EQ(first_row[2].fvalue, 20);
+  // the missing entry must be dropped from the second row
+  auto second_row = batch[1];
+  ASSERT_EQ(second_row.size(), 2);
+  EXPECT_EQ(second_row[1].index, 2);
+  EXPECT_EQ(second_row[1].fvalue, 2);
+}
+
+TEST(DenseDMatrix, ColAccess) {
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  const float data[] = {1.0f, 0.0f, 20.0f,
+                        0.5f, nan,  2.0f};
+  xgboost::data::DenseDMatrix dmat(data, 2, 3, nan);
+
+  EXPECT_EQ(dmat.GetColDensity(0), 1);
+  EXPECT_EQ(dmat.GetColDensity(1), 0.5);
+  ASSERT_TRUE(dmat.SingleColBlock());
+
+  long num_col_batch = 0;
+  for (const auto &batch : dmat.GetSortedColumnBatches()) {
+    num_col_batch += 1;
+    EXPECT_EQ(batch.Size(), dmat.Info().num_col_)
+        << "Expected batch size = number of cells as #batches is 1.";
+  }
+  EXPECT_EQ(num_col_batch, 1) << "Expected number of batches to be 1";
+}
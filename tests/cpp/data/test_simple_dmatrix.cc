@@ -63,3 +63,154 @@ TEST(SimpleDMatrix, ColAccessWithoutBatches) {
   EXPECT_EQ(num_col_batch, 1) << "Expected number of batches to be 1";
   delete dmat;
 }
+
+TEST(SimpleDMatrix, Stats) {
+  dmlc::TemporaryDirectory tempdir;
+  const std::string tmp_file = tempdir.path + "/simple.libsvm";
+  CreateSimpleTestData(tmp_file);
+  xgboost::DMatrix * dmat = xgboost::DMatrix::Load(tmp_file, true, false);
+
+  // rows are "0:0 1:10 2:20" and "0:0 3:30 4:40"
+  const xgboost::DatasetStats &stats = dmat->Stats();
+  EXPECT_EQ(stats.num_row, 2);
+  ASSERT_EQ(stats.column_nnz.size(), 5);
+  EXPECT_EQ(stats.column_nnz[0], 2);
+  EXPECT_EQ(stats.column_nnz[1], 1);
+  EXPECT_EQ(stats.Density(0), 1.0f);
+  EXPECT_EQ(stats.Density(1), 0.5f);
+  EXPECT_EQ(stats.MissingCount(0), 0);
+  EXPECT_EQ(stats.MissingCount(3), 1);
+  EXPECT_EQ(stats.column_min[2], 20.0f);
+  EXPECT_EQ(stats.column_max[2], 20.0f);
+  EXPECT_EQ(stats.column_min[0], 0.0f);
+  EXPECT_EQ(stats.column_max[4], 40.0f);
+  // both rows hold three entries: bucket 2 covers lengths [2, 4)
+  ASSERT_EQ(stats.row_length_hist.size(), 3);
+  EXPECT_EQ(stats.row_length_hist[2], 2);
+
+  // the block is computed once and cached
+  EXPECT_EQ(&dmat->Stats(), &stats);
+
+  delete dmat;
+}
+
+TEST(SimpleDMatrix, SoAMirror) {
+  dmlc::TemporaryDirectory tempdir;
+  const std::string tmp_file = tempdir.path + "/simple.libsvm";
+  CreateSimpleTestData(tmp_file);
+  xgboost::DMatrix * dmat = xgboost::DMatrix::Load(tmp_file, true, false);
+
+  // the mirror must agree with the interleaved representation row by row
+  for (const auto &batch : dmat->GetRowBatches()) {
+    auto indices = batch.Indices();
+    auto values = batch.Values();
+    ASSERT_EQ(indices.size(), batch.data.Size());
+    ASSERT_EQ(values.size(), batch.data.Size());
+    for (size_t i = 0; i < batch.Size(); ++i) {
+      auto row = batch[i];
+      auto row_indices = batch.RowIndices(i);
+      auto row_values = batch.RowValues(i);
+      ASSERT_EQ(row_indices.size(), row.size());
+      ASSERT_EQ(row_values.size(), row.size());
+      for (size_t j = 0; j < row.size(); ++j) {
+        EXPECT_EQ(row_indices[j], row[j].index);
+        EXPECT_EQ(row_values[j], row[j].fvalue);
+      }
+    }
+  }
+
+  // growing a page must refresh the mirror
+  xgboost::SparsePage page;
+  std::vector<xgboost::Entry> row{{0, 1.0f}, {3, 2.0f}};
+  page.Push(xgboost::SparsePage::Inst(
+      dmlc::BeginPtr(row),
+      static_cast<xgboost::SparsePage::Inst::index_type>(row.size())));
+  EXPECT_EQ(page.Values().size(), 2);
+  page.Push(xgboost::SparsePage::Inst(
+      dmlc::BeginPtr(row),
+      static_cast<xgboost::SparsePage::Inst::index_type>(row.size())));
+  EXPECT_EQ(page.Values().size(), 4);
+  EXPECT_EQ(page.RowIndices(1)[1], 3);
+  page.Clear();
+  EXPECT_EQ(page.Values().size(), 0);
+
+  delete dmat;
+}
+
+// setenv is POSIX only
+#if DMLC_ENABLE_STD_THREAD && !defined(_WIN32)
+TEST(SimpleDMatrix, ShardedParse) {
+  dmlc::TemporaryDirectory tempdir;
+  const std::string tmp_file = tempdir.path + "/big.libsvm";
+  CreateBigTestData(tmp_file, 12000);
+  xgboost::DMatrix * dmat = xgboost::DMatrix::Load(tmp_file, true, false);
+
+  setenv("XGBOOST_PARSE_NTHREAD", "4", 1);
+  xgboost::DMatrix * sharded = xgboost::DMatrix::Load(tmp_file, true, false);
+  unsetenv("XGBOOST_PARSE_NTHREAD");
+
+  // the sharded parse must reproduce the single threaded parse exactly
+  ASSERT_EQ(sharded->Info().num_row_, dmat->Info().num_row_);
+  ASSERT_EQ(sharded->Info().num_col_, dmat->Info().num_col_);
+  ASSERT_EQ(sharded->Info().num_nonzero_, dmat->Info().num_nonzero_);
+  auto &batch = *dmat->GetRowBatches().begin();
+  auto &sharded_batch = *sharded->GetRowBatches().begin();
+  ASSERT_EQ(sharded_batch.Size(), batch.Size());
+  for (size_t i = 0; i < batch.Size(); ++i) {
+    auto row = batch[i];
+    auto sharded_row = sharded_batch[i];
+    ASSERT_EQ(sharded_row.size(), row.size());
+    for (size_t j = 0; j < row.size(); ++j) {
+      EXPECT_EQ(sharded_row[j].index, row[j].index);
+      EXPECT_EQ(sharded_row[j].fvalue, row[j].fvalue);
+    }
+  }
+
+  delete sharded;
+  delete dmat;
+}
+#endif  // DMLC_ENABLE_STD_THREAD && !defined(_WIN32)
+
+TEST(SimpleDMatrix, AppendRows) {
+  dmlc::TemporaryDirectory tempdir;
+  const std::string tmp_file = tempdir.path + "/simple.libsvm";
+  CreateSimpleTestData(tmp_file);
+  xgboost::DMatrix * dmat = xgboost::DMatrix::Load(tmp_file, true, false);
+  xgboost::DMatrix * extra = xgboost::DMatrix::Load(tmp_file, true, false);
+
+  // trigger the derived structures so appending has to refresh them
+  EXPECT_EQ(dmat->GetColDensity(0), 1);
+  EXPECT_EQ(dmat->Stats().num_row, 2);
+
+  dmat->AppendRows(extra);
+
+  EXPECT_EQ(dmat->Info().num_row_, 4);
+  EXPECT_EQ(dmat->Info().num_col_, 5);
+  EXPECT_EQ(dmat->Info().num_nonzero_, 12);
+  ASSERT_EQ(dmat->Info().labels_.Size(), 4);
+  EXPECT_EQ(dmat->Info().labels_.HostVector()[2],
+            dmat->Info().labels_.HostVector()[0]);
+
+  // the appended rows mirror the original ones
+  auto &batch = *dmat->GetRowBatches().begin();
+  ASSERT_EQ(batch.Size(), 4);
+  for (size_t i = 0; i < 2; ++i) {
+    auto row = batch[i];
+    auto appended = batch[2 + i];
+    ASSERT_EQ(appended.size(), row.size());
+    for (size_t j = 0; j < row.size(); ++j) {
+      EXPECT_EQ(appended[j].index, row[j].index);
+      EXPECT_EQ(appended[j].fvalue, row[j].fvalue);
+    }
+  }
+
+  // derived structures were dropped and reflect the extended data
+  EXPECT_EQ(dmat->Stats().num_row, 4);
+  EXPECT_EQ(dmat->GetColDensity(1), 0.5);
+
+  // the source matrix is untouched
+  EXPECT_EQ(extra->Info().num_row_, 2);
+
+  delete extra;
+  delete dmat;
+}
@@ -0,0 +1,75 @@
+// Copyright by Contributors
+#include <xgboost/data.h>
+#include <dmlc/filesystem.h>
+#include "../../../src/data/slice_dmatrix.h"
+
+#include "../helpers.h"
+
+TEST(SliceDMatrix, MetaInfo) {
+  dmlc::TemporaryDirectory tempdir;
+  const std::string tmp_file = tempdir.path + "/simple.libsvm";
+  CreateSimpleTestData(tmp_file);
+  std::shared_ptr<xgboost::DMatrix> dmat(
+      xgboost::DMatrix::Load(tmp_file, true, false));
+
+  std::vector<xgboost::bst_uint> ridx{1};
+  xgboost::data::SliceDMatrix view(dmat, ridx);
+
+  EXPECT_EQ(view.Info().num_row_, 1);
+  EXPECT_EQ(view.Info().num_col_, dmat->Info().num_col_);
+  EXPECT_EQ(view.Info().labels_.Size(), 1);
+  EXPECT_EQ(view.Info().labels_.HostVector()[0],
+            dmat->Info().labels_.HostVector()[1]);
+
+  const std::vector<xgboost::bst_uint>* out_ridx = nullptr;
+  EXPECT_EQ(view.ViewParent(&out_ridx), dmat.get());
+  EXPECT_EQ(out_ridx->size(), 1);
+}
+
+TEST(SliceDMatrix, RowAccess) {
+  dmlc::TemporaryDirectory tempdir;
+  const std::string tmp_file = tempdir.path + "/simple.libsvm";
+  CreateSimpleTestData(tmp_file);
+  std::shared_ptr<xgboost::DMatrix> dmat(
+      xgboost::DMatrix::Load(tmp_file, true, false));
+
+  // reversed order: the view must present rows in index-list order
+  std::vector<xgboost::bst_uint> ridx{1, 0};
+  xgboost::data::SliceDMatrix view(dmat, ridx);
+
+  auto& parent_batch = *dmat->GetRowBatches().begin();
+  long row_count = 0;
+  for (auto& batch : view.GetRowBatches()) {
+    row_count += batch.Size();
+    for (size_t i = 0; i < batch.Size(); ++i) {
+      auto view_row = batch[i];
+      auto parent_row = parent_batch[ridx[i]];
+      ASSERT_EQ(view_row.size(), parent_row.size());
+      for (size_t j = 0; j < view_row.size(); ++j) {
+        EXPECT_EQ(view_row[j].index, parent_row[j].index);
+        EXPECT_EQ(view_row[j].fvalue, parent_row[j].fvalue);
+      }
+    }
+  }
+  EXPECT_EQ(row_count, view.Info().num_row_);
+}
+
+TEST(SliceDMatrix, ColAccess) {
+  dmlc::TemporaryDirectory tempdir;
+  const std::string tmp_file = tempdir.path + "/simple.libsvm";
+  CreateSimpleTestData(tmp_file);
+  std::shared_ptr<xgboost::DMatrix> dmat(
+      xgboost::DMatrix::Load(tmp_file, true, false));
+
+  std::vector<xgboost::bst_uint> ridx{0, 1};
+  xgboost::data::SliceDMatrix view(dmat, ridx);
+
+  ASSERT_TRUE(view.SingleColBlock());
+  EXPECT_EQ(view.GetColDensity(0), dmat->GetColDensity(0));
+  long num_col_batch = 0;
+  for (const auto& batch : view.GetSortedColumnBatches()) {
+    num_col_batch += 1;
+    EXPECT_EQ(batch.Size(), view.Info().num_col_);
+  }
+  EXPECT_EQ(num_col_batch, 1);
+}
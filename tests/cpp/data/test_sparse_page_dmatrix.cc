@@ -49,6 +49,36 @@ TEST(SparsePageDMatrix, RowAccess) {
   delete dmat;
 }
 
+TEST(SparsePageDMatrix, PageSubsample) {
+  // Create sufficiently large data to make several row pages
+  dmlc::TemporaryDirectory tempdir;
+  const std::string tmp_file = tempdir.path + "/big.libsvm";
+  CreateBigTestData(tmp_file, 5000000);
+  xgboost::DMatrix * dmat = xgboost::DMatrix::Load(
+    tmp_file + "#" + tmp_file + ".cache", true, false);
+  EXPECT_TRUE(FileExists(tmp_file + ".cache.row.page.rows"));
+
+  dmat->SetPageSubsample(0.5f, 7);
+  long total_sampled = 0;
+  const int kEpochs = 8;
+  for (int epoch = 0; epoch < kEpochs; ++epoch) {
+    for (auto &batch : dmat->GetRowBatches()) {
+      // kept pages must keep their original base row id: the generator
+      // writes index 1 on even rows and index 3 on odd rows
+      for (size_t i = 0; i < batch.Size(); ++i) {
+        const size_t global_row = batch.base_rowid + i;
+        ASSERT_EQ(batch[i][1].index, global_row % 2 == 0 ? 1u : 3u);
+      }
+      total_sampled += batch.Size();
+    }
+  }
+  // each page is kept with probability 0.5, so across several epochs
+  // strictly fewer rows than the full passes must have surfaced
+  EXPECT_LT(total_sampled, kEpochs * static_cast<long>(dmat->Info().num_row_));
+
+  delete dmat;
+}
+
 TEST(SparsePageDMatrix, ColAccess) {
   dmlc::TemporaryDirectory tempdir;
   const std::string tmp_file = tempdir.path + "/simple.libsvm";
@@ -80,3 +110,41 @@ TEST(SparsePageDMatrix, ColAccess) {
 
   delete dmat;
 }
+
+// setenv is POSIX only
+#if !defined(_WIN32)
+TEST(SparsePageDMatrix, ShardedCacheBuild) {
+  dmlc::TemporaryDirectory tempdir;
+  const std::string tmp_file = tempdir.path + "/big.libsvm";
+  CreateBigTestData(tmp_file, 12000);
+  xgboost::DMatrix * dmat = xgboost::DMatrix::Load(tmp_file, true, false);
+
+  setenv("XGBOOST_PARSE_NTHREAD", "4", 1);
+  xgboost::DMatrix * sharded = xgboost::DMatrix::Load(
+    tmp_file + "#" + tmp_file + ".cache", true, false);
+  unsetenv("XGBOOST_PARSE_NTHREAD");
+  EXPECT_TRUE(FileExists(tmp_file + ".cache.row.page"));
+
+  // the sharded cache build must reproduce the single threaded parse
+  ASSERT_EQ(sharded->Info().num_row_, dmat->Info().num_row_);
+  ASSERT_EQ(sharded->Info().num_col_, dmat->Info().num_col_);
+  ASSERT_EQ(sharded->Info().num_nonzero_, dmat->Info().num_nonzero_);
+  auto &batch = *dmat->GetRowBatches().begin();
+  size_t ridx = 0;
+  for (auto &sharded_batch : sharded->GetRowBatches()) {
+    for (size_t i = 0; i < sharded_batch.Size(); ++i, ++ridx) {
+      auto row = batch[ridx];
+      auto sharded_row = sharded_batch[i];
+      ASSERT_EQ(sharded_row.size(), row.size());
+      for (size_t j = 0; j < row.size(); ++j) {
+        EXPECT_EQ(sharded_row[j].index, row[j].index);
+        EXPECT_EQ(sharded_row[j].fvalue, row[j].fvalue);
+      }
+    }
+  }
+  ASSERT_EQ(ridx, dmat->Info().num_row_);
+
+  delete sharded;
+  delete dmat;
+}
+#endif  // !defined(_WIN32)
@@ -26,6 +26,29 @@ TEST(Objective, DeclareUnifiedTest(LinearRegressionGPair)) {
   delete obj;
 }
 
+TEST(Objective, DeclareUnifiedTest(LinearRegressionFusedMetric)) {
+  xgboost::ObjFunction * obj = xgboost::ObjFunction::Create("reg:linear");
+  std::vector<std::pair<std::string, std::string> > args
+    {{"fused_eval_metric", "true"}};
+  obj->Configure(args);
+
+  xgboost::HostDeviceVector<xgboost::bst_float> preds = {0, 1, 2, 3};
+  xgboost::MetaInfo info;
+  info.num_row_ = 4;
+  info.labels_.HostVector() = std::vector<xgboost::bst_float>{1, 1, 1, 1};
+  xgboost::HostDeviceVector<xgboost::GradientPair> gpair;
+
+  xgboost::bst_float value = 0;
+  ASSERT_FALSE(obj->GetFusedMetric(info, "rmse", &value));
+  obj->GetGradient(preds, info, 0, &gpair);
+  ASSERT_TRUE(obj->GetFusedMetric(info, "rmse", &value));
+  // residuals {1, 0, 1, 2} -> rmse = sqrt(6 / 4)
+  EXPECT_NEAR(value, 1.224745f, 1e-5f);
+  ASSERT_FALSE(obj->GetFusedMetric(info, "mae", &value));
+
+  delete obj;
+}
+
 TEST(Objective, DeclareUnifiedTest(LogisticRegressionGPair)) {
   xgboost::ObjFunction * obj = xgboost::ObjFunction::Create("reg:logistic");
   std::vector<std::pair<std::string, std::string> > args;
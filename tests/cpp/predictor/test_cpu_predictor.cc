@@ -2,6 +2,7 @@
 #include <gtest/gtest.h>
 #include <xgboost/predictor.h>
 #include "../helpers.h"
+#include "../../../src/common/hist_util.h"
 
 namespace xgboost {
 TEST(cpu_predictor, Test) {
@@ -60,4 +61,522 @@ TEST(cpu_predictor, Test) {
 
   delete dmat;
 }
+
+// seeding the per-matrix cache with externally supplied margins must make
+// the next full batch prediction a cache hit, the warm-start path of
+// training continuation
+TEST(cpu_predictor, TestCacheSeeding) {
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+
+  std::vector<std::unique_ptr<RegTree>> trees;
+  trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+  (*trees.back())[0].SetLeaf(1.5f);
+  (*trees.back()).Stat(0).sum_hess = 1.0f;
+  gbm::GBTreeModel model(0.5);
+  model.CommitModel(std::move(trees), 0);
+  model.param.num_output_group = 1;
+  model.base_margin = 0;
+
+  int n_row = 5;
+  int n_col = 5;
+
+  auto dmat = CreateDMatrix(n_row, n_col, 0);
+  auto other = CreateDMatrix(n_row, n_col, 0);
+  cpu_predictor->Init({}, {*dmat});
+
+  std::vector<float> margin(n_row, 3.25f);
+  // matrices outside the cache are rejected
+  ASSERT_FALSE(cpu_predictor->SeedPredictionCache((*other).get(), margin));
+  ASSERT_TRUE(cpu_predictor->SeedPredictionCache((*dmat).get(), margin));
+
+  std::vector<float> cached;
+  ASSERT_FALSE(cpu_predictor->LookupPredictionCache((*other).get(), &cached));
+  ASSERT_TRUE(cpu_predictor->LookupPredictionCache((*dmat).get(), &cached));
+  ASSERT_EQ(cached.size(), margin.size());
+
+  // the full prediction pass is served from the seeded cache, not the trees
+  HostDeviceVector<float> out_predictions;
+  cpu_predictor->PredictBatch((*dmat).get(), &out_predictions, model, 0);
+  std::vector<float>& out_predictions_h = out_predictions.HostVector();
+  for (int i = 0; i < out_predictions.Size(); i++) {
+    ASSERT_EQ(out_predictions_h[i], 3.25f);
+  }
+
+  delete dmat;
+  delete other;
+}
+
+// covers the blocked prediction loop and the compact frozen tree layout:
+// enough rows for full row tiles plus a remainder, and trees with real
+// splits, checked against the per-instance prediction path
+TEST(cpu_predictor, TestBlockedLoop) {
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+
+  int n_trees = 5;
+  std::vector<std::unique_ptr<RegTree>> trees;
+  for (int i = 0; i < n_trees; i++) {
+    trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+    trees.back()->ExpandNode(0, i % 5, 0.5f, i % 2 == 0);
+    (*trees.back())[1].SetLeaf(1.5f);
+    (*trees.back())[2].SetLeaf(-0.5f);
+  }
+  gbm::GBTreeModel model(0.5);
+  model.CommitModel(std::move(trees), 0);
+  model.param.num_output_group = 1;
+  model.param.num_feature = 5;
+  model.base_margin = 0;
+
+  int n_row = 21;
+  int n_col = 5;
+
+  auto dmat = CreateDMatrix(n_row, n_col, 0);
+
+  HostDeviceVector<float> out_predictions;
+  cpu_predictor->PredictBatch((*dmat).get(), &out_predictions, model, 0);
+  std::vector<float>& out_predictions_h = out_predictions.HostVector();
+
+  auto &batch = *(*dmat)->GetRowBatches().begin();
+  for (int i = 0; i < batch.Size(); i++) {
+    std::vector<float> instance_out_predictions;
+    cpu_predictor->PredictInstance(batch[i], &instance_out_predictions, model);
+    ASSERT_EQ(out_predictions_h[i], instance_out_predictions[0]);
+  }
+
+  delete dmat;
+}
+
+// covers the CSR-direct sparse traversal: a low ratio forces the sparse
+// path on a sparse matrix, checked against the per-instance prediction path
+TEST(cpu_predictor, TestSparseTraversal) {
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+  cpu_predictor->Init({{"sparse_traversal_ratio", "1"}}, {});
+
+  int n_trees = 5;
+  std::vector<std::unique_ptr<RegTree>> trees;
+  for (int i = 0; i < n_trees; i++) {
+    trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+    trees.back()->ExpandNode(0, i % 5, 0.5f, i % 2 == 0);
+    (*trees.back())[1].SetLeaf(1.5f);
+    (*trees.back())[2].SetLeaf(-0.5f);
+  }
+  gbm::GBTreeModel model(0.5);
+  model.CommitModel(std::move(trees), 0);
+  model.param.num_output_group = 1;
+  model.param.num_feature = 5;
+  model.base_margin = 0;
+
+  int n_row = 21;
+  int n_col = 5;
+
+  auto dmat = CreateDMatrix(n_row, n_col, 0.8, 3);  // sparse
+
+  HostDeviceVector<float> out_predictions;
+  cpu_predictor->PredictBatch((*dmat).get(), &out_predictions, model, 0);
+  std::vector<float>& out_predictions_h = out_predictions.HostVector();
+
+  auto &batch = *(*dmat)->GetRowBatches().begin();
+  for (int i = 0; i < batch.Size(); i++) {
+    std::vector<float> instance_out_predictions;
+    cpu_predictor->PredictInstance(batch[i], &instance_out_predictions, model);
+    ASSERT_EQ(out_predictions_h[i], instance_out_predictions[0]);
+  }
+
+  delete dmat;
+}
+
+// in-place prediction over a raw dense buffer must agree with instance
+// prediction over the equivalent sparse rows
+TEST(cpu_predictor, TestPredictDense) {
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+  cpu_predictor->Init({}, {});
+
+  int n_trees = 5;
+  std::vector<std::unique_ptr<RegTree>> trees;
+  for (int i = 0; i < n_trees; i++) {
+    trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+    trees.back()->ExpandNode(0, i % 5, 0.5f, i % 2 == 0);
+    (*trees.back())[1].SetLeaf(1.5f);
+    (*trees.back())[2].SetLeaf(-0.5f);
+  }
+  gbm::GBTreeModel model(0.5);
+  model.CommitModel(std::move(trees), 0);
+  model.param.num_output_group = 1;
+  model.param.num_feature = 5;
+  model.base_margin = 0;
+
+  const size_t n_row = 8;
+  const size_t n_col = 5;
+  const float kMissing = -999.0f;
+  std::vector<float> data(n_row * n_col);
+  for (size_t i = 0; i < n_row; ++i) {
+    for (size_t j = 0; j < n_col; ++j) {
+      // leave a diagonal band of features missing
+      data[i * n_col + j] =
+          ((i + j) % 3 == 0) ? kMissing : 0.1f * static_cast<float>(i + j);
+    }
+  }
+
+  std::vector<float> out_predictions;
+  cpu_predictor->PredictDense(data.data(), n_row, n_col, kMissing, model, 0,
+                              &out_predictions);
+  ASSERT_EQ(out_predictions.size(), n_row);
+
+  for (size_t i = 0; i < n_row; ++i) {
+    std::vector<Entry> row;
+    for (size_t j = 0; j < n_col; ++j) {
+      const float v = data[i * n_col + j];
+      if (v != kMissing) {
+        row.emplace_back(static_cast<bst_uint>(j), v);
+      }
+    }
+    SparsePage::Inst inst(
+        row.data(), static_cast<SparsePage::Inst::index_type>(row.size()));
+    std::vector<float> instance_out_predictions;
+    cpu_predictor->PredictInstance(inst, &instance_out_predictions, model);
+    ASSERT_EQ(out_predictions[i], instance_out_predictions[0]);
+  }
+}
+
+// covers the quantized fast path: a published quantized matrix plus trees
+// whose thresholds are cut values route prediction through bin comparisons
+TEST(cpu_predictor, TestQuantized) {
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+
+  int n_row = 50;
+  int n_col = 3;
+  auto dmat = CreateDMatrix(n_row, n_col, 0);
+
+  auto gmat = std::make_shared<common::GHistIndexMatrix>();
+  gmat->Init((*dmat).get(), 16);
+  common::PublishGHistIndex((*dmat).get(), gmat);
+
+  // split on an interior cut value of feature 1, as the hist updater would
+  bst_uint fid = 1;
+  uint32_t lo = gmat->cut.row_ptr[fid];
+  uint32_t hi = gmat->cut.row_ptr[fid + 1];
+  ASSERT_GT(hi, lo);
+  bst_float split = gmat->cut.cut[(lo + hi) / 2];
+
+  std::vector<std::unique_ptr<RegTree>> trees;
+  trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+  trees.back()->ExpandNode(0, fid, split, true);
+  (*trees.back())[1].SetLeaf(1.5f);
+  (*trees.back())[2].SetLeaf(-0.5f);
+  gbm::GBTreeModel model(0.5);
+  model.CommitModel(std::move(trees), 0);
+  model.param.num_output_group = 1;
+  model.param.num_feature = n_col;
+  model.base_margin = 0;
+
+  HostDeviceVector<float> out_predictions;
+  cpu_predictor->PredictBatch((*dmat).get(), &out_predictions, model, 0);
+  std::vector<float>& out_predictions_h = out_predictions.HostVector();
+
+  auto &batch = *(*dmat)->GetRowBatches().begin();
+  for (int i = 0; i < batch.Size(); i++) {
+    float fvalue = batch[i][fid].fvalue;
+    float expected = fvalue < split ? 1.5f : -0.5f;
+    ASSERT_EQ(out_predictions_h[i], expected);
+  }
+
+  delete dmat;
+}
+
+// continuing a batch prediction from a nonzero tree_begin must give the
+// same margins as a single full pass
+TEST(cpu_predictor, TestDeltaPrediction) {
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+
+  int n_trees = 5;
+  std::vector<std::unique_ptr<RegTree>> trees;
+  for (int i = 0; i < n_trees; i++) {
+    trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+    trees.back()->ExpandNode(0, i % 5, 0.5f, i % 2 == 0);
+    (*trees.back())[1].SetLeaf(1.5f);
+    (*trees.back())[2].SetLeaf(-0.5f);
+  }
+  gbm::GBTreeModel model(0.5);
+  model.CommitModel(std::move(trees), 0);
+  model.param.num_output_group = 1;
+  model.param.num_feature = 5;
+  model.base_margin = 0;
+
+  auto dmat = CreateDMatrix(17, 5, 0);
+
+  HostDeviceVector<float> full_preds;
+  cpu_predictor->PredictBatch((*dmat).get(), &full_preds, model, 0);
+
+  // margins at two trees, then only the remaining trees on top
+  HostDeviceVector<float> delta_preds;
+  cpu_predictor->PredictBatch((*dmat).get(), &delta_preds, model, 0, 2);
+  cpu_predictor->PredictBatch((*dmat).get(), &delta_preds, model, 2);
+
+  std::vector<float>& full_h = full_preds.HostVector();
+  std::vector<float>& delta_h = delta_preds.HostVector();
+  ASSERT_EQ(full_h.size(), delta_h.size());
+  for (int i = 0; i < full_h.size(); i++) {
+    ASSERT_FLOAT_EQ(full_h[i], delta_h[i]);
+  }
+
+  delete dmat;
+}
+
+// the cascade mode may report partial margins, but every sign decision
+// has to match full evaluation
+TEST(cpu_predictor, TestCascade) {
+  std::unique_ptr<Predictor> full_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+  std::unique_ptr<Predictor> cascade_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+  cascade_predictor->Init({{"cascade_stage_size", "2"}}, {});
+
+  int n_trees = 7;
+  std::vector<std::unique_ptr<RegTree>> trees;
+  for (int i = 0; i < n_trees; i++) {
+    trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+    trees.back()->ExpandNode(0, i % 5, 0.5f, i % 2 == 0);
+    (*trees.back())[1].SetLeaf(1.5f);
+    (*trees.back())[2].SetLeaf(-0.5f);
+  }
+  gbm::GBTreeModel model(0.5);
+  model.CommitModel(std::move(trees), 0);
+  model.param.num_output_group = 1;
+  model.param.num_feature = 5;
+  model.base_margin = 0;
+
+  auto dmat = CreateDMatrix(33, 5, 0);
+
+  HostDeviceVector<float> full_preds;
+  full_predictor->PredictBatch((*dmat).get(), &full_preds, model, 0);
+  HostDeviceVector<float> cascade_preds;
+  cascade_predictor->PredictBatch((*dmat).get(), &cascade_preds, model, 0);
+
+  std::vector<float>& full_h = full_preds.HostVector();
+  std::vector<float>& cascade_h = cascade_preds.HostVector();
+  ASSERT_EQ(full_h.size(), cascade_h.size());
+  for (int i = 0; i < full_h.size(); i++) {
+    ASSERT_EQ(full_h[i] > 0, cascade_h[i] > 0);
+  }
+
+  delete dmat;
+}
+
+// the half precision node layout must calibrate successfully on trees
+// whose thresholds are exactly representable and then reproduce the full
+// precision batch predictions
+TEST(cpu_predictor, TestHalfNodes) {
+  std::unique_ptr<Predictor> full_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+  std::unique_ptr<Predictor> half_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+  half_predictor->Init({{"half_node_calibration_rows", "64"}}, {});
+
+  int n_trees = 5;
+  std::vector<std::unique_ptr<RegTree>> trees;
+  for (int i = 0; i < n_trees; i++) {
+    trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+    // 0.5 is exactly representable in half precision
+    trees.back()->ExpandNode(0, i % 5, 0.5f, i % 2 == 0);
+    (*trees.back())[1].SetLeaf(1.5f);
+    (*trees.back())[2].SetLeaf(-0.5f);
+  }
+  gbm::GBTreeModel model(0.5);
+  model.CommitModel(std::move(trees), 0);
+  model.param.num_output_group = 1;
+  model.param.num_feature = 5;
+  model.base_margin = 0;
+
+  auto dmat = CreateDMatrix(33, 5, 0);
+
+  HostDeviceVector<float> full_preds;
+  full_predictor->PredictBatch((*dmat).get(), &full_preds, model, 0);
+  HostDeviceVector<float> half_preds;
+  half_predictor->PredictBatch((*dmat).get(), &half_preds, model, 0);
+
+  std::vector<float>& full_h = full_preds.HostVector();
+  std::vector<float>& half_h = half_preds.HostVector();
+  ASSERT_EQ(full_h.size(), half_h.size());
+  for (int i = 0; i < full_h.size(); i++) {
+    ASSERT_EQ(full_h[i], half_h[i]);
+  }
+
+  delete dmat;
+}
+
+// the process-level cache must return the stored predictions on a second
+// pass and drop everything when the capacity goes to zero
+TEST(cpu_predictor, TestGlobalPredictionCache) {
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+
+  std::vector<std::unique_ptr<RegTree>> trees;
+  trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+  trees.back()->ExpandNode(0, 2, 0.5f, true);
+  (*trees.back())[1].SetLeaf(1.5f);
+  (*trees.back())[2].SetLeaf(-0.5f);
+  gbm::GBTreeModel model(0.5);
+  model.CommitModel(std::move(trees), 0);
+  model.param.num_output_group = 1;
+  model.param.num_feature = 5;
+  model.base_margin = 0;
+
+  auto dmat = CreateDMatrix(20, 5, 0);
+  GlobalPredictionCache* cache = GlobalPredictionCache::Get();
+  cache->SetCapacityBytes(1 << 20);
+
+  HostDeviceVector<float> first;
+  cpu_predictor->PredictBatch((*dmat).get(), &first, model, 0);
+  std::vector<float> cached;
+  ASSERT_TRUE(cache->Lookup(model, (*dmat).get(), 0, &cached));
+  ASSERT_EQ(cached, first.HostVector());
+
+  // the second pass comes back from the cache unchanged
+  HostDeviceVector<float> second;
+  cpu_predictor->PredictBatch((*dmat).get(), &second, model, 0);
+  ASSERT_EQ(second.HostVector(), first.HostVector());
+
+  // zero capacity empties the cache
+  cache->SetCapacityBytes(0);
+  ASSERT_FALSE(cache->Lookup(model, (*dmat).get(), 0, &cached));
+  cache->SetCapacityBytes(256UL << 20);
+
+  delete dmat;
+}
+
+// subsampling knobs only apply to approximate contributions; exact SHAP
+// stays untouched
+TEST(cpu_predictor, TestContributionSampling) {
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+  cpu_predictor->Init({{"contribution_row_sample", "0"}}, {});
+
+  std::vector<std::unique_ptr<RegTree>> trees;
+  trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+  (*trees.back())[0].SetLeaf(1.5f);
+  (*trees.back()).Stat(0).sum_hess = 1.0f;
+  gbm::GBTreeModel model(0.5);
+  model.CommitModel(std::move(trees), 0);
+  model.param.num_output_group = 1;
+  model.base_margin = 0;
+
+  auto dmat = CreateDMatrix(5, 5, 0);
+
+  // every row is sampled out, so approximate contributions stay zero
+  std::vector<float> out_contribution;
+  cpu_predictor->PredictContribution((*dmat).get(), &out_contribution, model,
+                                     0, true);
+  for (int i = 0; i < out_contribution.size(); i++) {
+    ASSERT_EQ(out_contribution[i], 0);
+  }
+
+  // the exact path ignores the sampling knobs
+  cpu_predictor->PredictContribution((*dmat).get(), &out_contribution, model);
+  for (int i = 0; i < out_contribution.size(); i++) {
+    ASSERT_EQ(out_contribution[i], 1.5);
+  }
+
+  delete dmat;
+}
+
+// the context overload must match the plain instance path and reuse its
+// buffers across calls
+TEST(cpu_predictor, TestPredictionContext) {
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+
+  std::vector<std::unique_ptr<RegTree>> trees;
+  trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+  trees.back()->ExpandNode(0, 1, 0.5f, true);
+  (*trees.back())[1].SetLeaf(1.5f);
+  (*trees.back())[2].SetLeaf(-0.5f);
+  gbm::GBTreeModel model(0.5);
+  model.CommitModel(std::move(trees), 0);
+  model.param.num_output_group = 1;
+  model.param.num_feature = 5;
+  model.base_margin = 0;
+
+  auto dmat = CreateDMatrix(10, 5, 0);
+
+  PredictionContext ctx;
+  auto &batch = *(*dmat)->GetRowBatches().begin();
+  for (int i = 0; i < batch.Size(); i++) {
+    std::vector<float> instance_out_predictions;
+    cpu_predictor->PredictInstance(batch[i], &instance_out_predictions, model);
+    cpu_predictor->PredictInstance(batch[i], &ctx, model);
+    ASSERT_EQ(ctx.preds.HostVector()[0], instance_out_predictions[0]);
+  }
+  // after the first call the feature vector scratch is warm
+  ASSERT_EQ(ctx.feats.Size(), model.param.num_feature);
+
+  delete dmat;
+}
+
+// the thread-safe batch path bypasses every cache but must reproduce the
+// regular batch predictions exactly
+TEST(cpu_predictor, TestPredictBatchSafe) {
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+
+  int n_trees = 5;
+  std::vector<std::unique_ptr<RegTree>> trees;
+  for (int i = 0; i < n_trees; i++) {
+    trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+    trees.back()->ExpandNode(0, i % 5, 0.5f, i % 2 == 0);
+    (*trees.back())[1].SetLeaf(1.5f);
+    (*trees.back())[2].SetLeaf(-0.5f);
+  }
+  gbm::GBTreeModel model(0.5);
+  model.CommitModel(std::move(trees), 0);
+  model.param.num_output_group = 1;
+  model.param.num_feature = 5;
+  model.base_margin = 0;
+
+  auto dmat = CreateDMatrix(21, 5, 0);
+
+  HostDeviceVector<float> batch_preds;
+  cpu_predictor->PredictBatch((*dmat).get(), &batch_preds, model, 0);
+
+  PredictionContext ctx;
+  cpu_predictor->PredictBatchSafe((*dmat).get(), &ctx, model);
+
+  std::vector<float>& batch_h = batch_preds.HostVector();
+  std::vector<float>& safe_h = ctx.preds.HostVector();
+  ASSERT_EQ(batch_h.size(), safe_h.size());
+  for (int i = 0; i < batch_h.size(); i++) {
+    ASSERT_FLOAT_EQ(batch_h[i], safe_h[i]);
+  }
+
+  delete dmat;
+}
+
+TEST(cpu_predictor, TestEmitNativeCode) {
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+
+  std::vector<std::unique_ptr<RegTree>> trees;
+  trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+  trees.back()->ExpandNode(0, 1, 0.5f, true);
+  (*trees.back())[1].SetLeaf(1.5f);
+  (*trees.back())[2].SetLeaf(-0.5f);
+  gbm::GBTreeModel model(0.5);
+  model.CommitModel(std::move(trees), 0);
+  model.param.num_output_group = 1;
+  model.param.num_feature = 3;
+  model.base_margin = 0.5;
+
+  std::string src = cpu_predictor->EmitNativeCode(model);
+  ASSERT_NE(src.find("void xgboost_predict(const float* f, float* out)"),
+            std::string::npos);
+  ASSERT_NE(src.find("#define XGBOOST_NUM_FEATURE 3"), std::string::npos);
+  ASSERT_NE(src.find("isnan(f[1]) ? 1 : (f[1] < 0.5f)"), std::string::npos);
+  ASSERT_NE(src.find("sum += 1.5f"), std::string::npos);
+  ASSERT_NE(src.find("sum += -0.5f"), std::string::npos);
+  ASSERT_NE(src.find("out[0] = sum;"), std::string::npos);
+}
 }  // namespace xgboost
@@ -3,6 +3,8 @@
 #include <vector>
 #include "helpers.h"
 #include "xgboost/learner.h"
+#include "../../src/common/io.h"
+#include "../../src/common/host_device_vector.h"
 
 namespace xgboost {
 
@@ -51,4 +53,222 @@ TEST(learner, SelectTreeMethod) {
   delete mat_ptr;
 }
 
+TEST(learner, FeatureImportance) {
+  using arg = std::pair<std::string, std::string>;
+  auto mat_ptr = CreateDMatrix(50, 10, 0.0f);
+  MetaInfo& info = (**mat_ptr).Info();
+  std::vector<bst_float> labels(info.num_row_);
+  for (size_t i = 0; i < labels.size(); ++i) {
+    labels[i] = i % 2;
+  }
+  info.labels_.HostVector() = labels;
+
+  std::vector<std::shared_ptr<xgboost::DMatrix>> mat = {*mat_ptr};
+  auto learner = std::unique_ptr<Learner>(Learner::Create(mat));
+  learner->Configure({arg("tree_method", "exact")});
+  learner->InitModel();
+  for (int iter = 0; iter < 2; ++iter) {
+    learner->UpdateOneIter(iter, (*mat_ptr).get());
+  }
+
+  std::vector<bst_uint> features;
+  std::vector<bst_float> weight;
+  learner->FeatureImportance("weight", &features, &weight);
+  ASSERT_EQ(features.size(), weight.size());
+  ASSERT_FALSE(features.empty());
+  for (size_t i = 0; i < features.size(); ++i) {
+    ASSERT_LT(features[i], 10);
+    ASSERT_GE(weight[i], 1.0f);
+  }
+
+  std::vector<bst_uint> gain_features;
+  std::vector<bst_float> gain;
+  learner->FeatureImportance("gain", &gain_features, &gain);
+  // gain is defined for exactly the features that have splits
+  ASSERT_EQ(gain_features, features);
+
+  EXPECT_ANY_THROW(learner->FeatureImportance("magic", &features, &weight));
+
+  delete mat_ptr;
+}
+
+// rotating-subsample evaluation: a forced full round must reproduce the
+// exact metrics of an unsampled learner, and intermediate rounds still
+// report the metric under its usual name
+TEST(learner, EvalSubsample) {
+  using arg = std::pair<std::string, std::string>;
+  auto mat_ptr = CreateDMatrix(50, 10, 0.0f);
+  auto& labels = (*mat_ptr)->Info().labels_.HostVector();
+  labels.resize(50);
+  for (size_t i = 0; i < labels.size(); ++i) {
+    labels[i] = static_cast<bst_float>(i % 2);
+  }
+  std::vector<std::shared_ptr<xgboost::DMatrix>> mat = {*mat_ptr};
+
+  auto full_learner = std::unique_ptr<Learner>(Learner::Create(mat));
+  full_learner->Configure({arg("tree_method", "exact")});
+  full_learner->InitModel();
+  full_learner->UpdateOneIter(0, mat[0].get());
+
+  auto sampled_learner = std::unique_ptr<Learner>(Learner::Create(mat));
+  sampled_learner->Configure({arg("tree_method", "exact"),
+                              arg("eval_subsample", "0.25"),
+                              arg("eval_full_period", "4")});
+  sampled_learner->InitModel();
+  sampled_learner->UpdateOneIter(0, mat[0].get());
+
+  // round 3 is a forced full round: (3 + 1) % 4 == 0
+  ASSERT_EQ(full_learner->EvalOneIter(3, {mat[0].get()}, {"train"}),
+            sampled_learner->EvalOneIter(3, {mat[0].get()}, {"train"}));
+
+  // an intermediate round evaluates a quarter-size rotating fold
+  const std::string sampled =
+      sampled_learner->EvalOneIter(0, {mat[0].get()}, {"train"});
+  ASSERT_NE(sampled.find("train-rmse"), std::string::npos);
+
+  delete mat_ptr;
+}
+
+TEST(learner, ModelRoundtrip) {
+  using arg = std::pair<std::string, std::string>;
+  auto mat_ptr = CreateDMatrix(50, 10, 0.0f);
+  std::vector<std::shared_ptr<xgboost::DMatrix>> mat = {*mat_ptr};
+  auto& labels = (*mat_ptr)->Info().labels_.HostVector();
+  labels.resize(50);
+  for (size_t i = 0; i < labels.size(); ++i) {
+    labels[i] = static_cast<bst_float>(i % 2);
+  }
+
+  auto learner = std::unique_ptr<Learner>(Learner::Create(mat));
+  learner->Configure({arg("tree_method", "exact")});
+  learner->InitModel();
+  for (int iter = 0; iter < 3; ++iter) {
+    learner->UpdateOneIter(iter, mat[0].get());
+  }
+
+  std::string buffer;
+  common::MemoryBufferStream fo(&buffer);
+  learner->Save(&fo);
+
+  auto loaded = std::unique_ptr<Learner>(
+      Learner::Create(std::vector<std::shared_ptr<xgboost::DMatrix>>{}));
+  common::MemoryBufferStream fi(&buffer);
+  loaded->Load(&fi);
+
+  FeatureMap fmap;
+  const std::vector<std::string> dump = learner->DumpModel(fmap, true, "text");
+  const std::vector<std::string> loaded_dump =
+      loaded->DumpModel(fmap, true, "text");
+  ASSERT_EQ(dump.size(), loaded_dump.size());
+  for (size_t i = 0; i < dump.size(); ++i) {
+    EXPECT_EQ(dump[i], loaded_dump[i]);
+  }
+
+  delete mat_ptr;
+}
+
+TEST(learner, SliceAndClone) {
+  using arg = std::pair<std::string, std::string>;
+  auto mat_ptr = CreateDMatrix(50, 10, 0.0f);
+  std::vector<std::shared_ptr<xgboost::DMatrix>> mat = {*mat_ptr};
+  auto& labels = (*mat_ptr)->Info().labels_.HostVector();
+  labels.resize(50);
+  for (size_t i = 0; i < labels.size(); ++i) {
+    labels[i] = static_cast<bst_float>(i % 2);
+  }
+
+  auto learner = std::unique_ptr<Learner>(Learner::Create(mat));
+  learner->Configure({arg("tree_method", "exact")});
+  learner->InitModel();
+  for (int iter = 0; iter < 4; ++iter) {
+    learner->UpdateOneIter(iter, mat[0].get());
+  }
+
+  HostDeviceVector<bst_float> full_preds, limit_preds;
+  learner->Predict(mat[0].get(), false, &full_preds);
+  learner->Predict(mat[0].get(), false, &limit_preds, 2);
+
+  // a slice over the first two trees predicts like ntree_limit = 2
+  auto sliced = std::unique_ptr<Learner>(learner->Slice(0, 2));
+  sliced->Configure({arg("tree_method", "exact")});
+  HostDeviceVector<bst_float> sliced_preds;
+  sliced->Predict(mat[0].get(), false, &sliced_preds);
+  ASSERT_EQ(sliced_preds.Size(), limit_preds.Size());
+  for (size_t i = 0; i < limit_preds.Size(); ++i) {
+    ASSERT_EQ(sliced_preds.HostVector()[i], limit_preds.HostVector()[i]);
+  }
+
+  // unit_end = 0 clones the whole model
+  auto clone = std::unique_ptr<Learner>(learner->Slice(0, 0));
+  clone->Configure({arg("tree_method", "exact")});
+  HostDeviceVector<bst_float> clone_preds;
+  clone->Predict(mat[0].get(), false, &clone_preds);
+  ASSERT_EQ(clone_preds.Size(), full_preds.Size());
+  for (size_t i = 0; i < full_preds.Size(); ++i) {
+    ASSERT_EQ(clone_preds.HostVector()[i], full_preds.HostVector()[i]);
+  }
+
+  // training the clone appends to its own tree list and must leave the
+  // shared trees of the source untouched
+  clone->UpdateOneIter(4, mat[0].get());
+  HostDeviceVector<bst_float> src_preds;
+  learner->Predict(mat[0].get(), false, &src_preds);
+  for (size_t i = 0; i < full_preds.Size(); ++i) {
+    ASSERT_EQ(src_preds.HostVector()[i], full_preds.HostVector()[i]);
+  }
+
+  delete mat_ptr;
+}
+
+TEST(learner, EvalAsync) {
+  using arg = std::pair<std::string, std::string>;
+  auto train_ptr = CreateDMatrix(50, 10, 0.0f);
+  auto eval_ptr = CreateDMatrix(50, 10, 0.0f);
+  std::vector<std::shared_ptr<xgboost::DMatrix>> mat = {*train_ptr};
+  for (auto* pp : {train_ptr, eval_ptr}) {
+    auto& labels = (*pp)->Info().labels_.HostVector();
+    labels.resize(50);
+    for (size_t i = 0; i < labels.size(); ++i) {
+      labels[i] = static_cast<bst_float>(i % 2);
+    }
+  }
+  std::vector<DMatrix*> eval_sets = {eval_ptr->get()};
+  std::vector<std::string> eval_names = {"eval"};
+  const int kRounds = 4;
+
+  // reference: the regular synchronous evaluation
+  auto sync_learner = std::unique_ptr<Learner>(Learner::Create(mat));
+  sync_learner->Configure({arg("tree_method", "exact")});
+  sync_learner->InitModel();
+  std::vector<std::string> sync_lines;
+  for (int iter = 0; iter < kRounds; ++iter) {
+    sync_learner->UpdateOneIter(iter, mat[0].get());
+    sync_lines.push_back(
+        sync_learner->EvalOneIter(iter, eval_sets, eval_names));
+  }
+
+  auto async_learner = std::unique_ptr<Learner>(Learner::Create(mat));
+  async_learner->Configure(
+      {arg("tree_method", "exact"), arg("eval_async", "1")});
+  async_learner->InitModel();
+  std::vector<std::string> async_lines;
+  for (int iter = 0; iter < kRounds; ++iter) {
+    async_learner->UpdateOneIter(iter, mat[0].get());
+    async_lines.push_back(
+        async_learner->EvalOneIter(iter, eval_sets, eval_names));
+  }
+
+  // results arrive one round delayed; the last round comes from the flush
+  ASSERT_EQ(async_lines[0], "");
+  for (int iter = 1; iter < kRounds; ++iter) {
+    ASSERT_EQ(async_lines[iter], sync_lines[iter - 1]);
+  }
+  ASSERT_EQ(async_learner->FlushEvalOneIter(), sync_lines[kRounds - 1]);
+  // a second flush has nothing pending
+  ASSERT_EQ(async_learner->FlushEvalOneIter(), "");
+
+  delete train_ptr;
+  delete eval_ptr;
+}
+
 }  // namespace xgboost
@@ -36,8 +36,13 @@ void BuildGidx(DeviceShard<GradientSumT>* shard, int n_rows, int n_cols,
               0.26f, 0.74f, 1.98f,
               0.26f, 0.71f, 1.83f};
 
-  shard->InitRowPtrs(batch);
-  shard->InitCompressedData(cmat, batch);
+  const auto& offset_vec = batch.offset.HostVector();
+  std::vector<size_t> row_offsets(offset_vec.begin(), offset_vec.end());
+
+  shard->InitRowPtrs(row_offsets);
+  shard->InitCompressedData(cmat);
+  shard->CreateHistIndices(batch, row_offsets);
+  shard->FinishCompressedData();
 
   delete dmat;
 }
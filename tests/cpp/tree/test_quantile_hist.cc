@@ -35,6 +35,21 @@ class QuantileHistMock : public QuantileHistMaker {
       ASSERT_EQ(data_layout_, kSparseData);
     }
 
+    void TestInitDataZeroElision(const GHistIndexMatrix& gmat,
+                                 const std::vector<GradientPair>& gpair,
+                                 const DMatrix& fmat,
+                                 const RegTree& tree) {
+      RealImpl::InitData(gmat, gpair, fmat, tree);
+      size_t nonzero = 0;
+      for (auto p : gpair) {
+        if (p.GetGrad() != 0.0f || p.GetHess() != 0.0f) {
+          ++nonzero;
+        }
+      }
+      ASSERT_EQ(row_set_collection_[0].Size(), nonzero);
+      ASSERT_TRUE(rows_elided_);
+    }
+
     void TestBuildHist(int nid,
                        const GHistIndexMatrix& gmat,
                        const DMatrix& fmat,
@@ -62,6 +77,21 @@ class QuantileHistMock : public QuantileHistMaker {
         ASSERT_NEAR(sol.GetGrad(), hist_[nid].begin[i].sum_grad, kEps);
         ASSERT_NEAR(sol.GetHess(), hist_[nid].begin[i].sum_hess, kEps);
       }
+
+      // the partition-ordered gradient copy must reproduce the gathered
+      // histogram exactly
+      hist_builder_.ReorderGradients(
+          gpair, row_set_collection_[nid].begin,
+          row_set_collection_[nid].Size());
+      hist_.AddHistRow(nid + 1);
+      BuildHist(gpair, row_set_collection_[nid],
+                gmat, quantile_index_block, hist_[nid + 1]);
+      hist_builder_.ClearReorderedGradients();
+      for (size_t i = 0; i < hist_[nid + 1].size; ++i) {
+        GradientPairPrecise sol = solution[i];
+        ASSERT_NEAR(sol.GetGrad(), hist_[nid + 1].begin[i].sum_grad, kEps);
+        ASSERT_NEAR(sol.GetHess(), hist_[nid + 1].begin[i].sum_hess, kEps);
+      }
     }
 
     void TestEvaluateSplit(const GHistIndexBlockMatrix& quantile_index_block,
@@ -93,6 +123,55 @@ class QuantileHistMock : public QuantileHistMaker {
 
       delete dmat;
     }
+
+    void TestEvaluateSplitSparseHist(
+        const GHistIndexBlockMatrix& quantile_index_block,
+        const RegTree& tree) {
+      std::vector<GradientPair> row_gpairs =
+          { {0.23f, 0.24f}, {0.24f, 0.25f}, {0.26f, 0.27f}, {0.27f, 0.28f},
+            {0.27f, 0.29f}, {0.37f, 0.39f}, {0.47f, 0.49f}, {0.57f, 0.59f} };
+      size_t constexpr max_bins = 4;
+      auto dmat = CreateDMatrix(n_rows, n_cols, 0, 3);  // dense
+
+      common::GHistIndexMatrix gmat;
+      gmat.Init((*dmat).get(), max_bins);
+
+      RealImpl::InitData(gmat, row_gpairs, *(*dmat), tree);
+
+      // dense reference row for the root
+      hist_.AddHistRow(1);
+      BuildHist(row_gpairs, row_set_collection_[0],
+                gmat, quantile_index_block, hist_[1]);
+
+      // compact row over the same rows; must carry the same mass per bin
+      std::vector<uint32_t> bins;
+      std::vector<GHistEntry> entries;
+      hist_builder_.BuildHistSparse(row_gpairs, row_set_collection_[0],
+                                    gmat, &bins, &entries);
+      hist_.AddSparseHistRow(0, &bins, &entries);
+      GHistRow sparse = hist_[0];
+      GHistRow dense = hist_[1];
+      ASSERT_TRUE(sparse.IsSparse());
+      ASSERT_FALSE(dense.IsSparse());
+      for (uint32_t i = 0; i < sparse.size; ++i) {
+        ASSERT_NEAR(dense.begin[sparse.bins[i]].sum_grad,
+                    sparse.begin[i].sum_grad, kEps);
+        ASSERT_NEAR(dense.begin[sparse.bins[i]].sum_hess,
+                    sparse.begin[i].sum_hess, kEps);
+      }
+
+      // the scan over the compact row must find the same best split as
+      // the dense scan in TestEvaluateSplit
+      RealImpl::InitNewNode(0, gmat, row_gpairs, *(*dmat), tree);
+      snode_[0].root_gain = 0.8;
+      RealImpl::EvaluateSplit(0, gmat, hist_, *(*dmat), tree);
+
+      ASSERT_NEAR(snode_.at(0).best.loss_chg, 0.7128048, kEps);
+      ASSERT_EQ(snode_.at(0).best.SplitIndex(), 10);
+      ASSERT_NEAR(snode_.at(0).best.split_value, 0.182258, kEps);
+
+      delete dmat;
+    }
   };
 
   int static constexpr n_rows = 8, n_cols = 16;
@@ -131,6 +210,22 @@ class QuantileHistMock : public QuantileHistMaker {
     builder_->TestInitData(gmat, gpair, *(*dmat), tree);
   }
 
+  void TestInitDataZeroElision() {
+    size_t constexpr max_bins = 4;
+    common::GHistIndexMatrix gmat;
+    gmat.Init((*dmat).get(), max_bins);
+
+    RegTree tree = RegTree();
+    tree.param.InitAllowUnknown(cfg);
+
+    // three zero-weight rows whose gradient pairs are exactly zero
+    std::vector<GradientPair> gpair =
+        { {0.23f, 0.24f}, {0.0f, 0.0f}, {0.23f, 0.24f}, {0.0f, 0.0f},
+          {0.27f, 0.29f}, {0.27f, 0.29f}, {0.0f, 0.0f}, {0.27f, 0.29f} };
+
+    builder_->TestInitDataZeroElision(gmat, gpair, *(*dmat), tree);
+  }
+
   void TestBuildHist() {
     RegTree tree = RegTree();
     tree.param.InitAllowUnknown(cfg);
@@ -146,7 +241,15 @@ class QuantileHistMock : public QuantileHistMaker {
     RegTree tree = RegTree();
     tree.param.InitAllowUnknown(cfg);
 
-    builder_->TestEvaluateSplit(gmatb_, tree);
+    // feature grouping is not enabled; an empty block matrix is enough
+    builder_->TestEvaluateSplit(GHistIndexBlockMatrix(), tree);
+  }
+
+  void TestEvaluateSplitSparseHist() {
+    RegTree tree = RegTree();
+    tree.param.InitAllowUnknown(cfg);
+
+    builder_->TestEvaluateSplitSparseHist(GHistIndexBlockMatrix(), tree);
   }
 };
 
@@ -157,6 +260,14 @@ TEST(Updater, QuantileHist_InitData) {
   maker.TestInitData();
 }
 
+TEST(Updater, QuantileHist_InitDataZeroElision) {
+  std::vector<std::pair<std::string, std::string>> cfg
+      {{"num_feature", std::to_string(QuantileHistMock::GetNumColumns())},
+       {"elide_zero_gradient_rows", "true"}};
+  QuantileHistMock maker(cfg);
+  maker.TestInitDataZeroElision();
+}
+
 TEST(Updater, QuantileHist_BuildHist) {
   // Don't enable feature grouping
   std::vector<std::pair<std::string, std::string>> cfg
@@ -174,5 +285,14 @@ TEST(Updater, QuantileHist_EvalSplits) {
   maker.TestEvaluateSplit();
 }
 
+TEST(Updater, QuantileHist_EvalSplitsSparseHist) {
+  std::vector<std::pair<std::string, std::string>> cfg
+      {{"num_feature", std::to_string(QuantileHistMock::GetNumColumns())},
+       {"split_evaluator", "elastic_net"},
+       {"sparse_histogram_occupancy", "0.5"}};
+  QuantileHistMock maker(cfg);
+  maker.TestEvaluateSplitSparseHist();
+}
+
 }  // namespace tree
 }  // namespace xgboost
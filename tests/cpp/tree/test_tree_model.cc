@@ -84,4 +84,86 @@ TEST(Tree, Load) {
   EXPECT_EQ(tree[1].LeafValue(), 0.1f);
   EXPECT_TRUE(tree[1].IsLeaf());
 }
+
+TEST(Tree, DumpModel) {
+  RegTree tree;
+  tree.ExpandNode(0, 0, 0.5f, true);
+  tree[1].SetLeaf(0.25f);
+  tree[2].SetLeaf(-0.5f);
+
+  FeatureMap fmap;
+  EXPECT_EQ(tree.DumpModel(fmap, false, "text"),
+            "0:[f0<0.5] yes=1,no=2,missing=1\n"
+            "\t1:leaf=0.25\n"
+            "\t2:leaf=-0.5\n");
+  EXPECT_EQ(tree.DumpModel(fmap, false, "json"),
+            "  { \"nodeid\": 0, \"depth\": 0, \"split\": 0, "
+            "\"split_condition\": 0.5, \"yes\": 1, \"no\": 2, "
+            "\"missing\": 1, \"children\": [\n"
+            "    { \"nodeid\": 1, \"leaf\": 0.25 },\n"
+            "    { \"nodeid\": 2, \"leaf\": -0.5 }\n"
+            "  ]}");
+}
+
+TEST(Tree, ReorderNodes) {
+  RegTree tree;
+  tree.ExpandNode(0, 0, 0.5f, true);
+  tree.ExpandNode(2, 1, 0.7f, false);
+  tree[1].SetLeaf(0.25f);
+  tree[3].SetLeaf(0.5f);
+  tree[4].SetLeaf(0.75f);
+
+  // the right subtree is much hotter than the left leaf
+  std::vector<size_t> counts = {10, 2, 8, 7, 1};
+  tree.ReorderNodes(counts);
+
+  // root keeps its slot, the hot child takes the slot right after it and
+  // the hot leaf follows; the cold left leaf moves behind them
+  EXPECT_EQ(tree[0].SplitIndex(), 0);
+  EXPECT_EQ(tree[0].SplitCond(), 0.5f);
+  EXPECT_EQ(tree[0].RightChild(), 1);
+  EXPECT_EQ(tree[0].LeftChild(), 4);
+  EXPECT_EQ(tree[1].SplitIndex(), 1);
+  EXPECT_EQ(tree[1].SplitCond(), 0.7f);
+  EXPECT_EQ(tree[1].Parent(), 0);
+  EXPECT_EQ(tree[1].LeftChild(), 2);
+  EXPECT_EQ(tree[1].RightChild(), 3);
+  EXPECT_EQ(tree[2].LeafValue(), 0.5f);
+  EXPECT_EQ(tree[2].Parent(), 1);
+  EXPECT_EQ(tree[3].LeafValue(), 0.75f);
+  EXPECT_EQ(tree[4].LeafValue(), 0.25f);
+  EXPECT_EQ(tree[4].Parent(), 0);
+  EXPECT_TRUE(tree[4].IsLeftChild());
+}
+
+TEST(Tree, LeafVectorRoundtrip) {
+  dmlc::TemporaryDirectory tempdir;
+  const std::string tmp_file = tempdir.path + "/tree_vec.model";
+
+  RegTree tree;
+  tree.param.size_leaf_vector = 3;
+  tree.ExpandNode(0, 5, 0.5f, true);
+  tree[1].SetLeaf(0.1f);
+  tree[2].SetLeaf(0.2f);
+  tree.SetLeafVector(1, {0.1f, -0.2f, 0.3f});
+  tree.SetLeafVector(2, {-0.4f, 0.5f, -0.6f});
+  {
+    std::unique_ptr<dmlc::Stream> fo(
+        dmlc::Stream::Create(tmp_file.c_str(), "w"));
+    tree.Save(fo.get());
+  }
+
+  std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(tmp_file.c_str(), "r"));
+  RegTree loaded;
+  loaded.Load(fi.get());
+  EXPECT_EQ(loaded.param.size_leaf_vector, 3);
+  EXPECT_EQ(loaded[1].LeafValue(), 0.1f);
+  const bst_float* v1 = loaded.LeafVector(1);
+  EXPECT_EQ(v1[0], 0.1f);
+  EXPECT_EQ(v1[1], -0.2f);
+  EXPECT_EQ(v1[2], 0.3f);
+  const bst_float* v2 = loaded.LeafVector(2);
+  EXPECT_EQ(v2[0], -0.4f);
+  EXPECT_EQ(v2[2], -0.6f);
+}
 }  // namespace xgboost